@@ -389,6 +389,35 @@ BFChassisManager::~BFChassisManager() = default;
   xcvr_port_key_to_xcvr_state_ = xcvr_port_key_to_xcvr_state;
   initialized_ = true;
 
+  // The nodes added by this push get a port counters poller. Its sweeps are
+  // skipped until the push is done.
+  for (const auto& e : node_id_to_unit_) {
+    const uint64 node_id = e.first;
+    if (node_id_to_port_counters_poller_.count(node_id)) continue;
+    auto poller = absl::make_unique<PortCountersPoller>(
+        node_id,
+        [this, node_id](std::map<uint32, PortCounters>* counters) {
+          return ReadPortCounters(node_id, counters);
+        },
+        [this, node_id](uint32 port_id, const PortCounters& counters) {
+          SendPortCountersGnmiEvent(node_id, port_id, counters);
+        });
+    RETURN_IF_ERROR(poller->Start());
+    node_id_to_port_counters_poller_[node_id] = std::move(poller);
+  }
+
+  // The nodes dropped by this push have their poller stopped. The pollers
+  // never wait for chassis_lock (see ReadPortCounters()), so they can be
+  // stopped while the push holds it.
+  for (auto it = node_id_to_port_counters_poller_.begin();
+       it != node_id_to_port_counters_poller_.end();) {
+    if (node_id_to_unit_.count(it->first)) {
+      ++it;
+    } else {
+      it = node_id_to_port_counters_poller_.erase(it);
+    }
+  }
+
   return ::util::OkStatus();
 }
 
@@ -599,6 +628,19 @@ BFChassisManager::GetPortConfig(uint64 node_id, uint32 port_id) const {
                                       resp.mutable_port_counters()));
       break;
     }
+    case Request::kNodePortCounters: {
+      const auto& node_ports = request.node_port_counters();
+      auto* node_port_counters = resp.mutable_node_port_counters();
+      node_port_counters->set_node_id(node_ports.node_id());
+      std::map<uint32, PortCounters> counters;
+      RETURN_IF_ERROR(GetNodePortCounters(
+          node_ports.node_id(),
+          {node_ports.port_ids().begin(), node_ports.port_ids().end()},
+          &counters));
+      auto* port_counters = node_port_counters->mutable_port_counters();
+      for (auto& e : counters) (*port_counters)[e.first] = std::move(e.second);
+      break;
+    }
     case Request::kAutonegStatus: {
       ASSIGN_OR_RETURN(auto* config,
                        GetPortConfig(request.autoneg_status().node_id(),
@@ -684,6 +726,80 @@ BFChassisManager::GetPortConfig(uint64 node_id, uint32 port_id) const {
   return bf_sde_interface_->GetPortCounters(unit, sdk_port_id, counters);
 }
 
+::util::Status BFChassisManager::GetNodePortCounters(
+    uint64 node_id, const std::vector<uint32>& port_ids,
+    std::map<uint32, PortCounters>* counters) {
+  if (!initialized_) {
+    return MAKE_ERROR(ERR_NOT_INITIALIZED) << "Not initialized!";
+  }
+  CHECK_RETURN_IF_FALSE(counters != nullptr) << "counters is null.";
+  ASSIGN_OR_RETURN(auto unit, GetUnitFromNodeId(node_id));
+  const auto* port_id_to_sdk_port_id =
+      gtl::FindOrNull(node_id_to_port_id_to_sdk_port_id_, node_id);
+  CHECK_RETURN_IF_FALSE(port_id_to_sdk_port_id != nullptr)
+      << "Unknown node " << node_id << ".";
+  // All the ports of the node, or the listed ones.
+  const std::map<uint32, uint32>* requested = port_id_to_sdk_port_id;
+  std::map<uint32, uint32> listed;
+  if (!port_ids.empty()) {
+    for (uint32 port_id : port_ids) {
+      ASSIGN_OR_RETURN(auto sdk_port_id, GetSdkPortId(node_id, port_id));
+      listed[port_id] = sdk_port_id;
+    }
+    requested = &listed;
+  }
+
+  counters->clear();
+  std::map<int, PortCounters> sdk_port_id_to_counters;
+  auto status =
+      bf_sde_interface_->GetAllPortCounters(unit, &sdk_port_id_to_counters);
+  if (!status.ok()) {
+    // The port stat table is not available before the first pipeline push.
+    VLOG(1) << "Reading the counters of node " << node_id
+            << " one port at a time: " << status;
+    for (const auto& e : *requested) {
+      PortCounters port_counters;
+      auto port_status =
+          bf_sde_interface_->GetPortCounters(unit, e.second, &port_counters);
+      if (!port_status.ok()) {
+        // The other ports are still reported.
+        LOG_EVERY_N(WARNING, 100) << "Failed to read the counters of port "
+                                  << e.first << " in node " << node_id
+                                  << ": " << port_status;
+        continue;
+      }
+      (*counters)[e.first] = std::move(port_counters);
+    }
+    return ::util::OkStatus();
+  }
+  for (const auto& e : *requested) {
+    auto* port_counters = gtl::FindOrNull(sdk_port_id_to_counters,
+                                          static_cast<int>(e.second));
+    if (port_counters == nullptr) {
+      // The other ports are still reported.
+      LOG_EVERY_N(WARNING, 100) << "No counters for port " << e.first
+                                << " in node " << node_id << " (SDK port "
+                                << e.second << ").";
+      continue;
+    }
+    (*counters)[e.first] = std::move(*port_counters);
+  }
+
+  return ::util::OkStatus();
+}
+
+::util::Status BFChassisManager::ReadPortCounters(
+    uint64 node_id, std::map<uint32, PortCounters>* counters) {
+  // A sweep does not wait for a config push, which may stop its poller.
+  if (!chassis_lock.ReaderTryLock()) {
+    return MAKE_ERROR(ERR_NO_OP).without_logging()
+           << "The chassis lock is held, skipping the sweep.";
+  }
+  ::util::Status status = GetNodePortCounters(node_id, {}, counters);
+  chassis_lock.ReaderUnlock();
+  return status;
+}
+
 ::util::StatusOr<std::map<uint64, int>> BFChassisManager::GetNodeIdToUnitMap()
     const {
   if (!initialized_) {
@@ -826,6 +942,17 @@ void BFChassisManager::SendPortOperStateGnmiEvent(uint64 node_id,
   }
 }
 
+void BFChassisManager::SendPortCountersGnmiEvent(
+    uint64 node_id, uint32 port_id, const PortCounters& counters) {
+  absl::ReaderMutexLock l(&gnmi_event_lock_);
+  if (!gnmi_event_writer_) return;
+  if (!gnmi_event_writer_->Write(GnmiEventPtr(
+          new PortCountersChangedEvent(node_id, port_id, counters)))) {
+    // Remove WriterInterface if it is no longer operational.
+    gnmi_event_writer_.reset();
+  }
+}
+
 void BFChassisManager::ReadPortStatusEvents() {
   PortStatusEvent event;
   while (true) {
@@ -1084,6 +1211,14 @@ void BFChassisManager::CleanupInternalState() {
     absl::ReaderMutexLock l(&chassis_lock);
     if (!initialized_) return status;
   }
+  // The port counters pollers are stopped without holding the chassis lock,
+  // which their sweeps take.
+  std::map<uint64, std::unique_ptr<PortCountersPoller>> pollers;
+  {
+    absl::WriterMutexLock l(&chassis_lock);
+    pollers.swap(node_id_to_port_counters_poller_);
+  }
+  pollers.clear();
   // It is fine to release the chassis lock here (it is actually needed to call
   // UnregisterEventWriters or there would be a deadlock). Because initialized_
   // is set to true, RegisterEventWriters cannot be called.
@@ -7,6 +7,7 @@
 #include <map>
 #include <memory>
 #include <thread>  // NOLINT
+#include <vector>
 
 #include "absl/base/thread_annotations.h"
 #include "absl/memory/memory.h"
@@ -16,6 +17,7 @@
 #include "stratum/hal/lib/barefoot/bf_sde_interface.h"
 #include "stratum/hal/lib/common/gnmi_events.h"
 #include "stratum/hal/lib/common/phal_interface.h"
+#include "stratum/hal/lib/common/port_counters_poller.h"
 #include "stratum/hal/lib/common/utils.h"
 #include "stratum/hal/lib/common/writer_interface.h"
 #include "stratum/lib/channel/channel.h"
@@ -57,6 +59,14 @@ class BFChassisManager {
                                          PortCounters* counters)
       SHARED_LOCKS_REQUIRED(chassis_lock);
 
+  // Gets the counters of the given ports of a node, or of all its ports if
+  // port_ids is empty, keyed by port ID. All the counters are read from the
+  // SDE at once. The ports whose counters cannot be read are left out.
+  virtual ::util::Status GetNodePortCounters(
+      uint64 node_id, const std::vector<uint32>& port_ids,
+      std::map<uint32, PortCounters>* counters)
+      SHARED_LOCKS_REQUIRED(chassis_lock);
+
   virtual ::util::Status ReplayPortsConfig(uint64 node_id)
       EXCLUSIVE_LOCKS_REQUIRED(chassis_lock);
 
@@ -129,6 +139,20 @@ class BFChassisManager {
                                   PortState new_state)
       LOCKS_EXCLUDED(gnmi_event_lock_);
 
+  // Forward the counters of a port which changed since the previous sweep of
+  // its node's PortCountersPoller through the registered
+  // WriterInterface<GnmiEventPtr> object.
+  void SendPortCountersGnmiEvent(uint64 node_id, uint32 port_id,
+                                 const PortCounters& counters)
+      LOCKS_EXCLUDED(gnmi_event_lock_);
+
+  // Reads the counters of all the ports of a node, keyed by port ID. Used as
+  // the ReadFunc of the PortCountersPoller of the node. Returns ERR_NO_OP
+  // rather than wait if chassis_lock is held by a writer.
+  ::util::Status ReadPortCounters(uint64 node_id,
+                                  std::map<uint32, PortCounters>* counters)
+      LOCKS_EXCLUDED(chassis_lock);
+
   // Thread function for reading and processing port state events.
   void ReadPortStatusEvents() LOCKS_EXCLUDED(chassis_lock);
 
@@ -239,6 +263,14 @@ class BFChassisManager {
   // Pointer to a BfSdeInterface implementation that wraps all the SDE calls.
   BfSdeInterface* bf_sde_interface_;  // not owned by this class.
 
+  // Map from node ID to the poller publishing the port counters which changed
+  // to the ON_CHANGE gNMI subscriptions. The pollers are created by the first
+  // config push of a node, and stopped by the push which drops the node or by
+  // Shutdown(). Declared last so that the polling threads are stopped before
+  // the rest of the state is destroyed.
+  std::map<uint64, std::unique_ptr<PortCountersPoller>>
+      node_id_to_port_counters_poller_ GUARDED_BY(chassis_lock);
+
   friend class BFChassisManagerTest;
 };
 
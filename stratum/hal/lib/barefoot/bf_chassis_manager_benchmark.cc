@@ -0,0 +1,145 @@
+// Copyright 2018-present Open Networking Foundation
+// SPDX-License-Identifier: Apache-2.0
+
+// Benchmarks the retrieval of the counters of all the ports of a node through
+// BFChassisManager::GetPortData, on top of the SDE mock. BM_PerPortCounters
+// sends one port_counters request per port, each taking the chassis lock and
+// making one SDE call. BM_NodePortCounters sends a single node_port_counters
+// request, served with one SDE call. The argument is the number of ports of
+// the node; the sde_calls_per_read counter reports the number of SDE calls
+// made to read the counters of all the ports once.
+
+#include <map>
+#include <memory>
+
+#include "absl/memory/memory.h"
+#include "absl/synchronization/mutex.h"
+#include "benchmark/benchmark.h"
+#include "gflags/gflags.h"
+#include "gmock/gmock.h"
+#include "stratum/glue/logging.h"
+#include "stratum/hal/lib/barefoot/bf_chassis_manager.h"
+#include "stratum/hal/lib/barefoot/bf_sde_mock.h"
+#include "stratum/hal/lib/common/common.pb.h"
+#include "stratum/hal/lib/common/phal_mock.h"
+#include "stratum/lib/constants.h"
+
+DECLARE_int32(port_counters_poll_interval_ms);
+
+namespace stratum {
+namespace hal {
+namespace barefoot {
+namespace {
+
+using ::testing::_;
+using ::testing::Invoke;
+using ::testing::NiceMock;
+using ::testing::Return;
+using ::testing::WithArg;
+
+constexpr uint64 kNodeId = 1;
+constexpr int kSlot = 1;
+constexpr uint32 kSdkPortOffset = 100;
+
+// A BFChassisManager, on top of the mocks, managing a node with the given
+// number of ports.
+class Chassis {
+ public:
+  explicit Chassis(int num_ports) : num_ports_(num_ports), num_sde_calls_(0) {
+    FLAGS_port_counters_poll_interval_ms = 0;
+    ON_CALL(*bf_sde_mock_, GetPortIdFromPortKey(_, _))
+        .WillByDefault(WithArg<1>(Invoke([](const PortKey& port_key) {
+          return ::util::StatusOr<uint32>(port_key.port + kSdkPortOffset);
+        })));
+    ON_CALL(*bf_sde_mock_, IsValidPort(_, _)).WillByDefault(Return(true));
+    ON_CALL(*phal_mock_, RegisterTransceiverEventWriter(_, _))
+        .WillByDefault(Return(::util::StatusOr<int>(1)));
+    ON_CALL(*bf_sde_mock_, GetPortCounters(_, _, _))
+        .WillByDefault(
+            WithArg<2>(Invoke([this](PortCounters* counters) {
+              ++num_sde_calls_;
+              counters->set_in_octets(1000);
+              return ::util::OkStatus();
+            })));
+    ON_CALL(*bf_sde_mock_, GetAllPortCounters(_, _))
+        .WillByDefault(WithArg<1>(
+            Invoke([this](std::map<int, PortCounters>* counters) {
+              ++num_sde_calls_;
+              for (int port = 1; port <= num_ports_; ++port) {
+                (*counters)[port + kSdkPortOffset].set_in_octets(1000);
+              }
+              return ::util::OkStatus();
+            })));
+    bf_chassis_manager_ = BFChassisManager::CreateInstance(
+        OPERATION_MODE_STANDALONE, phal_mock_.get(), bf_sde_mock_.get());
+
+    ChassisConfig config;
+    config.mutable_chassis()->set_platform(PLT_GENERIC_BAREFOOT_TOFINO);
+    auto* node = config.add_nodes();
+    node->set_id(kNodeId);
+    node->set_slot(kSlot);
+    for (int port = 1; port <= num_ports_; ++port) {
+      auto* singleton_port = config.add_singleton_ports();
+      singleton_port->set_id(port);
+      singleton_port->set_node(kNodeId);
+      singleton_port->set_slot(kSlot);
+      singleton_port->set_port(port);
+      singleton_port->set_speed_bps(kHundredGigBps);
+      singleton_port->mutable_config_params()->set_admin_state(
+          ADMIN_STATE_ENABLED);
+    }
+    absl::WriterMutexLock l(&chassis_lock);
+    CHECK_OK(bf_chassis_manager_->PushChassisConfig(config));
+  }
+
+  ~Chassis() { CHECK_OK(bf_chassis_manager_->Shutdown()); }
+
+  BFChassisManager* bf_chassis_manager() { return bf_chassis_manager_.get(); }
+  int num_ports() const { return num_ports_; }
+  int64 num_sde_calls() const { return num_sde_calls_; }
+
+ private:
+  const int num_ports_;
+  int64 num_sde_calls_;
+  std::unique_ptr<NiceMock<PhalMock>> phal_mock_ =
+      absl::make_unique<NiceMock<PhalMock>>();
+  std::unique_ptr<NiceMock<BfSdeMock>> bf_sde_mock_ =
+      absl::make_unique<NiceMock<BfSdeMock>>();
+  std::unique_ptr<BFChassisManager> bf_chassis_manager_;
+};
+
+void BM_PerPortCounters(benchmark::State& state) {
+  Chassis chassis(state.range(0));
+  DataRequest::Request req;
+  req.mutable_port_counters()->set_node_id(kNodeId);
+  for (auto _ : state) {
+    for (int port = 1; port <= chassis.num_ports(); ++port) {
+      req.mutable_port_counters()->set_port_id(port);
+      absl::ReaderMutexLock l(&chassis_lock);
+      auto ret = chassis.bf_chassis_manager()->GetPortData(req);
+      benchmark::DoNotOptimize(ret);
+    }
+  }
+  state.counters["sde_calls_per_read"] = benchmark::Counter(
+      static_cast<double>(chassis.num_sde_calls()) / state.iterations());
+}
+BENCHMARK(BM_PerPortCounters)->Arg(32)->Arg(64)->Arg(256);
+
+void BM_NodePortCounters(benchmark::State& state) {
+  Chassis chassis(state.range(0));
+  DataRequest::Request req;
+  req.mutable_node_port_counters()->set_node_id(kNodeId);
+  for (auto _ : state) {
+    absl::ReaderMutexLock l(&chassis_lock);
+    auto ret = chassis.bf_chassis_manager()->GetPortData(req);
+    benchmark::DoNotOptimize(ret);
+  }
+  state.counters["sde_calls_per_read"] = benchmark::Counter(
+      static_cast<double>(chassis.num_sde_calls()) / state.iterations());
+}
+BENCHMARK(BM_NodePortCounters)->Arg(32)->Arg(64)->Arg(256);
+
+}  // namespace
+}  // namespace barefoot
+}  // namespace hal
+}  // namespace stratum
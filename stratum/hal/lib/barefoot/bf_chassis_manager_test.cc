@@ -3,10 +3,12 @@
 
 #include "stratum/hal/lib/barefoot/bf_chassis_manager.h"
 
+#include <map>
 #include <string>
 
 #include "absl/time/clock.h"
 #include "absl/time/time.h"
+#include "gflags/gflags.h"
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
 #include "stratum/glue/integral_types.h"
@@ -16,10 +18,13 @@
 #include "stratum/hal/lib/barefoot/bf_sde_mock.h"
 #include "stratum/hal/lib/common/common.pb.h"
 #include "stratum/hal/lib/common/phal_mock.h"
+#include "stratum/hal/lib/common/writer_mock.h"
 #include "stratum/lib/constants.h"
 #include "stratum/lib/test_utils/matchers.h"
 #include "stratum/lib/utils.h"
 
+DECLARE_int32(port_counters_poll_interval_ms);
+
 namespace stratum {
 namespace hal {
 namespace barefoot {
@@ -33,6 +38,7 @@ using ::testing::Invoke;
 using ::testing::Matcher;
 using ::testing::Mock;
 using ::testing::Return;
+using ::testing::SaveArg;
 using ::testing::SetArgPointee;
 using ::testing::WithArg;
 
@@ -108,6 +114,8 @@ class BFChassisManagerTest : public ::testing::Test {
   BFChassisManagerTest() {}
 
   void SetUp() override {
+    // The tests sweep the port counters themselves.
+    FLAGS_port_counters_poll_interval_ms = 0;
     phal_mock_ = absl::make_unique<PhalMock>();
     bf_sde_mock_ = absl::make_unique<BfSdeMock>();
     // TODO(max): create parametrized test suite over mode.
@@ -150,6 +158,8 @@ class BFChassisManagerTest : public ::testing::Test {
                           nullptr);
     CHECK_RETURN_IF_FALSE(bf_chassis_manager_->xcvr_event_channel_ == nullptr);
     CHECK_RETURN_IF_FALSE(bf_chassis_manager_->xcvr_event_reader_ == nullptr);
+    CHECK_RETURN_IF_FALSE(
+        bf_chassis_manager_->node_id_to_port_counters_poller_.empty());
     return ::util::OkStatus();
   }
 
@@ -214,6 +224,20 @@ class BFChassisManagerTest : public ::testing::Test {
     return bf_chassis_manager_->GetUnitFromNodeId(node_id);
   }
 
+  ::util::StatusOr<int> SweepPortCounters(uint64 node_id) {
+    PortCountersPoller* poller;
+    {
+      absl::ReaderMutexLock l(&chassis_lock);
+      auto it = bf_chassis_manager_->node_id_to_port_counters_poller_.find(
+          node_id);
+      CHECK_RETURN_IF_FALSE(
+          it != bf_chassis_manager_->node_id_to_port_counters_poller_.end())
+          << "No port counters poller for node " << node_id << ".";
+      poller = it->second.get();
+    }
+    return poller->Sweep();
+  }
+
   ::util::Status Shutdown() { return bf_chassis_manager_->Shutdown(); }
 
   ::util::Status ShutdownAndTestCleanState() {
@@ -514,6 +538,152 @@ TEST_F(BFChassisManagerTest, GetPortData) {
   ASSERT_OK(ShutdownAndTestCleanState());
 }
 
+TEST_F(BFChassisManagerTest, GetNodePortCounters) {
+  ASSERT_OK(PushBaseChassisConfig());
+  const uint32 sdkPortId = kPortId + kSdkPortOffset;
+
+  std::map<int, PortCounters> sdk_counters;
+  sdk_counters[sdkPortId].set_in_octets(100);
+  sdk_counters[sdkPortId].set_out_octets(200);
+  // A port of the device which is not in the config.
+  sdk_counters[sdkPortId + 1].set_in_octets(300);
+  EXPECT_CALL(*bf_sde_mock_, GetAllPortCounters(kUnit, _))
+      .Times(2)
+      .WillRepeatedly(
+          DoAll(SetArgPointee<1>(sdk_counters), Return(::util::OkStatus())));
+
+  // All the ports of the node.
+  DataRequest::Request req;
+  req.mutable_node_port_counters()->set_node_id(kNodeId);
+  {
+    absl::ReaderMutexLock l(&chassis_lock);
+    auto ret = bf_chassis_manager_->GetPortData(req);
+    ASSERT_OK(ret.status());
+    const auto& resp = ret.ValueOrDie().node_port_counters();
+    EXPECT_EQ(kNodeId, resp.node_id());
+    ASSERT_EQ(1, resp.port_counters_size());
+    EXPECT_THAT(resp.port_counters().at(kPortId),
+                EqualsProto(sdk_counters[sdkPortId]));
+  }
+
+  // The listed ports only.
+  req.mutable_node_port_counters()->add_port_ids(kPortId);
+  {
+    absl::ReaderMutexLock l(&chassis_lock);
+    auto ret = bf_chassis_manager_->GetPortData(req);
+    ASSERT_OK(ret.status());
+    const auto& resp = ret.ValueOrDie().node_port_counters();
+    ASSERT_EQ(1, resp.port_counters_size());
+    EXPECT_THAT(resp.port_counters().at(kPortId),
+                EqualsProto(sdk_counters[sdkPortId]));
+  }
+
+  // Falls back to one read per port if the port stat table cannot be read.
+  EXPECT_CALL(*bf_sde_mock_, GetAllPortCounters(kUnit, _))
+      .WillOnce(Return(::util::Status(StratumErrorSpace(), ERR_NOT_INITIALIZED,
+                                      "No pipeline.")));
+  EXPECT_CALL(*bf_sde_mock_, GetPortCounters(kUnit, sdkPortId, _))
+      .WillOnce(DoAll(SetArgPointee<2>(sdk_counters[sdkPortId]),
+                      Return(::util::OkStatus())));
+  {
+    absl::ReaderMutexLock l(&chassis_lock);
+    auto ret = bf_chassis_manager_->GetPortData(req);
+    ASSERT_OK(ret.status());
+    const auto& resp = ret.ValueOrDie().node_port_counters();
+    ASSERT_EQ(1, resp.port_counters_size());
+    EXPECT_THAT(resp.port_counters().at(kPortId),
+                EqualsProto(sdk_counters[sdkPortId]));
+  }
+
+  // A port missing from the SDE counters is left out rather than failing the
+  // read of the node.
+  EXPECT_CALL(*bf_sde_mock_, GetAllPortCounters(kUnit, _))
+      .WillOnce(DoAll(SetArgPointee<1>(std::map<int, PortCounters>{}),
+                      Return(::util::OkStatus())));
+  {
+    absl::ReaderMutexLock l(&chassis_lock);
+    auto ret = bf_chassis_manager_->GetPortData(req);
+    ASSERT_OK(ret.status());
+    EXPECT_EQ(0, ret.ValueOrDie().node_port_counters().port_counters_size());
+  }
+
+  // Unknown port.
+  req.mutable_node_port_counters()->add_port_ids(kPortId + 1);
+  {
+    absl::ReaderMutexLock l(&chassis_lock);
+    EXPECT_FALSE(bf_chassis_manager_->GetPortData(req).ok());
+  }
+
+  ASSERT_OK(ShutdownAndTestCleanState());
+}
+
+TEST_F(BFChassisManagerTest, PublishChangedPortCounters) {
+  ASSERT_OK(PushBaseChassisConfig());
+  const uint32 sdkPortId = kPortId + kSdkPortOffset;
+
+  auto writer = std::make_shared<WriterMock<GnmiEventPtr>>();
+  ASSERT_OK(bf_chassis_manager_->RegisterEventNotifyWriter(writer));
+
+  std::map<int, PortCounters> counters;
+  counters[sdkPortId].set_in_octets(100);
+  EXPECT_CALL(*bf_sde_mock_, GetAllPortCounters(kUnit, _))
+      .WillRepeatedly(
+          DoAll(SetArgPointee<1>(counters), Return(::util::OkStatus())));
+  // The first sweep only records the counters.
+  EXPECT_CALL(*writer, Write(_)).Times(0);
+  auto ret = SweepPortCounters(kNodeId);
+  ASSERT_OK(ret.status());
+  EXPECT_EQ(0, ret.ValueOrDie());
+  // Nothing moved.
+  ret = SweepPortCounters(kNodeId);
+  ASSERT_OK(ret.status());
+  EXPECT_EQ(0, ret.ValueOrDie());
+  Mock::VerifyAndClearExpectations(writer.get());
+
+  counters[sdkPortId].set_in_octets(200);
+  EXPECT_CALL(*bf_sde_mock_, GetAllPortCounters(kUnit, _))
+      .WillRepeatedly(
+          DoAll(SetArgPointee<1>(counters), Return(::util::OkStatus())));
+  GnmiEventPtr event;
+  EXPECT_CALL(*writer, Write(_))
+      .WillOnce(DoAll(SaveArg<0>(&event), Return(true)));
+  ret = SweepPortCounters(kNodeId);
+  ASSERT_OK(ret.status());
+  EXPECT_EQ(1, ret.ValueOrDie());
+  auto* counters_event = dynamic_cast<PortCountersChangedEvent*>(event.get());
+  ASSERT_NE(nullptr, counters_event);
+  EXPECT_EQ(kNodeId, counters_event->GetNodeId());
+  EXPECT_EQ(kPortId, counters_event->GetPortId());
+  EXPECT_EQ(200U, counters_event->GetInOctets());
+
+  ASSERT_OK(bf_chassis_manager_->UnregisterEventNotifyWriter());
+  ASSERT_OK(ShutdownAndTestCleanState());
+}
+
+TEST_F(BFChassisManagerTest, PushStopsPortCountersPollerOfDroppedNode) {
+  ASSERT_OK(PushBaseChassisConfig());
+
+  // The node is replaced by another one.
+  ChassisConfigBuilder builder(kNodeId + 1);
+  const uint32 portId = kPortId + 1;
+  RegisterSdkPortId(builder.AddPort(portId, kPort + 1, ADMIN_STATE_ENABLED));
+  EXPECT_CALL(*bf_sde_mock_, DeletePort(kUnit, kPortId + kSdkPortOffset));
+  EXPECT_CALL(*bf_sde_mock_, AddPort(kUnit, portId + kSdkPortOffset,
+                                     kDefaultSpeedBps, kDefaultFecMode));
+  EXPECT_CALL(*bf_sde_mock_, EnablePort(kUnit, portId + kSdkPortOffset));
+  ASSERT_OK(PushChassisConfig(builder));
+
+  {
+    absl::ReaderMutexLock l(&chassis_lock);
+    const auto& pollers = bf_chassis_manager_->node_id_to_port_counters_poller_;
+    EXPECT_EQ(1, pollers.size());
+    EXPECT_EQ(0, pollers.count(kNodeId));
+    EXPECT_EQ(1, pollers.count(kNodeId + 1));
+  }
+
+  ASSERT_OK(ShutdownAndTestCleanState());
+}
+
 TEST_F(BFChassisManagerTest, UpdateInvalidPort) {
   ASSERT_OK(PushBaseChassisConfig());
   ChassisConfigBuilder builder;
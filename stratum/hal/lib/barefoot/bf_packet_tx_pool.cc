@@ -0,0 +1,174 @@
+// Copyright 2020-present Open Networking Foundation
+// SPDX-License-Identifier: Apache-2.0
+
+#include "stratum/hal/lib/barefoot/bf_packet_tx_pool.h"
+
+#include <algorithm>
+
+#include "absl/time/clock.h"
+#include "stratum/glue/logging.h"
+#include "stratum/lib/macros.h"
+#include "stratum/public/lib/error.h"
+
+namespace stratum {
+namespace hal {
+namespace barefoot {
+
+namespace {
+
+// The TX rate is measured over intervals of this length.
+constexpr absl::Duration kRateInterval = absl::Seconds(1);
+
+}  // namespace
+
+BfPacketTxPool::BfPacketTxPool(
+    const std::vector<std::vector<void*>>& buffers_by_ring)
+    : buffers_(),
+      buffer_tx_rings_(),
+      buffer_index_(),
+      num_tx_rings_(buffers_by_ring.size()),
+      free_buffers_by_ring_(buffers_by_ring.size()),
+      num_free_buffers_(0),
+      submit_times_(),
+      in_flight_(),
+      drained_(false),
+      next_tx_ring_(0),
+      stats_(),
+      rate_interval_start_(absl::Now()),
+      rate_interval_start_packets_(0),
+      tx_rate_pps_(0) {
+  for (int tx_ring = 0; tx_ring < num_tx_rings_; ++tx_ring) {
+    const auto& buffers = buffers_by_ring[tx_ring];
+    // Push the buffers in reverse, so that they are handed out in order.
+    for (auto it = buffers.rbegin(); it != buffers.rend(); ++it) {
+      buffer_index_.emplace(*it, buffers_.size());
+      free_buffers_by_ring_[tx_ring].push_back(buffers_.size());
+      buffers_.push_back(*it);
+      buffer_tx_rings_.push_back(tx_ring);
+    }
+  }
+  num_free_buffers_ = buffers_.size();
+  submit_times_.resize(buffers_.size());
+  in_flight_.resize(buffers_.size(), false);
+}
+
+::util::Status BfPacketTxPool::Acquire(void** buffer, int* tx_ring) {
+  absl::MutexLock l(&lock_);
+  if (drained_) {
+    return MAKE_ERROR(ERR_CANCELLED).without_logging()
+           << "The TX buffers are being freed.";
+  }
+  if (num_free_buffers_ == 0) {
+    stats_.num_dropped_no_buffer++;
+    return MAKE_ERROR(ERR_NO_RESOURCE).without_logging()
+           << "All " << buffers_.size() << " TX buffers are in flight.";
+  }
+  // There is a free buffer, so this finds a TX ring with one.
+  int ring = next_tx_ring_;
+  while (free_buffers_by_ring_[ring].empty()) {
+    ring = (ring + 1) % num_tx_rings_;
+  }
+  const int index = free_buffers_by_ring_[ring].back();
+  free_buffers_by_ring_[ring].pop_back();
+  num_free_buffers_--;
+  in_flight_[index] = true;
+  submit_times_[index] = absl::Now();
+  *buffer = buffers_[index];
+  *tx_ring = ring;
+  next_tx_ring_ = (ring + 1) % num_tx_rings_;
+  stats_.num_packets++;
+
+  return ::util::OkStatus();
+}
+
+void BfPacketTxPool::Abort(void* buffer) {
+  absl::MutexLock l(&lock_);
+  auto it = buffer_index_.find(buffer);
+  if (it == buffer_index_.end() || !in_flight_[it->second]) {
+    LOG(ERROR) << "Aborted TX buffer " << buffer << " is not in flight.";
+    return;
+  }
+  ReleaseBuffer(it->second);
+  stats_.num_packets--;
+  stats_.num_dropped_tx_error++;
+}
+
+BfPacketTxPool::CompleteResult BfPacketTxPool::Complete(void* buffer,
+                                                        bool success) {
+  const absl::Time now = absl::Now();
+  absl::MutexLock l(&lock_);
+  auto it = buffer_index_.find(buffer);
+  if (it == buffer_index_.end()) return kNotPooled;
+  const int index = it->second;
+  if (!in_flight_[index]) return kNotInFlight;
+  ReleaseBuffer(index);
+
+  const absl::Duration completion_time = now - submit_times_[index];
+  stats_.num_completed++;
+  if (!success) stats_.num_completion_errors++;
+  stats_.total_completion_time += completion_time;
+  stats_.max_completion_time =
+      std::max(stats_.max_completion_time, completion_time);
+  UpdateTxRate(now);
+
+  return kCompleted;
+}
+
+bool BfPacketTxPool::Drain(absl::Duration timeout) {
+  absl::MutexLock l(&lock_);
+  drained_ = true;
+  return lock_.AwaitWithTimeout(
+      absl::Condition(this, &BfPacketTxPool::AllBuffersFree), timeout);
+}
+
+std::vector<void*> BfPacketTxPool::GetFreeBuffers() const {
+  absl::MutexLock l(&lock_);
+  std::vector<void*> free_buffers;
+  free_buffers.reserve(num_free_buffers_);
+  for (size_t i = 0; i < buffers_.size(); ++i) {
+    if (!in_flight_[i]) free_buffers.push_back(buffers_[i]);
+  }
+  return free_buffers;
+}
+
+BfSdeInterface::PacketTxStats BfPacketTxPool::GetStats() const {
+  const absl::Time now = absl::Now();
+  absl::MutexLock l(&lock_);
+  BfSdeInterface::PacketTxStats stats = stats_;
+  stats.num_in_flight = buffers_.size() - num_free_buffers_;
+  // Once the current interval is over, the rate is the one measured since its
+  // start, so that the rate drops to zero when no packets are sent anymore.
+  const absl::Duration elapsed = now - rate_interval_start_;
+  if (elapsed >= kRateInterval) {
+    stats.tx_rate_pps =
+        (stats_.num_completed - rate_interval_start_packets_) /
+        absl::ToDoubleSeconds(elapsed);
+  } else {
+    stats.tx_rate_pps = tx_rate_pps_;
+  }
+
+  return stats;
+}
+
+bool BfPacketTxPool::AllBuffersFree() const {
+  return num_free_buffers_ == buffers_.size();
+}
+
+void BfPacketTxPool::ReleaseBuffer(int index) {
+  in_flight_[index] = false;
+  free_buffers_by_ring_[buffer_tx_rings_[index]].push_back(index);
+  num_free_buffers_++;
+}
+
+void BfPacketTxPool::UpdateTxRate(absl::Time now) {
+  const absl::Duration elapsed = now - rate_interval_start_;
+  if (elapsed < kRateInterval) return;
+  tx_rate_pps_ = (stats_.num_completed - rate_interval_start_packets_) /
+                 absl::ToDoubleSeconds(elapsed);
+  rate_interval_start_ = now;
+  rate_interval_start_packets_ = stats_.num_completed;
+}
+
+}  // namespace barefoot
+}  // namespace hal
+}  // namespace stratum
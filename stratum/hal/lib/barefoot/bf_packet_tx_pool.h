@@ -0,0 +1,142 @@
+// Copyright 2020-present Open Networking Foundation
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef STRATUM_HAL_LIB_BAREFOOT_BF_PACKET_TX_POOL_H_
+#define STRATUM_HAL_LIB_BAREFOOT_BF_PACKET_TX_POOL_H_
+
+#include <vector>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/time.h"
+#include "stratum/glue/integral_types.h"
+#include "stratum/glue/status/status.h"
+#include "stratum/hal/lib/barefoot/bf_sde_interface.h"
+
+namespace stratum {
+namespace hal {
+namespace barefoot {
+
+// BfPacketTxPool keeps track of a fixed set of preallocated packet buffers
+// used to transmit packets on the PCIe CPU port. A buffer is taken from the
+// pool for each transmitted packet and returned to it by the TX completion
+// notification of the packet, so that no buffer is allocated or freed per
+// packet. Each buffer belongs to one TX ring, and the packets are spread over
+// the TX rings in round robin order.
+//
+// The buffers are opaque to this class (they are bf_pkt pointers in
+// BfSdeWrapper), which does not allocate or free them. All the methods are
+// thread-safe.
+class BfPacketTxPool {
+ public:
+  // The outcome of Complete().
+  enum CompleteResult {
+    // The buffer was in flight and is back in the pool.
+    kCompleted,
+    // The buffer is from the pool but was not in flight. It is still owned
+    // by the pool and must not be freed.
+    kNotInFlight,
+    // The buffer is not from the pool, the caller owns it.
+    kNotPooled,
+  };
+
+  // Creates a pool of the given buffers, which are all free. The i-th element
+  // of buffers_by_ring holds the buffers of the i-th TX ring.
+  explicit BfPacketTxPool(
+      const std::vector<std::vector<void*>>& buffers_by_ring);
+
+  // Takes a free buffer out of the pool for a packet to be transmitted now, and
+  // returns the TX ring of the buffer to transmit the packet on. The TX rings
+  // are tried in turn, starting from the one after that of the previous
+  // packet. Returns ERR_NO_RESOURCE if all the buffers are in flight, and
+  // ERR_CANCELLED once the pool is drained.
+  ::util::Status Acquire(void** buffer, int* tx_ring) LOCKS_EXCLUDED(lock_);
+
+  // Returns a buffer whose packet could not be submitted to its TX ring.
+  void Abort(void* buffer) LOCKS_EXCLUDED(lock_);
+
+  // Returns a buffer to the pool on the TX completion of its packet, and
+  // accounts for the completion.
+  CompleteResult Complete(void* buffer, bool success) LOCKS_EXCLUDED(lock_);
+
+  // Stops handing out buffers, and waits up to the given timeout for the
+  // packets in flight to complete. Returns true if none is in flight anymore.
+  bool Drain(absl::Duration timeout) LOCKS_EXCLUDED(lock_);
+
+  // Returns the buffers that are not in flight. The others may still be read
+  // by the DMA engine and must not be freed.
+  std::vector<void*> GetFreeBuffers() const LOCKS_EXCLUDED(lock_);
+
+  // Returns the counters of the transmitted packets.
+  BfSdeInterface::PacketTxStats GetStats() const LOCKS_EXCLUDED(lock_);
+
+  // Returns all the buffers of the pool, free or in flight.
+  const std::vector<void*>& buffers() const { return buffers_; }
+
+  // Returns the number of TX rings the packets are spread over.
+  int num_tx_rings() const { return num_tx_rings_; }
+
+  // BfPacketTxPool is neither copyable nor movable.
+  BfPacketTxPool(const BfPacketTxPool&) = delete;
+  BfPacketTxPool& operator=(const BfPacketTxPool&) = delete;
+
+ private:
+  // Returns true if no buffer is in flight.
+  bool AllBuffersFree() const EXCLUSIVE_LOCKS_REQUIRED(lock_);
+
+  // Marks the buffer with the given index in buffers_ as free.
+  void ReleaseBuffer(int index) EXCLUSIVE_LOCKS_REQUIRED(lock_);
+
+  // Moves to a new rate interval if the current one is over.
+  void UpdateTxRate(absl::Time now) EXCLUSIVE_LOCKS_REQUIRED(lock_);
+
+  // The buffers of the pool and the TX ring of each of them. Never change
+  // after construction.
+  std::vector<void*> buffers_;
+  std::vector<int> buffer_tx_rings_;
+
+  // Maps a buffer to its index in buffers_. Never changes after construction.
+  absl::flat_hash_map<void*, int> buffer_index_;
+
+  // Number of TX rings. Never changes after construction.
+  const int num_tx_rings_;
+
+  mutable absl::Mutex lock_;
+
+  // Indices of the free buffers of each TX ring, used as stacks so that the
+  // most recently completed buffer, which is the most likely to be in cache,
+  // is reused first.
+  std::vector<std::vector<int>> free_buffers_by_ring_ GUARDED_BY(lock_);
+
+  // Number of free buffers over all the TX rings.
+  size_t num_free_buffers_ GUARDED_BY(lock_);
+
+  // Submission time of the packet of each in-flight buffer, by index.
+  std::vector<absl::Time> submit_times_ GUARDED_BY(lock_);
+
+  // Whether each buffer is in flight, by index.
+  std::vector<bool> in_flight_ GUARDED_BY(lock_);
+
+  // Whether Drain() was called, after which no buffer is handed out.
+  bool drained_ GUARDED_BY(lock_);
+
+  // TX ring to try first for the next packet.
+  int next_tx_ring_ GUARDED_BY(lock_);
+
+  // Counters of the transmitted packets. The number of in-flight packets and
+  // the TX rate are filled in by GetStats().
+  BfSdeInterface::PacketTxStats stats_ GUARDED_BY(lock_);
+
+  // Start of the current rate interval and the number of completed packets at
+  // that time, and the rate measured over the previous interval.
+  absl::Time rate_interval_start_ GUARDED_BY(lock_);
+  uint64 rate_interval_start_packets_ GUARDED_BY(lock_);
+  double tx_rate_pps_ GUARDED_BY(lock_);
+};
+
+}  // namespace barefoot
+}  // namespace hal
+}  // namespace stratum
+
+#endif  // STRATUM_HAL_LIB_BAREFOOT_BF_PACKET_TX_POOL_H_
@@ -0,0 +1,152 @@
+// Copyright 2020-present Open Networking Foundation
+// SPDX-License-Identifier: Apache-2.0
+
+#include "stratum/hal/lib/barefoot/bf_packet_tx_pool.h"
+
+#include <memory>
+#include <thread>  // NOLINT
+#include <vector>
+
+#include "absl/memory/memory.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "stratum/glue/status/status_test_util.h"
+#include "stratum/lib/test_utils/matchers.h"
+#include "stratum/public/lib/error.h"
+
+using ::stratum::test_utils::StatusIs;
+using ::testing::_;
+
+namespace stratum {
+namespace hal {
+namespace barefoot {
+
+class BfPacketTxPoolTest : public ::testing::Test {
+ protected:
+  // Returns the address of the i-th buffer, which stands for a bf_pkt.
+  void* Buffer(int i) { return &buffers_[i]; }
+
+  // Creates a pool with two TX rings of two buffers each.
+  std::unique_ptr<BfPacketTxPool> CreatePool() {
+    return absl::make_unique<BfPacketTxPool>(
+        std::vector<std::vector<void*>>{{Buffer(0), Buffer(1)},
+                                        {Buffer(2), Buffer(3)}});
+  }
+
+  char buffers_[4];
+};
+
+TEST_F(BfPacketTxPoolTest, AcquireSpreadsPacketsOverTxRings) {
+  auto pool = CreatePool();
+  EXPECT_EQ(2, pool->num_tx_rings());
+  std::vector<int> tx_rings;
+  std::vector<void*> buffers;
+  for (int i = 0; i < 4; ++i) {
+    void* buffer = nullptr;
+    int tx_ring = -1;
+    ASSERT_OK(pool->Acquire(&buffer, &tx_ring));
+    buffers.push_back(buffer);
+    tx_rings.push_back(tx_ring);
+  }
+  EXPECT_EQ((std::vector<int>{0, 1, 0, 1}), tx_rings);
+  EXPECT_EQ((std::vector<void*>{Buffer(0), Buffer(2), Buffer(1), Buffer(3)}),
+            buffers);
+  EXPECT_EQ(4, pool->GetStats().num_in_flight);
+}
+
+TEST_F(BfPacketTxPoolTest, AcquireFailsWhenAllBuffersAreInFlight) {
+  auto pool = CreatePool();
+  void* buffer = nullptr;
+  int tx_ring = -1;
+  for (int i = 0; i < 4; ++i) ASSERT_OK(pool->Acquire(&buffer, &tx_ring));
+  EXPECT_THAT(pool->Acquire(&buffer, &tx_ring),
+              StatusIs(StratumErrorSpace(), ERR_NO_RESOURCE, _));
+
+  // The completed buffer is reused, on its own TX ring.
+  EXPECT_EQ(BfPacketTxPool::kCompleted, pool->Complete(Buffer(2), true));
+  ASSERT_OK(pool->Acquire(&buffer, &tx_ring));
+  EXPECT_EQ(Buffer(2), buffer);
+  EXPECT_EQ(1, tx_ring);
+
+  auto stats = pool->GetStats();
+  EXPECT_EQ(5, stats.num_packets);
+  EXPECT_EQ(1, stats.num_completed);
+  EXPECT_EQ(1, stats.num_dropped_no_buffer);
+  EXPECT_EQ(4, stats.num_in_flight);
+}
+
+TEST_F(BfPacketTxPoolTest, CompleteAccountsForCompletions) {
+  auto pool = CreatePool();
+  void* buffer = nullptr;
+  int tx_ring = -1;
+  ASSERT_OK(pool->Acquire(&buffer, &tx_ring));
+  void* other_buffer = nullptr;
+  ASSERT_OK(pool->Acquire(&other_buffer, &tx_ring));
+  EXPECT_EQ(BfPacketTxPool::kCompleted, pool->Complete(buffer, true));
+  EXPECT_EQ(BfPacketTxPool::kCompleted, pool->Complete(other_buffer, false));
+  // Buffers that are not in flight, or not from the pool, are not taken.
+  EXPECT_EQ(BfPacketTxPool::kNotInFlight, pool->Complete(buffer, true));
+  char unpooled_buffer;
+  EXPECT_EQ(BfPacketTxPool::kNotPooled,
+            pool->Complete(&unpooled_buffer, true));
+
+  auto stats = pool->GetStats();
+  EXPECT_EQ(2, stats.num_packets);
+  EXPECT_EQ(2, stats.num_completed);
+  EXPECT_EQ(1, stats.num_completion_errors);
+  EXPECT_EQ(0, stats.num_in_flight);
+  EXPECT_LE(stats.max_completion_time, stats.total_completion_time);
+}
+
+TEST_F(BfPacketTxPoolTest, AbortReturnsBufferWithoutCompletion) {
+  auto pool = CreatePool();
+  void* buffer = nullptr;
+  int tx_ring = -1;
+  ASSERT_OK(pool->Acquire(&buffer, &tx_ring));
+  pool->Abort(buffer);
+  EXPECT_EQ(BfPacketTxPool::kNotInFlight, pool->Complete(buffer, true));
+
+  auto stats = pool->GetStats();
+  EXPECT_EQ(0, stats.num_packets);
+  EXPECT_EQ(0, stats.num_completed);
+  EXPECT_EQ(1, stats.num_dropped_tx_error);
+  EXPECT_EQ(0, stats.num_in_flight);
+}
+
+TEST_F(BfPacketTxPoolTest, DrainWaitsForPacketsInFlight) {
+  auto pool = CreatePool();
+  void* buffer = nullptr;
+  int tx_ring = -1;
+  ASSERT_OK(pool->Acquire(&buffer, &tx_ring));
+  std::thread completer([&pool, buffer]() {
+    absl::SleepFor(absl::Milliseconds(10));
+    pool->Complete(buffer, true);
+  });
+  EXPECT_TRUE(pool->Drain(absl::Seconds(10)));
+  completer.join();
+  EXPECT_EQ(4, pool->GetFreeBuffers().size());
+  // No buffer is handed out anymore.
+  EXPECT_THAT(pool->Acquire(&buffer, &tx_ring),
+              StatusIs(StratumErrorSpace(), ERR_CANCELLED, _));
+}
+
+TEST_F(BfPacketTxPoolTest, DrainTimesOutWithPacketsInFlight) {
+  auto pool = CreatePool();
+  void* buffer = nullptr;
+  int tx_ring = -1;
+  ASSERT_OK(pool->Acquire(&buffer, &tx_ring));
+  EXPECT_FALSE(pool->Drain(absl::Milliseconds(1)));
+  // The buffer in flight is not free, so it is not freed.
+  std::vector<void*> free_buffers = pool->GetFreeBuffers();
+  EXPECT_EQ(3, free_buffers.size());
+  EXPECT_THAT(free_buffers, ::testing::Not(::testing::Contains(buffer)));
+  // A late completion still returns it.
+  EXPECT_EQ(BfPacketTxPool::kCompleted, pool->Complete(buffer, true));
+  EXPECT_EQ(4, pool->GetFreeBuffers().size());
+}
+
+}  // namespace barefoot
+}  // namespace hal
+}  // namespace stratum
@@ -4,10 +4,13 @@
 #ifndef STRATUM_HAL_LIB_BAREFOOT_BF_SDE_INTERFACE_H_
 #define STRATUM_HAL_LIB_BAREFOOT_BF_SDE_INTERFACE_H_
 
+#include <map>
 #include <memory>
 #include <string>
 #include <vector>
 
+#include "absl/strings/string_view.h"
+#include "absl/time/time.h"
 #include "absl/types/optional.h"
 #include "stratum/glue/integral_types.h"
 #include "stratum/glue/status/status.h"
@@ -36,6 +39,44 @@ class BfSdeInterface {
     PortState state;
   };
 
+  // PacketRxStats counts the packets received on the PCIe CPU port of a
+  // device by the SDE callback, and the time spent in the callback.
+  struct PacketRxStats {
+    // Number of packets written to the registered receive writer.
+    uint64 num_packets = 0;
+    // Number of packets dropped because no writer was registered, because the
+    // buffer pool was empty, or because the writer's Channel was full.
+    uint64 num_dropped_no_writer = 0;
+    uint64 num_dropped_no_buffer = 0;
+    uint64 num_dropped_channel_full = 0;
+    // Time spent in the callback for each packet, summed over all the packets
+    // and the maximum of it.
+    absl::Duration total_callback_time = absl::ZeroDuration();
+    absl::Duration max_callback_time = absl::ZeroDuration();
+  };
+
+  // PacketTxStats counts the packets transmitted on the PCIe CPU port of a
+  // device and the time it takes the SDE to complete their transmission.
+  struct PacketTxStats {
+    // Number of packets submitted to the TX rings, and number of them whose
+    // TX completion was notified, successful or not.
+    uint64 num_packets = 0;
+    uint64 num_completed = 0;
+    uint64 num_completion_errors = 0;
+    // Number of packets not transmitted because all the TX buffers were in
+    // flight, and because they could not be submitted to the TX rings.
+    uint64 num_dropped_no_buffer = 0;
+    uint64 num_dropped_tx_error = 0;
+    // Number of packets submitted but not completed yet.
+    uint64 num_in_flight = 0;
+    // Time from the submission of a packet to its TX completion, summed over
+    // all the completed packets and the maximum of it.
+    absl::Duration total_completion_time = absl::ZeroDuration();
+    absl::Duration max_completion_time = absl::ZeroDuration();
+    // Rate of completed packets over the last second or so.
+    double tx_rate_pps = 0;
+  };
+
   // SessionInterface is a proxy class for BfRt sessions. Most API calls require
   // an active session. It also allows batching requests for performance.
   class SessionInterface {
@@ -184,6 +225,11 @@ class BfSdeInterface {
   virtual ::util::Status GetPortCounters(int device, int port,
                                          PortCounters* counters) = 0;
 
+  // Get the port counters of all the ports of a device in one read, keyed by
+  // SDK port ID.
+  virtual ::util::Status GetAllPortCounters(
+      int device, std::map<int, PortCounters>* counters) = 0;
+
   // Set the auto negotiation policy on a port.
   virtual ::util::Status SetPortAutonegPolicy(int device, int port,
                                               TriState autoneg) = 0;
@@ -214,8 +260,13 @@ class BfSdeInterface {
   // Return the chip type as a string.
   virtual std::string GetBfChipType(int device) const = 0;
 
-  // Send a packet to the PCIe CPU port.
-  virtual ::util::Status TxPacket(int device, const std::string& packet) = 0;
+  // Send a packet to the PCIe CPU port. The packet is the header followed by
+  // the payload, which are copied straight into a preallocated TX buffer. The
+  // transmission completes asynchronously, and the buffer is reused once it
+  // has. Returns ERR_NO_RESOURCE if all the TX buffers are in flight, in which
+  // case the caller may retry later.
+  virtual ::util::Status TxPacket(int device, absl::string_view header,
+                                  absl::string_view payload) = 0;
 
   // Setup PacketIO to transmit and receive packets from the CPU port.
   virtual ::util::Status StartPacketIo(int device) = 0;
@@ -228,10 +279,28 @@ class BfSdeInterface {
   virtual ::util::Status RegisterPacketReceiveWriter(
       int device, std::unique_ptr<ChannelWriter<std::string>> writer) = 0;
 
+  // Registers a pool of empty buffers for the packets received on the PCIe
+  // CPU port. Each received packet is copied into a buffer read from the pool
+  // and the buffer is written to the receive writer. The reader of the
+  // writer's Channel writes the buffers back to the pool once it is done with
+  // them, so that the buffers are reused. Packets are dropped while the pool
+  // is empty. Without a pool, a new buffer is allocated for each packet.
+  virtual ::util::Status RegisterPacketReceiveBufferPool(
+      int device, std::shared_ptr<Channel<std::string>> buffer_pool) = 0;
+
   // Unregisters the writer registered to this device by
-  // RegisterPacketReceiveWriter().
+  // RegisterPacketReceiveWriter() and the buffer pool registered by
+  // RegisterPacketReceiveBufferPool().
   virtual ::util::Status UnregisterPacketReceiveWriter(int device) = 0;
 
+  // Returns the counters of the packets received on the PCIe CPU port of this
+  // device.
+  virtual PacketRxStats GetPacketRxStats(int device) = 0;
+
+  // Returns the counters of the packets transmitted on the PCIe CPU port of
+  // this device.
+  virtual PacketTxStats GetPacketTxStats(int device) = 0;
+
   // Create a new multicast node with the given parameters. Returns the newly
   // allocated node id.
   virtual ::util::StatusOr<uint32> CreateMulticastNode(
@@ -447,6 +516,15 @@ class BfSdeInterface {
       int device, std::shared_ptr<BfSdeInterface::SessionInterface> session,
       uint32 table_id, absl::Duration timeout) = 0;
 
+  // Synchronizes the driver cached counter values with the current hardware
+  // state for all the given BfRt tables. The syncs of all tables are started
+  // before waiting for any of them to complete, so the call takes about as
+  // long as the slowest sync, rather than the sum of them. Timeout applies to
+  // the whole call.
+  virtual ::util::Status SynchronizeCountersOfTables(
+      int device, std::shared_ptr<BfSdeInterface::SessionInterface> session,
+      const std::vector<uint32>& table_ids, absl::Duration timeout) = 0;
+
   // Returns the equivalent BfRt ID for the given P4RT ID.
   virtual ::util::StatusOr<uint32> GetBfRtId(uint32 p4info_id) const = 0;
 
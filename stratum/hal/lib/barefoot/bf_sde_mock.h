@@ -70,6 +70,9 @@ class BfSdeMock : public BfSdeInterface {
   MOCK_METHOD2(GetPortState, ::util::StatusOr<PortState>(int device, int port));
   MOCK_METHOD3(GetPortCounters,
                ::util::Status(int device, int port, PortCounters* counters));
+  MOCK_METHOD2(GetAllPortCounters,
+               ::util::Status(int device,
+                              std::map<int, PortCounters>* counters));
   MOCK_METHOD1(
       RegisterPortStatusEventWriter,
       ::util::Status(std::unique_ptr<ChannelWriter<PortStatusEvent>> writer));
@@ -92,14 +95,22 @@ class BfSdeMock : public BfSdeInterface {
   MOCK_METHOD2(SetTmCpuPort, ::util::Status(int device, int port));
   MOCK_METHOD1(IsSoftwareModel, ::util::StatusOr<bool>(int device));
   MOCK_CONST_METHOD1(GetBfChipType, std::string(int device));
-  MOCK_METHOD2(TxPacket, ::util::Status(int device, const std::string& packet));
+  MOCK_METHOD3(TxPacket,
+               ::util::Status(int device, absl::string_view header,
+                              absl::string_view payload));
   MOCK_METHOD1(StartPacketIo, ::util::Status(int device));
   MOCK_METHOD1(StopPacketIo, ::util::Status(int device));
   MOCK_METHOD2(
       RegisterPacketReceiveWriter,
       ::util::Status(int device,
                      std::unique_ptr<ChannelWriter<std::string>> writer));
+  MOCK_METHOD2(
+      RegisterPacketReceiveBufferPool,
+      ::util::Status(int device,
+                     std::shared_ptr<Channel<std::string>> buffer_pool));
   MOCK_METHOD1(UnregisterPacketReceiveWriter, ::util::Status(int device));
+  MOCK_METHOD1(GetPacketRxStats, PacketRxStats(int device));
+  MOCK_METHOD1(GetPacketTxStats, PacketTxStats(int device));
   MOCK_METHOD5(CreateMulticastNode,
                ::util::StatusOr<uint32>(
                    int device,
@@ -301,6 +312,12 @@ class BfSdeMock : public BfSdeInterface {
       ::util::Status(int device,
                      std::shared_ptr<BfSdeInterface::SessionInterface> session,
                      uint32 table_id, absl::Duration timeout));
+  MOCK_METHOD4(
+      SynchronizeCountersOfTables,
+      ::util::Status(int device,
+                     std::shared_ptr<BfSdeInterface::SessionInterface> session,
+                     const std::vector<uint32>& table_ids,
+                     absl::Duration timeout));
   MOCK_CONST_METHOD1(GetBfRtId, ::util::StatusOr<uint32>(uint32 p4info_id));
   MOCK_CONST_METHOD1(GetP4InfoId, ::util::StatusOr<uint32>(uint32 bfrt_id));
   MOCK_CONST_METHOD1(GetActionSelectorBfRtId,
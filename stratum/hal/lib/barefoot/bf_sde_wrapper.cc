@@ -3,13 +3,18 @@
 
 #include "stratum/hal/lib/barefoot/bf_sde_wrapper.h"
 
+#include <string.h>
+
+#include <algorithm>
+#include <map>
 #include <memory>
 #include <set>
 #include <utility>
+#include <vector>
 
+#include "absl/memory/memory.h"
 #include "absl/strings/match.h"
 #include "absl/synchronization/mutex.h"
-#include "absl/synchronization/notification.h"
 #include "absl/time/time.h"
 #include "bf_rt/bf_rt_table_operations.hpp"
 #include "lld/lld_sku.h"
@@ -21,6 +26,7 @@
 #include "stratum/glue/status/status.h"
 #include "stratum/glue/status/statusor.h"
 #include "stratum/hal/lib/barefoot/bfrt_constants.h"
+#include "stratum/hal/lib/barefoot/bfrt_table_sync_tracker.h"
 #include "stratum/hal/lib/barefoot/macros.h"
 #include "stratum/hal/lib/barefoot/utils.h"
 #include "stratum/hal/lib/common/common.pb.h"
@@ -40,6 +46,16 @@ extern bool stat_mgr_enable_detail_trace;
 
 DEFINE_string(bfrt_sde_config_dir, "/var/run/stratum/bfrt_config",
               "The dir used by the SDE to load the device configuration.");
+DEFINE_uint32(bfrt_table_read_batch_size, 1024,
+              "Max number of table entries fetched from the SDE with one "
+              "tableEntryGetNext_n call when reading all entries of a table.");
+DEFINE_uint32(bfrt_packet_tx_buffers_per_ring, 64,
+              "Number of bf_pkt buffers preallocated for each TX ring of the "
+              "PCIe CPU port. A PacketOut fails with ERR_NO_RESOURCE while "
+              "all of them are in flight.");
+DEFINE_uint32(bfrt_table_object_pool_size, 16,
+              "Max number of BfRt table key objects, and of table data "
+              "objects, kept per table for reuse by later table writes.");
 
 namespace stratum {
 namespace hal {
@@ -285,11 +301,15 @@ template <typename T>
   return ::util::OkStatus();
 }
 
+// Reads all the entries of a table. The entries are read from the driver
+// state, or from the hardware if read_flag is GET_FROM_HW.
 ::util::Status GetAllEntries(
     std::shared_ptr<bfrt::BfRtSession> bfrt_session,
     bf_rt_target_t bf_dev_target, const bfrt::BfRtTable* table,
     std::vector<std::unique_ptr<bfrt::BfRtTableKey>>* table_keys,
-    std::vector<std::unique_ptr<bfrt::BfRtTableData>>* table_datums) {
+    std::vector<std::unique_ptr<bfrt::BfRtTableData>>* table_datums,
+    bfrt::BfRtTable::BfRtTableGetFlag read_flag =
+        bfrt::BfRtTable::BfRtTableGetFlag::GET_FROM_SW) {
   CHECK_RETURN_IF_FALSE(table_keys) << "table_keys is null";
   CHECK_RETURN_IF_FALSE(table_datums) << "table_datums is null";
 
@@ -310,8 +330,7 @@ template <typename T>
     RETURN_IF_BFRT_ERROR(table->keyAllocate(&table_key));
     RETURN_IF_BFRT_ERROR(table->dataAllocate(&table_data));
     RETURN_IF_BFRT_ERROR(table->tableEntryGetFirst(
-        *bfrt_session, bf_dev_target,
-        bfrt::BfRtTable::BfRtTableGetFlag::GET_FROM_SW, table_key.get(),
+        *bfrt_session, bf_dev_target, read_flag, table_key.get(),
         table_data.get()));
 
     table_keys->push_back(std::move(table_key));
@@ -319,30 +338,38 @@ template <typename T>
   }
   if (entries == 1) return ::util::OkStatus();
 
-  // Get all entries following the first.
-  {
-    std::vector<std::unique_ptr<bfrt::BfRtTableKey>> keys(entries - 1);
-    std::vector<std::unique_ptr<bfrt::BfRtTableData>> data(keys.size());
+  // Get all entries following the first, in batches of bounded size so that
+  // a large table does not hold the SDE for the whole read.
+  const uint32 batch_size = std::max(FLAGS_bfrt_table_read_batch_size, 1U);
+  while (table_keys->size() < entries) {
+    const uint32 n =
+        std::min(batch_size, entries - static_cast<uint32>(table_keys->size()));
+    std::vector<std::unique_ptr<bfrt::BfRtTableKey>> keys(n);
+    std::vector<std::unique_ptr<bfrt::BfRtTableData>> data(n);
     bfrt::BfRtTable::keyDataPairs pairs;
-    for (size_t i = 0; i < keys.size(); ++i) {
+    for (uint32 i = 0; i < n; ++i) {
       RETURN_IF_BFRT_ERROR(table->keyAllocate(&keys[i]));
       RETURN_IF_BFRT_ERROR(table->dataAllocate(&data[i]));
       pairs.push_back(std::make_pair(keys[i].get(), data[i].get()));
     }
     uint32 actual = 0;
     RETURN_IF_BFRT_ERROR(table->tableEntryGetNext_n(
-        *bfrt_session, bf_dev_target, *(*table_keys)[0], pairs.size(),
-        bfrt::BfRtTable::BfRtTableGetFlag::GET_FROM_SW, &pairs, &actual));
+        *bfrt_session, bf_dev_target, *table_keys->back(), n, read_flag, &pairs,
+        &actual));
+    CHECK_RETURN_IF_FALSE(actual <= n);
+    // The table shrank since its usage was read.
+    if (actual == 0) break;
 
     table_keys->insert(table_keys->end(), std::make_move_iterator(keys.begin()),
-                       std::make_move_iterator(keys.end()));
+                       std::make_move_iterator(keys.begin() + actual));
     table_datums->insert(table_datums->end(),
                          std::make_move_iterator(data.begin()),
-                         std::make_move_iterator(data.end()));
+                         std::make_move_iterator(data.begin() + actual));
+    if (actual < n) break;
   }
 
   CHECK(table_keys->size() == table_datums->size());
-  CHECK(table_keys->size() == entries);
+  CHECK(table_keys->size() <= entries);
 
   return ::util::OkStatus();
 }
@@ -395,8 +422,91 @@ template <typename T>
 
   return ::util::OkStatus();
 }
+
+// Finds the IDs of the data fields that are looked up by name among the data
+// fields of the given action, or of the table if action_id is 0. The field
+// lists are walked instead of looking up the names, which makes the SDE log
+// an error for every name that is not found.
+::util::Status FindDataFieldIds(const bfrt::BfRtTable* table,
+                                bf_rt_id_t action_id,
+                                SdeTableCache::DataFieldIds* field_ids) {
+  std::vector<bf_rt_id_t> data_field_ids;
+  if (action_id) {
+    RETURN_IF_BFRT_ERROR(table->dataFieldIdListGet(action_id, &data_field_ids));
+  } else {
+    RETURN_IF_BFRT_ERROR(table->dataFieldIdListGet(&data_field_ids));
+  }
+  for (const auto field_id : data_field_ids) {
+    std::string field_name;
+    if (action_id) {
+      RETURN_IF_BFRT_ERROR(
+          table->dataFieldNameGet(field_id, action_id, &field_name));
+    } else {
+      RETURN_IF_BFRT_ERROR(table->dataFieldNameGet(field_id, &field_name));
+    }
+    if (field_name == "$ACTION_MEMBER_ID") {
+      field_ids->action_member_id = field_id;
+    } else if (field_name == "$SELECTOR_GROUP_ID") {
+      field_ids->selector_group_id = field_id;
+    } else if (field_name == "$COUNTER_SPEC_BYTES") {
+      field_ids->counter_bytes = field_id;
+    } else if (field_name == "$COUNTER_SPEC_PKTS") {
+      field_ids->counter_packets = field_id;
+    }
+  }
+
+  return ::util::OkStatus();
+}
+
+// Builds the table cache of all the tables of a pipeline.
+::util::StatusOr<std::shared_ptr<SdeTableCache>> BuildTableCache(
+    const bfrt::BfRtInfo* bfrt_info) {
+  auto table_cache =
+      std::make_shared<SdeTableCache>(FLAGS_bfrt_table_object_pool_size);
+  std::vector<const bfrt::BfRtTable*> tables;
+  RETURN_IF_BFRT_ERROR(bfrt_info->bfrtInfoGetTables(&tables));
+  for (const auto* table : tables) {
+    SdeTableCache::TableInfo table_info;
+    bf_rt_id_t table_id;
+    RETURN_IF_BFRT_ERROR(table->tableIdGet(&table_id));
+    table_info.table_id = table_id;
+    table_info.table = table;
+    table_info.action_id_applicable = table->actionIdApplicable();
+
+    std::vector<bf_rt_id_t> key_field_ids;
+    RETURN_IF_BFRT_ERROR(table->keyFieldIdListGet(&key_field_ids));
+    for (const auto field_id : key_field_ids) {
+      std::string field_name;
+      RETURN_IF_BFRT_ERROR(table->keyFieldNameGet(field_id, &field_name));
+      if (field_name == "$MATCH_PRIORITY") {
+        table_info.match_priority_field_id = field_id;
+      }
+    }
+
+    std::vector<bf_rt_id_t> action_ids;
+    if (table_info.action_id_applicable) {
+      RETURN_IF_BFRT_ERROR(table->actionIdListGet(&action_ids));
+    } else {
+      action_ids.push_back(0);
+    }
+    for (const auto action_id : action_ids) {
+      RETURN_IF_ERROR(FindDataFieldIds(
+          table, action_id, &table_info.data_field_ids[action_id]));
+    }
+    table_cache->AddTable(std::move(table_info));
+  }
+  VLOG(1) << "Cached " << tables.size() << " BfRt tables.";
+
+  return table_cache;
+}
 }  // namespace
 
+TableKey::~TableKey() {
+  if (table_key_) {
+    table_cache_->ReturnKey(table_info_->table_id, std::move(table_key_));
+  }
+}
+
 ::util::Status TableKey::SetExact(int id, const std::string& value) {
   RETURN_IF_BFRT_ERROR(table_key_->setValue(
       id, reinterpret_cast<const uint8*>(value.data()), value.size()));
@@ -434,19 +544,16 @@ template <typename T>
 }
 
 ::util::Status TableKey::SetPriority(uint32 priority) {
-  const bfrt::BfRtTable* table;
-  RETURN_IF_BFRT_ERROR(table_key_->tableGet(&table));
-  bf_rt_id_t priority_field_id;
-  RETURN_IF_BFRT_ERROR(
-      table->keyFieldIdGet("$MATCH_PRIORITY", &priority_field_id));
+  const bf_rt_id_t priority_field_id = table_info_->match_priority_field_id;
+  CHECK_RETURN_IF_FALSE(priority_field_id)
+      << "Table " << table_info_->table_id << " has no $MATCH_PRIORITY field.";
   RETURN_IF_BFRT_ERROR(table_key_->setValue(priority_field_id, priority));
 
   return ::util::OkStatus();
 }
 
 ::util::Status TableKey::GetExact(int id, std::string* value) const {
-  const bfrt::BfRtTable* table;
-  RETURN_IF_BFRT_ERROR(table_key_->tableGet(&table));
+  const bfrt::BfRtTable* table = table_info_->table;
   size_t field_size_bits;
   RETURN_IF_BFRT_ERROR(table->keyFieldSizeGet(id, &field_size_bits));
   value->clear();
@@ -460,8 +567,7 @@ template <typename T>
 
 ::util::Status TableKey::GetTernary(int id, std::string* value,
                                     std::string* mask) const {
-  const bfrt::BfRtTable* table;
-  RETURN_IF_BFRT_ERROR(table_key_->tableGet(&table));
+  const bfrt::BfRtTable* table = table_info_->table;
   size_t field_size_bits;
   RETURN_IF_BFRT_ERROR(table->keyFieldSizeGet(id, &field_size_bits));
   value->clear();
@@ -477,8 +583,7 @@ template <typename T>
 
 ::util::Status TableKey::GetLpm(int id, std::string* prefix,
                                 uint16* prefix_length) const {
-  const bfrt::BfRtTable* table;
-  RETURN_IF_BFRT_ERROR(table_key_->tableGet(&table));
+  const bfrt::BfRtTable* table = table_info_->table;
   size_t field_size_bits;
   RETURN_IF_BFRT_ERROR(table->keyFieldSizeGet(id, &field_size_bits));
   prefix->clear();
@@ -492,8 +597,7 @@ template <typename T>
 
 ::util::Status TableKey::GetRange(int id, std::string* low,
                                   std::string* high) const {
-  const bfrt::BfRtTable* table;
-  RETURN_IF_BFRT_ERROR(table_key_->tableGet(&table));
+  const bfrt::BfRtTable* table = table_info_->table;
   size_t field_size_bits;
   RETURN_IF_BFRT_ERROR(table->keyFieldSizeGet(id, &field_size_bits));
   low->clear();
@@ -508,26 +612,49 @@ template <typename T>
 }
 
 ::util::Status TableKey::GetPriority(uint32* priority) const {
-  // const bfrt::BfRtTable* table;
-  // RETURN_IF_BFRT_ERROR(table_key_->tableGet(&table));
+  const bf_rt_id_t priority_field_id = table_info_->match_priority_field_id;
+  CHECK_RETURN_IF_FALSE(priority_field_id)
+      << "Table " << table_info_->table_id << " has no $MATCH_PRIORITY field.";
   uint64 bf_priority;
-  RETURN_IF_ERROR(GetField(*table_key_, "$MATCH_PRIORITY", &bf_priority));
+  RETURN_IF_BFRT_ERROR(table_key_->getValue(priority_field_id, &bf_priority));
   *priority = bf_priority;
 
   return ::util::OkStatus();
 }
 
 ::util::StatusOr<std::unique_ptr<BfSdeInterface::TableKeyInterface>>
-TableKey::CreateTableKey(const bfrt::BfRtInfo* bfrt_info_, int table_id) {
-  const bfrt::BfRtTable* table;
-  RETURN_IF_BFRT_ERROR(bfrt_info_->bfrtTableFromIdGet(table_id, &table));
-  std::unique_ptr<bfrt::BfRtTableKey> table_key;
-  RETURN_IF_BFRT_ERROR(table->keyAllocate(&table_key));
+TableKey::CreateTableKey(std::shared_ptr<SdeTableCache> table_cache,
+                         int table_id) {
+  const auto* table_info = table_cache->GetTable(table_id);
+  if (!table_info) {
+    return MAKE_ERROR(ERR_ENTRY_NOT_FOUND) << "Unknown table " << table_id
+                                           << ".";
+  }
+  auto table_key = table_cache->TakeKey(table_id);
+  if (table_key) {
+    RETURN_IF_BFRT_ERROR(table_info->table->keyReset(table_key.get()));
+  } else {
+    RETURN_IF_BFRT_ERROR(table_info->table->keyAllocate(&table_key));
+  }
   auto key = std::unique_ptr<BfSdeInterface::TableKeyInterface>(
-      new TableKey(std::move(table_key)));
+      new TableKey(std::move(table_key), std::move(table_cache), table_info));
   return key;
 }
 
+TableData::~TableData() {
+  if (table_data_) {
+    table_cache_->ReturnData(table_info_->table_id, std::move(table_data_));
+  }
+}
+
+::util::StatusOr<bf_rt_id_t> TableData::GetBfRtActionId() const {
+  bf_rt_id_t action_id = 0;
+  if (table_info_->action_id_applicable) {
+    RETURN_IF_BFRT_ERROR(table_data_->actionIdGet(&action_id));
+  }
+  return action_id;
+}
+
 ::util::Status TableData::SetParam(int id, const std::string& value) {
   RETURN_IF_BFRT_ERROR(table_data_->setValue(
       id, reinterpret_cast<const uint8*>(value.data()), value.size()));
@@ -536,12 +663,8 @@ TableKey::CreateTableKey(const bfrt::BfRtInfo* bfrt_info_, int table_id) {
 }
 
 ::util::Status TableData::GetParam(int id, std::string* value) const {
-  const bfrt::BfRtTable* table;
-  RETURN_IF_BFRT_ERROR(table_data_->getParent(&table));
-  bf_rt_id_t action_id = 0;
-  if (table->actionIdApplicable()) {
-    RETURN_IF_BFRT_ERROR(table_data_->actionIdGet(&action_id));
-  }
+  const bfrt::BfRtTable* table = table_info_->table;
+  ASSIGN_OR_RETURN(const bf_rt_id_t action_id, GetBfRtActionId());
   size_t field_size;
   if (action_id) {
     RETURN_IF_BFRT_ERROR(table->dataFieldSizeGet(id, action_id, &field_size));
@@ -558,96 +681,97 @@ TableKey::CreateTableKey(const bfrt::BfRtInfo* bfrt_info_, int table_id) {
 }
 
 ::util::Status TableData::SetActionMemberId(uint64 action_member_id) {
-  return SetField(table_data_.get(), "$ACTION_MEMBER_ID", action_member_id);
+  ASSIGN_OR_RETURN(const bf_rt_id_t action_id, GetBfRtActionId());
+  const bf_rt_id_t field_id =
+      table_info_->GetDataFieldIds(action_id).action_member_id;
+  CHECK_RETURN_IF_FALSE(field_id)
+      << "Table " << table_info_->table_id
+      << " has no $ACTION_MEMBER_ID field.";
+  RETURN_IF_BFRT_ERROR(table_data_->setValue(field_id, action_member_id));
+
+  return ::util::OkStatus();
 }
 
 ::util::Status TableData::GetActionMemberId(uint64* action_member_id) const {
-  return GetField(*table_data_, "$ACTION_MEMBER_ID", action_member_id);
+  ASSIGN_OR_RETURN(const bf_rt_id_t action_id, GetBfRtActionId());
+  const bf_rt_id_t field_id =
+      table_info_->GetDataFieldIds(action_id).action_member_id;
+  CHECK_RETURN_IF_FALSE(field_id)
+      << "Table " << table_info_->table_id
+      << " has no $ACTION_MEMBER_ID field.";
+  RETURN_IF_BFRT_ERROR(table_data_->getValue(field_id, action_member_id));
+
+  return ::util::OkStatus();
 }
 
 ::util::Status TableData::SetSelectorGroupId(uint64 selector_group_id) {
-  return SetField(table_data_.get(), "$SELECTOR_GROUP_ID", selector_group_id);
+  ASSIGN_OR_RETURN(const bf_rt_id_t action_id, GetBfRtActionId());
+  const bf_rt_id_t field_id =
+      table_info_->GetDataFieldIds(action_id).selector_group_id;
+  CHECK_RETURN_IF_FALSE(field_id)
+      << "Table " << table_info_->table_id
+      << " has no $SELECTOR_GROUP_ID field.";
+  RETURN_IF_BFRT_ERROR(table_data_->setValue(field_id, selector_group_id));
+
+  return ::util::OkStatus();
 }
 
 ::util::Status TableData::GetSelectorGroupId(uint64* selector_group_id) const {
-  return GetField(*table_data_, "$SELECTOR_GROUP_ID", selector_group_id);
+  ASSIGN_OR_RETURN(const bf_rt_id_t action_id, GetBfRtActionId());
+  const bf_rt_id_t field_id =
+      table_info_->GetDataFieldIds(action_id).selector_group_id;
+  CHECK_RETURN_IF_FALSE(field_id)
+      << "Table " << table_info_->table_id
+      << " has no $SELECTOR_GROUP_ID field.";
+  RETURN_IF_BFRT_ERROR(table_data_->getValue(field_id, selector_group_id));
+
+  return ::util::OkStatus();
 }
 
 ::util::Status TableData::SetOnlyCounterData(uint64 bytes, uint64 packets) {
-  const bfrt::BfRtTable* table;
-  RETURN_IF_BFRT_ERROR(table_data_->getParent(&table));
-
-  bf_rt_id_t action_id = 0;
-  if (table->actionIdApplicable()) {
-    RETURN_IF_BFRT_ERROR(table_data_->actionIdGet(&action_id));
-  }
+  const bfrt::BfRtTable* table = table_info_->table;
+  ASSIGN_OR_RETURN(const bf_rt_id_t action_id, GetBfRtActionId());
   if (!action_id) {
-    bf_rt_id_t table_id;
-    table->tableIdGet(&table_id);
-    std::string table_name;
-    table->tableNameGet(&table_name);
     LOG(WARNING) << "Trying to set counter data on a table entry without "
                  << "action ID. This might not behave as expected, please "
-                 << "report this to the Stratum authors: table_id " << table_id
-                 << " table_name " << table_name << ".";
+                 << "report this to the Stratum authors: table_id "
+                 << table_info_->table_id << ".";
   }
+  const auto& field_ids = table_info_->GetDataFieldIds(action_id);
   std::vector<bf_rt_id_t> ids;
-  bf_rt_id_t field_id_bytes;
-  bf_status_t has_bytes =
-      table->dataFieldIdGet("$COUNTER_SPEC_BYTES", action_id, &field_id_bytes);
-  if (has_bytes == BF_SUCCESS) {
-    ids.push_back(field_id_bytes);
-  }
-  bf_rt_id_t field_id_packets;
-  bf_status_t has_packets =
-      table->dataFieldIdGet("$COUNTER_SPEC_PKTS", action_id, &field_id_packets);
-  if (has_packets == BF_SUCCESS) {
-    ids.push_back(field_id_packets);
-  }
+  if (field_ids.counter_bytes) ids.push_back(field_ids.counter_bytes);
+  if (field_ids.counter_packets) ids.push_back(field_ids.counter_packets);
   if (action_id) {
     RETURN_IF_BFRT_ERROR(table->dataReset(ids, action_id, table_data_.get()));
   } else {
     RETURN_IF_BFRT_ERROR(table->dataReset(ids, table_data_.get()));
   }
-  if (has_bytes == BF_SUCCESS) {
-    RETURN_IF_BFRT_ERROR(table_data_->setValue(field_id_bytes, bytes));
+  if (field_ids.counter_bytes) {
+    RETURN_IF_BFRT_ERROR(table_data_->setValue(field_ids.counter_bytes, bytes));
   }
-  if (has_packets == BF_SUCCESS) {
-    RETURN_IF_BFRT_ERROR(table_data_->setValue(field_id_packets, packets));
+  if (field_ids.counter_packets) {
+    RETURN_IF_BFRT_ERROR(
+        table_data_->setValue(field_ids.counter_packets, packets));
   }
 
   return ::util::OkStatus();
 }
 
 ::util::Status TableData::SetCounterData(uint64 bytes, uint64 packets) {
-  const bfrt::BfRtTable* table;
-  RETURN_IF_BFRT_ERROR(table_data_->getParent(&table));
-
-  bf_rt_id_t action_id = 0;
-  if (table->actionIdApplicable()) {
-    RETURN_IF_BFRT_ERROR(table_data_->actionIdGet(&action_id));
-  }
+  ASSIGN_OR_RETURN(const bf_rt_id_t action_id, GetBfRtActionId());
   if (!action_id) {
-    bf_rt_id_t table_id;
-    table->tableIdGet(&table_id);
-    std::string table_name;
-    table->tableNameGet(&table_name);
     LOG(WARNING) << "Trying to set counter data on a table entry without "
                  << "action ID. This might not behave as expected, please "
-                 << "report this to the Stratum authors: table_id " << table_id
-                 << " table_name " << table_name << ".";
+                 << "report this to the Stratum authors: table_id "
+                 << table_info_->table_id << ".";
   }
-  bf_rt_id_t field_id_bytes;
-  bf_status_t has_bytes =
-      table->dataFieldIdGet("$COUNTER_SPEC_BYTES", action_id, &field_id_bytes);
-  bf_rt_id_t field_id_packets;
-  bf_status_t has_packets =
-      table->dataFieldIdGet("$COUNTER_SPEC_PKTS", action_id, &field_id_packets);
-  if (has_bytes == BF_SUCCESS) {
-    RETURN_IF_BFRT_ERROR(table_data_->setValue(field_id_bytes, bytes));
+  const auto& field_ids = table_info_->GetDataFieldIds(action_id);
+  if (field_ids.counter_bytes) {
+    RETURN_IF_BFRT_ERROR(table_data_->setValue(field_ids.counter_bytes, bytes));
   }
-  if (has_packets == BF_SUCCESS) {
-    RETURN_IF_BFRT_ERROR(table_data_->setValue(field_id_packets, packets));
+  if (field_ids.counter_packets) {
+    RETURN_IF_BFRT_ERROR(
+        table_data_->setValue(field_ids.counter_packets, packets));
   }
 
   return ::util::OkStatus();
@@ -656,39 +780,20 @@ TableKey::CreateTableKey(const bfrt::BfRtInfo* bfrt_info_, int table_id) {
 ::util::Status TableData::GetCounterData(uint64* bytes, uint64* packets) const {
   CHECK_RETURN_IF_FALSE(bytes);
   CHECK_RETURN_IF_FALSE(packets);
-  const bfrt::BfRtTable* table;
-  RETURN_IF_BFRT_ERROR(table_data_->getParent(&table));
-
-  bf_rt_id_t action_id = 0;
-  if (table->actionIdApplicable()) {
-    RETURN_IF_BFRT_ERROR(table_data_->actionIdGet(&action_id));
-  }
+  ASSIGN_OR_RETURN(const bf_rt_id_t action_id, GetBfRtActionId());
+  const auto& field_ids = table_info_->GetDataFieldIds(action_id);
 
-  bf_rt_id_t field_id;
-  // Try to read byte counter.
-  bf_status_t bf_status;
-  if (action_id) {
-    bf_status =
-        table->dataFieldIdGet("$COUNTER_SPEC_BYTES", action_id, &field_id);
-  } else {
-    bf_status = table->dataFieldIdGet("$COUNTER_SPEC_BYTES", &field_id);
-  }
-  if (bf_status == BF_SUCCESS) {
+  // Read the byte and packet counters the table has.
+  if (field_ids.counter_bytes) {
     uint64 counter_val;
-    RETURN_IF_BFRT_ERROR(table_data_->getValue(field_id, &counter_val));
+    RETURN_IF_BFRT_ERROR(
+        table_data_->getValue(field_ids.counter_bytes, &counter_val));
     *bytes = counter_val;
   }
-
-  // Try to read packet counter.
-  if (action_id) {
-    bf_status =
-        table->dataFieldIdGet("$COUNTER_SPEC_PKTS", action_id, &field_id);
-  } else {
-    bf_status = table->dataFieldIdGet("$COUNTER_SPEC_PKTS", &field_id);
-  }
-  if (bf_status == BF_SUCCESS) {
+  if (field_ids.counter_packets) {
     uint64 counter_val;
-    RETURN_IF_BFRT_ERROR(table_data_->getValue(field_id, &counter_val));
+    RETURN_IF_BFRT_ERROR(
+        table_data_->getValue(field_ids.counter_packets, &counter_val));
     *packets = counter_val;
   }
 
@@ -697,20 +802,14 @@ TableKey::CreateTableKey(const bfrt::BfRtInfo* bfrt_info_, int table_id) {
 
 ::util::Status TableData::GetActionId(int* action_id) const {
   CHECK_RETURN_IF_FALSE(action_id);
-  const bfrt::BfRtTable* table;
-  RETURN_IF_BFRT_ERROR(table_data_->getParent(&table));
-  bf_rt_id_t bf_action_id = 0;
-  if (table->actionIdApplicable()) {
-    RETURN_IF_BFRT_ERROR(table_data_->actionIdGet(&bf_action_id));
-  }
+  ASSIGN_OR_RETURN(const bf_rt_id_t bf_action_id, GetBfRtActionId());
   *action_id = bf_action_id;
 
   return ::util::OkStatus();
 }
 
 ::util::Status TableData::Reset(int action_id) {
-  const bfrt::BfRtTable* table;
-  RETURN_IF_BFRT_ERROR(table_data_->getParent(&table));
+  const bfrt::BfRtTable* table = table_info_->table;
   if (action_id) {
     RETURN_IF_BFRT_ERROR(table->dataReset(action_id, table_data_.get()));
   } else {
@@ -721,18 +820,29 @@ TableKey::CreateTableKey(const bfrt::BfRtInfo* bfrt_info_, int table_id) {
 }
 
 ::util::StatusOr<std::unique_ptr<BfSdeInterface::TableDataInterface>>
-TableData::CreateTableData(const bfrt::BfRtInfo* bfrt_info_, int table_id,
-                           int action_id) {
-  const bfrt::BfRtTable* table;
-  RETURN_IF_BFRT_ERROR(bfrt_info_->bfrtTableFromIdGet(table_id, &table));
-  std::unique_ptr<bfrt::BfRtTableData> table_data;
-  if (action_id) {
+TableData::CreateTableData(std::shared_ptr<SdeTableCache> table_cache,
+                           int table_id, int action_id) {
+  const auto* table_info = table_cache->GetTable(table_id);
+  if (!table_info) {
+    return MAKE_ERROR(ERR_ENTRY_NOT_FOUND) << "Unknown table " << table_id
+                                           << ".";
+  }
+  const bfrt::BfRtTable* table = table_info->table;
+  auto table_data = table_cache->TakeData(table_id);
+  if (table_data) {
+    // A pooled object may be of another action, which the reset replaces.
+    if (action_id) {
+      RETURN_IF_BFRT_ERROR(table->dataReset(action_id, table_data.get()));
+    } else {
+      RETURN_IF_BFRT_ERROR(table->dataReset(table_data.get()));
+    }
+  } else if (action_id) {
     RETURN_IF_BFRT_ERROR(table->dataAllocate(action_id, &table_data));
   } else {
     RETURN_IF_BFRT_ERROR(table->dataAllocate(&table_data));
   }
   auto data = std::unique_ptr<BfSdeInterface::TableDataInterface>(
-      new TableData(std::move(table_data)));
+      new TableData(std::move(table_data), std::move(table_cache), table_info));
   return data;
 }
 
@@ -867,6 +977,69 @@ BfSdeWrapper::BfSdeWrapper() : port_status_event_writer_(nullptr) {}
   return ::util::OkStatus();
 }
 
+::util::Status BfSdeWrapper::GetAllPortCounters(
+    int device, std::map<int, PortCounters>* counters) {
+  CHECK_RETURN_IF_FALSE(counters) << "counters is null";
+  ::absl::ReaderMutexLock l(&data_lock_);
+  CHECK_RETURN_IF_FALSE(bfrt_info_)
+      << "No pipeline has been pushed to device " << device << ".";
+  const bfrt::BfRtTable* table;
+  RETURN_IF_BFRT_ERROR(
+      bfrt_info_->bfrtTableFromNameGet(kPortStatTable, &table));
+  auto bfrt_session = bfrt::BfRtSession::sessionCreate();
+  CHECK_RETURN_IF_FALSE(bfrt_session) << "Failed to create new session.";
+  auto session_cleanup =
+      gtl::MakeCleanup([bfrt_session]() { bfrt_session->sessionDestroy(); });
+
+  // One read of the whole table instead of one SDE call per port. The
+  // counters are read from the MACs, as the copy of the driver is only
+  // refreshed periodically.
+  std::vector<std::unique_ptr<bfrt::BfRtTableKey>> keys;
+  std::vector<std::unique_ptr<bfrt::BfRtTableData>> datums;
+  RETURN_IF_ERROR(
+      GetAllEntries(bfrt_session, GetDeviceTarget(device), table, &keys,
+                    &datums, bfrt::BfRtTable::BfRtTableGetFlag::GET_FROM_HW));
+  counters->clear();
+  for (size_t i = 0; i < keys.size(); ++i) {
+    uint64 port;
+    RETURN_IF_ERROR(GetField(*keys[i], kPortStatDevPort, &port));
+    const bfrt::BfRtTableData& data = *datums[i];
+    PortCounters& port_counters = (*counters)[static_cast<int>(port)];
+    uint64 value;
+    RETURN_IF_ERROR(GetField(data, "$OctetsReceived", &value));
+    port_counters.set_in_octets(value);
+    RETURN_IF_ERROR(GetField(data, "$OctetsTransmittedTotal", &value));
+    port_counters.set_out_octets(value);
+    RETURN_IF_ERROR(
+        GetField(data, "$FramesReceivedwithUnicastAddresses", &value));
+    port_counters.set_in_unicast_pkts(value);
+    RETURN_IF_ERROR(GetField(data, "$FramesTransmittedUnicast", &value));
+    port_counters.set_out_unicast_pkts(value);
+    RETURN_IF_ERROR(
+        GetField(data, "$FramesReceivedwithBroadcastAddresses", &value));
+    port_counters.set_in_broadcast_pkts(value);
+    RETURN_IF_ERROR(GetField(data, "$FramesTransmittedBroadcast", &value));
+    port_counters.set_out_broadcast_pkts(value);
+    RETURN_IF_ERROR(
+        GetField(data, "$FramesReceivedwithMulticastAddresses", &value));
+    port_counters.set_in_multicast_pkts(value);
+    RETURN_IF_ERROR(GetField(data, "$FramesTransmittedMulticast", &value));
+    port_counters.set_out_multicast_pkts(value);
+    RETURN_IF_ERROR(GetField(data, "$FramesDroppedBufferFull", &value));
+    port_counters.set_in_discards(value);
+    port_counters.set_out_discards(0);       // stat not available
+    port_counters.set_in_unknown_protos(0);  // stat not meaningful
+    RETURN_IF_ERROR(GetField(data, "$FrameswithanyError", &value));
+    port_counters.set_in_errors(value);
+    RETURN_IF_ERROR(GetField(data, "$FramesTransmittedwithError", &value));
+    port_counters.set_out_errors(value);
+    RETURN_IF_ERROR(GetField(data, "$FramesReceivedwithFCSError", &value));
+    port_counters.set_in_fcs_errors(value);
+  }
+
+  return ::util::OkStatus();
+}
+
 ::util::Status BfSdeWrapper::OnPortStatusEvent(int device, int port, bool up) {
   // Create PortStatusEvent message.
   PortState state = up ? PORT_STATE_UP : PORT_STATE_DOWN;
@@ -1095,6 +1268,7 @@ std::string BfSdeWrapper::GetBfChipType(int device) const {
 
   bfrt_device_manager_ = &bfrt::BfRtDevMgr::getInstance();
   bfrt_id_mapper_.reset();
+  table_cache_.reset();
 
   RETURN_IF_BFRT_ERROR(bf_pal_device_warm_init_begin(
       device, BF_DEV_WARM_INIT_FAST_RECFG, BF_DEV_SERDES_UPD_NONE,
@@ -1174,6 +1348,7 @@ std::string BfSdeWrapper::GetBfChipType(int device) const {
 
   RETURN_IF_BFRT_ERROR(bfrt_device_manager_->bfRtInfoGet(
       device, device_config.programs(0).name(), &bfrt_info_));
+  ASSIGN_OR_RETURN(table_cache_, BuildTableCache(bfrt_info_));
 
   // FIXME: if all we ever do is create and push, this could be one call.
   bfrt_id_mapper_ = BfrtIdMapper::CreateInstance();
@@ -1192,18 +1367,78 @@ BfSdeWrapper::CreateSession() {
 ::util::StatusOr<std::unique_ptr<BfSdeInterface::TableKeyInterface>>
 BfSdeWrapper::CreateTableKey(int table_id) {
   ::absl::ReaderMutexLock l(&data_lock_);
-  return TableKey::CreateTableKey(bfrt_info_, table_id);
+  CHECK_RETURN_IF_FALSE(table_cache_) << "No pipeline has been pushed.";
+  return TableKey::CreateTableKey(table_cache_, table_id);
 }
 
 ::util::StatusOr<std::unique_ptr<BfSdeInterface::TableDataInterface>>
 BfSdeWrapper::CreateTableData(int table_id, int action_id) {
   ::absl::ReaderMutexLock l(&data_lock_);
-  return TableData::CreateTableData(bfrt_info_, table_id, action_id);
+  CHECK_RETURN_IF_FALSE(table_cache_) << "No pipeline has been pushed.";
+  return TableData::CreateTableData(table_cache_, table_id, action_id);
 }
 
 //  Packetio
 
-::util::Status BfSdeWrapper::TxPacket(int device, const std::string& buffer) {
+namespace {
+
+// Size of the preallocated TX buffers, which hold a full size Ethernet frame
+// and the CPU header. Larger packets are sent in buffers allocated for them.
+constexpr size_t kPacketTxBufferSize = 2048;
+
+// How long StopPacketIo() waits for the packets in flight to complete.
+constexpr absl::Duration kPacketTxDrainTimeout = absl::Seconds(1);
+
+// The DMA pools of the TX rings, by ring.
+constexpr bf_dma_type_e kPacketTxDmaTypes[] = {
+    BF_DMA_CPU_PKT_TRANSMIT_0,
+    BF_DMA_CPU_PKT_TRANSMIT_1,
+    BF_DMA_CPU_PKT_TRANSMIT_2,
+    BF_DMA_CPU_PKT_TRANSMIT_3,
+};
+constexpr int kNumPacketTxRings =
+    std::min<int>(BF_PKT_TX_RING_MAX,
+                  sizeof(kPacketTxDmaTypes) / sizeof(kPacketTxDmaTypes[0]));
+
+}  // namespace
+
+::util::Status BfSdeWrapper::TxPacket(int device, absl::string_view header,
+                                      absl::string_view payload) {
+  const size_t size = header.size() + payload.size();
+  if (size > kPacketTxBufferSize) {
+    return TxUnpooledPacket(device, header, payload);
+  }
+
+  absl::ReaderMutexLock l(&packet_tx_lock_);
+  auto tx_pool = gtl::FindOrNull(device_to_packet_tx_pool_, device);
+  CHECK_RETURN_IF_FALSE(tx_pool)
+      << "Packet IO is not started on device " << device << ".";
+  void* buffer = nullptr;
+  int tx_ring = 0;
+  RETURN_IF_ERROR((*tx_pool)->Acquire(&buffer, &tx_ring));
+  bf_pkt* pkt = static_cast<bf_pkt*>(buffer);
+  auto pkt_aborter =
+      gtl::MakeCleanup([tx_pool, pkt]() { (*tx_pool)->Abort(pkt); });
+
+  // Copy the header and the payload straight into the DMA buffer.
+  uint8* data = bf_pkt_get_pkt_data(pkt);
+  memcpy(data, header.data(), header.size());
+  memcpy(data + header.size(), payload.data(), payload.size());
+  RETURN_IF_BFRT_ERROR(bf_pkt_set_pkt_size(pkt, size));
+  RETURN_IF_BFRT_ERROR(
+      bf_pkt_tx(device, pkt, static_cast<bf_pkt_tx_ring_t>(tx_ring), pkt));
+  pkt_aborter.release();
+
+  return ::util::OkStatus();
+}
+
+::util::Status BfSdeWrapper::TxUnpooledPacket(int device,
+                                              absl::string_view header,
+                                              absl::string_view payload) {
+  std::string buffer;
+  buffer.reserve(header.size() + payload.size());
+  buffer.append(header.data(), header.size());
+  buffer.append(payload.data(), payload.size());
   bf_pkt* pkt = nullptr;
   RETURN_IF_BFRT_ERROR(
       bf_pkt_alloc(device, &pkt, buffer.size(), BF_DMA_CPU_PKT_TRANSMIT_0));
@@ -1217,11 +1452,114 @@ BfSdeWrapper::CreateTableData(int table_id, int action_id) {
   return ::util::OkStatus();
 }
 
+::util::Status BfSdeWrapper::AllocatePacketTxPool(int device,
+                                                  bool driver_initialized) {
+  absl::WriterMutexLock l(&packet_tx_lock_);
+  auto& tx_pool = device_to_packet_tx_pool_[device];
+  if (tx_pool != nullptr) {
+    if (driver_initialized) return ::util::OkStatus();
+    // The buffers went away with the previous bf_pkt driver instance, and no
+    // completion is coming for the packets in flight.
+    LOG(WARNING) << "Dropping the TX buffers of device " << device
+                 << ", the bf_pkt driver was re-initialized.";
+    tx_pool.reset();
+  }
+
+  std::vector<std::vector<void*>> buffers_by_ring(kNumPacketTxRings);
+  size_t num_buffers = 0;
+  for (int tx_ring = 0; tx_ring < kNumPacketTxRings; ++tx_ring) {
+    for (uint32 i = 0; i < FLAGS_bfrt_packet_tx_buffers_per_ring; ++i) {
+      bf_pkt* pkt = nullptr;
+      bf_status_t status = bf_pkt_alloc(device, &pkt, kPacketTxBufferSize,
+                                        kPacketTxDmaTypes[tx_ring]);
+      if (status != BF_SUCCESS) {
+        LOG(WARNING) << "Allocated only " << i << " TX buffers for TX ring "
+                     << tx_ring << " of device " << device << ": "
+                     << bf_err_str(status) << ".";
+        break;
+      }
+      buffers_by_ring[tx_ring].push_back(pkt);
+      ++num_buffers;
+    }
+  }
+  CHECK_RETURN_IF_FALSE(num_buffers > 0)
+      << "Failed to allocate TX buffers for device " << device << ".";
+  tx_pool = absl::make_unique<BfPacketTxPool>(buffers_by_ring);
+  VLOG(1) << "Allocated " << num_buffers << " TX buffers for device " << device
+          << ".";
+
+  return ::util::OkStatus();
+}
+
+void BfSdeWrapper::DrainPacketTxPool(int device) {
+  // Reader lock only, the TX completions need it to return the buffers.
+  absl::ReaderMutexLock l(&packet_tx_lock_);
+  auto tx_pool = gtl::FindOrNull(device_to_packet_tx_pool_, device);
+  if (tx_pool == nullptr) return;
+  if (!(*tx_pool)->Drain(kPacketTxDrainTimeout)) {
+    LOG(WARNING) << "Timed out waiting for the TX completions of "
+                 << (*tx_pool)->GetStats().num_in_flight << " packets on "
+                 << "device " << device << ".";
+  }
+}
+
+void BfSdeWrapper::FreePacketTxPool(int device) {
+  absl::WriterMutexLock l(&packet_tx_lock_);
+  auto tx_pool = gtl::FindOrNull(device_to_packet_tx_pool_, device);
+  if (tx_pool == nullptr) return;
+  // The buffers still in flight may yet be read by the DMA engine, so they
+  // are leaked rather than freed.
+  const std::vector<void*> free_buffers = (*tx_pool)->GetFreeBuffers();
+  const size_t num_in_flight =
+      (*tx_pool)->buffers().size() - free_buffers.size();
+  if (num_in_flight > 0) {
+    LOG(WARNING) << "Leaking " << num_in_flight << " TX buffers in flight on "
+                 << "device " << device << ".";
+  }
+  for (void* buffer : free_buffers) {
+    bf_pkt_free(device, static_cast<bf_pkt*>(buffer));
+  }
+  device_to_packet_tx_pool_.erase(device);
+}
+
+BfSdeInterface::PacketTxStats BfSdeWrapper::GetPacketTxStats(int device) {
+  absl::ReaderMutexLock l(&packet_tx_lock_);
+  auto tx_pool = gtl::FindOrNull(device_to_packet_tx_pool_, device);
+  if (tx_pool == nullptr) return PacketTxStats();
+  return (*tx_pool)->GetStats();
+}
+
+::util::Status BfSdeWrapper::HandlePacketTxDone(bf_dev_id_t device,
+                                                bf_pkt* pkt, uint32 status) {
+  {
+    absl::ReaderMutexLock l(&packet_tx_lock_);
+    auto tx_pool = gtl::FindOrNull(device_to_packet_tx_pool_, device);
+    if (tx_pool) {
+      switch ((*tx_pool)->Complete(pkt, status == BF_SUCCESS)) {
+        case BfPacketTxPool::kCompleted:
+          return ::util::OkStatus();
+        case BfPacketTxPool::kNotInFlight:
+          // The pool still owns the buffer, it must not be freed.
+          return MAKE_ERROR(ERR_INTERNAL).without_logging()
+                 << "TX buffer " << pkt << " completed while not in flight.";
+        case BfPacketTxPool::kNotPooled:
+          break;
+      }
+    }
+  }
+  // Not a pooled buffer, it was allocated for this packet.
+  RETURN_IF_BFRT_ERROR(bf_pkt_free(device, pkt));
+
+  return ::util::OkStatus();
+}
+
 ::util::Status BfSdeWrapper::StartPacketIo(int device) {
   // Maybe move to InitSde function?
-  if (!bf_pkt_is_inited(device)) {
+  const bool driver_initialized = bf_pkt_is_inited(device);
+  if (!driver_initialized) {
     RETURN_IF_BFRT_ERROR(bf_pkt_init());
   }
+  RETURN_IF_ERROR(AllocatePacketTxPool(device, driver_initialized));
 
   // type of i should be bf_pkt_tx_ring_t?
   for (int tx_ring = BF_PKT_TX_RING_0; tx_ring < BF_PKT_TX_RING_MAX;
@@ -1243,6 +1581,9 @@ BfSdeWrapper::CreateTableData(int table_id, int action_id) {
 }
 
 ::util::Status BfSdeWrapper::StopPacketIo(int device) {
+  // The TX buffers can only be freed once their packets are out, which is
+  // signaled by the TX completion notifications.
+  DrainPacketTxPool(device);
   for (int tx_ring = BF_PKT_TX_RING_0; tx_ring < BF_PKT_TX_RING_MAX;
        ++tx_ring) {
     RETURN_IF_BFRT_ERROR(bf_pkt_tx_done_notif_deregister(
@@ -1255,6 +1596,7 @@ BfSdeWrapper::CreateTableData(int table_id, int action_id) {
         bf_pkt_rx_deregister(device, static_cast<bf_pkt_rx_ring_t>(rx_ring)));
   }
   VLOG(1) << "Unregistered packetio callbacks on device " << device << ".";
+  FreePacketTxPool(device);
 
   return ::util::OkStatus();
 }
@@ -1263,31 +1605,91 @@ BfSdeWrapper::CreateTableData(int table_id, int action_id) {
     int device, std::unique_ptr<ChannelWriter<std::string>> writer) {
   absl::WriterMutexLock l(&packet_rx_callback_lock_);
   device_to_packet_rx_writer_[device] = std::move(writer);
+  auto& counters = device_to_packet_rx_counters_[device];
+  if (counters == nullptr) counters = absl::make_unique<PacketRxCounters>();
+  return ::util::OkStatus();
+}
+
+::util::Status BfSdeWrapper::RegisterPacketReceiveBufferPool(
+    int device, std::shared_ptr<Channel<std::string>> buffer_pool) {
+  absl::WriterMutexLock l(&packet_rx_callback_lock_);
+  device_to_packet_rx_buffer_pool_[device] = std::move(buffer_pool);
   return ::util::OkStatus();
 }
 
 ::util::Status BfSdeWrapper::UnregisterPacketReceiveWriter(int device) {
   absl::WriterMutexLock l(&packet_rx_callback_lock_);
   device_to_packet_rx_writer_.erase(device);
+  device_to_packet_rx_buffer_pool_.erase(device);
   return ::util::OkStatus();
 }
 
+BfSdeInterface::PacketRxStats BfSdeWrapper::GetPacketRxStats(int device) {
+  absl::ReaderMutexLock l(&packet_rx_callback_lock_);
+  PacketRxStats stats;
+  auto counters = gtl::FindOrNull(device_to_packet_rx_counters_, device);
+  if (counters == nullptr) return stats;
+  stats.num_packets = (*counters)->num_packets.load();
+  stats.num_dropped_no_writer = (*counters)->num_dropped_no_writer.load();
+  stats.num_dropped_no_buffer = (*counters)->num_dropped_no_buffer.load();
+  stats.num_dropped_channel_full = (*counters)->num_dropped_channel_full.load();
+  stats.total_callback_time =
+      absl::Nanoseconds((*counters)->total_callback_ns.load());
+  stats.max_callback_time =
+      absl::Nanoseconds((*counters)->max_callback_ns.load());
+  return stats;
+}
+
 ::util::Status BfSdeWrapper::HandlePacketRx(bf_dev_id_t device, bf_pkt* pkt,
                                             bf_pkt_rx_ring_t rx_ring) {
+  const absl::Time start_time = absl::Now();
   absl::ReaderMutexLock l(&packet_rx_callback_lock_);
   auto rx_writer = gtl::FindOrNull(device_to_packet_rx_writer_, device);
+  if (!rx_writer) {
+    auto counters = gtl::FindOrNull(device_to_packet_rx_counters_, device);
+    if (counters) (*counters)->num_dropped_no_writer++;
+  }
   CHECK_RETURN_IF_FALSE(rx_writer)
       << "No Rx callback registered for device id " << device << ".";
-
-  std::string buffer(reinterpret_cast<const char*>(bf_pkt_get_pkt_data(pkt)),
-                     bf_pkt_get_pkt_size(pkt));
-  if (!(*rx_writer)->TryWrite(buffer).ok()) {
-    LOG_EVERY_N(INFO, 500) << "Dropped packet received from CPU.";
+  // The counters are added along with the writer.
+  PacketRxCounters* counters =
+      gtl::FindOrDie(device_to_packet_rx_counters_, device).get();
+
+  // Copy the packet into a buffer of the pool if there is one. The buffers
+  // keep their capacity, so the copy does not allocate once they have grown
+  // to the size of the received packets.
+  std::string buffer;
+  auto buffer_pool = gtl::FindOrNull(device_to_packet_rx_buffer_pool_, device);
+  if (buffer_pool && !(*buffer_pool)->TryRead(&buffer).ok()) {
+    counters->num_dropped_no_buffer++;
+    LOG_EVERY_N(INFO, 500) << "Dropped packet received from CPU, "
+                           << "no free buffer.";
+    return ::util::OkStatus();
   }
+  buffer.assign(reinterpret_cast<const char*>(bf_pkt_get_pkt_data(pkt)),
+                bf_pkt_get_pkt_size(pkt));
 
   VLOG(1) << "Received packet from CPU " << buffer.size() << " bytes "
           << StringToHex(buffer);
 
+  // A failed TryWrite() leaves the buffer untouched, so it goes back to the
+  // pool.
+  if ((*rx_writer)->TryWrite(std::move(buffer)).ok()) {
+    counters->num_packets++;
+  } else {
+    counters->num_dropped_channel_full++;
+    if (buffer_pool) (*buffer_pool)->TryWrite(std::move(buffer)).IgnoreError();
+    LOG_EVERY_N(INFO, 500) << "Dropped packet received from CPU.";
+  }
+
+  const int64 callback_ns = absl::ToInt64Nanoseconds(absl::Now() - start_time);
+  counters->total_callback_ns += callback_ns;
+  int64 max_ns = counters->max_callback_ns.load(std::memory_order_relaxed);
+  while (callback_ns > max_ns &&
+         !counters->max_callback_ns.compare_exchange_weak(max_ns,
+                                                          callback_ns)) {
+  }
+
   return ::util::OkStatus();
 }
 
@@ -1299,8 +1701,16 @@ bf_status_t BfSdeWrapper::BfPktTxNotifyCallback(bf_dev_id_t device,
           << " tx ring: " << tx_ring << " tx cookie: " << tx_cookie
           << " status: " << status;
 
+  BfSdeWrapper* bf_sde_wrapper = BfSdeWrapper::GetSingleton();
   bf_pkt* pkt = reinterpret_cast<bf_pkt*>(tx_cookie);
-  return bf_pkt_free(device, pkt);
+  ::util::Status result =
+      bf_sde_wrapper->HandlePacketTxDone(device, pkt, status);
+  if (!result.ok()) {
+    LOG_EVERY_N(ERROR, 500) << "Failed to complete TX of packet on device "
+                            << device << ": " << result.error_message();
+    return BF_UNEXPECTED;
+  }
+  return BF_SUCCESS;
 }
 
 bf_status_t BfSdeWrapper::BfPktRxNotifyCallback(bf_dev_id_t device, bf_pkt* pkt,
@@ -1891,8 +2301,7 @@ namespace {
   auto real_session = std::dynamic_pointer_cast<Session>(session);
   CHECK_RETURN_IF_FALSE(real_session);
 
-  const bfrt::BfRtTable* table;
-  RETURN_IF_BFRT_ERROR(bfrt_info_->bfrtTableFromIdGet(counter_id, &table));
+  ASSIGN_OR_RETURN(const bfrt::BfRtTable* table, GetTable(counter_id));
 
   std::unique_ptr<bfrt::BfRtTableKey> table_key;
   std::unique_ptr<bfrt::BfRtTableData> table_data;
@@ -1936,8 +2345,7 @@ namespace {
   auto real_session = std::dynamic_pointer_cast<Session>(session);
   CHECK_RETURN_IF_FALSE(real_session);
 
-  const bfrt::BfRtTable* table;
-  RETURN_IF_BFRT_ERROR(bfrt_info_->bfrtTableFromIdGet(counter_id, &table));
+  ASSIGN_OR_RETURN(const bfrt::BfRtTable* table, GetTable(counter_id));
 
   RETURN_IF_ERROR(DoSynchronizeCounters(device, session, counter_id, timeout));
 
@@ -2010,8 +2418,7 @@ namespace {
   auto real_session = std::dynamic_pointer_cast<Session>(session);
   CHECK_RETURN_IF_FALSE(real_session);
 
-  const bfrt::BfRtTable* table;
-  RETURN_IF_BFRT_ERROR(bfrt_info_->bfrtTableFromIdGet(table_id, &table));
+  ASSIGN_OR_RETURN(const bfrt::BfRtTable* table, GetTable(table_id));
 
   std::unique_ptr<bfrt::BfRtTableKey> table_key;
   std::unique_ptr<bfrt::BfRtTableData> table_data;
@@ -2069,8 +2476,7 @@ namespace {
   RETURN_IF_ERROR(SynchronizeRegisters(device, session, table_id, timeout));
 
   auto bf_dev_tgt = GetDeviceTarget(device);
-  const bfrt::BfRtTable* table;
-  RETURN_IF_BFRT_ERROR(bfrt_info_->bfrtTableFromIdGet(table_id, &table));
+  ASSIGN_OR_RETURN(const bfrt::BfRtTable* table, GetTable(table_id));
   std::vector<std::unique_ptr<bfrt::BfRtTableKey>> keys;
   std::vector<std::unique_ptr<bfrt::BfRtTableData>> datums;
 
@@ -2139,8 +2545,7 @@ namespace {
   auto real_table_data = dynamic_cast<const TableData*>(table_data);
   CHECK_RETURN_IF_FALSE(real_table_data);
 
-  const bfrt::BfRtTable* table;
-  RETURN_IF_BFRT_ERROR(bfrt_info_->bfrtTableFromIdGet(table_id, &table));
+  ASSIGN_OR_RETURN(const bfrt::BfRtTable* table, GetTable(table_id));
 
   std::unique_ptr<bfrt::BfRtTableKey> table_key;
   RETURN_IF_BFRT_ERROR(table->keyAllocate(&table_key));
@@ -2185,8 +2590,7 @@ namespace {
   auto real_session = std::dynamic_pointer_cast<Session>(session);
   CHECK_RETURN_IF_FALSE(real_session);
 
-  const bfrt::BfRtTable* table;
-  RETURN_IF_BFRT_ERROR(bfrt_info_->bfrtTableFromIdGet(table_id, &table));
+  ASSIGN_OR_RETURN(const bfrt::BfRtTable* table, GetTable(table_id));
 
   std::unique_ptr<bfrt::BfRtTableKey> table_key;
   RETURN_IF_BFRT_ERROR(table->keyAllocate(&table_key));
@@ -2212,8 +2616,7 @@ namespace {
   CHECK_RETURN_IF_FALSE(real_session);
 
   auto bf_dev_tgt = GetDeviceTarget(device);
-  const bfrt::BfRtTable* table;
-  RETURN_IF_BFRT_ERROR(bfrt_info_->bfrtTableFromIdGet(table_id, &table));
+  ASSIGN_OR_RETURN(const bfrt::BfRtTable* table, GetTable(table_id));
   std::vector<std::unique_ptr<bfrt::BfRtTableKey>> keys;
   std::vector<std::unique_ptr<bfrt::BfRtTableData>> datums;
   // Is this a wildcard read?
@@ -2234,6 +2637,7 @@ namespace {
 
   member_ids->resize(0);
   table_datas->resize(0);
+  const auto* table_info = table_cache_->GetTable(table_id);
   for (size_t i = 0; i < keys.size(); ++i) {
     // Key: $sid
     uint64 member_id;
@@ -2241,7 +2645,8 @@ namespace {
     member_ids->push_back(member_id);
 
     // Data: action params
-    auto td = absl::make_unique<TableData>(std::move(datums[i]));
+    auto td = absl::make_unique<TableData>(std::move(datums[i]), table_cache_,
+                                           table_info);
     table_datas->push_back(std::move(td));
   }
 
@@ -2259,8 +2664,7 @@ namespace {
   auto real_session = std::dynamic_pointer_cast<Session>(session);
   CHECK_RETURN_IF_FALSE(real_session);
 
-  const bfrt::BfRtTable* table;
-  RETURN_IF_BFRT_ERROR(bfrt_info_->bfrtTableFromIdGet(table_id, &table));
+  ASSIGN_OR_RETURN(const bfrt::BfRtTable* table, GetTable(table_id));
 
   std::unique_ptr<bfrt::BfRtTableKey> table_key;
   std::unique_ptr<bfrt::BfRtTableData> table_data;
@@ -2319,8 +2723,7 @@ namespace {
   auto real_session = std::dynamic_pointer_cast<Session>(session);
   CHECK_RETURN_IF_FALSE(real_session);
 
-  const bfrt::BfRtTable* table;
-  RETURN_IF_BFRT_ERROR(bfrt_info_->bfrtTableFromIdGet(table_id, &table));
+  ASSIGN_OR_RETURN(const bfrt::BfRtTable* table, GetTable(table_id));
   std::unique_ptr<bfrt::BfRtTableKey> table_key;
   RETURN_IF_BFRT_ERROR(table->keyAllocate(&table_key));
   // Key: $SELECTOR_GROUP_ID
@@ -2347,8 +2750,7 @@ namespace {
   CHECK_RETURN_IF_FALSE(real_session);
 
   auto bf_dev_tgt = GetDeviceTarget(device);
-  const bfrt::BfRtTable* table;
-  RETURN_IF_BFRT_ERROR(bfrt_info_->bfrtTableFromIdGet(table_id, &table));
+  ASSIGN_OR_RETURN(const bfrt::BfRtTable* table, GetTable(table_id));
   std::vector<std::unique_ptr<bfrt::BfRtTableKey>> keys;
   std::vector<std::unique_ptr<bfrt::BfRtTableData>> datums;
   // Is this a wildcard read?
@@ -2416,8 +2818,7 @@ namespace {
   auto real_table_data = dynamic_cast<const TableData*>(table_data);
   CHECK_RETURN_IF_FALSE(real_table_data);
 
-  const bfrt::BfRtTable* table;
-  RETURN_IF_BFRT_ERROR(bfrt_info_->bfrtTableFromIdGet(table_id, &table));
+  ASSIGN_OR_RETURN(const bfrt::BfRtTable* table, GetTable(table_id));
   auto bf_dev_tgt = GetDeviceTarget(device);
   RETURN_IF_BFRT_ERROR(table->tableEntryAdd(
       *real_session->bfrt_session_, bf_dev_tgt, *real_table_key->table_key_,
@@ -2437,8 +2838,7 @@ namespace {
   CHECK_RETURN_IF_FALSE(real_table_key);
   auto real_table_data = dynamic_cast<const TableData*>(table_data);
   CHECK_RETURN_IF_FALSE(real_table_data);
-  const bfrt::BfRtTable* table;
-  RETURN_IF_BFRT_ERROR(bfrt_info_->bfrtTableFromIdGet(table_id, &table));
+  ASSIGN_OR_RETURN(const bfrt::BfRtTable* table, GetTable(table_id));
 
   auto bf_dev_tgt = GetDeviceTarget(device);
   RETURN_IF_BFRT_ERROR(table->tableEntryMod(
@@ -2456,8 +2856,7 @@ namespace {
   CHECK_RETURN_IF_FALSE(real_session);
   auto real_table_key = dynamic_cast<const TableKey*>(table_key);
   CHECK_RETURN_IF_FALSE(real_table_key);
-  const bfrt::BfRtTable* table;
-  RETURN_IF_BFRT_ERROR(bfrt_info_->bfrtTableFromIdGet(table_id, &table));
+  ASSIGN_OR_RETURN(const bfrt::BfRtTable* table, GetTable(table_id));
 
   auto bf_dev_tgt = GetDeviceTarget(device);
   RETURN_IF_BFRT_ERROR(table->tableEntryDel(
@@ -2477,8 +2876,7 @@ namespace {
   CHECK_RETURN_IF_FALSE(real_table_key);
   auto real_table_data = dynamic_cast<const TableData*>(table_data);
   CHECK_RETURN_IF_FALSE(real_table_data);
-  const bfrt::BfRtTable* table;
-  RETURN_IF_BFRT_ERROR(bfrt_info_->bfrtTableFromIdGet(table_id, &table));
+  ASSIGN_OR_RETURN(const bfrt::BfRtTable* table, GetTable(table_id));
 
   auto bf_dev_tgt = GetDeviceTarget(device);
   RETURN_IF_BFRT_ERROR(table->tableEntryGet(
@@ -2497,8 +2895,7 @@ namespace {
   ::absl::ReaderMutexLock l(&data_lock_);
   auto real_session = std::dynamic_pointer_cast<Session>(session);
   CHECK_RETURN_IF_FALSE(real_session);
-  const bfrt::BfRtTable* table;
-  RETURN_IF_BFRT_ERROR(bfrt_info_->bfrtTableFromIdGet(table_id, &table));
+  ASSIGN_OR_RETURN(const bfrt::BfRtTable* table, GetTable(table_id));
   auto bf_dev_tgt = GetDeviceTarget(device);
 
   std::vector<std::unique_ptr<bfrt::BfRtTableKey>> keys;
@@ -2509,9 +2906,12 @@ namespace {
   table_keys->resize(0);
   table_datas->resize(0);
 
+  const auto* table_info = table_cache_->GetTable(table_id);
   for (size_t i = 0; i < keys.size(); ++i) {
-    auto tk = absl::make_unique<TableKey>(std::move(keys[i]));
-    auto td = absl::make_unique<TableData>(std::move(datums[i]));
+    auto tk = absl::make_unique<TableKey>(std::move(keys[i]), table_cache_,
+                                          table_info);
+    auto td = absl::make_unique<TableData>(std::move(datums[i]), table_cache_,
+                                           table_info);
     table_keys->push_back(std::move(tk));
     table_datas->push_back(std::move(td));
   }
@@ -2527,8 +2927,7 @@ namespace {
   CHECK_RETURN_IF_FALSE(real_session);
   auto real_table_data = dynamic_cast<const TableData*>(table_data);
   CHECK_RETURN_IF_FALSE(real_table_data);
-  const bfrt::BfRtTable* table;
-  RETURN_IF_BFRT_ERROR(bfrt_info_->bfrtTableFromIdGet(table_id, &table));
+  ASSIGN_OR_RETURN(const bfrt::BfRtTable* table, GetTable(table_id));
 
   auto bf_dev_tgt = GetDeviceTarget(device);
   RETURN_IF_BFRT_ERROR(table->tableDefaultEntrySet(
@@ -2543,8 +2942,7 @@ namespace {
   ::absl::ReaderMutexLock l(&data_lock_);
   auto real_session = std::dynamic_pointer_cast<Session>(session);
   CHECK_RETURN_IF_FALSE(real_session);
-  const bfrt::BfRtTable* table;
-  RETURN_IF_BFRT_ERROR(bfrt_info_->bfrtTableFromIdGet(table_id, &table));
+  ASSIGN_OR_RETURN(const bfrt::BfRtTable* table, GetTable(table_id));
 
   auto bf_dev_tgt = GetDeviceTarget(device);
   RETURN_IF_BFRT_ERROR(
@@ -2561,8 +2959,7 @@ namespace {
   CHECK_RETURN_IF_FALSE(real_session);
   auto real_table_data = dynamic_cast<const TableData*>(table_data);
   CHECK_RETURN_IF_FALSE(real_table_data);
-  const bfrt::BfRtTable* table;
-  RETURN_IF_BFRT_ERROR(bfrt_info_->bfrtTableFromIdGet(table_id, &table));
+  ASSIGN_OR_RETURN(const bfrt::BfRtTable* table, GetTable(table_id));
 
   auto bf_dev_tgt = GetDeviceTarget(device);
   RETURN_IF_BFRT_ERROR(table->tableDefaultEntryGet(
@@ -2602,90 +2999,82 @@ namespace {
   return DoSynchronizeCounters(device, session, table_id, timeout);
 }
 
+::util::Status BfSdeWrapper::SynchronizeCountersOfTables(
+    int device, std::shared_ptr<BfSdeInterface::SessionInterface> session,
+    const std::vector<uint32>& table_ids, absl::Duration timeout) {
+  ::absl::ReaderMutexLock l(&data_lock_);
+  return DoSynchronizeTables(device, session, table_ids,
+                             {bfrt::TableOperationsType::COUNTER_SYNC},
+                             timeout);
+}
+
 ::util::Status BfSdeWrapper::DoSynchronizeCounters(
     int device, std::shared_ptr<BfSdeInterface::SessionInterface> session,
     uint32 table_id, absl::Duration timeout) {
-  auto real_session = std::dynamic_pointer_cast<Session>(session);
-  CHECK_RETURN_IF_FALSE(real_session);
-
-  const bfrt::BfRtTable* table;
-  RETURN_IF_BFRT_ERROR(bfrt_info_->bfrtTableFromIdGet(table_id, &table));
-
-  auto bf_dev_tgt = GetDeviceTarget(device);
-  // Sync table counter
-  std::set<bfrt::TableOperationsType> supported_ops;
-  RETURN_IF_BFRT_ERROR(table->tableOperationsSupported(&supported_ops));
-  if (supported_ops.count(bfrt::TableOperationsType::COUNTER_SYNC)) {
-    auto sync_notifier = std::make_shared<absl::Notification>();
-    std::weak_ptr<absl::Notification> weak_ref(sync_notifier);
-    std::unique_ptr<bfrt::BfRtTableOperations> table_op;
-    RETURN_IF_BFRT_ERROR(table->operationsAllocate(
-        bfrt::TableOperationsType::COUNTER_SYNC, &table_op));
-    RETURN_IF_BFRT_ERROR(table_op->counterSyncSet(
-        *real_session->bfrt_session_, bf_dev_tgt,
-        [table_id, weak_ref](const bf_rt_target_t& dev_tgt, void* cookie) {
-          if (auto notifier = weak_ref.lock()) {
-            VLOG(1) << "Table counter for table " << table_id << " synced.";
-            notifier->Notify();
-          } else {
-            VLOG(1) << "Notifier expired before table " << table_id
-                    << " could be synced.";
-          }
-        },
-        nullptr));
-    RETURN_IF_BFRT_ERROR(table->tableOperationsExecute(*table_op.get()));
-    // Wait until sync done or timeout.
-    if (!sync_notifier->WaitForNotificationWithTimeout(timeout)) {
-      return MAKE_ERROR(ERR_OPER_TIMEOUT)
-             << "Timeout while syncing (indirect) table counters of table "
-             << table_id << ".";
-    }
-  }
-
-  return ::util::OkStatus();
+  return DoSynchronizeTables(device, session, {table_id},
+                             {bfrt::TableOperationsType::COUNTER_SYNC},
+                             timeout);
 }
 
 ::util::Status BfSdeWrapper::SynchronizeRegisters(
     int device, std::shared_ptr<BfSdeInterface::SessionInterface> session,
     uint32 table_id, absl::Duration timeout) {
+  return DoSynchronizeTables(device, session, {table_id},
+                             {bfrt::TableOperationsType::REGISTER_SYNC},
+                             timeout);
+}
+
+::util::Status BfSdeWrapper::DoSynchronizeTables(
+    int device, std::shared_ptr<BfSdeInterface::SessionInterface> session,
+    const std::vector<uint32>& table_ids,
+    const std::set<bfrt::TableOperationsType>& sync_ops,
+    absl::Duration timeout) {
   auto real_session = std::dynamic_pointer_cast<Session>(session);
   CHECK_RETURN_IF_FALSE(real_session);
-
-  const bfrt::BfRtTable* table;
-  RETURN_IF_BFRT_ERROR(bfrt_info_->bfrtTableFromIdGet(table_id, &table));
-
+  const absl::Time deadline = absl::Now() + timeout;
   auto bf_dev_tgt = GetDeviceTarget(device);
-  // Sync table registers.
-  std::set<bfrt::TableOperationsType> supported_ops;
-  RETURN_IF_BFRT_ERROR(table->tableOperationsSupported(&supported_ops));
-  if (supported_ops.count(bfrt::TableOperationsType::REGISTER_SYNC)) {
-    auto sync_notifier = std::make_shared<absl::Notification>();
-    std::weak_ptr<absl::Notification> weak_ref(sync_notifier);
-    std::unique_ptr<bfrt::BfRtTableOperations> table_op;
-    RETURN_IF_BFRT_ERROR(table->operationsAllocate(
-        bfrt::TableOperationsType::REGISTER_SYNC, &table_op));
-    RETURN_IF_BFRT_ERROR(table_op->registerSyncSet(
-        *real_session->bfrt_session_, bf_dev_tgt,
-        [table_id, weak_ref](const bf_rt_target_t& dev_tgt, void* cookie) {
-          if (auto notifier = weak_ref.lock()) {
-            VLOG(1) << "Table registers for table " << table_id << " synced.";
-            notifier->Notify();
-          } else {
-            VLOG(1) << "Notifier expired before table " << table_id
-                    << " could be synced.";
-          }
-        },
-        nullptr));
-    RETURN_IF_BFRT_ERROR(table->tableOperationsExecute(*table_op.get()));
-    // Wait until sync done or timeout.
-    if (!sync_notifier->WaitForNotificationWithTimeout(timeout)) {
-      return MAKE_ERROR(ERR_OPER_TIMEOUT)
-             << "Timeout while syncing (indirect) table registers of table "
-             << table_id << ".";
+
+  // If starting a sync fails, the syncs already started are abandoned: their
+  // callbacks are ignored once this function returns.
+  BfrtTableSyncTracker sync_tracker;
+  for (const auto table_id : table_ids) {
+    ASSIGN_OR_RETURN(const bfrt::BfRtTable* table, GetTable(table_id));
+    std::set<bfrt::TableOperationsType> supported_ops;
+    RETURN_IF_BFRT_ERROR(table->tableOperationsSupported(&supported_ops));
+    for (const auto op : sync_ops) {
+      if (!supported_ops.count(op)) continue;
+      const bool is_counter_sync =
+          op == bfrt::TableOperationsType::COUNTER_SYNC;
+      auto sync_done = sync_tracker.AddSync(
+          table_id, is_counter_sync ? "counters" : "registers");
+      auto sync_callback = [sync_done](const bf_rt_target_t& dev_tgt,
+                                       void* cookie) { sync_done(); };
+      std::unique_ptr<bfrt::BfRtTableOperations> table_op;
+      RETURN_IF_BFRT_ERROR(table->operationsAllocate(op, &table_op));
+      if (is_counter_sync) {
+        RETURN_IF_BFRT_ERROR(table_op->counterSyncSet(
+            *real_session->bfrt_session_, bf_dev_tgt, sync_callback, nullptr));
+      } else {
+        RETURN_IF_BFRT_ERROR(table_op->registerSyncSet(
+            *real_session->bfrt_session_, bf_dev_tgt, sync_callback, nullptr));
+      }
+      RETURN_IF_BFRT_ERROR(table->tableOperationsExecute(*table_op.get()));
     }
   }
 
-  return ::util::OkStatus();
+  // Wait until all syncs are done or timeout.
+  return sync_tracker.WaitForAll(deadline);
+}
+
+::util::StatusOr<const bfrt::BfRtTable*> BfSdeWrapper::GetTable(
+    uint32 table_id) const {
+  CHECK_RETURN_IF_FALSE(table_cache_) << "No pipeline has been pushed.";
+  const auto* table_info = table_cache_->GetTable(table_id);
+  if (!table_info) {
+    return MAKE_ERROR(ERR_ENTRY_NOT_FOUND) << "Unknown table " << table_id
+                                           << ".";
+  }
+  return table_info->table;
 }
 
 BfSdeWrapper* BfSdeWrapper::CreateSingleton() {
@@ -4,23 +4,30 @@
 #ifndef STRATUM_HAL_LIB_BAREFOOT_BF_SDE_WRAPPER_H_
 #define STRATUM_HAL_LIB_BAREFOOT_BF_SDE_WRAPPER_H_
 
+#include <atomic>
+#include <map>
 #include <memory>
+#include <set>
 #include <string>
 #include <utility>
 #include <vector>
 
 #include "absl/container/flat_hash_map.h"
+#include "absl/strings/string_view.h"
 #include "absl/synchronization/mutex.h"
 #include "bf_rt/bf_rt_init.hpp"
 #include "bf_rt/bf_rt_session.hpp"
 #include "bf_rt/bf_rt_table.hpp"
 #include "bf_rt/bf_rt_table_key.hpp"
+#include "bf_rt/bf_rt_table_operations.hpp"
 #include "pkt_mgr/pkt_mgr_intf.h"
 #include "stratum/glue/integral_types.h"
 #include "stratum/glue/status/status.h"
 #include "stratum/glue/status/statusor.h"
+#include "stratum/hal/lib/barefoot/bf_packet_tx_pool.h"
 #include "stratum/hal/lib/barefoot/bf_sde_interface.h"
 #include "stratum/hal/lib/barefoot/bfrt_id_mapper.h"
+#include "stratum/hal/lib/barefoot/bfrt_table_cache.h"
 #include "stratum/hal/lib/barefoot/macros.h"
 #include "stratum/hal/lib/common/common.pb.h"
 #include "stratum/lib/channel/channel.h"
@@ -29,10 +36,21 @@ namespace stratum {
 namespace hal {
 namespace barefoot {
 
+// The table cache of a pipeline, over the BfRt types of the SDE.
+using SdeTableCache = BfrtTableCache<bfrt::BfRtTable, bfrt::BfRtTableKey,
+                                     bfrt::BfRtTableData>;
+
 class TableKey : public BfSdeInterface::TableKeyInterface {
  public:
-  explicit TableKey(std::unique_ptr<bfrt::BfRtTableKey> table_key)
-      : table_key_(std::move(table_key)) {}
+  // Wraps a key object of the given table of the cache. The key object is
+  // returned to the pool of the cache when this is destroyed.
+  TableKey(std::unique_ptr<bfrt::BfRtTableKey> table_key,
+           std::shared_ptr<SdeTableCache> table_cache,
+           const SdeTableCache::TableInfo* table_info)
+      : table_key_(std::move(table_key)),
+        table_cache_(std::move(table_cache)),
+        table_info_(table_info) {}
+  ~TableKey() override;
 
   // TableKeyInterface public methods.
   ::util::Status SetExact(int id, const std::string& value) override;
@@ -52,21 +70,31 @@ class TableKey : public BfSdeInterface::TableKeyInterface {
   ::util::Status SetPriority(uint32 priority) override;
   ::util::Status GetPriority(uint32* priority) const override;
 
-  // Allocates a new table key object.
+  // Takes a table key object from the pool of the cache, or allocates a new
+  // one if the pool is empty.
   static ::util::StatusOr<std::unique_ptr<BfSdeInterface::TableKeyInterface>>
-  CreateTableKey(const bfrt::BfRtInfo* bfrt_info_, int table_id);
+  CreateTableKey(std::shared_ptr<SdeTableCache> table_cache, int table_id);
 
   // Stores the underlying SDE object.
   std::unique_ptr<bfrt::BfRtTableKey> table_key_;
 
  private:
-  TableKey() {}
+  // The cache the key object is returned to, and the table of the key.
+  std::shared_ptr<SdeTableCache> table_cache_;
+  const SdeTableCache::TableInfo* table_info_;
 };
 
 class TableData : public BfSdeInterface::TableDataInterface {
  public:
-  explicit TableData(std::unique_ptr<bfrt::BfRtTableData> table_data)
-      : table_data_(std::move(table_data)) {}
+  // Wraps a data object of the given table of the cache. The data object is
+  // returned to the pool of the cache when this is destroyed.
+  TableData(std::unique_ptr<bfrt::BfRtTableData> table_data,
+            std::shared_ptr<SdeTableCache> table_cache,
+            const SdeTableCache::TableInfo* table_info)
+      : table_data_(std::move(table_data)),
+        table_cache_(std::move(table_cache)),
+        table_info_(table_info) {}
+  ~TableData() override;
 
   // TableDataInterface public methods.
   ::util::Status SetParam(int id, const std::string& value) override;
@@ -81,16 +109,23 @@ class TableData : public BfSdeInterface::TableDataInterface {
   ::util::Status GetActionId(int* action_id) const override;
   ::util::Status Reset(int action_id) override;
 
-  // Allocates a new table data object.
+  // Takes a table data object from the pool of the cache and resets it to the
+  // given action, or allocates a new one if the pool is empty.
   static ::util::StatusOr<std::unique_ptr<BfSdeInterface::TableDataInterface>>
-  CreateTableData(const bfrt::BfRtInfo* bfrt_info_, int table_id,
+  CreateTableData(std::shared_ptr<SdeTableCache> table_cache, int table_id,
                   int action_id);
 
   // Stores the underlying SDE object.
   std::unique_ptr<bfrt::BfRtTableData> table_data_;
 
  private:
-  TableData() {}
+  // Returns the action ID of the data object, or 0 if the table has no
+  // actions.
+  ::util::StatusOr<bf_rt_id_t> GetBfRtActionId() const;
+
+  // The cache the data object is returned to, and the table of the data.
+  std::shared_ptr<SdeTableCache> table_cache_;
+  const SdeTableCache::TableInfo* table_info_;
 };
 
 // The "BfSdeWrapper" is an implementation of BfSdeInterface which is used
@@ -147,6 +182,9 @@ class BfSdeWrapper : public BfSdeInterface {
   ::util::StatusOr<PortState> GetPortState(int device, int port) override;
   ::util::Status GetPortCounters(int device, int port,
                                  PortCounters* counters) override;
+  ::util::Status GetAllPortCounters(int device,
+                                    std::map<int, PortCounters>* counters)
+      override LOCKS_EXCLUDED(data_lock_);
   ::util::Status RegisterPortStatusEventWriter(
       std::unique_ptr<ChannelWriter<PortStatusEvent>> writer) override
       LOCKS_EXCLUDED(port_status_event_writer_lock_);
@@ -169,12 +207,24 @@ class BfSdeWrapper : public BfSdeInterface {
   ::util::Status SetTmCpuPort(int device, int port) override;
   ::util::StatusOr<bool> IsSoftwareModel(int device) override;
   std::string GetBfChipType(int device) const override;
-  ::util::Status TxPacket(int device, const std::string& packet) override;
-  ::util::Status StartPacketIo(int device) override;
-  ::util::Status StopPacketIo(int device) override;
+  ::util::Status TxPacket(int device, absl::string_view header,
+                          absl::string_view payload) override
+      LOCKS_EXCLUDED(packet_tx_lock_);
+  ::util::Status StartPacketIo(int device) override
+      LOCKS_EXCLUDED(packet_tx_lock_);
+  ::util::Status StopPacketIo(int device) override
+      LOCKS_EXCLUDED(packet_tx_lock_);
   ::util::Status RegisterPacketReceiveWriter(
       int device, std::unique_ptr<ChannelWriter<std::string>> writer) override;
-  ::util::Status UnregisterPacketReceiveWriter(int device) override;
+  ::util::Status RegisterPacketReceiveBufferPool(
+      int device, std::shared_ptr<Channel<std::string>> buffer_pool) override
+      LOCKS_EXCLUDED(packet_rx_callback_lock_);
+  ::util::Status UnregisterPacketReceiveWriter(int device) override
+      LOCKS_EXCLUDED(packet_rx_callback_lock_);
+  PacketRxStats GetPacketRxStats(int device) override
+      LOCKS_EXCLUDED(packet_rx_callback_lock_);
+  PacketTxStats GetPacketTxStats(int device) override
+      LOCKS_EXCLUDED(packet_tx_lock_);
   ::util::StatusOr<uint32> CreateMulticastNode(
       int device, std::shared_ptr<BfSdeInterface::SessionInterface> session,
       int mc_replication_id, const std::vector<uint32>& mc_lag_ids,
@@ -283,6 +333,10 @@ class BfSdeWrapper : public BfSdeInterface {
       int device, std::shared_ptr<BfSdeInterface::SessionInterface> session,
       uint32 table_id, absl::Duration timeout) override
       LOCKS_EXCLUDED(data_lock_);
+  ::util::Status SynchronizeCountersOfTables(
+      int device, std::shared_ptr<BfSdeInterface::SessionInterface> session,
+      const std::vector<uint32>& table_ids, absl::Duration timeout) override
+      LOCKS_EXCLUDED(data_lock_);
   ::util::Status InsertTableEntry(
       int device, std::shared_ptr<BfSdeInterface::SessionInterface> session,
       uint32 table_id, const TableKeyInterface* table_key,
@@ -347,6 +401,12 @@ class BfSdeWrapper : public BfSdeInterface {
                                 bf_pkt_rx_ring_t rx_ring)
       LOCKS_EXCLUDED(packet_rx_callback_lock_);
 
+  // Returns the buffer of a transmitted packet to the TX pool, or frees it if
+  // it is not from the pool. Called from the SDE TX completion callback.
+  ::util::Status HandlePacketTxDone(bf_dev_id_t device, bf_pkt* pkt,
+                                    uint32 status)
+      LOCKS_EXCLUDED(packet_tx_lock_);
+
   // Called whenever a port status event is received from SDK. It forwards the
   // port status event to the module who registered a callback by calling
   // RegisterPortStatusEventWriter().
@@ -381,9 +441,39 @@ class BfSdeWrapper : public BfSdeInterface {
   // Mutex protecting the packet rx writer map.
   mutable absl::Mutex packet_rx_callback_lock_;
 
+  // Mutex protecting the packet tx pool map.
+  mutable absl::Mutex packet_tx_lock_;
+
   // RW mutex lock for protecting the pipeline state.
   mutable absl::Mutex data_lock_;
 
+  // The counters behind PacketRxStats, updated by concurrent SDE callbacks.
+  struct PacketRxCounters {
+    std::atomic<uint64> num_packets{0};
+    std::atomic<uint64> num_dropped_no_writer{0};
+    std::atomic<uint64> num_dropped_no_buffer{0};
+    std::atomic<uint64> num_dropped_channel_full{0};
+    std::atomic<int64> total_callback_ns{0};
+    std::atomic<int64> max_callback_ns{0};
+  };
+
+  // Allocates the TX buffers of the device, unless it already has them from a
+  // bf_pkt driver that was not re-initialized since.
+  ::util::Status AllocatePacketTxPool(int device, bool driver_initialized)
+      LOCKS_EXCLUDED(packet_tx_lock_);
+
+  // Stops transmitting packets from the TX buffers of the device, and waits
+  // for a while for the packets in flight to complete.
+  void DrainPacketTxPool(int device) LOCKS_EXCLUDED(packet_tx_lock_);
+
+  // Frees the TX buffers of the device that are not in flight.
+  void FreePacketTxPool(int device) LOCKS_EXCLUDED(packet_tx_lock_);
+
+  // Transmits a packet that does not fit in a pooled TX buffer, in a buffer
+  // allocated for it.
+  ::util::Status TxUnpooledPacket(int device, absl::string_view header,
+                                  absl::string_view payload);
+
   // Callback registed with the SDE for Tx notifications.
   static bf_status_t BfPktTxNotifyCallback(bf_dev_id_t device,
                                            bf_pkt_tx_ring_t tx_ring,
@@ -433,19 +523,31 @@ class BfSdeWrapper : public BfSdeInterface {
 
   // Synchronizes the driver cached register values with the current hardware
   // state for a given BfRt table.
-  // TODO(max): consolidate with SynchronizeCounters
   ::util::Status SynchronizeRegisters(
       int device, std::shared_ptr<BfSdeInterface::SessionInterface> session,
       uint32 table_id, absl::Duration timeout)
       SHARED_LOCKS_REQUIRED(data_lock_);
 
   // Internal version SynchronizeCounters without locks.
-  // TODO(max): consolidate with SynchronizeRegisters
   ::util::Status DoSynchronizeCounters(
       int device, std::shared_ptr<BfSdeInterface::SessionInterface> session,
       uint32 table_id, absl::Duration timeout)
       SHARED_LOCKS_REQUIRED(data_lock_);
 
+  // Executes the given sync operations (COUNTER_SYNC, REGISTER_SYNC) on all
+  // the given BfRt tables that support them, then waits until all of them
+  // are done or the timeout expires. Internal version without locks.
+  ::util::Status DoSynchronizeTables(
+      int device, std::shared_ptr<BfSdeInterface::SessionInterface> session,
+      const std::vector<uint32>& table_ids,
+      const std::set<bfrt::TableOperationsType>& sync_ops,
+      absl::Duration timeout) SHARED_LOCKS_REQUIRED(data_lock_);
+
+  // Returns the handle of the BfRt table with the given ID from the table
+  // cache of the pipeline.
+  ::util::StatusOr<const bfrt::BfRtTable*> GetTable(uint32 table_id) const
+      SHARED_LOCKS_REQUIRED(data_lock_);
+
   // Writer to forward the port status change message to. It is registered
   // by chassis manager to receive SDE port status change events.
   std::unique_ptr<ChannelWriter<PortStatusEvent>> port_status_event_writer_
@@ -455,6 +557,22 @@ class BfSdeWrapper : public BfSdeInterface {
   absl::flat_hash_map<int, std::unique_ptr<ChannelWriter<std::string>>>
       device_to_packet_rx_writer_ GUARDED_BY(packet_rx_callback_lock_);
 
+  // Map from device ID to the pool of buffers for the received packets.
+  absl::flat_hash_map<int, std::shared_ptr<Channel<std::string>>>
+      device_to_packet_rx_buffer_pool_ GUARDED_BY(packet_rx_callback_lock_);
+
+  // Map from device ID to the counters of the received packets. The entries
+  // are added by RegisterPacketReceiveWriter() and never removed, so that
+  // HandlePacketRx() can update them under a reader lock.
+  absl::flat_hash_map<int, std::unique_ptr<PacketRxCounters>>
+      device_to_packet_rx_counters_ GUARDED_BY(packet_rx_callback_lock_);
+
+  // Map from device ID to the pool of preallocated buffers for the transmitted
+  // packets. The pools are created by StartPacketIo() and destroyed by
+  // StopPacketIo().
+  absl::flat_hash_map<int, std::unique_ptr<BfPacketTxPool>>
+      device_to_packet_tx_pool_ GUARDED_BY(packet_tx_lock_);
+
   // TODO(max): make the following maps to handle multiple devices.
   // Pointer to the ID mapper. Not owned by this class.
   std::unique_ptr<BfrtIdMapper> bfrt_id_mapper_ GUARDED_BY(data_lock_);
@@ -462,6 +580,11 @@ class BfSdeWrapper : public BfSdeInterface {
   // Pointer to the current BfR info object. Not owned by this class.
   const bfrt::BfRtInfo* bfrt_info_ GUARDED_BY(data_lock_);
 
+  // The table handles, field IDs and pooled key and data objects of the
+  // pipeline, built along with bfrt_info_. Shared with the TableKey and
+  // TableData objects, which outlive a pipeline change.
+  std::shared_ptr<SdeTableCache> table_cache_ GUARDED_BY(data_lock_);
+
   // Pointer to the bfrt device manager. Not owned by this class.
   bfrt::BfRtDevMgr* bfrt_device_manager_ GUARDED_BY(data_lock_);
 };
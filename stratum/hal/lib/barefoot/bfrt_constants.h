@@ -24,6 +24,8 @@ constexpr char kMcNodeL1XidValid[] = "$MULTICAST_NODE_L1_XID_VALID";
 constexpr char kMcNodeLagId[] = "$MULTICAST_LAG_ID";
 constexpr char kMcReplicationId[] = "$MULTICAST_RID";
 constexpr char kMgid[] = "$MGID";
+constexpr char kPortStatDevPort[] = "$DEV_PORT";
+constexpr char kPortStatTable[] = "$PORT_STAT";
 constexpr char kPreMgidTable[] = "$pre.mgid";
 constexpr char kPreNodeTable[] = "$pre.node";
 constexpr char kRegisterIndex[] = "$REGISTER_INDEX";
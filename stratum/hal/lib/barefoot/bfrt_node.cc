@@ -320,7 +320,9 @@ BfrtNode::~BfrtNode() = default;
 }
 
 ::util::Status BfrtNode::TransmitPacket(const ::p4::v1::PacketOut& packet) {
-  absl::WriterMutexLock l(&lock_);
+  // BfrtPacketioManager is thread-safe, so that PacketOuts are transmitted
+  // concurrently under the reader lock.
+  absl::ReaderMutexLock l(&lock_);
   if (!initialized_) {
     return MAKE_ERROR(ERR_NOT_INITIALIZED) << "Not initialized!";
   }
@@ -328,6 +330,10 @@ BfrtNode::~BfrtNode() = default;
   return bfrt_packetio_manager_->TransmitPacket(packet);
 }
 
+std::string BfrtNode::GetPacketIoDebugString() const {
+  return bfrt_packetio_manager_->GetPacketIoDebugString();
+}
+
 ::util::Status BfrtNode::WriteExternEntry(
     std::shared_ptr<BfSdeInterface::SessionInterface> session,
     const ::p4::v1::Update::Type type, const ::p4::v1::ExternEntry& entry) {
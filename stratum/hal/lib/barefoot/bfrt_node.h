@@ -5,6 +5,7 @@
 #define STRATUM_HAL_LIB_BAREFOOT_BFRT_NODE_H_
 
 #include <memory>
+#include <string>
 #include <vector>
 
 #include "absl/synchronization/mutex.h"
@@ -59,6 +60,8 @@ class BfrtNode final {
   ::util::Status UnregisterPacketReceiveWriter() LOCKS_EXCLUDED(lock_);
   ::util::Status TransmitPacket(const ::p4::v1::PacketOut& packet)
       LOCKS_EXCLUDED(lock_);
+  // Returns the counters of the packet IO of the node as a debug string.
+  std::string GetPacketIoDebugString() const;
   // Factory function for creating the instance of the class.
   static std::unique_ptr<BfrtNode> CreateInstance(
       BfrtTableManager* bfrt_table_manager,
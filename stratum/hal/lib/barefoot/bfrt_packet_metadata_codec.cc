@@ -0,0 +1,229 @@
+// Copyright 2020-present Open Networking Foundation
+// SPDX-License-Identifier: Apache-2.0
+
+#include "stratum/hal/lib/barefoot/bfrt_packet_metadata_codec.h"
+
+#include <endian.h>
+#include <string.h>
+
+#include <algorithm>
+
+#include "absl/container/inlined_vector.h"
+#include "stratum/glue/logging.h"
+#include "stratum/lib/macros.h"
+#include "stratum/lib/utils.h"
+
+namespace stratum {
+namespace hal {
+namespace barefoot {
+
+namespace {
+
+constexpr int kBitsPerByte = 8;
+
+// Fields are copied in chunks of at most kMaxChunkBits bits. A chunk starting
+// anywhere in a byte then fits in the 64-bit word loaded from 8 bytes. The
+// chunk size is a multiple of 8, so that all chunks of a field but its most
+// significant one fill whole bytes of the metadata value.
+constexpr int kMaxChunkBits = 56;
+
+inline size_t BytesForBits(size_t bits) {
+  return (bits + kBitsPerByte - 1) / kBitsPerByte;
+}
+
+inline uint64 LowBitsMask(int bits) {
+  return bits == 64 ? ~0ULL : (1ULL << bits) - 1;
+}
+
+// Returns the bits [bit_offset, bit_offset + bits) of the header, with
+// bits <= kMaxChunkBits. The header must hold all of these bits.
+inline uint64 LoadBits(const uint8* header, size_t header_size,
+                       size_t bit_offset, int bits) {
+  const size_t byte_offset = bit_offset / kBitsPerByte;
+  const int shift = bit_offset % kBitsPerByte;
+  uint64 word;
+  int word_bits;
+  if (byte_offset + sizeof(word) <= header_size) {
+    memcpy(&word, header + byte_offset, sizeof(word));
+    word = be64toh(word);
+    word_bits = 64;
+  } else {
+    // Near the end of the header, only the bytes of the chunk are loaded.
+    const size_t num_bytes = BytesForBits(shift + bits);
+    word = 0;
+    for (size_t i = 0; i < num_bytes; ++i) {
+      word = (word << kBitsPerByte) | header[byte_offset + i];
+    }
+    word_bits = num_bytes * kBitsPerByte;
+  }
+  return (word >> (word_bits - shift - bits)) & LowBitsMask(bits);
+}
+
+// Sets the bits [bit_offset, bit_offset + bits) of the header, which must be
+// zero, to the value, with bits <= kMaxChunkBits.
+inline void StoreBits(uint8* header, size_t bit_offset, int bits,
+                      uint64 value) {
+  const size_t byte_offset = bit_offset / kBitsPerByte;
+  const int shift = bit_offset % kBitsPerByte;
+  const size_t num_bytes = BytesForBits(shift + bits);
+  uint64 word = (value & LowBitsMask(bits))
+                << (num_bytes * kBitsPerByte - shift - bits);
+  for (size_t i = num_bytes; i > 0; --i) {
+    header[byte_offset + i - 1] |= word & 0xff;
+    word >>= kBitsPerByte;
+  }
+}
+
+// Returns the big-endian value of the bytes [begin, end) of the bytestring.
+// Bytes before the start of the bytestring count as zero.
+inline uint64 LoadBytes(const std::string& bytestring, int begin, int end) {
+  uint64 value = 0;
+  for (int i = std::max(begin, 0); i < end; ++i) {
+    value = (value << kBitsPerByte) | static_cast<uint8>(bytestring[i]);
+  }
+  return value;
+}
+
+}  // namespace
+
+::util::Status BfrtPacketMetadataCodec::Initialize(
+    const std::vector<std::pair<uint32, int>>& header) {
+  std::vector<Field> fields;
+  absl::flat_hash_map<uint32, int> field_index_by_id;
+  size_t bits = 0;
+  for (const auto& p : header) {
+    CHECK_RETURN_IF_FALSE(p.second > 0)
+        << "Metadata with Id " << p.first << " has invalid bit width "
+        << p.second << ".";
+    field_index_by_id.emplace(p.first, fields.size());
+    fields.push_back({p.first, p.second, bits});
+    bits += p.second;
+  }
+  CHECK_RETURN_IF_FALSE(bits % kBitsPerByte == 0)
+      << "Header size must be multiple of 8 bits.";
+
+  fields_ = std::move(fields);
+  field_index_by_id_ = std::move(field_index_by_id);
+  header_size_ = bits / kBitsPerByte;
+
+  return ::util::OkStatus();
+}
+
+void BfrtPacketMetadataCodec::Clear() {
+  fields_.clear();
+  field_index_by_id_.clear();
+  header_size_ = 0;
+}
+
+::util::Status BfrtPacketMetadataCodec::Deparse(
+    const ::p4::v1::PacketOut& packet, std::string* buffer) const {
+  buffer->resize(header_size_ + packet.payload().size());
+  uint8* header = reinterpret_cast<uint8*>(&(*buffer)[0]);
+  RETURN_IF_ERROR(WriteHeader(packet, header));
+  if (!packet.payload().empty()) {
+    memcpy(header + header_size_, packet.payload().data(),
+           packet.payload().size());
+  }
+
+  return ::util::OkStatus();
+}
+
+::util::Status BfrtPacketMetadataCodec::DeparseHeader(
+    const ::p4::v1::PacketOut& packet, std::string* header) const {
+  header->resize(header_size_);
+  return WriteHeader(packet, reinterpret_cast<uint8*>(&(*header)[0]));
+}
+
+::util::Status BfrtPacketMetadataCodec::WriteHeader(
+    const ::p4::v1::PacketOut& packet, uint8* header) const {
+  // Find the metadata of each header field in one pass over the packet. As
+  // before, the first metadata with a given ID is the one that is used.
+  absl::InlinedVector<const ::p4::v1::PacketMetadata*, 8> field_metadata(
+      fields_.size(), nullptr);
+  for (const auto& metadata : packet.metadata()) {
+    auto it = field_index_by_id_.find(metadata.metadata_id());
+    if (it != field_index_by_id_.end() && field_metadata[it->second] == nullptr)
+      field_metadata[it->second] = &metadata;
+  }
+
+  memset(header, 0, header_size_);
+  for (size_t f = 0; f < fields_.size(); ++f) {
+    const Field& field = fields_[f];
+    CHECK_RETURN_IF_FALSE(field_metadata[f] != nullptr)
+        << "Missing metadata with Id " << field.id << " in PacketOut "
+        << packet.ShortDebugString();
+    const std::string& value = field_metadata[f]->value();
+    const size_t value_bytes = BytesForBits(field.bitwidth);
+    const int top_bits = field.bitwidth % kBitsPerByte;
+    CHECK_RETURN_IF_FALSE(
+        value.size() <= value_bytes &&
+        (value.size() < value_bytes || top_bits == 0 ||
+         (static_cast<uint8>(value[0]) >> top_bits) == 0))
+        << "Bytestring " << StringToHex(value) << " overflows bit width "
+        << field.bitwidth << ".";
+
+    // Copy the value from its least significant end, one chunk at a time.
+    int end = value.size();
+    size_t end_bit = field.bit_offset + field.bitwidth;
+    for (int bits = field.bitwidth; bits > 0;) {
+      const int chunk_bits = std::min(bits, kMaxChunkBits);
+      const int chunk_bytes = BytesForBits(chunk_bits);
+      StoreBits(header, end_bit - chunk_bits, chunk_bits,
+                LoadBytes(value, end - chunk_bytes, end));
+      end -= chunk_bytes;
+      end_bit -= chunk_bits;
+      bits -= chunk_bits;
+    }
+    VLOG(1) << "Encoded PacketOut metadata field with id " << field.id
+            << " bitwidth " << field.bitwidth << " value 0x"
+            << StringToHex(value);
+  }
+
+  return ::util::OkStatus();
+}
+
+::util::Status BfrtPacketMetadataCodec::Parse(
+    absl::string_view buffer, ::p4::v1::PacketIn* packet) const {
+  CHECK_RETURN_IF_FALSE(buffer.size() >= header_size_)
+      << "Received packet is too small.";
+
+  auto* metadata_list = packet->mutable_metadata();
+  while (metadata_list->size() > static_cast<int>(fields_.size())) {
+    metadata_list->RemoveLast();
+  }
+  while (metadata_list->size() < static_cast<int>(fields_.size())) {
+    metadata_list->Add();
+  }
+
+  const uint8* header = reinterpret_cast<const uint8*>(buffer.data());
+  for (size_t f = 0; f < fields_.size(); ++f) {
+    const Field& field = fields_[f];
+    auto* metadata = metadata_list->Mutable(f);
+    metadata->set_metadata_id(field.id);
+    std::string* value = metadata->mutable_value();
+    value->resize(BytesForBits(field.bitwidth));
+
+    // Fill the value from its least significant end, one chunk at a time.
+    int end = value->size();
+    size_t end_bit = field.bit_offset + field.bitwidth;
+    for (int bits = field.bitwidth; bits > 0;) {
+      const int chunk_bits = std::min(bits, kMaxChunkBits);
+      uint64 chunk =
+          LoadBits(header, header_size_, end_bit - chunk_bits, chunk_bits);
+      for (int i = BytesForBits(chunk_bits); i > 0; --i) {
+        (*value)[--end] = static_cast<char>(chunk & 0xff);
+        chunk >>= kBitsPerByte;
+      }
+      end_bit -= chunk_bits;
+      bits -= chunk_bits;
+    }
+  }
+  packet->set_payload(buffer.data() + header_size_,
+                      buffer.size() - header_size_);
+
+  return ::util::OkStatus();
+}
+
+}  // namespace barefoot
+}  // namespace hal
+}  // namespace stratum
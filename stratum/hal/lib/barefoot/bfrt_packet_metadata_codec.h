@@ -0,0 +1,88 @@
+// Copyright 2020-present Open Networking Foundation
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef STRATUM_HAL_LIB_BAREFOOT_BFRT_PACKET_METADATA_CODEC_H_
+#define STRATUM_HAL_LIB_BAREFOOT_BFRT_PACKET_METADATA_CODEC_H_
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/strings/string_view.h"
+#include "p4/v1/p4runtime.pb.h"
+#include "stratum/glue/integral_types.h"
+#include "stratum/glue/status/status.h"
+
+namespace stratum {
+namespace hal {
+namespace barefoot {
+
+// Parses and deparses the metadata header that the pipeline puts in front of
+// the controller packets, i.e. the PacketIn and PacketOut metadata. The header
+// is a sequence of fields, each given by its metadata ID and bit width, packed
+// without padding in the order of the P4Info. The bit offset of each field is
+// computed once by Initialize(), and the fields are copied from and to the
+// packet buffer up to 56 bits at a time with 64-bit shifts and masks.
+//
+// Metadata values follow the encoding of BitBuffer which this class replaces:
+// a parsed value always has (bitwidth + 7) / 8 bytes, and a deparsed value may
+// be shorter but must not have bits set above its bit width.
+class BfrtPacketMetadataCodec {
+ public:
+  BfrtPacketMetadataCodec() : header_size_(0) {}
+
+  // Sets up the codec for a header with the given (metadata ID, bit width)
+  // fields. The total bit width must be a multiple of 8.
+  ::util::Status Initialize(const std::vector<std::pair<uint32, int>>& header);
+
+  // Resets the codec to an empty header.
+  void Clear();
+
+  // Writes the metadata header of the packet followed by its payload into the
+  // buffer. Metadata of the packet that is not part of the header is ignored.
+  ::util::Status Deparse(const ::p4::v1::PacketOut& packet,
+                         std::string* buffer) const;
+
+  // Writes only the metadata header of the packet into the header buffer, for
+  // the payload to be copied straight from the packet to its destination.
+  ::util::Status DeparseHeader(const ::p4::v1::PacketOut& packet,
+                               std::string* header) const;
+
+  // Parses the metadata header at the front of the buffer into the metadata
+  // of the packet, and the rest of the buffer into its payload. The metadata
+  // and payload already in the packet are replaced, so the packet can be
+  // reused across calls without reallocating them.
+  ::util::Status Parse(absl::string_view buffer,
+                       ::p4::v1::PacketIn* packet) const;
+
+  // Returns the size of the header in bytes.
+  size_t header_size() const { return header_size_; }
+
+ private:
+  // Writes the metadata header of the packet to the header_size_ bytes at
+  // header.
+  ::util::Status WriteHeader(const ::p4::v1::PacketOut& packet,
+                             uint8* header) const;
+
+  // A header field and its position in the header.
+  struct Field {
+    uint32 id;
+    int bitwidth;
+    size_t bit_offset;
+  };
+
+  std::vector<Field> fields_;
+
+  // Maps a metadata ID to its index in fields_.
+  absl::flat_hash_map<uint32, int> field_index_by_id_;
+
+  // Size of the header in bytes.
+  size_t header_size_;
+};
+
+}  // namespace barefoot
+}  // namespace hal
+}  // namespace stratum
+
+#endif  // STRATUM_HAL_LIB_BAREFOOT_BFRT_PACKET_METADATA_CODEC_H_
@@ -0,0 +1,171 @@
+// Copyright 2020-present Open Networking Foundation
+// SPDX-License-Identifier: Apache-2.0
+
+// Benchmarks parsing PacketIn and deparsing PacketOut metadata headers with
+// BfrtPacketMetadataCodec, against the bit-per-byte deque that
+// BfrtPacketioManager used before (the Legacy benchmarks). The argument picks
+// one of the header layouts below; the payload is a 64 byte packet.
+
+#include <algorithm>
+#include <deque>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+#include "p4/v1/p4runtime.pb.h"
+#include "stratum/glue/logging.h"
+#include "stratum/hal/lib/barefoot/bfrt_packet_metadata_codec.h"
+
+namespace stratum {
+namespace hal {
+namespace barefoot {
+namespace {
+
+// (metadata ID, bit width) fields of the header layouts.
+const std::vector<std::vector<std::pair<uint32, int>>>& Layouts() {
+  static const auto* layouts =
+      new std::vector<std::vector<std::pair<uint32, int>>>{
+          // fabric.p4 packet_in: ingress_port and padding.
+          {{1, 9}, {2, 7}},
+          // fabric.p4 packet_out: egress_port, cpu_loopback_mode, padding
+          // and ether type.
+          {{1, 9}, {2, 2}, {3, 85}, {4, 16}},
+          // A header with a 128-bit field.
+          {{1, 9}, {2, 7}, {3, 32}, {4, 128}},
+      };
+  return *layouts;
+}
+
+class LegacyBitBuffer {
+ public:
+  void PushBack(const std::string& bytestring, size_t bitwidth) {
+    std::deque<uint8> new_bits;
+    for (const uint8 c : bytestring) {
+      for (int b = 7; b >= 0; --b) new_bits.push_back((c >> b) & 1u);
+    }
+    while (new_bits.size() > bitwidth) new_bits.pop_front();
+    while (new_bits.size() < bitwidth) new_bits.push_front(0);
+    bits_.insert(bits_.end(), new_bits.begin(), new_bits.end());
+  }
+
+  std::string PopField(size_t bitwidth) {
+    std::string out;
+    uint8 byte_val = 0;
+    for (int bit = bitwidth - 1; bit >= 0; --bit) {
+      byte_val <<= 1;
+      byte_val |= bits_.front();
+      bits_.pop_front();
+      if (!(bit % 8)) {
+        out.push_back(byte_val);
+        byte_val = 0;
+      }
+    }
+    return out;
+  }
+
+  std::string PopAll() { return PopField(bits_.size()); }
+
+ private:
+  std::deque<uint8> bits_;
+};
+
+::p4::v1::PacketOut MakePacketOut(
+    const std::vector<std::pair<uint32, int>>& layout) {
+  ::p4::v1::PacketOut packet;
+  packet.set_payload(std::string(64, 'x'));
+  for (const auto& p : layout) {
+    auto* metadata = packet.add_metadata();
+    metadata->set_metadata_id(p.first);
+    metadata->set_value(std::string((p.second + 7) / 8, '\x01'));
+  }
+  return packet;
+}
+
+std::string MakePacketIn(const std::vector<std::pair<uint32, int>>& layout) {
+  BfrtPacketMetadataCodec codec;
+  CHECK_OK(codec.Initialize(layout));
+  std::string buffer;
+  CHECK_OK(codec.Deparse(MakePacketOut(layout), &buffer));
+  return buffer;
+}
+
+void BM_Deparse(benchmark::State& state) {
+  const auto& layout = Layouts()[state.range(0)];
+  BfrtPacketMetadataCodec codec;
+  CHECK_OK(codec.Initialize(layout));
+  const auto packet = MakePacketOut(layout);
+  std::string buffer;
+  for (auto _ : state) {
+    CHECK_OK(codec.Deparse(packet, &buffer));
+    benchmark::DoNotOptimize(buffer.data());
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_Deparse)->DenseRange(0, 2);
+
+void BM_DeparseLegacy(benchmark::State& state) {
+  const auto& layout = Layouts()[state.range(0)];
+  const auto packet = MakePacketOut(layout);
+  std::string buffer;
+  for (auto _ : state) {
+    LegacyBitBuffer bit_buf;
+    for (const auto& p : layout) {
+      auto it = std::find_if(packet.metadata().begin(), packet.metadata().end(),
+                             [&p](::p4::v1::PacketMetadata metadata) {
+                               return metadata.metadata_id() == p.first;
+                             });
+      bit_buf.PushBack(it->value(), p.second);
+    }
+    auto hdr_buf = bit_buf.PopAll();
+    buffer.resize(0);
+    buffer.insert(buffer.end(), hdr_buf.begin(), hdr_buf.end());
+    buffer.insert(buffer.end(), packet.payload().begin(),
+                  packet.payload().end());
+    benchmark::DoNotOptimize(buffer.data());
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_DeparseLegacy)->DenseRange(0, 2);
+
+void BM_Parse(benchmark::State& state) {
+  const auto& layout = Layouts()[state.range(0)];
+  BfrtPacketMetadataCodec codec;
+  CHECK_OK(codec.Initialize(layout));
+  const std::string buffer = MakePacketIn(layout);
+  ::p4::v1::PacketIn packet;
+  for (auto _ : state) {
+    CHECK_OK(codec.Parse(buffer, &packet));
+    benchmark::DoNotOptimize(packet);
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_Parse)->DenseRange(0, 2);
+
+void BM_ParseLegacy(benchmark::State& state) {
+  const auto& layout = Layouts()[state.range(0)];
+  const std::string buffer = MakePacketIn(layout);
+  size_t header_size = 0;
+  for (const auto& p : layout) header_size += p.second;
+  header_size /= 8;
+  for (auto _ : state) {
+    ::p4::v1::PacketIn packet;
+    LegacyBitBuffer bit_buf;
+    bit_buf.PushBack(buffer.substr(0, header_size), header_size * 8);
+    for (const auto& p : layout) {
+      auto metadata = packet.add_metadata();
+      metadata->set_metadata_id(p.first);
+      metadata->set_value(bit_buf.PopField(p.second));
+    }
+    packet.set_payload(buffer.data() + header_size,
+                       buffer.size() - header_size);
+    benchmark::DoNotOptimize(packet);
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_ParseLegacy)->DenseRange(0, 2);
+
+}  // namespace
+}  // namespace barefoot
+}  // namespace hal
+}  // namespace stratum
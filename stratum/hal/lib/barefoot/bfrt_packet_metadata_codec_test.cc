@@ -0,0 +1,168 @@
+// Copyright 2020-present Open Networking Foundation
+// SPDX-License-Identifier: Apache-2.0
+
+#include "stratum/hal/lib/barefoot/bfrt_packet_metadata_codec.h"
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "p4/v1/p4runtime.pb.h"
+#include "stratum/glue/status/status_test_util.h"
+#include "stratum/lib/test_utils/matchers.h"
+#include "stratum/lib/utils.h"
+
+using ::stratum::test_utils::EqualsProto;
+using ::testing::HasSubstr;
+
+namespace stratum {
+namespace hal {
+namespace barefoot {
+
+TEST(BfrtPacketMetadataCodecTest, InitializeRejectsPartialByteHeader) {
+  BfrtPacketMetadataCodec codec;
+  ::util::Status status = codec.Initialize({{1, 9}, {2, 6}});
+  EXPECT_FALSE(status.ok());
+  EXPECT_THAT(status.error_message(), HasSubstr("multiple of 8 bits"));
+}
+
+TEST(BfrtPacketMetadataCodecTest, ParseFabricPacketIn) {
+  BfrtPacketMetadataCodec codec;
+  ASSERT_OK(codec.Initialize({{1, 9}, {2, 7}}));
+  EXPECT_EQ(2, codec.header_size());
+
+  const char expected_packet_in_str[] = R"PROTO(
+    payload: "abcde"
+    metadata {
+      metadata_id: 1
+      value: "\001\177"
+    }
+    metadata {
+      metadata_id: 2
+      value: "\001"
+    }
+  )PROTO";
+  ::p4::v1::PacketIn expected_packet_in;
+  ASSERT_OK(ParseProtoFromString(expected_packet_in_str, &expected_packet_in));
+
+  // The packet is parsed twice to check the reuse of its metadata.
+  ::p4::v1::PacketIn packet_in;
+  for (int i = 0; i < 2; ++i) {
+    ASSERT_OK(codec.Parse(std::string("\xBF\x81"
+                                      "abcde",
+                                      7),
+                          &packet_in));
+    EXPECT_THAT(packet_in, EqualsProto(expected_packet_in));
+  }
+}
+
+TEST(BfrtPacketMetadataCodecTest, ParseTooSmallPacket) {
+  BfrtPacketMetadataCodec codec;
+  ASSERT_OK(codec.Initialize({{1, 9}, {2, 7}}));
+  ::p4::v1::PacketIn packet_in;
+  ::util::Status status = codec.Parse(std::string("\x01", 1), &packet_in);
+  EXPECT_FALSE(status.ok());
+  EXPECT_THAT(status.error_message(), HasSubstr("too small"));
+}
+
+// Fields wider than one 64-bit word are copied in several chunks.
+TEST(BfrtPacketMetadataCodecTest, WideFieldsRoundTrip) {
+  BfrtPacketMetadataCodec codec;
+  ASSERT_OK(codec.Initialize({{1, 3}, {2, 128}, {3, 61}}));
+  EXPECT_EQ(24, codec.header_size());
+
+  ::p4::v1::PacketOut packet_out;
+  packet_out.set_payload("payload");
+  auto* metadata = packet_out.add_metadata();
+  metadata->set_metadata_id(3);
+  metadata->set_value(std::string("\x1F\xEE\xDD\xCC\xBB\xAA\x99\x88", 8));
+  metadata = packet_out.add_metadata();
+  metadata->set_metadata_id(1);
+  metadata->set_value("\x05");
+  metadata = packet_out.add_metadata();
+  metadata->set_metadata_id(2);
+  metadata->set_value(std::string("\x80\x01\x02\x03\x04\x05\x06\x07"
+                                  "\x08\x09\x0A\x0B\x0C\x0D\x0E\xFF",
+                                  16));
+  std::string buffer;
+  ASSERT_OK(codec.Deparse(packet_out, &buffer));
+  EXPECT_EQ(24 + packet_out.payload().size(), buffer.size());
+
+  ::p4::v1::PacketIn packet_in;
+  ASSERT_OK(codec.Parse(buffer, &packet_in));
+  EXPECT_EQ(packet_out.payload(), packet_in.payload());
+  ASSERT_EQ(3, packet_in.metadata_size());
+  EXPECT_EQ(1, packet_in.metadata(0).metadata_id());
+  EXPECT_EQ("\x05", packet_in.metadata(0).value());
+  EXPECT_EQ(2, packet_in.metadata(1).metadata_id());
+  EXPECT_EQ(packet_out.metadata(2).value(), packet_in.metadata(1).value());
+  EXPECT_EQ(3, packet_in.metadata(2).metadata_id());
+  EXPECT_EQ(packet_out.metadata(0).value(), packet_in.metadata(2).value());
+}
+
+TEST(BfrtPacketMetadataCodecTest, DeparsePadsShortValues) {
+  BfrtPacketMetadataCodec codec;
+  ASSERT_OK(codec.Initialize({{1, 4}, {2, 20}}));
+  ::p4::v1::PacketOut packet_out;
+  auto* metadata = packet_out.add_metadata();
+  metadata->set_metadata_id(1);
+  metadata->set_value("\x0A");
+  metadata = packet_out.add_metadata();
+  metadata->set_metadata_id(2);
+  metadata->set_value("\x12");
+  std::string buffer;
+  ASSERT_OK(codec.Deparse(packet_out, &buffer));
+  EXPECT_EQ(std::string("\xA0\x00\x12", 3), buffer);
+}
+
+TEST(BfrtPacketMetadataCodecTest, DeparseHeaderOnly) {
+  BfrtPacketMetadataCodec codec;
+  ASSERT_OK(codec.Initialize({{1, 9}, {2, 7}}));
+  ::p4::v1::PacketOut packet_out;
+  packet_out.set_payload("abcde");
+  auto* metadata = packet_out.add_metadata();
+  metadata->set_metadata_id(1);
+  metadata->set_value("\x01");
+  metadata = packet_out.add_metadata();
+  metadata->set_metadata_id(2);
+  metadata->set_value("\x00");
+  std::string header;
+  ASSERT_OK(codec.DeparseHeader(packet_out, &header));
+  EXPECT_EQ(std::string("\0\x80", 2), header);
+}
+
+TEST(BfrtPacketMetadataCodecTest, DeparseValueOverflowingBitWidth) {
+  BfrtPacketMetadataCodec codec;
+  ASSERT_OK(codec.Initialize({{1, 9}, {2, 7}}));
+  ::p4::v1::PacketOut packet_out;
+  auto* metadata = packet_out.add_metadata();
+  metadata->set_metadata_id(1);
+  metadata->set_value("\x02\x00");
+  metadata = packet_out.add_metadata();
+  metadata->set_metadata_id(2);
+  metadata->set_value("\x00");
+  std::string buffer;
+  ::util::Status status = codec.Deparse(packet_out, &buffer);
+  EXPECT_FALSE(status.ok());
+  EXPECT_THAT(status.error_message(), HasSubstr("overflows bit width 9"));
+}
+
+TEST(BfrtPacketMetadataCodecTest, DeparseMissingMetadata) {
+  BfrtPacketMetadataCodec codec;
+  ASSERT_OK(codec.Initialize({{1, 9}, {2, 7}}));
+  ::p4::v1::PacketOut packet_out;
+  auto* metadata = packet_out.add_metadata();
+  metadata->set_metadata_id(1);
+  metadata->set_value("\x01");
+  std::string buffer;
+  ::util::Status status = codec.Deparse(packet_out, &buffer);
+  EXPECT_FALSE(status.ok());
+  EXPECT_THAT(status.error_message(),
+              HasSubstr("Missing metadata with Id 2 in PacketOut"));
+}
+
+}  // namespace barefoot
+}  // namespace hal
+}  // namespace stratum
@@ -9,25 +9,40 @@
 #include <sys/socket.h>
 #include <unistd.h>
 
-#include <deque>
+#include <algorithm>
 #include <string>
+#include <vector>
 
+#include "absl/strings/str_cat.h"
 #include "stratum/glue/gtl/cleanup.h"
 #include "stratum/glue/gtl/map_util.h"
 #include "stratum/hal/lib/common/constants.h"
 #include "stratum/lib/utils.h"
+#include "stratum/public/lib/error.h"
 
 namespace stratum {
 namespace hal {
 namespace barefoot {
 
+namespace {
+
+// Depth of the Channel carrying the received packets from the SDE callback to
+// the RX thread, which reads at most this many packets per batch.
+constexpr size_t kPacketRxChannelDepth = 1024;
+
+// The buffer pool holds enough buffers for a full Channel plus the batch that
+// the RX thread is parsing. Each buffer is preallocated for a full size
+// Ethernet frame and grows if a larger packet is copied into it.
+constexpr size_t kPacketRxBufferPoolSize = 2 * kPacketRxChannelDepth;
+constexpr size_t kPacketRxBufferSize = 2048;
+
+}  // namespace
+
 BfrtPacketioManager::BfrtPacketioManager(int device,
                                          BfSdeInterface* bf_sde_interface)
     : initialized_(false),
-      packetin_header_(),
-      packetout_header_(),
-      packetin_header_size_(),
-      packetout_header_size_(),
+      packetin_codec_(),
+      packetout_codec_(),
       sde_rx_thread_id_(0),
       bf_sde_interface_(ABSL_DIE_IF_NULL(bf_sde_interface)),
       device_(device) {}
@@ -55,7 +70,17 @@ std::unique_ptr<BfrtPacketioManager> BfrtPacketioManager::CreateInstance(
     // PushForwardingPipelineConfig resets the bf_pkt driver.
     RETURN_IF_ERROR(bf_sde_interface_->StartPacketIo(device_));
     if (!initialized_) {
-      packet_receive_channel_ = Channel<std::string>::Create(128);
+      packet_receive_channel_ = Channel<std::string>::Create(
+          kPacketRxChannelDepth, ChannelImpl::kLockFreeRing);
+      packet_rx_buffer_pool_ = Channel<std::string>::Create(
+          kPacketRxBufferPoolSize, ChannelImpl::kLockFreeRing);
+      auto buffer_pool_writer =
+          ChannelWriter<std::string>::Create(packet_rx_buffer_pool_);
+      for (size_t i = 0; i < kPacketRxBufferPoolSize; ++i) {
+        std::string buffer;
+        buffer.reserve(kPacketRxBufferSize);
+        RETURN_IF_ERROR(buffer_pool_writer->TryWrite(std::move(buffer)));
+      }
       if (sde_rx_thread_id_ == 0) {
         int ret = pthread_create(&sde_rx_thread_id_, nullptr,
                                  &BfrtPacketioManager::SdeRxThreadFunc, this);
@@ -68,6 +93,8 @@ std::unique_ptr<BfrtPacketioManager> BfrtPacketioManager::CreateInstance(
       RETURN_IF_ERROR(bf_sde_interface_->RegisterPacketReceiveWriter(
           device_,
           ChannelWriter<std::string>::Create(packet_receive_channel_)));
+      RETURN_IF_ERROR(bf_sde_interface_->RegisterPacketReceiveBufferPool(
+          device_, packet_rx_buffer_pool_));
     }
     initialized_ = true;
   }
@@ -90,16 +117,16 @@ std::unique_ptr<BfrtPacketioManager> BfrtPacketioManager::CreateInstance(
   }
   {
     absl::WriterMutexLock l(&data_lock_);
-    packetin_header_.clear();
-    packetout_header_.clear();
-    packetin_header_size_ = 0;
-    packetout_header_size_ = 0;
+    packetin_codec_.Clear();
+    packetout_codec_.Clear();
     if (!packet_receive_channel_ || !packet_receive_channel_->Close()) {
       ::util::Status error = MAKE_ERROR(ERR_INTERNAL)
                              << "Packet Rx channel is already closed.";
       APPEND_STATUS_IF_ERROR(status, error);
     }
     packet_receive_channel_.reset();
+    if (packet_rx_buffer_pool_) packet_rx_buffer_pool_->Close();
+    packet_rx_buffer_pool_.reset();
     initialized_ = false;
   }
   {
@@ -131,132 +158,30 @@ std::unique_ptr<BfrtPacketioManager> BfrtPacketioManager::CreateInstance(
   return ::util::OkStatus();
 }
 
-namespace {
-// BitBuffer implements a helper class for parsing and deparsing packet headers.
-class BitBuffer {
- public:
-  BitBuffer() = default;
-
-  // Add a bytestring to the back of the buffer.
-  ::util::Status PushBack(const std::string& bytestring, size_t bitwidth) {
-    CHECK_RETURN_IF_FALSE(bytestring.size() <=
-                          (bitwidth + kBitsPerByte - 1) / kBitsPerByte)
-        << "Bytestring " << StringToHex(bytestring) << " overflows bit width "
-        << bitwidth << ".";
-
-    // Push all bits to a new buffer.
-    std::deque<uint8> new_bits;
-    for (const uint8 c : bytestring) {
-      new_bits.push_back((c >> 7) & 1u);
-      new_bits.push_back((c >> 6) & 1u);
-      new_bits.push_back((c >> 5) & 1u);
-      new_bits.push_back((c >> 4) & 1u);
-      new_bits.push_back((c >> 3) & 1u);
-      new_bits.push_back((c >> 2) & 1u);
-      new_bits.push_back((c >> 1) & 1u);
-      new_bits.push_back((c >> 0) & 1u);
-    }
-    // Remove bits from partial byte at the front.
-    while (new_bits.size() > bitwidth) {
-      CHECK_RETURN_IF_FALSE(new_bits.front() == 0)
-          << "Bytestring " << StringToHex(bytestring) << " overflows bit width "
-          << bitwidth << ".";
-      new_bits.pop_front();
-    }
-    // Pad to full width.
-    while (new_bits.size() < bitwidth) {
-      new_bits.push_front(0);
-    }
-    // Append to internal buffer.
-    bits_.insert(bits_.end(), new_bits.begin(), new_bits.end());
-
-    return ::util::OkStatus();
-  }
-
-  // Removes and returns a field from the front of the buffer.
-  std::string PopField(size_t bitwidth) {
-    CHECK_LE(bitwidth, bits_.size());
-    std::string out;
-    uint8 byte_val = 0;
-    for (int bit = bitwidth - 1; bit >= 0; --bit) {
-      byte_val <<= 1;
-      byte_val |= bits_.front();
-      bits_.pop_front();
-      if (!(bit % 8)) {
-        out.push_back(byte_val);
-        byte_val = 0;
-      }
-    }
-    return out;
-  }
-
-  // Returns and empties the entire buffer.
-  std::string PopAll(void) {
-    CHECK_EQ(bits_.size() % 8, 0);
-    return PopField(bits_.size());
-  }
-
-  // Returns a human-readable representation of the buffer.
-  std::string ToString() {
-    std::string ret;
-    for (size_t i = 0; i < bits_.size(); ++i) {
-      if (i % 8 == 0) ret += " ";
-      ret += std::to_string(static_cast<uint16>(bits_[i]));
-    }
-    return ret;
-  }
-
- private:
-  const int kBitsPerByte = 8;
-  std::deque<uint8> bits_;
-};
-}  // namespace
-
-::util::Status BfrtPacketioManager::DeparsePacketOut(
-    const ::p4::v1::PacketOut& packet, std::string* buffer) {
+::util::Status BfrtPacketioManager::DeparsePacketOutHeader(
+    const ::p4::v1::PacketOut& packet, std::string* header) {
   absl::ReaderMutexLock l(&data_lock_);
-  BitBuffer bit_buf;
-  for (const auto& p : packetout_header_) {
-    const auto id = p.first;
-    const auto bitwidth = p.second;
-    auto it = std::find_if(packet.metadata().begin(), packet.metadata().end(),
-                           [&id](::p4::v1::PacketMetadata metadata) {
-                             return metadata.metadata_id() == id;
-                           });
-    CHECK_RETURN_IF_FALSE(it != packet.metadata().end())
-        << "Missing metadata with Id " << id << " in PacketOut "
-        << packet.ShortDebugString();
-    RETURN_IF_ERROR(bit_buf.PushBack(it->value(), bitwidth));
-    VLOG(1) << "Encoded PacketOut metadata field with id " << id << " bitwidth "
-            << bitwidth << " value 0x" << StringToHex(it->value());
-  }
-  auto hdr_buf = bit_buf.PopAll();
-  buffer->resize(0);
-  buffer->insert(buffer->end(), hdr_buf.begin(), hdr_buf.end());
-  buffer->insert(buffer->end(), packet.payload().begin(),
-                 packet.payload().end());
-
-  return ::util::OkStatus();
+  return packetout_codec_.DeparseHeader(packet, header);
 }
 
-::util::Status BfrtPacketioManager::ParsePacketIn(const std::string& buffer,
-                                                  ::p4::v1::PacketIn* packet) {
+size_t BfrtPacketioManager::ParsePacketIns(
+    const std::vector<std::string>& buffers,
+    std::vector<::p4::v1::PacketIn>* packets) {
   absl::ReaderMutexLock l(&data_lock_);
-  CHECK_RETURN_IF_FALSE(buffer.size() >= packetin_header_size_)
-      << "Received packet is too small.";
-
-  BitBuffer bit_buf;
-  RETURN_IF_ERROR(bit_buf.PushBack(buffer.substr(0, packetin_header_size_),
-                                   packetin_header_size_ * 8));
-  for (const auto& p : packetin_header_) {
-    auto metadata = packet->add_metadata();
-    metadata->set_metadata_id(p.first);
-    metadata->set_value(bit_buf.PopField(p.second));
+  if (packets->size() < buffers.size()) packets->resize(buffers.size());
+  size_t num_parsed = 0;
+  for (const auto& buffer : buffers) {
+    ::util::Status status =
+        packetin_codec_.Parse(buffer, &(*packets)[num_parsed]);
+    if (!status.ok()) {
+      LOG_EVERY_N(ERROR, 500) << "Dropped packet received from CPU: "
+                              << status.error_message();
+      continue;
+    }
+    ++num_parsed;
   }
-  packet->set_payload(buffer.data() + packetin_header_size_,
-                      buffer.size() - packetin_header_size_);
 
-  return ::util::OkStatus();
+  return num_parsed;
 }
 
 ::util::Status BfrtPacketioManager::TransmitPacket(
@@ -265,44 +190,140 @@ class BitBuffer {
     absl::ReaderMutexLock l(&data_lock_);
     if (!initialized_) RETURN_ERROR(ERR_NOT_INITIALIZED) << "Not initialized.";
   }
-  std::string buf;
-  RETURN_IF_ERROR(DeparsePacketOut(packet, &buf));
-
-  RETURN_IF_ERROR(bf_sde_interface_->TxPacket(device_, buf));
+  // Only the header is deparsed here, the SDE copies the payload straight from
+  // the PacketOut into its TX buffer.
+  std::string header;
+  ::util::Status status = DeparsePacketOutHeader(packet, &header);
+  if (!status.ok()) {
+    absl::MutexLock l(&tx_stats_lock_);
+    tx_stats_.num_dropped_deparse_error++;
+    return status;
+  }
+  status = bf_sde_interface_->TxPacket(device_, header, packet.payload());
+
+  absl::MutexLock l(&tx_stats_lock_);
+  if (status.ok()) {
+    tx_stats_.num_packets++;
+  } else if (status.error_code() == ERR_NO_RESOURCE) {
+    tx_stats_.num_dropped_no_buffer++;
+  } else {
+    tx_stats_.num_dropped_tx_error++;
+  }
 
-  return ::util::OkStatus();
+  return status;
 }
 
 // TODO(max): drop Sde in name?
 ::util::Status BfrtPacketioManager::HandleSdePacketRx() {
   std::unique_ptr<ChannelReader<std::string>> reader;
+  std::unique_ptr<ChannelWriter<std::string>> buffer_pool_writer;
   {
     absl::ReaderMutexLock l(&data_lock_);
     if (!initialized_) RETURN_ERROR(ERR_NOT_INITIALIZED) << "Not initialized.";
     reader = ChannelReader<std::string>::Create(packet_receive_channel_);
+    buffer_pool_writer =
+        ChannelWriter<std::string>::Create(packet_rx_buffer_pool_);
   }
 
+  // The buffers of a batch and the PacketIns they are parsed into. Both are
+  // reused across batches, so that the metadata and payload fields of the
+  // PacketIns keep their memory.
+  std::vector<std::string> buffers;
+  std::vector<::p4::v1::PacketIn> packets;
   while (true) {
-    std::string buffer;
-    int code = reader->Read(&buffer, absl::InfiniteDuration()).error_code();
+    int code = reader->ReadAll(&buffers, absl::InfiniteDuration()).error_code();
     if (code == ERR_CANCELLED) break;
     if (code == ERR_ENTRY_NOT_FOUND) {
       LOG(ERROR) << "Read with infinite timeout failed with ENTRY_NOT_FOUND.";
       continue;
     }
+    const absl::Time start_time = absl::Now();
+
+    const size_t num_parsed = ParsePacketIns(buffers, &packets);
+    for (auto& buffer : buffers) {
+      buffer_pool_writer->TryWrite(std::move(buffer)).IgnoreError();
+    }
 
-    ::p4::v1::PacketIn packet_in;
-    RETURN_IF_ERROR(ParsePacketIn(buffer, &packet_in));
+    size_t num_written = 0;
     {
       absl::WriterMutexLock l(&rx_writer_lock_);
-      rx_writer_->Write(packet_in);
+      if (rx_writer_) {
+        for (size_t i = 0; i < num_parsed; ++i) {
+          if (rx_writer_->Write(packets[i])) ++num_written;
+        }
+      }
     }
-    VLOG(1) << "Handled PacketIn: " << packet_in.ShortDebugString();
+    if (VLOG_IS_ON(1)) {
+      for (size_t i = 0; i < num_parsed; ++i) {
+        VLOG(1) << "Handled PacketIn: " << packets[i].ShortDebugString();
+      }
+    }
+
+    const absl::Duration batch_time = absl::Now() - start_time;
+    absl::MutexLock l(&rx_stats_lock_);
+    rx_stats_.num_batches++;
+    rx_stats_.num_packets += num_written;
+    rx_stats_.max_batch_size =
+        std::max<uint64>(rx_stats_.max_batch_size, buffers.size());
+    rx_stats_.num_dropped_parse_error += buffers.size() - num_parsed;
+    rx_stats_.num_dropped_write_failure += num_parsed - num_written;
+    rx_stats_.total_batch_time += batch_time;
+    rx_stats_.max_batch_time = std::max(rx_stats_.max_batch_time, batch_time);
   }
 
   return ::util::OkStatus();
 }
 
+BfrtPacketioManager::PacketRxStats BfrtPacketioManager::GetPacketRxStats()
+    const {
+  PacketRxStats stats;
+  {
+    absl::MutexLock l(&rx_stats_lock_);
+    stats = rx_stats_;
+  }
+  stats.sde = bf_sde_interface_->GetPacketRxStats(device_);
+  return stats;
+}
+
+BfrtPacketioManager::PacketTxStats BfrtPacketioManager::GetPacketTxStats()
+    const {
+  PacketTxStats stats;
+  {
+    absl::MutexLock l(&tx_stats_lock_);
+    stats = tx_stats_;
+  }
+  stats.sde = bf_sde_interface_->GetPacketTxStats(device_);
+  return stats;
+}
+
+std::string BfrtPacketioManager::GetPacketIoDebugString() const {
+  const PacketRxStats rx = GetPacketRxStats();
+  const PacketTxStats tx = GetPacketTxStats();
+  const double tx_mean_completion_us =
+      tx.sde.num_completed > 0
+          ? absl::ToDoubleMicroseconds(tx.sde.total_completion_time) /
+                tx.sde.num_completed
+          : 0;
+  return absl::StrCat(
+      "rx_packets: ", rx.num_packets, " rx_batches: ", rx.num_batches,
+      " rx_max_batch_size: ", rx.max_batch_size,
+      " rx_dropped_no_writer: ", rx.sde.num_dropped_no_writer,
+      " rx_dropped_no_buffer: ", rx.sde.num_dropped_no_buffer,
+      " rx_dropped_channel_full: ", rx.sde.num_dropped_channel_full,
+      " rx_dropped_parse_error: ", rx.num_dropped_parse_error,
+      " rx_dropped_write_failure: ", rx.num_dropped_write_failure,
+      " tx_packets: ", tx.num_packets, " tx_completed: ", tx.sde.num_completed,
+      " tx_completion_errors: ", tx.sde.num_completion_errors,
+      " tx_in_flight: ", tx.sde.num_in_flight,
+      " tx_dropped_deparse_error: ", tx.num_dropped_deparse_error,
+      " tx_dropped_no_buffer: ", tx.num_dropped_no_buffer,
+      " tx_dropped_tx_error: ", tx.num_dropped_tx_error,
+      " tx_rate_pps: ", tx.sde.tx_rate_pps,
+      " tx_mean_completion_us: ", tx_mean_completion_us,
+      " tx_max_completion_us: ",
+      absl::ToDoubleMicroseconds(tx.sde.max_completion_time));
+}
+
 // This function is based on P4TableMapper and implements a subset of its
 // functionality.
 // TODO(max): Check and reject if a mapping cannot be handled at runtime
@@ -338,10 +359,12 @@ class BitBuffer {
       << "PacketIn header size must be multiple of 8 bits.";
   CHECK_RETURN_IF_FALSE(packetout_bits % 8 == 0)
       << "PacketOut header size must be multiple of 8 bits.";
-  packetin_header_ = std::move(packetin_header);
-  packetout_header_ = std::move(packetout_header);
-  packetin_header_size_ = packetin_bits / 8;
-  packetout_header_size_ = packetout_bits / 8;
+  BfrtPacketMetadataCodec packetin_codec;
+  BfrtPacketMetadataCodec packetout_codec;
+  RETURN_IF_ERROR(packetin_codec.Initialize(packetin_header));
+  RETURN_IF_ERROR(packetout_codec.Initialize(packetout_header));
+  packetin_codec_ = std::move(packetin_codec);
+  packetout_codec_ = std::move(packetout_codec);
 
   return ::util::OkStatus();
 }
@@ -13,10 +13,12 @@
 #include "absl/container/flat_hash_map.h"
 #include "absl/memory/memory.h"
 #include "absl/synchronization/mutex.h"
+#include "absl/time/time.h"
 #include "p4/v1/p4runtime.pb.h"
 #include "stratum/glue/status/status.h"
 #include "stratum/hal/lib/barefoot/bf.pb.h"
 #include "stratum/hal/lib/barefoot/bf_sde_interface.h"
+#include "stratum/hal/lib/barefoot/bfrt_packet_metadata_codec.h"
 #include "stratum/hal/lib/common/common.pb.h"
 #include "stratum/hal/lib/common/writer_interface.h"
 #include "stratum/lib/utils.h"
@@ -27,6 +29,44 @@ namespace barefoot {
 
 class BfrtPacketioManager {
  public:
+  // PacketRxStats counts the packets received from the SDE at each stage of
+  // the RX path: the SDE callback copying the packets into buffers, and the
+  // RX thread parsing batches of buffers into PacketIns and handing them to
+  // the registered writer.
+  struct PacketRxStats {
+    // Counters of the SDE callback.
+    BfSdeInterface::PacketRxStats sde;
+    // Number of batches read by the RX thread and of PacketIns handed to the
+    // writer.
+    uint64 num_batches = 0;
+    uint64 num_packets = 0;
+    // Size of the largest batch read so far.
+    uint64 max_batch_size = 0;
+    // Number of packets dropped because they could not be parsed, and because
+    // no writer was registered or the write failed.
+    uint64 num_dropped_parse_error = 0;
+    uint64 num_dropped_write_failure = 0;
+    // Time from a batch being read to all of its PacketIns being handed to
+    // the writer, summed over all the batches and the maximum of it.
+    absl::Duration total_batch_time = absl::ZeroDuration();
+    absl::Duration max_batch_time = absl::ZeroDuration();
+  };
+
+  // PacketTxStats counts the PacketOuts handed to this class and the packets
+  // transmitted by the SDE.
+  struct PacketTxStats {
+    // Counters of the SDE TX buffers and completions.
+    BfSdeInterface::PacketTxStats sde;
+    // Number of PacketOuts handed to the SDE.
+    uint64 num_packets = 0;
+    // Number of PacketOuts dropped because they could not be deparsed, because
+    // all the SDE TX buffers were in flight, and because the SDE failed to
+    // transmit them.
+    uint64 num_dropped_deparse_error = 0;
+    uint64 num_dropped_no_buffer = 0;
+    uint64 num_dropped_tx_error = 0;
+  };
+
   virtual ~BfrtPacketioManager();
 
   // Pushes the parts of the given ChassisConfig proto that this class cares
@@ -61,9 +101,22 @@ class BfrtPacketioManager {
   virtual ::util::Status UnregisterPacketReceiveWriter()
       LOCKS_EXCLUDED(rx_writer_lock_);
 
-  // Transmits a packet to the PCIe interface.
+  // Transmits a packet to the PCIe interface. The transmission completes
+  // asynchronously. Returns ERR_NO_RESOURCE if the packet is dropped because
+  // too many packets are being transmitted already.
   virtual ::util::Status TransmitPacket(const ::p4::v1::PacketOut& packet)
-      LOCKS_EXCLUDED(data_lock_);
+      LOCKS_EXCLUDED(data_lock_, tx_stats_lock_);
+
+  // Returns the counters of the received packets.
+  virtual PacketRxStats GetPacketRxStats() const LOCKS_EXCLUDED(rx_stats_lock_);
+
+  // Returns the counters of the transmitted packets.
+  virtual PacketTxStats GetPacketTxStats() const LOCKS_EXCLUDED(tx_stats_lock_);
+
+  // Returns a human readable summary of the RX and TX counters, reported as
+  // the packet IO debug string of the node.
+  virtual std::string GetPacketIoDebugString() const
+      LOCKS_EXCLUDED(rx_stats_lock_, tx_stats_lock_);
 
   // Factory function for creating the instance of the class.
   static std::unique_ptr<BfrtPacketioManager> CreateInstance(
@@ -87,20 +140,24 @@ class BfrtPacketioManager {
   ::util::Status BuildMetadataMapping(const p4::config::v1::P4Info& p4_info)
       EXCLUSIVE_LOCKS_REQUIRED(data_lock_);
 
-  // Deparses a PacketOut into the buffer by serializing the metadata fields in
-  // front of the payload.
-  ::util::Status DeparsePacketOut(const ::p4::v1::PacketOut& packet,
-                                  std::string* buffer)
+  // Deparses the metadata fields of a PacketOut into the header that goes in
+  // front of its payload.
+  ::util::Status DeparsePacketOutHeader(const ::p4::v1::PacketOut& packet,
+                                        std::string* header)
       LOCKS_EXCLUDED(data_lock_);
 
-  // Parses a binary string into a PacketIn, filling the metadata fields.
-  ::util::Status ParsePacketIn(const std::string& buffer,
-                               ::p4::v1::PacketIn* packet)
+  // Parses a batch of binary strings into PacketIns, filling the metadata
+  // fields. The PacketIns of the packets that are parsed successfully are
+  // stored at the front of packets, which is grown as needed and otherwise
+  // reused across batches. Returns the number of parsed packets.
+  size_t ParsePacketIns(const std::vector<std::string>& buffers,
+                        std::vector<::p4::v1::PacketIn>* packets)
       LOCKS_EXCLUDED(data_lock_);
 
-  // Handles a received packets and hands it over the registered receive writer.
+  // Handles the received packets in batches and hands them over the registered
+  // receive writer.
   ::util::Status HandleSdePacketRx()
-      LOCKS_EXCLUDED(data_lock_, rx_writer_lock_);
+      LOCKS_EXCLUDED(data_lock_, rx_writer_lock_, rx_stats_lock_);
 
   // SDE cpu interface RX thread function.
   static void* SdeRxThreadFunc(void* arg);
@@ -111,6 +168,12 @@ class BfrtPacketioManager {
   // Mutex lock to protect the metadata mappings.
   mutable absl::Mutex data_lock_;
 
+  // Mutex lock for protecting rx_stats_.
+  mutable absl::Mutex rx_stats_lock_;
+
+  // Mutex lock for protecting tx_stats_.
+  mutable absl::Mutex tx_stats_lock_;
+
   // Initialized to false, set once only on first PushForwardingPipelineConfig.
   bool initialized_ GUARDED_BY(data_lock_);
 
@@ -118,17 +181,26 @@ class BfrtPacketioManager {
   std::shared_ptr<WriterInterface<::p4::v1::PacketIn>> rx_writer_
       GUARDED_BY(rx_writer_lock_);
 
-  // List of metadata id and bitwidth pairs. Stores the size and structure of
-  // the CPU packet headers.
-  std::vector<std::pair<uint32, int>> packetin_header_ GUARDED_BY(data_lock_);
-  std::vector<std::pair<uint32, int>> packetout_header_ GUARDED_BY(data_lock_);
-  size_t packetin_header_size_ GUARDED_BY(data_lock_);
-  size_t packetout_header_size_ GUARDED_BY(data_lock_);
+  // Codecs of the CPU packet headers, built from the metadata IDs and bit
+  // widths of the controller packet metadata in the P4Info.
+  BfrtPacketMetadataCodec packetin_codec_ GUARDED_BY(data_lock_);
+  BfrtPacketMetadataCodec packetout_codec_ GUARDED_BY(data_lock_);
 
   //
   std::shared_ptr<Channel<std::string>> packet_receive_channel_
       GUARDED_BY(data_lock_);
 
+  // Pool of the buffers that the SDE copies the received packets into. The RX
+  // thread writes the buffers back to the pool once their packets are parsed.
+  std::shared_ptr<Channel<std::string>> packet_rx_buffer_pool_
+      GUARDED_BY(data_lock_);
+
+  // Counters of the packets handled by the RX thread.
+  PacketRxStats rx_stats_ GUARDED_BY(rx_stats_lock_);
+
+  // Counters of the PacketOuts, without the SDE counters.
+  PacketTxStats tx_stats_ GUARDED_BY(tx_stats_lock_);
+
   //
   pthread_t sde_rx_thread_id_ GUARDED_BY(data_lock_);
 
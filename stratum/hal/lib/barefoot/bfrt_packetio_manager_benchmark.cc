@@ -0,0 +1,317 @@
+// Copyright 2020-present Open Networking Foundation
+// SPDX-License-Identifier: Apache-2.0
+
+// Benchmarks the Tofino packet RX and TX paths of BfrtPacketioManager on top
+// of the SDE mock. The SDE RX callback is emulated the way BfSdeWrapper::
+// HandlePacketRx() handles a bf_pkt: the packet is copied into a buffer from
+// the registered pool and written to the registered Channel, or dropped. The
+// packets are offered at the rate given by the argument, in packets per second
+// (0 sends them back to back), and every iteration sends kPacketsPerIteration
+// fabric.p4 PacketIns of 128 bytes and waits for the RX thread to hand them to
+// the writer. The counters report the delivered packets per second, the drops
+// of each stage and the mean batch size and batch handling time.
+//
+// The TX benchmark emulates BfSdeWrapper::TxPacket() the same way: the header
+// and payload of each PacketOut are copied into a buffer from a BfPacketTxPool,
+// and the packets in flight are completed in bursts as the TX completion
+// callback would.
+
+#include <string.h>
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/memory/memory.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "benchmark/benchmark.h"
+#include "gmock/gmock.h"
+#include "p4/v1/p4runtime.pb.h"
+#include "stratum/glue/logging.h"
+#include "stratum/hal/lib/barefoot/bf_packet_tx_pool.h"
+#include "stratum/hal/lib/barefoot/bf_sde_mock.h"
+#include "stratum/hal/lib/barefoot/bfrt_packetio_manager.h"
+#include "stratum/hal/lib/common/writer_interface.h"
+#include "stratum/lib/macros.h"
+#include "stratum/lib/utils.h"
+
+namespace stratum {
+namespace hal {
+namespace barefoot {
+namespace {
+
+using ::testing::_;
+using ::testing::Invoke;
+using ::testing::NiceMock;
+
+constexpr int kDevice = 0;
+constexpr int kPacketsPerIteration = 10000;
+constexpr size_t kPacketSize = 128;
+
+// Emulated TX rings and buffers, and the number of packets completed at once.
+constexpr int kNumTxRings = 4;
+constexpr int kTxBuffersPerRing = 64;
+constexpr size_t kTxBufferSize = 2048;
+constexpr size_t kTxCompletionBurst = 32;
+
+constexpr char kP4Info[] = R"PROTO(
+  controller_packet_metadata {
+    preamble { id: 67146229 name: "packet_in" }
+    metadata { id: 1 name: "ingress_port" bitwidth: 9 }
+    metadata { id: 2 name: "_pad0" bitwidth: 7 }
+  }
+  controller_packet_metadata {
+    preamble { id: 67121543 name: "packet_out" }
+    metadata { id: 1 name: "egress_port" bitwidth: 9 }
+    metadata { id: 2 name: "_pad0" bitwidth: 7 }
+  }
+)PROTO";
+
+// Counts the PacketIns handed to it by BfrtPacketioManager.
+class CountingWriter : public WriterInterface<::p4::v1::PacketIn> {
+ public:
+  bool Write(const ::p4::v1::PacketIn& msg) override {
+    num_packets_.fetch_add(1, std::memory_order_release);
+    return true;
+  }
+  int64 num_packets() const {
+    return num_packets_.load(std::memory_order_acquire);
+  }
+
+ private:
+  std::atomic<int64> num_packets_{0};
+};
+
+// A BfrtPacketioManager on top of the SDE mock, with the SDE side of the RX
+// path emulated by HandlePacketRx().
+class PacketRx {
+ public:
+  PacketRx() : writer_(std::make_shared<CountingWriter>()) {
+    ON_CALL(*bf_sde_mock_, RegisterPacketReceiveWriter(kDevice, _))
+        .WillByDefault(
+            Invoke([this](int device,
+                          std::unique_ptr<ChannelWriter<std::string>> writer) {
+              rx_writer_ = std::move(writer);
+              return ::util::OkStatus();
+            }));
+    ON_CALL(*bf_sde_mock_, RegisterPacketReceiveBufferPool(kDevice, _))
+        .WillByDefault(
+            Invoke([this](int device,
+                          std::shared_ptr<Channel<std::string>> buffer_pool) {
+              buffer_pool_reader_ =
+                  ChannelReader<std::string>::Create(buffer_pool);
+              buffer_pool_writer_ =
+                  ChannelWriter<std::string>::Create(buffer_pool);
+              return ::util::OkStatus();
+            }));
+    ON_CALL(*bf_sde_mock_, GetPacketRxStats(kDevice))
+        .WillByDefault(Invoke([this](int device) { return sde_stats_; }));
+
+    bfrt_packetio_manager_ =
+        BfrtPacketioManager::CreateInstance(kDevice, bf_sde_mock_.get());
+    BfrtDeviceConfig config;
+    CHECK_OK(ParseProtoFromString(kP4Info,
+                                  config.add_programs()->mutable_p4info()));
+    CHECK_OK(bfrt_packetio_manager_->PushForwardingPipelineConfig(config));
+    CHECK_OK(bfrt_packetio_manager_->RegisterPacketReceiveWriter(writer_));
+    CHECK(rx_writer_ != nullptr && buffer_pool_reader_ != nullptr);
+
+    packet_.assign(kPacketSize, 'x');
+    packet_[0] = 0;
+    packet_[1] = static_cast<char>(0x80);
+  }
+
+  ~PacketRx() {
+    rx_writer_.reset();
+    buffer_pool_reader_.reset();
+    buffer_pool_writer_.reset();
+    CHECK_OK(bfrt_packetio_manager_->Shutdown());
+  }
+
+  // Emulates BfSdeWrapper::HandlePacketRx() for one received packet.
+  void HandlePacketRx() {
+    std::string buffer;
+    if (!buffer_pool_reader_->TryRead(&buffer).ok()) {
+      sde_stats_.num_dropped_no_buffer++;
+      return;
+    }
+    buffer.assign(packet_);
+    if (rx_writer_->TryWrite(std::move(buffer)).ok()) {
+      sde_stats_.num_packets++;
+    } else {
+      sde_stats_.num_dropped_channel_full++;
+      buffer_pool_writer_->TryWrite(std::move(buffer)).IgnoreError();
+    }
+  }
+
+  const CountingWriter& writer() const { return *writer_; }
+  const BfrtPacketioManager& manager() const { return *bfrt_packetio_manager_; }
+  const BfSdeInterface::PacketRxStats& sde_stats() const { return sde_stats_; }
+
+ private:
+  std::unique_ptr<NiceMock<BfSdeMock>> bf_sde_mock_ =
+      absl::make_unique<NiceMock<BfSdeMock>>();
+  std::shared_ptr<CountingWriter> writer_;
+  std::unique_ptr<BfrtPacketioManager> bfrt_packetio_manager_;
+  std::unique_ptr<ChannelWriter<std::string>> rx_writer_;
+  std::unique_ptr<ChannelReader<std::string>> buffer_pool_reader_;
+  std::unique_ptr<ChannelWriter<std::string>> buffer_pool_writer_;
+  BfSdeInterface::PacketRxStats sde_stats_;
+  std::string packet_;
+};
+
+void BM_PacketRx(benchmark::State& state) {
+  PacketRx packet_rx;
+  const int64 rate_pps = state.range(0);
+  const absl::Duration interval =
+      rate_pps > 0 ? absl::Seconds(1) / rate_pps : absl::ZeroDuration();
+  int64 num_offered = 0;
+  absl::Duration delivery_time = absl::ZeroDuration();
+  for (auto _ : state) {
+    const absl::Time start_time = absl::Now();
+    absl::Time next_time = start_time;
+    for (int i = 0; i < kPacketsPerIteration; ++i) {
+      while (absl::Now() < next_time) {
+      }
+      packet_rx.HandlePacketRx();
+      next_time += interval;
+    }
+    num_offered += kPacketsPerIteration;
+    // Wait for the RX thread to hand all the accepted packets to the writer.
+    const int64 num_accepted = packet_rx.sde_stats().num_packets;
+    const absl::Time deadline = absl::Now() + absl::Seconds(5);
+    while (packet_rx.writer().num_packets() < num_accepted &&
+           absl::Now() < deadline) {
+      absl::SleepFor(absl::Microseconds(10));
+    }
+    delivery_time += absl::Now() - start_time;
+  }
+
+  const auto stats = packet_rx.manager().GetPacketRxStats();
+  state.counters["offered"] = benchmark::Counter(num_offered);
+  state.counters["delivered_pps"] = benchmark::Counter(
+      packet_rx.writer().num_packets() / absl::ToDoubleSeconds(delivery_time));
+  state.counters["dropped_no_buffer"] =
+      benchmark::Counter(stats.sde.num_dropped_no_buffer);
+  state.counters["dropped_channel_full"] =
+      benchmark::Counter(stats.sde.num_dropped_channel_full);
+  state.counters["dropped_parse_error"] =
+      benchmark::Counter(stats.num_dropped_parse_error);
+  state.counters["dropped_write_failure"] =
+      benchmark::Counter(stats.num_dropped_write_failure);
+  if (stats.num_batches > 0) {
+    state.counters["mean_batch_size"] = benchmark::Counter(
+        static_cast<double>(stats.num_packets) / stats.num_batches);
+    state.counters["mean_batch_time_us"] = benchmark::Counter(
+        absl::ToDoubleMicroseconds(stats.total_batch_time) /
+        stats.num_batches);
+  }
+  state.counters["max_batch_time_us"] =
+      benchmark::Counter(absl::ToDoubleMicroseconds(stats.max_batch_time));
+}
+BENCHMARK(BM_PacketRx)
+    ->Arg(100000)
+    ->Arg(0)
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime();
+
+// A BfrtPacketioManager on top of the SDE mock, with the SDE side of the TX
+// path emulated by TxPacket().
+class PacketTx {
+ public:
+  PacketTx()
+      : tx_buffers_(kNumTxRings * kTxBuffersPerRing,
+                    std::vector<char>(kTxBufferSize)) {
+    std::vector<std::vector<void*>> buffers_by_ring(kNumTxRings);
+    for (size_t i = 0; i < tx_buffers_.size(); ++i) {
+      buffers_by_ring[i % kNumTxRings].push_back(tx_buffers_[i].data());
+    }
+    tx_pool_ = absl::make_unique<BfPacketTxPool>(buffers_by_ring);
+    ON_CALL(*bf_sde_mock_, TxPacket(kDevice, _, _))
+        .WillByDefault(Invoke(this, &PacketTx::TxPacket));
+    ON_CALL(*bf_sde_mock_, GetPacketTxStats(kDevice))
+        .WillByDefault(Invoke([this](int device) {
+          return tx_pool_->GetStats();
+        }));
+
+    bfrt_packetio_manager_ =
+        BfrtPacketioManager::CreateInstance(kDevice, bf_sde_mock_.get());
+    BfrtDeviceConfig config;
+    CHECK_OK(ParseProtoFromString(kP4Info,
+                                  config.add_programs()->mutable_p4info()));
+    CHECK_OK(bfrt_packetio_manager_->PushForwardingPipelineConfig(config));
+
+    packet_.set_payload(std::string(kPacketSize - 2, 'x'));
+    auto* metadata = packet_.add_metadata();
+    metadata->set_metadata_id(1);
+    metadata->set_value(std::string("\x01", 1));
+    metadata = packet_.add_metadata();
+    metadata->set_metadata_id(2);
+    metadata->set_value(std::string("\x00", 1));
+  }
+
+  ~PacketTx() { CHECK_OK(bfrt_packetio_manager_->Shutdown()); }
+
+  // Emulates BfSdeWrapper::TxPacket().
+  ::util::Status TxPacket(int device, absl::string_view header,
+                          absl::string_view payload) {
+    void* buffer = nullptr;
+    int tx_ring = 0;
+    RETURN_IF_ERROR(tx_pool_->Acquire(&buffer, &tx_ring));
+    char* data = static_cast<char*>(buffer);
+    memcpy(data, header.data(), header.size());
+    memcpy(data + header.size(), payload.data(), payload.size());
+    in_flight_.push_back(buffer);
+    if (in_flight_.size() == kTxCompletionBurst) CompleteInFlight();
+    return ::util::OkStatus();
+  }
+
+  // Emulates the TX completion callback for all the packets in flight.
+  void CompleteInFlight() {
+    for (void* buffer : in_flight_) tx_pool_->Complete(buffer, true);
+    in_flight_.clear();
+  }
+
+  BfrtPacketioManager* manager() { return bfrt_packetio_manager_.get(); }
+  const ::p4::v1::PacketOut& packet() const { return packet_; }
+
+ private:
+  std::unique_ptr<NiceMock<BfSdeMock>> bf_sde_mock_ =
+      absl::make_unique<NiceMock<BfSdeMock>>();
+  std::unique_ptr<BfrtPacketioManager> bfrt_packetio_manager_;
+  std::vector<std::vector<char>> tx_buffers_;
+  std::unique_ptr<BfPacketTxPool> tx_pool_;
+  std::vector<void*> in_flight_;
+  ::p4::v1::PacketOut packet_;
+};
+
+void BM_PacketTx(benchmark::State& state) {
+  PacketTx packet_tx;
+  for (auto _ : state) {
+    for (int i = 0; i < kPacketsPerIteration; ++i) {
+      packet_tx.manager()->TransmitPacket(packet_tx.packet()).IgnoreError();
+    }
+  }
+  packet_tx.CompleteInFlight();
+
+  const auto stats = packet_tx.manager()->GetPacketTxStats();
+  state.SetItemsProcessed(state.iterations() * kPacketsPerIteration);
+  state.counters["transmitted"] = benchmark::Counter(stats.num_packets);
+  state.counters["dropped_no_buffer"] =
+      benchmark::Counter(stats.num_dropped_no_buffer);
+  if (stats.sde.num_completed > 0) {
+    state.counters["mean_completion_us"] = benchmark::Counter(
+        absl::ToDoubleMicroseconds(stats.sde.total_completion_time) /
+        stats.sde.num_completed);
+  }
+}
+BENCHMARK(BM_PacketTx)->Unit(benchmark::kMillisecond);
+
+}  // namespace
+}  // namespace barefoot
+}  // namespace hal
+}  // namespace stratum
@@ -52,6 +52,11 @@ class BfrtPacketioManagerTest : public ::testing::Test {
                   RegisterPacketReceiveWriter(kDevice1, _))
           .WillOnce(Invoke(
               this, &BfrtPacketioManagerTest::RegisterPacketReceiveWriter));
+      // - RegisterPacketReceiveBufferPool of SDE interface will be invoked
+      EXPECT_CALL(*bf_sde_wrapper_mock_,
+                  RegisterPacketReceiveBufferPool(kDevice1, _))
+          .WillOnce(Invoke(
+              this, &BfrtPacketioManagerTest::RegisterPacketReceiveBufferPool));
     }
 
     auto status = bfrt_packetio_manager_->PushForwardingPipelineConfig(config);
@@ -68,6 +73,7 @@ class BfrtPacketioManagerTest : public ::testing::Test {
     EXPECT_CALL(*bf_sde_wrapper_mock_, UnregisterPacketReceiveWriter(kDevice1))
         .WillOnce(Return(util::OkStatus()));
     packet_rx_writer.release();
+    packet_rx_buffer_pool.reset();
     return bfrt_packetio_manager_->Shutdown();
   }
 
@@ -80,6 +86,16 @@ class BfrtPacketioManagerTest : public ::testing::Test {
     return ::util::OkStatus();
   }
 
+  // The mock method which keeps the packet buffer pool, so that tests can
+  // copy the packets they write to packet_rx_writer into buffers of the pool
+  // like the SDE does.
+  ::util::Status RegisterPacketReceiveBufferPool(
+      int device, std::shared_ptr<Channel<std::string>> buffer_pool) {
+    EXPECT_EQ(device, kDevice1);
+    packet_rx_buffer_pool = std::move(buffer_pool);
+    return ::util::OkStatus();
+  }
+
   static constexpr int kDevice1 = 0;
   static constexpr char kP4Info[] = R"PROTO(
     controller_packet_metadata {
@@ -134,6 +150,7 @@ class BfrtPacketioManagerTest : public ::testing::Test {
   std::unique_ptr<BfSdeMock> bf_sde_wrapper_mock_;
   std::unique_ptr<BfrtPacketioManager> bfrt_packetio_manager_;
   std::unique_ptr<ChannelWriter<std::string>> packet_rx_writer;
+  std::shared_ptr<Channel<std::string>> packet_rx_buffer_pool;
 };
 
 // Basic set up and shutdown test
@@ -255,16 +272,81 @@ TEST_F(BfrtPacketioManagerTest, TransmitPacketAfterPipelineConfigPush) {
     }
   )PROTO";
   EXPECT_OK(ParseProtoFromString(packet_out_str, &packet_out));
-  const std::string expected_packet(
-      "\0\x80\0\0\0\0\0\0\0\0\0\0\xBF\x1"
-      "abcde",
-      19);
-  EXPECT_CALL(*bf_sde_wrapper_mock_, TxPacket(kDevice1, expected_packet))
+  const std::string expected_header("\0\x80\0\0\0\0\0\0\0\0\0\0\xBF\x1",
+                                    14);
+  EXPECT_CALL(*bf_sde_wrapper_mock_,
+              TxPacket(kDevice1, absl::string_view(expected_header),
+                       absl::string_view("abcde")))
       .WillOnce(Return(util::OkStatus()));
   EXPECT_OK(bfrt_packetio_manager_->TransmitPacket(packet_out));
   EXPECT_OK(Shutdown());
 }
 
+// A PacketOut is dropped with ERR_NO_RESOURCE while all the SDE TX buffers are
+// in flight, and the drops are counted along with the SDE TX counters.
+TEST_F(BfrtPacketioManagerTest, TransmitPacketBackpressure) {
+  EXPECT_OK(PushPipelineConfig());
+  p4::v1::PacketOut packet_out;
+  const char packet_out_str[] = R"PROTO(
+    payload: "abcde"
+    metadata {
+      metadata_id: 1
+      value: "\x1"
+    }
+    metadata {
+      metadata_id: 2
+      value: "\x0"
+    }
+    metadata {
+      metadata_id: 3
+      value: "\x0"
+    }
+    metadata {
+      metadata_id: 4
+      value: "\xbf\x01"
+    }
+  )PROTO";
+  EXPECT_OK(ParseProtoFromString(packet_out_str, &packet_out));
+  EXPECT_CALL(*bf_sde_wrapper_mock_, TxPacket(kDevice1, _, _))
+      .WillOnce(Return(util::OkStatus()))
+      .WillOnce(Return(::util::Status(StratumErrorSpace(), ERR_NO_RESOURCE,
+                                      "All TX buffers are in flight.")))
+      .WillOnce(Return(
+          ::util::Status(StratumErrorSpace(), ERR_INTERNAL, "TX failed.")));
+  EXPECT_OK(bfrt_packetio_manager_->TransmitPacket(packet_out));
+  EXPECT_THAT(bfrt_packetio_manager_->TransmitPacket(packet_out),
+              StatusIs(StratumErrorSpace(), ERR_NO_RESOURCE,
+                       HasSubstr("in flight")));
+  EXPECT_THAT(bfrt_packetio_manager_->TransmitPacket(packet_out),
+              StatusIs(StratumErrorSpace(), ERR_INTERNAL, _));
+  packet_out.mutable_metadata()->RemoveLast();
+  EXPECT_FALSE(bfrt_packetio_manager_->TransmitPacket(packet_out).ok());
+
+  BfSdeInterface::PacketTxStats sde_stats;
+  sde_stats.num_packets = 1;
+  sde_stats.num_completed = 1;
+  sde_stats.num_dropped_no_buffer = 1;
+  EXPECT_CALL(*bf_sde_wrapper_mock_, GetPacketTxStats(kDevice1))
+      .WillOnce(Return(sde_stats));
+  auto stats = bfrt_packetio_manager_->GetPacketTxStats();
+  EXPECT_EQ(1, stats.num_packets);
+  EXPECT_EQ(1, stats.num_dropped_no_buffer);
+  EXPECT_EQ(1, stats.num_dropped_tx_error);
+  EXPECT_EQ(1, stats.num_dropped_deparse_error);
+  EXPECT_EQ(1, stats.sde.num_completed);
+  EXPECT_EQ(1, stats.sde.num_dropped_no_buffer);
+
+  EXPECT_CALL(*bf_sde_wrapper_mock_, GetPacketRxStats(kDevice1))
+      .WillOnce(Return(BfSdeInterface::PacketRxStats()));
+  EXPECT_CALL(*bf_sde_wrapper_mock_, GetPacketTxStats(kDevice1))
+      .WillOnce(Return(sde_stats));
+  const std::string debug_string =
+      bfrt_packetio_manager_->GetPacketIoDebugString();
+  EXPECT_THAT(debug_string, HasSubstr("tx_packets: 1 tx_completed: 1"));
+  EXPECT_THAT(debug_string, HasSubstr("tx_dropped_no_buffer: 1"));
+  EXPECT_OK(Shutdown());
+}
+
 TEST_F(BfrtPacketioManagerTest, TransmitInvalidPacketAfterPipelineConfigPush) {
   EXPECT_OK(PushPipelineConfig());
   p4::v1::PacketOut packet_out;
@@ -337,6 +419,71 @@ TEST_F(BfrtPacketioManagerTest, TestPacketIn) {
   EXPECT_OK(Shutdown());
 }
 
+// Packets that cannot be parsed are counted and dropped without stopping the
+// RX thread, and the buffers of the packets go back to the pool.
+TEST_F(BfrtPacketioManagerTest, TestPacketInBatchStats) {
+  EXPECT_OK(PushPipelineConfig());
+  auto writer = std::make_shared<WriterMock<::p4::v1::PacketIn>>();
+  EXPECT_OK(bfrt_packetio_manager_->RegisterPacketReceiveWriter(writer));
+  ASSERT_NE(nullptr, packet_rx_buffer_pool);
+  auto buffer_pool_reader =
+      ChannelReader<std::string>::Create(packet_rx_buffer_pool);
+
+  constexpr int kNumPackets = 10;
+  auto write_notifier = std::make_shared<absl::Notification>();
+  std::weak_ptr<absl::Notification> weak_ref(write_notifier);
+  int num_written = 0;
+  EXPECT_CALL(*writer, Write(_))
+      .Times(kNumPackets)
+      .WillRepeatedly(Invoke([&num_written, weak_ref](::p4::v1::PacketIn) {
+        if (++num_written == kNumPackets) {
+          if (auto notifier = weak_ref.lock()) notifier->Notify();
+        }
+        return true;
+      }));
+  // A packet shorter than the PacketIn header.
+  std::string buffer;
+  ASSERT_OK(buffer_pool_reader->TryRead(&buffer));
+  buffer.assign("\0", 1);
+  EXPECT_OK(
+      packet_rx_writer->Write(std::move(buffer), absl::Milliseconds(100)));
+  std::vector<std::string> buffers;
+  for (int i = 0; i < kNumPackets; ++i) {
+    ASSERT_OK(buffer_pool_reader->TryRead(&buffer));
+    buffer.assign("\0\x80"
+                  "abcde",
+                  7);
+    buffers.push_back(std::move(buffer));
+  }
+  EXPECT_OK(packet_rx_writer->WriteBatch(&buffers, absl::Milliseconds(100)));
+
+  EXPECT_TRUE(
+      write_notifier->WaitForNotificationWithTimeout(absl::Milliseconds(100)));
+  EXPECT_CALL(*bf_sde_wrapper_mock_, GetPacketRxStats(kDevice1))
+      .WillRepeatedly(Return(BfSdeInterface::PacketRxStats()));
+  // The stats are updated after the batch is written, so wait until all the
+  // packets are accounted for.
+  const absl::Time deadline = absl::Now() + absl::Seconds(5);
+  auto stats = bfrt_packetio_manager_->GetPacketRxStats();
+  while (stats.num_packets + stats.num_dropped_parse_error < kNumPackets + 1 &&
+         absl::Now() < deadline) {
+    absl::SleepFor(absl::Milliseconds(1));
+    stats = bfrt_packetio_manager_->GetPacketRxStats();
+  }
+  EXPECT_EQ(kNumPackets, stats.num_packets);
+  EXPECT_EQ(1, stats.num_dropped_parse_error);
+  EXPECT_EQ(0, stats.num_dropped_write_failure);
+  EXPECT_LE(1, stats.num_batches);
+  EXPECT_LE(stats.num_batches, 1 + kNumPackets);
+
+  // All the buffers are back in the pool.
+  std::vector<std::string> free_buffers;
+  EXPECT_OK(buffer_pool_reader->ReadAll(&free_buffers));
+  EXPECT_EQ(2048, free_buffers.size());
+  EXPECT_OK(bfrt_packetio_manager_->UnregisterPacketReceiveWriter());
+  EXPECT_OK(Shutdown());
+}
+
 }  // namespace barefoot
 }  // namespace hal
 }  // namespace stratum
@@ -202,6 +202,7 @@ BfrtSwitch::~BfrtSwitch() {}
       case DataRequest::Request::kPortSpeed:
       case DataRequest::Request::kNegotiatedPortSpeed:
       case DataRequest::Request::kPortCounters:
+      case DataRequest::Request::kNodePortCounters:
       case DataRequest::Request::kAutonegStatus:
       case DataRequest::Request::kFrontPanelPortInfo:
       case DataRequest::Request::kLoopbackStatus:
@@ -227,6 +228,17 @@ BfrtSwitch::~BfrtSwitch() {}
         }
         break;
       }
+      case DataRequest::Request::kNodePacketioDebugInfo: {
+        auto bfrt_node = GetBfrtNodeFromNodeId(
+            req.node_packetio_debug_info().node_id());
+        if (!bfrt_node.ok()) {
+          status.Update(bfrt_node.status());
+        } else {
+          resp.mutable_node_packetio_debug_info()->set_debug_string(
+              bfrt_node.ValueOrDie()->GetPacketIoDebugString());
+        }
+        break;
+      }
       default:
         status =
             MAKE_ERROR(ERR_UNIMPLEMENTED)
@@ -0,0 +1,159 @@
+// Copyright 2020-present Open Networking Foundation
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef STRATUM_HAL_LIB_BAREFOOT_BFRT_TABLE_CACHE_H_
+#define STRATUM_HAL_LIB_BAREFOOT_BFRT_TABLE_CACHE_H_
+
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/memory/memory.h"
+#include "absl/synchronization/mutex.h"
+#include "stratum/glue/gtl/map_util.h"
+#include "stratum/glue/integral_types.h"
+
+namespace stratum {
+namespace hal {
+namespace barefoot {
+
+// BfrtTableCache holds what BfSdeWrapper would otherwise look up in the SDE
+// on every table operation: the handles of the BfRt tables of a pipeline and
+// the IDs of the fields that the SDE only names, like $MATCH_PRIORITY. It
+// also pools the key and data objects of the tables, so that they are reused
+// across writes instead of being allocated for each of them. A cache is built
+// when a pipeline is pushed and dropped with it.
+//
+// The class is templated on the table, key and data types (bfrt::BfRtTable,
+// bfrt::BfRtTableKey and bfrt::BfRtTableData in BfSdeWrapper) to not depend
+// on the SDE headers. The tables must all be added before the cache is
+// shared; the pools are thread-safe.
+template <typename TableT, typename KeyT, typename DataT>
+class BfrtTableCache {
+ public:
+  // IDs of the data fields looked up by name, for one action of a table. An
+  // ID is 0 if there is no such field, as BfRt never uses 0 as an ID.
+  struct DataFieldIds {
+    uint32 action_member_id = 0;
+    uint32 selector_group_id = 0;
+    uint32 counter_bytes = 0;
+    uint32 counter_packets = 0;
+  };
+
+  // The cached state of a table.
+  struct TableInfo {
+    uint32 table_id = 0;
+    const TableT* table = nullptr;
+    bool action_id_applicable = false;
+    // ID of the $MATCH_PRIORITY key field, or 0 if there is none.
+    uint32 match_priority_field_id = 0;
+    // Data field IDs by action ID. A table without actions has its data field
+    // IDs under action ID 0.
+    absl::flat_hash_map<uint32, DataFieldIds> data_field_ids;
+
+    // Returns the data field IDs of the given action, which are all 0 if the
+    // action is unknown.
+    const DataFieldIds& GetDataFieldIds(uint32 action_id) const {
+      static const DataFieldIds kNoDataFieldIds;
+      const DataFieldIds* field_ids =
+          gtl::FindOrNull(data_field_ids, action_id);
+      return field_ids ? *field_ids : kNoDataFieldIds;
+    }
+  };
+
+  // Creates an empty cache which pools up to max_pooled_objects key objects
+  // and as many data objects per table.
+  explicit BfrtTableCache(size_t max_pooled_objects)
+      : max_pooled_objects_(max_pooled_objects) {}
+
+  // Adds a table to the cache, replacing any table with the same ID.
+  void AddTable(TableInfo table_info) {
+    const uint32 table_id = table_info.table_id;
+    tables_[table_id] = absl::make_unique<TableInfo>(std::move(table_info));
+  }
+
+  // Returns the table with the given ID, or nullptr if there is none. The
+  // returned pointer is valid for the lifetime of the cache.
+  const TableInfo* GetTable(uint32 table_id) const {
+    auto it = tables_.find(table_id);
+    return it == tables_.end() ? nullptr : it->second.get();
+  }
+
+  // Takes a key object of the table out of the pool, or returns nullptr if
+  // the pool has none. The object still holds the values it was returned
+  // with, and must be reset by the caller.
+  std::unique_ptr<KeyT> TakeKey(uint32 table_id) LOCKS_EXCLUDED(lock_) {
+    absl::MutexLock l(&lock_);
+    return TakeObject(&free_keys_, table_id);
+  }
+
+  // Returns a key object of the table to the pool, or frees it if the pool of
+  // the table is full.
+  void ReturnKey(uint32 table_id, std::unique_ptr<KeyT> key)
+      LOCKS_EXCLUDED(lock_) {
+    absl::MutexLock l(&lock_);
+    ReturnObject(&free_keys_, table_id, std::move(key));
+  }
+
+  // Takes a data object of the table out of the pool, or returns nullptr if
+  // the pool has none. The object may have been allocated for another action
+  // of the table, and must be reset by the caller.
+  std::unique_ptr<DataT> TakeData(uint32 table_id) LOCKS_EXCLUDED(lock_) {
+    absl::MutexLock l(&lock_);
+    return TakeObject(&free_datas_, table_id);
+  }
+
+  // Returns a data object of the table to the pool, or frees it if the pool
+  // of the table is full.
+  void ReturnData(uint32 table_id, std::unique_ptr<DataT> data)
+      LOCKS_EXCLUDED(lock_) {
+    absl::MutexLock l(&lock_);
+    ReturnObject(&free_datas_, table_id, std::move(data));
+  }
+
+  // BfrtTableCache is neither copyable nor movable.
+  BfrtTableCache(const BfrtTableCache&) = delete;
+  BfrtTableCache& operator=(const BfrtTableCache&) = delete;
+
+ private:
+  template <typename T>
+  using ObjectPools =
+      absl::flat_hash_map<uint32, std::vector<std::unique_ptr<T>>>;
+
+  template <typename T>
+  static std::unique_ptr<T> TakeObject(ObjectPools<T>* pools,
+                                       uint32 table_id) {
+    auto it = pools->find(table_id);
+    if (it == pools->end() || it->second.empty()) return nullptr;
+    std::unique_ptr<T> object = std::move(it->second.back());
+    it->second.pop_back();
+    return object;
+  }
+
+  template <typename T>
+  void ReturnObject(ObjectPools<T>* pools, uint32 table_id,
+                    std::unique_ptr<T> object) {
+    auto& pool = (*pools)[table_id];
+    if (pool.size() < max_pooled_objects_) pool.push_back(std::move(object));
+  }
+
+  // The tables by ID. Never change once the cache is shared.
+  absl::flat_hash_map<uint32, std::unique_ptr<TableInfo>> tables_;
+
+  // Max number of pooled key or data objects per table.
+  const size_t max_pooled_objects_;
+
+  absl::Mutex lock_;
+
+  // The free key and data objects, by table ID.
+  ObjectPools<KeyT> free_keys_ GUARDED_BY(lock_);
+  ObjectPools<DataT> free_datas_ GUARDED_BY(lock_);
+};
+
+}  // namespace barefoot
+}  // namespace hal
+}  // namespace stratum
+
+#endif  // STRATUM_HAL_LIB_BAREFOOT_BFRT_TABLE_CACHE_H_
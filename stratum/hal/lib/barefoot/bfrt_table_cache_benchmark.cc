@@ -0,0 +1,288 @@
+// Copyright 2020-present Open Networking Foundation
+// SPDX-License-Identifier: Apache-2.0
+
+// Benchmarks the SDE calls BfSdeWrapper makes for a P4Runtime table entry
+// insert (CreateTableKey, CreateTableData, InsertTableEntry), before and with
+// the BfrtTableCache. The BfRt classes are replaced by fakes whose lookups and
+// allocations follow those of the SDE: the tables are in an ordered map by
+// ID, the fields of a table in ordered maps by name, and the key and data
+// objects hold a value per field. The entries go to tables of a pipeline of
+// kNumTables in turn; each has an exact and a ternary match field, the
+// $MATCH_PRIORITY field, an action with two parameters and direct counters.
+
+#include <map>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/memory/memory.h"
+#include "benchmark/benchmark.h"
+#include "stratum/glue/integral_types.h"
+#include "stratum/glue/logging.h"
+#include "stratum/hal/lib/barefoot/bfrt_table_cache.h"
+
+namespace stratum {
+namespace hal {
+namespace barefoot {
+namespace {
+
+constexpr int kNumTables = 64;
+constexpr uint32 kFirstTableId = 33554433;
+constexpr uint32 kActionId = 16777217;
+
+// Key field IDs, and IDs of the action parameters.
+constexpr uint32 kExactFieldId = 1;
+constexpr uint32 kTernaryFieldId = 2;
+constexpr uint32 kParam1Id = 1;
+constexpr uint32 kParam2Id = 2;
+
+// Status of the fake calls, like bf_status_t.
+constexpr int kSuccess = 0;
+constexpr int kObjectNotFound = 6;
+
+class FakeKey {
+ public:
+  explicit FakeKey(const std::vector<uint32>& field_ids) {
+    for (const auto id : field_ids) fields_[id] = std::string(16, '\0');
+  }
+  int setValue(uint32 field_id, const std::string& value) {
+    auto it = fields_.find(field_id);
+    if (it == fields_.end()) return kObjectNotFound;
+    it->second = value;
+    return kSuccess;
+  }
+  void Reset() {
+    for (auto& field : fields_) field.second.assign(16, '\0');
+  }
+
+ private:
+  std::map<uint32, std::string> fields_;
+};
+
+class FakeData {
+ public:
+  FakeData(uint32 action_id, const std::vector<uint32>& field_ids) {
+    Reset(action_id, field_ids);
+  }
+  int setValue(uint32 field_id, const std::string& value) {
+    auto it = fields_.find(field_id);
+    if (it == fields_.end()) return kObjectNotFound;
+    it->second = value;
+    return kSuccess;
+  }
+  void Reset(uint32 action_id, const std::vector<uint32>& field_ids) {
+    action_id_ = action_id;
+    fields_.clear();
+    for (const auto id : field_ids) fields_[id] = std::string(8, '\0');
+  }
+
+ private:
+  uint32 action_id_;
+  std::map<uint32, std::string> fields_;
+};
+
+class FakeTable {
+ public:
+  explicit FakeTable(uint32 table_id) : table_id_(table_id) {
+    key_fields_ = {{"hdr.ethernet.dst_addr", kExactFieldId},
+                   {"hdr.ipv4.src_addr", kTernaryFieldId},
+                   {"$MATCH_PRIORITY", 3}};
+    data_fields_ = {{"port", kParam1Id},
+                    {"smac", kParam2Id},
+                    {"$COUNTER_SPEC_BYTES", 65553},
+                    {"$COUNTER_SPEC_PKTS", 65554}};
+  }
+
+  uint32 table_id() const { return table_id_; }
+
+  int keyFieldIdGet(const std::string& name, uint32* field_id) const {
+    return FieldIdGet(key_fields_, name, field_id);
+  }
+  int dataFieldIdGet(const std::string& name, uint32 action_id,
+                     uint32* field_id) const {
+    if (action_id != kActionId) return kObjectNotFound;
+    return FieldIdGet(data_fields_, name, field_id);
+  }
+  int keyAllocate(std::unique_ptr<FakeKey>* key) const {
+    *key = absl::make_unique<FakeKey>(FieldIds(key_fields_));
+    return kSuccess;
+  }
+  int keyReset(FakeKey* key) const {
+    key->Reset();
+    return kSuccess;
+  }
+  int dataAllocate(uint32 action_id, std::unique_ptr<FakeData>* data) const {
+    *data = absl::make_unique<FakeData>(action_id, FieldIds(data_fields_));
+    return kSuccess;
+  }
+  int dataReset(uint32 action_id, FakeData* data) const {
+    data->Reset(action_id, FieldIds(data_fields_));
+    return kSuccess;
+  }
+  int tableEntryAdd(const FakeKey& key, const FakeData& data) const {
+    benchmark::DoNotOptimize(&key);
+    benchmark::DoNotOptimize(&data);
+    return kSuccess;
+  }
+
+ private:
+  static int FieldIdGet(const std::map<std::string, uint32>& fields,
+                        const std::string& name, uint32* field_id) {
+    auto it = fields.find(name);
+    if (it == fields.end()) return kObjectNotFound;
+    *field_id = it->second;
+    return kSuccess;
+  }
+  static std::vector<uint32> FieldIds(
+      const std::map<std::string, uint32>& fields) {
+    std::vector<uint32> ids;
+    for (const auto& field : fields) ids.push_back(field.second);
+    return ids;
+  }
+
+  const uint32 table_id_;
+  std::map<std::string, uint32> key_fields_;
+  std::map<std::string, uint32> data_fields_;
+};
+
+using FakeTableCache = BfrtTableCache<FakeTable, FakeKey, FakeData>;
+
+// The tables of the pipeline by ID, like bfrt::BfRtInfo.
+class FakeInfo {
+ public:
+  FakeInfo() {
+    for (int i = 0; i < kNumTables; ++i) {
+      const uint32 table_id = kFirstTableId + i;
+      tables_.emplace(table_id, absl::make_unique<FakeTable>(table_id));
+    }
+  }
+
+  int bfrtTableFromIdGet(uint32 table_id, const FakeTable** table) const {
+    auto it = tables_.find(table_id);
+    if (it == tables_.end()) return kObjectNotFound;
+    *table = it->second.get();
+    return kSuccess;
+  }
+
+  // Builds the cache the way BfSdeWrapper does on a pipeline push.
+  std::shared_ptr<FakeTableCache> BuildTableCache() const {
+    auto table_cache = std::make_shared<FakeTableCache>(16);
+    for (const auto& e : tables_) {
+      const FakeTable* table = e.second.get();
+      FakeTableCache::TableInfo table_info;
+      table_info.table_id = e.first;
+      table_info.table = table;
+      table_info.action_id_applicable = true;
+      CHECK_EQ(kSuccess, table->keyFieldIdGet(
+                             "$MATCH_PRIORITY",
+                             &table_info.match_priority_field_id));
+      auto& field_ids = table_info.data_field_ids[kActionId];
+      CHECK_EQ(kSuccess, table->dataFieldIdGet("$COUNTER_SPEC_BYTES", kActionId,
+                                               &field_ids.counter_bytes));
+      CHECK_EQ(kSuccess, table->dataFieldIdGet("$COUNTER_SPEC_PKTS", kActionId,
+                                               &field_ids.counter_packets));
+      table_cache->AddTable(std::move(table_info));
+    }
+    return table_cache;
+  }
+
+ private:
+  std::map<uint32, std::unique_ptr<FakeTable>> tables_;
+};
+
+const std::string& Value() {
+  static const auto* value = new std::string(6, '\x01');
+  return *value;
+}
+
+// Before the cache: every call looks up the table by ID and the fields by
+// name, and the key and data objects are allocated for each entry.
+void BM_InsertTableEntry(benchmark::State& state) {
+  FakeInfo bfrt_info;
+  int i = 0;
+  for (auto _ : state) {
+    const uint32 table_id = kFirstTableId + i++ % kNumTables;
+    // CreateTableKey()
+    const FakeTable* table;
+    CHECK_EQ(kSuccess, bfrt_info.bfrtTableFromIdGet(table_id, &table));
+    std::unique_ptr<FakeKey> key;
+    CHECK_EQ(kSuccess, table->keyAllocate(&key));
+    CHECK_EQ(kSuccess, key->setValue(kExactFieldId, Value()));
+    CHECK_EQ(kSuccess, key->setValue(kTernaryFieldId, Value()));
+    uint32 priority_field_id;
+    CHECK_EQ(kSuccess, table->keyFieldIdGet("$MATCH_PRIORITY",
+                                            &priority_field_id));
+    CHECK_EQ(kSuccess, key->setValue(priority_field_id, Value()));
+    // CreateTableData()
+    CHECK_EQ(kSuccess, bfrt_info.bfrtTableFromIdGet(table_id, &table));
+    std::unique_ptr<FakeData> data;
+    CHECK_EQ(kSuccess, table->dataAllocate(kActionId, &data));
+    CHECK_EQ(kSuccess, data->setValue(kParam1Id, Value()));
+    CHECK_EQ(kSuccess, data->setValue(kParam2Id, Value()));
+    uint32 bytes_field_id, packets_field_id;
+    CHECK_EQ(kSuccess, table->dataFieldIdGet("$COUNTER_SPEC_BYTES", kActionId,
+                                             &bytes_field_id));
+    CHECK_EQ(kSuccess, table->dataFieldIdGet("$COUNTER_SPEC_PKTS", kActionId,
+                                             &packets_field_id));
+    CHECK_EQ(kSuccess, data->setValue(bytes_field_id, Value()));
+    CHECK_EQ(kSuccess, data->setValue(packets_field_id, Value()));
+    // InsertTableEntry()
+    CHECK_EQ(kSuccess, bfrt_info.bfrtTableFromIdGet(table_id, &table));
+    CHECK_EQ(kSuccess, table->tableEntryAdd(*key, *data));
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_InsertTableEntry);
+
+// With the cache: the tables and field IDs come from the cache, and the key
+// and data objects from its pools.
+void BM_InsertTableEntryCached(benchmark::State& state) {
+  FakeInfo bfrt_info;
+  auto table_cache = bfrt_info.BuildTableCache();
+  int i = 0;
+  for (auto _ : state) {
+    const uint32 table_id = kFirstTableId + i++ % kNumTables;
+    // CreateTableKey()
+    const auto* table_info = table_cache->GetTable(table_id);
+    CHECK(table_info);
+    auto key = table_cache->TakeKey(table_id);
+    if (key) {
+      CHECK_EQ(kSuccess, table_info->table->keyReset(key.get()));
+    } else {
+      CHECK_EQ(kSuccess, table_info->table->keyAllocate(&key));
+    }
+    CHECK_EQ(kSuccess, key->setValue(kExactFieldId, Value()));
+    CHECK_EQ(kSuccess, key->setValue(kTernaryFieldId, Value()));
+    CHECK_EQ(kSuccess,
+             key->setValue(table_info->match_priority_field_id, Value()));
+    // CreateTableData()
+    table_info = table_cache->GetTable(table_id);
+    CHECK(table_info);
+    auto data = table_cache->TakeData(table_id);
+    if (data) {
+      CHECK_EQ(kSuccess, table_info->table->dataReset(kActionId, data.get()));
+    } else {
+      CHECK_EQ(kSuccess, table_info->table->dataAllocate(kActionId, &data));
+    }
+    CHECK_EQ(kSuccess, data->setValue(kParam1Id, Value()));
+    CHECK_EQ(kSuccess, data->setValue(kParam2Id, Value()));
+    const auto& field_ids = table_info->GetDataFieldIds(kActionId);
+    CHECK_EQ(kSuccess, data->setValue(field_ids.counter_bytes, Value()));
+    CHECK_EQ(kSuccess, data->setValue(field_ids.counter_packets, Value()));
+    // InsertTableEntry()
+    table_info = table_cache->GetTable(table_id);
+    CHECK(table_info);
+    CHECK_EQ(kSuccess, table_info->table->tableEntryAdd(*key, *data));
+    // The TableKey and TableData destructors.
+    table_cache->ReturnKey(table_id, std::move(key));
+    table_cache->ReturnData(table_id, std::move(data));
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_InsertTableEntryCached);
+
+}  // namespace
+}  // namespace barefoot
+}  // namespace hal
+}  // namespace stratum
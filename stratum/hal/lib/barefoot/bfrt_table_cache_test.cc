@@ -0,0 +1,94 @@
+// Copyright 2020-present Open Networking Foundation
+// SPDX-License-Identifier: Apache-2.0
+
+#include "stratum/hal/lib/barefoot/bfrt_table_cache.h"
+
+#include <memory>
+#include <utility>
+
+#include "absl/memory/memory.h"
+#include "gtest/gtest.h"
+
+namespace stratum {
+namespace hal {
+namespace barefoot {
+
+// Stand-ins for the BfRt table, key and data types.
+struct FakeTable {};
+struct FakeKey {};
+struct FakeData {};
+
+using FakeTableCache = BfrtTableCache<FakeTable, FakeKey, FakeData>;
+
+class BfrtTableCacheTest : public ::testing::Test {
+ protected:
+  static constexpr uint32 kTableId = 33583783;
+  static constexpr uint32 kActionId = 16829080;
+
+  BfrtTableCacheTest() : table_cache_(/*max_pooled_objects=*/2) {
+    FakeTableCache::TableInfo table_info;
+    table_info.table_id = kTableId;
+    table_info.table = &table_;
+    table_info.action_id_applicable = true;
+    table_info.match_priority_field_id = 5;
+    table_info.data_field_ids[kActionId].counter_bytes = 2;
+    table_info.data_field_ids[kActionId].counter_packets = 3;
+    table_cache_.AddTable(std::move(table_info));
+  }
+
+  FakeTable table_;
+  FakeTableCache table_cache_;
+};
+
+constexpr uint32 BfrtTableCacheTest::kTableId;
+constexpr uint32 BfrtTableCacheTest::kActionId;
+
+TEST_F(BfrtTableCacheTest, GetTable) {
+  const auto* table_info = table_cache_.GetTable(kTableId);
+  ASSERT_NE(nullptr, table_info);
+  EXPECT_EQ(kTableId, table_info->table_id);
+  EXPECT_EQ(&table_, table_info->table);
+  EXPECT_TRUE(table_info->action_id_applicable);
+  EXPECT_EQ(5, table_info->match_priority_field_id);
+  EXPECT_EQ(nullptr, table_cache_.GetTable(kTableId + 1));
+}
+
+TEST_F(BfrtTableCacheTest, GetDataFieldIds) {
+  const auto* table_info = table_cache_.GetTable(kTableId);
+  ASSERT_NE(nullptr, table_info);
+  const auto& field_ids = table_info->GetDataFieldIds(kActionId);
+  EXPECT_EQ(0, field_ids.action_member_id);
+  EXPECT_EQ(0, field_ids.selector_group_id);
+  EXPECT_EQ(2, field_ids.counter_bytes);
+  EXPECT_EQ(3, field_ids.counter_packets);
+
+  // An unknown action has none of the fields.
+  const auto& unknown_field_ids = table_info->GetDataFieldIds(kActionId + 1);
+  EXPECT_EQ(0, unknown_field_ids.counter_bytes);
+  EXPECT_EQ(0, unknown_field_ids.counter_packets);
+}
+
+TEST_F(BfrtTableCacheTest, KeysAreReused) {
+  EXPECT_EQ(nullptr, table_cache_.TakeKey(kTableId));
+  auto key = absl::make_unique<FakeKey>();
+  FakeKey* key_ptr = key.get();
+  table_cache_.ReturnKey(kTableId, std::move(key));
+  // The pools are per table.
+  EXPECT_EQ(nullptr, table_cache_.TakeKey(kTableId + 1));
+  EXPECT_EQ(nullptr, table_cache_.TakeData(kTableId));
+  EXPECT_EQ(key_ptr, table_cache_.TakeKey(kTableId).get());
+  EXPECT_EQ(nullptr, table_cache_.TakeKey(kTableId));
+}
+
+TEST_F(BfrtTableCacheTest, PoolsAreBounded) {
+  for (int i = 0; i < 3; ++i) {
+    table_cache_.ReturnData(kTableId, absl::make_unique<FakeData>());
+  }
+  EXPECT_NE(nullptr, table_cache_.TakeData(kTableId));
+  EXPECT_NE(nullptr, table_cache_.TakeData(kTableId));
+  EXPECT_EQ(nullptr, table_cache_.TakeData(kTableId));
+}
+
+}  // namespace barefoot
+}  // namespace hal
+}  // namespace stratum
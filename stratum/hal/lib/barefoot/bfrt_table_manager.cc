@@ -15,6 +15,7 @@
 #include "stratum/glue/status/status_macros.h"
 #include "stratum/hal/lib/barefoot/bfrt_constants.h"
 #include "stratum/hal/lib/barefoot/utils.h"
+#include "stratum/hal/lib/common/read_response_chunker.h"
 #include "stratum/hal/lib/p4/utils.h"
 #include "stratum/lib/utils.h"
 
@@ -575,22 +576,22 @@ struct RegisterClearThreadData {
   std::vector<std::unique_ptr<BfSdeInterface::TableDataInterface>> datas;
   RETURN_IF_ERROR(bf_sde_interface_->GetAllTableEntries(
       device_, session, table_id, &keys, &datas));
-  ::p4::v1::ReadResponse resp;
+  // Stream the entries in chunks rather than building one response for the
+  // whole table. The SDE objects of an entry are released once it is built.
+  ReadResponseChunker chunker(writer);
   for (size_t i = 0; i < keys.size(); ++i) {
-    const std::unique_ptr<BfSdeInterface::TableKeyInterface>& table_key =
-        keys[i];
-    const std::unique_ptr<BfSdeInterface::TableDataInterface>& table_data =
-        datas[i];
+    std::unique_ptr<BfSdeInterface::TableKeyInterface> table_key =
+        std::move(keys[i]);
+    std::unique_ptr<BfSdeInterface::TableDataInterface> table_data =
+        std::move(datas[i]);
+    ASSIGN_OR_RETURN(auto* entity, chunker.AddEntity());
     ASSIGN_OR_RETURN(
-        auto result,
+        *entity->mutable_table_entry(),
         BuildP4TableEntry(table_entry, table_key.get(), table_data.get()));
-    *resp.add_entities()->mutable_table_entry() = result;
-  }
-
-  VLOG(1) << "ReadAllTableEntries resp " << resp.DebugString();
-  if (!writer->Write(resp)) {
-    return MAKE_ERROR(ERR_INTERNAL) << "Write to stream for failed.";
   }
+  VLOG(1) << "ReadAllTableEntries read " << keys.size()
+          << " entries from table " << table_entry.table_id() << ".";
+  RETURN_IF_ERROR(chunker.Flush());
 
   return ::util::OkStatus();
 }
@@ -603,18 +604,19 @@ struct RegisterClearThreadData {
   absl::ReaderMutexLock l(&lock_);
 
   // We have four cases to handle:
-  // 1. empty table entry: return all tables
+  // 1. table id not set, no match key: return all entries of all tables
   // 2. table id set, no match key: return all table entires of that table
   // 3. table id set, no match key, is_default_action set: return default action
   // 4. table id and match key: return single entry
 
   if (table_entry.match_size() == 0 && !table_entry.is_default_action()) {
     std::vector<::p4::v1::TableEntry> wanted_tables;
-    if (ProtoEqual(table_entry, ::p4::v1::TableEntry::default_instance())) {
-      // 1.
+    if (table_entry.table_id() == 0) {
+      // 1. The other fields of the request, e.g. counter_data, apply to the
+      // entries of all tables.
       const ::p4::config::v1::P4Info& p4_info = p4_info_manager_->p4_info();
       for (const auto& table : p4_info.tables()) {
-        ::p4::v1::TableEntry te;
+        ::p4::v1::TableEntry te = table_entry;
         te.set_table_id(table.preamble().id());
         wanted_tables.push_back(te);
       }
@@ -622,13 +624,19 @@ struct RegisterClearThreadData {
       // 2.
       wanted_tables.push_back(table_entry);
     }
-    // TODO(max): can wildcard reads request counter_data?
     if (table_entry.has_counter_data()) {
+      // Sync the counters of all tables at once, instead of waiting for the
+      // sync of each table in turn.
+      std::vector<uint32> bfrt_table_ids;
       for (const auto& wanted_table_entry : wanted_tables) {
-        RETURN_IF_ERROR(bf_sde_interface_->SynchronizeCounters(
-            device_, session, wanted_table_entry.table_id(),
-            absl::Milliseconds(FLAGS_bfrt_table_sync_timeout_ms)));
+        ASSIGN_OR_RETURN(
+            uint32 bfrt_table_id,
+            bf_sde_interface_->GetBfRtId(wanted_table_entry.table_id()));
+        bfrt_table_ids.push_back(bfrt_table_id);
       }
+      RETURN_IF_ERROR(bf_sde_interface_->SynchronizeCountersOfTables(
+          device_, session, bfrt_table_ids,
+          absl::Milliseconds(FLAGS_bfrt_table_sync_timeout_ms)));
     }
     for (const auto& wanted_table_entry : wanted_tables) {
       RETURN_IF_ERROR_WITH_APPEND(
@@ -644,8 +652,10 @@ struct RegisterClearThreadData {
   } else {
     // 4.
     if (table_entry.has_counter_data()) {
+      ASSIGN_OR_RETURN(uint32 bfrt_table_id,
+                       bf_sde_interface_->GetBfRtId(table_entry.table_id()));
       RETURN_IF_ERROR(bf_sde_interface_->SynchronizeCounters(
-          device_, session, table_entry.table_id(),
+          device_, session, bfrt_table_id,
           absl::Milliseconds(FLAGS_bfrt_table_sync_timeout_ms)));
     }
     return ReadSingleTableEntry(session, table_entry, writer);
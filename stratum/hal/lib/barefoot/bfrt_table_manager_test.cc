@@ -5,21 +5,29 @@
 
 #include <string>
 #include <utility>
+#include <vector>
 
 #include "absl/memory/memory.h"
+#include "absl/time/time.h"
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
 #include "stratum/glue/status/status_test_util.h"
 #include "stratum/hal/lib/barefoot/bf_sde_mock.h"
+#include "stratum/hal/lib/common/writer_mock.h"
 #include "stratum/lib/utils.h"
+#include "stratum/public/lib/error.h"
 
 using ::testing::_;
 using ::testing::ByMove;
 using ::testing::DoAll;
 using ::testing::HasSubstr;
+using ::testing::InSequence;
 using ::testing::Invoke;
 using ::testing::InvokeWithoutArgs;
 using ::testing::Return;
+using ::testing::UnorderedElementsAre;
+
+DECLARE_uint32(bfrt_table_sync_timeout_ms);
 
 // FIXME
 DEFINE_string(bfrt_sde_config_dir, "/var/run/stratum/bfrt_config",
@@ -69,6 +77,38 @@ class BfrtTableManagerTest : public ::testing::Test {
             direct_resource_ids: 318814845
             size: 1024
           }
+          tables {
+            preamble {
+              id: 33583784
+              name: "Ingress.control.table2"
+            }
+            match_fields {
+              id: 1
+              name: "field1"
+              bitwidth: 9
+              match_type: EXACT
+            }
+            action_refs {
+              id: 16794911
+            }
+            size: 1024
+          }
+          tables {
+            preamble {
+              id: 33583785
+              name: "Ingress.control.table3"
+            }
+            match_fields {
+              id: 1
+              name: "field1"
+              bitwidth: 9
+              match_type: EXACT
+            }
+            action_refs {
+              id: 16794911
+            }
+            size: 1024
+          }
           actions {
             preamble {
               id: 16794911
@@ -161,6 +201,65 @@ TEST_F(BfrtTableManagerTest, WriteDirectCounterEntryTest) {
       session_mock, ::p4::v1::Update::MODIFY, entry));
 }
 
+TEST_F(BfrtTableManagerTest, ReadAllTablesWithCounterDataSyncsTablesAtOnce) {
+  ASSERT_OK(PushTestConfig());
+  auto session_mock = std::make_shared<SessionMock>();
+  WriterMock<::p4::v1::ReadResponse> writer_mock;
+
+  EXPECT_CALL(*bf_sde_wrapper_mock_, GetBfRtId(_))
+      .WillRepeatedly(
+          Invoke([](uint32 p4info_id) -> ::util::StatusOr<uint32> {
+            return p4info_id - 33583783 + 20;
+          }));
+  {
+    // The counters of all tables are synced in a single call, before any
+    // table is read.
+    InSequence s;
+    EXPECT_CALL(*bf_sde_wrapper_mock_,
+                SynchronizeCountersOfTables(
+                    kDevice1, _, UnorderedElementsAre(20, 21, 22),
+                    absl::Milliseconds(FLAGS_bfrt_table_sync_timeout_ms)))
+        .WillOnce(Return(::util::OkStatus()));
+    EXPECT_CALL(*bf_sde_wrapper_mock_,
+                GetAllTableEntries(kDevice1, _, _, _, _))
+        .Times(3)
+        .WillRepeatedly(Return(::util::OkStatus()));
+  }
+  EXPECT_CALL(*bf_sde_wrapper_mock_, SynchronizeCounters(_, _, _, _)).Times(0);
+  EXPECT_CALL(writer_mock, Write(_)).Times(3).WillRepeatedly(Return(true));
+
+  ::p4::v1::TableEntry table_entry;
+  table_entry.mutable_counter_data();
+  EXPECT_OK(bfrt_table_manager_->ReadTableEntry(session_mock, table_entry,
+                                                &writer_mock));
+}
+
+TEST_F(BfrtTableManagerTest, ReadTableEntriesFailsOnSyncTimeout) {
+  ASSERT_OK(PushTestConfig());
+  auto session_mock = std::make_shared<SessionMock>();
+  WriterMock<::p4::v1::ReadResponse> writer_mock;
+
+  EXPECT_CALL(*bf_sde_wrapper_mock_, GetBfRtId(33583784))
+      .WillOnce(Return(21));
+  EXPECT_CALL(*bf_sde_wrapper_mock_,
+              SynchronizeCountersOfTables(kDevice1, _,
+                                          std::vector<uint32>{21}, _))
+      .WillOnce(Return(::util::Status(
+          StratumErrorSpace(), ERR_OPER_TIMEOUT,
+          "Timeout while syncing (indirect) table counters of table 21.")));
+  EXPECT_CALL(*bf_sde_wrapper_mock_, GetAllTableEntries(_, _, _, _, _))
+      .Times(0);
+  EXPECT_CALL(writer_mock, Write(_)).Times(0);
+
+  ::p4::v1::TableEntry table_entry;
+  table_entry.set_table_id(33583784);
+  table_entry.mutable_counter_data();
+  ::util::Status status = bfrt_table_manager_->ReadTableEntry(
+      session_mock, table_entry, &writer_mock);
+  EXPECT_EQ(ERR_OPER_TIMEOUT, status.error_code());
+  EXPECT_THAT(status.error_message(), HasSubstr("table 21"));
+}
+
 }  // namespace barefoot
 }  // namespace hal
 }  // namespace stratum
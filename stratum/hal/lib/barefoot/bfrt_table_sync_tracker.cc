@@ -0,0 +1,45 @@
+// Copyright 2020-present Open Networking Foundation
+// SPDX-License-Identifier: Apache-2.0
+
+#include "stratum/hal/lib/barefoot/bfrt_table_sync_tracker.h"
+
+#include "stratum/glue/logging.h"
+#include "stratum/lib/macros.h"
+#include "stratum/public/lib/error.h"
+
+namespace stratum {
+namespace hal {
+namespace barefoot {
+
+std::function<void()> BfrtTableSyncTracker::AddSync(uint32 table_id,
+                                                    const char* what) {
+  auto notifier = std::make_shared<absl::Notification>();
+  std::weak_ptr<absl::Notification> weak_ref(notifier);
+  pending_syncs_.push_back({table_id, what, std::move(notifier)});
+
+  return [table_id, what, weak_ref]() {
+    if (auto notifier = weak_ref.lock()) {
+      VLOG(1) << "Table " << what << " for table " << table_id << " synced.";
+      notifier->Notify();
+    } else {
+      VLOG(1) << "Notifier expired before table " << table_id
+              << " could be synced.";
+    }
+  };
+}
+
+::util::Status BfrtTableSyncTracker::WaitForAll(absl::Time deadline) const {
+  for (const auto& pending_sync : pending_syncs_) {
+    if (!pending_sync.notifier->WaitForNotificationWithDeadline(deadline)) {
+      return MAKE_ERROR(ERR_OPER_TIMEOUT)
+             << "Timeout while syncing (indirect) table " << pending_sync.what
+             << " of table " << pending_sync.table_id << ".";
+    }
+  }
+
+  return ::util::OkStatus();
+}
+
+}  // namespace barefoot
+}  // namespace hal
+}  // namespace stratum
@@ -0,0 +1,65 @@
+// Copyright 2020-present Open Networking Foundation
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef STRATUM_HAL_LIB_BAREFOOT_BFRT_TABLE_SYNC_TRACKER_H_
+#define STRATUM_HAL_LIB_BAREFOOT_BFRT_TABLE_SYNC_TRACKER_H_
+
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "absl/synchronization/notification.h"
+#include "absl/time/time.h"
+#include "stratum/glue/integral_types.h"
+#include "stratum/glue/status/status.h"
+
+namespace stratum {
+namespace hal {
+namespace barefoot {
+
+// BfrtTableSyncTracker keeps track of the asynchronous sync operations
+// (counter or register syncs) of BfRt tables started by one BfSdeWrapper call.
+// The syncs of all the tables are started first and then waited for together
+// with a single deadline, so that the call takes about as long as its slowest
+// sync rather than the sum of them.
+//
+// AddSync() and WaitForAll() are called by the thread starting the syncs. The
+// callbacks returned by AddSync() can be called from any thread, even after
+// the tracker is gone, e.g. for syncs abandoned on a timeout.
+class BfrtTableSyncTracker {
+ public:
+  BfrtTableSyncTracker() {}
+
+  // Adds a sync of the given table, and returns the callback to call once it
+  // is done. what names the synced values ("counters" or "registers") in the
+  // logs and errors.
+  std::function<void()> AddSync(uint32 table_id, const char* what);
+
+  // Waits until all the syncs are done. Returns ERR_OPER_TIMEOUT if one is
+  // still pending at the deadline.
+  ::util::Status WaitForAll(absl::Time deadline) const;
+
+  // Returns the number of syncs added.
+  size_t num_syncs() const { return pending_syncs_.size(); }
+
+  // BfrtTableSyncTracker is neither copyable nor movable.
+  BfrtTableSyncTracker(const BfrtTableSyncTracker&) = delete;
+  BfrtTableSyncTracker& operator=(const BfrtTableSyncTracker&) = delete;
+
+ private:
+  // A sync operation which has been started and is waited for. The callback
+  // of the sync only holds a weak reference to the notifier.
+  struct PendingSync {
+    uint32 table_id;
+    const char* what;
+    std::shared_ptr<absl::Notification> notifier;
+  };
+
+  std::vector<PendingSync> pending_syncs_;
+};
+
+}  // namespace barefoot
+}  // namespace hal
+}  // namespace stratum
+
+#endif  // STRATUM_HAL_LIB_BAREFOOT_BFRT_TABLE_SYNC_TRACKER_H_
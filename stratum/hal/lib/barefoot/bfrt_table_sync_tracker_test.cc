@@ -0,0 +1,74 @@
+// Copyright 2020-present Open Networking Foundation
+// SPDX-License-Identifier: Apache-2.0
+
+#include "stratum/hal/lib/barefoot/bfrt_table_sync_tracker.h"
+
+#include <functional>
+#include <memory>
+#include <thread>  // NOLINT
+#include <vector>
+
+#include "absl/memory/memory.h"
+#include "absl/synchronization/notification.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "stratum/glue/status/status_test_util.h"
+#include "stratum/lib/test_utils/matchers.h"
+#include "stratum/public/lib/error.h"
+
+using ::stratum::test_utils::StatusIs;
+using ::testing::HasSubstr;
+
+namespace stratum {
+namespace hal {
+namespace barefoot {
+
+// The syncs are waited for together: here the (simulated) hardware only
+// completes any of them once all are started, and in reverse order, which
+// would time out if each sync was waited for before starting the next one.
+TEST(BfrtTableSyncTrackerTest, WaitsForSyncsStartedTogether) {
+  BfrtTableSyncTracker sync_tracker;
+  absl::Notification all_started;
+  std::vector<std::thread> syncs;
+  for (int i = 0; i < 3; ++i) {
+    auto sync_done = sync_tracker.AddSync(20 + i, "counters");
+    syncs.emplace_back([&all_started, sync_done, i]() {
+      all_started.WaitForNotification();
+      absl::SleepFor(absl::Milliseconds(10 * (3 - i)));
+      sync_done();
+    });
+  }
+  all_started.Notify();
+  EXPECT_EQ(3, sync_tracker.num_syncs());
+  EXPECT_OK(sync_tracker.WaitForAll(absl::Now() + absl::Seconds(10)));
+  for (auto& sync : syncs) sync.join();
+}
+
+TEST(BfrtTableSyncTrackerTest, WaitForAllFailsOnPendingSync) {
+  BfrtTableSyncTracker sync_tracker;
+  auto counters_done = sync_tracker.AddSync(21, "counters");
+  auto registers_done = sync_tracker.AddSync(22, "registers");
+  counters_done();
+  ::util::Status status =
+      sync_tracker.WaitForAll(absl::Now() + absl::Milliseconds(10));
+  EXPECT_THAT(status, StatusIs(StratumErrorSpace(), ERR_OPER_TIMEOUT,
+                               HasSubstr("registers of table 22")));
+
+  // The sync completes once it is done.
+  registers_done();
+  EXPECT_OK(sync_tracker.WaitForAll(absl::Now()));
+}
+
+TEST(BfrtTableSyncTrackerTest, CallbacksOutliveTracker) {
+  auto sync_tracker = absl::make_unique<BfrtTableSyncTracker>();
+  std::function<void()> sync_done = sync_tracker->AddSync(20, "counters");
+  sync_tracker.reset();
+  // The sync was abandoned, so its completion is ignored.
+  sync_done();
+}
+
+}  // namespace barefoot
+}  // namespace hal
+}  // namespace stratum
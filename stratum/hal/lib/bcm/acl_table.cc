@@ -52,7 +52,7 @@ BcmAclStage AclTable::P4PipelineToBcmAclStage(
 ::util::StatusOr<int> AclTable::BcmAclId(
     const ::p4::v1::TableEntry& entry) const {
   // Search for the entry.
-  const auto iter = bcm_acl_id_map_.find(entry);
+  const auto iter = bcm_acl_id_map_.find(TableEntryKey(entry));
   if (iter != bcm_acl_id_map_.end()) {
     return iter->second;
   }
@@ -71,13 +71,14 @@ BcmAclStage AclTable::P4PipelineToBcmAclStage(
 
 ::util::Status AclTable::DryRunInsertEntry(
     const ::p4::v1::TableEntry& entry) const {
-  const auto result = entries_.find(entry);
+  const auto result = entries_.find(TableEntryKey(entry));
   // Duplicate entry check.
   if (result != entries_.end()) {
     return MAKE_ERROR(ERR_ENTRY_EXISTS)
            << TableStr()
            << " contains duplicate of TableEntry: " << entry.ShortDebugString()
-           << ". Matching TableEntry: " << result->ShortDebugString() << ".";
+           << ". Matching TableEntry: " << result->second.ShortDebugString()
+           << ".";
   }
   // Table capacity check.
   if (EntryCount() == max_entries_) {
@@ -114,14 +115,15 @@ BcmAclStage AclTable::P4PipelineToBcmAclStage(
            << " does not contain TableEntry: " << entry.ShortDebugString()
            << ".";
   }
-  auto iter = bcm_acl_id_map_.find(entry);
+  TableEntryKey key(entry);
+  auto iter = bcm_acl_id_map_.find(key);
   if (iter != bcm_acl_id_map_.end()) {
     return MAKE_ERROR(ERR_INTERNAL)
            << "Unexpected scenario in " << TableStr()
            << ": Leftover Bcm ACL ID <" << iter->second
            << "> found for TableEntry: " << entry.ShortDebugString() << ".";
   }
-  bcm_acl_id_map_[entry] = bcm_acl_id;
+  bcm_acl_id_map_.emplace(std::move(key), bcm_acl_id);
   return ::util::OkStatus();
 }
 
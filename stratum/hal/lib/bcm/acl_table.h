@@ -149,11 +149,9 @@ class AclTable : public BcmFlowTable {
   // Returns an error if the entry cannot be added.
   util::StatusOr<p4::v1::TableEntry> ModifyEntry(
       const ::p4::v1::TableEntry& entry) override {
-    // Remove the entry, but don't remove the record in bcm_acl_id_map_.
-    ASSIGN_OR_RETURN(p4::v1::TableEntry old_entry,
-                     BcmFlowTable::DeleteEntry(entry));
-    entries_.insert(entry);
-    return old_entry;
+    // The entry is replaced in place, so the record in bcm_acl_id_map_ stays
+    // valid.
+    return BcmFlowTable::ModifyEntry(entry);
   }
 
   // Attempts to set the Bcm ACL ID for an entry in this table.
@@ -166,7 +164,7 @@ class AclTable : public BcmFlowTable {
       const ::p4::v1::TableEntry& entry) override {
     // We aren't interested in the return for erase since it's possible nobody
     // ever set the associated Bcm ACL ID.
-    bcm_acl_id_map_.erase(entry);
+    bcm_acl_id_map_.erase(TableEntryKey(entry));
     return BcmFlowTable::DeleteEntry(entry);
   }
 
@@ -193,9 +191,7 @@ class AclTable : public BcmFlowTable {
   // match_fields_.
   absl::flat_hash_set<uint32> udf_match_fields_;
   // Mapping from entries to their respective Bcm ACL IDs.
-  absl::flat_hash_map<::p4::v1::TableEntry, uint32,
-  TableEntryHash, TableEntryEqual>
-      bcm_acl_id_map_;
+  absl::flat_hash_map<TableEntryKey, uint32> bcm_acl_id_map_;
   // Stores const conditions
   absl::flat_hash_map<P4HeaderType, bool,
   EnumHash<P4HeaderType>> const_conditions_;
@@ -9,6 +9,7 @@
 #include <algorithm>
 #include <set>
 #include <sstream>  // IWYU pragma: keep
+#include <utility>
 
 #include "absl/container/flat_hash_map.h"
 #include "absl/memory/memory.h"
@@ -145,6 +146,7 @@ BcmChassisManager::~BcmChassisManager() {
                << "true. You did not call Shutdown() before deleting the class "
                << "instance. This can lead to unexpected behavior.";
   }
+  node_id_to_port_counters_poller_.clear();
   CleanupInternalState();
 }
 
@@ -174,6 +176,35 @@ BcmChassisManager::~BcmChassisManager() {
     RETURN_IF_ERROR(ConfigurePortGroups());
   }
 
+  // The nodes added by this push get a port counters poller. Its sweeps are
+  // skipped until the push is done.
+  for (const auto& e : node_id_to_unit_) {
+    const uint64 node_id = e.first;
+    if (node_id_to_port_counters_poller_.count(node_id)) continue;
+    auto poller = absl::make_unique<PortCountersPoller>(
+        node_id,
+        [this, node_id](std::map<uint32, PortCounters>* counters) {
+          return ReadPortCounters(node_id, counters);
+        },
+        [this, node_id](uint32 port_id, const PortCounters& counters) {
+          SendPortCountersGnmiEvent(node_id, port_id, counters);
+        });
+    RETURN_IF_ERROR(poller->Start());
+    node_id_to_port_counters_poller_[node_id] = std::move(poller);
+  }
+
+  // The nodes dropped by this push have their poller stopped. The pollers
+  // never wait for chassis_lock (see ReadPortCounters()), so they can be
+  // stopped while the push holds it.
+  for (auto it = node_id_to_port_counters_poller_.begin();
+       it != node_id_to_port_counters_poller_.end();) {
+    if (node_id_to_unit_.count(it->first)) {
+      ++it;
+    } else {
+      it = node_id_to_port_counters_poller_.erase(it);
+    }
+  }
+
   return ::util::OkStatus();
 }
 
@@ -217,6 +248,14 @@ BcmChassisManager::~BcmChassisManager() {
 
 ::util::Status BcmChassisManager::Shutdown() {
   ::util::Status status = ::util::OkStatus();
+  // Stop the port counters pollers first, without holding chassis_lock, which
+  // their sweeps take.
+  std::map<uint64, std::unique_ptr<PortCountersPoller>> pollers;
+  {
+    absl::WriterMutexLock l(&chassis_lock);
+    pollers.swap(node_id_to_port_counters_poller_);
+  }
+  pollers.clear();
   APPEND_STATUS_IF_ERROR(status, UnregisterEventWriters());
   APPEND_STATUS_IF_ERROR(status, bcm_sdk_interface_->ShutdownAllUnits());
   initialized_ = false;  // Set to false even if there is an error
@@ -460,6 +499,67 @@ BcmChassisManager::GetTrunkIdToSdkTrunkMap(uint64 node_id) const {
   return bcm_sdk_interface_->GetPortCounters(unit, bcm_port.logical_port(), pc);
 }
 
+::util::Status BcmChassisManager::GetNodePortCounters(
+    uint64 node_id, const std::vector<uint32>& port_ids,
+    std::map<uint32, PortCounters>* counters) const {
+  if (!initialized_) {
+    return MAKE_ERROR(ERR_NOT_INITIALIZED) << "Not initialized!";
+  }
+  CHECK_RETURN_IF_FALSE(counters != nullptr) << "counters is null.";
+  ASSIGN_OR_RETURN(auto unit, GetUnitFromNodeId(node_id));
+  const auto* port_id_to_port_key =
+      gtl::FindOrNull(node_id_to_port_id_to_singleton_port_key_, node_id);
+  CHECK_RETURN_IF_FALSE(port_id_to_port_key != nullptr)
+      << "Unknown node " << node_id << ".";
+  std::map<uint32, int> port_id_to_logical_port;
+  if (port_ids.empty()) {
+    for (const auto& e : *port_id_to_port_key) {
+      ASSIGN_OR_RETURN(auto bcm_port, GetBcmPort(node_id, e.first));
+      port_id_to_logical_port[e.first] = bcm_port.logical_port();
+    }
+  } else {
+    for (uint32 port_id : port_ids) {
+      ASSIGN_OR_RETURN(auto bcm_port, GetBcmPort(node_id, port_id));
+      port_id_to_logical_port[port_id] = bcm_port.logical_port();
+    }
+  }
+
+  counters->clear();
+  std::map<int, PortCounters> logical_port_to_counters;
+  RETURN_IF_ERROR(
+      bcm_sdk_interface_->GetAllPortCounters(unit, &logical_port_to_counters));
+  for (const auto& e : port_id_to_logical_port) {
+    auto* port_counters = gtl::FindOrNull(logical_port_to_counters, e.second);
+    if (port_counters == nullptr) {
+      // The other ports are still reported.
+      LOG_EVERY_N(WARNING, 100) << "No counters for port " << e.first
+                                << " in node " << node_id << " (logical port "
+                                << e.second << ").";
+      continue;
+    }
+    (*counters)[e.first] = std::move(*port_counters);
+  }
+
+  return ::util::OkStatus();
+}
+
+::util::Status BcmChassisManager::ReadPortCounters(
+    uint64 node_id, std::map<uint32, PortCounters>* counters) {
+  // A sweep does not wait for a config push, which may stop its poller.
+  if (!chassis_lock.ReaderTryLock()) {
+    return MAKE_ERROR(ERR_NO_OP).without_logging()
+           << "The chassis lock is held, skipping the sweep.";
+  }
+  ::util::Status status;
+  if (shutdown) {
+    status = MAKE_ERROR(ERR_CANCELLED) << "The class is already shutdown.";
+  } else {
+    status = GetNodePortCounters(node_id, {}, counters);
+  }
+  chassis_lock.ReaderUnlock();
+  return status;
+}
+
 ::util::Status BcmChassisManager::SetTrunkMemberBlockState(
     uint64 node_id, uint32 trunk_id, uint32 port_id,
     TrunkMemberBlockState state) {
@@ -1884,6 +1984,17 @@ void BcmChassisManager::SendPortOperStateGnmiEvent(uint64 node_id,
   }
 }
 
+void BcmChassisManager::SendPortCountersGnmiEvent(
+    uint64 node_id, uint32 port_id, const PortCounters& counters) {
+  absl::ReaderMutexLock l(&gnmi_event_lock_);
+  if (!gnmi_event_writer_) return;
+  if (!gnmi_event_writer_->Write(GnmiEventPtr(
+          new PortCountersChangedEvent(node_id, port_id, counters)))) {
+    // Remove WriterInterface if it is no longer operational.
+    gnmi_event_writer_.reset();
+  }
+}
+
 void* BcmChassisManager::TransceiverEventHandlerThreadFunc(void* arg) {
   CHECK(arg != nullptr);
   // Retrieve arguments.
@@ -28,6 +28,7 @@
 #include "stratum/hal/lib/common/common.pb.h"
 #include "stratum/hal/lib/common/gnmi_events.h"
 #include "stratum/hal/lib/common/phal_interface.h"
+#include "stratum/hal/lib/common/port_counters_poller.h"
 #include "stratum/hal/lib/common/writer_interface.h"
 #include "stratum/lib/channel/channel.h"
 
@@ -143,6 +144,10 @@ class BcmChassisManager : public BcmChassisRoInterface {
   ::util::Status GetPortCounters(uint64 node_id, uint32 port_id,
                                  PortCounters* pc) const override
       SHARED_LOCKS_REQUIRED(chassis_lock);
+  ::util::Status GetNodePortCounters(
+      uint64 node_id, const std::vector<uint32>& port_ids,
+      std::map<uint32, PortCounters>* counters) const override
+      SHARED_LOCKS_REQUIRED(chassis_lock);
 
   // Sets the block state of a trunk member on a node specified by node_id. The
   // id of the member is given by port_id. The ID of the trunk which the port is
@@ -362,6 +367,20 @@ class BcmChassisManager : public BcmChassisRoInterface {
                                   PortState new_state)
       SHARED_LOCKS_REQUIRED(chassis_lock) LOCKS_EXCLUDED(gnmi_event_lock_);
 
+  // Forward the counters of a port which changed since the previous sweep of
+  // its node's PortCountersPoller through the registered
+  // WriterInterface<GnmiEventPtr> object.
+  void SendPortCountersGnmiEvent(uint64 node_id, uint32 port_id,
+                                 const PortCounters& counters)
+      LOCKS_EXCLUDED(gnmi_event_lock_);
+
+  // Reads the counters of all the ports of a node, keyed by port ID. Used as
+  // the ReadFunc of the PortCountersPoller of the node. Returns ERR_NO_OP
+  // rather than wait if chassis_lock is held by a writer.
+  ::util::Status ReadPortCounters(uint64 node_id,
+                                  std::map<uint32, PortCounters>* counters)
+      LOCKS_EXCLUDED(chassis_lock);
+
   // Sets the speed for a flex port group after a chassis config is pushed. The
   // input is a PortKey encapsulating (slot, port) of the port group. The
   // function determines if there is a change in the speed based on the pushed
@@ -605,6 +624,14 @@ class BcmChassisManager : public BcmChassisRoInterface {
   // Map from unit to BcmNode instance.
   std::map<int, BcmNode*> unit_to_bcm_node_;  // not owned by this class.
 
+  // Map from node ID to the poller publishing the port counters which changed
+  // to the ON_CHANGE gNMI subscriptions. The pollers are created by the first
+  // config push of a node, and stopped by the push which drops the node, or by
+  // Shutdown() or the destructor before the rest of the state is cleaned up.
+  // Accessed under chassis_lock.
+  std::map<uint64, std::unique_ptr<PortCountersPoller>>
+      node_id_to_port_counters_poller_;
+
   friend class BcmChassisManagerTest;
 };
 
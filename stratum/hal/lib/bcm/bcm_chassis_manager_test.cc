@@ -4,6 +4,7 @@
 
 #include "stratum/hal/lib/bcm/bcm_chassis_manager.h"
 
+#include <map>
 #include <memory>
 #include <string>
 #include <tuple>
@@ -38,6 +39,7 @@ DECLARE_string(bcm_sdk_config_flush_file);
 DECLARE_string(bcm_sdk_shell_log_file);
 DECLARE_string(bcm_sdk_checkpoint_dir);
 DECLARE_string(test_tmpdir);
+DECLARE_int32(port_counters_poll_interval_ms);
 
 using ::testing::_;
 using ::testing::DoAll;
@@ -66,6 +68,14 @@ MATCHER_P(GnmiEventEq, event, "") {
            cast_event.GetNodeId() == cast_arg.GetNodeId() &&
            cast_event.GetNewState() == cast_arg.GetNewState();
   }
+  if (absl::StrContains(typeid(*event).name(), "PortCountersChangedEvent")) {
+    const auto& cast_event =
+        static_cast<const PortCountersChangedEvent&>(*event);
+    const auto& cast_arg = static_cast<const PortCountersChangedEvent&>(*arg);
+    return cast_event.GetPortId() == cast_arg.GetPortId() &&
+           cast_event.GetNodeId() == cast_arg.GetNodeId() &&
+           cast_event.GetInOctets() == cast_arg.GetInOctets();
+  }
   return false;
 }
 
@@ -82,6 +92,8 @@ class BcmChassisManagerTest : public ::testing::TestWithParam<OperationMode> {
     FLAGS_bcm_sdk_config_flush_file = FLAGS_test_tmpdir + "/config.bcm.tmp";
     FLAGS_bcm_sdk_shell_log_file = FLAGS_test_tmpdir + "/bcm.log";
     FLAGS_bcm_sdk_checkpoint_dir = FLAGS_test_tmpdir + "/sdk_checkpoint/";
+    // The tests sweep the port counters themselves.
+    FLAGS_port_counters_poll_interval_ms = 0;
   }
 
   void SetUp() override {
@@ -158,6 +170,8 @@ class BcmChassisManagerTest : public ::testing::TestWithParam<OperationMode> {
     CHECK_RETURN_IF_FALSE(bcm_chassis_manager_->applied_bcm_chassis_map_ ==
                           nullptr);
     CHECK_RETURN_IF_FALSE(bcm_chassis_manager_->xcvr_event_channel_ == nullptr);
+    CHECK_RETURN_IF_FALSE(
+        bcm_chassis_manager_->node_id_to_port_counters_poller_.empty());
     CHECK_RETURN_IF_FALSE(bcm_chassis_manager_->linkscan_event_channel_ ==
                           nullptr);
 
@@ -270,6 +284,14 @@ class BcmChassisManagerTest : public ::testing::TestWithParam<OperationMode> {
     return bcm_chassis_manager_->GetPortLoopbackState(node_id, port_id);
   }
 
+  ::util::Status GetNodePortCounters(
+      uint64 node_id, const std::vector<uint32>& port_ids,
+      std::map<uint32, PortCounters>* counters) const {
+    absl::ReaderMutexLock l(&chassis_lock);
+    return bcm_chassis_manager_->GetNodePortCounters(node_id, port_ids,
+                                                     counters);
+  }
+
   ::util::Status SetTrunkMemberBlockState(uint64 node_id, uint32 trunk_id,
                                           uint32 port_id,
                                           TrunkMemberBlockState state) {
@@ -301,6 +323,15 @@ class BcmChassisManagerTest : public ::testing::TestWithParam<OperationMode> {
     bcm_chassis_manager_->SendPortOperStateGnmiEvent(node_id, port_id, state);
   }
 
+  ::util::StatusOr<int> SweepPortCounters(uint64 node_id) {
+    auto it = bcm_chassis_manager_->node_id_to_port_counters_poller_.find(
+        node_id);
+    CHECK_RETURN_IF_FALSE(
+        it != bcm_chassis_manager_->node_id_to_port_counters_poller_.end())
+        << "No port counters poller for node " << node_id << ".";
+    return it->second->Sweep();
+  }
+
   bool IsInternalPort(const PortKey& port_key) const {
     return bcm_chassis_manager_->IsInternalPort(port_key);
   }
@@ -5219,6 +5250,95 @@ TEST_P(BcmChassisManagerTest, TestSendTransceiverGnmiEvent) {
   ASSERT_OK(ShutdownAndTestCleanState());
 }
 
+TEST_P(BcmChassisManagerTest, TestSendChangedPortCountersGnmiEvent) {
+  ASSERT_OK(PushTestConfig());
+
+  // Create and register writer for sending events.
+  auto writer = std::make_shared<WriterMock<GnmiEventPtr>>();
+  ASSERT_OK(RegisterEventNotifyWriter(writer));
+
+  // Port 12345 of node 7654321 is logical port 34 on unit 0.
+  PortCounters counters;
+  counters.set_in_octets(100);
+  EXPECT_CALL(*bcm_sdk_mock_, GetAllPortCounters(0, _))
+      .WillRepeatedly(DoAll(
+          SetArgPointee<1>(std::map<int, PortCounters>{{34, counters}}),
+          Return(::util::OkStatus())));
+
+  // The first sweep only records the counters, and nothing moved in the
+  // second one.
+  EXPECT_CALL(*writer, Write(_)).Times(0);
+  auto ret = SweepPortCounters(kNodeId);
+  ASSERT_OK(ret.status());
+  EXPECT_EQ(0, ret.ValueOrDie());
+  ret = SweepPortCounters(kNodeId);
+  ASSERT_OK(ret.status());
+  EXPECT_EQ(0, ret.ValueOrDie());
+  Mock::VerifyAndClear(writer.get());
+
+  counters.set_in_octets(200);
+  EXPECT_CALL(*bcm_sdk_mock_, GetAllPortCounters(0, _))
+      .WillRepeatedly(DoAll(
+          SetArgPointee<1>(std::map<int, PortCounters>{{34, counters}}),
+          Return(::util::OkStatus())));
+  GnmiEventPtr event(new PortCountersChangedEvent(kNodeId, kPortId, counters));
+  EXPECT_CALL(*writer, Write(Matcher<const GnmiEventPtr&>(GnmiEventEq(event))))
+      .WillOnce(Return(true));
+  ret = SweepPortCounters(kNodeId);
+  ASSERT_OK(ret.status());
+  EXPECT_EQ(1, ret.ValueOrDie());
+
+  ASSERT_OK(UnregisterEventNotifyWriter());
+
+  ASSERT_OK(ShutdownAndTestCleanState());
+}
+
+TEST_P(BcmChassisManagerTest, TestGetNodePortCounters) {
+  ASSERT_OK(PushTestConfig());
+
+  // Port 12345 of node 7654321 is logical port 34 on unit 0. The SDK returns
+  // the counters of all the logical ports of the unit.
+  PortCounters counters;
+  counters.set_in_octets(100);
+  counters.set_out_octets(200);
+  PortCounters other_counters;
+  other_counters.set_in_octets(300);
+  EXPECT_CALL(*bcm_sdk_mock_, GetAllPortCounters(0, _))
+      .WillRepeatedly(DoAll(SetArgPointee<1>(std::map<int, PortCounters>{
+                                {34, counters}, {38, other_counters}}),
+                            Return(::util::OkStatus())));
+  EXPECT_CALL(*bcm_sdk_mock_, GetPortCounters(_, _, _)).Times(0);
+
+  // All the ports of the node.
+  std::map<uint32, PortCounters> node_counters;
+  ASSERT_OK(GetNodePortCounters(kNodeId, {}, &node_counters));
+  ASSERT_EQ(1U, node_counters.size());
+  EXPECT_THAT(node_counters[kPortId], EqualsProto(counters));
+
+  // The listed ports.
+  node_counters.clear();
+  ASSERT_OK(GetNodePortCounters(kNodeId, {kPortId}, &node_counters));
+  ASSERT_EQ(1U, node_counters.size());
+  EXPECT_THAT(node_counters[kPortId], EqualsProto(counters));
+
+  // Unknown node or port.
+  EXPECT_FALSE(GetNodePortCounters(kNodeId + 1, {}, &node_counters).ok());
+  EXPECT_FALSE(
+      GetNodePortCounters(kNodeId, {kPortId + 1}, &node_counters).ok());
+
+  // The SDK returned no counters for the port, which is left out rather than
+  // failing the read of the node.
+  EXPECT_CALL(*bcm_sdk_mock_, GetAllPortCounters(0, _))
+      .WillOnce(DoAll(SetArgPointee<1>(std::map<int, PortCounters>{
+                          {38, other_counters}}),
+                      Return(::util::OkStatus())));
+  node_counters.clear();
+  ASSERT_OK(GetNodePortCounters(kNodeId, {}, &node_counters));
+  EXPECT_TRUE(node_counters.empty());
+
+  ASSERT_OK(ShutdownAndTestCleanState());
+}
+
 TEST_P(BcmChassisManagerTest, TestSetTrunkMemberBlockStateByController) {
   ASSERT_OK(PushTestConfig());
 
@@ -8,6 +8,7 @@
 #include <map>
 #include <string>
 #include <set>
+#include <vector>
 
 #include "stratum/hal/lib/bcm/bcm.pb.h"
 #include "stratum/hal/lib/bcm/utils.h"
@@ -90,6 +91,14 @@ class BcmChassisRoInterface {
   virtual ::util::Status GetPortCounters(uint64 node_id, uint32 port_id,
                                          PortCounters* pc) const = 0;
 
+  // Gets the counters of the given singleton ports of a node, keyed by port
+  // ID, reading the counters of all the ports of the unit at once. All the
+  // singleton ports of the node if port_ids is empty. The ports whose counters
+  // the SDK does not return are left out.
+  virtual ::util::Status GetNodePortCounters(
+      uint64 node_id, const std::vector<uint32>& port_ids,
+      std::map<uint32, PortCounters>* counters) const = 0;
+
  protected:
   // Default constructor.
   BcmChassisRoInterface() {}
@@ -7,6 +7,7 @@
 
 #include <map>
 #include <set>
+#include <vector>
 
 #include "gmock/gmock.h"
 #include "stratum/hal/lib/bcm/bcm_chassis_ro_interface.h"
@@ -53,6 +54,10 @@ class BcmChassisRoMock : public BcmChassisRoInterface {
   MOCK_CONST_METHOD3(GetPortCounters,
                      ::util::Status(uint64 node_id, uint32 port_id,
                                     PortCounters* pc));
+  MOCK_CONST_METHOD3(GetNodePortCounters,
+                     ::util::Status(uint64 node_id,
+                                    const std::vector<uint32>& port_ids,
+                                    std::map<uint32, PortCounters>* counters));
 };
 
 }  // namespace bcm
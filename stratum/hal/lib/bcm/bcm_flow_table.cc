@@ -0,0 +1,90 @@
+// Copyright 2018 Google LLC
+// Copyright 2018-present Open Networking Foundation
+// SPDX-License-Identifier: Apache-2.0
+
+
+#include "stratum/hal/lib/bcm/bcm_flow_table.h"
+
+#include <algorithm>
+#include <tuple>
+
+#include "absl/strings/string_view.h"
+
+namespace stratum {
+namespace hal {
+namespace bcm {
+
+TableEntryKey::TableEntryKey(const ::p4::v1::TableEntry& entry)
+    : priority_(entry.priority()),
+      is_default_action_(entry.is_default_action()),
+      idle_timeout_ns_(entry.idle_timeout_ns()),
+      has_time_since_last_hit_(entry.has_time_since_last_hit()),
+      time_since_last_hit_ns_(entry.time_since_last_hit().elapsed_ns()),
+      metadata_(entry.metadata()),
+      match_(),
+      hash_(0) {
+  // Sort pointers to the match fields rather than the fields themselves so
+  // that the input proto is neither copied nor modified. Entries only have a
+  // handful of match fields, so this stays on the stack.
+  absl::InlinedVector<const ::p4::v1::FieldMatch*, 8> fields;
+  fields.reserve(entry.match_size());
+  for (const auto& field : entry.match()) fields.push_back(&field);
+  std::sort(fields.begin(), fields.end(),
+            [](const ::p4::v1::FieldMatch* l, const ::p4::v1::FieldMatch* r) {
+              if (l->field_id() != r->field_id()) {
+                return l->field_id() < r->field_id();
+              }
+              // Duplicate field IDs are invalid, but we still need a strict
+              // ordering to keep the key independent of the field order.
+              return ProtoSerialize(*l) < ProtoSerialize(*r);
+            });
+  for (const auto* field : fields) AppendFieldMatch(*field);
+  hash_ = absl::Hash<std::tuple<int32, bool, int64, bool, int64,
+                                absl::string_view, absl::string_view>>()(
+      std::make_tuple(priority_, is_default_action_, idle_timeout_ns_,
+                      has_time_since_last_hit_, time_since_last_hit_ns_,
+                      absl::string_view(metadata_),
+                      absl::string_view(match_.data(), match_.size())));
+}
+
+void TableEntryKey::AppendFieldMatch(const ::p4::v1::FieldMatch& field) {
+  AppendUint32(field.field_id());
+  AppendUint32(static_cast<uint32>(field.field_match_type_case()));
+  switch (field.field_match_type_case()) {
+    case ::p4::v1::FieldMatch::kExact:
+      AppendBytes(field.exact().value());
+      break;
+    case ::p4::v1::FieldMatch::kTernary:
+      AppendBytes(field.ternary().value());
+      AppendBytes(field.ternary().mask());
+      break;
+    case ::p4::v1::FieldMatch::kLpm:
+      AppendBytes(field.lpm().value());
+      AppendUint32(static_cast<uint32>(field.lpm().prefix_len()));
+      break;
+    case ::p4::v1::FieldMatch::kRange:
+      AppendBytes(field.range().low());
+      AppendBytes(field.range().high());
+      break;
+    default:
+      // Match kinds not used by BCM tables are rare; fall back to their
+      // serialized form.
+      AppendBytes(ProtoSerialize(field));
+      break;
+  }
+}
+
+void TableEntryKey::AppendUint32(uint32 value) {
+  const char* bytes = reinterpret_cast<const char*>(&value);
+  match_.insert(match_.end(), bytes, bytes + sizeof(value));
+}
+
+void TableEntryKey::AppendBytes(const std::string& bytes) {
+  // Length-prefix each value so that adjacent values can not alias.
+  AppendUint32(static_cast<uint32>(bytes.size()));
+  match_.insert(match_.end(), bytes.begin(), bytes.end());
+}
+
+}  // namespace bcm
+}  // namespace hal
+}  // namespace stratum
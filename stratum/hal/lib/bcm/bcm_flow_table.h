@@ -6,15 +6,18 @@
 #ifndef STRATUM_HAL_LIB_BCM_BCM_FLOW_TABLE_H_
 #define STRATUM_HAL_LIB_BCM_BCM_FLOW_TABLE_H_
 
+#include <cstddef>
+#include <iterator>
 #include <utility>
 #include <string>
-#include <algorithm>
 
 #include "stratum/glue/status/status_macros.h"
 #include "stratum/lib/utils.h"
 #include "stratum/public/lib/error.h"
 #include "stratum/glue/integral_types.h"
-#include "absl/container/node_hash_set.h"
+#include "absl/container/inlined_vector.h"
+#include "absl/container/node_hash_map.h"
+#include "absl/hash/hash.h"
 #include "p4/v1/p4runtime.pb.h"
 #include "stratum/glue/status/status.h"
 #include "stratum/glue/status/statusor.h"
@@ -26,69 +29,129 @@ namespace stratum {
 namespace hal {
 namespace bcm {
 
-// Custom hash and equal function for P4 TableEntry protos. We need a way
-// to differeniate flows in the following way: If we have 2 flows f1 and f2
-// with f2 being the modified version of f1 as intended by the controller, f1
-// = f2. In any other case they should not.
+// TableEntryKey is the canonical, precomputed identity of a P4 TableEntry as
+// seen by a BcmFlowTable. We need a way to differeniate flows in the following
+// way: If we have 2 flows f1 and f2 with f2 being the modified version of f1 as
+// intended by the controller, f1 = f2. In any other case they should not. Two
+// entries therefore map to the same key iff all of the following match:
+// 1) TableEntry.match (all matches, regardless of their order)
+// 2) TableEntry.priority
+// 3) TableEntry.is_default_action
+// 4) TableEntry.idle_timeout_ns
+// 5) TableEntry.time_since_last_hit
+// 6) TableEntry.metadata
+// The table ID is not part of the key as all entries in a table share it. The
+// action, controller metadata, meter config and counter data are not part of
+// the key either, as those are what a modify changes. The key is built once per
+// entry, without copying or serializing the proto, and is cheap to hash and
+// compare afterwards.
+class TableEntryKey {
+ public:
+  explicit TableEntryKey(const ::p4::v1::TableEntry& entry);
+
+  TableEntryKey(const TableEntryKey& other) = default;
+  TableEntryKey(TableEntryKey&& other) = default;
+  TableEntryKey& operator=(const TableEntryKey& other) = default;
+  TableEntryKey& operator=(TableEntryKey&& other) = default;
+
+  bool operator==(const TableEntryKey& other) const {
+    return hash_ == other.hash_ && priority_ == other.priority_ &&
+           is_default_action_ == other.is_default_action_ &&
+           idle_timeout_ns_ == other.idle_timeout_ns_ &&
+           has_time_since_last_hit_ == other.has_time_since_last_hit_ &&
+           time_since_last_hit_ns_ == other.time_since_last_hit_ns_ &&
+           metadata_ == other.metadata_ && match_ == other.match_;
+  }
+  bool operator!=(const TableEntryKey& other) const {
+    return !(*this == other);
+  }
+
+  template <typename H>
+  friend H AbslHashValue(H h, const TableEntryKey& key) {
+    return H::combine(std::move(h), key.hash_);
+  }
+
+ private:
+  // Size of the inline buffer holding the encoded match fields. Chosen so that
+  // the common L2/L3 entries (a few exact/LPM/ternary fields on IPv4/IPv6
+  // addresses) never spill to the heap.
+  static constexpr size_t kInlineMatchBytes = 96;
+
+  // Appends the canonical encoding of a single match field to match_.
+  void AppendFieldMatch(const ::p4::v1::FieldMatch& field);
+  void AppendUint32(uint32 value);
+  void AppendBytes(const std::string& bytes);
+
+  int32 priority_;
+  bool is_default_action_;
+  int64 idle_timeout_ns_;
+  bool has_time_since_last_hit_;
+  int64 time_since_last_hit_ns_;
+  // Opaque controller metadata. Usually empty, so it does not allocate.
+  std::string metadata_;
+  // Length-prefixed encoding of all the match fields, sorted by field ID.
+  absl::InlinedVector<char, kInlineMatchBytes> match_;
+  // Precomputed hash over all the members above.
+  size_t hash_;
+};
+
+// Custom hash and equal function for P4 TableEntry protos, for containers that
+// need to be keyed directly by TableEntry. Both build a TableEntryKey on the
+// fly. Prefer keying containers by TableEntryKey where the key can be reused.
 struct TableEntryHash {
   size_t operator()(const ::p4::v1::TableEntry& x) const {
-    // Save a copy of the input proto, clear actions/metadata/counter/meter,
-    // and hash the rest.
-    ::p4::v1::TableEntry a = x;
-    a.clear_table_id();
-    a.clear_action();
-    a.clear_controller_metadata();
-    a.clear_meter_config();
-    a.clear_counter_data();
-    // Hash on match field combination, not on permutation.
-    std::sort(a.mutable_match()->begin(), a.mutable_match()->end(),
-              [](const ::p4::v1::FieldMatch& l, const ::p4::v1::FieldMatch& r) {
-                return ProtoSerialize(l) < ProtoSerialize(r);
-              });
-    return std::hash<std::string>()(ProtoSerialize(a));
+    return absl::Hash<TableEntryKey>()(TableEntryKey(x));
   }
 };
 
 struct TableEntryEqual {
   bool operator()(const ::p4::v1::TableEntry& x,
                   const ::p4::v1::TableEntry& y) const {
-    // Save copies of the input protos, clear actions/metadata/counter/meter
-    // and compare the rest.
-    ::p4::v1::TableEntry a = x, b = y;
-    a.clear_table_id();
-    a.clear_action();
-    a.clear_controller_metadata();
-    a.clear_meter_config();
-    a.clear_counter_data();
-    b.clear_table_id();
-    b.clear_action();
-    b.clear_controller_metadata();
-    b.clear_meter_config();
-    b.clear_counter_data();
-    // The order of the match fields are not important.
-    if (a.match_size() != b.match_size() ||
-        !std::is_permutation(
-            a.match().begin(), a.match().end(), b.match().begin(),
-            [](const ::p4::v1::FieldMatch& l, const ::p4::v1::FieldMatch& r) {
-              return ProtoSerialize(l) == ProtoSerialize(r);
-            })) {
-      return false;
-    }
-    a.clear_match();
-    b.clear_match();
-    return ProtoSerialize(a) == ProtoSerialize(b);
+    return TableEntryKey(x) == TableEntryKey(y);
   }
 };
 
-using TableEntrySet =
-    absl::node_hash_set<::p4::v1::TableEntry, TableEntryHash, TableEntryEqual>;
+// Storage for the entries of a table, indexed by their TableEntryKey.
+using TableEntryMap = absl::node_hash_map<TableEntryKey, ::p4::v1::TableEntry>;
 
 // Class for managing a BCM table.
 class BcmFlowTable {
  public:
-  // STL-style types that allow table traversal.
-  using const_iterator = TableEntrySet::const_iterator;
-  using value_type = TableEntrySet::value_type;
+  // STL-style types that allow table traversal. Iterating a table yields the
+  // stored TableEntry protos.
+  using value_type = ::p4::v1::TableEntry;
+  class const_iterator {
+   public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = ::p4::v1::TableEntry;
+    using difference_type = std::ptrdiff_t;
+    using pointer = const ::p4::v1::TableEntry*;
+    using reference = const ::p4::v1::TableEntry&;
+
+    const_iterator() : iter_() {}
+    explicit const_iterator(TableEntryMap::const_iterator iter) : iter_(iter) {}
+
+    reference operator*() const { return iter_->second; }
+    pointer operator->() const { return &iter_->second; }
+    const_iterator& operator++() {
+      ++iter_;
+      return *this;
+    }
+    const_iterator operator++(int) {
+      const_iterator tmp = *this;
+      ++iter_;
+      return tmp;
+    }
+    bool operator==(const const_iterator& other) const {
+      return iter_ == other.iter_;
+    }
+    bool operator!=(const const_iterator& other) const {
+      return iter_ != other.iter_;
+    }
+
+   private:
+    TableEntryMap::const_iterator iter_;
+  };
 
   // Constructors.
   explicit BcmFlowTable(uint32 p4_table_id)
@@ -135,7 +198,7 @@ class BcmFlowTable {
 
   // Returns true if this table already has this entry.
   virtual bool HasEntry(const ::p4::v1::TableEntry& entry) const {
-    return entries_.count(entry) > 0;
+    return entries_.count(TableEntryKey(entry)) > 0;
   }
 
   // Returns the number of entries in this table.
@@ -148,17 +211,17 @@ class BcmFlowTable {
   // Returns ERR_ENTRY_NOT_FOUND if a matching entry is not found.
   virtual ::util::StatusOr<::p4::v1::TableEntry> Lookup(
       const ::p4::v1::TableEntry& key) const {
-    auto lookup = entries_.find(key);
+    auto lookup = entries_.find(TableEntryKey(key));
     if (lookup == entries_.end()) {
       return MAKE_ERROR(ERR_ENTRY_NOT_FOUND)
              << TableStr()
              << " does not contain TableEntry: " << key.ShortDebugString();
     }
-    return *lookup;
+    return lookup->second;
   }
 
-  TableEntrySet::const_iterator begin() const { return entries_.begin(); }
-  TableEntrySet::const_iterator end() const { return entries_.end(); }
+  const_iterator begin() const { return const_iterator(entries_.begin()); }
+  const_iterator end() const { return const_iterator(entries_.end()); }
 
   // Returns true if this is a const table.
   virtual bool IsConst() const { return is_const_; }
@@ -176,15 +239,14 @@ class BcmFlowTable {
   // 2) TableEntry.priority
   // 3) is_default_action
   //
-  // See TableEntryEqual below.
+  // See TableEntryKey above.
   virtual ::util::Status InsertEntry(const ::p4::v1::TableEntry& entry) {
-    auto result = entries_.insert(entry);
+    auto result = entries_.emplace(TableEntryKey(entry), entry);
     if (!result.second) {
       return MAKE_ERROR(ERR_ENTRY_EXISTS)
              << TableStr() << " contains duplicate of TableEntry: "
-             << entry.ShortDebugString()
-             << ". Matching TableEntry: " << result.first->ShortDebugString()
-             << ".";
+             << entry.ShortDebugString() << ". Matching TableEntry: "
+             << result.first->second.ShortDebugString() << ".";
     }
     return ::util::OkStatus();
   }
@@ -193,12 +255,12 @@ class BcmFlowTable {
   // inserted. If the entry can be inserted, returns ::util::OkStatus().
   virtual ::util::Status DryRunInsertEntry(
       const ::p4::v1::TableEntry& entry) const {
-    const auto result = entries_.find(entry);
+    const auto result = entries_.find(TableEntryKey(entry));
     if (result != entries_.end()) {
       return MAKE_ERROR(ERR_ENTRY_EXISTS)
              << TableStr() << " contains duplicate of TableEntry: "
-             << entry.ShortDebugString()
-             << ". Matching TableEntry: " << result->ShortDebugString() << ".";
+             << entry.ShortDebugString() << ". Matching TableEntry: "
+             << result->second.ShortDebugString() << ".";
     }
     return ::util::OkStatus();
   }
@@ -209,8 +271,17 @@ class BcmFlowTable {
   // Returns an error if the entry cannot be added.
   virtual ::util::StatusOr<::p4::v1::TableEntry> ModifyEntry(
       const ::p4::v1::TableEntry& entry) {
-    ASSIGN_OR_RETURN(::p4::v1::TableEntry old_entry, DeleteEntry(entry));
-    entries_.insert(entry);
+    // The modified entry has the same key as the original one, so it can be
+    // replaced in place.
+    auto lookup = entries_.find(TableEntryKey(entry));
+    if (lookup == entries_.end()) {
+      return MAKE_ERROR(ERR_ENTRY_NOT_FOUND)
+             << TableStr()
+             << " does not contain TableEntry: " << entry.ShortDebugString()
+             << ".";
+    }
+    ::p4::v1::TableEntry old_entry = std::move(lookup->second);
+    lookup->second = entry;
     return old_entry;
   }
 
@@ -219,14 +290,14 @@ class BcmFlowTable {
   // Returns ERR_ENTRY_NOT_FOUND if a matching entry does not already exist.
   virtual ::util::StatusOr<::p4::v1::TableEntry> DeleteEntry(
       const ::p4::v1::TableEntry& key) {
-    const auto lookup = entries_.find(key);
+    const auto lookup = entries_.find(TableEntryKey(key));
     if (lookup == entries_.end()) {
       return MAKE_ERROR(ERR_ENTRY_NOT_FOUND)
              << TableStr()
              << " does not contain TableEntry: " << key.ShortDebugString()
              << ".";
     }
-    ::p4::v1::TableEntry entry = *lookup;
+    ::p4::v1::TableEntry entry = std::move(lookup->second);
     entries_.erase(lookup);
     return entry;
   }
@@ -243,7 +314,7 @@ class BcmFlowTable {
   uint32 id_;
   std::string name_;
   // Keeps track of all entries currently in the table.
-  TableEntrySet entries_;
+  TableEntryMap entries_;
   // True is this is a const table. Const tables can only be modified during
   // SetForwardingPipelineConfig().
   bool is_const_;
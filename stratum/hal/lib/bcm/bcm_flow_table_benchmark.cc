@@ -0,0 +1,146 @@
+// Copyright 2018-present Open Networking Foundation
+// SPDX-License-Identifier: Apache-2.0
+
+// Benchmarks insert and lookup throughput of BcmFlowTable, which is keyed by
+// TableEntryKey, against a set keyed by the full TableEntry that copies and
+// serializes the proto for every hash and compare (the previous approach).
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "absl/container/node_hash_set.h"
+#include "benchmark/benchmark.h"
+#include "p4/v1/p4runtime.pb.h"
+#include "stratum/glue/logging.h"
+#include "stratum/hal/lib/bcm/bcm_flow_table.h"
+#include "stratum/lib/utils.h"
+
+namespace stratum {
+namespace hal {
+namespace bcm {
+namespace {
+
+struct LegacyTableEntryHash {
+  size_t operator()(const ::p4::v1::TableEntry& x) const {
+    ::p4::v1::TableEntry a = x;
+    a.clear_table_id();
+    a.clear_action();
+    a.clear_controller_metadata();
+    a.clear_meter_config();
+    a.clear_counter_data();
+    std::sort(a.mutable_match()->begin(), a.mutable_match()->end(),
+              [](const ::p4::v1::FieldMatch& l, const ::p4::v1::FieldMatch& r) {
+                return ProtoSerialize(l) < ProtoSerialize(r);
+              });
+    return std::hash<std::string>()(ProtoSerialize(a));
+  }
+};
+
+struct LegacyTableEntryEqual {
+  bool operator()(const ::p4::v1::TableEntry& x,
+                  const ::p4::v1::TableEntry& y) const {
+    ::p4::v1::TableEntry a = x, b = y;
+    for (auto* e : {&a, &b}) {
+      e->clear_table_id();
+      e->clear_action();
+      e->clear_controller_metadata();
+      e->clear_meter_config();
+      e->clear_counter_data();
+    }
+    if (a.match_size() != b.match_size() ||
+        !std::is_permutation(
+            a.match().begin(), a.match().end(), b.match().begin(),
+            [](const ::p4::v1::FieldMatch& l, const ::p4::v1::FieldMatch& r) {
+              return ProtoSerialize(l) == ProtoSerialize(r);
+            })) {
+      return false;
+    }
+    a.clear_match();
+    b.clear_match();
+    return ProtoSerialize(a) == ProtoSerialize(b);
+  }
+};
+
+using LegacyTableEntrySet =
+    absl::node_hash_set<::p4::v1::TableEntry, LegacyTableEntryHash,
+                        LegacyTableEntryEqual>;
+
+// Builds IPv4 LPM route-like entries: VRF exact match plus a /24 prefix.
+std::vector<::p4::v1::TableEntry> MakeRouteEntries(int count) {
+  std::vector<::p4::v1::TableEntry> entries;
+  entries.reserve(count);
+  for (int i = 0; i < count; ++i) {
+    ::p4::v1::TableEntry entry;
+    entry.set_table_id(1);
+    auto* vrf = entry.add_match();
+    vrf->set_field_id(1);
+    vrf->mutable_exact()->set_value(std::string(1, static_cast<char>(i % 4)));
+    auto* dst = entry.add_match();
+    dst->set_field_id(2);
+    const uint32 prefix = 0x0a000000 | (static_cast<uint32>(i) << 8);
+    std::string value(4, '\0');
+    for (int b = 0; b < 4; ++b) {
+      value[b] = static_cast<char>((prefix >> (24 - 8 * b)) & 0xff);
+    }
+    dst->mutable_lpm()->set_value(value);
+    dst->mutable_lpm()->set_prefix_len(24);
+    entry.mutable_action()->set_action_profile_member_id(i);
+    entries.push_back(entry);
+  }
+  return entries;
+}
+
+void BM_LegacySetInsert(benchmark::State& state) {
+  const auto entries = MakeRouteEntries(state.range(0));
+  for (auto _ : state) {
+    LegacyTableEntrySet set;
+    for (const auto& entry : entries) set.insert(entry);
+    benchmark::DoNotOptimize(set.size());
+  }
+  state.SetItemsProcessed(state.iterations() * entries.size());
+}
+BENCHMARK(BM_LegacySetInsert)->Arg(1000)->Arg(10000)->Arg(100000);
+
+void BM_BcmFlowTableInsert(benchmark::State& state) {
+  const auto entries = MakeRouteEntries(state.range(0));
+  for (auto _ : state) {
+    BcmFlowTable table(1);
+    for (const auto& entry : entries) {
+      CHECK(table.InsertEntry(entry).ok());
+    }
+    benchmark::DoNotOptimize(table.EntryCount());
+  }
+  state.SetItemsProcessed(state.iterations() * entries.size());
+}
+BENCHMARK(BM_BcmFlowTableInsert)->Arg(1000)->Arg(10000)->Arg(100000);
+
+void BM_LegacySetLookup(benchmark::State& state) {
+  const auto entries = MakeRouteEntries(state.range(0));
+  LegacyTableEntrySet set(entries.begin(), entries.end());
+  for (auto _ : state) {
+    for (const auto& entry : entries) {
+      benchmark::DoNotOptimize(set.count(entry));
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * entries.size());
+}
+BENCHMARK(BM_LegacySetLookup)->Arg(1000)->Arg(10000)->Arg(100000);
+
+void BM_BcmFlowTableLookup(benchmark::State& state) {
+  const auto entries = MakeRouteEntries(state.range(0));
+  BcmFlowTable table(1);
+  for (const auto& entry : entries) CHECK(table.InsertEntry(entry).ok());
+  for (auto _ : state) {
+    for (const auto& entry : entries) {
+      benchmark::DoNotOptimize(table.HasEntry(entry));
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * entries.size());
+}
+BENCHMARK(BM_BcmFlowTableLookup)->Arg(1000)->Arg(10000)->Arg(100000);
+
+}  // namespace
+}  // namespace bcm
+}  // namespace hal
+}  // namespace stratum
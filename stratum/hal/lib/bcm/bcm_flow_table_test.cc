@@ -2,6 +2,7 @@
 // Copyright 2018-present Open Networking Foundation
 // SPDX-License-Identifier: Apache-2.0
 
+#include <algorithm>
 #include <vector>
 
 #include "stratum/hal/lib/bcm/bcm_flow_table.h"
@@ -302,6 +303,84 @@ TEST(BcmFlowTableTest, DeleteMissingEntryFailure) {
   ASSERT_EQ(table.DeleteEntry(mod).status().error_code(), ERR_ENTRY_NOT_FOUND);
 }
 
+// Verify that the key of an entry does not depend on the match field order.
+TEST(TableEntryKeyTest, IgnoresMatchFieldOrder) {
+  ::p4::v1::TableEntry reordered = MockTableEntry();
+  std::reverse(reordered.mutable_match()->begin(),
+               reordered.mutable_match()->end());
+  EXPECT_EQ(TableEntryKey(MockTableEntry()), TableEntryKey(reordered));
+  EXPECT_EQ(TableEntryHash()(MockTableEntry()), TableEntryHash()(reordered));
+  EXPECT_TRUE(TableEntryEqual()(MockTableEntry(), reordered));
+
+  BcmFlowTable table(1);
+  ASSERT_OK(table.InsertEntry(MockTableEntry()));
+  EXPECT_TRUE(table.HasEntry(reordered));
+  EXPECT_EQ(table.InsertEntry(reordered).error_code(), ERR_ENTRY_EXISTS);
+}
+
+// Verify that values of different match fields can not alias each other in the
+// key.
+TEST(TableEntryKeyTest, DistinguishesMatchValueBoundaries) {
+  ::p4::v1::TableEntry a, b;
+  auto* match = a.add_match();
+  match->set_field_id(1);
+  match->mutable_ternary()->set_value("ab");
+  match->mutable_ternary()->set_mask("c");
+  match = b.add_match();
+  match->set_field_id(1);
+  match->mutable_ternary()->set_value("a");
+  match->mutable_ternary()->set_mask("bc");
+  EXPECT_NE(TableEntryKey(a), TableEntryKey(b));
+
+  // Same bytes with a different match kind.
+  ::p4::v1::TableEntry c, d;
+  c.add_match()->mutable_exact()->set_value("1");
+  d.add_match()->mutable_lpm()->set_value("1");
+  EXPECT_NE(TableEntryKey(c), TableEntryKey(d));
+}
+
+// Verify that the idle timeout, time since last hit and metadata of an entry
+// are part of its key, while the table ID is not.
+TEST(TableEntryKeyTest, KeepsNonModifiableFields) {
+  ::p4::v1::TableEntry entry = MockTableEntry();
+  entry.set_table_id(entry.table_id() + 1);
+  EXPECT_EQ(TableEntryKey(MockTableEntry()), TableEntryKey(entry));
+
+  entry = MockTableEntry();
+  entry.set_idle_timeout_ns(entry.idle_timeout_ns() + 1);
+  EXPECT_NE(TableEntryKey(MockTableEntry()), TableEntryKey(entry));
+
+  entry = MockTableEntry();
+  entry.mutable_time_since_last_hit();
+  EXPECT_NE(TableEntryKey(MockTableEntry()), TableEntryKey(entry));
+
+  entry = MockTableEntry();
+  entry.set_metadata(entry.metadata() + "1");
+  EXPECT_NE(TableEntryKey(MockTableEntry()), TableEntryKey(entry));
+
+  BcmFlowTable table(1);
+  ASSERT_OK(table.InsertEntry(MockTableEntry()));
+  EXPECT_FALSE(table.HasEntry(entry));
+}
+
+// Verify that iterating a table yields the stored entries.
+TEST(BcmFlowTableTest, IterateEntries) {
+  constexpr int kNumEntries = 4;
+  BcmFlowTable table(1);
+  for (int i = 0; i < kNumEntries; ++i) {
+    ::p4::v1::TableEntry entry = MockTableEntry();
+    entry.set_priority(i);
+    ASSERT_OK(table.InsertEntry(entry));
+  }
+  std::vector<int> priorities;
+  for (const auto& entry : table) {
+    EXPECT_EQ(entry.match_size(), MockTableEntry().match_size());
+    priorities.push_back(entry.priority());
+  }
+  std::sort(priorities.begin(), priorities.end());
+  EXPECT_THAT(priorities, ::testing::ElementsAre(0, 1, 2, 3));
+}
+
 // Verify the properties a BcmFlowTable inherits from a source
 // P4 config Table.
 TEST(BcmFlowTableTest, ConstructFromP4ConfigTable) {
@@ -369,6 +369,98 @@ BcmL3Manager::~BcmL3Manager() {}
   }
 }
 
+::util::Status BcmL3Manager::InsertTableEntries(
+    const std::vector<const ::p4::v1::TableEntry*>& entries,
+    std::vector<::util::Status>* results) {
+  CHECK_RETURN_IF_FALSE(results != nullptr);
+  results->assign(entries.size(), ::util::OkStatus());
+  std::vector<BcmSdkInterface::L3Route> routes;
+  std::vector<size_t> route_indices;  // index in entries of every route
+  routes.reserve(entries.size());
+  route_indices.reserve(entries.size());
+  for (size_t i = 0; i < entries.size(); ++i) {
+    BcmFlowEntry bcm_flow_entry;
+    BcmSdkInterface::L3Route route;
+    ::util::Status status = bcm_table_manager_->FillBcmFlowEntry(
+        *entries[i], ::p4::v1::Update::INSERT, &bcm_flow_entry);
+    if (status.ok()) status = FillL3Route(bcm_flow_entry, &route);
+    if (!status.ok()) {
+      (*results)[i] = status;
+      continue;
+    }
+    routes.push_back(std::move(route));
+    route_indices.push_back(i);
+  }
+
+  std::vector<::util::Status> route_results;
+  if (!routes.empty()) {
+    ::util::Status status =
+        bcm_sdk_interface_->AddL3Routes(unit_, routes, &route_results);
+    if (route_results.size() != routes.size()) {
+      if (status.ok()) {
+        status = MAKE_ERROR(ERR_INTERNAL)
+                 << "Got " << route_results.size() << " results for "
+                 << routes.size() << " L3 routes on unit " << unit_ << ".";
+      }
+      route_results.assign(routes.size(), status);
+    }
+  }
+  // Update the internal records in BcmTableManager for the routes added.
+  for (size_t k = 0; k < route_indices.size(); ++k) {
+    const size_t i = route_indices[k];
+    (*results)[i] = route_results[k].ok()
+                        ? bcm_table_manager_->AddTableEntry(*entries[i])
+                        : route_results[k];
+  }
+  bool success = true;
+  for (const auto& status : *results) success &= status.ok();
+  if (!success) {
+    return MAKE_ERROR(ERR_AT_LEAST_ONE_OPER_FAILED)
+           << "One or more L3 flows could not be inserted on unit " << unit_
+           << ".";
+  }
+
+  return ::util::OkStatus();
+}
+
+::util::Status BcmL3Manager::FillL3Route(const BcmFlowEntry& bcm_flow_entry,
+                                         BcmSdkInterface::L3Route* route) {
+  CHECK_RETURN_IF_FALSE(bcm_flow_entry.unit() == unit_)
+      << "Received L3 flow for unit " << bcm_flow_entry.unit() << " on unit "
+      << unit_ << ".";
+  const auto bcm_table_type = bcm_flow_entry.bcm_table_type();
+  switch (bcm_table_type) {
+    case BcmFlowEntry::BCM_TABLE_IPV4_LPM:
+    case BcmFlowEntry::BCM_TABLE_IPV4_HOST:
+    case BcmFlowEntry::BCM_TABLE_IPV6_LPM:
+    case BcmFlowEntry::BCM_TABLE_IPV6_HOST:
+      break;
+    default:
+      return MAKE_ERROR(ERR_INVALID_PARAM)
+             << "Invalid table_id: "
+             << BcmFlowEntry::BcmTableType_Name(bcm_table_type) << ", found in "
+             << bcm_flow_entry.ShortDebugString() << ".";
+  }
+  LpmOrHostKey key;
+  LpmOrHostActionParams action_params;
+  RETURN_IF_ERROR(ExtractLpmOrHostKey(bcm_flow_entry, &key));
+  RETURN_IF_ERROR(ExtractLpmOrHostActionParams(bcm_flow_entry, &action_params));
+  route->is_host = bcm_table_type == BcmFlowEntry::BCM_TABLE_IPV4_HOST ||
+                   bcm_table_type == BcmFlowEntry::BCM_TABLE_IPV6_HOST;
+  route->is_ipv6 = bcm_table_type == BcmFlowEntry::BCM_TABLE_IPV6_LPM ||
+                   bcm_table_type == BcmFlowEntry::BCM_TABLE_IPV6_HOST;
+  route->vrf = key.vrf;
+  route->subnet_ipv4 = key.subnet_ipv4;
+  route->mask_ipv4 = key.mask_ipv4;
+  route->subnet_ipv6 = key.subnet_ipv6;
+  route->mask_ipv6 = key.mask_ipv6;
+  route->class_id = action_params.class_id;
+  route->egress_intf_id = action_params.egress_intf_id;
+  route->is_intf_multipath = action_params.is_intf_multipath;
+
+  return ::util::OkStatus();
+}
+
 ::util::Status BcmL3Manager::ModifyTableEntry(
     const ::p4::v1::TableEntry& entry) {
   BcmFlowEntry bcm_flow_entry;
@@ -115,6 +115,15 @@ class BcmL3Manager {
   // low level routes into the given unit based on the given P4 TableEntry.
   virtual ::util::Status InsertTableEntry(const ::p4::v1::TableEntry& entry);
 
+  // Inserts a batch of IPv4/IPv6 L3 LPM/Host flows. Same as calling
+  // InsertTableEntry() for every entry, except that all the routes are given
+  // to the SDK in a single BcmSdkInterface::AddL3Routes() call. On return,
+  // results holds the status of every entry in the same order as entries.
+  // Returns error if at least one entry could not be inserted.
+  virtual ::util::Status InsertTableEntries(
+      const std::vector<const ::p4::v1::TableEntry*>& entries,
+      std::vector<::util::Status>* results);
+
   // Modifies an IPv4/IPv6 L3 LPM/Host flow. The function programs the
   // low level routes into the given unit based on the given P4 TableEntry. The
   // fields populated in P4 TableEntry are the same as the ones populated when
@@ -156,6 +165,11 @@ class BcmL3Manager {
   // low level routes into the given unit based on the given BcmFlowEntry.
   ::util::Status InsertLpmOrHostFlow(const BcmFlowEntry& bcm_flow_entry);
 
+  // Helper to build the route given to BcmSdkInterface::AddL3Routes() for an
+  // IPv4/IPv6 L3 LPM/Host flow given its BcmFlowEntry.
+  ::util::Status FillL3Route(const BcmFlowEntry& bcm_flow_entry,
+                             BcmSdkInterface::L3Route* route);
+
   // Modifies an IPv4/IPv6 L3 LPM/Host flow. The function programs the
   // low level routes into the given unit based on the given BcmFlowEntry. The
   // fields populated in BcmFlowEntry are the same as the ones populated when
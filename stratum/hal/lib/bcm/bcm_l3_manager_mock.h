@@ -34,6 +34,10 @@ class BcmL3ManagerMock : public BcmL3Manager {
   MOCK_METHOD1(DeleteMultipathNexthop, ::util::Status(int egress_intf_id));
   MOCK_METHOD1(InsertTableEntry,
                ::util::Status(const ::p4::v1::TableEntry& entry));
+  MOCK_METHOD2(InsertTableEntries,
+               ::util::Status(
+                   const std::vector<const ::p4::v1::TableEntry*>& entries,
+                   std::vector<::util::Status>* results));
   MOCK_METHOD1(ModifyTableEntry,
                ::util::Status(const ::p4::v1::TableEntry& entry));
   MOCK_METHOD1(DeleteTableEntry,
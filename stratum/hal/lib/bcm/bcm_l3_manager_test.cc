@@ -25,6 +25,7 @@ using test_utils::EqualsProto;
 using ::testing::_;
 using ::testing::DoAll;
 using ::testing::HasSubstr;
+using ::testing::Invoke;
 using ::testing::Return;
 using ::testing::SetArgPointee;
 using ::testing::StrictMock;
@@ -1532,6 +1533,184 @@ TEST_F(BcmL3ManagerTest, InsertLpmOrHostFlowP4ConversionFailure) {
   ASSERT_FALSE(bcm_l3_manager_->InsertTableEntry(p4_table_entry).ok());
 }
 
+TEST_F(BcmL3ManagerTest, InsertTableEntriesSuccessForMixedFlows) {
+  const std::string kBcmFlowEntryTexts[] = {
+      R"(
+        unit: 3
+        bcm_table_type: BCM_TABLE_IPV4_LPM
+        fields: {
+          type: IPV4_DST
+          value { u32: 0xc0a00100 }
+          mask { u32: 0xffffff00 }
+        }
+        fields: { type: VRF value { u32: 80 } }
+        actions: {
+          type: OUTPUT_L3
+          params { type: EGRESS_INTF_ID value { u32: 200256 } }
+        }
+      )",
+      R"(
+        unit: 3
+        bcm_table_type: BCM_TABLE_IPV4_HOST
+        fields: { type: IPV4_DST value { u32: 0xc0a00101 } }
+        actions: {
+          type: OUTPUT_PORT
+          params { type: EGRESS_INTF_ID value { u32: 100003 } }
+        }
+      )",
+      R"(
+        unit: 3
+        bcm_table_type: BCM_TABLE_IPV6_HOST
+        fields: {
+          type: IPV6_DST
+          value { b: "\x01\x02\x03\x04\x05\x06\x07\x08" }
+        }
+        actions: {
+          type: OUTPUT_PORT
+          params { type: EGRESS_INTF_ID value { u32: 100002 } }
+        }
+      )",
+  };
+
+  std::vector<::p4::v1::TableEntry> p4_table_entries;
+  for (const auto& text : kBcmFlowEntryTexts) {
+    BcmFlowEntry bcm_flow_entry;
+    ASSERT_OK(ParseProtoFromString(text, &bcm_flow_entry));
+    p4_table_entries.push_back(
+        ExpectFlowConversion(::p4::v1::Update::INSERT, bcm_flow_entry));
+  }
+
+  // All the routes must be given to the SDK in a single call.
+  EXPECT_CALL(*bcm_sdk_mock_, AddL3Routes(kUnit, _, _))
+      .WillOnce(Invoke([](int unit,
+                          const std::vector<BcmSdkInterface::L3Route>& routes,
+                          std::vector<::util::Status>* results) {
+        EXPECT_EQ(3U, routes.size());
+        if (routes.size() != 3U) return ::util::OkStatus();
+        EXPECT_FALSE(routes[0].is_host);
+        EXPECT_FALSE(routes[0].is_ipv6);
+        EXPECT_EQ(80, routes[0].vrf);
+        EXPECT_EQ(0xc0a00100, routes[0].subnet_ipv4);
+        EXPECT_EQ(0xffffff00, routes[0].mask_ipv4);
+        EXPECT_EQ(200256, routes[0].egress_intf_id);
+        EXPECT_TRUE(routes[0].is_intf_multipath);
+        EXPECT_TRUE(routes[1].is_host);
+        EXPECT_FALSE(routes[1].is_ipv6);
+        EXPECT_EQ(0xc0a00101, routes[1].subnet_ipv4);
+        EXPECT_EQ(100003, routes[1].egress_intf_id);
+        EXPECT_FALSE(routes[1].is_intf_multipath);
+        EXPECT_TRUE(routes[2].is_host);
+        EXPECT_TRUE(routes[2].is_ipv6);
+        EXPECT_EQ(std::string("\x01\x02\x03\x04\x05\x06\x07\x08", 8),
+                  routes[2].subnet_ipv6);
+        EXPECT_EQ(100002, routes[2].egress_intf_id);
+        results->assign(routes.size(), ::util::OkStatus());
+        return ::util::OkStatus();
+      }));
+  for (const auto& p4_table_entry : p4_table_entries) {
+    EXPECT_CALL(*bcm_table_manager_mock_,
+                AddTableEntry(EqualsProto(p4_table_entry)))
+        .WillOnce(Return(::util::OkStatus()));
+  }
+
+  std::vector<const ::p4::v1::TableEntry*> entries;
+  for (const auto& p4_table_entry : p4_table_entries) {
+    entries.push_back(&p4_table_entry);
+  }
+  std::vector<::util::Status> results;
+  ASSERT_OK(bcm_l3_manager_->InsertTableEntries(entries, &results));
+  ASSERT_EQ(3U, results.size());
+  for (const auto& status : results) EXPECT_OK(status);
+}
+
+TEST_F(BcmL3ManagerTest, InsertTableEntriesReportsPerEntryFailures) {
+  const std::string kBcmFlowEntryText = R"(
+      unit: 3
+      bcm_table_type: BCM_TABLE_IPV4_HOST
+      fields: { type: IPV4_DST value { u32: 0xc0a00101 } }
+      actions: {
+        type: OUTPUT_PORT
+        params { type: EGRESS_INTF_ID value { u32: 100003 } }
+      }
+  )";
+  BcmFlowEntry bcm_flow_entry;
+  ASSERT_OK(ParseProtoFromString(kBcmFlowEntryText, &bcm_flow_entry));
+  std::vector<::p4::v1::TableEntry> p4_table_entries(3);
+  p4_table_entries[0] =
+      ExpectFlowConversion(::p4::v1::Update::INSERT, bcm_flow_entry);
+  // The second entry fails the conversion, and is not given to the SDK.
+  p4_table_entries[1].set_table_id(1000);
+  EXPECT_CALL(*bcm_table_manager_mock_,
+              FillBcmFlowEntry(EqualsProto(p4_table_entries[1]), _, _))
+      .WillOnce(
+          Return(::util::Status(StratumErrorSpace(), ERR_INTERNAL, "Blah")));
+  p4_table_entries[2] =
+      ExpectFlowConversion(::p4::v1::Update::INSERT, bcm_flow_entry);
+
+  // The third route is rejected by the SDK.
+  EXPECT_CALL(*bcm_sdk_mock_, AddL3Routes(kUnit, _, _))
+      .WillOnce(Invoke([](int unit,
+                          const std::vector<BcmSdkInterface::L3Route>& routes,
+                          std::vector<::util::Status>* results) {
+        EXPECT_EQ(2U, routes.size());
+        results->assign(routes.size(), ::util::OkStatus());
+        results->back() =
+            ::util::Status(StratumErrorSpace(), ERR_ENTRY_EXISTS, "Exists");
+        return ::util::OkStatus();
+      }));
+  EXPECT_CALL(*bcm_table_manager_mock_,
+              AddTableEntry(EqualsProto(p4_table_entries[0])))
+      .WillOnce(Return(::util::OkStatus()));
+
+  std::vector<const ::p4::v1::TableEntry*> entries;
+  for (const auto& p4_table_entry : p4_table_entries) {
+    entries.push_back(&p4_table_entry);
+  }
+  std::vector<::util::Status> results;
+  auto status = bcm_l3_manager_->InsertTableEntries(entries, &results);
+  ASSERT_FALSE(status.ok());
+  EXPECT_EQ(ERR_AT_LEAST_ONE_OPER_FAILED, status.error_code());
+  ASSERT_EQ(3U, results.size());
+  EXPECT_OK(results[0]);
+  EXPECT_EQ(ERR_INTERNAL, results[1].error_code());
+  EXPECT_EQ(ERR_ENTRY_EXISTS, results[2].error_code());
+}
+
+TEST_F(BcmL3ManagerTest, InsertTableEntriesFailureWhenSdkFails) {
+  const std::string kBcmFlowEntryText = R"(
+      unit: 3
+      bcm_table_type: BCM_TABLE_IPV4_HOST
+      fields: { type: IPV4_DST value { u32: 0xc0a00101 } }
+      actions: {
+        type: OUTPUT_PORT
+        params { type: EGRESS_INTF_ID value { u32: 100003 } }
+      }
+  )";
+  BcmFlowEntry bcm_flow_entry;
+  ASSERT_OK(ParseProtoFromString(kBcmFlowEntryText, &bcm_flow_entry));
+  std::vector<::p4::v1::TableEntry> p4_table_entries;
+  for (int i = 0; i < 2; ++i) {
+    p4_table_entries.push_back(
+        ExpectFlowConversion(::p4::v1::Update::INSERT, bcm_flow_entry));
+  }
+
+  EXPECT_CALL(*bcm_sdk_mock_, AddL3Routes(kUnit, _, _))
+      .WillOnce(
+          Return(::util::Status(StratumErrorSpace(), ERR_INTERNAL, "Blah")));
+  EXPECT_CALL(*bcm_table_manager_mock_, AddTableEntry(_)).Times(0);
+
+  std::vector<const ::p4::v1::TableEntry*> entries;
+  for (const auto& p4_table_entry : p4_table_entries) {
+    entries.push_back(&p4_table_entry);
+  }
+  std::vector<::util::Status> results;
+  ASSERT_FALSE(bcm_l3_manager_->InsertTableEntries(entries, &results).ok());
+  ASSERT_EQ(2U, results.size());
+  for (const auto& status : results) {
+    EXPECT_EQ(ERR_INTERNAL, status.error_code());
+  }
+}
+
 TEST_F(BcmL3ManagerTest,
        ModifyLpmOrHostFlowSuccessForIpv4LpmFlowAndMultipathNexthop) {
   const std::string kBcmFlowEntryText = R"(
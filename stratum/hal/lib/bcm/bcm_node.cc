@@ -4,12 +4,16 @@
 
 #include "stratum/hal/lib/bcm/bcm_node.h"
 
+#include <algorithm>
 #include <set>
 #include <utility>
 
+#include "absl/container/flat_hash_map.h"
 #include "absl/memory/memory.h"
+#include "absl/synchronization/blocking_counter.h"
 #include "absl/synchronization/mutex.h"
 #include "gflags/gflags.h"
+#include "stratum/hal/lib/common/read_response_chunker.h"
 #include "stratum/lib/macros.h"
 
 // TODO(unknown): This flag is currently false to skip static entry writes
@@ -17,6 +21,13 @@
 DEFINE_bool(enable_static_table_writes, true,
             "Enables writes of static table "
             "entries from the P4 pipeline config to the hardware tables");
+DEFINE_int32(bcm_write_mapping_threads, 4,
+             "Number of worker threads per node used to map and validate the "
+             "table entries of a P4 WriteRequest in parallel. 0 maps them on "
+             "the RPC thread.");
+DEFINE_int32(bcm_write_parallel_min_entries, 64,
+             "Minimum number of table entries in a P4 WriteRequest for them "
+             "to be mapped in parallel.");
 
 namespace stratum {
 namespace hal {
@@ -36,6 +47,10 @@ BcmNode::BcmNode(BcmAclManager* bcm_acl_manager, BcmL2Manager* bcm_l2_manager,
       bcm_table_manager_(ABSL_DIE_IF_NULL(bcm_table_manager)),
       bcm_tunnel_manager_(ABSL_DIE_IF_NULL(bcm_tunnel_manager)),
       p4_table_mapper_(ABSL_DIE_IF_NULL(p4_table_mapper)),
+      write_pool_(FLAGS_bcm_write_mapping_threads > 0
+                      ? absl::make_unique<ThreadPool>(
+                            FLAGS_bcm_write_mapping_threads)
+                      : nullptr),
       node_id_(0),
       unit_(unit) {}
 
@@ -48,6 +63,7 @@ BcmNode::BcmNode()
       bcm_table_manager_(nullptr),
       bcm_tunnel_manager_(nullptr),
       p4_table_mapper_(nullptr),
+      write_pool_(nullptr),
       node_id_(0),
       unit_(-1) {}
 
@@ -282,21 +298,24 @@ BcmNode::~BcmNode() {}
   if (action_profile_ids.count(0)) action_profile_ids.clear();  // request all
 
   if (table_entries_requested) {
-    ::p4::v1::ReadResponse resp;
-    std::vector<::p4::v1::TableEntry*> acl_flows;
-    // Populate response with table entries and obtain list of pointers into the
-    // response to entries for which stats need to be collected.
-    RETURN_IF_ERROR(
-        bcm_table_manager_->ReadTableEntries(table_ids, &resp, &acl_flows));
-    // Collect ACL stats.
-    for (auto* flow : acl_flows) {
-      RETURN_IF_ERROR(bcm_acl_manager_->GetTableEntryStats(
-          *flow, flow->mutable_counter_data()));
-    }
-    if (!writer->Write(resp)) {
-      return MAKE_ERROR(ERR_INTERNAL)
-             << "Write to stream for failed for node " << node_id_ << ".";
-    }
+    // Stream the table entries in chunks, as tables can hold far too many
+    // entries to copy all of them to a single response.
+    ReadResponseChunker chunker(writer);
+    RETURN_IF_ERROR(bcm_table_manager_->StreamTableEntries(
+        table_ids,
+        [this, &chunker](const ::p4::v1::TableEntry& table_entry,
+                         bool is_acl) -> ::util::Status {
+          ASSIGN_OR_RETURN(auto* entity, chunker.AddEntity());
+          auto* flow = entity->mutable_table_entry();
+          *flow = table_entry;
+          // Collect ACL stats.
+          if (is_acl) {
+            RETURN_IF_ERROR(bcm_acl_manager_->GetTableEntryStats(
+                *flow, flow->mutable_counter_data()));
+          }
+          return ::util::OkStatus();
+        }));
+    RETURN_IF_ERROR(chunker.Flush());
   }
   if (action_profile_members_requested) {
     RETURN_IF_ERROR(bcm_table_manager_->ReadActionProfileMembers(
@@ -415,71 +434,87 @@ std::unique_ptr<BcmNode> BcmNode::CreateInstance(
 
 ::util::Status BcmNode::DoWriteForwardingEntries(
     const ::p4::v1::WriteRequest& req, std::vector<::util::Status>* results) {
-  bool success = true;
-  for (const auto& update : req.updates()) {
-    ::util::Status status = ::util::OkStatus();
-    switch (update.entity().entity_case()) {
-      case ::p4::v1::Entity::kExternEntry:
-        // TODO(unknown): Implement this.
-        status = MAKE_ERROR(ERR_OPER_NOT_SUPPORTED)
-                 << "Extern entries are not currently supported.";
-        break;
-      case ::p4::v1::Entity::kTableEntry:
-        status = TableWrite(update.entity().table_entry(), update.type());
-        break;
-      case ::p4::v1::Entity::kActionProfileMember:
-        status = ActionProfileMemberWrite(
-            update.entity().action_profile_member(), update.type());
-        break;
-      case ::p4::v1::Entity::kActionProfileGroup:
-        status = ActionProfileGroupWrite(update.entity().action_profile_group(),
-                                         update.type());
-        break;
-      case ::p4::v1::Entity::kMeterEntry:
-        // TODO(unknown): Implement this.
-        status = MAKE_ERROR(ERR_OPER_NOT_SUPPORTED)
-                 << "Meter entries are not currently supported: "
-                 << update.ShortDebugString() << ".";
-        break;
-      case ::p4::v1::Entity::kDirectMeterEntry:
-        // For direct meter entry, only modify action is expected.
-        if (update.type() != ::p4::v1::Update::MODIFY) {
-          status = MAKE_ERROR(ERR_INVALID_PARAM)
-                   << "Direct meter entries can only be modified: "
-                   << update.ShortDebugString() << ".";
-        } else {
-          status = bcm_acl_manager_->UpdateTableEntryMeter(
-              update.entity().direct_meter_entry());
-        }
-        break;
-      case ::p4::v1::Entity::kCounterEntry:
-        // TODO(unknown): Implement this.
-        status = MAKE_ERROR(ERR_OPER_NOT_SUPPORTED)
-                 << "Counter entries are not currently supported: "
-                 << update.ShortDebugString() << ".";
-        break;
-      case ::p4::v1::Entity::kDirectCounterEntry:
-        // TODO(unknown): Implement this.
-        status = MAKE_ERROR(ERR_OPER_NOT_SUPPORTED)
-                 << "Direct counter entries are not currently supported: "
-                 << update.ShortDebugString() << ".";
-        break;
-      case ::p4::v1::Entity::kPacketReplicationEngineEntry:
-        status = PacketReplicationEngineEntryWrite(
-            update.entity().packet_replication_engine_entry(), update.type());
-        break;
-      case ::p4::v1::Entity::ENTITY_NOT_SET:
-        status = MAKE_ERROR(ERR_INVALID_PARAM)
-                 << "Empty entity: " << update.ShortDebugString() << ".";
-        break;
-      default:
-        status = MAKE_ERROR(ERR_OPER_NOT_SUPPORTED)
-                 << "Unsupported entity type " << update.entity().entity_case()
-                 << " with no plan of support: " << update.ShortDebugString()
-                 << ".";
+  // Bucket the updates by stage, keeping their relative order in every stage.
+  std::vector<int> stages[kNumWriteStages];
+  for (int i = 0; i < req.updates_size(); ++i) {
+    stages[GetWriteStage(req.updates(i))].push_back(i);
+  }
+
+  std::vector<::util::Status> statuses(req.updates_size());
+  for (int stage = 0; stage < kNumWriteStages; ++stage) {
+    const std::vector<int>& indices = stages[stage];
+    if (stage != kEntryWriteStage) {
+      for (int i : indices) statuses[i] = WriteUpdate(req.updates(i));
+      continue;
+    }
+    // Map all the table entries of this stage first. The members and groups
+    // they refer to have already been written at this point.
+    std::vector<int> table_entry_indices;
+    for (int i : indices) {
+      if (req.updates(i).entity().has_table_entry()) {
+        table_entry_indices.push_back(i);
+      }
+    }
+    std::vector<BcmFlowEntry> bcm_flow_entries;
+    std::vector<::util::Status> map_statuses;
+    MapTableEntries(req, table_entry_indices, &bcm_flow_entries,
+                    &map_statuses);
+    // Then program everything in request order. Runs of consecutive L3
+    // LPM/host inserts are programmed as a batch.
+    auto is_l3_insert = [&](size_t j) {
+      if (!map_statuses[j].ok() ||
+          req.updates(table_entry_indices[j]).type() !=
+              ::p4::v1::Update::INSERT) {
+        return false;
+      }
+      switch (bcm_flow_entries[j].bcm_table_type()) {
+        case BcmFlowEntry::BCM_TABLE_IPV4_LPM:
+        case BcmFlowEntry::BCM_TABLE_IPV4_HOST:
+        case BcmFlowEntry::BCM_TABLE_IPV6_LPM:
+        case BcmFlowEntry::BCM_TABLE_IPV6_HOST:
+          return true;
+        default:
+          return false;
+      }
+    };
+    size_t j = 0;
+    for (size_t k = 0; k < indices.size();) {
+      const int i = indices[k];
+      const ::p4::v1::Update& update = req.updates(i);
+      if (j >= table_entry_indices.size() || table_entry_indices[j] != i) {
+        statuses[i] = WriteUpdate(update);
+        ++k;
+        continue;
+      }
+      size_t run = 0;
+      while (k + run < indices.size() && j + run < table_entry_indices.size() &&
+             table_entry_indices[j + run] == indices[k + run] &&
+             is_l3_insert(j + run)) {
+        ++run;
+      }
+      if (run > 1) {
+        InsertL3TableEntries(
+            req,
+            std::vector<int>(table_entry_indices.begin() + j,
+                             table_entry_indices.begin() + j + run),
+            &statuses);
+        k += run;
+        j += run;
+        continue;
+      }
+      statuses[i] = map_statuses[j].ok()
+                        ? TableWrite(update.entity().table_entry(),
+                                     update.type(), bcm_flow_entries[j])
+                        : map_statuses[j];
+      ++k;
+      ++j;
     }
+  }
+
+  bool success = true;
+  for (auto& status : statuses) {
     success &= status.ok();
-    results->push_back(status);
+    results->push_back(std::move(status));
   }
 
   if (!success) {
@@ -493,6 +528,167 @@ std::unique_ptr<BcmNode> BcmNode::CreateInstance(
   return ::util::OkStatus();
 }
 
+BcmNode::WriteStage BcmNode::GetWriteStage(const ::p4::v1::Update& update) {
+  const bool is_delete = update.type() == ::p4::v1::Update::DELETE;
+  switch (update.entity().entity_case()) {
+    case ::p4::v1::Entity::kActionProfileMember:
+      return is_delete ? kMemberDeleteStage : kMemberWriteStage;
+    case ::p4::v1::Entity::kActionProfileGroup:
+      return is_delete ? kGroupDeleteStage : kGroupWriteStage;
+    default:
+      return kEntryWriteStage;
+  }
+}
+
+::util::Status BcmNode::WriteUpdate(const ::p4::v1::Update& update) {
+  ::util::Status status = ::util::OkStatus();
+  switch (update.entity().entity_case()) {
+    case ::p4::v1::Entity::kExternEntry:
+      // TODO(unknown): Implement this.
+      status = MAKE_ERROR(ERR_OPER_NOT_SUPPORTED)
+               << "Extern entries are not currently supported.";
+      break;
+    case ::p4::v1::Entity::kTableEntry:
+      status = TableWrite(update.entity().table_entry(), update.type());
+      break;
+    case ::p4::v1::Entity::kActionProfileMember:
+      status = ActionProfileMemberWrite(
+          update.entity().action_profile_member(), update.type());
+      break;
+    case ::p4::v1::Entity::kActionProfileGroup:
+      status = ActionProfileGroupWrite(update.entity().action_profile_group(),
+                                       update.type());
+      break;
+    case ::p4::v1::Entity::kMeterEntry:
+      // TODO(unknown): Implement this.
+      status = MAKE_ERROR(ERR_OPER_NOT_SUPPORTED)
+               << "Meter entries are not currently supported: "
+               << update.ShortDebugString() << ".";
+      break;
+    case ::p4::v1::Entity::kDirectMeterEntry:
+      // For direct meter entry, only modify action is expected.
+      if (update.type() != ::p4::v1::Update::MODIFY) {
+        status = MAKE_ERROR(ERR_INVALID_PARAM)
+                 << "Direct meter entries can only be modified: "
+                 << update.ShortDebugString() << ".";
+      } else {
+        status = bcm_acl_manager_->UpdateTableEntryMeter(
+            update.entity().direct_meter_entry());
+      }
+      break;
+    case ::p4::v1::Entity::kCounterEntry:
+      // TODO(unknown): Implement this.
+      status = MAKE_ERROR(ERR_OPER_NOT_SUPPORTED)
+               << "Counter entries are not currently supported: "
+               << update.ShortDebugString() << ".";
+      break;
+    case ::p4::v1::Entity::kDirectCounterEntry:
+      // TODO(unknown): Implement this.
+      status = MAKE_ERROR(ERR_OPER_NOT_SUPPORTED)
+               << "Direct counter entries are not currently supported: "
+               << update.ShortDebugString() << ".";
+      break;
+    case ::p4::v1::Entity::kPacketReplicationEngineEntry:
+      status = PacketReplicationEngineEntryWrite(
+          update.entity().packet_replication_engine_entry(), update.type());
+      break;
+    case ::p4::v1::Entity::ENTITY_NOT_SET:
+      status = MAKE_ERROR(ERR_INVALID_PARAM)
+               << "Empty entity: " << update.ShortDebugString() << ".";
+      break;
+    default:
+      status = MAKE_ERROR(ERR_OPER_NOT_SUPPORTED)
+               << "Unsupported entity type " << update.entity().entity_case()
+               << " with no plan of support: " << update.ShortDebugString()
+               << ".";
+  }
+  return status;
+}
+
+void BcmNode::MapTableEntries(const ::p4::v1::WriteRequest& req,
+                              const std::vector<int>& indices,
+                              std::vector<BcmFlowEntry>* bcm_flow_entries,
+                              std::vector<::util::Status>* statuses) {
+  bcm_flow_entries->assign(indices.size(), BcmFlowEntry());
+  statuses->assign(indices.size(), ::util::OkStatus());
+  auto map_range = [&req, &indices, bcm_flow_entries, statuses,
+                    this](const std::vector<int>& positions, size_t begin,
+                          size_t end) {
+    for (size_t k = begin; k < end; ++k) {
+      const int pos = positions[k];
+      const ::p4::v1::Update& update = req.updates(indices[pos]);
+      // Rejected by TableWrite() later on.
+      if (update.type() == ::p4::v1::Update::UNSPECIFIED) continue;
+      (*statuses)[pos] = bcm_table_manager_->FillBcmFlowEntry(
+          update.entity().table_entry(), update.type(),
+          &(*bcm_flow_entries)[pos]);
+    }
+  };
+
+  // Small requests are not worth the hand-off to the worker pool.
+  if (write_pool_ == nullptr ||
+      indices.size() <
+          static_cast<size_t>(FLAGS_bcm_write_parallel_min_entries)) {
+    std::vector<int> positions(indices.size());
+    for (size_t pos = 0; pos < indices.size(); ++pos) positions[pos] = pos;
+    map_range(positions, 0, positions.size());
+    return;
+  }
+
+  // Shard the work by table, and split the shards of large tables into chunks
+  // so that a request for a single big table still uses all the workers.
+  absl::flat_hash_map<uint32, std::vector<int>> positions_by_table;
+  for (size_t pos = 0; pos < indices.size(); ++pos) {
+    const uint32 table_id =
+        req.updates(indices[pos]).entity().table_entry().table_id();
+    positions_by_table[table_id].push_back(pos);
+  }
+  const size_t chunk_size =
+      std::max<size_t>(1, (indices.size() + write_pool_->NumThreads() - 1) /
+                              write_pool_->NumThreads());
+  std::vector<std::pair<const std::vector<int>*, size_t>> chunks;
+  for (const auto& e : positions_by_table) {
+    for (size_t begin = 0; begin < e.second.size(); begin += chunk_size) {
+      chunks.emplace_back(&e.second, begin);
+    }
+  }
+  absl::BlockingCounter done(chunks.size());
+  for (const auto& chunk : chunks) {
+    write_pool_->Schedule([&map_range, &done, &chunk, chunk_size]() {
+      const std::vector<int>& positions = *chunk.first;
+      map_range(positions, chunk.second,
+                std::min(chunk.second + chunk_size, positions.size()));
+      done.DecrementCount();
+    });
+  }
+  done.Wait();
+}
+
+void BcmNode::InsertL3TableEntries(const ::p4::v1::WriteRequest& req,
+                                   const std::vector<int>& indices,
+                                   std::vector<::util::Status>* statuses) {
+  std::vector<const ::p4::v1::TableEntry*> entries;
+  entries.reserve(indices.size());
+  for (int i : indices) {
+    entries.push_back(&req.updates(i).entity().table_entry());
+  }
+  std::vector<::util::Status> results;
+  // The per-entry results carry all the errors.
+  ::util::Status status =
+      bcm_l3_manager_->InsertTableEntries(entries, &results);
+  if (results.size() != indices.size()) {
+    if (status.ok()) {
+      status = MAKE_ERROR(ERR_INTERNAL)
+               << "Got " << results.size() << " results for "
+               << indices.size() << " L3 table entries.";
+    }
+    results.assign(indices.size(), status);
+  }
+  for (size_t k = 0; k < indices.size(); ++k) {
+    (*statuses)[indices[k]] = std::move(results[k]);
+  }
+}
+
 // TODO(unknown): Complete this function for all the update types.
 ::util::Status BcmNode::TableWrite(const ::p4::v1::TableEntry& entry,
                                    ::p4::v1::Update::Type type) {
@@ -502,6 +698,13 @@ std::unique_ptr<BcmNode> BcmNode::CreateInstance(
   BcmFlowEntry bcm_flow_entry;
   RETURN_IF_ERROR(
       bcm_table_manager_->FillBcmFlowEntry(entry, type, &bcm_flow_entry));
+  return TableWrite(entry, type, bcm_flow_entry);
+}
+
+::util::Status BcmNode::TableWrite(const ::p4::v1::TableEntry& entry,
+                                   ::p4::v1::Update::Type type,
+                                   const BcmFlowEntry& bcm_flow_entry) {
+  CHECK_RETURN_IF_FALSE(type != ::p4::v1::Update::UNSPECIFIED);
   BcmFlowEntry::BcmTableType bcm_table_type = bcm_flow_entry.bcm_table_type();
   // Try to program the flow.
   bool consumed = false;  // will be set to true if we know what to do
@@ -19,6 +19,7 @@
 #include "stratum/hal/lib/bcm/bcm_tunnel_manager.h"
 #include "stratum/hal/lib/common/common.pb.h"
 #include "stratum/hal/lib/p4/p4_table_mapper.h"
+#include "stratum/lib/thread_pool.h"
 
 namespace stratum {
 namespace hal {
@@ -69,7 +70,12 @@ class BcmNode {
       LOCKS_EXCLUDED(lock_);
 
   // Writes P4-based forwarding entries (table entries, action profile members,
-  // action profile groups, meters, counters) to this node.
+  // action profile groups, meters, counters) to this node. The updates are
+  // applied in dependency order: action profile members and groups are
+  // inserted/modified before, and deleted after, all the other entities. The
+  // table entries of large requests are mapped and validated in parallel on a
+  // worker pool before they are programmed. The i-th element of results always
+  // refers to the i-th update of the request.
   virtual ::util::Status WriteForwardingEntries(
       const ::p4::v1::WriteRequest& req, std::vector<::util::Status>* results)
       SHARED_LOCKS_REQUIRED(chassis_lock) LOCKS_EXCLUDED(lock_);
@@ -143,10 +149,52 @@ class BcmNode {
       const ::p4::v1::WriteRequest& req, std::vector<::util::Status>* results)
       EXCLUSIVE_LOCKS_REQUIRED(lock_);
 
+  // The stages in which the updates of a WriteRequest are applied. Action
+  // profile members are referenced by groups, and both are referenced by table
+  // entries, so the referenced entities are added first and removed last.
+  enum WriteStage {
+    kMemberWriteStage = 0,
+    kGroupWriteStage,
+    kEntryWriteStage,
+    kGroupDeleteStage,
+    kMemberDeleteStage,
+    kNumWriteStages,
+  };
+
+  // Returns the stage in which the given update is applied.
+  static WriteStage GetWriteStage(const ::p4::v1::Update& update);
+
+  // Writes a single update, of any entity type.
+  ::util::Status WriteUpdate(const ::p4::v1::Update& update)
+      EXCLUSIVE_LOCKS_REQUIRED(lock_);
+
+  // Maps the table entries of the updates at the given indices of the request
+  // to BcmFlowEntry. The mapping only reads the software state, so it is run in
+  // parallel on write_pool_ for large requests, with the work split by table.
+  // bcm_flow_entries and statuses are filled in the order of the indices.
+  void MapTableEntries(const ::p4::v1::WriteRequest& req,
+                       const std::vector<int>& indices,
+                       std::vector<BcmFlowEntry>* bcm_flow_entries,
+                       std::vector<::util::Status>* statuses)
+      EXCLUSIVE_LOCKS_REQUIRED(lock_);
+
+  // Inserts the L3 LPM/host table entries of the updates at the given indices
+  // of the request as a single batch, and sets their statuses (indexed by the
+  // update index in the request).
+  void InsertL3TableEntries(const ::p4::v1::WriteRequest& req,
+                            const std::vector<int>& indices,
+                            std::vector<::util::Status>* statuses)
+      EXCLUSIVE_LOCKS_REQUIRED(lock_);
+
   // Write a single P4 TableEntry.
   ::util::Status TableWrite(const ::p4::v1::TableEntry& entry,
                             ::p4::v1::Update::Type type);
 
+  // Programs a single P4 TableEntry, given its already mapped BcmFlowEntry.
+  ::util::Status TableWrite(const ::p4::v1::TableEntry& entry,
+                            ::p4::v1::Update::Type type,
+                            const BcmFlowEntry& bcm_flow_entry);
+
   // Write a single P4 ActionProfileMember.
   ::util::Status ActionProfileMemberWrite(
       const ::p4::v1::ActionProfileMember& member, ::p4::v1::Update::Type type);
@@ -178,6 +226,10 @@ class BcmNode {
   // managers for parsing/deparsing P4 data.
   P4TableMapper* p4_table_mapper_;  // not owned by this class.
 
+  // Worker pool used to map the table entries of large write requests in
+  // parallel. nullptr if parallel mapping is disabled.
+  std::unique_ptr<ThreadPool> write_pool_;
+
   // Logical node ID corresponding to the node/ASIC managed by this class
   // instance. Assigned on PushChassisConfig() and might change during the
   // lifetime of the class.
@@ -0,0 +1,298 @@
+// Copyright 2018-present Open Networking Foundation
+// SPDX-License-Identifier: Apache-2.0
+
+// Benchmarks BcmNode::WriteForwardingEntries() for large route batches with
+// different sizes of the worker pool that maps P4 table entries to
+// BcmFlowEntry. The table manager is replaced by a fake that spends a fixed
+// amount of CPU per entry, mimicking the cost of the P4TableMapper lookups
+// done by the real FillBcmFlowEntry(). The SDK programming step is free.
+//
+// Also benchmarks BcmNode::ReadForwardingEntries() on a large table, with and
+// without chunking of the response, and reports the peak RSS growth of the
+// read.
+
+#include <fstream>
+#include <memory>
+#include <set>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/hash/hash.h"
+#include "absl/strings/match.h"
+#include "absl/synchronization/mutex.h"
+#include "benchmark/benchmark.h"
+#include "gmock/gmock.h"
+#include "p4/v1/p4runtime.pb.h"
+#include "stratum/glue/logging.h"
+#include "stratum/glue/status/status_macros.h"
+#include "stratum/hal/lib/bcm/bcm_acl_manager_mock.h"
+#include "stratum/hal/lib/bcm/bcm_l2_manager_mock.h"
+#include "stratum/hal/lib/bcm/bcm_l3_manager.h"
+#include "stratum/hal/lib/bcm/bcm_node.h"
+#include "stratum/hal/lib/bcm/bcm_packetio_manager_mock.h"
+#include "stratum/hal/lib/bcm/bcm_table_manager.h"
+#include "stratum/hal/lib/bcm/bcm_tunnel_manager_mock.h"
+#include "stratum/hal/lib/common/writer_interface.h"
+#include "stratum/hal/lib/p4/p4_table_mapper_mock.h"
+#include "stratum/lib/utils.h"
+
+DECLARE_int32(bcm_write_mapping_threads);
+DECLARE_int32(read_response_max_entities);
+DECLARE_int64(read_response_max_bytes);
+
+namespace stratum {
+namespace hal {
+namespace bcm {
+namespace {
+
+using ::testing::NiceMock;
+
+constexpr uint64 kNodeId = 13579;
+constexpr int kUnit = 0;
+// Number of hashing rounds spent on every mapped entry.
+constexpr int kMappingRounds = 64;
+// ID of the table read by BM_ReadForwardingEntries.
+constexpr uint32 kReadTableId = 33554500;
+
+class FakeBcmTableManager : public BcmTableManager {
+ public:
+  FakeBcmTableManager() {}
+
+  ::util::Status PushChassisConfig(const ChassisConfig& config,
+                                   uint64 node_id) override {
+    return ::util::OkStatus();
+  }
+
+  ::util::Status FillBcmFlowEntry(const ::p4::v1::TableEntry& table_entry,
+                                  ::p4::v1::Update::Type type,
+                                  BcmFlowEntry* bcm_flow_entry) const override {
+    std::string bytes = ProtoSerialize(table_entry);
+    size_t hash = 0;
+    for (int i = 0; i < kMappingRounds; ++i) {
+      hash = absl::Hash<std::pair<size_t, std::string>>()({hash, bytes});
+    }
+    benchmark::DoNotOptimize(hash);
+    bcm_flow_entry->set_unit(kUnit);
+    bcm_flow_entry->set_bcm_table_type(BcmFlowEntry::BCM_TABLE_IPV4_LPM);
+    return ::util::OkStatus();
+  }
+
+  // Streams num_read_entries_ ACL-like entries of kReadTableId.
+  ::util::Status StreamTableEntries(
+      const std::set<uint32>& table_ids,
+      const TableEntryCallback& callback) const override {
+    ::p4::v1::TableEntry table_entry;
+    table_entry.set_table_id(kReadTableId);
+    for (int i = 0; i < 4; ++i) {
+      auto* match = table_entry.add_match();
+      match->set_field_id(i + 1);
+      match->mutable_ternary()->set_value(std::string(16, 'v'));
+      match->mutable_ternary()->set_mask(std::string(16, '\xff'));
+    }
+    auto* action = table_entry.mutable_action()->mutable_action();
+    action->set_action_id(16777300);
+    action->add_params()->set_value(std::string(6, 'p'));
+    for (int i = 0; i < num_read_entries_; ++i) {
+      table_entry.set_priority(i + 1);
+      RETURN_IF_ERROR(callback(table_entry, false));
+    }
+    return ::util::OkStatus();
+  }
+
+  void set_num_read_entries(int num_read_entries) {
+    num_read_entries_ = num_read_entries;
+  }
+
+ private:
+  int num_read_entries_ = 0;
+};
+
+class FakeBcmL3Manager : public BcmL3Manager {
+ public:
+  FakeBcmL3Manager() {}
+
+  ::util::Status PushChassisConfig(const ChassisConfig& config,
+                                   uint64 node_id) override {
+    return ::util::OkStatus();
+  }
+
+  ::util::Status InsertTableEntry(const ::p4::v1::TableEntry& entry) override {
+    return ::util::OkStatus();
+  }
+};
+
+// Writer that drops the responses, only counting the entities written.
+class CountingReadResponseWriter
+    : public WriterInterface<::p4::v1::ReadResponse> {
+ public:
+  CountingReadResponseWriter() : num_responses_(0), num_entities_(0) {}
+
+  bool Write(const ::p4::v1::ReadResponse& msg) override {
+    num_responses_++;
+    num_entities_ += msg.entities_size();
+    return true;
+  }
+
+  int64 num_responses() const { return num_responses_; }
+  int64 num_entities() const { return num_entities_; }
+
+ private:
+  int64 num_responses_;
+  int64 num_entities_;
+};
+
+// Returns the value in KiB of the given field of /proc/self/status, e.g.
+// "VmRSS" for the resident set size or "VmHWM" for its peak, or -1 if not
+// found.
+int64 ReadProcStatusKb(const std::string& field) {
+  std::ifstream status("/proc/self/status");
+  std::string line;
+  while (std::getline(status, line)) {
+    if (absl::StartsWith(line, field + ":")) {
+      int64 value;
+      std::istringstream(line.substr(field.size() + 1)) >> value;
+      return value;
+    }
+  }
+  return -1;
+}
+
+// Resets the peak resident set size of the process to the current one.
+// Returns false if the kernel does not support it.
+bool ResetPeakRss() {
+  std::ofstream clear_refs("/proc/self/clear_refs");
+  clear_refs << "5";
+  clear_refs.close();
+  return !clear_refs.fail() &&
+         ReadProcStatusKb("VmHWM") <= ReadProcStatusKb("VmRSS");
+}
+
+// Builds a request with num_entries route inserts spread over a few tables.
+::p4::v1::WriteRequest MakeRouteRequest(int num_entries) {
+  ::p4::v1::WriteRequest req;
+  req.set_device_id(kNodeId);
+  for (int i = 0; i < num_entries; ++i) {
+    auto* update = req.add_updates();
+    update->set_type(::p4::v1::Update::INSERT);
+    auto* entry = update->mutable_entity()->mutable_table_entry();
+    entry->set_table_id(1 + i % 4);
+    auto* match = entry->add_match();
+    match->set_field_id(1);
+    const uint32 prefix = 0x0a000000 | (static_cast<uint32>(i) << 8);
+    std::string value(4, '\0');
+    for (int b = 0; b < 4; ++b) {
+      value[b] = static_cast<char>((prefix >> (24 - 8 * b)) & 0xff);
+    }
+    match->mutable_lpm()->set_value(value);
+    match->mutable_lpm()->set_prefix_len(24);
+    entry->mutable_action()->set_action_profile_member_id(i);
+  }
+  return req;
+}
+
+// Arguments: number of mapping threads, number of updates per request.
+void BM_WriteForwardingEntries(benchmark::State& state) {
+  FLAGS_bcm_write_mapping_threads = state.range(0);
+  NiceMock<BcmAclManagerMock> bcm_acl_manager;
+  NiceMock<BcmL2ManagerMock> bcm_l2_manager;
+  FakeBcmL3Manager bcm_l3_manager;
+  NiceMock<BcmPacketioManagerMock> bcm_packetio_manager;
+  FakeBcmTableManager bcm_table_manager;
+  NiceMock<BcmTunnelManagerMock> bcm_tunnel_manager;
+  NiceMock<P4TableMapperMock> p4_table_mapper;
+  auto bcm_node = BcmNode::CreateInstance(
+      &bcm_acl_manager, &bcm_l2_manager, &bcm_l3_manager,
+      &bcm_packetio_manager, &bcm_table_manager, &bcm_tunnel_manager,
+      &p4_table_mapper, kUnit);
+  {
+    absl::ReaderMutexLock l(&chassis_lock);
+    ChassisConfig config;
+    config.add_nodes()->set_id(kNodeId);
+    CHECK(bcm_node->PushChassisConfig(config, kNodeId).ok());
+  }
+
+  const auto req = MakeRouteRequest(state.range(1));
+  for (auto _ : state) {
+    std::vector<::util::Status> results;
+    absl::ReaderMutexLock l(&chassis_lock);
+    CHECK(bcm_node->WriteForwardingEntries(req, &results).ok());
+  }
+  state.SetItemsProcessed(state.iterations() * req.updates_size());
+}
+BENCHMARK(BM_WriteForwardingEntries)
+    ->Apply([](benchmark::internal::Benchmark* b) {
+      for (int num_threads : {0, 1, 2, 4, 8}) {
+        for (int num_entries : {1000, 10000}) {
+          b->Args({num_threads, num_entries});
+        }
+      }
+    })
+    ->UseRealTime();
+
+// Arguments: number of entries in the table, max entities per response (0
+// disables chunking). Reports the peak RSS growth of the last read, if the
+// kernel allows resetting the peak RSS.
+void BM_ReadForwardingEntries(benchmark::State& state) {
+  FLAGS_read_response_max_entities = state.range(1);
+  FLAGS_read_response_max_bytes = state.range(1) > 0 ? 1024 * 1024 : 0;
+  NiceMock<BcmAclManagerMock> bcm_acl_manager;
+  NiceMock<BcmL2ManagerMock> bcm_l2_manager;
+  FakeBcmL3Manager bcm_l3_manager;
+  NiceMock<BcmPacketioManagerMock> bcm_packetio_manager;
+  FakeBcmTableManager bcm_table_manager;
+  NiceMock<BcmTunnelManagerMock> bcm_tunnel_manager;
+  NiceMock<P4TableMapperMock> p4_table_mapper;
+  bcm_table_manager.set_num_read_entries(state.range(0));
+  auto bcm_node = BcmNode::CreateInstance(
+      &bcm_acl_manager, &bcm_l2_manager, &bcm_l3_manager,
+      &bcm_packetio_manager, &bcm_table_manager, &bcm_tunnel_manager,
+      &p4_table_mapper, kUnit);
+  {
+    absl::ReaderMutexLock l(&chassis_lock);
+    ChassisConfig config;
+    config.add_nodes()->set_id(kNodeId);
+    CHECK(bcm_node->PushChassisConfig(config, kNodeId).ok());
+  }
+
+  ::p4::v1::ReadRequest req;
+  req.set_device_id(kNodeId);
+  req.add_entities()->mutable_table_entry()->set_table_id(kReadTableId);
+  int64 peak_rss_increase_kb = -1;
+  CountingReadResponseWriter writer;
+  for (auto _ : state) {
+    const bool peak_rss_reset = ResetPeakRss();
+    const int64 rss_before_kb = ReadProcStatusKb("VmRSS");
+    std::vector<::util::Status> details;
+    {
+      absl::ReaderMutexLock l(&chassis_lock);
+      CHECK(bcm_node->ReadForwardingEntries(req, &writer, &details).ok());
+    }
+    if (peak_rss_reset) {
+      peak_rss_increase_kb = ReadProcStatusKb("VmHWM") - rss_before_kb;
+    }
+  }
+  CHECK_EQ(state.iterations() * state.range(0), writer.num_entities());
+  state.SetItemsProcessed(writer.num_entities());
+  state.counters["responses"] = benchmark::Counter(
+      writer.num_responses(), benchmark::Counter::kAvgIterations);
+  if (peak_rss_increase_kb >= 0) {
+    state.counters["peak_rss_increase_kb"] =
+        benchmark::Counter(peak_rss_increase_kb);
+  }
+}
+BENCHMARK(BM_ReadForwardingEntries)
+    ->Apply([](benchmark::internal::Benchmark* b) {
+      for (int num_entries : {100000, 500000}) {
+        for (int max_entities : {0, 1000}) {
+          b->Args({num_entries, max_entities});
+        }
+      }
+    })
+    ->Unit(benchmark::kMillisecond);
+
+}  // namespace
+}  // namespace bcm
+}  // namespace hal
+}  // namespace stratum
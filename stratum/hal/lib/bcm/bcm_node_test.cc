@@ -24,6 +24,7 @@
 
 using ::testing::_;
 using ::testing::DoAll;
+using ::testing::ElementsAre;
 using ::testing::Eq;
 using ::testing::HasSubstr;
 using ::testing::InSequence;
@@ -31,6 +32,10 @@ using ::testing::Invoke;
 using ::testing::Return;
 using ::testing::WithArgs;
 
+DECLARE_int32(bcm_write_parallel_min_entries);
+DECLARE_int32(read_response_max_entities);
+DECLARE_int64(read_response_max_bytes);
+
 namespace stratum {
 namespace hal {
 namespace bcm {
@@ -96,6 +101,14 @@ class BcmNodeTest : public ::testing::Test {
     return bcm_node_->WriteForwardingEntries(req, results);
   }
 
+  ::util::Status ReadForwardingEntries(
+      const ::p4::v1::ReadRequest& req,
+      WriterInterface<::p4::v1::ReadResponse>* writer,
+      std::vector<::util::Status>* details) {
+    absl::ReaderMutexLock l(&chassis_lock);
+    return bcm_node_->ReadForwardingEntries(req, writer, details);
+  }
+
   ::util::Status RegisterPacketReceiveWriter(
       const std::shared_ptr<WriterInterface<::p4::v1::PacketIn>>& writer) {
     absl::ReaderMutexLock l(&chassis_lock);
@@ -1619,6 +1632,172 @@ TEST_F(BcmNodeTest, WriteForwardingEntriesSuccess_DeleteMulticastGroupEntry) {
   EXPECT_EQ(1U, results.size());
 }
 
+// Action profile members must be inserted before, and deleted after, the table
+// entries in the same request, while the results keep the request order.
+TEST_F(BcmNodeTest, WriteForwardingEntriesAppliesUpdatesInDependencyOrder) {
+  ASSERT_NO_FATAL_FAILURE(PushChassisConfigWithCheck());
+
+  ::p4::v1::WriteRequest req;
+  auto* table_entry = SetupTableEntryToInsert(&req, kNodeId);
+  auto* update = req.add_updates();
+  update->set_type(::p4::v1::Update::DELETE);
+  update->mutable_entity()->mutable_action_profile_member()->set_member_id(
+      kMemberId + 1);
+  update = req.add_updates();
+  update->set_type(::p4::v1::Update::INSERT);
+  auto* member = update->mutable_entity()->mutable_action_profile_member();
+  member->set_member_id(kMemberId);
+  std::vector<::util::Status> results = {};
+
+  {
+    InSequence sequence;
+    EXPECT_CALL(*bcm_table_manager_mock_, ActionProfileMemberExists(kMemberId))
+        .WillOnce(Return(false));
+    EXPECT_CALL(*bcm_table_manager_mock_,
+                FillBcmNonMultipathNexthop(EqualsProto(*member), _))
+        .WillOnce(Return(::util::OkStatus()));
+    EXPECT_CALL(*bcm_l3_manager_mock_, FindOrCreateNonMultipathNexthop(_))
+        .WillOnce(Return(kEgressIntfId));
+    EXPECT_CALL(*bcm_table_manager_mock_,
+                AddActionProfileMember(EqualsProto(*member), _, _, _))
+        .WillOnce(Return(::util::OkStatus()));
+    EXPECT_CALL(*bcm_table_manager_mock_,
+                FillBcmFlowEntry(EqualsProto(*table_entry),
+                                 ::p4::v1::Update::INSERT, _))
+        .WillOnce(
+            DoAll(WithArgs<2>(Invoke([](BcmFlowEntry* x) {
+                    x->set_bcm_table_type(BcmFlowEntry::BCM_TABLE_IPV4_LPM);
+                  })),
+                  Return(::util::OkStatus())));
+    EXPECT_CALL(*bcm_l3_manager_mock_, InsertTableEntry(_))
+        .WillOnce(Return(DefaultError()));
+    EXPECT_CALL(*bcm_table_manager_mock_,
+                GetBcmNonMultipathNexthopInfo(kMemberId + 1, _))
+        .WillOnce(Return(::util::OkStatus()));
+    EXPECT_CALL(*bcm_l3_manager_mock_, DeleteNonMultipathNexthop(_))
+        .WillOnce(Return(::util::OkStatus()));
+    EXPECT_CALL(*bcm_table_manager_mock_, DeleteActionProfileMember(_))
+        .WillOnce(Return(::util::OkStatus()));
+  }
+
+  EXPECT_THAT(WriteForwardingEntries(req, &results),
+              DerivedFromStatus(::util::Status(StratumErrorSpace(),
+                                               ERR_AT_LEAST_ONE_OPER_FAILED,
+                                               "")));
+  ASSERT_EQ(3U, results.size());
+  EXPECT_THAT(results[0], DerivedFromStatus(DefaultError()));
+  EXPECT_OK(results[1]);
+  EXPECT_OK(results[2]);
+}
+
+// The table entries of large requests are mapped on the worker pool. The
+// results must still be reported in request order.
+TEST_F(BcmNodeTest, WriteForwardingEntriesMapsLargeRequestsInParallel) {
+  ASSERT_NO_FATAL_FAILURE(PushChassisConfigWithCheck());
+
+  const int kNumEntries = 4 * FLAGS_bcm_write_parallel_min_entries;
+  const int kFailedEntry = kNumEntries / 3;
+  ::p4::v1::WriteRequest req;
+  for (int i = 0; i < kNumEntries; ++i) {
+    auto* table_entry = SetupTableEntryToInsert(&req, kNodeId);
+    // Spread the entries over a few tables.
+    table_entry->set_table_id(1 + i % 3);
+    table_entry->set_priority(i);
+  }
+  std::vector<::util::Status> results = {};
+
+  EXPECT_CALL(*bcm_table_manager_mock_,
+              FillBcmFlowEntry(_, ::p4::v1::Update::INSERT, _))
+      .Times(kNumEntries)
+      .WillRepeatedly(Invoke(
+          [this, kFailedEntry](const ::p4::v1::TableEntry& entry,
+                               ::p4::v1::Update::Type type, BcmFlowEntry* x) {
+            if (entry.priority() == kFailedEntry) return DefaultError();
+            x->set_bcm_table_type(BcmFlowEntry::BCM_TABLE_IPV4_LPM);
+            return ::util::OkStatus();
+          }));
+  // The failed entry splits the routes into two batches.
+  std::vector<size_t> batch_sizes;
+  EXPECT_CALL(*bcm_l3_manager_mock_, InsertTableEntries(_, _))
+      .Times(2)
+      .WillRepeatedly(Invoke(
+          [&batch_sizes](
+              const std::vector<const ::p4::v1::TableEntry*>& entries,
+              std::vector<::util::Status>* results) {
+            batch_sizes.push_back(entries.size());
+            results->assign(entries.size(), ::util::OkStatus());
+            return ::util::OkStatus();
+          }));
+
+  EXPECT_FALSE(WriteForwardingEntries(req, &results).ok());
+  EXPECT_THAT(batch_sizes, ElementsAre(kFailedEntry,
+                                       kNumEntries - kFailedEntry - 1));
+  ASSERT_EQ(static_cast<size_t>(kNumEntries), results.size());
+  for (int i = 0; i < kNumEntries; ++i) {
+    if (i == kFailedEntry) {
+      EXPECT_THAT(results[i], DerivedFromStatus(DefaultError()));
+    } else {
+      EXPECT_OK(results[i]);
+    }
+  }
+}
+
+// Consecutive L3 route inserts are given to BcmL3Manager as one batch, and the
+// per-entry results are reported at the index of every update.
+TEST_F(BcmNodeTest, WriteForwardingEntriesBatchesL3RouteInserts) {
+  ASSERT_NO_FATAL_FAILURE(PushChassisConfigWithCheck());
+
+  ::p4::v1::WriteRequest req;
+  std::vector<::p4::v1::TableEntry> table_entries;
+  for (int i = 0; i < 3; ++i) {
+    auto* table_entry = SetupTableEntryToInsert(&req, kNodeId);
+    table_entry->set_priority(i + 1);
+    table_entries.push_back(*table_entry);
+  }
+  // A my station entry ends the run of routes.
+  auto* my_station_entry = SetupTableEntryToInsert(&req, kNodeId);
+  my_station_entry->set_priority(100);
+  table_entries.push_back(*my_station_entry);
+  std::vector<::util::Status> results = {};
+
+  EXPECT_CALL(*bcm_table_manager_mock_,
+              FillBcmFlowEntry(_, ::p4::v1::Update::INSERT, _))
+      .Times(4)
+      .WillRepeatedly(Invoke([](const ::p4::v1::TableEntry& entry,
+                                ::p4::v1::Update::Type type, BcmFlowEntry* x) {
+        x->set_bcm_table_type(entry.priority() == 100
+                                  ? BcmFlowEntry::BCM_TABLE_MY_STATION
+                                  : BcmFlowEntry::BCM_TABLE_IPV4_LPM);
+        return ::util::OkStatus();
+      }));
+  EXPECT_CALL(*bcm_l3_manager_mock_, InsertTableEntries(_, _))
+      .WillOnce(Invoke(
+          [this, &table_entries](
+              const std::vector<const ::p4::v1::TableEntry*>& entries,
+              std::vector<::util::Status>* results) {
+            EXPECT_EQ(3U, entries.size());
+            for (size_t i = 0; i < entries.size() && i < 3; ++i) {
+              EXPECT_TRUE(ProtoEqual(table_entries[i], *entries[i]));
+            }
+            results->assign(entries.size(), ::util::OkStatus());
+            (*results)[1] = DefaultError();
+            return ::util::Status(StratumErrorSpace(),
+                                  ERR_AT_LEAST_ONE_OPER_FAILED, "");
+          }));
+  EXPECT_CALL(*bcm_l2_manager_mock_, InsertMyStationEntry(_))
+      .WillOnce(Return(::util::OkStatus()));
+  EXPECT_CALL(*bcm_table_manager_mock_,
+              AddTableEntry(EqualsProto(table_entries[3])))
+      .WillOnce(Return(::util::OkStatus()));
+
+  EXPECT_FALSE(WriteForwardingEntries(req, &results).ok());
+  ASSERT_EQ(4U, results.size());
+  EXPECT_OK(results[0]);
+  EXPECT_THAT(results[1], DerivedFromStatus(DefaultError()));
+  EXPECT_OK(results[2]);
+  EXPECT_OK(results[3]);
+}
+
 // RegisterPacketReceiveWriter() should forward the call to BcmPacketioManager
 // and return success or error based on the returned result.
 TEST_F(BcmNodeTest, RegisterPacketReceiveWriter) {
@@ -1652,6 +1831,78 @@ TEST_F(BcmNodeTest, UnregisterPacketReceiveWriter) {
               DerivedFromStatus(DefaultError()));
 }
 
+// Reading a large table streams it in bounded chunks, instead of building a
+// response holding all the entries.
+TEST_F(BcmNodeTest, ReadForwardingEntriesStreamsLargeTable) {
+  ASSERT_NO_FATAL_FAILURE(PushChassisConfigWithCheck());
+  constexpr int kNumEntries = 1000;
+  constexpr uint32 kTableId = 33554500;
+  const int saved_max_entities = FLAGS_read_response_max_entities;
+  const int64 saved_max_bytes = FLAGS_read_response_max_bytes;
+  FLAGS_read_response_max_entities = 64;
+  FLAGS_read_response_max_bytes = 4096;
+
+  ::p4::v1::TableEntry table_entry;
+  table_entry.set_table_id(kTableId);
+  for (int i = 0; i < 4; ++i) {
+    auto* match = table_entry.add_match();
+    match->set_field_id(i + 1);
+    match->mutable_ternary()->set_value(std::string(16, 'v'));
+    match->mutable_ternary()->set_mask(std::string(16, '\xff'));
+  }
+  auto* action = table_entry.mutable_action()->mutable_action();
+  action->set_action_id(16777300);
+  action->add_params()->set_value(std::string(6, 'p'));
+  EXPECT_CALL(*bcm_table_manager_mock_,
+              StreamTableEntries(ElementsAre(kTableId), _))
+      .WillOnce(Invoke(
+          [&table_entry](const std::set<uint32>& table_ids,
+                         const BcmTableManager::TableEntryCallback& callback) {
+            for (int i = 0; i < kNumEntries; ++i) {
+              table_entry.set_priority(i + 1);
+              RETURN_IF_ERROR(callback(table_entry, false));
+            }
+            return ::util::OkStatus();
+          }));
+
+  // Every response must stay within the limits of the chunker: at most
+  // --read_response_max_entities entities, and below
+  // --read_response_max_bytes bytes before its last entity is added.
+  int num_chunks = 0;
+  int num_entities = 0;
+  WriterMock<::p4::v1::ReadResponse> writer;
+  EXPECT_CALL(writer, Write(_))
+      .WillRepeatedly(Invoke([&](const ::p4::v1::ReadResponse& resp) {
+        EXPECT_GT(resp.entities_size(), 0);
+        EXPECT_LE(resp.entities_size(), FLAGS_read_response_max_entities);
+        int64 bytes_before_last = 0;
+        for (int i = 0; i < resp.entities_size() - 1; ++i) {
+          bytes_before_last += resp.entities(i).ByteSizeLong();
+        }
+        EXPECT_LT(bytes_before_last, FLAGS_read_response_max_bytes);
+        // Entries are streamed in the order they are read.
+        for (const auto& entity : resp.entities()) {
+          EXPECT_EQ(++num_entities, entity.table_entry().priority());
+        }
+        num_chunks++;
+        return true;
+      }));
+
+  ::p4::v1::ReadRequest req;
+  req.set_device_id(kNodeId);
+  req.add_entities()->mutable_table_entry()->set_table_id(kTableId);
+  std::vector<::util::Status> details;
+  ASSERT_OK(ReadForwardingEntries(req, &writer, &details));
+  FLAGS_read_response_max_entities = saved_max_entities;
+  FLAGS_read_response_max_bytes = saved_max_bytes;
+
+  EXPECT_TRUE(details.empty());
+  EXPECT_EQ(kNumEntries, num_entities);
+  // Each entity takes about 200 bytes, so the byte limit splits the entries
+  // well before the entity limit does.
+  EXPECT_GT(num_chunks, 2 * kNumEntries / 64);
+}
+
 // Check functions invoked on UpdatePortState() call.
 TEST_F(BcmNodeTest, TestUpdatePortState) {
   ASSERT_NO_FATAL_FAILURE(PushChassisConfigWithCheck());
@@ -19,6 +19,7 @@
 #include <sys/types.h>
 #include <unistd.h>
 
+#include <algorithm>
 #include <memory>
 #include <utility>
 
@@ -40,6 +41,9 @@ DEFINE_int32(knet_rx_poll_timeout_ms, 100,
 DEFINE_int32(knet_max_num_packets_to_read_at_once, 8,
              "Determines the number of packets we try to read at once as soon "
              "as the socket FD becomes available.");
+DEFINE_bool(knet_rx_use_recvmmsg, false,
+            "If true, the KNET RX threads read each batch of packets with a "
+            "single recvmmsg() call instead of one recvmsg() per packet.");
 
 // TODO(unknown): I really really wish we could use google3 thread libraries.
 namespace stratum {
@@ -1022,6 +1026,11 @@ std::string BcmPacketioManager::GetKnetIntfNameTemplate(
     return MAKE_ERROR(ERR_INTERNAL)
            << "epoll_ctl() failed. errno: " << errno << ".";
   }
+  // The buffers for the received packets are allocated once for the lifetime
+  // of the thread and reused for every batch read from the socket.
+  PacketRxRing rx_ring(std::max(1, FLAGS_knet_max_num_packets_to_read_at_once),
+                       bcm_sdk_interface_->GetKnetHeaderSizeForRx(unit_),
+                       kMaxRxBufferSize);
   while (true) {
     {
       absl::ReaderMutexLock l(&chassis_lock);
@@ -1036,20 +1045,24 @@ std::string BcmPacketioManager::GetKnetIntfNameTemplate(
       INCREMENT_RX_COUNTER(purpose, rx_errors_epoll_wait_failures);
       continue;  // let it retry
     } else if (ret > 0 && pevents[0].events & EPOLLIN) {
-      // We have data to receive. Try to read max of
+      // We have data to receive. Read a batch of max
       // FLAGS_knet_max_num_packets_to_read_at_once packets before we try to
-      // check for exit criteria.
+      // check for exit criteria. The chassis lock is held once for the whole
+      // batch.
       std::vector<::p4::v1::PacketIn> packets;
-      for (int i = 0; i < FLAGS_knet_max_num_packets_to_read_at_once; ++i) {
+      {
         absl::ReaderMutexLock l(&chassis_lock);
         if (shutdown) break;
-        std::string header = "";
-        ::p4::v1::PacketIn packet;
-        ASSIGN_OR_RETURN(bool retry,
-                         RxPacket(purpose, rx_sock, netif_index, &header,
-                                  packet.mutable_payload()));
-        if (!retry) break;
-        if (!header.empty()) {
+        ASSIGN_OR_RETURN(int num_packets,
+                         RxPackets(purpose, rx_sock, netif_index, &rx_ring));
+        packets.reserve(num_packets);
+        for (int i = 0; i < num_packets; ++i) {
+          std::string header = "";
+          ::p4::v1::PacketIn packet;
+          if (!ExtractRxPacket(purpose, netif_index, rx_ring, i, &header,
+                               packet.mutable_payload())) {
+            continue;  // let it retry
+          }
           // We received good data. Process it. The parsing errors will not
           // result in RX thread to shutdown.
           int ingress_logical_port = 0, egress_logical_port = 0;
@@ -1117,10 +1130,10 @@ std::string BcmPacketioManager::GetKnetIntfNameTemplate(
             continue;  // let it retry
           }
           INCREMENT_RX_COUNTER(purpose, rx_accepts);
-          packets.push_back(packet);
+          packets.push_back(std::move(packet));
         }
       }
-      // Send the packet to the packet RX writer.
+      // Send the packets to the packet RX writer.
       if (!packets.empty()) {
         absl::ReaderMutexLock l(&rx_writer_lock_);
         auto* writer = gtl::FindOrNull(purpose_to_rx_writer_, purpose);
@@ -1142,110 +1155,110 @@ std::string BcmPacketioManager::GetKnetIntfNameTemplate(
   return ::util::OkStatus();
 }
 
-::util::StatusOr<bool> BcmPacketioManager::RxPacket(
+::util::StatusOr<int> BcmPacketioManager::RxPackets(
     GoogleConfig::BcmKnetIntfPurpose purpose, int sock, int netif_index,
-    std::string* header, std::string* payload) {
-  if (header == nullptr || payload == nullptr) {
-    return MAKE_ERROR(ERR_INTERNAL) << "Null header or payload!";
+    PacketRxRing* rx_ring) {
+  if (rx_ring == nullptr) {
+    return MAKE_ERROR(ERR_INTERNAL) << "Null rx_ring!";
   }
 
-  header->clear();
-  payload->clear();
-
-  constexpr size_t kMaxIovLen = 2;
-  struct iovec iov[kMaxIovLen];
-  size_t idx = 0;
-  size_t header_size = bcm_sdk_interface_->GetKnetHeaderSizeForRx(unit_);
-  std::unique_ptr<char[]> header_buffer(new char[header_size]);
-  std::unique_ptr<char[]> payload_buffer(new char[kMaxRxBufferSize]);
-  memset(header_buffer.get(), 0, header_size);
-  memset(payload_buffer.get(), 0, kMaxRxBufferSize);
-
-  iov[idx].iov_base = header_buffer.get();
-  iov[idx].iov_len = header_size;
-  idx++;
-
-  iov[idx].iov_base = payload_buffer.get();
-  iov[idx].iov_len = kMaxRxBufferSize;
-  idx++;
-
-  CHECK_RETURN_IF_FALSE(idx <= kMaxIovLen);  // juts in case. Will never happen
-
-  struct sockaddr_ll sa;
-  memset(&sa, 0, sizeof(sa));
-
-  struct msghdr msg;
-  memset(&msg, 0, sizeof(msg));
-  msg.msg_iov = iov;
-  msg.msg_iovlen = idx;
-  msg.msg_name = &sa;
-  msg.msg_namelen = sizeof(sa);
-
-  ssize_t res = recvmsg(sock, &msg, MSG_DONTWAIT);
-  if (res < 0) {
-    switch (errno) {
-      case EINTR:
-        // Signal received before we could read anything. Need to retry.
-        return true;
-      case EAGAIN:
-        // No data was available. No need to retry before we check for data
-        // available again.
-        return false;
-      default:
-        VLOG(1) << "Error when receiving packet on netif  " << netif_index
+  if (FLAGS_knet_rx_use_recvmmsg) {
+    int res = rx_ring->ReceiveBatch(sock);
+    if (res < 0) {
+      // In case of EINTR (signal received before we could read anything) or
+      // EAGAIN (no data was available) we just wait for data to be available
+      // again.
+      if (errno != EINTR && errno != EAGAIN) {
+        VLOG(1) << "Error when receiving packets on netif  " << netif_index
                 << " on unit " << unit_ << ": " << errno;
         INCREMENT_RX_COUNTER(purpose, rx_errors_internal_read_failures);
-        // We retry in case of other errors as well.
-        return true;
+      }
+      return 0;
     }
-  } else if (res == 0) {
-    INCREMENT_RX_COUNTER(purpose, rx_errors_sock_shutdown);
-    return MAKE_ERROR(ERR_INTERNAL)
-           << "Unexpected socket shutdown on netif  " << netif_index
-           << " on unit " << unit_ << ".";
+    return res;
   }
 
+  int num_packets = 0;
+  for (int i = 0; i < rx_ring->NumSlots(); ++i) {
+    ssize_t res = rx_ring->Receive(sock, num_packets);
+    if (res < 0) {
+      switch (errno) {
+        case EINTR:
+          // Signal received before we could read anything. Need to retry.
+          continue;
+        case EAGAIN:
+          // No data was available. No need to retry before we check for data
+          // available again.
+          return num_packets;
+        default:
+          VLOG(1) << "Error when receiving packet on netif  " << netif_index
+                  << " on unit " << unit_ << ": " << errno;
+          INCREMENT_RX_COUNTER(purpose, rx_errors_internal_read_failures);
+          // We retry in case of other errors as well.
+          continue;
+      }
+    } else if (res == 0) {
+      INCREMENT_RX_COUNTER(purpose, rx_errors_sock_shutdown);
+      return MAKE_ERROR(ERR_INTERNAL)
+             << "Unexpected socket shutdown on netif  " << netif_index
+             << " on unit " << unit_ << ".";
+    }
+    num_packets++;
+  }
+
+  return num_packets;
+}
+
+bool BcmPacketioManager::ExtractRxPacket(
+    GoogleConfig::BcmKnetIntfPurpose purpose, int netif_index,
+    const PacketRxRing& rx_ring, int slot, std::string* header,
+    std::string* payload) {
+  header->clear();
+  payload->clear();
+
   INCREMENT_RX_COUNTER(purpose, all_rx);
-  // res > 0 so cast to size_t is safe.
-  if (static_cast<size_t>(res) < header_size) {
+  size_t header_size = rx_ring.HeaderSize();
+  size_t received_size = rx_ring.ReceivedBytes(slot);
+  if (received_size < header_size) {
     VLOG(1) << "Num of received bytes on netif  " << netif_index << " on unit "
             << unit_ << " < " << header_size << ".";
     INCREMENT_RX_COUNTER(purpose, rx_errors_incomplete_read);
-    return true;
+    return false;
   }
-  size_t payload_size = static_cast<size_t>(res - header_size);
+  size_t payload_size = received_size - header_size;
 
-  // Try to see if the message looks OK. If not retry.
-  if (msg.msg_flags & MSG_TRUNC || sa.sll_ifindex != netif_index ||
+  // Try to see if the message looks OK. If not drop it.
+  const struct sockaddr_ll& sa = rx_ring.Source(slot);
+  if (rx_ring.Truncated(slot) || sa.sll_ifindex != netif_index ||
       sa.sll_pkttype == PACKET_OUTGOING) {
     VLOG(1) << "Received invalid packet on netif  " << netif_index
             << " on unit " << unit_ << ".";
     INCREMENT_RX_COUNTER(purpose, rx_errors_invalid_packet);
-    return true;
+    return false;
   }
 
   // Strip some known VLAN tags.
-  struct ether_header* ether_header =
-      reinterpret_cast<struct ether_header*>(payload_buffer.get());
+  const char* payload_buffer = rx_ring.Payload(slot);
+  const struct ether_header* ether_header =
+      reinterpret_cast<const struct ether_header*>(payload_buffer);
   bool tagged = false;
   if (payload_size >= sizeof(struct ether_header) + kVlanIdSize &&
       ntohs(ether_header->ether_type) == ETHERTYPE_VLAN) {
-    auto* pid = reinterpret_cast<uint16*>(payload_buffer.get() +
-                                          sizeof(struct ether_header));
+    auto* pid = reinterpret_cast<const uint16*>(payload_buffer +
+                                                sizeof(struct ether_header));
     uint16 vlan = ntohs(*pid) & kVlanIdMask;
     if (vlan == kDefaultVlan || vlan == kArpVlan || vlan == 0) {
       tagged = true;
     }
   }
-
   if (tagged) {
-    payload->assign(payload_buffer.get(), ETH_ALEN * 2);
-    payload->append(payload_buffer.get() + ETH_ALEN * 2 + kVlanTagSize,
+    payload->assign(payload_buffer, ETH_ALEN * 2);
+    payload->append(payload_buffer + ETH_ALEN * 2 + kVlanTagSize,
                     payload_size - ETH_ALEN * 2 - kVlanTagSize);
   } else {
-    payload->assign(payload_buffer.get(), payload_size);
+    payload->assign(payload_buffer, payload_size);
   }
-  header->assign(header_buffer.get(), header_size);
+  header->assign(rx_ring.Header(slot), header_size);
 
   return true;
 }
@@ -23,6 +23,7 @@
 #include "stratum/hal/lib/bcm/bcm_global_vars.h"
 #include "stratum/hal/lib/bcm/bcm_sdk_interface.h"
 #include "stratum/hal/lib/bcm/constants.h"
+#include "stratum/hal/lib/bcm/packet_rx_ring.h"
 #include "stratum/hal/lib/common/writer_interface.h"
 #include "stratum/hal/lib/common/common.pb.h"
 #include "stratum/hal/lib/common/constants.h"
@@ -394,12 +395,22 @@ class BcmPacketioManager {
       GoogleConfig::BcmKnetIntfPurpose purpose)
       LOCKS_EXCLUDED(chassis_lock, rx_writer_lock_);
 
-  // Helper called by HandleKnetIntfPacketRx() to read one single full message
-  // from a socket. Returns true if we need to retry the receive and false if
-  // otherwise. If any non-recoverable error is encountered, returns error.
-  ::util::StatusOr<bool> RxPacket(GoogleConfig::BcmKnetIntfPurpose purpose,
+  // Helper called by HandleKnetIntfPacketRx() to read a batch of messages
+  // from a socket into the slots of 'rx_ring', using one recvmmsg() call if
+  // FLAGS_knet_rx_use_recvmmsg is set or one recvmsg() call per message
+  // otherwise. Returns the number of slots filled (0 if no data was
+  // available). If any non-recoverable error is encountered, returns error.
+  ::util::StatusOr<int> RxPackets(GoogleConfig::BcmKnetIntfPurpose purpose,
                                   int sock, int netif_index,
-                                  std::string* header, std::string* payload);
+                                  PacketRxRing* rx_ring);
+
+  // Helper called by HandleKnetIntfPacketRx() to validate the message
+  // received in a slot of 'rx_ring' and split it into KNET header and
+  // payload, stripping known VLAN tags from the payload. Returns false if the
+  // message is invalid and must be dropped.
+  bool ExtractRxPacket(GoogleConfig::BcmKnetIntfPurpose purpose,
+                       int netif_index, const PacketRxRing& rx_ring, int slot,
+                       std::string* header, std::string* payload);
 
   // Deparses the given PacketInMetadata to the a set of
   // P4 PacketMetadata protos in the given P4 PacketIn which
@@ -26,6 +26,9 @@
 // #include "util/libcproxy/libcwrapper.h"
 // #include "util/libcproxy/passthrough_proxy.h"
 
+DECLARE_bool(knet_rx_use_recvmmsg);
+DECLARE_int32(knet_max_num_packets_to_read_at_once);
+
 using ::testing::_;
 using ::testing::DoAll;
 using ::testing::HasSubstr;
@@ -89,6 +92,10 @@ class LibcProxyMock : public PassthroughLibcProxy {
   ssize_t recvmsg(int sockfd, struct msghdr* msg, int flags) override {
     return RecvMsg(sockfd, msg, flags);
   }
+  int recvmmsg(int sockfd, struct mmsghdr* msgvec, unsigned int vlen, int flags,
+               struct timespec* timeout) override {
+    return RecvMMsg(sockfd, msgvec, vlen, flags, timeout);
+  }
   int epoll_create1(int flags) override { return EpollCreate1(flags); }
   int epoll_ctl(int efd, int op, int fd, struct epoll_event* event) override {
     return EpollCtl(efd, op, fd, event);
@@ -113,6 +120,9 @@ class LibcProxyMock : public PassthroughLibcProxy {
   MOCK_METHOD3(SendMsg,
                ssize_t(int sockfd, const struct msghdr* msg, int flags));
   MOCK_METHOD3(RecvMsg, ssize_t(int sockfd, struct msghdr* msg, int flags));
+  MOCK_METHOD5(RecvMMsg, int(int sockfd, struct mmsghdr* msgvec,
+                             unsigned int vlen, int flags,
+                             struct timespec* timeout));
   MOCK_METHOD1(EpollCreate1, int(int flags));
   MOCK_METHOD4(EpollCtl,
                int(int efd, int op, int fd, struct epoll_event* event));
@@ -196,6 +206,7 @@ class BcmPacketioManagerTest : public ::testing::TestWithParam<OperationMode> {
       absl::WriterMutexLock l(&chassis_lock);
       shutdown = false;
     }
+    FLAGS_knet_rx_use_recvmmsg = false;
   }
 
   ::util::Status PushChassisConfig(const ChassisConfig& config,
@@ -1375,6 +1386,170 @@ TEST_P(BcmPacketioManagerTest,
   }
 }
 
+TEST_P(BcmPacketioManagerTest,
+       RegisterPacketReceiveWriterAndReceivePacketBatchesWithRecvmmsg) {
+  if (mode_ == OPERATION_MODE_SIM) return;  // no need to run in sim mode
+  FLAGS_knet_rx_use_recvmmsg = true;
+  constexpr int kNumPacketsPerBatch = 3;
+
+  //--------------------------------------------------------------
+  // Config push
+  //--------------------------------------------------------------
+
+  ChassisConfig config;
+  std::map<uint32, SdkPort> port_id_to_sdk_port = {};
+  ASSERT_OK(PopulateChassisConfigAndPortMaps(kNodeId1, &config,
+                                             &port_id_to_sdk_port));
+  config.clear_vendor_config();  // default config
+
+  // Expected calls to BcmChassisManager for first config push.
+  EXPECT_CALL(*bcm_chassis_ro_mock_, GetPortIdToSdkPortMap(kNodeId1))
+      .WillOnce(Return(port_id_to_sdk_port));
+
+  // Track the socket FDs;
+  LibcProxyMock::Instance()->TrackFds({kSocket1, kEfd});
+
+  // Expected libc calls for config push.
+  EXPECT_CALL(*LibcProxyMock::Instance(), Socket(_, _, _))
+      .Times(3)
+      .WillRepeatedly(Return(kSocket1));
+  EXPECT_CALL(*LibcProxyMock::Instance(), Ioctl(kSocket1, _, _))
+      .Times(5)
+      .WillRepeatedly(Return(0));
+  EXPECT_CALL(*LibcProxyMock::Instance(), Close(kSocket1)).WillOnce(Return(0));
+  EXPECT_CALL(*LibcProxyMock::Instance(), SetSockOpt(kSocket1, _, _, _, _))
+      .Times(2)
+      .WillRepeatedly(Return(0));
+  EXPECT_CALL(*LibcProxyMock::Instance(), Bind(kSocket1, _, _))
+      .WillOnce(Return(0));
+
+  // Expected calls to BcmSdkInterface for config push.
+  EXPECT_CALL(*bcm_sdk_mock_, StartRx(kUnit1, _))
+      .WillOnce(Return(::util::OkStatus()));
+  EXPECT_CALL(*bcm_sdk_mock_, CreateKnetIntf(kUnit1, kDefaultVlan, _, _))
+      .WillRepeatedly(
+          DoAll(SetArgPointee<3>(kNetifId), Return(::util::OkStatus())));
+  EXPECT_CALL(*bcm_sdk_mock_, CreateKnetFilter(kUnit1, _, kFilterTypeCatchAll))
+      .WillOnce(Return(kCatchAllFilterId1));
+
+  // libc calls triggered by RX thread. Every recvmmsg() call returns a batch
+  // of packets tagged with VLAN 0, which is stripped before the packets are
+  // sent to the controller. recvmsg() must not be used at all.
+  EXPECT_CALL(*LibcProxyMock::Instance(), EpollCreate1(0))
+      .WillRepeatedly(Return(kEfd));
+  EXPECT_CALL(*LibcProxyMock::Instance(),
+              EpollCtl(kEfd, EPOLL_CTL_ADD, kSocket1, _))
+      .WillRepeatedly(Return(0));
+  EXPECT_CALL(*LibcProxyMock::Instance(), EpollWait(kEfd, _, 1, _))
+      .WillRepeatedly(DoAll(WithArgs<1>(Invoke([](struct epoll_event* p) {
+                              p[0].events = EPOLLIN;
+                            })),
+                            Return(1)));  // 1 means RX packet is available
+  EXPECT_CALL(*LibcProxyMock::Instance(), RecvMsg(_, _, _)).Times(0);
+  EXPECT_CALL(*LibcProxyMock::Instance(),
+              RecvMMsg(kSocket1, _, FLAGS_knet_max_num_packets_to_read_at_once,
+                       MSG_DONTWAIT, nullptr))
+      .WillRepeatedly(DoAll(WithArgs<1>(Invoke([](struct mmsghdr* msgs) {
+                              for (int i = 0; i < kNumPacketsPerBatch; ++i) {
+                                ASSERT_EQ(2U, msgs[i].msg_hdr.msg_iovlen);
+                                char* payload = static_cast<char*>(
+                                    msgs[i].msg_hdr.msg_iov[1].iov_base);
+                                memset(payload, 0, kTestPacketBodySize);
+                                payload[ETH_ALEN * 2] = 0x81;  // ETHERTYPE_VLAN
+                                msgs[i].msg_len =
+                                    kTestKnetHeaderSize + kTestPacketBodySize;
+                              }
+                            })),
+                            Return(kNumPacketsPerBatch)));
+
+  // BcmSdkInterface calls triggered by RX thread.
+  EXPECT_CALL(*bcm_sdk_mock_, GetKnetHeaderSizeForRx(kUnit1))
+      .WillRepeatedly(Return(kTestKnetHeaderSize));
+
+  EXPECT_CALL(*bcm_sdk_mock_, ParseKnetHeaderForRx(kUnit1, _, _, _, _))
+      .WillRepeatedly(DoAll(SetArgPointee<2>(kLogicalPort1),
+                            SetArgPointee<3>(kCpuLogicalPort),
+                            SetArgPointee<4>(5), Return(::util::OkStatus())));
+
+  // BcmChassisRoInterface calls triggered by RX thread.
+  EXPECT_CALL(*bcm_chassis_ro_mock_, GetParentTrunkId(kNodeId1, kPortId1))
+      .WillRepeatedly(Return(kTrunkId1));
+
+  // P4TableMapper calls triggered by RX thread.
+  EXPECT_CALL(*p4_table_mapper_mock_, DeparsePacketInMetadata(_, _))
+      .WillRepeatedly(
+          DoAll(WithArgs<1>(Invoke([](::p4::v1::PacketMetadata* m) {
+                  ParseProtoFromString(kTestPacketMetadata1, m).IgnoreError();
+                })),
+                Return(::util::OkStatus())));
+
+  // Call PushChassisConfig to initialize the class. The RX thread will be
+  // initialized as part of config push.
+  ASSERT_OK(PushChassisConfig(config, kNodeId1));
+
+  //--------------------------------------------------------------
+  // Register packet receive handler
+  //--------------------------------------------------------------
+  auto writer = std::make_shared<WriterMock<::p4::v1::PacketIn>>();
+  int num_received = 0;
+  std::string payload = "";
+  EXPECT_CALL(*writer, Write(_))
+      .WillRepeatedly(Invoke([&](const ::p4::v1::PacketIn& packet) {
+        absl::WriterMutexLock l(&rx_lock_);
+        payload = packet.payload();
+        if (++num_received == kNumPacketsPerBatch) rx_complete_ = true;
+        return true;
+      }));
+  ASSERT_OK(RegisterPacketReceiveWriter(
+      GoogleConfig::BCM_KNET_INTF_PURPOSE_CONTROLLER, writer));
+
+  // We now wait until at least a full batch is sent to the receive handler.
+  while (!RxComplete()) {
+  }  // no sleep, check as fast as possible
+
+  {
+    absl::ReaderMutexLock l(&rx_lock_);
+    EXPECT_EQ(kTestPacketBodySize - kVlanTagSize, payload.size());
+  }
+  {
+    SCOPED_TRACE(bcm_packetio_manager_->DumpStats());
+    CheckNoTxStats();
+    CHECK_NON_ZERO_RX_COUNTER(GoogleConfig::BCM_KNET_INTF_PURPOSE_CONTROLLER,
+                              all_rx);
+    CHECK_NON_ZERO_RX_COUNTER(GoogleConfig::BCM_KNET_INTF_PURPOSE_CONTROLLER,
+                              rx_accepts);
+    CHECK_ZERO_RX_COUNTER(GoogleConfig::BCM_KNET_INTF_PURPOSE_CONTROLLER,
+                          rx_errors_internal_read_failures);
+    CHECK_ZERO_RX_COUNTER(GoogleConfig::BCM_KNET_INTF_PURPOSE_CONTROLLER,
+                          rx_errors_incomplete_read);
+    CHECK_ZERO_RX_COUNTER(GoogleConfig::BCM_KNET_INTF_PURPOSE_CONTROLLER,
+                          rx_errors_invalid_packet);
+  }
+
+  //--------------------------------------------------------------
+  // Shutdown
+  //--------------------------------------------------------------
+
+  // Expected libc calls for shutdown.
+  EXPECT_CALL(*LibcProxyMock::Instance(), Close(kSocket1))
+      .Times(2)
+      .WillRepeatedly(Return(0));
+
+  // Expected calls to BcmSdkInterface for shutdown.
+  EXPECT_CALL(*bcm_sdk_mock_, StopRx(kUnit1))
+      .WillOnce(Return(::util::OkStatus()));
+  EXPECT_CALL(*bcm_sdk_mock_, DestroyKnetFilter(kUnit1, kCatchAllFilterId1))
+      .WillOnce(Return(::util::OkStatus()));
+  EXPECT_CALL(*bcm_sdk_mock_, DestroyKnetIntf(kUnit1, kNetifId))
+      .WillOnce(Return(::util::OkStatus()));
+
+  // libc calls triggered by RX thread.
+  EXPECT_CALL(*LibcProxyMock::Instance(), Close(kEfd))
+      .WillRepeatedly(Return(0));
+
+  ASSERT_OK(Shutdown());
+}
+
 TEST_P(BcmPacketioManagerTest,
        RegisterPacketReceiveWriterAndHandleReceiveErrors) {
   if (mode_ == OPERATION_MODE_SIM) return;  // no need to run in sim mode
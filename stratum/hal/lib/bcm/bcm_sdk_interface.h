@@ -160,6 +160,40 @@ class BcmSdkInterface {
     BoolFlag stats_read_through_enable;
   };
 
+  // L3Route encapsulates an IPv4/IPv6 L3 LPM or host route given to the
+  // batched AddL3Routes() API. The fields have the same meaning as the args of
+  // AddL3RouteIpv4/Ipv6() and AddL3HostIpv4/Ipv6().
+  struct L3Route {
+    // Host route (exact match on the address) or LPM route?
+    bool is_host;
+    // IPv6 (subnet_ipv6/mask_ipv6) or IPv4 (subnet_ipv4/mask_ipv4) route?
+    bool is_ipv6;
+    int vrf;
+    // IPv4 subnet, or IPv4 address for host routes.
+    uint32 subnet_ipv4;
+    // IPv4 subnet mask. Not used for host routes.
+    uint32 mask_ipv4;
+    // IPv6 subnet, or IPv6 address for host routes, as a 16-byte string.
+    std::string subnet_ipv6;
+    // IPv6 subnet mask as a 16-byte string. Not used for host routes.
+    std::string mask_ipv6;
+    int class_id;
+    int egress_intf_id;
+    // Not used for host routes, which only point to non-multipath intfs.
+    bool is_intf_multipath;
+    L3Route()
+        : is_host(false),
+          is_ipv6(false),
+          vrf(0),
+          subnet_ipv4(0),
+          mask_ipv4(0),
+          subnet_ipv6(),
+          mask_ipv6(),
+          class_id(0),
+          egress_intf_id(0),
+          is_intf_multipath(false) {}
+  };
+
   // LinkscanEvent encapsulates the information received on a linkscan event.
   struct LinkscanEvent {
     int unit;
@@ -224,6 +258,11 @@ class BcmSdkInterface {
   virtual ::util::Status GetPortCounters(int unit, int port,
                                          PortCounters* pc) = 0;
 
+  // Gets the counters of all the logical ports of the given unit in one
+  // pass over the SDK counter tables, keyed by logical port.
+  virtual ::util::Status GetAllPortCounters(
+      int unit, std::map<int, PortCounters>* counters) = 0;
+
   // Starts the diag shell server for listening to client telnet connections.
   virtual ::util::Status StartDiagShellServer() = 0;
 
@@ -387,6 +426,18 @@ class BcmSdkInterface {
                                        const std::string& ipv6, int class_id,
                                        int egress_intf_id) = 0;
 
+  // Adds a batch of IPv4/IPv6 L3 LPM and host routes, which may be mixed. The
+  // result is the same as calling AddL3RouteIpv4/Ipv6() or
+  // AddL3HostIpv4/Ipv6() for every route, but implementations are expected to
+  // program the routes in as few SDK operations as possible. One route failing
+  // does not prevent the others from being added. On return, results holds
+  // the status of every route in the same order as routes. The returned status
+  // is an error only if the batch as a whole could not be programmed, in which
+  // case the results of the routes not programmed are errors as well.
+  virtual ::util::Status AddL3Routes(int unit,
+                                     const std::vector<L3Route>& routes,
+                                     std::vector<::util::Status>* results) = 0;
+
   // Modifies class_id and/or egress_intf_id of an existing IPv4 L3 LPM route
   // with key (vrf, subnet, mask). If vrf == 0, default VRF is used. If
   // class_id == 0, class ID will not be modified. The new egress intf to use is
@@ -6,6 +6,7 @@
 #ifndef STRATUM_HAL_LIB_BCM_BCM_SDK_MOCK_H_
 #define STRATUM_HAL_LIB_BCM_BCM_SDK_MOCK_H_
 
+#include <map>
 #include <memory>
 #include <string>
 #include <vector>
@@ -41,6 +42,8 @@ class BcmSdkMock : public BcmSdkInterface {
                ::util::Status(int unit, int port, BcmPortOptions* options));
   MOCK_METHOD3(GetPortCounters,
                ::util::Status(int unit, int port, PortCounters* pc));
+  MOCK_METHOD2(GetAllPortCounters,
+               ::util::Status(int unit, std::map<int, PortCounters>* counters));
   MOCK_METHOD0(StartDiagShellServer, ::util::Status());
   MOCK_METHOD1(StartLinkscan, ::util::Status(int unit));
   MOCK_METHOD1(StopLinkscan, ::util::Status(int unit));
@@ -100,6 +103,9 @@ class BcmSdkMock : public BcmSdkInterface {
   MOCK_METHOD5(AddL3HostIpv6,
                ::util::Status(int unit, int vrf, const std::string& ipv6,
                               int class_id, int egress_intf_id));
+  MOCK_METHOD3(AddL3Routes,
+               ::util::Status(int unit, const std::vector<L3Route>& routes,
+                              std::vector<::util::Status>* results));
   MOCK_METHOD7(ModifyL3RouteIpv4,
                ::util::Status(int unit, int vrf, uint32 subnet, uint32 mask,
                               int class_id, int egress_intf_id,
@@ -339,6 +339,22 @@ BcmSwitch::~BcmSwitch() {}
             resp.mutable_port_counters()));
         break;
       }
+      case DataRequest::Request::kNodePortCounters: {
+        // Counters of all the requested ports of the node, read at once.
+        const auto& node_ports = req.node_port_counters();
+        std::map<uint32, PortCounters> counters;
+        status.Update(bcm_chassis_manager_->GetNodePortCounters(
+            node_ports.node_id(),
+            {node_ports.port_ids().begin(), node_ports.port_ids().end()},
+            &counters));
+        auto* node_port_counters = resp.mutable_node_port_counters();
+        node_port_counters->set_node_id(node_ports.node_id());
+        auto* port_counters = node_port_counters->mutable_port_counters();
+        for (auto& e : counters) {
+          (*port_counters)[e.first] = std::move(e.second);
+        }
+        break;
+      }
       case DataRequest::Request::kHealthIndicator:
         // Find current port health indicator (LED) for port located at:
         // - node_id: req.health_indicator().node_id()
@@ -13,6 +13,7 @@
 #include "stratum/hal/lib/bcm/constants.h"
 #include "stratum/hal/lib/bcm/utils.h"
 #include "stratum/hal/lib/common/constants.h"
+#include "stratum/hal/lib/common/read_response_chunker.h"
 #include "stratum/lib/macros.h"
 #include "stratum/lib/utils.h"
 #include "stratum/glue/integral_types.h"
@@ -1551,24 +1552,35 @@ std::set<uint32> BcmTableManager::GetAllAclTableIDs() const {
     return MAKE_ERROR(ERR_INTERNAL) << "Null acl_flows.";
   }
 
+  // Acl entries should also be recorded in acl_flows. These are pointers to
+  // the acl entries in resp.
+  return StreamTableEntries(
+      table_ids, [resp, acl_flows](const ::p4::v1::TableEntry& table_entry,
+                                   bool is_acl) {
+        auto entry_ptr = resp->add_entities()->mutable_table_entry();
+        *entry_ptr = table_entry;
+        if (is_acl) acl_flows->push_back(entry_ptr);
+        return ::util::OkStatus();
+      });
+}
+
+::util::Status BcmTableManager::StreamTableEntries(
+    const std::set<uint32>& table_ids,
+    const TableEntryCallback& callback) const {
   // Return all tables if no table ids were specified.
   if (table_ids.empty()) {
     for (const auto& pair : generic_flow_tables_) {
       // We shouldn't return static flows.
       if (pair.second.IsConst()) continue;
       for (const auto& table_entry : pair.second) {
-        *resp->add_entities()->mutable_table_entry() = table_entry;
+        RETURN_IF_ERROR(callback(table_entry, false));
       }
     }
-    // Acl entries should also be recorded in acl_flows. These are pointers to
-    // the acl entries in resp.
     for (const auto& pair : acl_tables_) {
       // We shouldn't return static flows.
       if (pair.second.IsConst()) continue;
       for (const auto& table_entry : pair.second) {
-        auto entry_ptr = resp->add_entities()->mutable_table_entry();
-        *entry_ptr = table_entry;
-        acl_flows->push_back(entry_ptr);
+        RETURN_IF_ERROR(callback(table_entry, true));
       }
     }
   } else {
@@ -1579,12 +1591,8 @@ std::set<uint32> BcmTableManager::GetAllAclTableIDs() const {
       if (acl_lookup) {
         // We shouldn't return static flows.
         if (acl_lookup->IsConst()) continue;
-        // Acl entries should also be recorded in acl_flows. These are pointers
-        // to the acl entries in resp.
         for (const auto& table_entry : *acl_lookup) {
-          auto entry_ptr = resp->add_entities()->mutable_table_entry();
-          *entry_ptr = table_entry;
-          acl_flows->push_back(entry_ptr);
+          RETURN_IF_ERROR(callback(table_entry, true));
         }
         continue;
       }
@@ -1595,7 +1603,7 @@ std::set<uint32> BcmTableManager::GetAllAclTableIDs() const {
         // We shouldn't return static flows.
         if (lookup->IsConst()) continue;
         for (const auto& table_entry : *lookup) {
-          *resp->add_entities()->mutable_table_entry() = table_entry;
+          RETURN_IF_ERROR(callback(table_entry, false));
         }
       }
     }
@@ -1619,17 +1627,15 @@ std::set<uint32> BcmTableManager::GetAllAclTableIDs() const {
     return MAKE_ERROR(ERR_INTERNAL) << "Null writer.";
   }
 
-  ::p4::v1::ReadResponse resp;
+  ReadResponseChunker chunker(writer);
   for (const auto& member : members_) {
     if (action_profile_ids.empty() ||
         action_profile_ids.count(member.second.action_profile_id())) {
-      auto* entity = resp.add_entities();
+      ASSIGN_OR_RETURN(auto* entity, chunker.AddEntity());
       *entity->mutable_action_profile_member() = member.second;
     }
   }
-  if (!writer->Write(resp)) {
-    return MAKE_ERROR(ERR_INTERNAL) << "Write to stream channel failed.";
-  }
+  RETURN_IF_ERROR(chunker.Flush());
 
   return ::util::OkStatus();
 }
@@ -1641,17 +1647,15 @@ std::set<uint32> BcmTableManager::GetAllAclTableIDs() const {
     return MAKE_ERROR(ERR_INTERNAL) << "Null writer.";
   }
 
-  ::p4::v1::ReadResponse resp;
+  ReadResponseChunker chunker(writer);
   for (const auto& group : groups_) {
     if (action_profile_ids.empty() ||
         action_profile_ids.count(group.second.action_profile_id())) {
-      auto* entity = resp.add_entities();
+      ASSIGN_OR_RETURN(auto* entity, chunker.AddEntity());
       *entity->mutable_action_profile_group() = group.second;
     }
   }
-  if (!writer->Write(resp)) {
-    return MAKE_ERROR(ERR_INTERNAL) << "Write to stream channel failed.";
-  }
+  RETURN_IF_ERROR(chunker.Flush());
 
   return ::util::OkStatus();
 }
@@ -1663,18 +1667,16 @@ std::set<uint32> BcmTableManager::GetAllAclTableIDs() const {
     return MAKE_ERROR(ERR_INTERNAL) << "Null writer.";
   }
 
-  ::p4::v1::ReadResponse resp;
+  ReadResponseChunker chunker(writer);
   for (const auto& group : multicast_groups_) {
     if (multicast_group_ids.empty() ||
         multicast_group_ids.count(group.second.multicast_group_id())) {
-      auto* entity = resp.add_entities();
+      ASSIGN_OR_RETURN(auto* entity, chunker.AddEntity());
       *entity->mutable_packet_replication_engine_entry()
           ->mutable_multicast_group_entry() = group.second;
     }
   }
-  if (!writer->Write(resp)) {
-    return MAKE_ERROR(ERR_INTERNAL) << "Write to stream channel failed.";
-  }
+  RETURN_IF_ERROR(chunker.Flush());
 
   return ::util::OkStatus();
 }
@@ -1686,18 +1688,16 @@ std::set<uint32> BcmTableManager::GetAllAclTableIDs() const {
     return MAKE_ERROR(ERR_INTERNAL) << "Null writer.";
   }
 
-  ::p4::v1::ReadResponse resp;
+  ReadResponseChunker chunker(writer);
   for (const auto& session : clone_sessions_) {
     if (clone_session_ids.empty() ||
         clone_session_ids.count(session.second.session_id())) {
-      auto* entity = resp.add_entities();
+      ASSIGN_OR_RETURN(auto* entity, chunker.AddEntity());
       *entity->mutable_packet_replication_engine_entry()
           ->mutable_clone_session_entry() = session.second;
     }
   }
-  if (!writer->Write(resp)) {
-    return MAKE_ERROR(ERR_INTERNAL) << "Write to stream channel failed.";
-  }
+  RETURN_IF_ERROR(chunker.Flush());
 
   return ::util::OkStatus();
 }
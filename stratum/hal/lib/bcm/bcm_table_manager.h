@@ -7,6 +7,7 @@
 #define STRATUM_HAL_LIB_BCM_BCM_TABLE_MANAGER_H_
 
 #include <algorithm>
+#include <functional>
 #include <map>
 #include <memory>
 #include <set>
@@ -320,6 +321,18 @@ class BcmTableManager {
       const std::set<uint32>& table_ids, ::p4::v1::ReadResponse* resp,
       std::vector<::p4::v1::TableEntry*>* acl_flows) const;
 
+  // Callback invoked by StreamTableEntries() for each entry read. is_acl is
+  // true for the entries of ACL tables, which have counters to be read.
+  using TableEntryCallback = std::function<::util::Status(
+      const ::p4::v1::TableEntry& table_entry, bool is_acl)>;
+
+  // Same as ReadTableEntries(), but passes the entries to 'callback' one at a
+  // time instead of copying all of them to a single response, so that large
+  // reads can be streamed. Stops at the first error returned by 'callback'.
+  virtual ::util::Status StreamTableEntries(
+      const std::set<uint32>& table_ids,
+      const TableEntryCallback& callback) const;
+
   // Finds the and returns the stored P4 TableEntry that matches the
   // given entry.
   virtual ::util::StatusOr<::p4::v1::TableEntry> LookupTableEntry(
@@ -373,12 +386,6 @@ class BcmTableManager {
   BcmTableManager();
 
  private:
-  // Typedefs for P4 TableEntry storage.
-  typedef absl::flat_hash_set<::p4::v1::TableEntry, TableEntryHash,
-                              TableEntryEqual>
-      TableEntrySet;
-  typedef absl::flat_hash_map<uint32, TableEntrySet> TableIdToTableEntrySetMap;
-
   // Private constructor. Use CreateInstance() to create an instance of this
   // class.
   BcmTableManager(const BcmChassisRoInterface* bcm_chassis_ro_interface,
@@ -114,6 +114,9 @@ class BcmTableManagerMock : public BcmTableManager {
       ::util::Status(const std::set<uint32>& table_ids,
                      ::p4::v1::ReadResponse* resp,
                      std::vector<::p4::v1::TableEntry*>* acl_flows));
+  MOCK_CONST_METHOD2(StreamTableEntries,
+                     ::util::Status(const std::set<uint32>& table_ids,
+                                    const TableEntryCallback& callback));
   MOCK_CONST_METHOD2(
       ReadActionProfileMembers,
       ::util::Status(const std::set<uint32>& action_profile_ids,
@@ -0,0 +1,70 @@
+// Copyright 2018-present Open Networking Foundation
+// SPDX-License-Identifier: Apache-2.0
+
+
+#include "stratum/hal/lib/bcm/packet_rx_ring.h"
+
+#include <string.h>
+
+#include "stratum/glue/logging.h"
+
+namespace stratum {
+namespace hal {
+namespace bcm {
+
+constexpr int PacketRxRing::kIovPerSlot;
+
+PacketRxRing::PacketRxRing(int num_slots, size_t header_size,
+                           size_t payload_size)
+    : header_size_(header_size),
+      payload_size_(payload_size),
+      header_buffer_(new char[num_slots * header_size + 1]),
+      payload_buffer_(new char[num_slots * payload_size]),
+      iovs_(num_slots * kIovPerSlot),
+      addrs_(num_slots),
+      msgs_(num_slots) {
+  CHECK_GT(num_slots, 0) << "PacketRxRing needs at least one slot.";
+  CHECK_GT(payload_size, 0) << "PacketRxRing needs a non-empty payload buffer.";
+  for (int i = 0; i < num_slots; ++i) {
+    struct iovec* iov = &iovs_[i * kIovPerSlot];
+    int iovlen = 0;
+    if (header_size_ > 0) {
+      iov[iovlen].iov_base = header_buffer_.get() + HeaderOffset(i);
+      iov[iovlen].iov_len = header_size_;
+      iovlen++;
+    }
+    iov[iovlen].iov_base = payload_buffer_.get() + PayloadOffset(i);
+    iov[iovlen].iov_len = payload_size_;
+    iovlen++;
+    memset(&msgs_[i], 0, sizeof(msgs_[i]));
+    msgs_[i].msg_hdr.msg_iov = iov;
+    msgs_[i].msg_hdr.msg_iovlen = iovlen;
+    msgs_[i].msg_hdr.msg_name = &addrs_[i];
+    ResetSlot(i);
+  }
+}
+
+int PacketRxRing::ReceiveBatch(int sock) {
+  for (int i = 0; i < NumSlots(); ++i) ResetSlot(i);
+  return recvmmsg(sock, msgs_.data(), msgs_.size(), MSG_DONTWAIT, nullptr);
+}
+
+ssize_t PacketRxRing::Receive(int sock, int slot) {
+  ResetSlot(slot);
+  ssize_t res = recvmsg(sock, &msgs_[slot].msg_hdr, MSG_DONTWAIT);
+  if (res >= 0) msgs_[slot].msg_len = res;
+  return res;
+}
+
+void PacketRxRing::ResetSlot(int slot) {
+  // The buffers themselves are not cleared: only the first ReceivedBytes()
+  // bytes of a slot are ever read back.
+  memset(&addrs_[slot], 0, sizeof(addrs_[slot]));
+  msgs_[slot].msg_hdr.msg_namelen = sizeof(addrs_[slot]);
+  msgs_[slot].msg_hdr.msg_flags = 0;
+  msgs_[slot].msg_len = 0;
+}
+
+}  // namespace bcm
+}  // namespace hal
+}  // namespace stratum
@@ -0,0 +1,100 @@
+// Copyright 2018-present Open Networking Foundation
+// SPDX-License-Identifier: Apache-2.0
+
+
+#ifndef STRATUM_HAL_LIB_BCM_PACKET_RX_RING_H_
+#define STRATUM_HAL_LIB_BCM_PACKET_RX_RING_H_
+
+#include <netpacket/packet.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <sys/uio.h>
+
+#include <memory>
+#include <vector>
+
+namespace stratum {
+namespace hal {
+namespace bcm {
+
+// PacketRxRing is a fixed set of preallocated receive buffers ("slots") used to
+// read packets from a packet socket without allocating memory per packet. Each
+// slot is made of a header buffer followed by a payload buffer, so that a
+// scatter read puts the KNET header and the packet data in separate buffers.
+// ReceiveBatch() fills up to all the slots with a single recvmmsg() call, while
+// Receive() reads exactly one packet into a given slot with recvmsg().
+//
+// The buffers are owned by the ring and are overwritten by the next receive
+// call, so callers must consume a slot (e.g. copy the payload out) before
+// receiving into it again. The class is not thread-safe; each RX thread is
+// expected to own its own ring.
+class PacketRxRing {
+ public:
+  // Creates a ring of num_slots slots, each with a header buffer of
+  // header_size bytes and a payload buffer of payload_size bytes. num_slots
+  // and payload_size must be positive. header_size can be zero.
+  PacketRxRing(int num_slots, size_t header_size, size_t payload_size);
+  ~PacketRxRing() {}
+
+  // Reads as many packets as are available on 'sock', up to NumSlots(), into
+  // slots 0, 1, ... using a single non-blocking recvmmsg() call. Returns the
+  // number of slots filled, or -1 with errno set on failure (EAGAIN if no
+  // packet was available).
+  int ReceiveBatch(int sock);
+
+  // Reads a single packet from 'sock' into the given slot using a
+  // non-blocking recvmsg() call. Returns the number of bytes received
+  // (header and payload), or -1 with errno set on failure.
+  ssize_t Receive(int sock, int slot);
+
+  // Accessors for the data received into a slot by the last receive call.
+  const char* Header(int slot) const {
+    return header_buffer_.get() + HeaderOffset(slot);
+  }
+  const char* Payload(int slot) const {
+    return payload_buffer_.get() + PayloadOffset(slot);
+  }
+  // Number of bytes received into the slot, including the header.
+  size_t ReceivedBytes(int slot) const { return msgs_[slot].msg_len; }
+  // Returns true if the packet did not fit in the slot and was truncated.
+  bool Truncated(int slot) const {
+    return msgs_[slot].msg_hdr.msg_flags & MSG_TRUNC;
+  }
+  // Link-layer source address of the packet (interface index, packet type).
+  const struct sockaddr_ll& Source(int slot) const { return addrs_[slot]; }
+
+  int NumSlots() const { return msgs_.size(); }
+  size_t HeaderSize() const { return header_size_; }
+  size_t PayloadSize() const { return payload_size_; }
+
+  // PacketRxRing is neither copyable nor movable, since the message headers
+  // point to the buffers of the instance.
+  PacketRxRing(const PacketRxRing&) = delete;
+  PacketRxRing& operator=(const PacketRxRing&) = delete;
+
+ private:
+  static constexpr int kIovPerSlot = 2;
+
+  size_t HeaderOffset(int slot) const { return slot * header_size_; }
+  size_t PayloadOffset(int slot) const { return slot * payload_size_; }
+
+  // Resets the per-packet output fields of a slot before receiving into it.
+  void ResetSlot(int slot);
+
+  const size_t header_size_;
+  const size_t payload_size_;
+  // Contiguous storage for the header and payload buffers of all the slots.
+  std::unique_ptr<char[]> header_buffer_;
+  std::unique_ptr<char[]> payload_buffer_;
+  // Per-slot scatter/gather list, source address and message header. Built
+  // once in the constructor and reused by every receive call.
+  std::vector<struct iovec> iovs_;
+  std::vector<struct sockaddr_ll> addrs_;
+  std::vector<struct mmsghdr> msgs_;
+};
+
+}  // namespace bcm
+}  // namespace hal
+}  // namespace stratum
+
+#endif  // STRATUM_HAL_LIB_BCM_PACKET_RX_RING_H_
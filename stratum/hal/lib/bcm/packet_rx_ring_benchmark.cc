@@ -0,0 +1,227 @@
+// Copyright 2018-present Open Networking Foundation
+// SPDX-License-Identifier: Apache-2.0
+
+// Benchmarks the receive rate of a packet socket bound to one end of a veth
+// pair, while a thread floods small frames into the other end. It compares
+// the three ways the KNET RX threads have read packets:
+//  - one recvmsg() per packet into freshly allocated and cleared buffers,
+//  - one recvmsg() per packet into the preallocated slots of a PacketRxRing,
+//  - one recvmmsg() per batch of packets into a PacketRxRing.
+// The "pps" counter reports the packets received per second. The veth pair
+// is created on start up, which needs CAP_NET_ADMIN; the benchmarks are
+// skipped if it cannot be created.
+
+#include <arpa/inet.h>
+#include <linux/if_ether.h>
+#include <net/if.h>
+#include <netpacket/packet.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>  // NOLINT
+
+#include "absl/strings/str_cat.h"
+#include "benchmark/benchmark.h"
+#include "stratum/glue/integral_types.h"
+#include "stratum/glue/logging.h"
+#include "stratum/hal/lib/bcm/packet_rx_ring.h"
+
+namespace stratum {
+namespace hal {
+namespace bcm {
+namespace {
+
+constexpr char kRxIntf[] = "stratum-rx0";
+constexpr char kTxIntf[] = "stratum-tx0";
+constexpr size_t kFrameSize = 64;
+constexpr size_t kMaxRxBufferSize = 32768;
+constexpr int kPollTimeoutMs = 100;
+
+// Owns the veth pair and the sockets on both of its ends. While a benchmark
+// runs, a sender thread writes frames into the TX end as fast as it can.
+class VethPair {
+ public:
+  VethPair() : rx_sock_(-1), tx_sock_(-1), efd_(-1), stop_(false) {}
+  ~VethPair() {
+    StopSender();
+    if (efd_ >= 0) close(efd_);
+    if (rx_sock_ >= 0) close(rx_sock_);
+    if (tx_sock_ >= 0) close(tx_sock_);
+    Ip(absl::StrCat("link del ", kRxIntf));
+  }
+
+  // Creates the veth pair and opens the sockets. Returns false on failure.
+  bool Setup() {
+    Ip(absl::StrCat("link del ", kRxIntf));  // leftover from a crashed run
+    if (!Ip(absl::StrCat("link add ", kRxIntf, " type veth peer name ",
+                         kTxIntf)) ||
+        !Ip(absl::StrCat("link set ", kRxIntf, " up")) ||
+        !Ip(absl::StrCat("link set ", kTxIntf, " up"))) {
+      return false;
+    }
+    rx_sock_ = OpenPacketSocket(kRxIntf);
+    tx_sock_ = OpenPacketSocket(kTxIntf);
+    if (rx_sock_ < 0 || tx_sock_ < 0) return false;
+    efd_ = epoll_create1(0);
+    struct epoll_event event = {};
+    event.events = EPOLLIN;
+    return efd_ >= 0 && epoll_ctl(efd_, EPOLL_CTL_ADD, rx_sock_, &event) == 0;
+  }
+
+  void StartSender() {
+    stop_ = false;
+    sender_ = std::thread([this]() {
+      char frame[kFrameSize];
+      memset(frame, 0xff, ETH_ALEN);  // broadcast
+      memset(frame + ETH_ALEN, 0x02, ETH_ALEN);
+      frame[ETH_ALEN * 2] = 0x88;  // local experimental ethertype
+      frame[ETH_ALEN * 2 + 1] = 0xb5;
+      while (!stop_.load(std::memory_order_relaxed)) {
+        send(tx_sock_, frame, sizeof(frame), 0);
+      }
+    });
+  }
+
+  void StopSender() {
+    stop_ = true;
+    if (sender_.joinable()) sender_.join();
+  }
+
+  // Blocks until the RX socket has data, like the KNET RX threads do.
+  bool WaitForData() {
+    struct epoll_event pevents[1];
+    return epoll_wait(efd_, pevents, 1, kPollTimeoutMs) > 0;
+  }
+
+  int rx_sock() const { return rx_sock_; }
+
+ private:
+  // Runs an "ip" command quietly. Returns true on success.
+  static bool Ip(const std::string& args) {
+    return system(absl::StrCat("ip ", args, " 2>/dev/null").c_str()) == 0;
+  }
+
+  static int OpenPacketSocket(const char* intf) {
+    int sock = socket(AF_PACKET, SOCK_RAW, htons(ETH_P_ALL));
+    if (sock < 0) return -1;
+    struct sockaddr_ll sa = {};
+    sa.sll_family = AF_PACKET;
+    sa.sll_protocol = htons(ETH_P_ALL);
+    sa.sll_ifindex = if_nametoindex(intf);
+    if (sa.sll_ifindex == 0 ||
+        bind(sock, reinterpret_cast<struct sockaddr*>(&sa), sizeof(sa)) != 0) {
+      close(sock);
+      return -1;
+    }
+    return sock;
+  }
+
+  int rx_sock_;
+  int tx_sock_;
+  int efd_;
+  std::atomic<bool> stop_;
+  std::thread sender_;
+};
+
+// Returns the veth pair shared by all the benchmarks, or nullptr if it could
+// not be set up. The pair is deleted when the binary exits.
+VethPair* GetVethPair() {
+  static VethPair veth;
+  static const bool ok = [&]() {
+    if (veth.Setup()) return true;
+    LOG(ERROR) << "Failed to set up veth pair " << kRxIntf << "/" << kTxIntf
+               << ". Are we running with CAP_NET_ADMIN?";
+    return false;
+  }();
+  return ok ? &veth : nullptr;
+}
+
+void ReportRate(benchmark::State& state, int64 num_packets) {
+  state.counters["pps"] =
+      benchmark::Counter(num_packets, benchmark::Counter::kIsRate);
+}
+
+// What the RX threads used to do: allocate, clear and read one packet at a
+// time.
+void BM_RecvmsgWithAllocation(benchmark::State& state) {
+  VethPair* veth = GetVethPair();
+  if (veth == nullptr) {
+    state.SkipWithError("veth pair not available");
+    return;
+  }
+  const int batch_size = state.range(0);
+  int64 num_packets = 0;
+  veth->StartSender();
+  for (auto _ : state) {
+    if (!veth->WaitForData()) continue;
+    for (int i = 0; i < batch_size; ++i) {
+      std::unique_ptr<char[]> buffer(new char[kMaxRxBufferSize]);
+      memset(buffer.get(), 0, kMaxRxBufferSize);
+      struct iovec iov = {buffer.get(), kMaxRxBufferSize};
+      struct sockaddr_ll sa;
+      memset(&sa, 0, sizeof(sa));
+      struct msghdr msg;
+      memset(&msg, 0, sizeof(msg));
+      msg.msg_iov = &iov;
+      msg.msg_iovlen = 1;
+      msg.msg_name = &sa;
+      msg.msg_namelen = sizeof(sa);
+      if (recvmsg(veth->rx_sock(), &msg, MSG_DONTWAIT) <= 0) break;
+      num_packets++;
+    }
+  }
+  veth->StopSender();
+  ReportRate(state, num_packets);
+}
+BENCHMARK(BM_RecvmsgWithAllocation)->Arg(8)->Arg(64)->UseRealTime();
+
+void BM_RingRecvmsg(benchmark::State& state) {
+  VethPair* veth = GetVethPair();
+  if (veth == nullptr) {
+    state.SkipWithError("veth pair not available");
+    return;
+  }
+  PacketRxRing ring(state.range(0), 0, kMaxRxBufferSize);
+  int64 num_packets = 0;
+  veth->StartSender();
+  for (auto _ : state) {
+    if (!veth->WaitForData()) continue;
+    for (int i = 0; i < ring.NumSlots(); ++i) {
+      if (ring.Receive(veth->rx_sock(), i) <= 0) break;
+      num_packets++;
+    }
+  }
+  veth->StopSender();
+  ReportRate(state, num_packets);
+}
+BENCHMARK(BM_RingRecvmsg)->Arg(8)->Arg(64)->UseRealTime();
+
+void BM_RingRecvmmsg(benchmark::State& state) {
+  VethPair* veth = GetVethPair();
+  if (veth == nullptr) {
+    state.SkipWithError("veth pair not available");
+    return;
+  }
+  PacketRxRing ring(state.range(0), 0, kMaxRxBufferSize);
+  int64 num_packets = 0;
+  veth->StartSender();
+  for (auto _ : state) {
+    if (!veth->WaitForData()) continue;
+    int res = ring.ReceiveBatch(veth->rx_sock());
+    if (res > 0) num_packets += res;
+  }
+  veth->StopSender();
+  ReportRate(state, num_packets);
+}
+BENCHMARK(BM_RingRecvmmsg)->Arg(8)->Arg(64)->UseRealTime();
+
+}  // namespace
+}  // namespace bcm
+}  // namespace hal
+}  // namespace stratum
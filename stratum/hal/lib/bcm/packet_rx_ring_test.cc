@@ -0,0 +1,123 @@
+// Copyright 2018-present Open Networking Foundation
+// SPDX-License-Identifier: Apache-2.0
+
+
+#include "stratum/hal/lib/bcm/packet_rx_ring.h"
+
+#include <errno.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <string>
+
+#include "gtest/gtest.h"
+
+namespace stratum {
+namespace hal {
+namespace bcm {
+
+// The tests use a pair of connected datagram sockets, which preserve message
+// boundaries like the KNET packet sockets do.
+class PacketRxRingTest : public ::testing::Test {
+ protected:
+  static constexpr size_t kHeaderSize = 4;
+  static constexpr size_t kPayloadSize = 16;
+
+  void SetUp() override {
+    ASSERT_EQ(0, socketpair(AF_UNIX, SOCK_DGRAM, 0, fds_));
+  }
+
+  void TearDown() override {
+    close(fds_[0]);
+    close(fds_[1]);
+  }
+
+  void Send(const std::string& data) {
+    ASSERT_EQ(static_cast<ssize_t>(data.size()),
+              send(fds_[1], data.data(), data.size(), 0));
+  }
+
+  int fds_[2];
+};
+
+constexpr size_t PacketRxRingTest::kHeaderSize;
+constexpr size_t PacketRxRingTest::kPayloadSize;
+
+TEST_F(PacketRxRingTest, ReceiveBatchSplitsHeaderAndPayload) {
+  PacketRxRing ring(4, kHeaderSize, kPayloadSize);
+  EXPECT_EQ(4, ring.NumSlots());
+  Send("HDR1payload-1");
+  Send("HDR2payload-22");
+  Send("HDR3payload-333");
+
+  ASSERT_EQ(3, ring.ReceiveBatch(fds_[0]));
+  for (int i = 0; i < 3; ++i) {
+    SCOPED_TRACE(i);
+    EXPECT_EQ("HDR" + std::to_string(i + 1),
+              std::string(ring.Header(i), kHeaderSize));
+    const std::string expected_payload =
+        "payload-" + std::string(i + 1, '1' + i);
+    EXPECT_EQ(kHeaderSize + expected_payload.size(), ring.ReceivedBytes(i));
+    EXPECT_EQ(expected_payload,
+              std::string(ring.Payload(i), ring.ReceivedBytes(i) - kHeaderSize));
+    EXPECT_FALSE(ring.Truncated(i));
+  }
+}
+
+TEST_F(PacketRxRingTest, ReceiveBatchReadsAtMostNumSlots) {
+  PacketRxRing ring(2, kHeaderSize, kPayloadSize);
+  for (int i = 0; i < 3; ++i) Send("HDR" + std::to_string(i) + "data");
+
+  EXPECT_EQ(2, ring.ReceiveBatch(fds_[0]));
+  EXPECT_EQ("HDR1", std::string(ring.Header(1), kHeaderSize));
+  ASSERT_EQ(1, ring.ReceiveBatch(fds_[0]));
+  EXPECT_EQ("HDR2", std::string(ring.Header(0), kHeaderSize));
+}
+
+TEST_F(PacketRxRingTest, ReceiveBatchFailsWithEagainWhenEmpty) {
+  PacketRxRing ring(2, kHeaderSize, kPayloadSize);
+  EXPECT_EQ(-1, ring.ReceiveBatch(fds_[0]));
+  EXPECT_EQ(EAGAIN, errno);
+  EXPECT_EQ(-1, ring.Receive(fds_[0], 0));
+  EXPECT_EQ(EAGAIN, errno);
+}
+
+TEST_F(PacketRxRingTest, ReceiveIntoSlot) {
+  PacketRxRing ring(2, kHeaderSize, kPayloadSize);
+  Send("HDR0first");
+  Send("HDR1second");
+
+  EXPECT_EQ(9, ring.Receive(fds_[0], 1));
+  EXPECT_EQ(10, ring.Receive(fds_[0], 0));
+  EXPECT_EQ(9U, ring.ReceivedBytes(1));
+  EXPECT_EQ("first", std::string(ring.Payload(1), 5));
+  EXPECT_EQ(10U, ring.ReceivedBytes(0));
+  EXPECT_EQ("second", std::string(ring.Payload(0), 6));
+}
+
+TEST_F(PacketRxRingTest, TruncatedPacket) {
+  PacketRxRing ring(1, kHeaderSize, kPayloadSize);
+  Send("HDR0" + std::string(kPayloadSize + 1, 'x'));
+  Send("HDR1ok");
+
+  ASSERT_EQ(1, ring.ReceiveBatch(fds_[0]));
+  EXPECT_TRUE(ring.Truncated(0));
+  EXPECT_EQ(kHeaderSize + kPayloadSize, ring.ReceivedBytes(0));
+  // The flags of a slot are reset for the next packet.
+  ASSERT_EQ(1, ring.ReceiveBatch(fds_[0]));
+  EXPECT_FALSE(ring.Truncated(0));
+  EXPECT_EQ("ok", std::string(ring.Payload(0), 2));
+}
+
+TEST_F(PacketRxRingTest, NoHeader) {
+  PacketRxRing ring(1, 0, kPayloadSize);
+  Send("payload");
+
+  ASSERT_EQ(1, ring.ReceiveBatch(fds_[0]));
+  EXPECT_EQ(7U, ring.ReceivedBytes(0));
+  EXPECT_EQ("payload", std::string(ring.Payload(0), 7));
+}
+
+}  // namespace bcm
+}  // namespace hal
+}  // namespace stratum
@@ -1465,6 +1465,47 @@ BcmSdkWrapper::~BcmSdkWrapper() { ShutdownAllUnits().IgnoreError(); }
   return ::util::OkStatus();
 }
 
+::util::Status BcmSdkWrapper::GetAllPortCounters(
+    int unit, std::map<int, PortCounters>* counters) {
+  CHECK_RETURN_IF_FALSE(counters);
+  counters->clear();
+  // The SDK has no stat call spanning several ports: read all the counters of
+  // each port with one call, instead of one call per counter.
+  bcm_stat_val_t stats[] = {
+      snmpIfInOctets,         snmpIfInUcastPkts,      snmpIfInMulticastPkts,
+      snmpIfInBroadcastPkts,  snmpIfInDiscards,       snmpIfInErrors,
+      snmpIfInUnknownProtos,  snmpIfOutOctets,        snmpIfOutUcastPkts,
+      snmpIfOutMulticastPkts, snmpIfOutBroadcastPkts, snmpIfOutDiscards,
+      snmpIfOutErrors,
+  };
+  constexpr int kNumStats = sizeof(stats) / sizeof(stats[0]);
+  uint64 vals[kNumStats];
+  bcm_port_config_t port_cfg;
+  RETURN_IF_BCM_ERROR(bcm_port_config_get(unit, &port_cfg));
+  int port;
+  BCM_PBMP_ITER(port_cfg.port, port) {
+    RETURN_IF_BCM_ERROR(bcm_stat_multi_get(unit, port, kNumStats, stats, vals))
+        << "Failed to read the counters of port " << port << " on unit "
+        << unit << ".";
+    PortCounters* pc = &(*counters)[port];
+    pc->set_in_octets(vals[0]);
+    pc->set_in_unicast_pkts(vals[1]);
+    pc->set_in_multicast_pkts(vals[2]);
+    pc->set_in_broadcast_pkts(vals[3]);
+    pc->set_in_discards(vals[4]);
+    pc->set_in_errors(vals[5]);
+    pc->set_in_unknown_protos(vals[6]);
+    pc->set_out_octets(vals[7]);
+    pc->set_out_unicast_pkts(vals[8]);
+    pc->set_out_multicast_pkts(vals[9]);
+    pc->set_out_broadcast_pkts(vals[10]);
+    pc->set_out_discards(vals[11]);
+    pc->set_out_errors(vals[12]);
+  }
+
+  return ::util::OkStatus();
+}
+
 ::util::Status BcmSdkWrapper::StartDiagShellServer() {
   if (bcm_diag_shell_ == nullptr) return ::util::OkStatus();  // sim mode
 
@@ -1936,6 +1977,37 @@ void PopulateL3HostAction(int class_id, int egress_intf_id,
   return ::util::OkStatus();
 }
 
+::util::Status BcmSdkWrapper::AddL3Routes(
+    int unit, const std::vector<L3Route>& routes,
+    std::vector<::util::Status>* results) {
+  CHECK_RETURN_IF_FALSE(results != nullptr);
+  // This SDK has no bulk L3 APIs, so the routes are added one at a time.
+  results->clear();
+  results->reserve(routes.size());
+  for (const auto& route : routes) {
+    if (route.is_host) {
+      results->push_back(route.is_ipv6
+                             ? AddL3HostIpv6(unit, route.vrf,
+                                             route.subnet_ipv6, route.class_id,
+                                             route.egress_intf_id)
+                             : AddL3HostIpv4(unit, route.vrf,
+                                             route.subnet_ipv4, route.class_id,
+                                             route.egress_intf_id));
+    } else {
+      results->push_back(
+          route.is_ipv6
+              ? AddL3RouteIpv6(unit, route.vrf, route.subnet_ipv6,
+                               route.mask_ipv6, route.class_id,
+                               route.egress_intf_id, route.is_intf_multipath)
+              : AddL3RouteIpv4(unit, route.vrf, route.subnet_ipv4,
+                               route.mask_ipv4, route.class_id,
+                               route.egress_intf_id, route.is_intf_multipath));
+    }
+  }
+
+  return ::util::OkStatus();
+}
+
 ::util::Status BcmSdkWrapper::ModifyL3RouteIpv4(int unit, int vrf,
                                                 uint32 subnet, uint32 mask,
                                                 int class_id,
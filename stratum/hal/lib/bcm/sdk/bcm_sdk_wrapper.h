@@ -17,6 +17,7 @@
 #include <pthread.h>
 
 #include <functional>
+#include <map>
 #include <memory>
 #include <set>
 #include <string>
@@ -135,6 +136,8 @@ class BcmSdkWrapper : public BcmSdkInterface {
   ::util::Status GetPortOptions(int unit, int port,
                                 BcmPortOptions* options) override;
   ::util::Status GetPortCounters(int unit, int port, PortCounters* pc) override;
+  ::util::Status GetAllPortCounters(
+      int unit, std::map<int, PortCounters>* counters) override;
   ::util::Status StartDiagShellServer() override;
   ::util::Status StartLinkscan(int unit) override;
   ::util::Status StopLinkscan(int unit) override;
@@ -187,6 +190,8 @@ class BcmSdkWrapper : public BcmSdkInterface {
                                int egress_intf_id) override;
   ::util::Status AddL3HostIpv6(int unit, int vrf, const std::string& ipv6,
                                int class_id, int egress_intf_id) override;
+  ::util::Status AddL3Routes(int unit, const std::vector<L3Route>& routes,
+                             std::vector<::util::Status>* results) override;
   ::util::Status ModifyL3RouteIpv4(int unit, int vrf, uint32 subnet,
                                    uint32 mask, int class_id,
                                    int egress_intf_id,
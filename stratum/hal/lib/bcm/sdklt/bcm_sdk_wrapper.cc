@@ -1980,6 +1980,79 @@ BcmSdkWrapper::~BcmSdkWrapper() { ShutdownAllUnits().IgnoreError(); }
   return ::util::OkStatus();
 }
 
+::util::Status BcmSdkWrapper::GetAllPortCounters(
+    int unit, std::map<int, PortCounters>* counters) {
+  // Check if unit is valid
+  RETURN_IF_BCM_ERROR(CheckIfUnitExists(unit));
+  CHECK_RETURN_IF_FALSE(counters != nullptr);
+  counters->clear();
+
+  // One traversal of each counter table instead of one lookup per port.
+  uint64 port;
+  uint64 value;
+  int rv;
+  bcmlt_entry_info_t entry_info;
+  // Read good counters
+  bcmlt_entry_handle_t entry_hdl;
+  RETURN_IF_BCM_ERROR(bcmlt_entry_allocate(unit, CTR_MACs, &entry_hdl));
+  auto cl1 = gtl::MakeCleanup([entry_hdl]() { bcmlt_entry_free(entry_hdl); });
+  while ((rv = bcmlt_entry_commit(entry_hdl, BCMLT_OPCODE_TRAVERSE,
+                                  BCMLT_PRIORITY_NORMAL)) == SHR_E_NONE) {
+    if (bcmlt_entry_info_get(entry_hdl, &entry_info) != SHR_E_NONE ||
+        entry_info.status != SHR_E_NONE) {
+      break;
+    }
+    RETURN_IF_BCM_ERROR(bcmlt_entry_field_get(entry_hdl, PORT_IDs, &port));
+    PortCounters* pc = &(*counters)[static_cast<int>(port)];
+    RETURN_IF_BCM_ERROR(bcmlt_entry_field_get(entry_hdl, RX_BYTESs, &value));
+    pc->set_in_octets(value);
+    RETURN_IF_BCM_ERROR(bcmlt_entry_field_get(entry_hdl, RX_UC_PKTs, &value));
+    pc->set_in_unicast_pkts(value);
+    RETURN_IF_BCM_ERROR(bcmlt_entry_field_get(entry_hdl, RX_BC_PKTs, &value));
+    pc->set_in_broadcast_pkts(value);
+    RETURN_IF_BCM_ERROR(bcmlt_entry_field_get(entry_hdl, RX_MC_PKTs, &value));
+    pc->set_in_multicast_pkts(value);
+    RETURN_IF_BCM_ERROR(bcmlt_entry_field_get(entry_hdl, TX_BYTESs, &value));
+    pc->set_out_octets(value);
+    RETURN_IF_BCM_ERROR(bcmlt_entry_field_get(entry_hdl, TX_UC_PKTs, &value));
+    pc->set_out_unicast_pkts(value);
+    RETURN_IF_BCM_ERROR(bcmlt_entry_field_get(entry_hdl, TX_BC_PKTs, &value));
+    pc->set_out_broadcast_pkts(value);
+    RETURN_IF_BCM_ERROR(bcmlt_entry_field_get(entry_hdl, TX_MC_PKTs, &value));
+    pc->set_out_multicast_pkts(value);
+  }
+  // The traversal ends with SHR_E_NOT_FOUND past the last entry.
+  if (rv != SHR_E_NOT_FOUND) {
+    RETURN_IF_BCM_ERROR(rv) << "Failed to traverse the counters of unit "
+                            << unit << ".";
+  }
+
+  // Read error counters
+  RETURN_IF_BCM_ERROR(bcmlt_entry_allocate(unit, CTR_MAC_ERRs, &entry_hdl));
+  auto cl2 = gtl::MakeCleanup([entry_hdl]() { bcmlt_entry_free(entry_hdl); });
+  while ((rv = bcmlt_entry_commit(entry_hdl, BCMLT_OPCODE_TRAVERSE,
+                                  BCMLT_PRIORITY_NORMAL)) == SHR_E_NONE) {
+    if (bcmlt_entry_info_get(entry_hdl, &entry_info) != SHR_E_NONE ||
+        entry_info.status != SHR_E_NONE) {
+      break;
+    }
+    RETURN_IF_BCM_ERROR(bcmlt_entry_field_get(entry_hdl, PORT_IDs, &port));
+    auto* pc = gtl::FindOrNull(*counters, static_cast<int>(port));
+    if (pc == nullptr) continue;
+    RETURN_IF_BCM_ERROR(
+        bcmlt_entry_field_get(entry_hdl, RX_FCS_ERR_PKTs, &value));
+    pc->set_in_fcs_errors(value);
+    RETURN_IF_BCM_ERROR(bcmlt_entry_field_get(entry_hdl, TX_ERR_PKTs, &value));
+    pc->set_out_errors(value);
+  }
+  if (rv != SHR_E_NOT_FOUND) {
+    RETURN_IF_BCM_ERROR(rv) << "Failed to traverse the counters of unit "
+                            << unit << ".";
+  }
+
+  return ::util::OkStatus();
+}
+
 ::util::Status BcmSdkWrapper::InitCLI() {
   // Initialize system log output
   RETURN_IF_BCM_ERROR(bcma_bslmgmt_init());
@@ -3377,6 +3450,248 @@ BcmSdkWrapper::GetPortLinkscanMode(int unit, int port) {
   return ::util::OkStatus();
 }
 
+namespace {
+
+// Value ranges of the fields of an L3 route or host table, read once per
+// AddL3Routes() batch rather than once per route.
+struct L3TableLimits {
+  uint64_t vrf_min, vrf_max;
+  uint64_t class_id_min, class_id_max;
+  uint64_t nhop_id_min, nhop_id_max;
+};
+
+::util::Status GetL3TableLimits(int unit, const char* table,
+                                L3TableLimits* limits) {
+  RETURN_IF_BCM_ERROR(GetFieldMinMaxValue(unit, table, VRF_IDs,
+                                          &limits->vrf_min, &limits->vrf_max));
+  RETURN_IF_BCM_ERROR(GetFieldMinMaxValue(unit, table, CLASS_IDs,
+                                          &limits->class_id_min,
+                                          &limits->class_id_max));
+  RETURN_IF_BCM_ERROR(GetFieldMinMaxValue(unit, table, NHOP_IDs,
+                                          &limits->nhop_id_min,
+                                          &limits->nhop_id_max));
+  return ::util::OkStatus();
+}
+
+// Validates the given route and allocates a bcmlt entry for inserting it into
+// the given L3 route or host table. Performs the same checks as
+// AddL3RouteIpv4/Ipv6() and AddL3HostIpv4/Ipv6(). On success, the caller owns
+// the entry.
+::util::Status CreateL3RouteEntry(int unit, const char* table,
+                                  const L3TableLimits& limits,
+                                  const std::map<int, bool>& l3_egress_intf,
+                                  const BcmSdkInterface::L3Route& route,
+                                  bcmlt_entry_handle_t* entry_hdl) {
+  CHECK_RETURN_IF_FALSE(route.egress_intf_id > 0);
+  if (route.vrf > static_cast<int>(limits.vrf_max) ||
+      route.vrf < static_cast<int>(limits.vrf_min)) {
+    return MAKE_ERROR(ERR_INVALID_PARAM)
+           << "Invalid vrf (" << route.vrf << "), valid vrf range is "
+           << static_cast<int>(limits.vrf_min) << " - "
+           << static_cast<int>(limits.vrf_max) << ".";
+  }
+  if (route.class_id > 0 &&
+      (route.class_id > static_cast<int>(limits.class_id_max) ||
+       route.class_id < static_cast<int>(limits.class_id_min))) {
+    return MAKE_ERROR(ERR_INVALID_PARAM)
+           << "Invalid class_id (" << route.class_id
+           << "), valid class_id range is "
+           << static_cast<int>(limits.class_id_min) << " - "
+           << static_cast<int>(limits.class_id_max) << ".";
+  }
+  if (route.is_host) {
+    // Host routes only point to non-multipath egress intfs.
+    if (route.egress_intf_id > static_cast<int>(limits.nhop_id_max) ||
+        route.egress_intf_id < static_cast<int>(limits.nhop_id_min)) {
+      return MAKE_ERROR(ERR_INVALID_PARAM)
+             << "Invalid egress interface (" << route.egress_intf_id
+             << "), valid next hop id range is "
+             << static_cast<int>(limits.nhop_id_min) << " - "
+             << static_cast<int>(limits.nhop_id_max) << ".";
+    }
+  } else {
+    auto it = l3_egress_intf.find(route.egress_intf_id);
+    if (it == l3_egress_intf.end()) {
+      return MAKE_ERROR(ERR_INVALID_PARAM)
+             << "Invalid L3 Egress interface " << route.egress_intf_id << ".";
+    }
+    if (!it->second) {
+      return MAKE_ERROR(ERR_INVALID_PARAM)
+             << "L3 Egress interface " << route.egress_intf_id
+             << " is not created.";
+    }
+  }
+  if (route.is_ipv6) {
+    CHECK_RETURN_IF_FALSE(route.subnet_ipv6.size() == 16);
+    CHECK_RETURN_IF_FALSE(route.is_host || route.mask_ipv6.size() == 16);
+  }
+
+  RETURN_IF_BCM_ERROR(bcmlt_entry_allocate(unit, table, entry_hdl));
+  auto cleanup = gtl::MakeCleanup([entry_hdl]() {
+    bcmlt_entry_free(*entry_hdl);
+  });
+  RETURN_IF_BCM_ERROR(bcmlt_entry_field_add(*entry_hdl, VRF_IDs, route.vrf));
+  if (route.is_ipv6) {
+    RETURN_IF_BCM_ERROR(bcmlt_entry_field_add(
+        *entry_hdl, IPV6_UPPERs,
+        ByteStreamToUint<uint64>(route.subnet_ipv6.substr(0, 8))));
+    RETURN_IF_BCM_ERROR(bcmlt_entry_field_add(
+        *entry_hdl, IPV6_LOWERs,
+        ByteStreamToUint<uint64>(route.subnet_ipv6.substr(8, 16))));
+    if (!route.is_host) {
+      RETURN_IF_BCM_ERROR(bcmlt_entry_field_add(
+          *entry_hdl, IPV6_UPPER_MASKs,
+          ByteStreamToUint<uint64>(route.mask_ipv6.substr(0, 8))));
+      RETURN_IF_BCM_ERROR(bcmlt_entry_field_add(
+          *entry_hdl, IPV6_LOWER_MASKs,
+          ByteStreamToUint<uint64>(route.mask_ipv6.substr(8, 16))));
+    }
+  } else {
+    if (!route.is_host) {
+      RETURN_IF_BCM_ERROR(bcmlt_entry_field_add(
+          *entry_hdl, IPV4_MASKs,
+          (!route.subnet_ipv4 ? 0
+                              : (route.mask_ipv4 ? route.mask_ipv4
+                                                 : 0xffffffff))));
+    }
+    RETURN_IF_BCM_ERROR(
+        bcmlt_entry_field_add(*entry_hdl, IPV4s, route.subnet_ipv4));
+  }
+  if (route.class_id > 0) {
+    RETURN_IF_BCM_ERROR(
+        bcmlt_entry_field_add(*entry_hdl, CLASS_IDs, route.class_id));
+  }
+  const bool is_intf_multipath = !route.is_host && route.is_intf_multipath;
+  RETURN_IF_BCM_ERROR(
+      bcmlt_entry_field_add(*entry_hdl, ECMP_NHOPs, is_intf_multipath));
+  RETURN_IF_BCM_ERROR(bcmlt_entry_field_add(
+      *entry_hdl, is_intf_multipath ? ECMP_IDs : NHOP_IDs,
+      route.egress_intf_id));
+  cleanup.release();
+
+  return ::util::OkStatus();
+}
+
+// Pretty prints a route given to AddL3Routes().
+std::string PrintL3Route(const BcmSdkInterface::L3Route& route) {
+  if (route.is_host) {
+    l3_host_t host = {route.is_ipv6,     route.vrf,
+                      route.class_id,    route.egress_intf_id,
+                      route.subnet_ipv4, route.subnet_ipv6};
+    return PrintL3Host(host);
+  }
+  l3_route_t l3_route = {route.is_ipv6,         route.vrf,
+                         route.class_id,        route.egress_intf_id,
+                         route.subnet_ipv4,     route.mask_ipv4,
+                         route.subnet_ipv6,     route.mask_ipv6};
+  return PrintL3Route(l3_route);
+}
+
+}  // namespace
+
+::util::Status BcmSdkWrapper::AddL3Routes(
+    int unit, const std::vector<L3Route>& routes,
+    std::vector<::util::Status>* results) {
+  CHECK_RETURN_IF_FALSE(results != nullptr);
+  results->assign(routes.size(), ::util::OkStatus());
+  if (routes.empty()) return ::util::OkStatus();
+
+  // Check if the unit is valid
+  RETURN_IF_BCM_ERROR(CheckIfUnitExists(unit));
+  InUseMap* l3_egress_intf = gtl::FindOrNull(l3_egress_interface_ids_, unit);
+  CHECK_RETURN_IF_FALSE(l3_egress_intf != nullptr)
+      << "Unit " << unit
+      << " not initialized yet. Call InitializeUnit first.";
+
+  // All the routes go into a single batch transaction. Unlike an atomic
+  // transaction, a batch commits every entry on its own, so that a failing
+  // route does not prevent the others from being added. The entries added to
+  // the transaction are freed together with it.
+  bcmlt_transaction_hdl_t trans_hdl;
+  RETURN_IF_BCM_ERROR(
+      bcmlt_transaction_allocate(BCMLT_TRANS_TYPE_BATCH, &trans_hdl));
+  auto _ = gtl::MakeCleanup(
+      [trans_hdl]() { bcmlt_transaction_free(trans_hdl); });
+
+  // The four L3 tables, indexed by 2 * is_host + is_ipv6.
+  constexpr int kNumL3Tables = 4;
+  const char* tables[kNumL3Tables] = {L3_IPV4_UC_ROUTE_VRFs,
+                                      L3_IPV6_UC_ROUTE_VRFs, L3_IPV4_UC_HOSTs,
+                                      L3_IPV6_UC_HOSTs};
+  L3TableLimits limits[kNumL3Tables];
+  ::util::Status limits_status[kNumL3Tables];
+  bool limits_read[kNumL3Tables] = {false, false, false, false};
+  // The index in routes of every entry added to the transaction, in order.
+  std::vector<size_t> trans_indices;
+  trans_indices.reserve(routes.size());
+  for (size_t i = 0; i < routes.size(); ++i) {
+    const L3Route& route = routes[i];
+    const int t = 2 * route.is_host + route.is_ipv6;
+    if (!limits_read[t]) {
+      limits_status[t] = GetL3TableLimits(unit, tables[t], &limits[t]);
+      limits_read[t] = true;
+    }
+    if (!limits_status[t].ok()) {
+      (*results)[i] = limits_status[t];
+      continue;
+    }
+    bcmlt_entry_handle_t entry_hdl;
+    ::util::Status status = CreateL3RouteEntry(
+        unit, tables[t], limits[t], *l3_egress_intf, route, &entry_hdl);
+    if (!status.ok()) {
+      (*results)[i] = status;
+      continue;
+    }
+    int rv = bcmlt_transaction_entry_add(trans_hdl, BCMLT_OPCODE_INSERT,
+                                         entry_hdl);
+    if (BCM_FAILURE(rv)) {
+      bcmlt_entry_free(entry_hdl);
+      (*results)[i] = MAKE_ERROR(BooleanBcmStatus(rv).error_code())
+                      << "Failed to add " << PrintL3Route(route)
+                      << " to the transaction on unit " << unit << ": "
+                      << bcm_errmsg(rv);
+      continue;
+    }
+    trans_indices.push_back(i);
+  }
+  if (trans_indices.empty()) return ::util::OkStatus();
+
+  int rv = bcmlt_transaction_commit(trans_hdl, BCMLT_PRIORITY_NORMAL);
+  if (BCM_FAILURE(rv)) {
+    ::util::Status error = MAKE_ERROR(BooleanBcmStatus(rv).error_code())
+                           << "Failed to commit " << trans_indices.size()
+                           << " L3 routes on unit " << unit << ": "
+                           << bcm_errmsg(rv);
+    for (size_t i : trans_indices) (*results)[i] = error;
+    return error;
+  }
+  for (uint32 k = 0; k < trans_indices.size(); ++k) {
+    const size_t i = trans_indices[k];
+    bcmlt_entry_info_t entry_info;
+    rv = bcmlt_transaction_entry_num_get(trans_hdl, k, &entry_info);
+    if (BCM_FAILURE(rv)) {
+      (*results)[i] = MAKE_ERROR(BooleanBcmStatus(rv).error_code())
+                      << "Failed to get the status of "
+                      << PrintL3Route(routes[i]) << " on unit " << unit
+                      << ": " << bcm_errmsg(rv);
+    } else if (entry_info.status == SHR_E_EXISTS) {
+      (*results)[i] = MAKE_ERROR(ERR_ENTRY_EXISTS)
+                      << PrintL3Route(routes[i]) << " already exists on unit "
+                      << unit << ".";
+    } else if (BCM_FAILURE(entry_info.status)) {
+      (*results)[i] =
+          MAKE_ERROR(BooleanBcmStatus(entry_info.status).error_code())
+          << "Failed to add " << PrintL3Route(routes[i]) << " on unit "
+          << unit << ": " << bcm_errmsg(entry_info.status);
+    } else {
+      VLOG(1) << "Added " << PrintL3Route(routes[i]) << " on unit " << unit
+              << ".";
+    }
+  }
+
+  return ::util::OkStatus();
+}
+
 ::util::Status BcmSdkWrapper::ModifyL3RouteIpv4(int unit, int vrf,
                                                 uint32 subnet, uint32 mask,
                                                 int class_id,
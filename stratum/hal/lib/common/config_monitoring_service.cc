@@ -6,6 +6,7 @@
 
 #include <string>
 #include <utility>
+#include <vector>
 
 #include "absl/container/flat_hash_set.h"
 #include "absl/memory/memory.h"
@@ -19,6 +20,7 @@
 #include "stratum/glue/logging.h"
 #include "stratum/glue/status/status_macros.h"
 #include "stratum/hal/lib/common/gnmi_publisher.h"
+#include "stratum/hal/lib/common/gnmi_subscriber_queue.h"
 #include "stratum/hal/lib/common/openconfig_converter.h"
 #include "stratum/lib/macros.h"
 #include "stratum/lib/utils.h"
@@ -310,6 +312,20 @@ bool ContainsUniqueNames(const T& values) {
                           "Get response can only be encoded as PROTO.");
   }
 
+  // An in-place stream that saves contents of the `update` field of the
+  // `msg` PROTOBUF to the response that will be sent to the controller.
+  InlineGnmiSubscribeStream stream(
+      [resp](const ::gnmi::SubscribeResponse& msg) -> bool {
+        // If msg has empty update, it might be a sync_response for
+        // GetRequest
+        if (!msg.has_update()) return msg.sync_response();
+        *resp->add_notification() = msg.update();
+        return true;
+      });
+  // The paths are polled together, so that the values they need are
+  // retrieved from the switch in as few calls as possible. The notifications
+  // are added to the response in the order of the paths.
+  std::vector<SubscriptionHandle> handles;
   for (const auto& path : req->path()) {
     VLOG(1) << "GET: " << path.ShortDebugString();
     if (path == GetPath()()) {
@@ -319,6 +335,12 @@ bool ContainsUniqueNames(const T& values) {
         return ::grpc::Status(::grpc::StatusCode::INVALID_ARGUMENT,
                               "Get '/' can be done for CONFIG elements only.");
       }
+      // Get the values of the paths that come before.
+      ::util::Status status = gnmi_publisher_.HandleBatchedPoll(handles);
+      if (!status.ok()) {
+        return ::grpc::Status(ToGrpcCode(status.CanonicalCode()),
+                              status.error_message());
+      }
       auto* notification = resp->add_notification();
       // TODO(unknown): Set correct timestamp.
       notification->set_timestamp(0ll);
@@ -338,32 +360,22 @@ bool ContainsUniqueNames(const T& values) {
                               out.status().error_message());
       }
     } else {
-      // Process the get request.
-      SubscriptionHandle h;
-      // An in-place stream that saves contents of the `update` field of the
-      // `msg` PROTOBUF to the response that will be sent to the controller.
-      InlineGnmiSubscribeStream stream(
-          [resp](const ::gnmi::SubscribeResponse& msg) -> bool {
-            // If msg has empty update, it might be a sync_response for
-            // GetRequest
-            if (!msg.has_update()) return msg.sync_response();
-            *resp->add_notification() = msg.update();
-            return true;
-          });
       // Check if the path is supported.
-      ::util::Status status;
-      if ((status = gnmi_publisher_.SubscribePoll(path, &stream, &h)).ok()) {
-        // Get the value(s) represented by the path.
-        if (!(status = gnmi_publisher_.HandlePoll(h)).ok()) {
-          return ::grpc::Status(ToGrpcCode(status.CanonicalCode()),
-                                status.error_message());
-        }
-      } else {
+      SubscriptionHandle h;
+      ::util::Status status = gnmi_publisher_.SubscribePoll(path, &stream, &h);
+      if (!status.ok()) {
         return ::grpc::Status(ToGrpcCode(status.CanonicalCode()),
                               status.error_message());
       }
+      handles.push_back(h);
     }
   }
+  // Get the value(s) represented by the paths.
+  ::util::Status status = gnmi_publisher_.HandleBatchedPoll(handles);
+  if (!status.ok()) {
+    return ::grpc::Status(ToGrpcCode(status.CanonicalCode()),
+                          status.error_message());
+  }
   return ::grpc::Status::OK;
 }
 
@@ -453,9 +465,8 @@ constexpr int kThousandMilliseconds = 1000 /* milliseconds */;
         uint64 sample_interval = subscription.sample_interval() == 0
                                      ? kThousandMilliseconds
                                      : subscription.sample_interval();
-        uint64 heartbeat_interval = subscription.heartbeat_interval() == 0
-                                        ? kThousandMilliseconds
-                                        : subscription.heartbeat_interval();
+        // Without heartbeat, only the changes are sent.
+        uint64 heartbeat_interval = subscription.heartbeat_interval();
         if (!subscription.suppress_redundant()) {
           status = publisher->SubscribePeriodic(
               Periodic(sample_interval), subscription.path(), stream, &h);
@@ -562,7 +573,12 @@ constexpr int kThousandMilliseconds = 1000 /* milliseconds */;
 
 ::grpc::Status ConfigMonitoringService::DoSubscribe(
     GnmiPublisher* publisher, ::grpc::ServerContext* context,
-    ServerSubscribeReaderWriterInterface* stream) {
+    ServerSubscribeReaderWriterInterface* grpc_stream) {
+  // All the responses go through a queue written to the gRPC stream by its own
+  // thread, so that a slow client does not hold up the event handlers and the
+  // timers serving the other subscribers.
+  QueuedGnmiSubscribeStream queued_stream(grpc_stream);
+  ServerSubscribeReaderWriterInterface* stream = &queued_stream;
   PathToHandleMap subscriptions;
   PathToHandleMap polls;
   ::util::Status status;
@@ -580,8 +596,8 @@ constexpr int kThousandMilliseconds = 1000 /* milliseconds */;
   while (true) {
     if (stream->Read(&req)) {
       // All good! The message has been received! Let's process it!
-      LOG(INFO) << "Subscribe request from " << uri << " over stream " << stream
-                << ".";
+      LOG(INFO) << "Subscribe request from " << uri << " over stream "
+                << grpc_stream << ".";
       VLOG(1) << "SubscribeRequest: " << req.ShortDebugString();
       if (req.has_subscribe()) {
         // Invalid type of request at this stage! Such message is valid only
@@ -610,7 +626,7 @@ constexpr int kThousandMilliseconds = 1000 /* milliseconds */;
       // The client called WritesDone() or the stream has been closed.
       // Now the infinite loop should be stopped - no more requests will be
       // received.
-      LOG(INFO) << "Subscribe stream " << stream << " from " << uri
+      LOG(INFO) << "Subscribe stream " << grpc_stream << " from " << uri
                 << " has been closed.";
       break;
     }
@@ -623,6 +639,12 @@ constexpr int kThousandMilliseconds = 1000 /* milliseconds */;
   }
   subscriptions.clear();
   polls.clear();
+  if (queued_stream.NumDropped() > 0 || queued_stream.NumCoalesced() > 0) {
+    LOG(WARNING) << "Subscribe stream " << grpc_stream << " from " << uri
+                 << " did not keep up: " << queued_stream.NumDropped()
+                 << " notifications dropped, " << queued_stream.NumCoalesced()
+                 << " coalesced.";
+  }
 
   return ::grpc::Status::OK;
 }
@@ -0,0 +1,238 @@
+// Copyright 2018-present Open Networking Foundation
+// SPDX-License-Identifier: Apache-2.0
+
+#include "stratum/hal/lib/common/forwarding_pipeline_config_store.h"
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "absl/strings/match.h"
+#include "absl/strings/numbers.h"
+#include "absl/strings/str_cat.h"
+#include "stratum/glue/gtl/cleanup.h"
+#include "stratum/glue/logging.h"
+#include "stratum/glue/status/status_macros.h"
+#include "stratum/lib/macros.h"
+#include "stratum/lib/utils.h"
+#include "stratum/public/lib/error.h"
+
+namespace stratum {
+namespace hal {
+
+namespace {
+
+constexpr char kNodeFilePrefix[] = "node_";
+constexpr char kNodeFileSuffix[] = ".pb.bin";
+constexpr char kTmpFileSuffix[] = ".tmp";
+
+// Writes all of 'buffer' to 'fd', retrying on short writes and EINTR.
+::util::Status WriteAll(int fd, const std::string& buffer,
+                        const std::string& path) {
+  size_t written = 0;
+  while (written < buffer.size()) {
+    ssize_t ret =
+        write(fd, buffer.data() + written, buffer.size() - written);
+    if (ret < 0) {
+      if (errno == EINTR) continue;
+      return MAKE_ERROR(ERR_INTERNAL)
+             << "Failed to write " << path << ": " << strerror(errno);
+    }
+    written += ret;
+  }
+
+  return ::util::OkStatus();
+}
+
+// Makes a rename in 'dir' durable by syncing the directory itself.
+::util::Status SyncDir(const std::string& dir) {
+  int fd = open(dir.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+  if (fd < 0) {
+    return MAKE_ERROR(ERR_INTERNAL)
+           << "Failed to open dir " << dir << ": " << strerror(errno);
+  }
+  auto fd_closer = gtl::MakeCleanup([fd]() { close(fd); });
+  if (fsync(fd) != 0) {
+    return MAKE_ERROR(ERR_INTERNAL)
+           << "Failed to sync dir " << dir << ": " << strerror(errno);
+  }
+
+  return ::util::OkStatus();
+}
+
+// Parses 'message' from the content of the file at 'path', which is mapped
+// in memory rather than read into a buffer.
+::util::Status ParseProtoFromMappedFile(const std::string& path,
+                                        ::google::protobuf::Message* message) {
+  int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    if (errno == ENOENT) {
+      return MAKE_ERROR(ERR_FILE_NOT_FOUND) << path << " not found.";
+    }
+    return MAKE_ERROR(ERR_INTERNAL)
+           << "Failed to open " << path << ": " << strerror(errno);
+  }
+  auto fd_closer = gtl::MakeCleanup([fd]() { close(fd); });
+  struct stat st;
+  if (fstat(fd, &st) != 0) {
+    return MAKE_ERROR(ERR_INTERNAL)
+           << "Failed to stat " << path << ": " << strerror(errno);
+  }
+  CHECK_RETURN_IF_FALSE(st.st_size <= INT_MAX)
+      << path << " is too large to be parsed: " << st.st_size << " bytes.";
+  if (st.st_size == 0) {
+    // mmap() rejects empty mappings. An empty file is a valid empty message.
+    message->Clear();
+    return ::util::OkStatus();
+  }
+  void* addr = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  if (addr == MAP_FAILED) {
+    return MAKE_ERROR(ERR_INTERNAL)
+           << "Failed to mmap " << path << ": " << strerror(errno);
+  }
+  auto unmapper = gtl::MakeCleanup([addr, &st]() { munmap(addr, st.st_size); });
+  madvise(addr, st.st_size, MADV_SEQUENTIAL);
+  if (!message->ParseFromArray(addr, st.st_size)) {
+    return MAKE_ERROR(ERR_INTERNAL) << "Failed to parse the binary content of "
+                                    << path << " to proto.";
+  }
+
+  return ::util::OkStatus();
+}
+
+}  // namespace
+
+::util::Status ForwardingPipelineConfigStore::Save(
+    uint64 node_id, const ::p4::v1::ForwardingPipelineConfig& config) const {
+  CHECK_RETURN_IF_FALSE(!dir_.empty()) << "No dir given for the store.";
+  if (!PathExists(dir_)) RETURN_IF_ERROR(RecursivelyCreateDir(dir_));
+  std::string buffer;
+  if (!config.SerializeToString(&buffer)) {
+    return MAKE_ERROR(ERR_INVALID_PARAM)
+           << "Failed to serialize the forwarding pipeline config for node "
+           << node_id << ".";
+  }
+
+  const std::string path = NodeFilePath(node_id);
+  const std::string tmp_path = absl::StrCat(path, kTmpFileSuffix);
+  int fd = open(tmp_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC,
+                S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH);
+  if (fd < 0) {
+    return MAKE_ERROR(ERR_INTERNAL)
+           << "Failed to open " << tmp_path << ": " << strerror(errno);
+  }
+  // Removes the temporary file if we bail out before the rename.
+  auto tmp_remover = gtl::MakeCleanup([&tmp_path]() {
+    if (unlink(tmp_path.c_str()) != 0 && errno != ENOENT) {
+      LOG(ERROR) << "Failed to remove " << tmp_path << ": "
+                 << strerror(errno);
+    }
+  });
+  {
+    auto fd_closer = gtl::MakeCleanup([fd]() { close(fd); });
+    RETURN_IF_ERROR(WriteAll(fd, buffer, tmp_path));
+    // The data must be on disk before the rename is, or a crash could leave
+    // the renamed file empty.
+    if (fsync(fd) != 0) {
+      return MAKE_ERROR(ERR_INTERNAL)
+             << "Failed to sync " << tmp_path << ": " << strerror(errno);
+    }
+  }
+  if (rename(tmp_path.c_str(), path.c_str()) != 0) {
+    return MAKE_ERROR(ERR_INTERNAL) << "Failed to rename " << tmp_path
+                                    << " to " << path << ": "
+                                    << strerror(errno);
+  }
+  tmp_remover.release();
+  RETURN_IF_ERROR(SyncDir(dir_));
+
+  return ::util::OkStatus();
+}
+
+::util::Status ForwardingPipelineConfigStore::Load(
+    uint64 node_id, ::p4::v1::ForwardingPipelineConfig* config) const {
+  CHECK_RETURN_IF_FALSE(config != nullptr);
+  return ParseProtoFromMappedFile(NodeFilePath(node_id), config);
+}
+
+::util::Status ForwardingPipelineConfigStore::LoadAll(
+    ForwardingPipelineConfigs* configs) const {
+  CHECK_RETURN_IF_FALSE(configs != nullptr);
+  configs->Clear();
+  DIR* dir = opendir(dir_.c_str());
+  if (dir == nullptr) {
+    if (errno == ENOENT) {
+      return MAKE_ERROR(ERR_FILE_NOT_FOUND) << dir_ << " not found.";
+    }
+    return MAKE_ERROR(ERR_INTERNAL)
+           << "Failed to open dir " << dir_ << ": " << strerror(errno);
+  }
+  auto dir_closer = gtl::MakeCleanup([dir]() { closedir(dir); });
+  struct dirent* entry;
+  while ((entry = readdir(dir)) != nullptr) {
+    uint64 node_id;
+    if (!ParseNodeFileName(entry->d_name, &node_id)) continue;
+    ::p4::v1::ForwardingPipelineConfig config;
+    RETURN_IF_ERROR(ParseProtoFromMappedFile(
+        absl::StrCat(dir_, "/", entry->d_name), &config));
+    (*configs->mutable_node_id_to_config())[node_id].Swap(&config);
+  }
+  if (configs->node_id_to_config_size() == 0) {
+    return MAKE_ERROR(ERR_FILE_NOT_FOUND)
+           << "No forwarding pipeline config saved in " << dir_ << ".";
+  }
+
+  return ::util::OkStatus();
+}
+
+::util::Status ForwardingPipelineConfigStore::Clear() const {
+  DIR* dir = opendir(dir_.c_str());
+  if (dir == nullptr) {
+    if (errno == ENOENT) return ::util::OkStatus();
+    return MAKE_ERROR(ERR_INTERNAL)
+           << "Failed to open dir " << dir_ << ": " << strerror(errno);
+  }
+  auto dir_closer = gtl::MakeCleanup([dir]() { closedir(dir); });
+  struct dirent* entry;
+  while ((entry = readdir(dir)) != nullptr) {
+    if (!IsStoreFileName(entry->d_name)) continue;
+    RETURN_IF_ERROR(RemoveFile(absl::StrCat(dir_, "/", entry->d_name)));
+  }
+
+  return ::util::OkStatus();
+}
+
+std::string ForwardingPipelineConfigStore::NodeFilePath(uint64 node_id) const {
+  return absl::StrCat(dir_, "/", kNodeFilePrefix, node_id, kNodeFileSuffix);
+}
+
+bool ForwardingPipelineConfigStore::ParseNodeFileName(const std::string& name,
+                                                      uint64* node_id) {
+  if (!absl::StartsWith(name, kNodeFilePrefix) ||
+      !absl::EndsWith(name, kNodeFileSuffix)) {
+    return false;
+  }
+  const size_t prefix_size = sizeof(kNodeFilePrefix) - 1;
+  const size_t suffix_size = sizeof(kNodeFileSuffix) - 1;
+  if (name.size() <= prefix_size + suffix_size) return false;
+  return absl::SimpleAtoi(
+      name.substr(prefix_size, name.size() - prefix_size - suffix_size),
+      node_id);
+}
+
+bool ForwardingPipelineConfigStore::IsStoreFileName(const std::string& name) {
+  uint64 node_id;
+  if (absl::EndsWith(name, kTmpFileSuffix)) {
+    return ParseNodeFileName(
+        name.substr(0, name.size() - (sizeof(kTmpFileSuffix) - 1)), &node_id);
+  }
+  return ParseNodeFileName(name, &node_id);
+}
+
+}  // namespace hal
+}  // namespace stratum
@@ -0,0 +1,72 @@
+// Copyright 2018-present Open Networking Foundation
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef STRATUM_HAL_LIB_COMMON_FORWARDING_PIPELINE_CONFIG_STORE_H_
+#define STRATUM_HAL_LIB_COMMON_FORWARDING_PIPELINE_CONFIG_STORE_H_
+
+#include <string>
+
+#include "p4/v1/p4runtime.pb.h"
+#include "stratum/glue/integral_types.h"
+#include "stratum/glue/status/status.h"
+#include "stratum/hal/lib/p4/forwarding_pipeline_configs.pb.h"
+
+namespace stratum {
+namespace hal {
+
+// ForwardingPipelineConfigStore persists the forwarding pipeline configs of
+// the nodes in a directory, so that they can be pushed again after a restart.
+// Each node has its own file, "node_<node_id>.pb.bin", holding the binary
+// serialized ::p4::v1::ForwardingPipelineConfig of the node. Saving the config
+// of a node therefore only rewrites the file of that node.
+//
+// A file is never modified in place: Save() writes the new config to a
+// temporary file in the same directory, syncs it to disk and renames it over
+// the old file. After a crash, a node file holds either the old or the new
+// config, never a partially written one. Files are read back through mmap()
+// and parsed straight from the mapping, without copying them to a buffer.
+//
+// The class holds no state besides the directory path. It is not thread-safe:
+// concurrent calls for the same node must be serialized by the caller.
+class ForwardingPipelineConfigStore {
+ public:
+  explicit ForwardingPipelineConfigStore(const std::string& dir) : dir_(dir) {}
+  ~ForwardingPipelineConfigStore() {}
+
+  // Atomically replaces the saved config of the given node. The directory is
+  // created if it does not exist.
+  ::util::Status Save(uint64 node_id,
+                      const ::p4::v1::ForwardingPipelineConfig& config) const;
+
+  // Reads the saved config of the given node. Returns ERR_FILE_NOT_FOUND if
+  // there is no saved config for the node.
+  ::util::Status Load(uint64 node_id,
+                      ::p4::v1::ForwardingPipelineConfig* config) const;
+
+  // Reads the saved configs of all the nodes into 'configs', which is cleared
+  // first. Returns ERR_FILE_NOT_FOUND if no config is saved in the directory.
+  ::util::Status LoadAll(ForwardingPipelineConfigs* configs) const;
+
+  // Removes the saved configs of all the nodes, as well as the temporary files
+  // left over by a crash.
+  ::util::Status Clear() const;
+
+  // Returns the path of the file holding the config of the given node.
+  std::string NodeFilePath(uint64 node_id) const;
+
+  const std::string& dir() const { return dir_; }
+
+ private:
+  // Returns true and sets 'node_id' if 'name' is the name of a node file.
+  static bool ParseNodeFileName(const std::string& name, uint64* node_id);
+
+  // Returns true if 'name' is the name of a node or temporary file.
+  static bool IsStoreFileName(const std::string& name);
+
+  const std::string dir_;
+};
+
+}  // namespace hal
+}  // namespace stratum
+
+#endif  // STRATUM_HAL_LIB_COMMON_FORWARDING_PIPELINE_CONFIG_STORE_H_
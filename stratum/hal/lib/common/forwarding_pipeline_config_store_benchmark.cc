@@ -0,0 +1,116 @@
+// Copyright 2018-present Open Networking Foundation
+// SPDX-License-Identifier: Apache-2.0
+
+// Benchmarks saving and loading the forwarding pipeline configs which
+// P4Service pushes again on startup, comparing the text file holding the
+// configs of all the nodes (WriteProtoToTextFile/ReadProtoFromTextFile)
+// against the binary per-node files of ForwardingPipelineConfigStore. The
+// config models a large Tofino pipeline: a p4info with a few hundred tables
+// and actions and a p4_device_config blob of the given size in MiB, filled
+// with random bytes like a compiled tofino.bin. The files are written to
+// /tmp, or to $TEST_TMPDIR if set.
+
+#include <stdlib.h>
+
+#include <random>
+#include <string>
+
+#include "benchmark/benchmark.h"
+#include "stratum/glue/logging.h"
+#include "stratum/hal/lib/common/forwarding_pipeline_config_store.h"
+#include "stratum/lib/utils.h"
+
+namespace stratum {
+namespace hal {
+namespace {
+
+constexpr uint64 kNodeId = 1;
+constexpr int kNumTables = 300;
+constexpr int kNumActions = 1000;
+
+std::string TmpDir() {
+  const char* dir = getenv("TEST_TMPDIR");
+  return dir != nullptr ? dir : "/tmp";
+}
+
+ForwardingPipelineConfigs MakeConfigs(int device_config_mib) {
+  ForwardingPipelineConfigs configs;
+  auto& config = (*configs.mutable_node_id_to_config())[kNodeId];
+  auto* p4info = config.mutable_p4info();
+  for (int i = 0; i < kNumTables; ++i) {
+    auto* table = p4info->add_tables();
+    table->mutable_preamble()->set_id(0x02000000 + i);
+    table->mutable_preamble()->set_name("FabricIngress.table_" +
+                                        std::to_string(i));
+    for (int j = 0; j < 4; ++j) {
+      auto* field = table->add_match_fields();
+      field->set_id(j + 1);
+      field->set_name("hdr.field_" + std::to_string(j));
+      field->set_bitwidth(32);
+    }
+    table->set_size(4096);
+  }
+  for (int i = 0; i < kNumActions; ++i) {
+    auto* action = p4info->add_actions();
+    action->mutable_preamble()->set_id(0x01000000 + i);
+    action->mutable_preamble()->set_name("FabricIngress.action_" +
+                                         std::to_string(i));
+  }
+  std::string blob(device_config_mib << 20, 0);
+  std::mt19937 gen(42);
+  for (auto& c : blob) c = static_cast<char>(gen());
+  config.set_p4_device_config(blob);
+  config.mutable_cookie()->set_cookie(1);
+  return configs;
+}
+
+void BM_SaveText(benchmark::State& state) {
+  const auto configs = MakeConfigs(state.range(0));
+  const std::string path = TmpDir() + "/pipeline_cfg_benchmark.pb.txt";
+  for (auto _ : state) {
+    CHECK(WriteProtoToTextFile(configs, path).ok());
+  }
+  CHECK(RemoveFile(path).ok());
+}
+BENCHMARK(BM_SaveText)->Arg(1)->Arg(16)->Unit(benchmark::kMillisecond);
+
+void BM_SaveBinary(benchmark::State& state) {
+  const auto configs = MakeConfigs(state.range(0));
+  ForwardingPipelineConfigStore store(TmpDir() + "/pipeline_cfgs_benchmark");
+  for (auto _ : state) {
+    CHECK(store.Save(kNodeId, configs.node_id_to_config().at(kNodeId)).ok());
+  }
+  CHECK(store.Clear().ok());
+}
+BENCHMARK(BM_SaveBinary)->Arg(1)->Arg(16)->Unit(benchmark::kMillisecond);
+
+// What P4Service did on startup before the configs were saved in binary.
+void BM_LoadText(benchmark::State& state) {
+  const std::string path = TmpDir() + "/pipeline_cfg_benchmark.pb.txt";
+  CHECK(WriteProtoToTextFile(MakeConfigs(state.range(0)), path).ok());
+  for (auto _ : state) {
+    ForwardingPipelineConfigs configs;
+    CHECK(ReadProtoFromTextFile(path, &configs).ok());
+    benchmark::DoNotOptimize(configs);
+  }
+  CHECK(RemoveFile(path).ok());
+}
+BENCHMARK(BM_LoadText)->Arg(1)->Arg(16)->Unit(benchmark::kMillisecond);
+
+void BM_LoadBinary(benchmark::State& state) {
+  const auto saved_configs = MakeConfigs(state.range(0));
+  ForwardingPipelineConfigStore store(TmpDir() + "/pipeline_cfgs_benchmark");
+  CHECK(store.Save(kNodeId, saved_configs.node_id_to_config().at(kNodeId))
+            .ok());
+  for (auto _ : state) {
+    ForwardingPipelineConfigs configs;
+    CHECK(store.LoadAll(&configs).ok());
+    benchmark::DoNotOptimize(configs);
+  }
+  CHECK(store.Clear().ok());
+}
+BENCHMARK(BM_LoadBinary)->Arg(1)->Arg(16)->Unit(benchmark::kMillisecond);
+
+}  // namespace
+}  // namespace hal
+}  // namespace stratum
@@ -0,0 +1,138 @@
+// Copyright 2018-present Open Networking Foundation
+// SPDX-License-Identifier: Apache-2.0
+
+#include "stratum/hal/lib/common/forwarding_pipeline_config_store.h"
+
+#include <string>
+
+#include "gflags/gflags.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "stratum/glue/status/status_test_util.h"
+#include "stratum/lib/test_utils/matchers.h"
+#include "stratum/lib/utils.h"
+#include "stratum/public/lib/error.h"
+
+DECLARE_string(test_tmpdir);
+
+namespace stratum {
+namespace hal {
+
+using test_utils::EqualsProto;
+using ::testing::HasSubstr;
+
+class ForwardingPipelineConfigStoreTest : public ::testing::Test {
+ protected:
+  ForwardingPipelineConfigStoreTest()
+      : store_(FLAGS_test_tmpdir + "/pipeline_cfgs") {}
+
+  void SetUp() override { ASSERT_OK(store_.Clear()); }
+
+  static ::p4::v1::ForwardingPipelineConfig MakeConfig(int num_tables,
+                                                       const std::string& blob,
+                                                       uint64 cookie) {
+    ::p4::v1::ForwardingPipelineConfig config;
+    for (int i = 0; i < num_tables; ++i) {
+      auto* table = config.mutable_p4info()->add_tables();
+      table->mutable_preamble()->set_id(i + 1);
+      table->mutable_preamble()->set_name("table_" + std::to_string(i));
+    }
+    config.set_p4_device_config(blob);
+    config.mutable_cookie()->set_cookie(cookie);
+    return config;
+  }
+
+  static constexpr uint64 kNodeId1 = 123123123;
+  static constexpr uint64 kNodeId2 = 456456456;
+
+  ForwardingPipelineConfigStore store_;
+};
+
+constexpr uint64 ForwardingPipelineConfigStoreTest::kNodeId1;
+constexpr uint64 ForwardingPipelineConfigStoreTest::kNodeId2;
+
+TEST_F(ForwardingPipelineConfigStoreTest, SaveAndLoad) {
+  // Binary blobs are kept as is, including null bytes.
+  const auto config = MakeConfig(3, std::string("\x00\xff\x01tofino", 9), 1);
+  ASSERT_OK(store_.Save(kNodeId1, config));
+  EXPECT_TRUE(PathExists(store_.NodeFilePath(kNodeId1)));
+  EXPECT_FALSE(PathExists(store_.NodeFilePath(kNodeId1) + ".tmp"));
+
+  ::p4::v1::ForwardingPipelineConfig loaded;
+  ASSERT_OK(store_.Load(kNodeId1, &loaded));
+  EXPECT_THAT(loaded, EqualsProto(config));
+  EXPECT_EQ(ERR_FILE_NOT_FOUND, store_.Load(kNodeId2, &loaded).error_code());
+}
+
+TEST_F(ForwardingPipelineConfigStoreTest, SaveEmptyConfig) {
+  ASSERT_OK(store_.Save(kNodeId1, ::p4::v1::ForwardingPipelineConfig()));
+  ::p4::v1::ForwardingPipelineConfig loaded = MakeConfig(1, "blob", 1);
+  ASSERT_OK(store_.Load(kNodeId1, &loaded));
+  EXPECT_THAT(loaded, EqualsProto(::p4::v1::ForwardingPipelineConfig()));
+}
+
+TEST_F(ForwardingPipelineConfigStoreTest, SaveOnlyReplacesTheNodeFile) {
+  const auto config1 = MakeConfig(2, "blob1", 1);
+  const auto config2 = MakeConfig(4, "blob2", 2);
+  const auto config3 = MakeConfig(8, "blob3", 3);
+  ASSERT_OK(store_.Save(kNodeId1, config1));
+  ASSERT_OK(store_.Save(kNodeId2, config2));
+  ASSERT_OK(store_.Save(kNodeId2, config3));
+
+  ForwardingPipelineConfigs configs;
+  ASSERT_OK(store_.LoadAll(&configs));
+  ASSERT_EQ(2, configs.node_id_to_config_size());
+  EXPECT_THAT(configs.node_id_to_config().at(kNodeId1), EqualsProto(config1));
+  EXPECT_THAT(configs.node_id_to_config().at(kNodeId2), EqualsProto(config3));
+}
+
+TEST_F(ForwardingPipelineConfigStoreTest, LoadAllIgnoresOtherFiles) {
+  const auto config = MakeConfig(1, "blob", 1);
+  ASSERT_OK(store_.Save(kNodeId1, config));
+  // A temporary file left over by a crash during Save() and unrelated files
+  // are skipped.
+  ASSERT_OK(
+      WriteStringToFile("garbage", store_.NodeFilePath(kNodeId2) + ".tmp"));
+  ASSERT_OK(WriteStringToFile("garbage", store_.dir() + "/node_x.pb.bin"));
+  ASSERT_OK(WriteStringToFile("garbage", store_.dir() + "/README"));
+
+  ForwardingPipelineConfigs configs;
+  ASSERT_OK(store_.LoadAll(&configs));
+  ASSERT_EQ(1, configs.node_id_to_config_size());
+  EXPECT_THAT(configs.node_id_to_config().at(kNodeId1), EqualsProto(config));
+
+  // Clear() only removes the files of the store.
+  ASSERT_OK(store_.Clear());
+  EXPECT_FALSE(PathExists(store_.NodeFilePath(kNodeId1)));
+  EXPECT_FALSE(PathExists(store_.NodeFilePath(kNodeId2) + ".tmp"));
+  EXPECT_TRUE(PathExists(store_.dir() + "/README"));
+  ASSERT_OK(RemoveFile(store_.dir() + "/node_x.pb.bin"));
+  ASSERT_OK(RemoveFile(store_.dir() + "/README"));
+}
+
+TEST_F(ForwardingPipelineConfigStoreTest, LoadAllWithNoSavedConfig) {
+  ForwardingPipelineConfigs configs;
+  ::util::Status status = store_.LoadAll(&configs);
+  EXPECT_EQ(ERR_FILE_NOT_FOUND, status.error_code());
+  EXPECT_THAT(status.error_message(), HasSubstr("No forwarding pipeline"));
+
+  ForwardingPipelineConfigStore missing_dir_store(FLAGS_test_tmpdir +
+                                                  "/no_such_dir");
+  EXPECT_EQ(ERR_FILE_NOT_FOUND,
+            missing_dir_store.LoadAll(&configs).error_code());
+  EXPECT_EQ(0, configs.node_id_to_config_size());
+}
+
+TEST_F(ForwardingPipelineConfigStoreTest, LoadAllFailsForCorruptFile) {
+  ASSERT_OK(store_.Save(kNodeId1, MakeConfig(1, "blob", 1)));
+  ASSERT_OK(WriteStringToFile("\xff\xff\xff", store_.NodeFilePath(kNodeId2)));
+
+  ForwardingPipelineConfigs configs;
+  ::util::Status status = store_.LoadAll(&configs);
+  EXPECT_EQ(ERR_INTERNAL, status.error_code());
+  EXPECT_THAT(status.error_message(),
+              HasSubstr(store_.NodeFilePath(kNodeId2)));
+}
+
+}  // namespace hal
+}  // namespace stratum
@@ -9,6 +9,7 @@
 #include <memory>
 #include <set>
 #include <string>
+#include <utility>
 
 #include "absl/container/flat_hash_map.h"
 #include "absl/synchronization/mutex.h"
@@ -569,13 +570,29 @@ class EventHandlerRecord {
 
   // Generic processing of an event.
   ::util::Status operator()(const GnmiEvent& event) const {
-    auto status = handler_(event, stream_);
+    return (*this)(event, stream_);
+  }
+
+  // Processing of an event with the responses written to 'stream', which is
+  // expected to forward them to the stream of this record.
+  ::util::Status operator()(const GnmiEvent& event,
+                            GnmiSubscribeStream* stream) const {
+    auto status = handler_(event, stream);
     if (status != ::util::OkStatus()) {
       return status;
     }
     return ::util::OkStatus();
   }
 
+  GnmiSubscribeStream* stream() const { return stream_; }
+
+  // Makes the handler write to 'stream', a stream wrapping the one given to
+  // the constructor, which is then owned by this record.
+  void WrapStream(std::unique_ptr<GnmiSubscribeStream> stream) {
+    wrapping_stream_ = std::move(stream);
+    stream_ = wrapping_stream_.get();
+  }
+
   TimerDaemon::DescriptorPtr* mutable_timer() { return &timer_; }
 
  protected:
@@ -583,6 +600,8 @@ class EventHandlerRecord {
   GnmiEventHandler handler_;
   // A stream to the client (the controller).
   GnmiSubscribeStream* stream_;
+  // The stream set by WrapStream(), if any.
+  std::unique_ptr<GnmiSubscribeStream> wrapping_stream_;
   // Not every EventHandler is executed on timer, but some are and this is the
   // handler that is used by the timer sub-system.
   TimerDaemon::DescriptorPtr timer_;
@@ -596,8 +615,19 @@ using SubscriptionHandle = std::shared_ptr<EventHandlerRecord>;
 // - to allow storing pointers to all specialized instances of event handler
 //   list.
 // - to implement Register() and UnRegister() methods (to limit code-bloat)
+//
+// The set of handlers is kept as an immutable snapshot. Register(),
+// UnRegister() and the removal of the expired entries build a new set and
+// publish it atomically, so Process() walks a snapshot without taking any lock
+// and the writers never wait for the handlers to return. The callers are
+// responsible for making sure that a stream is not destroyed while an event
+// processed with an older snapshot may still be written to it; GnmiPublisher
+// does it by serializing HandleChange() and UnSubscribe().
 class EventHandlerListBase {
  public:
+  using HandlerSet =
+      std::set<EventHandlerRecordPtr, std::owner_less<EventHandlerRecordPtr>>;
+
   // A hierarchy of classes uses this class as base, so, virtual destructor is
   // needed.
   virtual ~EventHandlerListBase() {}
@@ -612,7 +642,12 @@ class EventHandlerListBase {
   ::util::Status Register(const EventHandlerRecordPtr& record)
       LOCKS_EXCLUDED(access_lock_) {
     absl::WriterMutexLock l(&access_lock_);
-    handlers_.insert(record);
+    auto current = GetHandlers();
+    // A subscription to a subtree registers its record once per leaf.
+    if (current->count(record)) return ::util::OkStatus();
+    auto handlers = std::make_shared<HandlerSet>(*current);
+    handlers->insert(record);
+    PublishHandlers(std::move(handlers));
     return ::util::OkStatus();
   }
 
@@ -621,7 +656,11 @@ class EventHandlerListBase {
   ::util::Status UnRegister(const EventHandlerRecordPtr& record)
       LOCKS_EXCLUDED(access_lock_) {
     absl::WriterMutexLock l(&access_lock_);
-    handlers_.erase(record);
+    auto current = GetHandlers();
+    if (!current->count(record)) return ::util::OkStatus();
+    auto handlers = std::make_shared<HandlerSet>(*current);
+    handlers->erase(record);
+    PublishHandlers(std::move(handlers));
     return ::util::OkStatus();
   }
 
@@ -631,33 +670,42 @@ class EventHandlerListBase {
     // To return acurate information remove all expired subscriptions.
     CleanUpInactiveRegistrations();
     // Return the number of still active registrations.
-    return handlers_.size();
+    return GetHandlers()->size();
   }
 
  protected:
+  EventHandlerListBase() : handlers_(std::make_shared<const HandlerSet>()) {}
+
+  // Returns the current snapshot of the set of handlers. Can be called without
+  // holding access_lock_.
+  std::shared_ptr<const HandlerSet> GetHandlers() const {
+    return std::atomic_load(&handlers_);
+  }
+
+  // Replaces the snapshot of the set of handlers.
+  void PublishHandlers(std::shared_ptr<const HandlerSet> handlers)
+      EXCLUSIVE_LOCKS_REQUIRED(access_lock_) {
+    std::atomic_store(&handlers_, std::move(handlers));
+  }
+
   // Removes pointers that are expired.
   void CleanUpInactiveRegistrations() EXCLUSIVE_LOCKS_REQUIRED(access_lock_) {
-    std::list<EventHandlerRecordPtr> entries_to_be_removed;
-    for (const auto& entry : handlers_) {
-      if (entry.expired()) {
-        // The subscription has been silently (without calling UnRegister())
-        // canceled by deleting the handle. Make a note of this record and
-        // then delete it after all entries in handlers_ are processed.
-        entries_to_be_removed.push_back(entry);
-      }
-    }
-    // Remove all subscriptions that have been silently canceled.
-    for (const auto& handler : entries_to_be_removed) {
-      handlers_.erase(handler);
+    auto current = GetHandlers();
+    auto handlers = std::make_shared<HandlerSet>();
+    for (const auto& entry : *current) {
+      // Expired entries belong to subscriptions that have been silently
+      // (without calling UnRegister()) canceled by deleting the handle.
+      if (!entry.expired()) handlers->insert(entry);
     }
+    PublishHandlers(std::move(handlers));
   }
 
-  // A Mutex used to guard access to the map of pointers to handlers.
+  // A Mutex used to serialize the updates of the set of handlers.
   mutable absl::Mutex access_lock_;
 
-  // A set of event handlers that are interested in this ('E') type of events.
-  std::set<EventHandlerRecordPtr, std::owner_less<EventHandlerRecordPtr>>
-      handlers_ GUARDED_BY(access_lock_);
+  // A snapshot of the set of event handlers that are interested in this ('E')
+  // type of events. Only accessed with std::atomic_load()/std::atomic_store().
+  std::shared_ptr<const HandlerSet> handlers_;
 };
 
 // A class that keeps track of all event handlers that are interested in
@@ -680,15 +728,22 @@ class EventHandlerList : public EventHandlerListBase {
   // It goes through the list of registered event handlers and calls each of
   // them with the 'event' to be processed.
   ::util::Status Process(const GnmiEvent& base_event) override {
-    absl::WriterMutexLock l(&access_lock_);
     if (const E* event = dynamic_cast<const E*>(&base_event)) {
       VLOG(1) << "Handling " << Demangle(typeid(E).name());
-      CleanUpInactiveRegistrations();
-      for (const auto& entry : handlers_) {
+      // The snapshot stays alive until all its handlers have been called.
+      auto handlers = GetHandlers();
+      bool found_expired = false;
+      for (const auto& entry : *handlers) {
         if (auto handler = entry.lock()) {
           (*handler)(*event).IgnoreError();
+        } else {
+          found_expired = true;
         }
       }
+      if (found_expired) {
+        absl::WriterMutexLock l(&access_lock_);
+        CleanUpInactiveRegistrations();
+      }
     } else {
       // This __really__ should never happen!
       LOG(ERROR) << "Incorrectly routed event! "
@@ -0,0 +1,136 @@
+// Copyright 2018-present Open Networking Foundation
+// SPDX-License-Identifier: Apache-2.0
+
+// Benchmarks a gNMI Get of /interfaces, the state of all the interfaces of a
+// dummy switch with 4 nodes of 64 ports each, through GnmiPublisher:
+// - BM_GetLeafByLeaf polls the path with HandlePoll(), which sends one
+//   RetrieveValue() call to the switch for each leaf,
+// - BM_GetBatched polls it with HandleBatchedPoll(), as done by
+//   ConfigMonitoringService::DoGet(), which sends one call per node, the nodes
+//   being read in parallel.
+// The argument is a delay in microseconds added to each RetrieveValue() call,
+// standing for a switch whose calls reach the SDK. The switch_calls_per_get
+// counter reports the number of RetrieveValue() calls made for one Get.
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+#include "absl/memory/memory.h"
+#include "absl/strings/str_cat.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "benchmark/benchmark.h"
+#include "gmock/gmock.h"
+#include "stratum/glue/logging.h"
+#include "stratum/hal/lib/common/gnmi_publisher.h"
+#include "stratum/hal/lib/common/phal_mock.h"
+#include "stratum/hal/lib/common/switch_mock.h"
+#include "stratum/hal/lib/dummy/dummy_chassis_mgr.h"
+#include "stratum/hal/lib/dummy/dummy_switch.h"
+
+namespace stratum {
+namespace hal {
+namespace {
+
+using ::testing::_;
+using ::testing::Invoke;
+using ::testing::NiceMock;
+
+constexpr int kNumNodes = 4;
+constexpr int kNumPortsPerNode = 64;
+
+// A GnmiPublisher on top of a dummy switch, counting the RetrieveValue()
+// calls made to the switch.
+class Publisher {
+ public:
+  explicit Publisher(int delay_us)
+      : dummy_switch_(dummy_switch::DummySwitch::CreateInstance(
+            &phal_mock_, dummy_switch::DummyChassisManager::GetSingleton())),
+        num_switch_calls_(0) {
+    ON_CALL(switch_mock_, RetrieveValue(_, _, _, _))
+        .WillByDefault(Invoke([this, delay_us](
+                                  uint64 node_id, const DataRequest& req,
+                                  WriterInterface<DataResponse>* writer,
+                                  std::vector<::util::Status>* details) {
+          ++num_switch_calls_;
+          if (delay_us > 0) absl::SleepFor(absl::Microseconds(delay_us));
+          return dummy_switch_->RetrieveValue(node_id, req, writer, details);
+        }));
+    ChassisConfig config;
+    config.mutable_chassis()->set_name("dummy");
+    for (int node = 1; node <= kNumNodes; ++node) {
+      auto* node_config = config.add_nodes();
+      node_config->set_id(node);
+      node_config->set_slot(1);
+      node_config->set_index(node);
+      for (int port = 1; port <= kNumPortsPerNode; ++port) {
+        auto* singleton_port = config.add_singleton_ports();
+        singleton_port->set_id((node - 1) * kNumPortsPerNode + port);
+        singleton_port->set_name(absl::StrCat(node, "/", port, "/1"));
+        singleton_port->set_node(node);
+        singleton_port->set_slot(1);
+        singleton_port->set_port(port);
+      }
+    }
+    CHECK_OK(dummy_switch_->PushChassisConfig(config));
+    publisher_ = absl::make_unique<GnmiPublisher>(&switch_mock_);
+    CHECK_OK(publisher_->HandleChange(ConfigHasBeenPushedEvent(config)));
+  }
+
+  GnmiPublisher* publisher() { return publisher_.get(); }
+  int64 num_switch_calls() const { return num_switch_calls_; }
+
+ private:
+  NiceMock<PhalMock> phal_mock_;
+  std::unique_ptr<dummy_switch::DummySwitch> dummy_switch_;
+  // Forwards the calls to the dummy switch.
+  NiceMock<SwitchMock> switch_mock_;
+  std::atomic<int64> num_switch_calls_;
+  std::unique_ptr<GnmiPublisher> publisher_;
+};
+
+// Subscribes to /interfaces with POLL mode.
+SubscriptionHandle SubscribeInterfaces(GnmiPublisher* publisher,
+                                       GnmiSubscribeStream* stream) {
+  ::gnmi::Path path;
+  path.add_elem()->set_name("interfaces");
+  SubscriptionHandle h;
+  CHECK_OK(publisher->SubscribePoll(path, stream, &h));
+  return h;
+}
+
+void BM_GetLeafByLeaf(benchmark::State& state) {
+  Publisher publisher(state.range(0));
+  InlineGnmiSubscribeStream stream(
+      [](const ::gnmi::SubscribeResponse& resp) { return true; });
+  SubscriptionHandle h = SubscribeInterfaces(publisher.publisher(), &stream);
+  const int64 num_calls_before = publisher.num_switch_calls();
+  for (auto _ : state) {
+    CHECK_OK(publisher.publisher()->HandlePoll(h));
+  }
+  state.counters["switch_calls_per_get"] = benchmark::Counter(
+      static_cast<double>(publisher.num_switch_calls() - num_calls_before) /
+      state.iterations());
+}
+BENCHMARK(BM_GetLeafByLeaf)->Arg(0)->Arg(50)->UseRealTime();
+
+void BM_GetBatched(benchmark::State& state) {
+  Publisher publisher(state.range(0));
+  InlineGnmiSubscribeStream stream(
+      [](const ::gnmi::SubscribeResponse& resp) { return true; });
+  const std::vector<SubscriptionHandle> handles = {
+      SubscribeInterfaces(publisher.publisher(), &stream)};
+  const int64 num_calls_before = publisher.num_switch_calls();
+  for (auto _ : state) {
+    CHECK_OK(publisher.publisher()->HandleBatchedPoll(handles));
+  }
+  state.counters["switch_calls_per_get"] = benchmark::Counter(
+      static_cast<double>(publisher.num_switch_calls() - num_calls_before) /
+      state.iterations());
+}
+BENCHMARK(BM_GetBatched)->Arg(0)->Arg(50)->UseRealTime();
+
+}  // namespace
+}  // namespace hal
+}  // namespace stratum
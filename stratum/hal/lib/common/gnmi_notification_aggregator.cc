@@ -0,0 +1,149 @@
+// Copyright 2018-present Open Networking Foundation
+// SPDX-License-Identifier: Apache-2.0
+
+#include "stratum/hal/lib/common/gnmi_notification_aggregator.h"
+
+#include <algorithm>
+
+#include "gflags/gflags.h"
+#include "stratum/glue/logging.h"
+#include "stratum/glue/status/status_macros.h"
+#include "stratum/lib/macros.h"
+#include "stratum/public/lib/error.h"
+
+DEFINE_int64(gnmi_max_notification_bytes, 256 * 1024,
+             "Max size in bytes of the gNMI notification holding the updates "
+             "of the leaves sampled by one subscription tick. The updates "
+             "are split into several notifications only if they exceed this "
+             "size. 0 sends one notification per leaf.");
+
+namespace stratum {
+namespace hal {
+
+namespace {
+
+bool PathElemEqual(const ::gnmi::PathElem& a, const ::gnmi::PathElem& b) {
+  if (a.name() != b.name() || a.key_size() != b.key_size()) return false;
+  for (const auto& key : a.key()) {
+    auto it = b.key().find(key.first);
+    if (it == b.key().end() || it->second != key.second) return false;
+  }
+  return true;
+}
+
+// Returns the number of leading elements common to the paths of all the
+// updates and deletes of 'notification', leaving at least one element in each
+// path.
+int CommonPrefixLength(const ::gnmi::Notification& notification) {
+  const ::gnmi::Path* first = nullptr;
+  int length = 0;
+  auto visit = [&first, &length](const ::gnmi::Path& path) {
+    if (first == nullptr) {
+      first = &path;
+      length = path.elem_size() - 1;
+      return;
+    }
+    length = std::min(length, path.elem_size() - 1);
+    int i = 0;
+    while (i < length && PathElemEqual(path.elem(i), first->elem(i))) ++i;
+    length = i;
+  };
+  for (const auto& update : notification.update()) visit(update.path());
+  for (const auto& path : notification.delete_()) visit(path);
+
+  return std::max(length, 0);
+}
+
+}  // namespace
+
+AggregatingGnmiSubscribeStream::AggregatingGnmiSubscribeStream(
+    GnmiSubscribeStream* stream)
+    : AggregatingGnmiSubscribeStream(stream,
+                                     FLAGS_gnmi_max_notification_bytes) {}
+
+AggregatingGnmiSubscribeStream::AggregatingGnmiSubscribeStream(
+    GnmiSubscribeStream* stream, int64 max_notification_bytes)
+    : stream_(stream),
+      max_notification_bytes_(max_notification_bytes),
+      notification_(),
+      notification_bytes_(0),
+      num_responses_(0),
+      num_messages_written_(0) {}
+
+bool AggregatingGnmiSubscribeStream::Write(const ::gnmi::SubscribeResponse& msg,
+                                           ::grpc::WriteOptions options) {
+  if (max_notification_bytes_ <= 0) return WriteToStream(msg, options);
+  if (!msg.has_update() || msg.update().has_prefix() ||
+      !msg.update().alias().empty()) {
+    // Keep the order of the messages.
+    if (!Flush().ok()) return false;
+    return WriteToStream(msg, options);
+  }
+
+  const ::gnmi::Notification& notification = msg.update();
+  const int64 size = notification.ByteSizeLong();
+  if (num_responses_ > 0 &&
+      notification_bytes_ + size > max_notification_bytes_) {
+    if (!Flush().ok()) return false;
+  }
+  if (num_responses_ == 0) {
+    notification_.set_timestamp(notification.timestamp());
+  }
+  for (const auto& update : notification.update()) {
+    *notification_.add_update() = update;
+  }
+  for (const auto& path : notification.delete_()) {
+    *notification_.add_delete_() = path;
+  }
+  notification_bytes_ += size;
+  ++num_responses_;
+
+  return true;
+}
+
+::util::Status AggregatingGnmiSubscribeStream::Flush() {
+  if (num_responses_ == 0) return ::util::OkStatus();
+
+  // A single response is written as it came, with the full paths.
+  const int prefix_length =
+      num_responses_ > 1 ? CommonPrefixLength(notification_) : 0;
+  if (prefix_length > 0) {
+    const ::gnmi::Path& first_path = notification_.update_size() > 0
+                                         ? notification_.update(0).path()
+                                         : notification_.delete_(0);
+    auto* prefix = notification_.mutable_prefix();
+    for (int i = 0; i < prefix_length; ++i) {
+      *prefix->add_elem() = first_path.elem(i);
+    }
+    for (auto& update : *notification_.mutable_update()) {
+      update.mutable_path()->mutable_elem()->DeleteSubrange(0, prefix_length);
+    }
+    for (auto& path : *notification_.mutable_delete_()) {
+      path.mutable_elem()->DeleteSubrange(0, prefix_length);
+    }
+  }
+  ::gnmi::SubscribeResponse resp;
+  resp.mutable_update()->Swap(&notification_);
+  notification_.Clear();
+  notification_bytes_ = 0;
+  const int num_responses = num_responses_;
+  num_responses_ = 0;
+  if (!WriteToStream(resp, ::grpc::WriteOptions())) {
+    return MAKE_ERROR(ERR_INTERNAL)
+           << "Writing notification with the updates of " << num_responses
+           << " responses to stream failed.";
+  }
+
+  return ::util::OkStatus();
+}
+
+bool AggregatingGnmiSubscribeStream::WriteToStream(
+    const ::gnmi::SubscribeResponse& msg, ::grpc::WriteOptions options) {
+  if (stream_ == nullptr || !stream_->Write(msg, options)) return false;
+  ++num_messages_written_;
+
+  return true;
+}
+
+}  // namespace hal
+}  // namespace stratum
@@ -0,0 +1,89 @@
+// Copyright 2018-present Open Networking Foundation
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef STRATUM_HAL_LIB_COMMON_GNMI_NOTIFICATION_AGGREGATOR_H_
+#define STRATUM_HAL_LIB_COMMON_GNMI_NOTIFICATION_AGGREGATOR_H_
+
+#include "gnmi/gnmi.grpc.pb.h"
+#include "stratum/glue/integral_types.h"
+#include "stratum/glue/status/status.h"
+#include "stratum/hal/lib/common/gnmi_events.h"
+
+namespace stratum {
+namespace hal {
+
+// A GnmiSubscribeStream which gathers the updates of the SubscribeResponses
+// written to it into a single Notification, instead of sending one message per
+// leaf. The notification is written to the wrapped stream by Flush(), or
+// before an update which would make it exceed max_notification_bytes. It holds
+// the updates and deletes of all the gathered responses, with the timestamp of
+// the first one, and the path elements common to all of them moved to the
+// prefix of the notification. A single gathered response is written unchanged.
+//
+// Responses which cannot be merged (sync_response, notifications which already
+// have a prefix or an alias) flush the gathered updates and are written as is,
+// so the order of the messages is kept.
+//
+// Typical usage, for all the leaves sampled by one subscription tick:
+//   AggregatingGnmiSubscribeStream aggregator(stream);
+//   RETURN_IF_ERROR(handler(event, &aggregator));
+//   RETURN_IF_ERROR(aggregator.Flush());
+//
+// The class is not thread-safe.
+class AggregatingGnmiSubscribeStream : public GnmiSubscribeStream {
+ public:
+  // Uses the limit given by FLAGS_gnmi_max_notification_bytes.
+  explicit AggregatingGnmiSubscribeStream(GnmiSubscribeStream* stream);
+  // A limit of 0 disables the aggregation: every response is written to
+  // 'stream' as is.
+  AggregatingGnmiSubscribeStream(GnmiSubscribeStream* stream,
+                                 int64 max_notification_bytes);
+  ~AggregatingGnmiSubscribeStream() override {}
+
+  // Gathers the updates of 'msg', or writes it to the wrapped stream if it
+  // cannot be merged. Returns false if writing to the wrapped stream failed.
+  bool Write(const ::gnmi::SubscribeResponse& msg,
+             ::grpc::WriteOptions options) override;
+
+  // Writes the gathered updates to the wrapped stream as one notification.
+  ::util::Status Flush();
+
+  // Number of messages written to the wrapped stream so far.
+  int NumMessagesWritten() const { return num_messages_written_; }
+
+  // AggregatingGnmiSubscribeStream is neither copyable nor movable.
+  AggregatingGnmiSubscribeStream(const AggregatingGnmiSubscribeStream&) =
+      delete;
+  AggregatingGnmiSubscribeStream& operator=(
+      const AggregatingGnmiSubscribeStream&) = delete;
+
+ private:
+  // Reading is left to the wrapped stream.
+  void SendInitialMetadata() override { stream_->SendInitialMetadata(); }
+  bool NextMessageSize(uint32_t* sz) override {
+    return stream_->NextMessageSize(sz);
+  }
+  bool Read(::gnmi::SubscribeRequest* msg) override {
+    return stream_->Read(msg);
+  }
+
+  // Writes 'msg' to the wrapped stream.
+  bool WriteToStream(const ::gnmi::SubscribeResponse& msg,
+                     ::grpc::WriteOptions options);
+
+  GnmiSubscribeStream* stream_;  // not owned.
+  const int64 max_notification_bytes_;
+  // The notification being gathered.
+  ::gnmi::Notification notification_;
+  // Serialized size of the gathered notifications, an upper bound of the size
+  // of 'notification_' once the common prefix is taken out.
+  int64 notification_bytes_;
+  // Number of responses gathered in 'notification_'.
+  int num_responses_;
+  int num_messages_written_;
+};
+
+}  // namespace hal
+}  // namespace stratum
+
+#endif  // STRATUM_HAL_LIB_COMMON_GNMI_NOTIFICATION_AGGREGATOR_H_
@@ -0,0 +1,107 @@
+// Copyright 2018-present Open Networking Foundation
+// SPDX-License-Identifier: Apache-2.0
+
+// Benchmarks one tick of a SAMPLE subscription to /interfaces on a 128-port
+// switch, in which the counter leaves of every port are sent to the
+// controller. The argument is the max notification size given to
+// AggregatingGnmiSubscribeStream: 0 writes one message per leaf as before,
+// others gather the leaves into notifications of at most that many bytes.
+// The messages_per_tick and bytes_per_tick counters report what is written to
+// the gRPC stream, bytes including the 5-byte gRPC message framing.
+
+#include <string>
+
+#include "benchmark/benchmark.h"
+#include "stratum/glue/logging.h"
+#include "stratum/hal/lib/common/gnmi_notification_aggregator.h"
+
+namespace stratum {
+namespace hal {
+namespace {
+
+constexpr int kNumPorts = 128;
+constexpr const char* kCounterLeaves[] = {
+    "in-octets",         "out-octets",        "in-discards",
+    "in-unicast-pkts",   "in-multicast-pkts", "in-broadcast-pkts",
+    "in-errors",         "in-unknown-protos", "in-fcs-errors",
+    "out-discards",      "out-unicast-pkts",  "out-multicast-pkts",
+    "out-broadcast-pkts", "out-errors",
+};
+// Size of the gRPC length-prefixed message header.
+constexpr int kGrpcFrameBytes = 5;
+
+// A GnmiSubscribeStream counting the messages and bytes written to it. Like
+// gRPC, it serializes every message written.
+class CountingStream : public GnmiSubscribeStream {
+ public:
+  CountingStream() : num_messages_(0), num_bytes_(0) {}
+
+  bool Write(const ::gnmi::SubscribeResponse& msg,
+             ::grpc::WriteOptions options) override {
+    if (!msg.SerializeToString(&buffer_)) return false;
+    ++num_messages_;
+    num_bytes_ += buffer_.size() + kGrpcFrameBytes;
+    return true;
+  }
+  void SendInitialMetadata() override {}
+  bool NextMessageSize(uint32_t* sz) override { return false; }
+  bool Read(::gnmi::SubscribeRequest* msg) override { return false; }
+
+  int64 num_messages() const { return num_messages_; }
+  int64 num_bytes() const { return num_bytes_; }
+
+ private:
+  std::string buffer_;
+  int64 num_messages_;
+  int64 num_bytes_;
+};
+
+// Returns the response sent for one counter leaf, as built by SendResponse()
+// in yang_parse_tree_paths.cc.
+::gnmi::SubscribeResponse CounterResponse(int port, const char* leaf,
+                                          int64 timestamp) {
+  ::gnmi::SubscribeResponse resp;
+  auto* notification = resp.mutable_update();
+  notification->set_timestamp(timestamp);
+  auto* update = notification->add_update();
+  auto* path = update->mutable_path();
+  path->add_elem()->set_name("interfaces");
+  auto* elem = path->add_elem();
+  elem->set_name("interface");
+  (*elem->mutable_key())["name"] = "1/" + std::to_string(port) + "/1";
+  path->add_elem()->set_name("state");
+  path->add_elem()->set_name("counters");
+  path->add_elem()->set_name(leaf);
+  update->mutable_val()->set_uint_val(1234567890ULL * port);
+  return resp;
+}
+
+void BM_SampleInterfaceCounters(benchmark::State& state) {
+  CountingStream stream;
+  int64 timestamp = 1;
+  int64 num_ticks = 0;
+  for (auto _ : state) {
+    AggregatingGnmiSubscribeStream aggregator(&stream, state.range(0));
+    for (int port = 1; port <= kNumPorts; ++port) {
+      for (const char* leaf : kCounterLeaves) {
+        CHECK(aggregator.Write(CounterResponse(port, leaf, timestamp++),
+                               ::grpc::WriteOptions()));
+      }
+    }
+    CHECK(aggregator.Flush().ok());
+    ++num_ticks;
+  }
+  state.counters["messages_per_tick"] =
+      static_cast<double>(stream.num_messages()) / num_ticks;
+  state.counters["bytes_per_tick"] =
+      static_cast<double>(stream.num_bytes()) / num_ticks;
+}
+BENCHMARK(BM_SampleInterfaceCounters)
+    ->Arg(0)
+    ->Arg(16 * 1024)
+    ->Arg(256 * 1024)
+    ->Unit(benchmark::kMicrosecond);
+
+}  // namespace
+}  // namespace hal
+}  // namespace stratum
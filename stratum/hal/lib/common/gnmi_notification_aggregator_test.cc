@@ -0,0 +1,190 @@
+// Copyright 2018-present Open Networking Foundation
+// SPDX-License-Identifier: Apache-2.0
+
+#include "stratum/hal/lib/common/gnmi_notification_aggregator.h"
+
+#include <string>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "google/protobuf/text_format.h"
+#include "gtest/gtest.h"
+#include "stratum/glue/status/status_test_util.h"
+#include "stratum/hal/lib/common/subscribe_reader_writer_mock.h"
+#include "stratum/lib/test_utils/matchers.h"
+
+namespace stratum {
+namespace hal {
+
+using test_utils::EqualsProto;
+using ::testing::_;
+using ::testing::Invoke;
+using ::testing::Return;
+
+class AggregatingGnmiSubscribeStreamTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    EXPECT_CALL(stream_, Write(_, _))
+        .WillRepeatedly(Invoke([this](const ::gnmi::SubscribeResponse& resp,
+                                      ::grpc::WriteOptions options) {
+          written_.push_back(resp);
+          return true;
+        }));
+  }
+
+  // Returns a response with one update of the counter leaf 'leaf' of
+  // interface 'name'.
+  static ::gnmi::SubscribeResponse CounterUpdate(const std::string& name,
+                                                 const std::string& leaf,
+                                                 uint64 value,
+                                                 int64 timestamp) {
+    ::gnmi::SubscribeResponse resp;
+    auto* notification = resp.mutable_update();
+    notification->set_timestamp(timestamp);
+    auto* update = notification->add_update();
+    auto* path = update->mutable_path();
+    path->add_elem()->set_name("interfaces");
+    auto* elem = path->add_elem();
+    elem->set_name("interface");
+    (*elem->mutable_key())["name"] = name;
+    path->add_elem()->set_name("state");
+    path->add_elem()->set_name("counters");
+    path->add_elem()->set_name(leaf);
+    update->mutable_val()->set_uint_val(value);
+    return resp;
+  }
+
+  static ::gnmi::SubscribeResponse ParseResponse(const std::string& text) {
+    ::gnmi::SubscribeResponse resp;
+    EXPECT_TRUE(::google::protobuf::TextFormat::ParseFromString(text, &resp));
+    return resp;
+  }
+
+  SubscribeReaderWriterMock stream_;
+  std::vector<::gnmi::SubscribeResponse> written_;
+};
+
+TEST_F(AggregatingGnmiSubscribeStreamTest, MergesUpdatesUnderCommonPrefix) {
+  AggregatingGnmiSubscribeStream aggregator(&stream_, 1024 * 1024);
+  ASSERT_TRUE(aggregator.Write(CounterUpdate("1/1", "in-octets", 10, 100),
+                               ::grpc::WriteOptions()));
+  ASSERT_TRUE(aggregator.Write(CounterUpdate("1/1", "out-octets", 20, 101),
+                               ::grpc::WriteOptions()));
+  ASSERT_TRUE(aggregator.Write(CounterUpdate("1/2", "in-octets", 30, 102),
+                               ::grpc::WriteOptions()));
+  EXPECT_TRUE(written_.empty());
+  ASSERT_OK(aggregator.Flush());
+
+  ASSERT_EQ(1U, written_.size());
+  EXPECT_EQ(1, aggregator.NumMessagesWritten());
+  EXPECT_THAT(written_[0], EqualsProto(ParseResponse(R"PROTO(
+    update {
+      timestamp: 100
+      prefix { elem { name: "interfaces" } }
+      update {
+        path {
+          elem { name: "interface" key { key: "name" value: "1/1" } }
+          elem { name: "state" }
+          elem { name: "counters" }
+          elem { name: "in-octets" }
+        }
+        val { uint_val: 10 }
+      }
+      update {
+        path {
+          elem { name: "interface" key { key: "name" value: "1/1" } }
+          elem { name: "state" }
+          elem { name: "counters" }
+          elem { name: "out-octets" }
+        }
+        val { uint_val: 20 }
+      }
+      update {
+        path {
+          elem { name: "interface" key { key: "name" value: "1/2" } }
+          elem { name: "state" }
+          elem { name: "counters" }
+          elem { name: "in-octets" }
+        }
+        val { uint_val: 30 }
+      }
+    }
+  )PROTO")));
+
+  // Nothing left to write.
+  ASSERT_OK(aggregator.Flush());
+  EXPECT_EQ(1U, written_.size());
+}
+
+TEST_F(AggregatingGnmiSubscribeStreamTest, SingleResponseIsWrittenUnchanged) {
+  AggregatingGnmiSubscribeStream aggregator(&stream_, 1024 * 1024);
+  const auto resp = CounterUpdate("1/1", "in-octets", 10, 100);
+  ASSERT_TRUE(aggregator.Write(resp, ::grpc::WriteOptions()));
+  ASSERT_OK(aggregator.Flush());
+
+  ASSERT_EQ(1U, written_.size());
+  EXPECT_THAT(written_[0], EqualsProto(resp));
+}
+
+TEST_F(AggregatingGnmiSubscribeStreamTest, SplitsAtSizeLimit) {
+  const auto resp = CounterUpdate("1/1", "in-octets", 10, 100);
+  const int64 size = resp.update().ByteSizeLong();
+  // Room for two updates per notification.
+  AggregatingGnmiSubscribeStream aggregator(&stream_, 2 * size + 1);
+  for (int i = 0; i < 5; ++i) {
+    ASSERT_TRUE(aggregator.Write(resp, ::grpc::WriteOptions()));
+  }
+  EXPECT_EQ(2U, written_.size());
+  ASSERT_OK(aggregator.Flush());
+
+  ASSERT_EQ(3U, written_.size());
+  EXPECT_EQ(2, written_[0].update().update_size());
+  EXPECT_EQ(2, written_[1].update().update_size());
+  EXPECT_EQ(1, written_[2].update().update_size());
+  for (const auto& written : written_) {
+    EXPECT_LE(written.ByteSizeLong(), 2 * size + 1 + 8);  // 8: framing.
+  }
+}
+
+TEST_F(AggregatingGnmiSubscribeStreamTest, KeepsOrderOfUnmergeableResponses) {
+  AggregatingGnmiSubscribeStream aggregator(&stream_, 1024 * 1024);
+  ::gnmi::SubscribeResponse sync;
+  sync.set_sync_response(true);
+  ASSERT_TRUE(aggregator.Write(CounterUpdate("1/1", "in-octets", 10, 100),
+                               ::grpc::WriteOptions()));
+  ASSERT_TRUE(aggregator.Write(CounterUpdate("1/1", "out-octets", 20, 100),
+                               ::grpc::WriteOptions()));
+  ASSERT_TRUE(aggregator.Write(sync, ::grpc::WriteOptions()));
+  ASSERT_TRUE(aggregator.Write(CounterUpdate("1/2", "in-octets", 30, 100),
+                               ::grpc::WriteOptions()));
+  ASSERT_OK(aggregator.Flush());
+
+  ASSERT_EQ(3U, written_.size());
+  EXPECT_EQ(2, written_[0].update().update_size());
+  EXPECT_TRUE(written_[1].sync_response());
+  EXPECT_EQ(1, written_[2].update().update_size());
+}
+
+TEST_F(AggregatingGnmiSubscribeStreamTest, ZeroLimitWritesEveryResponse) {
+  AggregatingGnmiSubscribeStream aggregator(&stream_, 0);
+  const auto resp = CounterUpdate("1/1", "in-octets", 10, 100);
+  ASSERT_TRUE(aggregator.Write(resp, ::grpc::WriteOptions()));
+  ASSERT_TRUE(aggregator.Write(resp, ::grpc::WriteOptions()));
+  ASSERT_OK(aggregator.Flush());
+
+  ASSERT_EQ(2U, written_.size());
+  EXPECT_THAT(written_[0], EqualsProto(resp));
+  EXPECT_THAT(written_[1], EqualsProto(resp));
+}
+
+TEST_F(AggregatingGnmiSubscribeStreamTest, FlushFailsIfStreamWriteFails) {
+  EXPECT_CALL(stream_, Write(_, _)).WillOnce(Return(false));
+  AggregatingGnmiSubscribeStream aggregator(&stream_, 1024 * 1024);
+  ASSERT_TRUE(aggregator.Write(CounterUpdate("1/1", "in-octets", 10, 100),
+                               ::grpc::WriteOptions()));
+  EXPECT_FALSE(aggregator.Flush().ok());
+  EXPECT_EQ(0, aggregator.NumMessagesWritten());
+}
+
+}  // namespace hal
+}  // namespace stratum
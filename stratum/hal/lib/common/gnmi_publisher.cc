@@ -8,18 +8,34 @@
 #include <string>
 #include <utility>
 
+#include "absl/memory/memory.h"
 #include "absl/synchronization/mutex.h"
+#include "absl/time/time.h"
+#include "gflags/gflags.h"
 #include "gnmi/gnmi.pb.h"
+#include "stratum/glue/gtl/cleanup.h"
 #include "stratum/glue/gtl/map_util.h"
 #include "stratum/hal/lib/common/channel_writer_wrapper.h"
+#include "stratum/hal/lib/common/gnmi_notification_aggregator.h"
+#include "stratum/hal/lib/common/gnmi_redundant_update_filter.h"
+#include "stratum/hal/lib/common/retrieve_value_batch.h"
 #include "stratum/hal/lib/common/yang_parse_tree_paths.h"
 
+DEFINE_int32(gnmi_get_retrieve_threads, 4,
+             "Number of threads reading the values of the nodes in parallel "
+             "for a gNMI Get. If 0, the nodes are read one after the other.");
+
 namespace stratum {
 namespace hal {
 
 GnmiPublisher::GnmiPublisher(SwitchInterface* switch_interface)
     : switch_interface_(ABSL_DIE_IF_NULL(switch_interface)),
       parse_tree_(ABSL_DIE_IF_NULL(switch_interface)),
+      retrieve_pool_(FLAGS_gnmi_get_retrieve_threads > 0
+                         ? absl::make_unique<ThreadPool>(
+                               FLAGS_gnmi_get_retrieve_threads)
+                         : nullptr),
+      redundant_update_stats_(std::make_shared<RedundantUpdateStats>()),
       event_channel_(nullptr),
       on_config_pushed_(
           new EventHandlerRecord(on_config_pushed_func_, nullptr)) {
@@ -98,7 +114,11 @@ GnmiPublisher::~GnmiPublisher() {}
   // In order to reference a weak pointer, first it has to be used to create a
   // shared pointer.
   if (std::shared_ptr<EventHandlerRecord> handler = h.lock()) {
-    RETURN_IF_ERROR((*handler)(event));
+    // All the leaves handled for this event are sent in as few notifications
+    // as possible, rather than one message per leaf.
+    AggregatingGnmiSubscribeStream stream(handler->stream());
+    RETURN_IF_ERROR((*handler)(event, &stream));
+    RETURN_IF_ERROR(stream.Flush());
   }
   return ::util::OkStatus();
 }
@@ -109,6 +129,38 @@ GnmiPublisher::~GnmiPublisher() {}
   return (*handle)(PollEvent());
 }
 
+::util::Status GnmiPublisher::HandleBatchedPoll(
+    const std::vector<SubscriptionHandle>& handles) {
+  if (handles.empty()) return ::util::OkStatus();
+  absl::WriterMutexLock l(&access_lock_);
+  if (switch_interface_ == nullptr) {
+    return MAKE_ERROR(ERR_INTERNAL) << "No switch interface.";
+  }
+
+  RetrieveValueBatch batch(switch_interface_, retrieve_pool_.get());
+  parse_tree_.SetRetrieveValueBatch(&batch);
+  auto cleanup = gtl::MakeCleanup([this]() EXCLUSIVE_LOCKS_REQUIRED(
+                                      access_lock_) {
+    parse_tree_.SetRetrieveValueBatch(nullptr);
+  });
+  // First pass: the values needed by the leaves are recorded and what the
+  // leaves write is discarded.
+  InlineGnmiSubscribeStream discard(
+      [](const ::gnmi::SubscribeResponse& resp) { return true; });
+  for (const auto& handle : handles) {
+    RETURN_IF_ERROR((*handle)(PollEvent(), &discard));
+  }
+  batch.Retrieve();
+  // Second pass: the leaves write the retrieved values to their streams.
+  for (const auto& handle : handles) {
+    RETURN_IF_ERROR((*handle)(PollEvent()));
+  }
+  VLOG(1) << "Polled " << handles.size() << " subscriptions with "
+          << batch.NumSwitchCalls() << " RetrieveValue() calls.";
+
+  return ::util::OkStatus();
+}
+
 ::util::Status GnmiPublisher::SubscribePeriodic(const Frequency& freq,
                                                 const ::gnmi::Path& path,
                                                 GnmiSubscribeStream* stream,
@@ -118,6 +170,12 @@ GnmiPublisher::~GnmiPublisher() {}
   if (status != ::util::OkStatus()) {
     return status;
   }
+  if (freq.suppress_redundant_) {
+    (*h)->WrapStream(absl::make_unique<SuppressingGnmiSubscribeStream>(
+        stream, freq.heartbeat_ms_ > 0 ? absl::Milliseconds(freq.heartbeat_ms_)
+                                       : absl::InfiniteDuration(),
+        redundant_update_stats_));
+  }
   EventHandlerRecordPtr weak(*h);
   if (TimerDaemon::RequestPeriodicTimer(
           freq.delay_ms_, freq.period_ms_,
@@ -13,6 +13,7 @@
 #include <string>
 #include <algorithm>
 #include <map>
+#include <vector>
 
 #include "gnmi/gnmi.grpc.pb.h"
 // FIXME(boc) is this required?
@@ -20,7 +21,9 @@
 #include "stratum/glue/status/status.h"
 #include "stratum/glue/status/status_macros.h"
 #include "stratum/hal/lib/common/gnmi_events.h"
+#include "stratum/hal/lib/common/gnmi_redundant_update_filter.h"
 #include "stratum/hal/lib/common/yang_parse_tree.h"
+#include "stratum/lib/thread_pool.h"
 #include "stratum/lib/timer_daemon.h"
 #include "stratum/public/lib/error.h"
 #include "absl/synchronization/mutex.h"
@@ -40,29 +43,35 @@ class Frequency {
   uint64 delay_ms_;
   uint64 period_ms_;
   uint64 heartbeat_ms_;
+  // If true, only the leaves whose value changed are reported, and the others
+  // once every 'heartbeat_ms_' milliseconds (never if 0).
+  bool suppress_redundant_;
 
  protected:
-  Frequency(uint64 delay_ms, uint64 period_ms, uint64 heartbeat_ms)
+  Frequency(uint64 delay_ms, uint64 period_ms, uint64 heartbeat_ms,
+            bool suppress_redundant)
       : delay_ms_(delay_ms),
         period_ms_(period_ms),
-        heartbeat_ms_(heartbeat_ms) {}
+        heartbeat_ms_(heartbeat_ms),
+        suppress_redundant_(suppress_redundant) {}
 };
 
 // Specialization of the Frequency container to be used by subscriptions that
 // require updates every 'period_ms' milliseconds.
 class Periodic : public Frequency {
  public:
-  explicit Periodic(uint64 period_ms) : Frequency(0, period_ms, 0) {}
+  explicit Periodic(uint64 period_ms) : Frequency(0, period_ms, 0, false) {}
 };
 
 // Specialization of the Frequency container to be used by subscriptions that
 // require updates every 'period_ms' milliseconds. The current state is _only_
 // reported if there is change in the value of the node unless since last update
-// 'heartbeat_ms' milliseconds have elapsed.
+// 'heartbeat_ms' milliseconds have elapsed. A 'heartbeat_ms' of 0 reports only
+// the changes.
 class PeriodicWithHeartbeat : public Frequency {
  public:
   PeriodicWithHeartbeat(uint64 period_ms, uint64 heartbeat_ms)
-      : Frequency(0, period_ms, heartbeat_ms) {}
+      : Frequency(0, period_ms, heartbeat_ms, true) {}
 };
 
 // The main class responsible for handling all aspects of gNMI subscriptions and
@@ -100,6 +109,13 @@ class GnmiPublisher {
   virtual ::util::Status HandlePoll(const SubscriptionHandle& handle)
       LOCKS_EXCLUDED(access_lock_);
 
+  // Polls all the subscriptions in 'handles', in order, as one request: the
+  // values they need are retrieved from the switch in one RetrieveValue() call
+  // per node, the nodes being read in parallel. Stops at the first error.
+  virtual ::util::Status HandleBatchedPoll(
+      const std::vector<SubscriptionHandle>& handles)
+      LOCKS_EXCLUDED(access_lock_);
+
   virtual ::util::Status SubscribePeriodic(const Frequency& freq,
                                            const ::gnmi::Path& path,
                                            GnmiSubscribeStream* stream,
@@ -140,6 +156,12 @@ class GnmiPublisher {
   // the switch and cleaning-up.
   virtual ::util::Status UnregisterEventWriter() LOCKS_EXCLUDED(access_lock_);
 
+  // Returns the counters of the updates suppressed by all the subscriptions
+  // with suppress_redundant.
+  const RedundantUpdateStats& redundant_update_stats() const {
+    return *redundant_update_stats_;
+  }
+
  private:
   // ReaderArgs encapsulates the arguments for a Channel reader thread.
   template <typename T>
@@ -190,6 +212,14 @@ class GnmiPublisher {
   // that node.
   YangParseTree parse_tree_ GUARDED_BY(access_lock_);
 
+  // The threads reading the nodes in parallel in HandleBatchedPoll(), or
+  // nullptr if they are read one after the other.
+  std::unique_ptr<ThreadPool> retrieve_pool_;
+
+  // The counters shared by the SuppressingGnmiSubscribeStreams of the
+  // subscriptions with suppress_redundant.
+  const std::shared_ptr<RedundantUpdateStats> redundant_update_stats_;
+
   // Channel for receiving transceiver events from the SwitchInterface.
   std::shared_ptr<Channel<GnmiEventPtr>> event_channel_
       GUARDED_BY(access_lock_);
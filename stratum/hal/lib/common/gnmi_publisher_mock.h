@@ -5,6 +5,8 @@
 #ifndef STRATUM_HAL_LIB_COMMON_GNMI_PUBLISHER_MOCK_H_
 #define STRATUM_HAL_LIB_COMMON_GNMI_PUBLISHER_MOCK_H_
 
+#include <vector>
+
 #include "stratum/hal/lib/common/gnmi_publisher.h"
 #include "stratum/hal/lib/common/switch_mock.h"
 #include "gmock/gmock.h"
@@ -30,6 +32,9 @@ class GnmiPublisherMock : public GnmiPublisher {
 
   MOCK_METHOD1(HandlePoll, ::util::Status(const SubscriptionHandle &));
 
+  MOCK_METHOD1(HandleBatchedPoll,
+               ::util::Status(const std::vector<SubscriptionHandle> &));
+
   MOCK_METHOD2(UpdateSubscriptionWithTargetSpecificModeSpecification,
                ::util::Status(const ::gnmi::Path &path,
                               ::gnmi::Subscription *subscription));
@@ -5,6 +5,9 @@
 
 #include "stratum/hal/lib/common/gnmi_publisher.h"
 
+#include <string>
+#include <vector>
+
 #include "gnmi/gnmi.pb.h"
 #include "stratum/glue/status/status_test_util.h"
 #include "stratum/hal/lib/common/subscribe_reader_writer_mock.h"
@@ -234,6 +237,82 @@ TEST_F(SubscriptionTest, HandleTimer) {
   EXPECT_OK(gnmi_publisher_->HandleChange(TimerEvent()));
 }
 
+TEST_F(SubscriptionTest, HandleTimerSuppressesRedundantUpdates) {
+  SubscribeReaderWriterMock stream;
+  SubscriptionHandle h;
+  ::gnmi::Path path =
+      GetPath("interfaces")("interface", "device1.domain.net.com:ce-1/1")(
+          "state")("admin-status")();
+  // No heartbeat: only the changes are sent.
+  EXPECT_OK(gnmi_publisher_->SubscribePeriodic(
+      PeriodicWithHeartbeat(1000, 0), path, &stream, &h));
+
+  // The admin status is enabled twice, then disabled.
+  AdminState state = ADMIN_STATE_ENABLED;
+  EXPECT_CALL(switch_mock_, RetrieveValue(_, _, _, _))
+      .WillRepeatedly(
+          WithArgs<2>(Invoke([&state](WriterInterface<DataResponse>* w) {
+            DataResponse resp;
+            resp.mutable_admin_status()->set_state(state);
+            w->Write(resp);
+            return ::util::OkStatus();
+          })));
+  std::vector<std::string> values;
+  EXPECT_CALL(stream, Write(_, _))
+      .WillRepeatedly(
+          WithArgs<0>(Invoke([&values](const ::gnmi::SubscribeResponse& resp) {
+            values.push_back(resp.update().update(0).val().string_val());
+            return true;
+          })));
+
+  EXPECT_OK(gnmi_publisher_->HandleChange(TimerEvent()));
+  EXPECT_OK(gnmi_publisher_->HandleChange(TimerEvent()));
+  state = ADMIN_STATE_DISABLED;
+  EXPECT_OK(gnmi_publisher_->HandleChange(TimerEvent()));
+  EXPECT_THAT(values, ::testing::ElementsAre("UP", "DOWN"));
+  EXPECT_EQ(1, gnmi_publisher_->redundant_update_stats().NumSuppressed());
+}
+
+TEST_F(SubscriptionTest, HandleBatchedPoll) {
+  SubscribeReaderWriterMock stream;
+  std::vector<SubscriptionHandle> handles;
+  for (const char* name :
+       {"device1.domain.net.com:ce-1/1", "device1.domain.net.com:ce-1/2"}) {
+    SubscriptionHandle h;
+    EXPECT_OK(gnmi_publisher_->SubscribePoll(
+        GetPath("interfaces")("interface", name)("state")("admin-status")(),
+        &stream, &h));
+    handles.push_back(h);
+  }
+
+  // The values of both ports are retrieved in one call.
+  EXPECT_CALL(switch_mock_, RetrieveValue(1, _, _, _))
+      .WillOnce(Invoke([](uint64 node_id, const DataRequest& req,
+                          WriterInterface<DataResponse>* w,
+                          std::vector<::util::Status>* details) {
+        EXPECT_EQ(2, req.requests_size());
+        for (const auto& request : req.requests()) {
+          DataResponse resp;
+          resp.mutable_admin_status()->set_state(
+              request.admin_status().port_id() == 1 ? ADMIN_STATE_ENABLED
+                                                     : ADMIN_STATE_DISABLED);
+          w->Write(resp);
+          if (details) details->push_back(::util::OkStatus());
+        }
+        return ::util::OkStatus();
+      }));
+  std::vector<std::string> values;
+  EXPECT_CALL(stream, Write(_, _))
+      .WillRepeatedly(
+          WithArgs<0>(Invoke([&values](const ::gnmi::SubscribeResponse& resp) {
+            values.push_back(resp.update().update(0).val().string_val());
+            return true;
+          })));
+
+  EXPECT_OK(gnmi_publisher_->HandleBatchedPoll(handles));
+  EXPECT_THAT(values, ::testing::ElementsAre("UP", "DOWN"));
+}
+
 TEST_F(SubscriptionTest, OnUpdateUnSupportedPath) {
   // Configure the device - the model will reconfigure itself to reflect the
   // configuration.
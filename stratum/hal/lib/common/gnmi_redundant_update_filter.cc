@@ -0,0 +1,188 @@
+// Copyright 2018-present Open Networking Foundation
+// SPDX-License-Identifier: Apache-2.0
+
+#include "stratum/hal/lib/common/gnmi_redundant_update_filter.h"
+
+#include <algorithm>
+#include <functional>
+#include <utility>
+#include <vector>
+
+#include "absl/strings/str_cat.h"
+#include "absl/time/clock.h"
+#include "gflags/gflags.h"
+#include "stratum/glue/logging.h"
+
+DEFINE_int32(gnmi_redundant_update_stats_log_interval_s, 600,
+             "Interval in seconds at which the number of updates suppressed "
+             "by the gNMI subscriptions with suppress_redundant is logged. 0 "
+             "disables the logs.");
+
+namespace stratum {
+namespace hal {
+
+namespace {
+
+// Appends the elements of 'path' to 'key', with their keys in name order.
+void AppendPathKey(const ::gnmi::Path& path, std::string* key) {
+  for (const auto& elem : path.elem()) {
+    absl::StrAppend(key, "/", elem.name());
+    if (elem.key().empty()) continue;
+    std::vector<std::pair<std::string, std::string>> keys(elem.key().begin(),
+                                                          elem.key().end());
+    std::sort(keys.begin(), keys.end());
+    for (const auto& entry : keys) {
+      absl::StrAppend(key, "[", entry.first, "=", entry.second, "]");
+    }
+  }
+}
+
+// Returns the hash of the value of 'update'.
+size_t ValueHash(const ::gnmi::Update& update) {
+  return std::hash<std::string>()(update.val().SerializeAsString());
+}
+
+}  // namespace
+
+RedundantUpdateStats::RedundantUpdateStats()
+    : num_suppressed_(0), num_heartbeats_(0), log_time_(absl::Now()) {}
+
+void RedundantUpdateStats::Add(int64 num_suppressed, int64 num_heartbeats) {
+  const absl::Time now = absl::Now();
+  absl::MutexLock l(&lock_);
+  num_suppressed_ += num_suppressed;
+  num_heartbeats_ += num_heartbeats;
+  if (FLAGS_gnmi_redundant_update_stats_log_interval_s <= 0 ||
+      now - log_time_ <
+          absl::Seconds(FLAGS_gnmi_redundant_update_stats_log_interval_s)) {
+    return;
+  }
+  log_time_ = now;
+  LOG(INFO) << "gNMI suppress_redundant subscriptions: suppressed "
+            << num_suppressed_ << " redundant updates, sent "
+            << num_heartbeats_ << " unchanged updates on heartbeat.";
+}
+
+int64 RedundantUpdateStats::NumSuppressed() const {
+  absl::MutexLock l(&lock_);
+  return num_suppressed_;
+}
+
+int64 RedundantUpdateStats::NumHeartbeats() const {
+  absl::MutexLock l(&lock_);
+  return num_heartbeats_;
+}
+
+SuppressingGnmiSubscribeStream::SuppressingGnmiSubscribeStream(
+    GnmiSubscribeStream* stream, absl::Duration heartbeat,
+    std::shared_ptr<RedundantUpdateStats> stats)
+    : stream_(stream),
+      queue_(dynamic_cast<QueuedGnmiSubscribeStream*>(stream)),
+      heartbeat_(heartbeat),
+      stats_(std::move(stats)),
+      state_(std::make_shared<State>()) {}
+
+SuppressingGnmiSubscribeStream::~SuppressingGnmiSubscribeStream() {
+  VLOG(1) << "Suppressed " << NumSuppressed() << " redundant updates, sent "
+          << NumHeartbeats() << " unchanged updates on heartbeat.";
+}
+
+bool SuppressingGnmiSubscribeStream::Write(
+    const ::gnmi::SubscribeResponse& msg, ::grpc::WriteOptions options) {
+  if (!msg.has_update() || msg.update().update_size() == 0) {
+    return stream_->Write(msg, options);
+  }
+
+  const ::gnmi::Notification& notification = msg.update();
+  std::string prefix_key;
+  AppendPathKey(notification.prefix(), &prefix_key);
+  const absl::Time now = absl::Now();
+  // The indices of the updates to send.
+  std::vector<int> kept;
+  int64 num_suppressed = 0;
+  int64 num_heartbeats = 0;
+  {
+    absl::MutexLock l(&state_->lock);
+    for (int i = 0; i < notification.update_size(); ++i) {
+      const auto& update = notification.update(i);
+      std::string key = prefix_key;
+      AppendPathKey(update.path(), &key);
+      const size_t value_hash = ValueHash(update);
+      LeafState& leaf = state_->leaves[key];
+      if (leaf.sent_time != absl::InfinitePast() &&
+          leaf.value_hash == value_hash) {
+        if (now - leaf.sent_time < heartbeat_) {
+          ++num_suppressed;
+          continue;
+        }
+        ++num_heartbeats;
+      }
+      leaf.value_hash = value_hash;
+      leaf.sent_time = now;
+      kept.push_back(i);
+    }
+    state_->num_suppressed += num_suppressed;
+    state_->num_heartbeats += num_heartbeats;
+  }
+  if (stats_ != nullptr && (num_suppressed > 0 || num_heartbeats > 0)) {
+    stats_->Add(num_suppressed, num_heartbeats);
+  }
+  if (kept.size() == static_cast<size_t>(notification.update_size())) {
+    return WriteToStream(msg, options);
+  }
+  if (kept.empty() && notification.delete__size() == 0) return true;
+
+  ::gnmi::SubscribeResponse filtered = msg;
+  auto* updates = filtered.mutable_update()->mutable_update();
+  for (size_t i = 0; i < kept.size(); ++i) {
+    if (static_cast<int>(i) != kept[i]) updates->SwapElements(i, kept[i]);
+  }
+  updates->DeleteSubrange(kept.size(), updates->size() - kept.size());
+
+  return WriteToStream(filtered, options);
+}
+
+bool SuppressingGnmiSubscribeStream::WriteToStream(
+    const ::gnmi::SubscribeResponse& msg, ::grpc::WriteOptions options) {
+  if (queue_ == nullptr) return stream_->Write(msg, options);
+  std::weak_ptr<State> weak_state(state_);
+  return queue_->Write(msg, options,
+                       [weak_state](const ::gnmi::SubscribeResponse& dropped) {
+                         ForgetDroppedLeaves(weak_state, dropped);
+                       });
+}
+
+void SuppressingGnmiSubscribeStream::ForgetDroppedLeaves(
+    const std::weak_ptr<State>& weak_state,
+    const ::gnmi::SubscribeResponse& msg) {
+  auto state = weak_state.lock();
+  if (state == nullptr) return;
+
+  const ::gnmi::Notification& notification = msg.update();
+  std::string prefix_key;
+  AppendPathKey(notification.prefix(), &prefix_key);
+  absl::MutexLock l(&state->lock);
+  for (const auto& update : notification.update()) {
+    std::string key = prefix_key;
+    AppendPathKey(update.path(), &key);
+    auto it = state->leaves.find(key);
+    // A newer value of the leaf may have been written since.
+    if (it != state->leaves.end() &&
+        it->second.value_hash == ValueHash(update)) {
+      state->leaves.erase(it);
+    }
+  }
+}
+
+int64 SuppressingGnmiSubscribeStream::NumSuppressed() const {
+  absl::MutexLock l(&state_->lock);
+  return state_->num_suppressed;
+}
+
+int64 SuppressingGnmiSubscribeStream::NumHeartbeats() const {
+  absl::MutexLock l(&state_->lock);
+  return state_->num_heartbeats;
+}
+
+}  // namespace hal
+}  // namespace stratum
@@ -0,0 +1,142 @@
+// Copyright 2018-present Open Networking Foundation
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef STRATUM_HAL_LIB_COMMON_GNMI_REDUNDANT_UPDATE_FILTER_H_
+#define STRATUM_HAL_LIB_COMMON_GNMI_REDUNDANT_UPDATE_FILTER_H_
+
+#include <memory>
+#include <string>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/time.h"
+#include "gnmi/gnmi.grpc.pb.h"
+#include "stratum/glue/integral_types.h"
+#include "stratum/hal/lib/common/gnmi_events.h"
+#include "stratum/hal/lib/common/gnmi_subscriber_queue.h"
+
+namespace stratum {
+namespace hal {
+
+// Counters of the updates suppressed by the SuppressingGnmiSubscribeStreams of
+// all the subscriptions of a GnmiPublisher. They are logged every
+// FLAGS_gnmi_redundant_update_stats_log_interval_s while updates are
+// suppressed. The class is thread-safe.
+class RedundantUpdateStats {
+ public:
+  RedundantUpdateStats();
+  ~RedundantUpdateStats() {}
+
+  // Adds the updates suppressed and sent on heartbeat by one write.
+  void Add(int64 num_suppressed, int64 num_heartbeats) LOCKS_EXCLUDED(lock_);
+
+  // Number of updates removed because their value had already been sent.
+  int64 NumSuppressed() const LOCKS_EXCLUDED(lock_);
+  // Number of updates sent again, unchanged, because the heartbeat elapsed.
+  int64 NumHeartbeats() const LOCKS_EXCLUDED(lock_);
+
+  // RedundantUpdateStats is neither copyable nor movable.
+  RedundantUpdateStats(const RedundantUpdateStats&) = delete;
+  RedundantUpdateStats& operator=(const RedundantUpdateStats&) = delete;
+
+ private:
+  mutable absl::Mutex lock_;
+  int64 num_suppressed_ GUARDED_BY(lock_);
+  int64 num_heartbeats_ GUARDED_BY(lock_);
+  // The last time the counters were logged.
+  absl::Time log_time_ GUARDED_BY(lock_);
+};
+
+// A GnmiSubscribeStream implementing the suppress_redundant option of the
+// SAMPLE subscriptions. It remembers a hash of the last value written for
+// every leaf and removes from the notifications written to it the updates
+// which carry the same value again, unless the leaf has not been written for
+// 'heartbeat'. A notification left with neither update nor delete is not
+// written at all. The leaves are identified by the path elements of the
+// prefix and of the update, so the updates may be aggregated or not.
+//
+// The other messages (sync_response, error) are written as is. An infinite
+// 'heartbeat' resends a leaf only when its value changes.
+//
+// A value is taken as sent once it is written to the wrapped stream. When that
+// stream is a QueuedGnmiSubscribeStream, the leaves of the notifications it
+// drops are forgotten, so that their next value is sent even if unchanged.
+//
+// One instance is kept for the whole life of a subscription. Its counters are
+// also added to 'stats', if given, which is shared by all the subscriptions of
+// a GnmiPublisher. The class is thread-safe. Reading is left to the wrapped
+// stream.
+class SuppressingGnmiSubscribeStream : public GnmiSubscribeStream {
+ public:
+  SuppressingGnmiSubscribeStream(
+      GnmiSubscribeStream* stream, absl::Duration heartbeat,
+      std::shared_ptr<RedundantUpdateStats> stats = nullptr);
+  ~SuppressingGnmiSubscribeStream() override;
+
+  // Writes 'msg' without its redundant updates. Returns false if writing to
+  // the wrapped stream failed.
+  bool Write(const ::gnmi::SubscribeResponse& msg,
+             ::grpc::WriteOptions options) override;
+
+  // Number of updates removed because their value had already been sent.
+  int64 NumSuppressed() const;
+  // Number of updates sent again, unchanged, because the heartbeat elapsed.
+  int64 NumHeartbeats() const;
+
+  // SuppressingGnmiSubscribeStream is neither copyable nor movable.
+  SuppressingGnmiSubscribeStream(const SuppressingGnmiSubscribeStream&) =
+      delete;
+  SuppressingGnmiSubscribeStream& operator=(
+      const SuppressingGnmiSubscribeStream&) = delete;
+
+ private:
+  // The last value sent for a leaf.
+  struct LeafState {
+    size_t value_hash = 0;
+    // absl::InfinitePast() until the leaf is first sent.
+    absl::Time sent_time = absl::InfinitePast();
+  };
+
+  void SendInitialMetadata() override { stream_->SendInitialMetadata(); }
+  bool NextMessageSize(uint32_t* sz) override {
+    return stream_->NextMessageSize(sz);
+  }
+  bool Read(::gnmi::SubscribeRequest* msg) override {
+    return stream_->Read(msg);
+  }
+
+  // The state of the filter. It is shared with the callbacks of the
+  // notifications queued in 'queue_', which may be dropped after the filter is
+  // gone.
+  struct State {
+    mutable absl::Mutex lock;
+    // Map from the key of a leaf, built from its path, to its last sent value.
+    absl::flat_hash_map<std::string, LeafState> leaves GUARDED_BY(lock);
+    int64 num_suppressed GUARDED_BY(lock) = 0;
+    int64 num_heartbeats GUARDED_BY(lock) = 0;
+  };
+
+  // Writes 'msg' to the wrapped stream, with a callback forgetting its leaves
+  // if it is dropped by 'queue_'.
+  bool WriteToStream(const ::gnmi::SubscribeResponse& msg,
+                     ::grpc::WriteOptions options);
+
+  // Forgets the leaves of the dropped notification 'msg' whose last sent
+  // value is the one in 'msg'.
+  static void ForgetDroppedLeaves(const std::weak_ptr<State>& weak_state,
+                                  const ::gnmi::SubscribeResponse& msg);
+
+  GnmiSubscribeStream* stream_;  // not owned.
+  // 'stream_' if it is a QueuedGnmiSubscribeStream, or nullptr.
+  QueuedGnmiSubscribeStream* queue_;
+  const absl::Duration heartbeat_;
+  // The counters shared with the other subscriptions, or nullptr.
+  const std::shared_ptr<RedundantUpdateStats> stats_;
+  const std::shared_ptr<State> state_;
+};
+
+}  // namespace hal
+}  // namespace stratum
+
+#endif  // STRATUM_HAL_LIB_COMMON_GNMI_REDUNDANT_UPDATE_FILTER_H_
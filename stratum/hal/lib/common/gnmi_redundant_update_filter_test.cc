@@ -0,0 +1,210 @@
+// Copyright 2018-present Open Networking Foundation
+// SPDX-License-Identifier: Apache-2.0
+
+#include "stratum/hal/lib/common/gnmi_redundant_update_filter.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/synchronization/mutex.h"
+#include "absl/synchronization/notification.h"
+#include "absl/time/clock.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "stratum/hal/lib/common/gnmi_notification_aggregator.h"
+#include "stratum/hal/lib/common/gnmi_subscriber_queue.h"
+#include "stratum/hal/lib/common/subscribe_reader_writer_mock.h"
+#include "stratum/lib/test_utils/matchers.h"
+
+namespace stratum {
+namespace hal {
+
+using test_utils::EqualsProto;
+using ::testing::_;
+using ::testing::ElementsAre;
+using ::testing::Invoke;
+
+class SuppressingGnmiSubscribeStreamTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    EXPECT_CALL(stream_, Write(_, _))
+        .WillRepeatedly(Invoke([this](const ::gnmi::SubscribeResponse& resp,
+                                      ::grpc::WriteOptions options) {
+          written_.push_back(resp);
+          return true;
+        }));
+  }
+
+  // Returns a response with one update of the leaf 'leaf' of interface
+  // 'name'.
+  static ::gnmi::SubscribeResponse LeafUpdate(const std::string& name,
+                                              const std::string& leaf,
+                                              const std::string& value) {
+    ::gnmi::SubscribeResponse resp;
+    auto* update = resp.mutable_update()->add_update();
+    auto* path = update->mutable_path();
+    path->add_elem()->set_name("interfaces");
+    auto* elem = path->add_elem();
+    elem->set_name("interface");
+    (*elem->mutable_key())["name"] = name;
+    path->add_elem()->set_name("state");
+    path->add_elem()->set_name(leaf);
+    update->mutable_val()->set_string_val(value);
+    return resp;
+  }
+
+  // Writes the updates of 'responses' aggregated in one notification, as done
+  // for each tick of a subscription.
+  static void WriteTick(
+      const std::vector<::gnmi::SubscribeResponse>& responses,
+      GnmiSubscribeStream* stream) {
+    AggregatingGnmiSubscribeStream aggregator(stream, 1024 * 1024);
+    for (const auto& resp : responses) {
+      ASSERT_TRUE(aggregator.Write(resp, ::grpc::WriteOptions()));
+    }
+    ASSERT_TRUE(aggregator.Flush().ok());
+  }
+
+  SubscribeReaderWriterMock stream_;
+  std::vector<::gnmi::SubscribeResponse> written_;
+};
+
+TEST_F(SuppressingGnmiSubscribeStreamTest, SendsOnlyChangedValues) {
+  SuppressingGnmiSubscribeStream suppressor(&stream_,
+                                            absl::InfiniteDuration());
+  WriteTick({LeafUpdate("1/1", "oper-status", "UP"),
+             LeafUpdate("1/2", "oper-status", "UP")},
+            &suppressor);
+  ASSERT_EQ(1U, written_.size());
+  EXPECT_EQ(2, written_[0].update().update_size());
+
+  WriteTick({LeafUpdate("1/1", "oper-status", "UP"),
+             LeafUpdate("1/2", "oper-status", "DOWN")},
+            &suppressor);
+  ASSERT_EQ(2U, written_.size());
+  // The prefix computed for both updates is kept.
+  ASSERT_EQ(1, written_[1].update().update_size());
+  EXPECT_EQ("DOWN", written_[1].update().update(0).val().string_val());
+  EXPECT_EQ("1/2", written_[1].update().update(0).path().elem(0).key().at(
+                       "name"));
+  EXPECT_EQ(1, suppressor.NumSuppressed());
+
+  // Nothing changed, nothing is written.
+  WriteTick({LeafUpdate("1/1", "oper-status", "UP"),
+             LeafUpdate("1/2", "oper-status", "DOWN")},
+            &suppressor);
+  EXPECT_EQ(2U, written_.size());
+  EXPECT_EQ(3, suppressor.NumSuppressed());
+  EXPECT_EQ(0, suppressor.NumHeartbeats());
+}
+
+TEST_F(SuppressingGnmiSubscribeStreamTest, LeafIsKnownWithOrWithoutPrefix) {
+  SuppressingGnmiSubscribeStream suppressor(&stream_,
+                                            absl::InfiniteDuration());
+  WriteTick({LeafUpdate("1/1", "oper-status", "UP"),
+             LeafUpdate("1/1", "admin-status", "UP")},
+            &suppressor);
+  // Written alone, the update has its full path and no prefix.
+  WriteTick({LeafUpdate("1/1", "oper-status", "UP")}, &suppressor);
+  EXPECT_EQ(1U, written_.size());
+  EXPECT_EQ(1, suppressor.NumSuppressed());
+}
+
+TEST_F(SuppressingGnmiSubscribeStreamTest, HeartbeatResendsUnchangedValues) {
+  const absl::Duration kHeartbeat = absl::Milliseconds(10);
+  SuppressingGnmiSubscribeStream suppressor(&stream_, kHeartbeat);
+  const auto resp = LeafUpdate("1/1", "oper-status", "UP");
+  WriteTick({resp}, &suppressor);
+  absl::SleepFor(2 * kHeartbeat);
+  WriteTick({resp}, &suppressor);
+
+  ASSERT_EQ(2U, written_.size());
+  EXPECT_THAT(written_[1], EqualsProto(resp));
+  EXPECT_EQ(0, suppressor.NumSuppressed());
+  EXPECT_EQ(1, suppressor.NumHeartbeats());
+}
+
+TEST_F(SuppressingGnmiSubscribeStreamTest, OtherMessagesAreWritten) {
+  SuppressingGnmiSubscribeStream suppressor(&stream_,
+                                            absl::InfiniteDuration());
+  ::gnmi::SubscribeResponse sync;
+  sync.set_sync_response(true);
+  ASSERT_TRUE(suppressor.Write(sync, ::grpc::WriteOptions()));
+  ASSERT_TRUE(suppressor.Write(sync, ::grpc::WriteOptions()));
+  auto resp = LeafUpdate("1/1", "oper-status", "UP");
+  ASSERT_TRUE(suppressor.Write(resp, ::grpc::WriteOptions()));
+  // The update is removed, the delete is kept.
+  *resp.mutable_update()->add_delete_() = resp.update().update(0).path();
+  ASSERT_TRUE(suppressor.Write(resp, ::grpc::WriteOptions()));
+
+  ASSERT_EQ(4U, written_.size());
+  EXPECT_TRUE(written_[1].sync_response());
+  EXPECT_EQ(0, written_[3].update().update_size());
+  EXPECT_EQ(1, written_[3].update().delete__size());
+}
+
+TEST_F(SuppressingGnmiSubscribeStreamTest, CountersAreAddedToSharedStats) {
+  auto stats = std::make_shared<RedundantUpdateStats>();
+  SuppressingGnmiSubscribeStream suppressor1(&stream_,
+                                             absl::InfiniteDuration(), stats);
+  SuppressingGnmiSubscribeStream suppressor2(&stream_, absl::ZeroDuration(),
+                                             stats);
+  const auto resp = LeafUpdate("1/1", "oper-status", "UP");
+  for (int i = 0; i < 3; ++i) {
+    WriteTick({resp}, &suppressor1);
+    WriteTick({resp}, &suppressor2);
+  }
+
+  EXPECT_EQ(2, suppressor1.NumSuppressed());
+  EXPECT_EQ(2, suppressor2.NumHeartbeats());
+  EXPECT_EQ(2, stats->NumSuppressed());
+  EXPECT_EQ(2, stats->NumHeartbeats());
+}
+
+// A stream stalled by the client makes the queue in front of it drop
+// notifications. Their leaves are sent again even if unchanged, or the client
+// would never get their values.
+TEST_F(SuppressingGnmiSubscribeStreamTest, ResendsLeavesDroppedByQueue) {
+  absl::Notification write_started;
+  absl::Notification release;
+  absl::Mutex lock;
+  std::vector<std::string> written_names;
+  InlineGnmiSubscribeStream stalled_stream(
+      [&](const ::gnmi::SubscribeResponse& resp) {
+        if (!write_started.HasBeenNotified()) write_started.Notify();
+        release.WaitForNotification();
+        absl::MutexLock l(&lock);
+        for (const auto& update : resp.update().update()) {
+          written_names.push_back(update.path().elem(1).key().at("name"));
+        }
+        return true;
+      });
+  QueuedGnmiSubscribeStream queue(&stalled_stream, 1);
+  SuppressingGnmiSubscribeStream suppressor(&queue, absl::InfiniteDuration());
+
+  // 1/1 is held up in the stream, 1/2 is queued and then dropped for 1/3.
+  ASSERT_TRUE(suppressor.Write(LeafUpdate("1/1", "oper-status", "UP"),
+                               ::grpc::WriteOptions()));
+  write_started.WaitForNotification();
+  ASSERT_TRUE(suppressor.Write(LeafUpdate("1/2", "oper-status", "UP"),
+                               ::grpc::WriteOptions()));
+  ASSERT_TRUE(suppressor.Write(LeafUpdate("1/3", "oper-status", "UP"),
+                               ::grpc::WriteOptions()));
+  EXPECT_EQ(1, queue.NumDropped());
+  release.Notify();
+  queue.WaitUntilEmpty();
+
+  // Only the value of the dropped leaf is sent again.
+  for (const std::string name : {"1/1", "1/2", "1/3"}) {
+    ASSERT_TRUE(suppressor.Write(LeafUpdate(name, "oper-status", "UP"),
+                                 ::grpc::WriteOptions()));
+  }
+  queue.WaitUntilEmpty();
+  absl::MutexLock l(&lock);
+  EXPECT_THAT(written_names, ElementsAre("1/1", "1/3", "1/2"));
+  EXPECT_EQ(2, suppressor.NumSuppressed());
+}
+
+}  // namespace hal
+}  // namespace stratum
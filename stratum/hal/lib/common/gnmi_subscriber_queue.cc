@@ -0,0 +1,184 @@
+// Copyright 2018-present Open Networking Foundation
+// SPDX-License-Identifier: Apache-2.0
+
+#include "stratum/hal/lib/common/gnmi_subscriber_queue.h"
+
+#include <algorithm>
+#include <utility>
+
+#include "gflags/gflags.h"
+#include "stratum/glue/logging.h"
+
+DEFINE_int32(gnmi_subscriber_queue_size, 1024,
+             "Max number of messages queued for one gNMI subscriber. When "
+             "the subscriber does not keep up, a new notification replaces a "
+             "queued one with the same paths, or the oldest queued "
+             "notification is dropped.");
+
+namespace stratum {
+namespace hal {
+
+namespace {
+
+// Notifications are the only messages which can be coalesced or dropped.
+bool IsDroppable(const ::gnmi::SubscribeResponse& msg) {
+  return msg.has_update();
+}
+
+// Returns a key identifying the updated and deleted paths of the notification
+// held by 'msg'. Two notifications with the same key differ only by their
+// values and timestamps.
+std::string NotificationKey(const ::gnmi::SubscribeResponse& msg) {
+  const ::gnmi::Notification& notification = msg.update();
+  std::string key = notification.prefix().SerializeAsString();
+  for (const auto& update : notification.update()) {
+    key += '\0';
+    key += update.path().SerializeAsString();
+  }
+  key += '\1';
+  for (const auto& path : notification.delete_()) {
+    key += '\0';
+    key += path.SerializeAsString();
+  }
+  return key;
+}
+
+}  // namespace
+
+QueuedGnmiSubscribeStream::QueuedGnmiSubscribeStream(
+    GnmiSubscribeStream* stream)
+    : QueuedGnmiSubscribeStream(stream, FLAGS_gnmi_subscriber_queue_size) {}
+
+QueuedGnmiSubscribeStream::QueuedGnmiSubscribeStream(
+    GnmiSubscribeStream* stream, int max_queue_size)
+    : stream_(stream),
+      max_queue_size_(std::max(max_queue_size, 1)),
+      queue_(),
+      writing_(false),
+      failed_(false),
+      stopping_(false),
+      num_dropped_(0),
+      num_coalesced_(0) {
+  writer_ = std::thread(&QueuedGnmiSubscribeStream::Run, this);
+}
+
+QueuedGnmiSubscribeStream::~QueuedGnmiSubscribeStream() {
+  {
+    absl::MutexLock l(&lock_);
+    stopping_ = true;
+    cond_.SignalAll();
+  }
+  // The writer thread exits once the queue is empty.
+  writer_.join();
+}
+
+bool QueuedGnmiSubscribeStream::Write(const ::gnmi::SubscribeResponse& msg,
+                                      ::grpc::WriteOptions options) {
+  return Write(msg, options, DropCallback());
+}
+
+bool QueuedGnmiSubscribeStream::Write(const ::gnmi::SubscribeResponse& msg,
+                                      ::grpc::WriteOptions options,
+                                      const DropCallback& on_dropped) {
+  Entry entry;
+  entry.msg = msg;
+  entry.options = options;
+  entry.has_key = false;
+  entry.on_dropped = on_dropped;
+
+  absl::MutexLock l(&lock_);
+  if (failed_) return false;
+  if (queue_.size() >= static_cast<size_t>(max_queue_size_) &&
+      !MakeRoom(&entry)) {
+    return true;
+  }
+  queue_.push_back(std::move(entry));
+  cond_.SignalAll();
+
+  return true;
+}
+
+bool QueuedGnmiSubscribeStream::MakeRoom(Entry* entry) {
+  if (IsDroppable(entry->msg)) {
+    entry->key = NotificationKey(entry->msg);
+    entry->has_key = true;
+    for (auto& queued : queue_) {
+      if (!IsDroppable(queued.msg)) continue;
+      if (!queued.has_key) {
+        queued.key = NotificationKey(queued.msg);
+        queued.has_key = true;
+      }
+      if (queued.key == entry->key) {
+        // The newer values replace the queued ones, keeping their place in
+        // the queue.
+        queued.msg.Swap(&entry->msg);
+        queued.options = entry->options;
+        queued.on_dropped = std::move(entry->on_dropped);
+        ++num_coalesced_;
+        return false;
+      }
+    }
+  }
+  for (auto it = queue_.begin(); it != queue_.end(); ++it) {
+    if (IsDroppable(it->msg)) {
+      Drop(*it);
+      queue_.erase(it);
+      return true;
+    }
+  }
+  // Only messages which cannot be dropped are queued.
+  if (IsDroppable(entry->msg)) {
+    Drop(*entry);
+    return false;
+  }
+
+  return true;
+}
+
+void QueuedGnmiSubscribeStream::Drop(const Entry& entry) {
+  ++num_dropped_;
+  if (entry.on_dropped) entry.on_dropped(entry.msg);
+}
+
+void QueuedGnmiSubscribeStream::Run() {
+  while (true) {
+    Entry entry;
+    {
+      absl::MutexLock l(&lock_);
+      while (queue_.empty() && !stopping_) cond_.Wait(&lock_);
+      if (queue_.empty()) return;
+      entry = std::move(queue_.front());
+      queue_.pop_front();
+      writing_ = true;
+    }
+    const bool ok = stream_->Write(entry.msg, entry.options);
+    absl::MutexLock l(&lock_);
+    writing_ = false;
+    cond_.SignalAll();
+    if (!ok) {
+      VLOG(1) << "Writing to subscribe stream " << stream_ << " failed. "
+              << "Discarding " << queue_.size() << " queued messages.";
+      failed_ = true;
+      queue_.clear();
+      return;
+    }
+  }
+}
+
+void QueuedGnmiSubscribeStream::WaitUntilEmpty() {
+  absl::MutexLock l(&lock_);
+  while ((!queue_.empty() || writing_) && !failed_) cond_.Wait(&lock_);
+}
+
+int64 QueuedGnmiSubscribeStream::NumDropped() const {
+  absl::MutexLock l(&lock_);
+  return num_dropped_;
+}
+
+int64 QueuedGnmiSubscribeStream::NumCoalesced() const {
+  absl::MutexLock l(&lock_);
+  return num_coalesced_;
+}
+
+}  // namespace hal
+}  // namespace stratum
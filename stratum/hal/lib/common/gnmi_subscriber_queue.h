@@ -0,0 +1,122 @@
+// Copyright 2018-present Open Networking Foundation
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef STRATUM_HAL_LIB_COMMON_GNMI_SUBSCRIBER_QUEUE_H_
+#define STRATUM_HAL_LIB_COMMON_GNMI_SUBSCRIBER_QUEUE_H_
+
+#include <deque>
+#include <functional>
+#include <string>
+#include <thread>  // NOLINT
+
+#include "absl/base/thread_annotations.h"
+#include "absl/synchronization/mutex.h"
+#include "gnmi/gnmi.grpc.pb.h"
+#include "stratum/glue/integral_types.h"
+#include "stratum/hal/lib/common/gnmi_events.h"
+
+namespace stratum {
+namespace hal {
+
+// A GnmiSubscribeStream which queues the SubscribeResponses written to it and
+// writes them to the wrapped stream from its own thread. Every gNMI subscriber
+// gets one, so that the event handlers and the timers only append to a queue
+// and a slow collector only delays its own notifications.
+//
+// The queue is bounded. When it is full, a notification with the same updated
+// and deleted paths as a queued one replaces it in place (it is coalesced);
+// otherwise the oldest queued notification is dropped to make room. The
+// sync_response and the error messages are never dropped. A writer which
+// needs to know about the notifications dropped, e.g. to send them again, can
+// pass a callback to Write().
+//
+// Once writing to the wrapped stream fails, the queue is discarded and Write()
+// returns false. The destructor writes what is left in the queue.
+//
+// The class is thread-safe. Reading is left to the wrapped stream.
+class QueuedGnmiSubscribeStream : public GnmiSubscribeStream {
+ public:
+  // Called with a notification dropped from the queue.
+  using DropCallback =
+      std::function<void(const ::gnmi::SubscribeResponse& msg)>;
+
+  // Uses the size given by FLAGS_gnmi_subscriber_queue_size.
+  explicit QueuedGnmiSubscribeStream(GnmiSubscribeStream* stream);
+  QueuedGnmiSubscribeStream(GnmiSubscribeStream* stream, int max_queue_size);
+  ~QueuedGnmiSubscribeStream() override LOCKS_EXCLUDED(lock_);
+
+  // Queues 'msg'. Returns false if writing to the wrapped stream has failed.
+  bool Write(const ::gnmi::SubscribeResponse& msg,
+             ::grpc::WriteOptions options) override LOCKS_EXCLUDED(lock_);
+
+  // Same as above, and 'on_dropped' is called with 'msg' if it is dropped
+  // instead of being written to the wrapped stream. When 'msg' replaces a
+  // queued notification with the same paths, the callback of 'msg' replaces
+  // the one of the queued notification. The callback is called with the lock
+  // of the queue held, so it must not write to the queue.
+  bool Write(const ::gnmi::SubscribeResponse& msg, ::grpc::WriteOptions options,
+             const DropCallback& on_dropped) LOCKS_EXCLUDED(lock_);
+
+  // Waits until all the queued messages have been written to the wrapped
+  // stream, or writing failed.
+  void WaitUntilEmpty() LOCKS_EXCLUDED(lock_);
+
+  // Number of notifications dropped and coalesced because the queue was full.
+  int64 NumDropped() const LOCKS_EXCLUDED(lock_);
+  int64 NumCoalesced() const LOCKS_EXCLUDED(lock_);
+
+  // QueuedGnmiSubscribeStream is neither copyable nor movable.
+  QueuedGnmiSubscribeStream(const QueuedGnmiSubscribeStream&) = delete;
+  QueuedGnmiSubscribeStream& operator=(const QueuedGnmiSubscribeStream&) =
+      delete;
+
+ private:
+  struct Entry {
+    ::gnmi::SubscribeResponse msg;
+    ::grpc::WriteOptions options;
+    // The updated and deleted paths of a notification, empty for the messages
+    // which cannot be coalesced or dropped. Computed only when the queue is
+    // full.
+    std::string key;
+    bool has_key;
+    // Called if the notification is dropped. May be empty.
+    DropCallback on_dropped;
+  };
+
+  void SendInitialMetadata() override { stream_->SendInitialMetadata(); }
+  bool NextMessageSize(uint32_t* sz) override {
+    return stream_->NextMessageSize(sz);
+  }
+  bool Read(::gnmi::SubscribeRequest* msg) override {
+    return stream_->Read(msg);
+  }
+
+  // Makes room for 'entry' in the full queue, or merges it into a queued
+  // entry. Returns true if 'entry' still has to be appended to the queue.
+  bool MakeRoom(Entry* entry) EXCLUSIVE_LOCKS_REQUIRED(lock_);
+
+  // Counts 'entry' as dropped and calls its callback.
+  void Drop(const Entry& entry) EXCLUSIVE_LOCKS_REQUIRED(lock_);
+
+  // Main loop of the writer thread.
+  void Run() LOCKS_EXCLUDED(lock_);
+
+  GnmiSubscribeStream* stream_;  // not owned.
+  const int max_queue_size_;
+
+  mutable absl::Mutex lock_;
+  absl::CondVar cond_;
+  std::deque<Entry> queue_ GUARDED_BY(lock_);
+  // True while the writer thread is writing a message taken from the queue.
+  bool writing_ GUARDED_BY(lock_);
+  bool failed_ GUARDED_BY(lock_);
+  bool stopping_ GUARDED_BY(lock_);
+  int64 num_dropped_ GUARDED_BY(lock_);
+  int64 num_coalesced_ GUARDED_BY(lock_);
+  std::thread writer_;
+};
+
+}  // namespace hal
+}  // namespace stratum
+
+#endif  // STRATUM_HAL_LIB_COMMON_GNMI_SUBSCRIBER_QUEUE_H_
@@ -0,0 +1,315 @@
+// Copyright 2018-present Open Networking Foundation
+// SPDX-License-Identifier: Apache-2.0
+
+#include "stratum/hal/lib/common/gnmi_subscriber_queue.h"
+
+#include <algorithm>
+#include <atomic>
+#include <map>
+#include <memory>
+#include <string>
+#include <thread>  // NOLINT
+#include <vector>
+
+#include "absl/strings/str_cat.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/synchronization/notification.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "stratum/glue/status/status_test_util.h"
+#include "stratum/hal/lib/common/subscribe_reader_writer_mock.h"
+
+namespace stratum {
+namespace hal {
+
+using ::testing::_;
+using ::testing::Return;
+
+namespace {
+
+// Returns a response with one update of the leaf 'leaf'.
+::gnmi::SubscribeResponse LeafUpdate(const std::string& leaf, uint64 value) {
+  ::gnmi::SubscribeResponse resp;
+  auto* update = resp.mutable_update()->add_update();
+  update->mutable_path()->add_elem()->set_name("counters");
+  update->mutable_path()->add_elem()->set_name(leaf);
+  update->mutable_val()->set_uint_val(value);
+  return resp;
+}
+
+::gnmi::SubscribeResponse SyncResponse() {
+  ::gnmi::SubscribeResponse resp;
+  resp.set_sync_response(true);
+  return resp;
+}
+
+// A stream keeping the written responses, whose writes can be held up.
+class RecordingStream {
+ public:
+  RecordingStream()
+      : stream_([this](const ::gnmi::SubscribeResponse& msg) {
+          if (!entered_.HasBeenNotified()) entered_.Notify();
+          release_.WaitForNotification();
+          absl::MutexLock l(&lock_);
+          written_.push_back(msg);
+          return true;
+        }) {}
+
+  GnmiSubscribeStream* stream() { return &stream_; }
+
+  // The writes are held up until Release() is called.
+  void WaitUntilEntered() { entered_.WaitForNotification(); }
+  void Release() {
+    if (!release_.HasBeenNotified()) release_.Notify();
+  }
+
+  std::vector<::gnmi::SubscribeResponse> written() {
+    absl::MutexLock l(&lock_);
+    return written_;
+  }
+
+ private:
+  absl::Notification entered_;
+  absl::Notification release_;
+  absl::Mutex lock_;
+  std::vector<::gnmi::SubscribeResponse> written_ GUARDED_BY(lock_);
+  InlineGnmiSubscribeStream stream_;
+};
+
+}  // namespace
+
+TEST(QueuedGnmiSubscribeStreamTest, WritesInOrder) {
+  RecordingStream recorder;
+  recorder.Release();
+  QueuedGnmiSubscribeStream queue(recorder.stream(), 16);
+  ASSERT_TRUE(queue.Write(LeafUpdate("a", 1), ::grpc::WriteOptions()));
+  ASSERT_TRUE(queue.Write(LeafUpdate("b", 2), ::grpc::WriteOptions()));
+  ASSERT_TRUE(queue.Write(SyncResponse(), ::grpc::WriteOptions()));
+  queue.WaitUntilEmpty();
+
+  auto written = recorder.written();
+  ASSERT_EQ(3U, written.size());
+  EXPECT_EQ(1U, written[0].update().update(0).val().uint_val());
+  EXPECT_EQ(2U, written[1].update().update(0).val().uint_val());
+  EXPECT_TRUE(written[2].sync_response());
+  EXPECT_EQ(0, queue.NumDropped());
+  EXPECT_EQ(0, queue.NumCoalesced());
+}
+
+TEST(QueuedGnmiSubscribeStreamTest, CoalescesThenDropsWhenFull) {
+  RecordingStream recorder;
+  QueuedGnmiSubscribeStream queue(recorder.stream(), 2);
+  // Held up in the stream.
+  ASSERT_TRUE(queue.Write(LeafUpdate("a", 1), ::grpc::WriteOptions()));
+  recorder.WaitUntilEntered();
+  // Queued: b:1, c:1.
+  ASSERT_TRUE(queue.Write(LeafUpdate("b", 1), ::grpc::WriteOptions()));
+  ASSERT_TRUE(queue.Write(LeafUpdate("c", 1), ::grpc::WriteOptions()));
+  // Replaces b:1.
+  ASSERT_TRUE(queue.Write(LeafUpdate("b", 2), ::grpc::WriteOptions()));
+  EXPECT_EQ(1, queue.NumCoalesced());
+  EXPECT_EQ(0, queue.NumDropped());
+  // Drops b:2, then c:1.
+  ASSERT_TRUE(queue.Write(LeafUpdate("d", 1), ::grpc::WriteOptions()));
+  ASSERT_TRUE(queue.Write(SyncResponse(), ::grpc::WriteOptions()));
+  EXPECT_EQ(2, queue.NumDropped());
+  // Replaces d:1, the sync_response is kept.
+  ASSERT_TRUE(queue.Write(LeafUpdate("d", 2), ::grpc::WriteOptions()));
+  EXPECT_EQ(2, queue.NumCoalesced());
+  recorder.Release();
+  queue.WaitUntilEmpty();
+
+  auto written = recorder.written();
+  ASSERT_EQ(3U, written.size());
+  EXPECT_EQ("a", written[0].update().update(0).path().elem(1).name());
+  EXPECT_EQ("d", written[1].update().update(0).path().elem(1).name());
+  EXPECT_EQ(2U, written[1].update().update(0).val().uint_val());
+  EXPECT_TRUE(written[2].sync_response());
+}
+
+TEST(QueuedGnmiSubscribeStreamTest, SyncResponseIsNeverDropped) {
+  RecordingStream recorder;
+  QueuedGnmiSubscribeStream queue(recorder.stream(), 1);
+  ASSERT_TRUE(queue.Write(LeafUpdate("a", 1), ::grpc::WriteOptions()));
+  recorder.WaitUntilEntered();
+  ASSERT_TRUE(queue.Write(SyncResponse(), ::grpc::WriteOptions()));
+  // Nothing can make room for the update.
+  ASSERT_TRUE(queue.Write(LeafUpdate("b", 1), ::grpc::WriteOptions()));
+  EXPECT_EQ(1, queue.NumDropped());
+  ASSERT_TRUE(queue.Write(SyncResponse(), ::grpc::WriteOptions()));
+  recorder.Release();
+  queue.WaitUntilEmpty();
+
+  auto written = recorder.written();
+  ASSERT_EQ(3U, written.size());
+  EXPECT_TRUE(written[1].sync_response());
+  EXPECT_TRUE(written[2].sync_response());
+}
+
+TEST(QueuedGnmiSubscribeStreamTest, DropCallbackIsCalledWithDroppedMessage) {
+  RecordingStream recorder;
+  QueuedGnmiSubscribeStream queue(recorder.stream(), 1);
+  std::vector<std::string> dropped;
+  auto on_dropped = [&dropped](const ::gnmi::SubscribeResponse& msg) {
+    dropped.push_back(msg.update().update(0).path().elem(1).name());
+  };
+  ASSERT_TRUE(
+      queue.Write(LeafUpdate("a", 1), ::grpc::WriteOptions(), on_dropped));
+  recorder.WaitUntilEntered();
+  ASSERT_TRUE(
+      queue.Write(LeafUpdate("b", 1), ::grpc::WriteOptions(), on_dropped));
+  // Replaces b:1, which is not dropped.
+  ASSERT_TRUE(
+      queue.Write(LeafUpdate("b", 2), ::grpc::WriteOptions(), on_dropped));
+  EXPECT_TRUE(dropped.empty());
+  // Drops b:2. c:1 has no callback.
+  ASSERT_TRUE(queue.Write(LeafUpdate("c", 1), ::grpc::WriteOptions()));
+  // Drops c:1.
+  ASSERT_TRUE(queue.Write(SyncResponse(), ::grpc::WriteOptions()));
+  // Nothing can make room for d:1, which is dropped.
+  ASSERT_TRUE(
+      queue.Write(LeafUpdate("d", 1), ::grpc::WriteOptions(), on_dropped));
+  recorder.Release();
+  queue.WaitUntilEmpty();
+
+  EXPECT_THAT(dropped, ::testing::ElementsAre("b", "d"));
+  EXPECT_EQ(3, queue.NumDropped());
+}
+
+TEST(QueuedGnmiSubscribeStreamTest, WriteFailsOnceStreamFailed) {
+  SubscribeReaderWriterMock stream;
+  EXPECT_CALL(stream, Write(_, _)).WillOnce(Return(false));
+  QueuedGnmiSubscribeStream queue(&stream, 16);
+  ASSERT_TRUE(queue.Write(LeafUpdate("a", 1), ::grpc::WriteOptions()));
+  queue.WaitUntilEmpty();
+  EXPECT_FALSE(queue.Write(LeafUpdate("a", 2), ::grpc::WriteOptions()));
+}
+
+TEST(QueuedGnmiSubscribeStreamTest, DestructorWritesQueuedMessages) {
+  RecordingStream recorder;
+  {
+    QueuedGnmiSubscribeStream queue(recorder.stream(), 16);
+    for (int i = 0; i < 10; ++i) {
+      ASSERT_TRUE(queue.Write(LeafUpdate(absl::StrCat(i), i),
+                              ::grpc::WriteOptions()));
+    }
+    recorder.WaitUntilEntered();
+    recorder.Release();
+  }
+  EXPECT_EQ(10U, recorder.written().size());
+}
+
+TEST(QueuedGnmiSubscribeStreamTest, ReadIsForwarded) {
+  SubscribeReaderWriterMock stream;
+  EXPECT_CALL(stream, Read(_)).WillOnce(Return(true));
+  QueuedGnmiSubscribeStream queue(&stream, 16);
+  GnmiSubscribeStream* base = &queue;
+  ::gnmi::SubscribeRequest req;
+  EXPECT_TRUE(base->Read(&req));
+}
+
+namespace {
+
+// An event fanned out to the subscribers by the stress test.
+class FanOutTestEvent : public GnmiEventProcess<FanOutTestEvent> {
+ public:
+  explicit FanOutTestEvent(uint64 seq) : seq_(seq) {}
+  uint64 seq() const { return seq_; }
+
+ private:
+  const uint64 seq_;
+};
+
+}  // namespace
+
+// 100 subscribers registered for the same event, one of which never reads its
+// stream while the events are processed. Processing the events does not wait
+// for it, the others get every notification and the slow one has its queue
+// bounded, counting what it missed.
+TEST(QueuedGnmiSubscribeStreamTest, SlowSubscriberDoesNotBlockFanOut) {
+  constexpr int kNumSubscribers = 100;
+  constexpr int kNumEvents = 1000;
+  constexpr int kNumLeaves = 8;
+  constexpr int kSlowQueueSize = 16;
+  auto* list = EventHandlerList<FanOutTestEvent>::GetInstance();
+
+  std::vector<std::unique_ptr<RecordingStream>> recorders;
+  std::vector<std::unique_ptr<QueuedGnmiSubscribeStream>> queues;
+  std::vector<SubscriptionHandle> handles;
+  for (int i = 0; i < kNumSubscribers; ++i) {
+    recorders.emplace_back(new RecordingStream());
+    // Subscriber 0 is the slow one.
+    if (i > 0) recorders.back()->Release();
+    queues.emplace_back(new QueuedGnmiSubscribeStream(
+        recorders.back()->stream(), i == 0 ? kSlowQueueSize : 2 * kNumEvents));
+    handles.emplace_back(new EventHandlerRecord(
+        [](const GnmiEvent& base_event, GnmiSubscribeStream* stream) {
+          const auto& event = static_cast<const FanOutTestEvent&>(base_event);
+          stream->Write(LeafUpdate(absl::StrCat(event.seq() % kNumLeaves),
+                                   event.seq()),
+                        ::grpc::WriteOptions());
+          return ::util::OkStatus();
+        },
+        queues.back().get()));
+    ASSERT_OK(list->Register(handles.back()));
+  }
+
+  // Subscriptions come and go while the events are processed.
+  std::atomic<bool> done(false);
+  std::thread churn([list, &done]() {
+    while (!done) {
+      SubscriptionHandle h(new EventHandlerRecord(
+          [](const GnmiEvent& event, GnmiSubscribeStream* stream) {
+            return ::util::OkStatus();
+          },
+          nullptr));
+      list->Register(h).IgnoreError();
+      list->UnRegister(h).IgnoreError();
+    }
+  });
+  for (int seq = 1; seq <= kNumEvents; ++seq) {
+    EXPECT_OK(FanOutTestEvent(seq).Process());
+  }
+  done = true;
+  churn.join();
+
+  for (int i = 1; i < kNumSubscribers; ++i) {
+    queues[i]->WaitUntilEmpty();
+    auto written = recorders[i]->written();
+    EXPECT_EQ(kNumEvents, written.size()) << "subscriber " << i;
+    if (written.size() != kNumEvents) continue;
+    for (int seq = 1; seq <= kNumEvents; ++seq) {
+      EXPECT_EQ(seq, written[seq - 1].update().update(0).val().uint_val());
+    }
+    EXPECT_EQ(0, queues[i]->NumDropped());
+    EXPECT_EQ(0, queues[i]->NumCoalesced());
+  }
+
+  // The slow subscriber holds one write and a full queue. The checks above do
+  // not return early, as the queue could not be destroyed before this point.
+  const int64 num_dropped = queues[0]->NumDropped();
+  const int64 num_coalesced = queues[0]->NumCoalesced();
+  EXPECT_GT(num_dropped + num_coalesced, 0);
+  recorders[0]->Release();
+  queues[0]->WaitUntilEmpty();
+  auto written = recorders[0]->written();
+  EXPECT_LE(written.size(), kSlowQueueSize + 1);
+  EXPECT_EQ(kNumEvents, written.size() + num_dropped + num_coalesced);
+  // The last values of all the leaves made it.
+  std::map<std::string, uint64> last_values;
+  for (const auto& resp : written) {
+    const auto& update = resp.update().update(0);
+    uint64& value = last_values[update.path().elem(1).name()];
+    value = std::max(value, update.val().uint_val());
+  }
+  ASSERT_EQ(kNumLeaves, last_values.size());
+  for (int seq = kNumEvents - kNumLeaves + 1; seq <= kNumEvents; ++seq) {
+    EXPECT_EQ(seq, last_values[absl::StrCat(seq % kNumLeaves)]);
+  }
+
+  for (const auto& h : handles) ASSERT_OK(list->UnRegister(h));
+  EXPECT_EQ(0U, list->GetNumberOfRegisteredHandlers());
+}
+
+}  // namespace hal
+}  // namespace stratum
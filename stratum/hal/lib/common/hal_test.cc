@@ -11,6 +11,7 @@
 #include "gtest/gtest.h"
 #include "stratum/glue/net_util/ports.h"
 #include "stratum/glue/status/status_test_util.h"
+#include "stratum/hal/lib/common/forwarding_pipeline_config_store.h"
 #include "stratum/hal/lib/common/switch_mock.h"
 #include "stratum/lib/security/auth_policy_checker_mock.h"
 #include "stratum/lib/security/credentials_manager_mock.h"
@@ -22,6 +23,7 @@ DECLARE_string(external_stratum_urls);
 DECLARE_bool(warmboot);
 DECLARE_string(chassis_config_file);
 DECLARE_string(forwarding_pipeline_configs_file);
+DECLARE_string(forwarding_pipeline_configs_dir);
 DECLARE_string(test_tmpdir);
 DECLARE_string(local_stratum_url);
 DECLARE_string(procmon_service_addr);
@@ -112,6 +114,13 @@ class HalTest : public ::testing::Test {
     FLAGS_chassis_config_file = FLAGS_test_tmpdir + "/chassis_config.pb.txt";
     FLAGS_forwarding_pipeline_configs_file =
         FLAGS_test_tmpdir + "/forwarding_pipeline_configs_file.pb.txt";
+    FLAGS_forwarding_pipeline_configs_dir =
+        FLAGS_test_tmpdir + "/forwarding_pipeline_configs";
+    // The configs read from the text file are also saved in binary format on
+    // setup. Remove them so that each test only sees the configs it saves.
+    ASSERT_OK(ForwardingPipelineConfigStore(
+                  FLAGS_forwarding_pipeline_configs_dir)
+                  .Clear());
     FLAGS_persistent_config_dir = FLAGS_test_tmpdir + "/config_dir";
     FLAGS_external_stratum_urls =
         absl::StrJoin({RandomURL(), RandomURL()}, ",");
@@ -0,0 +1,210 @@
+// Copyright 2018-present Open Networking Foundation
+// SPDX-License-Identifier: Apache-2.0
+
+#include "stratum/hal/lib/common/p4_request_logger.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <utility>
+
+#include "absl/memory/memory.h"
+#include "absl/strings/str_cat.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "google/protobuf/io/coded_stream.h"
+#include "google/protobuf/io/zero_copy_stream_impl_lite.h"
+#include "stratum/glue/logging.h"
+#include "stratum/glue/status/status_macros.h"
+#include "stratum/lib/macros.h"
+#include "stratum/lib/utils.h"
+#include "stratum/public/lib/error.h"
+
+namespace stratum {
+namespace hal {
+
+P4RequestLogger::P4RequestLogger(const Options& options)
+    : options_(options),
+      channel_(Channel<P4RequestLogEntry>::Create(options.max_queue_size)),
+      reader_(ChannelReader<P4RequestLogEntry>::Create(channel_)),
+      writer_(ChannelWriter<P4RequestLogEntry>::Create(channel_)),
+      fd_(-1),
+      file_size_(0),
+      num_queued_(0),
+      num_dropped_(0),
+      num_processed_(0) {}
+
+P4RequestLogger::~P4RequestLogger() {
+  Flush();
+  channel_->Close();
+  if (flush_thread_.joinable()) flush_thread_.join();
+  if (fd_ >= 0) close(fd_);
+}
+
+std::unique_ptr<P4RequestLogger> P4RequestLogger::CreateInstance(
+    const Options& options) {
+  auto logger = absl::WrapUnique(new P4RequestLogger(options));
+  P4RequestLogger* p = logger.get();
+  logger->flush_thread_ = std::thread([p]() { p->FlushThread(); });
+  return logger;
+}
+
+bool P4RequestLogger::Log(P4RequestLogEntry&& entry) {
+  if (!writer_->TryWrite(std::move(entry)).ok()) {
+    uint64 num_dropped = ++num_dropped_;
+    LOG_EVERY_N(WARNING, 1000)
+        << "Request log queue for " << options_.path << " is full. Dropped "
+        << num_dropped << " entries so far.";
+    return false;
+  }
+  ++num_queued_;
+  return true;
+}
+
+void P4RequestLogger::Flush() {
+  const uint64 target = num_queued_.load();
+  absl::MutexLock l(&lock_);
+  while (num_processed_ < target && !channel_->IsClosed()) {
+    processed_cond_.Wait(&lock_);
+  }
+}
+
+void P4RequestLogger::FlushThread() {
+  std::vector<P4RequestLogEntry> entries;
+  std::string buffer;
+  while (true) {
+    ::util::Status status =
+        reader_->ReadAll(&entries, absl::InfiniteDuration());
+    // Exit if the Channel is closed.
+    if (status.error_code() == ERR_CANCELLED) break;
+    if (!status.ok()) continue;
+    buffer.clear();
+    for (const auto& entry : entries) AppendEntry(entry, &buffer);
+    status = WriteToFile(buffer);
+    if (!status.ok()) {
+      num_dropped_ += entries.size();
+      LOG_EVERY_N(ERROR, 50) << "Failed to log the requests: "
+                             << status.error_message();
+    }
+    absl::MutexLock l(&lock_);
+    num_processed_ += entries.size();
+    processed_cond_.SignalAll();
+  }
+  // Wake up any Flush() blocked on the closed Channel.
+  absl::MutexLock l(&lock_);
+  processed_cond_.SignalAll();
+}
+
+void P4RequestLogger::AppendEntry(const P4RequestLogEntry& entry,
+                                  std::string* buffer) const {
+  if (options_.format == Format::kBinary) {
+    ::google::protobuf::io::StringOutputStream string_stream(buffer);
+    ::google::protobuf::io::CodedOutputStream coded_stream(&string_stream);
+    coded_stream.WriteVarint32(entry.ByteSizeLong());
+    entry.SerializeWithCachedSizes(&coded_stream);
+    return;
+  }
+  std::string request;
+  switch (entry.request_case()) {
+    case P4RequestLogEntry::kUpdate:
+      request = entry.update().ShortDebugString();
+      break;
+    case P4RequestLogEntry::kEntity:
+      request = entry.entity().ShortDebugString();
+      break;
+    default:
+      break;
+  }
+  absl::StrAppend(buffer,
+                  absl::FormatTime("%Y-%m-%d %H:%M:%E6S",
+                                   absl::FromUnixMicros(entry.timestamp_us()),
+                                   absl::LocalTimeZone()),
+                  ";", entry.node_id(), ";", request, ";",
+                  entry.error_message(), "\n");
+}
+
+::util::Status P4RequestLogger::WriteToFile(const std::string& buffer) {
+  if (fd_ < 0) {
+    fd_ = open(options_.path.c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644);
+    if (fd_ < 0) {
+      return MAKE_ERROR(ERR_INTERNAL) << "Failed to open " << options_.path
+                                      << ": " << strerror(errno);
+    }
+    struct stat stbuf;
+    file_size_ = fstat(fd_, &stbuf) == 0 ? stbuf.st_size : 0;
+  }
+  size_t written = 0;
+  while (written < buffer.size()) {
+    ssize_t ret =
+        write(fd_, buffer.data() + written, buffer.size() - written);
+    if (ret < 0) {
+      if (errno == EINTR) continue;
+      return MAKE_ERROR(ERR_INTERNAL) << "Failed to write to " << options_.path
+                                      << ": " << strerror(errno);
+    }
+    written += ret;
+  }
+  file_size_ += written;
+  if (options_.max_file_size > 0 && file_size_ >= options_.max_file_size) {
+    RETURN_IF_ERROR(RotateFile());
+  }
+
+  return ::util::OkStatus();
+}
+
+::util::Status P4RequestLogger::RotateFile() {
+  close(fd_);
+  fd_ = -1;
+  file_size_ = 0;
+  if (options_.max_rotated_files <= 0) {
+    // Nothing to keep, the next write starts a new file.
+    if (unlink(options_.path.c_str()) != 0 && errno != ENOENT) {
+      return MAKE_ERROR(ERR_INTERNAL) << "Failed to remove " << options_.path
+                                      << ": " << strerror(errno);
+    }
+    return ::util::OkStatus();
+  }
+  for (int i = options_.max_rotated_files - 1; i >= 0; --i) {
+    std::string from =
+        i == 0 ? options_.path : absl::StrCat(options_.path, ".", i);
+    std::string to = absl::StrCat(options_.path, ".", i + 1);
+    if (rename(from.c_str(), to.c_str()) != 0 && errno != ENOENT) {
+      return MAKE_ERROR(ERR_INTERNAL) << "Failed to rename " << from << " to "
+                                      << to << ": " << strerror(errno);
+    }
+  }
+
+  return ::util::OkStatus();
+}
+
+::util::Status P4RequestLogger::ReadBinaryLogFile(
+    const std::string& path, std::vector<P4RequestLogEntry>* entries) {
+  std::string buffer;
+  RETURN_IF_ERROR(ReadFileToString(path, &buffer));
+  ::google::protobuf::io::CodedInputStream coded_stream(
+      reinterpret_cast<const uint8*>(buffer.data()), buffer.size());
+  entries->clear();
+  uint32 size;
+  while (coded_stream.ReadVarint32(&size)) {
+    auto limit = coded_stream.PushLimit(size);
+    P4RequestLogEntry entry;
+    CHECK_RETURN_IF_FALSE(entry.ParseFromCodedStream(&coded_stream) &&
+                          coded_stream.ConsumedEntireMessage())
+        << "Failed to parse entry " << entries->size() << " of " << path
+        << ".";
+    coded_stream.PopLimit(limit);
+    entries->push_back(std::move(entry));
+  }
+  CHECK_RETURN_IF_FALSE(coded_stream.CurrentPosition() ==
+                        static_cast<int>(buffer.size()))
+      << "Truncated entry at the end of " << path << ".";
+
+  return ::util::OkStatus();
+}
+
+}  // namespace hal
+}  // namespace stratum
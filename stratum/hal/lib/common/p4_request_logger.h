@@ -0,0 +1,129 @@
+// Copyright 2018-present Open Networking Foundation
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef STRATUM_HAL_LIB_COMMON_P4_REQUEST_LOGGER_H_
+#define STRATUM_HAL_LIB_COMMON_P4_REQUEST_LOGGER_H_
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>  // NOLINT
+#include <vector>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/synchronization/mutex.h"
+#include "stratum/glue/integral_types.h"
+#include "stratum/glue/status/status.h"
+#include "stratum/hal/lib/common/p4_request_log.pb.h"
+#include "stratum/lib/channel/channel.h"
+
+namespace stratum {
+namespace hal {
+
+// P4RequestLogger appends the P4Runtime write updates and read entities
+// handled by P4Service to a log file, for debugging and for replaying them
+// with stratum-replay. Log() only queues the entry on a bounded in-memory
+// Channel; a background thread formats the queued entries and writes them to
+// the file in batches, so that the RPC path does no file I/O. Entries logged
+// while the queue is full are dropped and counted.
+//
+// Two file formats are supported:
+//  - kText: one "<timestamp>;<node_id>;<request proto>;<error>" line per entry,
+//    the request being in proto short text format. This is the format parsed
+//    by stratum-replay.
+//  - kBinary: a sequence of serialized P4RequestLogEntry messages, each
+//    preceded by its size as a varint. Can be read with ReadBinaryLogFile().
+//
+// Once the log file reaches max_file_size bytes it is rotated: <path>.1 is
+// renamed to <path>.2 and so on, <path> is renamed to <path>.1 and a new
+// <path> is started, keeping at most max_rotated_files old files.
+class P4RequestLogger {
+ public:
+  enum class Format { kText, kBinary };
+
+  struct Options {
+    std::string path;
+    Format format = Format::kText;
+    // Size in bytes at which the log file is rotated. 0 disables rotation.
+    int64 max_file_size = 0;
+    // Number of rotated files to keep.
+    int max_rotated_files = 0;
+    // Max number of entries queued for the background thread.
+    size_t max_queue_size = 4096;
+  };
+
+  // Writes the entries still queued, then stops the background thread.
+  ~P4RequestLogger() LOCKS_EXCLUDED(lock_);
+
+  // Creates a logger and starts its background thread. The log file is opened
+  // by the background thread; failures to open or write it are logged and the
+  // affected entries are counted as dropped.
+  static std::unique_ptr<P4RequestLogger> CreateInstance(
+      const Options& options);
+
+  // Queues an entry for the background thread. Never blocks. Returns false if
+  // the queue is full, in which case the entry is dropped.
+  bool Log(P4RequestLogEntry&& entry);
+
+  // Blocks until all the entries queued before the call are processed by the
+  // background thread and written to the file.
+  void Flush() LOCKS_EXCLUDED(lock_);
+
+  // Number of entries dropped so far, because the queue was full or because
+  // they could not be written to the file.
+  uint64 NumDropped() const { return num_dropped_.load(); }
+
+  // Parses a log file written in the kBinary format.
+  static ::util::Status ReadBinaryLogFile(
+      const std::string& path, std::vector<P4RequestLogEntry>* entries);
+
+  // P4RequestLogger is neither copyable nor movable.
+  P4RequestLogger(const P4RequestLogger&) = delete;
+  P4RequestLogger& operator=(const P4RequestLogger&) = delete;
+
+ private:
+  // Private constructor. Use CreateInstance() to create an instance.
+  explicit P4RequestLogger(const Options& options);
+
+  // Main loop of the background thread.
+  void FlushThread() LOCKS_EXCLUDED(lock_);
+
+  // Appends the entry to the buffer, in the configured format.
+  void AppendEntry(const P4RequestLogEntry& entry, std::string* buffer) const;
+
+  // Appends the buffer to the log file, opening and rotating the file as
+  // needed. Only called by the background thread.
+  ::util::Status WriteToFile(const std::string& buffer);
+
+  // Closes the log file and shifts it and the rotated files by one.
+  ::util::Status RotateFile();
+
+  const Options options_;
+
+  // The queue of entries, read by the background thread.
+  std::shared_ptr<Channel<P4RequestLogEntry>> channel_;
+  std::unique_ptr<ChannelReader<P4RequestLogEntry>> reader_;
+  std::unique_ptr<ChannelWriter<P4RequestLogEntry>> writer_;
+
+  // File descriptor and size of the log file. Only accessed by the
+  // background thread.
+  int fd_;
+  int64 file_size_;
+
+  // Number of entries queued successfully and dropped so far.
+  std::atomic<uint64> num_queued_;
+  std::atomic<uint64> num_dropped_;
+
+  // Protects num_processed_, signaled every time a batch is processed.
+  mutable absl::Mutex lock_;
+  absl::CondVar processed_cond_;
+  // Number of queued entries processed by the background thread so far.
+  uint64 num_processed_ GUARDED_BY(lock_);
+
+  std::thread flush_thread_;
+};
+
+}  // namespace hal
+}  // namespace stratum
+
+#endif  // STRATUM_HAL_LIB_COMMON_P4_REQUEST_LOGGER_H_
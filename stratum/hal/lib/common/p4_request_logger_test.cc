@@ -0,0 +1,137 @@
+// Copyright 2018-present Open Networking Foundation
+// SPDX-License-Identifier: Apache-2.0
+
+#include "stratum/hal/lib/common/p4_request_logger.h"
+
+#include <string>
+#include <vector>
+
+#include "absl/strings/str_cat.h"
+#include "absl/time/time.h"
+#include "gflags/gflags.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "stratum/glue/status/status_test_util.h"
+#include "stratum/lib/test_utils/matchers.h"
+#include "stratum/lib/utils.h"
+
+DECLARE_string(test_tmpdir);
+
+namespace stratum {
+namespace hal {
+
+using test_utils::EqualsProto;
+using ::testing::HasSubstr;
+
+class P4RequestLoggerTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    options_.path = FLAGS_test_tmpdir + "/p4_request_log";
+    for (const std::string& path :
+         {options_.path, options_.path + ".1", options_.path + ".2",
+          options_.path + ".3"}) {
+      if (PathExists(path)) ASSERT_OK(RemoveFile(path));
+    }
+  }
+
+  static P4RequestLogEntry MakeUpdateEntry(int i) {
+    P4RequestLogEntry entry;
+    entry.set_timestamp_us(absl::ToUnixMicros(kTimestamp) + i);
+    entry.set_node_id(1);
+    auto* update = entry.mutable_update();
+    update->set_type(::p4::v1::Update::INSERT);
+    update->mutable_entity()->mutable_table_entry()->set_table_id(i);
+    return entry;
+  }
+
+  static constexpr absl::Time kTimestamp = absl::FromUnixSeconds(1500000000);
+
+  P4RequestLogger::Options options_;
+};
+
+constexpr absl::Time P4RequestLoggerTest::kTimestamp;
+
+TEST_F(P4RequestLoggerTest, TextFormat) {
+  P4RequestLogEntry read_entry;
+  read_entry.set_timestamp_us(absl::ToUnixMicros(kTimestamp));
+  read_entry.set_node_id(2);
+  read_entry.mutable_entity()->mutable_table_entry()->set_table_id(10);
+  read_entry.set_error_message("some error");
+
+  auto logger = P4RequestLogger::CreateInstance(options_);
+  EXPECT_TRUE(logger->Log(MakeUpdateEntry(1)));
+  EXPECT_TRUE(logger->Log(P4RequestLogEntry(read_entry)));
+  logger->Flush();
+
+  std::string s;
+  ASSERT_OK(ReadFileToString(options_.path, &s));
+  const std::string ts =
+      absl::FormatTime("%Y-%m-%d %H:%M:%E6S", kTimestamp + absl::Microseconds(1),
+                       absl::LocalTimeZone());
+  EXPECT_THAT(s, HasSubstr(absl::StrCat(
+                     ts, ";1;", MakeUpdateEntry(1).update().ShortDebugString(),
+                     ";\n")));
+  EXPECT_THAT(s, HasSubstr(absl::StrCat(
+                     ";2;", read_entry.entity().ShortDebugString(),
+                     ";some error\n")));
+  EXPECT_EQ(0, logger->NumDropped());
+}
+
+TEST_F(P4RequestLoggerTest, BinaryFormat) {
+  options_.format = P4RequestLogger::Format::kBinary;
+  {
+    auto logger = P4RequestLogger::CreateInstance(options_);
+    for (int i = 0; i < 100; ++i) EXPECT_TRUE(logger->Log(MakeUpdateEntry(i)));
+    // The destructor writes the queued entries.
+  }
+
+  std::vector<P4RequestLogEntry> entries;
+  ASSERT_OK(P4RequestLogger::ReadBinaryLogFile(options_.path, &entries));
+  ASSERT_EQ(100, entries.size());
+  for (int i = 0; i < 100; ++i) {
+    EXPECT_THAT(entries[i], EqualsProto(MakeUpdateEntry(i)));
+  }
+}
+
+TEST_F(P4RequestLoggerTest, RotatesBySize) {
+  options_.format = P4RequestLogger::Format::kBinary;
+  options_.max_file_size = 1;  // rotate after every batch
+  options_.max_rotated_files = 2;
+  auto logger = P4RequestLogger::CreateInstance(options_);
+  for (int i = 0; i < 4; ++i) {
+    EXPECT_TRUE(logger->Log(MakeUpdateEntry(i)));
+    logger->Flush();
+  }
+
+  // The last two batches are kept, the older ones are gone.
+  EXPECT_FALSE(PathExists(options_.path));
+  EXPECT_FALSE(PathExists(options_.path + ".3"));
+  std::vector<P4RequestLogEntry> entries;
+  ASSERT_OK(P4RequestLogger::ReadBinaryLogFile(options_.path + ".1", &entries));
+  ASSERT_EQ(1, entries.size());
+  EXPECT_THAT(entries[0], EqualsProto(MakeUpdateEntry(3)));
+  ASSERT_OK(P4RequestLogger::ReadBinaryLogFile(options_.path + ".2", &entries));
+  ASSERT_EQ(1, entries.size());
+  EXPECT_THAT(entries[0], EqualsProto(MakeUpdateEntry(2)));
+}
+
+TEST_F(P4RequestLoggerTest, DropsWhenQueueIsFull) {
+  options_.max_queue_size = 0;
+  auto logger = P4RequestLogger::CreateInstance(options_);
+  EXPECT_FALSE(logger->Log(MakeUpdateEntry(1)));
+  EXPECT_FALSE(logger->Log(MakeUpdateEntry(2)));
+  logger->Flush();
+  EXPECT_EQ(2, logger->NumDropped());
+  EXPECT_FALSE(PathExists(options_.path));
+}
+
+TEST_F(P4RequestLoggerTest, DropsWhenFileCannotBeWritten) {
+  options_.path = FLAGS_test_tmpdir + "/non/existing/dir/p4_request_log";
+  auto logger = P4RequestLogger::CreateInstance(options_);
+  EXPECT_TRUE(logger->Log(MakeUpdateEntry(1)));
+  logger->Flush();
+  EXPECT_EQ(1, logger->NumDropped());
+}
+
+}  // namespace hal
+}  // namespace stratum
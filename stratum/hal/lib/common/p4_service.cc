@@ -4,6 +4,7 @@
 
 #include "stratum/hal/lib/common/p4_service.h"
 
+#include <algorithm>
 #include <functional>
 #include <sstream>  // IWYU pragma: keep
 #include <utility>
@@ -12,6 +13,7 @@
 #include "absl/numeric/int128.h"
 #include "absl/strings/str_cat.h"
 #include "absl/synchronization/mutex.h"
+#include "absl/time/clock.h"
 #include "absl/time/time.h"
 #include "gflags/gflags.h"
 #include "google/protobuf/any.pb.h"
@@ -29,10 +31,23 @@
 
 DEFINE_string(forwarding_pipeline_configs_file,
               "/var/run/stratum/pipeline_cfg.pb.txt",
-              "The latest set of verified ForwardingPipelineConfig protos "
-              "pushed to the switch. This file is updated whenever "
-              "ForwardingPipelineConfig proto for switching node is added or "
-              "modified.");
+              "Text file with the set of verified ForwardingPipelineConfig "
+              "protos pushed to the switch. Only written if "
+              "--forwarding_pipeline_configs_text_export is true, for "
+              "debugging. On startup, the configs are read from this file if "
+              "none is saved in --forwarding_pipeline_configs_dir, e.g. after "
+              "an upgrade from a version which only saved the text file.");
+DEFINE_string(forwarding_pipeline_configs_dir, "",
+              "Dir where the latest verified ForwardingPipelineConfig proto "
+              "pushed to each switching node is saved, in binary format, one "
+              "file per node. The file of a node is replaced atomically "
+              "whenever the config of the node is added or modified. If "
+              "empty, the \"pipeline_cfgs\" subdir of the dir of "
+              "--forwarding_pipeline_configs_file is used.");
+DEFINE_bool(forwarding_pipeline_configs_text_export, false,
+            "Also save the forwarding pipeline configs of all the nodes to "
+            "--forwarding_pipeline_configs_file in text format whenever a "
+            "config is saved. Slow for large configs; for debugging only.");
 DEFINE_string(write_req_log_file, "/var/log/stratum/p4_writes.pb.txt",
               "The log file for all the individual write request updates and "
               "the corresponding result. The format for each line is: "
@@ -41,11 +56,38 @@ DEFINE_string(read_req_log_file, "/var/log/stratum/p4_reads.pb.txt",
               "The log file for all the individual read request and "
               "the corresponding result. The format for each line is: "
               "<timestamp>;<node_id>;<request proto>;<status>.");
+DEFINE_string(p4_req_log_format, "text",
+              "The format of the write and read request log files. Either "
+              "\"text\", for the format described for each file, or "
+              "\"binary\", for a sequence of length-delimited "
+              "P4RequestLogEntry protos.");
+DEFINE_int64(p4_req_log_max_file_size, 64 * 1024 * 1024,
+             "Size in bytes at which the write and read request log files are "
+             "rotated. 0 disables rotation.");
+DEFINE_int32(p4_req_log_max_rotated_files, 4,
+             "Number of rotated write and read request log files to keep.");
+DEFINE_int32(p4_req_log_queue_size, 16384,
+             "Max number of write updates or read entities waiting to be "
+             "written to a request log file. Requests logged while the queue "
+             "is full are dropped.");
 DEFINE_int32(max_num_controllers_per_node, 5,
              "Max number of controllers that can manage a node.");
 DEFINE_int32(max_num_controller_connections, 20,
              "Max number of active/inactive streaming connections from outside "
              "controllers (for all of the nodes combined).");
+DEFINE_int32(packet_in_max_batch_size, 64,
+             "Max number of PacketIns sent to the master controller of a node "
+             "as one batch, with a single flush of the stream. A batch only "
+             "holds the packets which are already queued when its first packet "
+             "is read, so packets are never held back to fill a batch. Set to "
+             "1 to send every packet on its own.");
+DEFINE_int32(packet_in_max_batch_delay_us, 1000,
+             "Max time in microseconds spent collecting the queued PacketIns "
+             "of a batch, before the batch is sent regardless of its size.");
+DEFINE_int32(packet_in_stats_log_interval_s, 600,
+             "Interval in seconds at which the PacketIn batching counters of "
+             "each node (batch size and queueing delay) are logged. 0 disables "
+             "the logs.");
 
 namespace stratum {
 namespace hal {
@@ -53,6 +95,37 @@ namespace hal {
 // TODO(unknown): This class move possibly big configs in memory. See if there
 // is a way to make this more efficient.
 
+namespace {
+
+// Creates the logger for the request log file with the given path, or returns
+// nullptr if the path is empty.
+std::unique_ptr<P4RequestLogger> CreateRequestLogger(const std::string& path) {
+  if (path.empty()) return nullptr;
+  P4RequestLogger::Options options;
+  options.path = path;
+  if (FLAGS_p4_req_log_format == "binary") {
+    options.format = P4RequestLogger::Format::kBinary;
+  } else if (FLAGS_p4_req_log_format != "text") {
+    LOG(ERROR) << "Unknown request log format '" << FLAGS_p4_req_log_format
+               << "'. Using the text format.";
+  }
+  options.max_file_size = FLAGS_p4_req_log_max_file_size;
+  options.max_rotated_files = FLAGS_p4_req_log_max_rotated_files;
+  options.max_queue_size = std::max(0, FLAGS_p4_req_log_queue_size);
+  return P4RequestLogger::CreateInstance(options);
+}
+
+// Returns the dir where the forwarding pipeline configs of the nodes are
+// saved.
+std::string ForwardingPipelineConfigsDir() {
+  if (!FLAGS_forwarding_pipeline_configs_dir.empty()) {
+    return FLAGS_forwarding_pipeline_configs_dir;
+  }
+  return DirName(FLAGS_forwarding_pipeline_configs_file) + "/pipeline_cfgs";
+}
+
+}  // namespace
+
 P4Service::P4Service(OperationMode mode, SwitchInterface* switch_interface,
                      AuthPolicyChecker* auth_policy_checker,
                      ErrorBuffer* error_buffer)
@@ -62,7 +135,10 @@ P4Service::P4Service(OperationMode mode, SwitchInterface* switch_interface,
       mode_(mode),
       switch_interface_(ABSL_DIE_IF_NULL(switch_interface)),
       auth_policy_checker_(ABSL_DIE_IF_NULL(auth_policy_checker)),
-      error_buffer_(ABSL_DIE_IF_NULL(error_buffer)) {}
+      error_buffer_(ABSL_DIE_IF_NULL(error_buffer)),
+      config_store_(ForwardingPipelineConfigsDir()),
+      write_req_logger_(CreateRequestLogger(FLAGS_write_req_log_file)),
+      read_req_logger_(CreateRequestLogger(FLAGS_read_req_log_file)) {}
 
 P4Service::~P4Service() {}
 
@@ -107,6 +183,11 @@ P4Service::~P4Service() {}
       }
     }
   }
+  {
+    absl::MutexLock l(&packet_in_stats_lock_);
+    packet_in_stats_.clear();
+    packet_in_stats_log_times_.clear();
+  }
   {
     absl::WriterMutexLock l(&config_lock_);
     forwarding_pipeline_configs_ = nullptr;
@@ -119,15 +200,33 @@ P4Service::~P4Service() {}
   // Try to read the saved forwarding pipeline configs for all the nodes and
   // push them to the nodes.
   LOG(INFO) << "Pushing the saved forwarding pipeline configs read from "
-            << FLAGS_forwarding_pipeline_configs_file << "...";
+            << config_store_.dir() << "...";
   absl::WriterMutexLock l(&config_lock_);
   ForwardingPipelineConfigs configs;
-  ::util::Status status =
-      ReadProtoFromTextFile(FLAGS_forwarding_pipeline_configs_file, &configs);
+  ::util::Status status = config_store_.LoadAll(&configs);
+  if (status.error_code() == ERR_FILE_NOT_FOUND) {
+    // Nothing saved in the binary format yet. Fall back to the text file and
+    // convert its content, so that the configs of the nodes not pushed again
+    // are not lost once the first binary config is saved.
+    status =
+        ReadProtoFromTextFile(FLAGS_forwarding_pipeline_configs_file, &configs);
+    if (status.ok() && configs.node_id_to_config_size() > 0) {
+      LOG(INFO) << "Converting the forwarding pipeline configs read from "
+                << FLAGS_forwarding_pipeline_configs_file << " to "
+                << config_store_.dir() << ".";
+      for (const auto& e : configs.node_id_to_config()) {
+        ::util::Status error = config_store_.Save(e.first, e.second);
+        LOG_IF(ERROR, !error.ok())
+            << "Failed to save the forwarding pipeline config for node "
+            << e.first << ": " << error.error_message();
+      }
+    }
+  }
   if (!status.ok()) {
     if (!warmboot && status.error_code() == ERR_FILE_NOT_FOUND) {
       // Not a critical error. If coldboot, we don't even return error.
       LOG(WARNING) << "No saved forwarding pipeline config found at "
+                   << config_store_.dir() << " or "
                    << FLAGS_forwarding_pipeline_configs_file
                    << ". This is normal when the switch is just installed and "
                    << "no master controller is connected yet.";
@@ -209,10 +308,12 @@ namespace {
 }
 
 // Helper to facilitate logging the write requests to the desired log file.
-void LogWriteRequest(uint64 node_id, const ::p4::v1::WriteRequest& req,
+// Only queues the requests, the file is written by the logger thread.
+void LogWriteRequest(P4RequestLogger* logger, uint64 node_id,
+                     const ::p4::v1::WriteRequest& req,
                      const std::vector<::util::Status>& results,
                      const absl::Time timestamp) {
-  if (FLAGS_write_req_log_file.empty()) {
+  if (logger == nullptr) {
     return;
   }
   if (results.size() != req.updates_size()) {
@@ -220,42 +321,32 @@ void LogWriteRequest(uint64 node_id, const ::p4::v1::WriteRequest& req,
                << " != " << req.updates_size() << ". Did not log anything!";
     return;
   }
-  std::string msg = "";
-  std::string ts =
-      absl::FormatTime("%Y-%m-%d %H:%M:%E6S", timestamp, absl::LocalTimeZone());
   for (size_t i = 0; i < results.size(); ++i) {
-    absl::StrAppend(&msg, ts, ";", node_id, ";",
-                    req.updates(i).ShortDebugString(), ";",
-                    results[i].error_message(), "\n");
-  }
-  ::util::Status status =
-      WriteStringToFile(msg, FLAGS_write_req_log_file, /*append=*/true);
-  if (!status.ok()) {
-    LOG_EVERY_N(ERROR, 50) << "Failed to log the write request: "
-                           << status.error_message();
+    P4RequestLogEntry entry;
+    entry.set_timestamp_us(absl::ToUnixMicros(timestamp));
+    entry.set_node_id(node_id);
+    *entry.mutable_update() = req.updates(i);
+    entry.set_error_message(results[i].error_message());
+    logger->Log(std::move(entry));
   }
 }
 
 // Helper to facilitate logging the read requests to the desired log file.
-void LogReadRequest(uint64 node_id, const ::p4::v1::ReadRequest& req,
+// Only queues the requests, the file is written by the logger thread.
+void LogReadRequest(P4RequestLogger* logger, uint64 node_id,
+                    const ::p4::v1::ReadRequest& req,
                     const std::vector<::util::Status>& results,
                     const absl::Time timestamp) {
-  if (FLAGS_read_req_log_file.empty()) {
+  if (logger == nullptr) {
     return;
   }
-  std::string msg = "";
-  std::string ts =
-      absl::FormatTime("%Y-%m-%d %H:%M:%E6S", timestamp, absl::LocalTimeZone());
-  for (size_t i = 0; i < results.size(); ++i) {
-    absl::StrAppend(&msg, ts, ";", node_id, ";",
-                    req.entities(i).ShortDebugString(), ";",
-                    results[i].error_message(), "\n");
-  }
-  ::util::Status status =
-      WriteStringToFile(msg, FLAGS_read_req_log_file, /*append=*/true);
-  if (!status.ok()) {
-    LOG_EVERY_N(ERROR, 50) << "Failed to log the read request: "
-                           << status.error_message();
+  for (size_t i = 0; i < results.size() && i < req.entities_size(); ++i) {
+    P4RequestLogEntry entry;
+    entry.set_timestamp_us(absl::ToUnixMicros(timestamp));
+    entry.set_node_id(node_id);
+    *entry.mutable_entity() = req.entities(i);
+    entry.set_error_message(results[i].error_message());
+    logger->Log(std::move(entry));
   }
 }
 
@@ -313,7 +404,7 @@ void LogReadRequest(uint64 node_id, const ::p4::v1::ReadRequest& req,
   }
 
   // Log debug info for future debugging.
-  LogWriteRequest(node_id, *req, results, timestamp);
+  LogWriteRequest(write_req_logger_.get(), node_id, *req, results, timestamp);
 
   return ToGrpcStatus(status, results);
 }
@@ -340,7 +431,8 @@ void LogReadRequest(uint64 node_id, const ::p4::v1::ReadRequest& req,
   }
 
   // Log debug info for future debugging.
-  LogReadRequest(req->device_id(), *req, details, timestamp);
+  LogReadRequest(read_req_logger_.get(), req->device_id(), *req, details,
+                 timestamp);
 
   return ToGrpcStatus(status, details);
 }
@@ -389,13 +481,7 @@ void LogReadRequest(uint64 node_id, const ::p4::v1::ReadRequest& req,
     case ::p4::v1::SetForwardingPipelineConfigRequest::VERIFY_AND_COMMIT:
     case ::p4::v1::SetForwardingPipelineConfigRequest::VERIFY_AND_SAVE: {
       absl::WriterMutexLock l(&config_lock_);
-      // configs_to_save_in_file will have a copy of the configs that will be
-      // saved in file at the end. Note that this copy may NOT be the same as
-      // forwarding_pipeline_configs_.
-      ForwardingPipelineConfigs configs_to_save_in_file;
-      if (forwarding_pipeline_configs_ != nullptr) {
-        configs_to_save_in_file = *forwarding_pipeline_configs_;
-      } else {
+      if (forwarding_pipeline_configs_ == nullptr) {
         forwarding_pipeline_configs_ =
             absl::make_unique<ForwardingPipelineConfigs>();
       }
@@ -415,12 +501,20 @@ void LogReadRequest(uint64 node_id, const ::p4::v1::ReadRequest& req,
       // TODO(unknown): this may not be appropriate for the VERIFY_AND_SAVE ->
       // COMMIT sequence of operations.
       if (error.ok() || error.error_code() == ERR_REBOOT_REQUIRED) {
-        (*configs_to_save_in_file.mutable_node_id_to_config())[node_id] =
-            req->config();
-        APPEND_STATUS_IF_ERROR(
-            status,
-            WriteProtoToTextFile(configs_to_save_in_file,
-                                 FLAGS_forwarding_pipeline_configs_file));
+        APPEND_STATUS_IF_ERROR(status,
+                               config_store_.Save(node_id, req->config()));
+        if (FLAGS_forwarding_pipeline_configs_text_export) {
+          // The text file holds the configs of all the nodes. Note that this
+          // copy may NOT be the same as forwarding_pipeline_configs_.
+          ForwardingPipelineConfigs configs_to_save_in_file =
+              *forwarding_pipeline_configs_;
+          (*configs_to_save_in_file.mutable_node_id_to_config())[node_id] =
+              req->config();
+          APPEND_STATUS_IF_ERROR(
+              status,
+              WriteProtoToTextFile(configs_to_save_in_file,
+                                   FLAGS_forwarding_pipeline_configs_file));
+        }
       }
       if (error.ok()) {
         (*forwarding_pipeline_configs_->mutable_node_id_to_config())[node_id] =
@@ -650,19 +744,19 @@ void LogReadRequest(uint64 node_id, const ::p4::v1::ReadRequest& req,
     // This is the first time we are hearing about this node. Lets try to add
     // an RX packet writer for it. If the node_id is invalid, registration will
     // fail.
-    std::shared_ptr<Channel<::p4::v1::PacketIn>> channel =
-        Channel<::p4::v1::PacketIn>::Create(128);
+    std::shared_ptr<Channel<TimestampedPacketIn>> channel =
+        Channel<TimestampedPacketIn>::Create(128);
     // Create the writer and register with the SwitchInterface.
-    auto writer = std::make_shared<ChannelWriterWrapper<::p4::v1::PacketIn>>(
-        ChannelWriter<::p4::v1::PacketIn>::Create(channel));
+    auto writer = std::make_shared<PacketInWriter>(
+        ChannelWriter<TimestampedPacketIn>::Create(channel));
     RETURN_IF_ERROR(
         switch_interface_->RegisterPacketReceiveWriter(node_id, writer));
     // Create the reader and pass it to a new thread.
-    auto reader = ChannelReader<::p4::v1::PacketIn>::Create(channel);
+    auto reader = ChannelReader<TimestampedPacketIn>::Create(channel);
     pthread_t tid = 0;
     int ret = pthread_create(
         &tid, nullptr, PacketReceiveThreadFunc,
-        new ReaderArgs<::p4::v1::PacketIn>{this, std::move(reader), node_id});
+        new ReaderArgs<TimestampedPacketIn>{this, std::move(reader), node_id});
     if (ret) {
       // Clean up state and return error.
       RETURN_IF_ERROR(
@@ -834,8 +928,27 @@ bool P4Service::IsMasterController(uint64 node_id, uint64 connection_id) const {
   return it->second.begin()->connection_id() == connection_id;
 }
 
+P4Service::PacketInStats P4Service::GetPacketInStats(uint64 node_id) const {
+  absl::MutexLock l(&packet_in_stats_lock_);
+  auto it = packet_in_stats_.find(node_id);
+  if (it == packet_in_stats_.end()) return PacketInStats();
+  return it->second;
+}
+
+bool P4Service::PacketInWriter::Write(const ::p4::v1::PacketIn& msg) {
+  if (!writer_) return false;
+  auto status = writer_->Write(TimestampedPacketIn{msg, absl::Now()},
+                               absl::InfiniteDuration());
+  if (!status.ok()) {
+    VLOG(3) << "Unable to write to Channel with error code: "
+            << status.error_code() << ".";
+    return false;
+  }
+  return true;
+}
+
 void* P4Service::PacketReceiveThreadFunc(void* arg) {
-  auto* args = reinterpret_cast<ReaderArgs<::p4::v1::PacketIn>*>(arg);
+  auto* args = reinterpret_cast<ReaderArgs<TimestampedPacketIn>*>(arg);
   auto* p4_service = args->p4_service;
   auto node_id = args->node_id;
   auto reader = std::move(args->reader);
@@ -844,9 +957,11 @@ void* P4Service::PacketReceiveThreadFunc(void* arg) {
 }
 
 void* P4Service::ReceivePackets(
-    uint64 node_id, std::unique_ptr<ChannelReader<::p4::v1::PacketIn>> reader) {
+    uint64 node_id,
+    std::unique_ptr<ChannelReader<TimestampedPacketIn>> reader) {
+  std::vector<TimestampedPacketIn> batch;
   do {
-    ::p4::v1::PacketIn packet_in;
+    TimestampedPacketIn packet_in;
     // Block on next packet RX from Channel.
     int code = reader->Read(&packet_in, absl::InfiniteDuration()).error_code();
     // Exit if the Channel is closed.
@@ -856,21 +971,92 @@ void* P4Service::ReceivePackets(
       LOG(ERROR) << "Read with infinite timeout failed with ENTRY_NOT_FOUND.";
       continue;
     }
-    // Handle PacketIn.
-    PacketReceiveHandler(node_id, packet_in);
+    batch.push_back(std::move(packet_in));
+    // Add the packets which are already queued to the batch, without waiting
+    // for more, within the size and time budget of a batch.
+    const size_t max_batch_size =
+        std::max(1, FLAGS_packet_in_max_batch_size);
+    const absl::Time deadline =
+        absl::Now() + absl::Microseconds(FLAGS_packet_in_max_batch_delay_us);
+    while (batch.size() < max_batch_size && absl::Now() < deadline &&
+           reader->TryRead(&packet_in).ok()) {
+      batch.push_back(std::move(packet_in));
+    }
+    // Handle PacketIns.
+    PacketReceiveHandler(node_id, &batch);
+    batch.clear();
   } while (true);
   return nullptr;
 }
 
+void P4Service::PacketReceiveHandler(
+    uint64 node_id, std::vector<TimestampedPacketIn>* packets) {
+  if (packets->empty()) return;
+  // Build the responses before taking the lock.
+  std::vector<::p4::v1::StreamMessageResponse> resps(packets->size());
+  for (size_t i = 0; i < packets->size(); ++i) {
+    resps[i].mutable_packet()->Swap(&(*packets)[i].packet);
+  }
+  size_t num_written = 0;
+  {
+    // We send the packets only to the master controller stream for this node.
+    absl::ReaderMutexLock l(&controller_lock_);
+    auto it = node_id_to_controllers_.find(node_id);
+    if (it != node_id_to_controllers_.end() && !it->second.empty()) {
+      auto* stream = it->second.begin()->stream();
+      // All the writes but the last one only buffer the response, so that the
+      // whole batch is sent with a single flush.
+      for (; num_written < resps.size(); ++num_written) {
+        ::grpc::WriteOptions options;
+        if (num_written + 1 < resps.size()) options.set_buffer_hint();
+        if (!stream->Write(resps[num_written], options)) break;
+      }
+    }
+  }
+  // Update the counters.
+  const absl::Time now = absl::Now();
+  absl::MutexLock l(&packet_in_stats_lock_);
+  PacketInStats& stats = packet_in_stats_[node_id];
+  stats.num_dropped += resps.size() - num_written;
+  if (num_written > 0) {
+    stats.num_batches++;
+    stats.num_packets += num_written;
+    stats.max_batch_size = std::max<uint64>(stats.max_batch_size, num_written);
+    for (size_t i = 0; i < num_written; ++i) {
+      absl::Duration delay = now - (*packets)[i].receive_time;
+      stats.total_queueing_delay += delay;
+      stats.max_queueing_delay = std::max(stats.max_queueing_delay, delay);
+    }
+  }
+  MaybeLogPacketInStats(node_id, stats, now);
+}
+
+void P4Service::MaybeLogPacketInStats(uint64 node_id,
+                                      const PacketInStats& stats,
+                                      absl::Time now) {
+  if (FLAGS_packet_in_stats_log_interval_s <= 0) return;
+  // The first interval starts with the first batch of the node.
+  absl::Time& log_time =
+      packet_in_stats_log_times_.emplace(node_id, now).first->second;
+  if (now - log_time < absl::Seconds(FLAGS_packet_in_stats_log_interval_s)) {
+    return;
+  }
+  log_time = now;
+  const uint64 num_batches = std::max<uint64>(stats.num_batches, 1);
+  const uint64 num_packets = std::max<uint64>(stats.num_packets, 1);
+  LOG(INFO) << "PacketIns of node " << node_id << ": " << stats.num_packets
+            << " sent in " << stats.num_batches << " batches (avg size "
+            << static_cast<double>(stats.num_packets) / num_batches
+            << ", max size " << stats.max_batch_size << "), "
+            << stats.num_dropped << " dropped, queueing delay avg "
+            << stats.total_queueing_delay / num_packets << ", max "
+            << stats.max_queueing_delay << ".";
+}
+
 void P4Service::PacketReceiveHandler(uint64 node_id,
                                      const ::p4::v1::PacketIn& packet) {
-  // We send the packets only to the master controller stream for this node.
-  absl::ReaderMutexLock l(&controller_lock_);
-  auto it = node_id_to_controllers_.find(node_id);
-  if (it == node_id_to_controllers_.end() || it->second.empty()) return;
-  ::p4::v1::StreamMessageResponse resp;
-  *resp.mutable_packet() = packet;
-  it->second.begin()->stream()->Write(resp);
+  std::vector<TimestampedPacketIn> packets = {{packet, absl::Now()}};
+  PacketReceiveHandler(node_id, &packets);
 }
 
 }  // namespace hal
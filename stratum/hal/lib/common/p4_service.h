@@ -17,6 +17,7 @@
 #include "absl/base/thread_annotations.h"
 #include "absl/numeric/int128.h"
 #include "absl/synchronization/mutex.h"
+#include "absl/time/time.h"
 #include "grpcpp/grpcpp.h"
 #include "p4/v1/p4runtime.grpc.pb.h"
 #include "stratum/glue/integral_types.h"
@@ -25,7 +26,10 @@
 #include "stratum/hal/lib/common/channel_writer_wrapper.h"
 #include "stratum/hal/lib/common/common.pb.h"
 #include "stratum/hal/lib/common/error_buffer.h"
+#include "stratum/hal/lib/common/forwarding_pipeline_config_store.h"
+#include "stratum/hal/lib/common/p4_request_logger.h"
 #include "stratum/hal/lib/common/switch_interface.h"
+#include "stratum/hal/lib/common/writer_interface.h"
 #include "stratum/hal/lib/p4/forwarding_pipeline_configs.pb.h"
 #include "stratum/lib/security/auth_policy_checker.h"
 
@@ -86,6 +90,25 @@ class P4Service final : public ::p4::v1::P4Runtime::Service {
     }
   };
 
+  // Counters for the PacketIns of a node, which are sent to the master
+  // controller in batches. Used to tune the PacketIn batching flags. They are
+  // also logged every FLAGS_packet_in_stats_log_interval_s.
+  struct PacketInStats {
+    // Number of batches and PacketIns written to the master controller stream.
+    uint64 num_batches = 0;
+    uint64 num_packets = 0;
+    // Number of PacketIns dropped because the node had no master controller
+    // or the write to its stream failed.
+    uint64 num_dropped = 0;
+    // Size of the largest batch written so far.
+    uint64 max_batch_size = 0;
+    // Time from the SwitchInterface handing a PacketIn to P4Service to the
+    // PacketIn being written to the stream, summed over all the written
+    // PacketIns and the maximum of it.
+    absl::Duration total_queueing_delay = absl::ZeroDuration();
+    absl::Duration max_queueing_delay = absl::ZeroDuration();
+  };
+
   P4Service(OperationMode mode, SwitchInterface* switch_interface,
             AuthPolicyChecker* auth_policy_checker, ErrorBuffer* error_buffer);
   ~P4Service() override;
@@ -99,7 +122,8 @@ class P4Service final : public ::p4::v1::P4Runtime::Service {
   // Tears down the class. Called in both warmboot or coldboot mode. It will
   // not alter any state on the hardware when called.
   ::util::Status Teardown()
-      LOCKS_EXCLUDED(config_lock_, controller_lock_, packet_in_thread_lock_);
+      LOCKS_EXCLUDED(config_lock_, controller_lock_, packet_in_thread_lock_,
+                     packet_in_stats_lock_);
 
   // Public helper function called in Setup().
   ::util::Status PushSavedForwardingPipelineConfigs(bool warmboot)
@@ -147,6 +171,11 @@ class P4Service final : public ::p4::v1::P4Runtime::Service {
       const ::p4::v1::CapabilitiesRequest* request,
       ::p4::v1::CapabilitiesResponse* response) override;
 
+  // Returns the PacketIn counters of the given node. All counters are zero for
+  // a node which has not received any packet.
+  PacketInStats GetPacketInStats(uint64 node_id) const
+      LOCKS_EXCLUDED(packet_in_stats_lock_);
+
   // P4Service is neither copyable nor movable.
   P4Service(const P4Service&) = delete;
   P4Service& operator=(const P4Service&) = delete;
@@ -160,6 +189,27 @@ class P4Service final : public ::p4::v1::P4Runtime::Service {
     uint64 node_id;
   };
 
+  // A PacketIn together with the time it was handed to P4Service by the
+  // SwitchInterface, used to measure the queueing delay of the PacketIn.
+  struct TimestampedPacketIn {
+    ::p4::v1::PacketIn packet;
+    absl::Time receive_time;
+  };
+
+  // The WriterInterface registered with the SwitchInterface for each node. It
+  // timestamps the received PacketIns and forwards them to the Channel read by
+  // the packet RX thread of the node.
+  class PacketInWriter : public WriterInterface<::p4::v1::PacketIn> {
+   public:
+    explicit PacketInWriter(
+        std::unique_ptr<ChannelWriter<TimestampedPacketIn>> writer)
+        : writer_(std::move(writer)) {}
+    bool Write(const ::p4::v1::PacketIn& msg) override;
+
+   private:
+    std::unique_ptr<ChannelWriter<TimestampedPacketIn>> writer_;
+  };
+
   // Specifies the max number of controllers that can connect for a node.
   static constexpr size_t kMaxNumControllerPerNode = 5;
 
@@ -206,15 +256,30 @@ class P4Service final : public ::p4::v1::P4Runtime::Service {
       LOCKS_EXCLUDED(controller_lock_);
 
   // Blocks on the Channel registered with SwitchInterface to read received
-  // packets.
+  // packets. Once a packet is read, the packets already queued behind it are
+  // drained as well (see FLAGS_packet_in_max_batch_size) and handed to
+  // PacketReceiveHandler() as a single batch.
   void* ReceivePackets(
-      uint64 node_id, std::unique_ptr<ChannelReader<::p4::v1::PacketIn>> reader)
+      uint64 node_id,
+      std::unique_ptr<ChannelReader<TimestampedPacketIn>> reader)
       LOCKS_EXCLUDED(controller_lock_);
 
-  // Callback to be called whenever we receive a packet on the specified node
-  // which is destined to controller.
+  // Callback to be called whenever we receive a batch of packets on the
+  // specified node which are destined to controller. The packets are moved
+  // out of the given vector.
+  void PacketReceiveHandler(uint64 node_id,
+                            std::vector<TimestampedPacketIn>* packets)
+      LOCKS_EXCLUDED(controller_lock_, packet_in_stats_lock_);
+
+  // Same as above for a single packet.
   void PacketReceiveHandler(uint64 node_id, const ::p4::v1::PacketIn& packet)
-      LOCKS_EXCLUDED(controller_lock_);
+      LOCKS_EXCLUDED(controller_lock_, packet_in_stats_lock_);
+
+  // Logs the PacketIn counters of the given node if they have not been logged
+  // for FLAGS_packet_in_stats_log_interval_s.
+  void MaybeLogPacketInStats(uint64 node_id, const PacketInStats& stats,
+                             absl::Time now)
+      EXCLUSIVE_LOCKS_REQUIRED(packet_in_stats_lock_);
 
   // Mutex lock used to protect node_id_to_controllers_ which is updated
   // every time mastership for any of the controllers connected to each node is
@@ -229,6 +294,9 @@ class P4Service final : public ::p4::v1::P4Runtime::Service {
   // Channels and threads.
   mutable absl::Mutex packet_in_thread_lock_;
 
+  // Mutex lock for protecting the PacketIn counters.
+  mutable absl::Mutex packet_in_stats_lock_;
+
   // Map from node ID to the set of Controller instances corresponding to the
   // external controller clients connected to that node. The Controller
   // instances for each node are sorted such that the master (Controller
@@ -242,9 +310,18 @@ class P4Service final : public ::p4::v1::P4Runtime::Service {
 
   // Map of per-node Channels which are used to forward received packets to
   // P4Service.
-  std::map<uint64, std::shared_ptr<Channel<::p4::v1::PacketIn>>>
+  std::map<uint64, std::shared_ptr<Channel<TimestampedPacketIn>>>
       packet_in_channels_ GUARDED_BY(packet_in_thread_lock_);
 
+  // Map from node ID to the PacketIn counters of that node.
+  std::map<uint64, PacketInStats> packet_in_stats_
+      GUARDED_BY(packet_in_stats_lock_);
+
+  // Map from node ID to the last time the PacketIn counters of that node were
+  // logged.
+  std::map<uint64, absl::Time> packet_in_stats_log_times_
+      GUARDED_BY(packet_in_stats_lock_);
+
   // Holds the IDs of all streaming connections. Every time there is a new
   // streaming connection, we select min{1,...,max(connection_ids_) + 1} as
   // the ID of the new connection. Also, whenever the connection is dropped
@@ -277,6 +354,17 @@ class P4Service final : public ::p4::v1::P4Runtime::Service {
   // by this class.
   ErrorBuffer* error_buffer_;
 
+  // Persists the forwarding pipeline config of each node, so that it can be
+  // pushed again by Setup() after a restart. Set up on creation according to
+  // FLAGS_forwarding_pipeline_configs_dir. Accessed under config_lock_.
+  const ForwardingPipelineConfigStore config_store_;
+
+  // Loggers for the write and read requests, set up on creation according to
+  // FLAGS_write_req_log_file and FLAGS_read_req_log_file. nullptr if logging
+  // of the corresponding requests is disabled.
+  std::unique_ptr<P4RequestLogger> write_req_logger_;
+  std::unique_ptr<P4RequestLogger> read_req_logger_;
+
   friend class P4ServiceTest;
 };
 
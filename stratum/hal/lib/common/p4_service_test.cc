@@ -5,11 +5,13 @@
 #include "stratum/hal/lib/common/p4_service.h"
 
 #include <memory>
+#include <vector>
 
 #include "absl/memory/memory.h"
 #include "absl/numeric/int128.h"
 #include "absl/strings/substitute.h"
 #include "absl/synchronization/mutex.h"
+#include "absl/time/clock.h"
 #include "gflags/gflags.h"
 #include "gmock/gmock.h"
 #include "google/rpc/code.pb.h"
@@ -29,6 +31,7 @@
 DECLARE_int32(max_num_controllers_per_node);
 DECLARE_int32(max_num_controller_connections);
 DECLARE_string(forwarding_pipeline_configs_file);
+DECLARE_string(forwarding_pipeline_configs_dir);
 DECLARE_string(write_req_log_file);
 DECLARE_string(test_tmpdir);
 
@@ -56,6 +59,23 @@ class P4ServiceTest : public ::testing::TestWithParam<OperationMode> {
     switch_mock_ = absl::make_unique<SwitchMock>();
     auth_policy_checker_mock_ = absl::make_unique<AuthPolicyCheckerMock>();
     error_buffer_ = absl::make_unique<ErrorBuffer>();
+    FLAGS_max_num_controllers_per_node = 5;
+    FLAGS_max_num_controller_connections = 20;
+    FLAGS_forwarding_pipeline_configs_file =
+        FLAGS_test_tmpdir + "/forwarding_pipeline_configs_file.pb.txt";
+    FLAGS_forwarding_pipeline_configs_dir =
+        FLAGS_test_tmpdir + "/forwarding_pipeline_configs";
+    // The configs read from the text file are also saved in binary format on
+    // setup. Remove them so that each test only sees the configs it saves.
+    ASSERT_OK(ForwardingPipelineConfigStore(
+                  FLAGS_forwarding_pipeline_configs_dir)
+                  .Clear());
+    FLAGS_write_req_log_file = FLAGS_test_tmpdir + "/write_req_log_fil.csv";
+    // Before starting the tests, remove the write req file if exists.
+    if (PathExists(FLAGS_write_req_log_file)) {
+      ASSERT_OK(RemoveFile(FLAGS_write_req_log_file));
+    }
+    // The request log files are opened by P4Service on creation.
     p4_service_ = absl::make_unique<P4Service>(mode_, switch_mock_.get(),
                                                auth_policy_checker_mock_.get(),
                                                error_buffer_.get());
@@ -69,23 +89,23 @@ class P4ServiceTest : public ::testing::TestWithParam<OperationMode> {
     stub_ = ::p4::v1::P4Runtime::NewStub(
         ::grpc::CreateChannel(url, ::grpc::InsecureChannelCredentials()));
     ASSERT_NE(stub_, nullptr);
-    FLAGS_max_num_controllers_per_node = 5;
-    FLAGS_max_num_controller_connections = 20;
-    FLAGS_forwarding_pipeline_configs_file =
-        FLAGS_test_tmpdir + "/forwarding_pipeline_configs_file.pb.txt";
-    FLAGS_write_req_log_file = FLAGS_test_tmpdir + "/write_req_log_fil.csv";
-    // Before starting the tests, remove the write req file if exists.
-    if (PathExists(FLAGS_write_req_log_file)) {
-      ASSERT_OK(RemoveFile(FLAGS_write_req_log_file));
-    }
   }
 
   void TearDown() override { server_->Shutdown(); }
 
+  // Waits for the logged write requests to be written to the log file.
+  void FlushWriteRequestLog() { p4_service_->write_req_logger_->Flush(); }
+
   void OnPacketReceive(const ::p4::v1::PacketIn& packet) {
     p4_service_->PacketReceiveHandler(kNodeId1, packet);
   }
 
+  void OnPacketBatchReceive(const std::vector<::p4::v1::PacketIn>& packets) {
+    std::vector<P4Service::TimestampedPacketIn> batch;
+    for (const auto& packet : packets) batch.push_back({packet, absl::Now()});
+    p4_service_->PacketReceiveHandler(kNodeId1, &batch);
+  }
+
   void FillTestForwardingPipelineConfigsAndSave(
       ForwardingPipelineConfigs* configs) {
     const std::string& configs_text = absl::Substitute(
@@ -282,6 +302,24 @@ TEST_P(P4ServiceTest, WarmbootSetupSuccessForSavedConfig) {
   CheckForwardingPipelineConfigs(&configs, kNodeId2);
 }
 
+TEST_P(P4ServiceTest, WarmbootSetupSuccessForSavedBinaryConfigs) {
+  // The configs saved in binary format take precedence over the text file.
+  ForwardingPipelineConfigs configs;
+  FillTestForwardingPipelineConfigsAndSave(&configs);
+  configs.mutable_node_id_to_config()->at(kNodeId1).set_p4_device_config(
+      std::string("\x00\x01binary", 8));
+  configs.mutable_node_id_to_config()->erase(kNodeId2);
+  ForwardingPipelineConfigStore store(FLAGS_forwarding_pipeline_configs_dir);
+  ASSERT_OK(store.Save(kNodeId1, configs.node_id_to_config().at(kNodeId1)));
+
+  // Call and validate results.
+  ASSERT_OK(p4_service_->Setup(true));
+  const auto& errors = error_buffer_->GetErrors();
+  EXPECT_TRUE(errors.empty());
+  CheckForwardingPipelineConfigs(&configs, kNodeId1);
+  ASSERT_OK(p4_service_->Teardown());
+}
+
 TEST_P(P4ServiceTest, WarmbootSetupFailureForNoSavedConfig) {
   // Delete the saved config. There will be no config push.
   if (PathExists(FLAGS_forwarding_pipeline_configs_file)) {
@@ -384,6 +422,18 @@ TEST_P(P4ServiceTest, SetupAndPushForwardingPipelineConfigSuccess) {
   }
   ASSERT_OK(p4_service_->Teardown());
   CheckForwardingPipelineConfigs(nullptr, 0 /*ignored*/);
+
+  // The modified config is saved in binary format. The configs read from the
+  // text file on setup were saved in binary format as well.
+  ForwardingPipelineConfigs saved_configs;
+  ASSERT_OK(ForwardingPipelineConfigStore(FLAGS_forwarding_pipeline_configs_dir)
+                .LoadAll(&saved_configs));
+  EXPECT_THAT(saved_configs.node_id_to_config().at(kNodeId1),
+              EqualsProto(configs.node_id_to_config().at(kNodeId1)));
+  if (mode_ != OPERATION_MODE_COUPLED) {
+    EXPECT_THAT(saved_configs.node_id_to_config().at(kNodeId2),
+                EqualsProto(configs.node_id_to_config().at(kNodeId2)));
+  }
 }
 
 TEST_P(P4ServiceTest, VerifyForwardingPipelineConfigSuccess) {
@@ -590,6 +640,7 @@ TEST_P(P4ServiceTest, WriteSuccess) {
   EXPECT_TRUE(status.error_message().empty());
   EXPECT_TRUE(status.error_details().empty());
   std::string s;
+  FlushWriteRequestLog();
   ASSERT_OK(ReadFileToString(FLAGS_write_req_log_file, &s));
   EXPECT_THAT(s, HasSubstr(req.updates(0).ShortDebugString()));
 }
@@ -699,6 +750,7 @@ TEST_P(P4ServiceTest, WriteFailureWhenWriteForwardingEntriesFails) {
   const auto& errors = error_buffer_->GetErrors();
   EXPECT_TRUE(errors.empty());
   std::string s;
+  FlushWriteRequestLog();
   ASSERT_OK(ReadFileToString(FLAGS_write_req_log_file, &s));
   EXPECT_THAT(s, HasSubstr(req.updates(0).ShortDebugString()));
   EXPECT_THAT(s, HasSubstr(req.updates(1).ShortDebugString()));
@@ -1082,6 +1134,27 @@ TEST_P(P4ServiceTest, StreamChannelSuccess) {
   ASSERT_TRUE(stream3->Read(&resp));
   ASSERT_TRUE(ProtoEqual(resp.packet(), packet3));
 
+  //----------------------------------------------------------------------------
+  // A batch of packets is forwarded to the master back-to-back, in order.
+  ::p4::v1::PacketIn packet5 = packet3;
+  ::p4::v1::PacketIn packet6 = packet3;
+  packet5.set_payload("packet5");
+  packet6.set_payload("packet6");
+  OnPacketBatchReceive({packet5, packet6});
+
+  ASSERT_TRUE(stream3->Read(&resp));
+  ASSERT_TRUE(ProtoEqual(resp.packet(), packet5));
+  ASSERT_TRUE(stream3->Read(&resp));
+  ASSERT_TRUE(ProtoEqual(resp.packet(), packet6));
+
+  // The packet received before any connection was dropped.
+  P4Service::PacketInStats stats = p4_service_->GetPacketInStats(kNodeId1);
+  EXPECT_EQ(2U, stats.num_batches);
+  EXPECT_EQ(3U, stats.num_packets);
+  EXPECT_EQ(1U, stats.num_dropped);
+  EXPECT_EQ(2U, stats.max_batch_size);
+  EXPECT_LE(stats.max_queueing_delay, stats.total_queueing_delay);
+
   //----------------------------------------------------------------------------
   // Now Controller #1 disconnects. In this case there will be no mastership
   // change. And nothing will be sent to Controller #3 which is still master.
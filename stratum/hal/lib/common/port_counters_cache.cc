@@ -0,0 +1,168 @@
+// Copyright 2018-present Open Networking Foundation
+// SPDX-License-Identifier: Apache-2.0
+
+#include "stratum/hal/lib/common/port_counters_cache.h"
+
+#include "gflags/gflags.h"
+#include "stratum/glue/logging.h"
+#include "stratum/glue/status/status_macros.h"
+#include "stratum/hal/lib/common/writer_interface.h"
+#include "stratum/lib/macros.h"
+#include "stratum/public/lib/error.h"
+
+DEFINE_int32(port_counters_cache_max_age_ms, 100,
+             "Max age in milliseconds of the port counters used to answer "
+             "gNMI requests for the counter leaves of an interface. All the "
+             "leaves of a port requested within this time are served from a "
+             "single read of the port counters. 0 disables the cache.");
+
+DEFINE_int32(port_counters_cache_stats_log_interval_s, 600,
+             "Interval in seconds at which the port counters cache logs how "
+             "many reads of the port counters it has issued and avoided. 0 "
+             "disables the logs.");
+
+namespace stratum {
+namespace hal {
+
+namespace {
+
+// A WriterInterface saving the port counters of the DataResponse written to it.
+class PortCountersWriter : public WriterInterface<DataResponse> {
+ public:
+  explicit PortCountersWriter(PortCounters* counters)
+      : counters_(counters), has_counters_(false) {}
+
+  bool Write(const DataResponse& resp) override {
+    if (!resp.has_port_counters()) return false;
+    *counters_ = resp.port_counters();
+    has_counters_ = true;
+    return true;
+  }
+
+  bool has_counters() const { return has_counters_; }
+
+ private:
+  PortCounters* counters_;  // not owned.
+  bool has_counters_;
+};
+
+}  // namespace
+
+PortCountersCache::PortCountersCache(SwitchInterface* switch_interface)
+    : PortCountersCache(
+          switch_interface,
+          absl::Milliseconds(FLAGS_port_counters_cache_max_age_ms)) {}
+
+PortCountersCache::PortCountersCache(SwitchInterface* switch_interface,
+                                     absl::Duration max_age)
+    : switch_interface_(switch_interface),
+      max_age_(max_age),
+      stats_(),
+      stats_log_time_(absl::Now()) {}
+
+::util::StatusOr<PortCounters> PortCountersCache::GetPortCounters(
+    uint64 node_id, uint32 port_id) {
+  if (max_age_ <= absl::ZeroDuration()) {
+    auto counters = ReadPortCounters(node_id, port_id);
+    absl::MutexLock l(&lock_);
+    CountSwitchRead(counters.status(), absl::Now());
+    return counters;
+  }
+
+  std::shared_ptr<PortEntry> entry;
+  const absl::Time now = absl::Now();
+  {
+    absl::MutexLock l(&lock_);
+    auto& port_entry = port_entries_[std::make_pair(node_id, port_id)];
+    if (!port_entry) port_entry = std::make_shared<PortEntry>();
+    entry = port_entry;
+    if (entry->has_snapshot && now - entry->read_time < max_age_) {
+      CountReadAvoided(now);
+      return entry->counters;
+    }
+    if (entry->read_in_flight) {
+      // Share the result of the read in flight.
+      while (entry->read_in_flight) entry->read_done.Wait(&lock_);
+      CountReadAvoided(now);
+      RETURN_IF_ERROR(entry->read_status);
+      return entry->counters;
+    }
+    entry->read_in_flight = true;
+  }
+
+  auto counters = ReadPortCounters(node_id, port_id);
+
+  absl::MutexLock l(&lock_);
+  entry->read_in_flight = false;
+  entry->read_status = counters.status();
+  // A failed read is not cached: the next request reads the port again.
+  if (counters.ok()) {
+    entry->has_snapshot = true;
+    entry->counters = counters.ValueOrDie();
+    entry->read_time = now;
+  }
+  entry->read_done.SignalAll();
+  CountSwitchRead(counters.status(), now);
+
+  return counters;
+}
+
+void PortCountersCache::Clear() {
+  absl::MutexLock l(&lock_);
+  port_entries_.clear();
+}
+
+PortCountersCache::Stats PortCountersCache::GetStats() const {
+  absl::MutexLock l(&lock_);
+  return stats_;
+}
+
+void PortCountersCache::CountSwitchRead(const ::util::Status& status,
+                                        absl::Time now) {
+  ++stats_.num_switch_reads;
+  if (!status.ok()) ++stats_.num_failed_reads;
+  MaybeLogStats(now);
+}
+
+void PortCountersCache::CountReadAvoided(absl::Time now) {
+  ++stats_.num_reads_avoided;
+  MaybeLogStats(now);
+}
+
+void PortCountersCache::MaybeLogStats(absl::Time now) {
+  if (FLAGS_port_counters_cache_stats_log_interval_s <= 0) return;
+  if (now - stats_log_time_ <
+      absl::Seconds(FLAGS_port_counters_cache_stats_log_interval_s)) {
+    return;
+  }
+  stats_log_time_ = now;
+  LOG(INFO) << "Port counters cache: " << stats_.num_switch_reads
+            << " SwitchInterface reads (" << stats_.num_failed_reads
+            << " failed), " << stats_.num_reads_avoided << " reads avoided.";
+}
+
+::util::StatusOr<PortCounters> PortCountersCache::ReadPortCounters(
+    uint64 node_id, uint32 port_id) {
+  CHECK_RETURN_IF_FALSE(switch_interface_ != nullptr)
+      << "Null switch interface.";
+  DataRequest req;
+  auto* request = req.add_requests()->mutable_port_counters();
+  request->set_node_id(node_id);
+  request->set_port_id(port_id);
+
+  PortCounters counters;
+  PortCountersWriter writer(&counters);
+  ::util::Status status = switch_interface_->RetrieveValue(
+      node_id, req, &writer, /* details= */ nullptr);
+  if (!status.ok()) return status;
+  if (!writer.has_counters()) {
+    return MAKE_ERROR(ERR_INTERNAL) << "No counters returned for port "
+                                    << port_id << " of node " << node_id
+                                    << ".";
+  }
+
+  return counters;
+}
+
+}  // namespace hal
+}  // namespace stratum
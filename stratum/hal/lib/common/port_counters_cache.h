@@ -0,0 +1,128 @@
+// Copyright 2018-present Open Networking Foundation
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef STRATUM_HAL_LIB_COMMON_PORT_COUNTERS_CACHE_H_
+#define STRATUM_HAL_LIB_COMMON_PORT_COUNTERS_CACHE_H_
+
+#include <memory>
+#include <utility>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/time.h"
+#include "stratum/glue/integral_types.h"
+#include "stratum/glue/status/statusor.h"
+#include "stratum/hal/lib/common/common.pb.h"
+#include "stratum/hal/lib/common/switch_interface.h"
+
+namespace stratum {
+namespace hal {
+
+// PortCountersCache keeps a snapshot of the PortCounters of each port, so that
+// all the gNMI counter leaves of a port sampled together are served from one
+// port_counters read of the SwitchInterface, instead of one read per leaf. A
+// snapshot is used for all requests made within max_age of the read that took
+// it; the first request after that reads the counters again. The default
+// max_age (FLAGS_port_counters_cache_max_age_ms) is much shorter than the
+// usual sample intervals and longer than the time it takes to process one
+// sample of all the leaves, so in practice each port is read once per sample.
+//
+// The class is thread-safe. Concurrent requests for the same port result in a
+// single read of the SwitchInterface, which the other requests wait for and
+// share the result of. Requests for different ports do not wait for each
+// other.
+//
+// The cache counts the requests it serves without a SwitchInterface read and
+// logs its counters every FLAGS_port_counters_cache_stats_log_interval_s.
+class PortCountersCache {
+ public:
+  // Counters of the cache, to check how many SwitchInterface reads it saves.
+  struct Stats {
+    // Number of port_counters reads issued to the SwitchInterface, including
+    // the failed ones.
+    uint64 num_switch_reads = 0;
+    // Number of failed port_counters reads.
+    uint64 num_failed_reads = 0;
+    // Number of requests served from a snapshot or from the read in flight of
+    // another request, i.e. SwitchInterface reads avoided.
+    uint64 num_reads_avoided = 0;
+  };
+
+  // Uses the max_age given by FLAGS_port_counters_cache_max_age_ms.
+  explicit PortCountersCache(SwitchInterface* switch_interface);
+  // A max_age of zero disables the cache: every request reads the counters.
+  PortCountersCache(SwitchInterface* switch_interface, absl::Duration max_age);
+  ~PortCountersCache() {}
+
+  // Returns the counters of the given port, from the snapshot of the port if it
+  // is not older than max_age, or else read from the SwitchInterface. A failed
+  // read is not cached.
+  ::util::StatusOr<PortCounters> GetPortCounters(uint64 node_id, uint32 port_id)
+      LOCKS_EXCLUDED(lock_);
+
+  // Drops all the snapshots, so that the next request of each port reads the
+  // counters. Used when the set of ports changes.
+  void Clear() LOCKS_EXCLUDED(lock_);
+
+  // Returns the counters of the cache.
+  Stats GetStats() const LOCKS_EXCLUDED(lock_);
+
+  // PortCountersCache is neither copyable nor movable.
+  PortCountersCache(const PortCountersCache&) = delete;
+  PortCountersCache& operator=(const PortCountersCache&) = delete;
+
+ private:
+  // The state of a port: its last snapshot and the read in flight, if any.
+  // All the fields are guarded by lock_.
+  struct PortEntry {
+    // The last snapshot of the port, if has_snapshot is true.
+    bool has_snapshot = false;
+    PortCounters counters;
+    absl::Time read_time;
+    // Whether a request is reading the counters of the port. The requests
+    // waiting for it are signaled on read_done once it is over.
+    bool read_in_flight = false;
+    absl::CondVar read_done;
+    // Status of the last read, returned to the requests that waited for it.
+    ::util::Status read_status;
+  };
+
+  // Reads the counters of the given port from the SwitchInterface.
+  ::util::StatusOr<PortCounters> ReadPortCounters(uint64 node_id,
+                                                  uint32 port_id)
+      LOCKS_EXCLUDED(lock_);
+
+  // Counts a read of the SwitchInterface.
+  void CountSwitchRead(const ::util::Status& status, absl::Time now)
+      EXCLUSIVE_LOCKS_REQUIRED(lock_);
+
+  // Counts a request served without reading the SwitchInterface.
+  void CountReadAvoided(absl::Time now) EXCLUSIVE_LOCKS_REQUIRED(lock_);
+
+  // Logs the stats if they have not been logged for
+  // FLAGS_port_counters_cache_stats_log_interval_s.
+  void MaybeLogStats(absl::Time now) EXCLUSIVE_LOCKS_REQUIRED(lock_);
+
+  SwitchInterface* switch_interface_;  // not owned.
+  const absl::Duration max_age_;
+
+  // Protects the port entries and the stats. It is not held during the reads
+  // of the SwitchInterface.
+  mutable absl::Mutex lock_;
+
+  // Map from (node ID, port ID) to the state of the port. The entries are
+  // shared with the requests using them, so that Clear() can drop them while
+  // a read is in flight.
+  absl::flat_hash_map<std::pair<uint64, uint32>, std::shared_ptr<PortEntry>>
+      port_entries_ GUARDED_BY(lock_);
+
+  Stats stats_ GUARDED_BY(lock_);
+  // The last time the stats were logged.
+  absl::Time stats_log_time_ GUARDED_BY(lock_);
+};
+
+}  // namespace hal
+}  // namespace stratum
+
+#endif  // STRATUM_HAL_LIB_COMMON_PORT_COUNTERS_CACHE_H_
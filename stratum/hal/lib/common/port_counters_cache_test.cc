@@ -0,0 +1,204 @@
+// Copyright 2018-present Open Networking Foundation
+// SPDX-License-Identifier: Apache-2.0
+
+#include "stratum/hal/lib/common/port_counters_cache.h"
+
+#include <map>
+#include <thread>  // NOLINT
+#include <vector>
+
+#include "absl/synchronization/notification.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "stratum/glue/status/status_test_util.h"
+#include "stratum/hal/lib/common/switch_mock.h"
+#include "stratum/public/lib/error.h"
+
+namespace stratum {
+namespace hal {
+
+using ::testing::_;
+using ::testing::DoDefault;
+using ::testing::Invoke;
+using ::testing::Return;
+
+class PortCountersCacheTest : public ::testing::Test {
+ protected:
+  static constexpr uint64 kNodeId = 1;
+  static constexpr uint32 kPortId1 = 11;
+  static constexpr uint32 kPortId2 = 12;
+
+  void SetUp() override {
+    // Each read returns the port ID as in_octets and the number of reads of
+    // the port so far as out_octets.
+    ON_CALL(switch_mock_, RetrieveValue(_, _, _, _))
+        .WillByDefault(Invoke([this](uint64 node_id, const DataRequest& req,
+                                     WriterInterface<DataResponse>* writer,
+                                     std::vector<::util::Status>* details) {
+          EXPECT_EQ(1, req.requests_size());
+          const auto& request = req.requests(0).port_counters();
+          EXPECT_EQ(node_id, request.node_id());
+          DataResponse resp;
+          resp.mutable_port_counters()->set_in_octets(request.port_id());
+          resp.mutable_port_counters()->set_out_octets(
+              ++num_reads_[request.port_id()]);
+          writer->Write(resp);
+          return ::util::OkStatus();
+        }));
+  }
+
+  // Gets the counters of the port and returns their out_octets, i.e. the
+  // number of the read they come from.
+  static uint64 ReadNumber(PortCountersCache* cache, uint32 port_id) {
+    auto counters = cache->GetPortCounters(kNodeId, port_id);
+    EXPECT_OK(counters.status());
+    if (!counters.ok()) return 0;
+    EXPECT_EQ(port_id, counters.ValueOrDie().in_octets());
+    return counters.ValueOrDie().out_octets();
+  }
+
+  SwitchMock switch_mock_;
+  std::map<uint32, uint64> num_reads_;
+};
+
+constexpr uint64 PortCountersCacheTest::kNodeId;
+constexpr uint32 PortCountersCacheTest::kPortId1;
+constexpr uint32 PortCountersCacheTest::kPortId2;
+
+TEST_F(PortCountersCacheTest, ReadsEachPortOnceWithinMaxAge) {
+  EXPECT_CALL(switch_mock_, RetrieveValue(kNodeId, _, _, _)).Times(2);
+  PortCountersCache cache(&switch_mock_, absl::InfiniteDuration());
+  for (int i = 0; i < 14; ++i) {
+    EXPECT_EQ(1U, ReadNumber(&cache, kPortId1));
+    EXPECT_EQ(1U, ReadNumber(&cache, kPortId2));
+  }
+
+  const auto stats = cache.GetStats();
+  EXPECT_EQ(2U, stats.num_switch_reads);
+  EXPECT_EQ(26U, stats.num_reads_avoided);
+  EXPECT_EQ(0U, stats.num_failed_reads);
+}
+
+TEST_F(PortCountersCacheTest, CacheHitCountsReadAvoided) {
+  PortCountersCache cache(&switch_mock_, absl::InfiniteDuration());
+  EXPECT_EQ(1U, ReadNumber(&cache, kPortId1));
+  EXPECT_EQ(1U, cache.GetStats().num_switch_reads);
+  EXPECT_EQ(0U, cache.GetStats().num_reads_avoided);
+
+  EXPECT_EQ(1U, ReadNumber(&cache, kPortId1));
+  EXPECT_EQ(1U, cache.GetStats().num_switch_reads);
+  EXPECT_EQ(1U, cache.GetStats().num_reads_avoided);
+}
+
+TEST_F(PortCountersCacheTest, ReadsAgainWhenSnapshotExpires) {
+  const absl::Duration kMaxAge = absl::Milliseconds(20);
+  EXPECT_CALL(switch_mock_, RetrieveValue(kNodeId, _, _, _)).Times(2);
+  PortCountersCache cache(&switch_mock_, kMaxAge);
+  EXPECT_EQ(1U, ReadNumber(&cache, kPortId1));
+  absl::SleepFor(kMaxAge);
+  EXPECT_EQ(2U, ReadNumber(&cache, kPortId1));
+}
+
+TEST_F(PortCountersCacheTest, ZeroMaxAgeDisablesCache) {
+  EXPECT_CALL(switch_mock_, RetrieveValue(kNodeId, _, _, _)).Times(3);
+  PortCountersCache cache(&switch_mock_, absl::ZeroDuration());
+  EXPECT_EQ(1U, ReadNumber(&cache, kPortId1));
+  EXPECT_EQ(2U, ReadNumber(&cache, kPortId1));
+  EXPECT_EQ(3U, ReadNumber(&cache, kPortId1));
+  EXPECT_EQ(3U, cache.GetStats().num_switch_reads);
+  EXPECT_EQ(0U, cache.GetStats().num_reads_avoided);
+}
+
+TEST_F(PortCountersCacheTest, ClearDropsSnapshots) {
+  EXPECT_CALL(switch_mock_, RetrieveValue(kNodeId, _, _, _)).Times(2);
+  PortCountersCache cache(&switch_mock_, absl::InfiniteDuration());
+  EXPECT_EQ(1U, ReadNumber(&cache, kPortId1));
+  cache.Clear();
+  EXPECT_EQ(2U, ReadNumber(&cache, kPortId1));
+  EXPECT_EQ(2U, ReadNumber(&cache, kPortId1));
+}
+
+TEST_F(PortCountersCacheTest, FailedReadsAreNotCached) {
+  PortCountersCache cache(&switch_mock_, absl::InfiniteDuration());
+  EXPECT_CALL(switch_mock_, RetrieveValue(kNodeId, _, _, _))
+      .WillOnce(Return(
+          ::util::Status(StratumErrorSpace(), ERR_INTERNAL, "Read failed.")))
+      .WillOnce(Return(::util::OkStatus()))  // No response written.
+      .WillRepeatedly(DoDefault());
+  EXPECT_EQ(ERR_INTERNAL,
+            cache.GetPortCounters(kNodeId, kPortId1).status().error_code());
+  EXPECT_EQ(ERR_INTERNAL,
+            cache.GetPortCounters(kNodeId, kPortId1).status().error_code());
+  EXPECT_EQ(1U, ReadNumber(&cache, kPortId1));
+  EXPECT_EQ(1U, ReadNumber(&cache, kPortId1));
+
+  const auto stats = cache.GetStats();
+  EXPECT_EQ(3U, stats.num_switch_reads);
+  EXPECT_EQ(2U, stats.num_failed_reads);
+  EXPECT_EQ(1U, stats.num_reads_avoided);
+}
+
+TEST_F(PortCountersCacheTest, ConcurrentRequestsOfAPortShareOneRead) {
+  PortCountersCache cache(&switch_mock_, absl::InfiniteDuration());
+  absl::Notification read_started;
+  absl::Notification finish_read;
+  EXPECT_CALL(switch_mock_, RetrieveValue(kNodeId, _, _, _))
+      .WillOnce(Invoke([&](uint64 node_id, const DataRequest& req,
+                           WriterInterface<DataResponse>* writer,
+                           std::vector<::util::Status>* details) {
+        read_started.Notify();
+        finish_read.WaitForNotification();
+        DataResponse resp;
+        resp.mutable_port_counters()->set_in_octets(kPortId1);
+        resp.mutable_port_counters()->set_out_octets(1);
+        writer->Write(resp);
+        return ::util::OkStatus();
+      }));
+
+  std::thread first(
+      [&cache]() { EXPECT_EQ(1U, ReadNumber(&cache, kPortId1)); });
+  read_started.WaitForNotification();
+  std::thread second(
+      [&cache]() { EXPECT_EQ(1U, ReadNumber(&cache, kPortId1)); });
+  finish_read.Notify();
+  first.join();
+  second.join();
+
+  // The second request either shared the read in flight or found its
+  // snapshot.
+  EXPECT_EQ(1U, cache.GetStats().num_switch_reads);
+  EXPECT_EQ(1U, cache.GetStats().num_reads_avoided);
+}
+
+TEST_F(PortCountersCacheTest, ReadsOfDifferentPortsDoNotWaitForEachOther) {
+  PortCountersCache cache(&switch_mock_, absl::InfiniteDuration());
+  absl::Notification read_started;
+  absl::Notification finish_read;
+  // The read of the first port only completes once the second port has been
+  // read, which requires the reads not to be serialized.
+  EXPECT_CALL(switch_mock_, RetrieveValue(kNodeId, _, _, _))
+      .WillOnce(Invoke([&](uint64 node_id, const DataRequest& req,
+                           WriterInterface<DataResponse>* writer,
+                           std::vector<::util::Status>* details) {
+        read_started.Notify();
+        finish_read.WaitForNotification();
+        DataResponse resp;
+        resp.mutable_port_counters()->set_in_octets(kPortId1);
+        resp.mutable_port_counters()->set_out_octets(1);
+        writer->Write(resp);
+        return ::util::OkStatus();
+      }))
+      .WillOnce(DoDefault());
+
+  std::thread first(
+      [&cache]() { EXPECT_EQ(1U, ReadNumber(&cache, kPortId1)); });
+  read_started.WaitForNotification();
+  EXPECT_EQ(1U, ReadNumber(&cache, kPortId2));
+  finish_read.Notify();
+  first.join();
+}
+
+}  // namespace hal
+}  // namespace stratum
@@ -0,0 +1,122 @@
+// Copyright 2018-present Open Networking Foundation
+// SPDX-License-Identifier: Apache-2.0
+
+#include "stratum/hal/lib/common/port_counters_poller.h"
+
+#include <utility>
+#include <vector>
+
+#include "absl/time/clock.h"
+#include "gflags/gflags.h"
+#include "stratum/glue/logging.h"
+#include "stratum/glue/status/status_macros.h"
+#include "stratum/lib/macros.h"
+#include "stratum/public/lib/error.h"
+
+DEFINE_int32(port_counters_poll_interval_ms, 1000,
+             "Interval in milliseconds at which the chassis managers read the "
+             "counters of all the ports to publish the ones which changed to "
+             "the ON_CHANGE gNMI subscriptions. 0 disables the polling.");
+
+namespace stratum {
+namespace hal {
+
+PortCountersPoller::PortCountersPoller(uint64 node_id, ReadFunc read_func,
+                                       NotifyFunc notify_func)
+    : node_id_(node_id),
+      read_func_(std::move(read_func)),
+      notify_func_(std::move(notify_func)),
+      last_counters_(),
+      running_(false),
+      stopping_(false) {}
+
+PortCountersPoller::~PortCountersPoller() { Stop(); }
+
+::util::Status PortCountersPoller::Start(absl::Duration interval) {
+  CHECK_RETURN_IF_FALSE(interval > absl::ZeroDuration())
+      << "Invalid port counters poll interval " << interval << ".";
+  absl::MutexLock l(&lock_);
+  CHECK_RETURN_IF_FALSE(!running_)
+      << "The port counters poller of node " << node_id_
+      << " is already running.";
+  running_ = true;
+  stopping_ = false;
+  thread_ = std::thread([this, interval]() { Run(interval); });
+  LOG(INFO) << "Polling the port counters of node " << node_id_ << " every "
+            << interval << ".";
+
+  return ::util::OkStatus();
+}
+
+::util::Status PortCountersPoller::Start() {
+  if (FLAGS_port_counters_poll_interval_ms <= 0) return ::util::OkStatus();
+  return Start(absl::Milliseconds(FLAGS_port_counters_poll_interval_ms));
+}
+
+void PortCountersPoller::Stop() {
+  {
+    absl::MutexLock l(&lock_);
+    if (!running_) return;
+    stopping_ = true;
+    stop_cond_.Signal();
+  }
+  thread_.join();
+  absl::MutexLock l(&lock_);
+  running_ = false;
+}
+
+::util::StatusOr<int> PortCountersPoller::Sweep() {
+  absl::MutexLock l(&sweep_lock_);
+  std::map<uint32, PortCounters> counters;
+  RETURN_IF_ERROR(read_func_(&counters));
+
+  std::map<uint32, std::string> new_counters;
+  std::vector<std::pair<uint32, const PortCounters*>> changed;
+  auto last = last_counters_.begin();
+  for (const auto& e : counters) {
+    std::string& serialized = new_counters[e.first];
+    e.second.SerializeToString(&serialized);
+    // Both maps are ordered by port ID.
+    while (last != last_counters_.end() && last->first < e.first) ++last;
+    if (last != last_counters_.end() && last->first == e.first &&
+        last->second != serialized) {
+      changed.emplace_back(e.first, &e.second);
+    }
+  }
+  last_counters_.swap(new_counters);
+
+  for (const auto& e : changed) notify_func_(e.first, *e.second);
+
+  return changed.size();
+}
+
+void PortCountersPoller::Run(absl::Duration interval) {
+  absl::Time next_sweep = absl::Now();
+  while (true) {
+    {
+      absl::MutexLock l(&lock_);
+      while (!stopping_ && absl::Now() < next_sweep) {
+        stop_cond_.WaitWithDeadline(&lock_, next_sweep);
+      }
+      if (stopping_) break;
+    }
+    auto ret = Sweep();
+    if (!ret.ok() && ret.status().error_code() == ERR_NO_OP) {
+      VLOG(2) << "Skipped a sweep of the port counters of node " << node_id_
+              << ": " << ret.status().error_message();
+    } else if (!ret.ok()) {
+      LOG_EVERY_N(ERROR, 100) << "Failed to read the port counters of node "
+                              << node_id_ << ": " << ret.status();
+    } else {
+      VLOG(2) << "Counters of " << ret.ValueOrDie() << " ports of node "
+              << node_id_ << " changed.";
+    }
+    next_sweep += interval;
+    // Skips the sweeps missed if the previous ones were too slow.
+    const absl::Time now = absl::Now();
+    if (next_sweep < now) next_sweep = now;
+  }
+}
+
+}  // namespace hal
+}  // namespace stratum
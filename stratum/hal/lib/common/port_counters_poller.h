@@ -0,0 +1,94 @@
+// Copyright 2018-present Open Networking Foundation
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef STRATUM_HAL_LIB_COMMON_PORT_COUNTERS_POLLER_H_
+#define STRATUM_HAL_LIB_COMMON_PORT_COUNTERS_POLLER_H_
+
+#include <functional>
+#include <map>
+#include <string>
+#include <thread>  // NOLINT
+
+#include "absl/base/thread_annotations.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/time.h"
+#include "stratum/glue/integral_types.h"
+#include "stratum/glue/status/status.h"
+#include "stratum/glue/status/statusor.h"
+#include "stratum/hal/lib/common/common.pb.h"
+
+namespace stratum {
+namespace hal {
+
+// PortCountersPoller reads the counters of all the ports of a node in one
+// sweep, at a fixed interval, and reports the ports whose counters changed
+// since the previous sweep. The chassis managers of the targets whose SDK has
+// no counter change notification use it to publish PortCountersChangedEvents,
+// which serve the ON_CHANGE gNMI subscriptions to the interface counters.
+//
+// The first sweep of a port only records its counters. A port missing from a
+// sweep is forgotten.
+//
+// The class is thread-safe.
+class PortCountersPoller {
+ public:
+  // Reads the counters of all the ports of the node into 'counters', keyed by
+  // port ID. Returns ERR_NO_OP to skip the sweep, which is then not reported
+  // as a failure.
+  using ReadFunc =
+      std::function<::util::Status(std::map<uint32, PortCounters>* counters)>;
+  // Called with the new counters of each port whose counters changed.
+  using NotifyFunc =
+      std::function<void(uint32 port_id, const PortCounters& counters)>;
+
+  PortCountersPoller(uint64 node_id, ReadFunc read_func,
+                     NotifyFunc notify_func);
+  // Stops the polling thread.
+  ~PortCountersPoller() LOCKS_EXCLUDED(lock_);
+
+  // Starts a thread sweeping the ports every 'interval'.
+  ::util::Status Start(absl::Duration interval) LOCKS_EXCLUDED(lock_);
+  // Same as above, with the interval given by
+  // FLAGS_port_counters_poll_interval_ms. Does nothing if the flag is 0.
+  ::util::Status Start() LOCKS_EXCLUDED(lock_);
+
+  // Stops the polling thread, if running, and waits until it exits.
+  void Stop() LOCKS_EXCLUDED(lock_);
+
+  // Reads the counters of all the ports and calls the NotifyFunc for each port
+  // whose counters changed. Returns the number of such ports.
+  ::util::StatusOr<int> Sweep() LOCKS_EXCLUDED(sweep_lock_);
+
+  uint64 node_id() const { return node_id_; }
+
+  // PortCountersPoller is neither copyable nor movable.
+  PortCountersPoller(const PortCountersPoller&) = delete;
+  PortCountersPoller& operator=(const PortCountersPoller&) = delete;
+
+ private:
+  // Main loop of the polling thread.
+  void Run(absl::Duration interval) LOCKS_EXCLUDED(lock_);
+
+  const uint64 node_id_;
+  const ReadFunc read_func_;
+  const NotifyFunc notify_func_;
+
+  // Serializes the sweeps.
+  absl::Mutex sweep_lock_;
+
+  // Serialized counters of each port at the previous sweep, which is enough
+  // to tell whether they changed.
+  std::map<uint32, std::string> last_counters_ GUARDED_BY(sweep_lock_);
+
+  // Protects the state of the polling thread.
+  absl::Mutex lock_;
+  absl::CondVar stop_cond_;
+  bool running_ GUARDED_BY(lock_);
+  bool stopping_ GUARDED_BY(lock_);
+  std::thread thread_;
+};
+
+}  // namespace hal
+}  // namespace stratum
+
+#endif  // STRATUM_HAL_LIB_COMMON_PORT_COUNTERS_POLLER_H_
@@ -0,0 +1,73 @@
+// Copyright 2018-present Open Networking Foundation
+// SPDX-License-Identifier: Apache-2.0
+
+// Benchmarks one sweep of PortCountersPoller on a 256-port node. The read
+// function stands in for the SDK and returns the counters of all the ports;
+// the argument is the number of ports whose counters move between two sweeps.
+// The notified_per_sweep counter reports the number of PortCountersChanged
+// notifications sent per sweep.
+
+#include <map>
+
+#include "benchmark/benchmark.h"
+#include "stratum/glue/logging.h"
+#include "stratum/hal/lib/common/port_counters_poller.h"
+
+namespace stratum {
+namespace hal {
+namespace {
+
+constexpr uint64 kNodeId = 1;
+constexpr int kNumPorts = 256;
+
+void FillCounters(uint32 port_id, uint64 base, PortCounters* counters) {
+  counters->set_in_octets(base + 64 * port_id);
+  counters->set_out_octets(base + 128 * port_id);
+  counters->set_in_unicast_pkts(base + port_id);
+  counters->set_out_unicast_pkts(base + 2 * port_id);
+  counters->set_in_broadcast_pkts(port_id);
+  counters->set_out_broadcast_pkts(port_id);
+  counters->set_in_multicast_pkts(port_id);
+  counters->set_out_multicast_pkts(port_id);
+  counters->set_in_discards(port_id);
+  counters->set_out_discards(port_id);
+  counters->set_in_unknown_protos(port_id);
+  counters->set_in_errors(port_id);
+  counters->set_out_errors(port_id);
+  counters->set_in_fcs_errors(port_id);
+}
+
+void BM_Sweep(benchmark::State& state) {
+  const int num_changed_ports = state.range(0);
+  std::map<uint32, PortCounters> counters;
+  for (uint32 port_id = 1; port_id <= kNumPorts; ++port_id) {
+    FillCounters(port_id, 1000000, &counters[port_id]);
+  }
+  uint64 sweep = 0;
+  int64 num_notified = 0;
+  PortCountersPoller poller(
+      kNodeId,
+      [&](std::map<uint32, PortCounters>* out) {
+        // The first ports see some traffic between two sweeps.
+        ++sweep;
+        for (uint32 port_id = 1; port_id <= num_changed_ports; ++port_id) {
+          FillCounters(port_id, 1000000 + sweep * 1500, &counters[port_id]);
+        }
+        *out = counters;
+        return ::util::OkStatus();
+      },
+      [&](uint32 port_id, const PortCounters& c) { ++num_notified; });
+  CHECK(poller.Sweep().ok());
+
+  for (auto _ : state) {
+    auto ret = poller.Sweep();
+    benchmark::DoNotOptimize(ret);
+  }
+  state.counters["notified_per_sweep"] = benchmark::Counter(
+      static_cast<double>(num_notified) / state.iterations());
+}
+BENCHMARK(BM_Sweep)->Arg(0)->Arg(16)->Arg(kNumPorts);
+
+}  // namespace
+}  // namespace hal
+}  // namespace stratum
@@ -0,0 +1,152 @@
+// Copyright 2018-present Open Networking Foundation
+// SPDX-License-Identifier: Apache-2.0
+
+#include "stratum/hal/lib/common/port_counters_poller.h"
+
+#include <map>
+#include <vector>
+
+#include "absl/synchronization/mutex.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "stratum/glue/status/status_test_util.h"
+#include "stratum/public/lib/error.h"
+
+namespace stratum {
+namespace hal {
+
+using ::testing::ElementsAre;
+using ::testing::IsEmpty;
+
+class PortCountersPollerTest : public ::testing::Test {
+ protected:
+  static constexpr uint64 kNodeId = 1;
+
+  PortCountersPollerTest()
+      : poller_(
+            kNodeId,
+            [this](std::map<uint32, PortCounters>* counters) {
+              absl::MutexLock l(&lock_);
+              if (!read_status_.ok()) return read_status_;
+              *counters = counters_;
+              ++num_reads_;
+              return ::util::OkStatus();
+            },
+            [this](uint32 port_id, const PortCounters& counters) {
+              absl::MutexLock l(&lock_);
+              notified_ports_.push_back(port_id);
+              notified_counters_[port_id] = counters;
+            }) {}
+
+  void SetInOctets(uint32 port_id, uint64 in_octets) {
+    absl::MutexLock l(&lock_);
+    counters_[port_id].set_in_octets(in_octets);
+  }
+
+  std::vector<uint32> TakeNotifiedPorts() {
+    absl::MutexLock l(&lock_);
+    std::vector<uint32> ports;
+    ports.swap(notified_ports_);
+    return ports;
+  }
+
+  absl::Mutex lock_;
+  std::map<uint32, PortCounters> counters_ GUARDED_BY(lock_);
+  ::util::Status read_status_ GUARDED_BY(lock_);
+  int num_reads_ GUARDED_BY(lock_) = 0;
+  std::vector<uint32> notified_ports_ GUARDED_BY(lock_);
+  std::map<uint32, PortCounters> notified_counters_ GUARDED_BY(lock_);
+  PortCountersPoller poller_;
+};
+
+constexpr uint64 PortCountersPollerTest::kNodeId;
+
+TEST_F(PortCountersPollerTest, FirstSweepOnlyRecordsCounters) {
+  SetInOctets(1, 10);
+  SetInOctets(2, 20);
+  auto ret = poller_.Sweep();
+  ASSERT_OK(ret.status());
+  EXPECT_EQ(0, ret.ValueOrDie());
+  EXPECT_THAT(TakeNotifiedPorts(), IsEmpty());
+}
+
+TEST_F(PortCountersPollerTest, NotifiesOnlyPortsWhoseCountersChanged) {
+  for (uint32 port_id = 1; port_id <= 4; ++port_id) SetInOctets(port_id, 0);
+  ASSERT_OK(poller_.Sweep().status());
+
+  SetInOctets(2, 100);
+  SetInOctets(4, 400);
+  auto ret = poller_.Sweep();
+  ASSERT_OK(ret.status());
+  EXPECT_EQ(2, ret.ValueOrDie());
+  EXPECT_THAT(TakeNotifiedPorts(), ElementsAre(2, 4));
+  {
+    absl::MutexLock l(&lock_);
+    EXPECT_EQ(100U, notified_counters_[2].in_octets());
+    EXPECT_EQ(400U, notified_counters_[4].in_octets());
+  }
+
+  // Nothing moved.
+  ret = poller_.Sweep();
+  ASSERT_OK(ret.status());
+  EXPECT_EQ(0, ret.ValueOrDie());
+  EXPECT_THAT(TakeNotifiedPorts(), IsEmpty());
+}
+
+TEST_F(PortCountersPollerTest, NewPortsAreRecordedFirst) {
+  SetInOctets(1, 10);
+  ASSERT_OK(poller_.Sweep().status());
+  SetInOctets(1, 11);
+  SetInOctets(2, 20);
+  ASSERT_OK(poller_.Sweep().status());
+  EXPECT_THAT(TakeNotifiedPorts(), ElementsAre(1));
+  SetInOctets(2, 21);
+  ASSERT_OK(poller_.Sweep().status());
+  EXPECT_THAT(TakeNotifiedPorts(), ElementsAre(2));
+}
+
+TEST_F(PortCountersPollerTest, FailedReadKeepsPreviousCounters) {
+  SetInOctets(1, 10);
+  ASSERT_OK(poller_.Sweep().status());
+  {
+    absl::MutexLock l(&lock_);
+    read_status_ =
+        ::util::Status(StratumErrorSpace(), ERR_INTERNAL, "Read failed.");
+  }
+  EXPECT_EQ(ERR_INTERNAL, poller_.Sweep().status().error_code());
+  {
+    absl::MutexLock l(&lock_);
+    read_status_ = ::util::OkStatus();
+  }
+  SetInOctets(1, 11);
+  ASSERT_OK(poller_.Sweep().status());
+  EXPECT_THAT(TakeNotifiedPorts(), ElementsAre(1));
+}
+
+TEST_F(PortCountersPollerTest, PollsAtTheGivenInterval) {
+  SetInOctets(1, 0);
+  ASSERT_OK(poller_.Start(absl::Milliseconds(10)));
+  EXPECT_FALSE(poller_.Start(absl::Milliseconds(10)).ok());
+  absl::SleepFor(absl::Milliseconds(30));
+  SetInOctets(1, 1);
+  absl::SleepFor(absl::Milliseconds(70));
+  poller_.Stop();
+  int num_reads;
+  {
+    absl::MutexLock l(&lock_);
+    num_reads = num_reads_;
+  }
+  EXPECT_GE(num_reads, 5);
+  EXPECT_LE(num_reads, 12);
+  EXPECT_THAT(TakeNotifiedPorts(), ElementsAre(1));
+
+  // Stopped: no more reads.
+  absl::SleepFor(absl::Milliseconds(30));
+  absl::MutexLock l(&lock_);
+  EXPECT_EQ(num_reads, num_reads_);
+}
+
+}  // namespace hal
+}  // namespace stratum
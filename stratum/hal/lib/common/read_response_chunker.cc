@@ -0,0 +1,73 @@
+// Copyright 2018-present Open Networking Foundation
+// SPDX-License-Identifier: Apache-2.0
+
+#include "stratum/hal/lib/common/read_response_chunker.h"
+
+#include "gflags/gflags.h"
+#include "stratum/glue/logging.h"
+#include "stratum/glue/status/status_macros.h"
+#include "stratum/lib/macros.h"
+#include "stratum/public/lib/error.h"
+
+DEFINE_int32(read_response_max_entities, 1000,
+             "Max number of entities sent in one ReadResponse message when "
+             "streaming the result of a P4Runtime read. 0 means no limit.");
+DEFINE_int64(read_response_max_bytes, 1024 * 1024,
+             "Max size in bytes of the entities sent in one ReadResponse "
+             "message when streaming the result of a P4Runtime read. A "
+             "message is sent as soon as it reaches this size, so it can "
+             "exceed it by one entity. 0 means no limit.");
+
+namespace stratum {
+namespace hal {
+
+ReadResponseChunker::ReadResponseChunker(
+    WriterInterface<::p4::v1::ReadResponse>* writer)
+    : ReadResponseChunker(writer, FLAGS_read_response_max_entities,
+                          FLAGS_read_response_max_bytes) {}
+
+ReadResponseChunker::ReadResponseChunker(
+    WriterInterface<::p4::v1::ReadResponse>* writer, int max_entities,
+    int64 max_bytes)
+    : writer_(writer),
+      max_entities_(max_entities),
+      max_bytes_(max_bytes),
+      chunk_(),
+      chunk_bytes_(0),
+      num_chunks_sent_(0) {}
+
+::util::StatusOr<::p4::v1::Entity*> ReadResponseChunker::AddEntity() {
+  const int num_entities = chunk_.entities_size();
+  if (num_entities > 0) {
+    chunk_bytes_ += chunk_.entities(num_entities - 1).ByteSizeLong();
+    if ((max_entities_ > 0 && num_entities >= max_entities_) ||
+        (max_bytes_ > 0 && chunk_bytes_ >= max_bytes_)) {
+      RETURN_IF_ERROR(SendChunk());
+    }
+  }
+
+  return chunk_.add_entities();
+}
+
+::util::Status ReadResponseChunker::Flush() {
+  if (chunk_.entities_size() > 0 || num_chunks_sent_ == 0) {
+    RETURN_IF_ERROR(SendChunk());
+  }
+
+  return ::util::OkStatus();
+}
+
+::util::Status ReadResponseChunker::SendChunk() {
+  CHECK_RETURN_IF_FALSE(writer_ != nullptr) << "Null writer.";
+  if (!writer_->Write(chunk_)) {
+    return MAKE_ERROR(ERR_INTERNAL) << "Write to stream channel failed.";
+  }
+  chunk_.Clear();
+  chunk_bytes_ = 0;
+  ++num_chunks_sent_;
+
+  return ::util::OkStatus();
+}
+
+}  // namespace hal
+}  // namespace stratum
@@ -0,0 +1,83 @@
+// Copyright 2018-present Open Networking Foundation
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef STRATUM_HAL_LIB_COMMON_READ_RESPONSE_CHUNKER_H_
+#define STRATUM_HAL_LIB_COMMON_READ_RESPONSE_CHUNKER_H_
+
+#include "p4/v1/p4runtime.pb.h"
+#include "stratum/glue/integral_types.h"
+#include "stratum/glue/status/status.h"
+#include "stratum/glue/status/statusor.h"
+#include "stratum/hal/lib/common/writer_interface.h"
+
+namespace stratum {
+namespace hal {
+
+// ReadResponseChunker streams the entities of a P4Runtime read to a
+// WriterInterface<ReadResponse> as a sequence of ReadResponse messages
+// ("chunks") of bounded size, instead of building a single response holding
+// all the entities. A chunk is sent as soon as it holds max_entities entities
+// or max_bytes bytes of serialized entities, whichever comes first, so that
+// memory usage does not grow with the size of the read and the first entities
+// reach the controller before the rest are read. When the writer is backed by
+// a gRPC ServerWriter, each write blocks until the stream can take the chunk,
+// which throttles the read to the pace of the controller.
+//
+// Typical usage:
+//   ReadResponseChunker chunker(writer);
+//   for (...) {
+//     ASSIGN_OR_RETURN(::p4::v1::Entity* entity, chunker.AddEntity());
+//     *entity->mutable_table_entry() = ...;
+//   }
+//   RETURN_IF_ERROR(chunker.Flush());
+//
+// The class is not thread-safe.
+class ReadResponseChunker {
+ public:
+  // Uses the limits given by FLAGS_read_response_max_entities and
+  // FLAGS_read_response_max_bytes.
+  explicit ReadResponseChunker(
+      WriterInterface<::p4::v1::ReadResponse>* writer);
+  // A limit of 0 means no limit.
+  ReadResponseChunker(WriterInterface<::p4::v1::ReadResponse>* writer,
+                      int max_entities, int64 max_bytes);
+  ~ReadResponseChunker() {}
+
+  // Returns a new entity of the current chunk, to be filled in by the caller.
+  // The entity returned by the previous call must be complete by then: if the
+  // chunk reached its limits with it, the chunk is sent before the new entity
+  // is added. Fails if sending the chunk fails.
+  ::util::StatusOr<::p4::v1::Entity*> AddEntity();
+
+  // Sends the entities added since the last chunk was sent. If no chunk has
+  // been sent at all, sends an empty response, so that the reader always gets
+  // a response for the read.
+  ::util::Status Flush();
+
+  // Number of chunks sent so far.
+  int NumChunksSent() const { return num_chunks_sent_; }
+
+  // ReadResponseChunker is neither copyable nor movable.
+  ReadResponseChunker(const ReadResponseChunker&) = delete;
+  ReadResponseChunker& operator=(const ReadResponseChunker&) = delete;
+
+ private:
+  // Sends the current chunk and clears it for the next one.
+  ::util::Status SendChunk();
+
+  WriterInterface<::p4::v1::ReadResponse>* writer_;  // not owned.
+  const int max_entities_;
+  const int64 max_bytes_;
+  // The chunk being built. Clearing it keeps the entity objects allocated, so
+  // they are reused by the next chunk.
+  ::p4::v1::ReadResponse chunk_;
+  // Serialized size of the complete entities of the chunk, i.e. all but the
+  // last one added.
+  int64 chunk_bytes_;
+  int num_chunks_sent_;
+};
+
+}  // namespace hal
+}  // namespace stratum
+
+#endif  // STRATUM_HAL_LIB_COMMON_READ_RESPONSE_CHUNKER_H_
@@ -0,0 +1,117 @@
+// Copyright 2018-present Open Networking Foundation
+// SPDX-License-Identifier: Apache-2.0
+
+#include "stratum/hal/lib/common/read_response_chunker.h"
+
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "stratum/glue/status/status_test_util.h"
+#include "stratum/hal/lib/common/writer_mock.h"
+#include "stratum/public/lib/error.h"
+
+namespace stratum {
+namespace hal {
+
+using ::testing::_;
+using ::testing::Invoke;
+using ::testing::Return;
+
+class ReadResponseChunkerTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    ON_CALL(writer_mock_, Write(_))
+        .WillByDefault(Invoke([this](const ::p4::v1::ReadResponse& resp) {
+          responses_.push_back(resp);
+          return true;
+        }));
+  }
+
+  // Adds 'count' table entities with consecutive table ids starting at
+  // 'first_table_id'.
+  static void AddTableEntities(ReadResponseChunker* chunker,
+                               uint32 first_table_id, int count) {
+    for (int i = 0; i < count; ++i) {
+      auto entity = chunker->AddEntity();
+      ASSERT_OK(entity.status());
+      entity.ValueOrDie()->mutable_table_entry()->set_table_id(first_table_id +
+                                                               i);
+    }
+  }
+
+  WriterMock<::p4::v1::ReadResponse> writer_mock_;
+  std::vector<::p4::v1::ReadResponse> responses_;
+};
+
+TEST_F(ReadResponseChunkerTest, ChunksByEntityCount) {
+  EXPECT_CALL(writer_mock_, Write(_)).Times(3);
+  ReadResponseChunker chunker(&writer_mock_, 4, 0);
+  AddTableEntities(&chunker, 1, 10);
+  // Chunks are sent once they are full, not when the entity is added.
+  EXPECT_EQ(2, chunker.NumChunksSent());
+  ASSERT_OK(chunker.Flush());
+
+  ASSERT_EQ(3U, responses_.size());
+  EXPECT_EQ(4, responses_[0].entities_size());
+  EXPECT_EQ(4, responses_[1].entities_size());
+  ASSERT_EQ(2, responses_[2].entities_size());
+  EXPECT_EQ(1U, responses_[0].entities(0).table_entry().table_id());
+  EXPECT_EQ(5U, responses_[1].entities(0).table_entry().table_id());
+  EXPECT_EQ(10U, responses_[2].entities(1).table_entry().table_id());
+}
+
+TEST_F(ReadResponseChunkerTest, ChunksByBytes) {
+  ::p4::v1::Entity entity;
+  entity.mutable_table_entry()->set_table_id(1);
+  const int64 entity_size = entity.ByteSizeLong();
+
+  EXPECT_CALL(writer_mock_, Write(_)).Times(2);
+  ReadResponseChunker chunker(&writer_mock_, 0, 3 * entity_size);
+  AddTableEntities(&chunker, 1, 5);
+  ASSERT_OK(chunker.Flush());
+
+  ASSERT_EQ(2U, responses_.size());
+  EXPECT_EQ(3, responses_[0].entities_size());
+  EXPECT_EQ(2, responses_[1].entities_size());
+}
+
+TEST_F(ReadResponseChunkerTest, NoLimits) {
+  EXPECT_CALL(writer_mock_, Write(_)).Times(1);
+  ReadResponseChunker chunker(&writer_mock_, 0, 0);
+  AddTableEntities(&chunker, 1, 100);
+  ASSERT_OK(chunker.Flush());
+
+  ASSERT_EQ(1U, responses_.size());
+  EXPECT_EQ(100, responses_[0].entities_size());
+}
+
+TEST_F(ReadResponseChunkerTest, FlushSendsEmptyResponseOnlyIfNothingSent) {
+  EXPECT_CALL(writer_mock_, Write(_)).Times(1);
+  ReadResponseChunker chunker(&writer_mock_, 2, 0);
+  ASSERT_OK(chunker.Flush());
+  ASSERT_EQ(1U, responses_.size());
+  EXPECT_EQ(0, responses_[0].entities_size());
+
+  // A full chunk is only sent when the next entity is added, so the last
+  // chunk is never empty.
+  ReadResponseChunker chunker2(&writer_mock_, 2, 0);
+  EXPECT_CALL(writer_mock_, Write(_)).Times(2);
+  AddTableEntities(&chunker2, 1, 4);
+  ASSERT_OK(chunker2.Flush());
+  ASSERT_OK(chunker2.Flush());
+  ASSERT_EQ(3U, responses_.size());
+  EXPECT_EQ(2, responses_[2].entities_size());
+}
+
+TEST_F(ReadResponseChunkerTest, WriteFailure) {
+  EXPECT_CALL(writer_mock_, Write(_)).WillOnce(Return(false));
+  ReadResponseChunker chunker(&writer_mock_, 1, 0);
+  AddTableEntities(&chunker, 1, 1);
+  auto entity = chunker.AddEntity();
+  EXPECT_EQ(ERR_INTERNAL, entity.status().error_code());
+  EXPECT_EQ(0, chunker.NumChunksSent());
+}
+
+}  // namespace hal
+}  // namespace stratum
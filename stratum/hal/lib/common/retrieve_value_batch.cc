@@ -0,0 +1,149 @@
+// Copyright 2018-present Open Networking Foundation
+// SPDX-License-Identifier: Apache-2.0
+
+#include "stratum/hal/lib/common/retrieve_value_batch.h"
+
+#include <map>
+
+#include "absl/strings/str_cat.h"
+#include "absl/synchronization/blocking_counter.h"
+#include "stratum/glue/logging.h"
+
+namespace stratum {
+namespace hal {
+
+namespace {
+
+// A writer keeping all the responses written to it.
+class CollectingWriter : public WriterInterface<DataResponse> {
+ public:
+  bool Write(const DataResponse& resp) override {
+    responses_.push_back(resp);
+    return true;
+  }
+  std::vector<DataResponse>* responses() { return &responses_; }
+
+ private:
+  std::vector<DataResponse> responses_;
+};
+
+std::string EntryKey(uint64 node_id, const DataRequest::Request& request) {
+  return absl::StrCat(node_id, ":", request.SerializeAsString());
+}
+
+}  // namespace
+
+RetrieveValueBatch::RetrieveValueBatch(SwitchInterface* switch_interface,
+                                       ThreadPool* pool)
+    : switch_interface_(switch_interface),
+      pool_(pool),
+      recording_(true),
+      entries_(),
+      entry_index_(),
+      num_switch_calls_(0) {}
+
+::util::Status RetrieveValueBatch::RetrieveValue(
+    uint64 node_id, const DataRequest& req,
+    WriterInterface<DataResponse>* writer,
+    std::vector<::util::Status>* details) {
+  if (recording_) {
+    for (const auto& request : req.requests()) {
+      const std::string key = EntryKey(node_id, request);
+      if (!entry_index_.count(key)) {
+        entry_index_[key] = entries_.size();
+        entries_.emplace_back();
+        entries_.back().node_id = node_id;
+        entries_.back().request = request;
+      }
+      if (details) details->push_back(::util::OkStatus());
+    }
+    return ::util::OkStatus();
+  }
+
+  std::vector<const Entry*> found;
+  for (const auto& request : req.requests()) {
+    const Entry* entry = FindEntry(node_id, request);
+    if (entry == nullptr || !entry->retrieved) {
+      // Not part of the batch.
+      ++num_switch_calls_;
+      return switch_interface_->RetrieveValue(node_id, req, writer, details);
+    }
+    found.push_back(entry);
+  }
+  for (const Entry* entry : found) {
+    if (entry->status.ok()) writer->Write(entry->response);
+    if (details) details->push_back(entry->status);
+  }
+
+  return ::util::OkStatus();
+}
+
+void RetrieveValueBatch::Retrieve() {
+  recording_ = false;
+  std::map<uint64, std::vector<Entry*>> entries_by_node;
+  for (auto& entry : entries_) {
+    entries_by_node[entry.node_id].push_back(&entry);
+  }
+
+  if (pool_ == nullptr || entries_by_node.size() < 2) {
+    for (const auto& e : entries_by_node) RetrieveNode(e.first, e.second);
+    return;
+  }
+  absl::BlockingCounter done(entries_by_node.size());
+  for (const auto& e : entries_by_node) {
+    pool_->Schedule([this, &e, &done]() {
+      RetrieveNode(e.first, e.second);
+      done.DecrementCount();
+    });
+  }
+  done.Wait();
+}
+
+void RetrieveValueBatch::RetrieveNode(uint64 node_id,
+                                      const std::vector<Entry*>& entries) {
+  DataRequest req;
+  for (const Entry* entry : entries) *req.add_requests() = entry->request;
+  CollectingWriter writer;
+  std::vector<::util::Status> details;
+  ++num_switch_calls_;
+  ::util::Status status =
+      switch_interface_->RetrieveValue(node_id, req, &writer, &details);
+  std::vector<DataResponse>& responses = *writer.responses();
+  if (!status.ok()) {
+    // The requests are sent again one by one when the leaves are polled.
+    VLOG(1) << "Failed to retrieve " << entries.size()
+            << " values of node " << node_id << ": " << status;
+    return;
+  }
+  if (details.empty() && responses.size() == entries.size()) {
+    // The switch does not report the status of each request.
+    details.assign(entries.size(), ::util::OkStatus());
+  }
+  if (details.size() != entries.size()) {
+    VLOG(1) << "Got " << details.size() << " statuses for " << entries.size()
+            << " requests to node " << node_id << ".";
+    return;
+  }
+
+  // There is one response for each request which succeeded, in order.
+  size_t next_response = 0;
+  for (size_t i = 0; i < entries.size(); ++i) {
+    if (details[i].ok()) {
+      if (next_response >= responses.size()) break;
+      entries[i]->response.Swap(&responses[next_response++]);
+    }
+    entries[i]->status = details[i];
+    entries[i]->retrieved = true;
+  }
+}
+
+RetrieveValueBatch::Entry* RetrieveValueBatch::FindEntry(
+    uint64 node_id, const DataRequest::Request& request) {
+  auto it = entry_index_.find(EntryKey(node_id, request));
+  if (it == entry_index_.end()) return nullptr;
+
+  return &entries_[it->second];
+}
+
+}  // namespace hal
+}  // namespace stratum
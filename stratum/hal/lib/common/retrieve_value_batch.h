@@ -0,0 +1,88 @@
+// Copyright 2018-present Open Networking Foundation
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef STRATUM_HAL_LIB_COMMON_RETRIEVE_VALUE_BATCH_H_
+#define STRATUM_HAL_LIB_COMMON_RETRIEVE_VALUE_BATCH_H_
+
+#include <atomic>
+#include <string>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "stratum/glue/integral_types.h"
+#include "stratum/glue/status/status.h"
+#include "stratum/hal/lib/common/common.pb.h"
+#include "stratum/hal/lib/common/switch_interface.h"
+#include "stratum/hal/lib/common/writer_interface.h"
+#include "stratum/lib/thread_pool.h"
+
+namespace stratum {
+namespace hal {
+
+// RetrieveValueBatch gathers the DataRequests of all the leaves polled by one
+// gNMI Get, so that they are sent to the SwitchInterface in a single
+// RetrieveValue() call per node instead of one call per leaf. It is used in
+// two passes over the same leaves:
+// - while recording, RetrieveValue() only records the requests and writes no
+//   response, so the leaves produce default values which are discarded;
+// - Retrieve() sends the recorded requests, grouped per node, the nodes in
+//   parallel, and keeps the responses;
+// - afterwards, RetrieveValue() writes the kept responses. The requests which
+//   were not recorded, or whose node could not be read, are sent to the
+//   SwitchInterface as they come.
+//
+// The class is not thread-safe: the leaves of a Get are polled one at a time.
+class RetrieveValueBatch {
+ public:
+  // The nodes are read in parallel on 'pool', or one after the other if it is
+  // nullptr.
+  RetrieveValueBatch(SwitchInterface* switch_interface, ThreadPool* pool);
+  ~RetrieveValueBatch() {}
+
+  // Same contract as SwitchInterface::RetrieveValue(), see the class comment.
+  ::util::Status RetrieveValue(uint64 node_id, const DataRequest& req,
+                               WriterInterface<DataResponse>* writer,
+                               std::vector<::util::Status>* details);
+
+  // Reads the recorded requests from the SwitchInterface and stops recording.
+  void Retrieve();
+
+  // Number of RetrieveValue() calls made to the SwitchInterface so far.
+  int NumSwitchCalls() const { return num_switch_calls_; }
+
+  // RetrieveValueBatch is neither copyable nor movable.
+  RetrieveValueBatch(const RetrieveValueBatch&) = delete;
+  RetrieveValueBatch& operator=(const RetrieveValueBatch&) = delete;
+
+ private:
+  // A recorded request and, once retrieved, its result.
+  struct Entry {
+    uint64 node_id = 0;
+    DataRequest::Request request;
+    bool retrieved = false;
+    ::util::Status status;
+    DataResponse response;
+  };
+
+  // Sends the requests of 'entries', all for the node 'node_id', in one
+  // RetrieveValue() call and stores the results in the entries.
+  void RetrieveNode(uint64 node_id, const std::vector<Entry*>& entries);
+
+  // Returns the recorded entry for 'request', or nullptr.
+  Entry* FindEntry(uint64 node_id, const DataRequest::Request& request);
+
+  SwitchInterface* switch_interface_;  // not owned.
+  ThreadPool* pool_;                   // not owned.
+
+  bool recording_;
+  // The recorded requests, in the order they were first made.
+  std::vector<Entry> entries_;
+  // Map from the node ID and the serialized request to its index in entries_.
+  absl::flat_hash_map<std::string, size_t> entry_index_;
+  std::atomic<int> num_switch_calls_;
+};
+
+}  // namespace hal
+}  // namespace stratum
+
+#endif  // STRATUM_HAL_LIB_COMMON_RETRIEVE_VALUE_BATCH_H_
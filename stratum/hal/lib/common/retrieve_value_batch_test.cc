@@ -0,0 +1,164 @@
+// Copyright 2018-present Open Networking Foundation
+// SPDX-License-Identifier: Apache-2.0
+
+#include "stratum/hal/lib/common/retrieve_value_batch.h"
+
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "stratum/glue/status/status_test_util.h"
+#include "stratum/hal/lib/common/switch_mock.h"
+#include "stratum/hal/lib/common/writer_mock.h"
+#include "stratum/hal/lib/common/yang_parse_tree.h"
+#include "stratum/public/lib/error.h"
+
+namespace stratum {
+namespace hal {
+
+using ::testing::_;
+using ::testing::Invoke;
+using ::testing::Return;
+
+namespace {
+
+constexpr uint64 kNodeId1 = 1;
+constexpr uint64 kNodeId2 = 2;
+// Reading the operational status of this port fails.
+constexpr uint32 kFailingPortId = 13;
+
+// Returns a request for the operational status of a port.
+DataRequest OperStatusRequest(uint64 node_id, uint32 port_id) {
+  DataRequest req;
+  auto* oper_status = req.add_requests()->mutable_oper_status();
+  oper_status->set_node_id(node_id);
+  oper_status->set_port_id(port_id);
+  return req;
+}
+
+// Implements SwitchInterface::RetrieveValue() for operational status
+// requests: the odd ports are up and the even ones down.
+::util::Status RetrieveOperStatus(uint64 node_id, const DataRequest& req,
+                                  WriterInterface<DataResponse>* writer,
+                                  std::vector<::util::Status>* details) {
+  for (const auto& request : req.requests()) {
+    const uint32 port_id = request.oper_status().port_id();
+    if (port_id == kFailingPortId) {
+      details->push_back(
+          ::util::Status(StratumErrorSpace(), ERR_INTERNAL, "Port failed."));
+      continue;
+    }
+    DataResponse resp;
+    resp.mutable_oper_status()->set_state(port_id % 2 ? PORT_STATE_UP
+                                                      : PORT_STATE_DOWN);
+    writer->Write(resp);
+    details->push_back(::util::OkStatus());
+  }
+  return ::util::OkStatus();
+}
+
+// Returns the state written for the request 'req', or PORT_STATE_UNKNOWN if
+// nothing was written.
+PortState Replay(RetrieveValueBatch* batch, uint64 node_id,
+                 const DataRequest& req, std::vector<::util::Status>* details) {
+  PortState state = PORT_STATE_UNKNOWN;
+  DataResponseWriter writer([&state](const DataResponse& resp) {
+    state = resp.oper_status().state();
+    return true;
+  });
+  EXPECT_OK(batch->RetrieveValue(node_id, req, &writer, details));
+  return state;
+}
+
+}  // namespace
+
+TEST(RetrieveValueBatchTest, RecordingWritesNothing) {
+  SwitchMock switch_mock;
+  EXPECT_CALL(switch_mock, RetrieveValue(_, _, _, _)).Times(0);
+  RetrieveValueBatch batch(&switch_mock, nullptr);
+  WriterMock<DataResponse> writer;
+  EXPECT_CALL(writer, Write(_)).Times(0);
+  std::vector<::util::Status> details;
+  EXPECT_OK(batch.RetrieveValue(kNodeId1, OperStatusRequest(kNodeId1, 1),
+                                &writer, &details));
+  ASSERT_EQ(1U, details.size());
+  EXPECT_OK(details[0]);
+  EXPECT_EQ(0, batch.NumSwitchCalls());
+}
+
+TEST(RetrieveValueBatchTest, RetrievesOncePerNode) {
+  SwitchMock switch_mock;
+  EXPECT_CALL(switch_mock, RetrieveValue(kNodeId1, _, _, _))
+      .WillOnce(Invoke([](uint64 node_id, const DataRequest& req,
+                          WriterInterface<DataResponse>* writer,
+                          std::vector<::util::Status>* details) {
+        // The duplicate request is sent once.
+        EXPECT_EQ(2, req.requests_size());
+        return RetrieveOperStatus(node_id, req, writer, details);
+      }));
+  EXPECT_CALL(switch_mock, RetrieveValue(kNodeId2, _, _, _))
+      .WillOnce(Invoke(RetrieveOperStatus));
+  ThreadPool pool(2);
+  RetrieveValueBatch batch(&switch_mock, &pool);
+  const DataRequest req1 = OperStatusRequest(kNodeId1, 1);
+  const DataRequest req2 = OperStatusRequest(kNodeId1, 2);
+  const DataRequest req3 = OperStatusRequest(kNodeId2, 3);
+  for (const auto* req : {&req1, &req2, &req1, &req3}) {
+    Replay(&batch, req->requests(0).oper_status().node_id(), *req, nullptr);
+  }
+
+  batch.Retrieve();
+  EXPECT_EQ(2, batch.NumSwitchCalls());
+  EXPECT_EQ(PORT_STATE_UP, Replay(&batch, kNodeId1, req1, nullptr));
+  EXPECT_EQ(PORT_STATE_DOWN, Replay(&batch, kNodeId1, req2, nullptr));
+  EXPECT_EQ(PORT_STATE_UP, Replay(&batch, kNodeId1, req1, nullptr));
+  EXPECT_EQ(PORT_STATE_UP, Replay(&batch, kNodeId2, req3, nullptr));
+  EXPECT_EQ(2, batch.NumSwitchCalls());
+}
+
+TEST(RetrieveValueBatchTest, FailedRequestKeepsItsStatus) {
+  SwitchMock switch_mock;
+  EXPECT_CALL(switch_mock, RetrieveValue(kNodeId1, _, _, _))
+      .WillOnce(Invoke(RetrieveOperStatus));
+  RetrieveValueBatch batch(&switch_mock, nullptr);
+  const DataRequest failing = OperStatusRequest(kNodeId1, kFailingPortId);
+  const DataRequest ok = OperStatusRequest(kNodeId1, 2);
+  Replay(&batch, kNodeId1, failing, nullptr);
+  Replay(&batch, kNodeId1, ok, nullptr);
+
+  batch.Retrieve();
+  std::vector<::util::Status> details;
+  EXPECT_EQ(PORT_STATE_UNKNOWN, Replay(&batch, kNodeId1, failing, &details));
+  // The response of the next request is not taken for the failed one.
+  EXPECT_EQ(PORT_STATE_DOWN, Replay(&batch, kNodeId1, ok, &details));
+  ASSERT_EQ(2U, details.size());
+  EXPECT_FALSE(details[0].ok());
+  EXPECT_OK(details[1]);
+  EXPECT_EQ(1, batch.NumSwitchCalls());
+}
+
+TEST(RetrieveValueBatchTest, RequestsNotRetrievedGoToSwitch) {
+  SwitchMock switch_mock;
+  EXPECT_CALL(switch_mock, RetrieveValue(kNodeId1, _, _, _))
+      .WillOnce(Return(::util::Status(StratumErrorSpace(), ERR_INTERNAL,
+                                      "Node not ready.")))
+      .WillOnce(Invoke(RetrieveOperStatus));
+  EXPECT_CALL(switch_mock, RetrieveValue(kNodeId2, _, _, _))
+      .WillOnce(Invoke(RetrieveOperStatus));
+  RetrieveValueBatch batch(&switch_mock, nullptr);
+  Replay(&batch, kNodeId1, OperStatusRequest(kNodeId1, 1), nullptr);
+
+  batch.Retrieve();
+  // The node could not be read as a whole.
+  std::vector<::util::Status> details;
+  EXPECT_EQ(PORT_STATE_UP, Replay(&batch, kNodeId1,
+                                  OperStatusRequest(kNodeId1, 1), &details));
+  // The request was not recorded.
+  EXPECT_EQ(PORT_STATE_DOWN, Replay(&batch, kNodeId2,
+                                    OperStatusRequest(kNodeId2, 2), &details));
+  EXPECT_EQ(2U, details.size());
+  EXPECT_EQ(3, batch.NumSwitchCalls());
+}
+
+}  // namespace hal
+}  // namespace stratum
@@ -4,8 +4,10 @@
 
 #include "stratum/hal/lib/common/yang_parse_tree.h"
 
+#include <initializer_list>
 #include <list>
 #include <string>
+#include <utility>
 
 #include "absl/container/flat_hash_map.h"
 #include "absl/strings/str_cat.h"
@@ -14,11 +16,31 @@
 #include "grpcpp/grpcpp.h"
 #include "stratum/glue/status/status_macros.h"
 #include "stratum/hal/lib/common/gnmi_publisher.h"
+#include "stratum/hal/lib/common/retrieve_value_batch.h"
 #include "stratum/hal/lib/common/yang_parse_tree_paths.h"
 
 namespace stratum {
 namespace hal {
 
+namespace {
+
+// Returns a string which differs for every value of 'messages', used to find
+// the config items which changed since the previous config push.
+std::string ConfigItemFingerprint(
+    absl::string_view kind,
+    std::initializer_list<const ::google::protobuf::Message*> messages) {
+  std::string fingerprint(kind);
+  for (const auto* message : messages) {
+    const std::string serialized = message->SerializeAsString();
+    absl::StrAppend(&fingerprint, ":", serialized.size(), ":", serialized);
+  }
+  return fingerprint;
+}
+
+}  // namespace
+
+std::atomic<uint64> TreeNode::support_generation_(1);
+
 TreeNode::TreeNode(const TreeNode& src) {
   name_ = src.name_;
   // Deep-copy children.
@@ -44,12 +66,87 @@ void TreeNode::CopySubtree(const TreeNode& src) {
   supports_on_delete_ = src.supports_on_delete_;
   // Copy flags.
   is_name_a_key_ = src.is_name_a_key_;
+  InvalidateSupportCache();
 
   // Deep-copy children.
   for (const auto& entry : src.children_) {
-    children_.emplace(entry.first, TreeNode(*this, entry.first));
-    children_[entry.first].CopySubtree(entry.second);
+    FindOrAddChild(entry.first)->CopySubtree(entry.second);
+  }
+}
+
+TreeNode* TreeNode::FindOrAddChild(const std::string& name,
+                                   bool is_name_a_key) {
+  TreeNode* child = FindChildOrNull(name);
+  if (child != nullptr) return child;
+  auto it =
+      children_.emplace(name, TreeNode(*this, name, is_name_a_key)).first;
+  child_index_[it->first] = &it->second;
+  InvalidateSupportCache();
+  return &it->second;
+}
+
+void TreeNode::RemoveChild(const std::string& name) {
+  auto it = children_.find(name);
+  if (it == children_.end()) return;
+  child_index_.erase(it->first);
+  children_.erase(it);
+  InvalidateSupportCache();
+}
+
+uint8 TreeNode::SupportBit(SupportsOnPtr supports_on) {
+  if (supports_on == &TreeNode::supports_on_timer_) return 1 << 0;
+  if (supports_on == &TreeNode::supports_on_change_) return 1 << 1;
+  if (supports_on == &TreeNode::supports_on_poll_) return 1 << 2;
+  if (supports_on == &TreeNode::supports_on_update_) return 1 << 3;
+  if (supports_on == &TreeNode::supports_on_replace_) return 1 << 4;
+  if (supports_on == &TreeNode::supports_on_delete_) return 1 << 5;
+  return 0;
+}
+
+uint8 TreeNode::GetSupport() const {
+  uint8 support = 0;
+  for (SupportsOnPtr supports_on :
+       {&TreeNode::supports_on_timer_, &TreeNode::supports_on_change_,
+        &TreeNode::supports_on_poll_, &TreeNode::supports_on_update_,
+        &TreeNode::supports_on_replace_, &TreeNode::supports_on_delete_}) {
+    if (this->*supports_on) support |= SupportBit(supports_on);
   }
+  return support;
+}
+
+uint8 TreeNode::GetSubtreeSupport() const {
+  const uint64 generation = support_generation_.load();
+  const uint64 cached = subtree_support_.load();
+  if (cached >> 8 == generation) return cached & 0xff;
+
+  uint8 support;
+  if (children_.empty()) {
+    // This is a leaf - return what the flags say.
+    support = GetSupport();
+  } else {
+    // Not a leaf - a mode is supported only if all the leaves in this subtree
+    // support it.
+    support = 0xff;
+    for (const auto& entry : children_) {
+      support &= entry.second.GetSubtreeSupport();
+    }
+  }
+  subtree_support_.store(generation << 8 | support);
+  return support;
+}
+
+GnmiEventHandler TreeNode::GetVisitingHandler(
+    const TreeNodeEventHandlerPtr& handler) const {
+  std::shared_ptr<const TreeNode*> self = self_;
+  return [self, handler](const GnmiEvent& event, GnmiSubscribeStream* stream) {
+    const TreeNode* node = *self;
+    if (node == nullptr) {
+      // The subtree has been removed from the tree by a config push.
+      return ::util::OkStatus();
+    }
+    return node->VisitThisNodeAndItsChildren(handler, event, node->GetPath(),
+                                             stream);
+  };
 }
 
 ::util::Status TreeNode::VisitThisNodeAndItsChildren(
@@ -107,10 +204,10 @@ const TreeNode* TreeNode::FindNodeOrNull(const ::gnmi::Path& path) const {
   const TreeNode* node = this;
   for (; node != nullptr && !node->children_.empty() &&
          element < path.elem_size();) {
-    node = gtl::FindOrNull(node->children_, path.elem(element).name());
+    node = node->FindChildOrNull(path.elem(element).name());
     auto* search = gtl::FindOrNull(path.elem(element).key(), "name");
     if (search != nullptr && node != nullptr) {
-      node = gtl::FindOrNull(node->children_, *search);
+      node = node->FindChildOrNull(*search);
     }
     ++element;
   }
@@ -135,6 +232,11 @@ void YangParseTree::ProcessPushedConfig(
     const ConfigHasBeenPushedEvent& change) {
   absl::WriterMutexLock r(&root_access_lock_);
 
+  // The config items found in the new config. Those left in 'config_items_'
+  // once all have been found are no longer in the config.
+  ConfigItems items;
+  bool changed = false;
+
   // Translation from node ID to an object describing the node.
   absl::flat_hash_map<uint64, const Node*> node_id_to_node;
   for (const auto& node : change.new_config_.nodes()) {
@@ -151,12 +253,20 @@ void YangParseTree::ProcessPushedConfig(
         node_id_to_node[singleton.node()]
             ? node_id_to_node[singleton.node()]->config_params()
             : empty_node_config;
-    AddSubtreeInterfaceFromSingleton(singleton, node_config);
+    changed |= AddConfigItem(
+        ConfigItemFingerprint("singleton", {&singleton, &node_config}),
+        [this, &singleton, &node_config]() {
+          AddSubtreeInterfaceFromSingleton(singleton, node_config);
+        },
+        &items);
     port_id_to_node_id[singleton.id()] = singleton.node();
   }
 
   for (const auto& optical : change.new_config_.optical_network_interfaces()) {
-    AddSubtreeInterfaceFromOptical(optical);
+    changed |= AddConfigItem(
+        ConfigItemFingerprint("optical", {&optical}),
+        [this, &optical]() { AddSubtreeInterfaceFromOptical(optical); },
+        &items);
   }
 
   for (const auto& trunk : change.new_config_.trunk_ports()) {
@@ -169,14 +279,84 @@ void YangParseTree::ProcessPushedConfig(
     const NodeConfigParams& node_config =
         node_id != kNodeIdUnknown ? node_id_to_node[node_id]->config_params()
                                   : empty_node_config;
-    AddSubtreeInterfaceFromTrunk(trunk.name(), node_id, trunk.id(),
-                                 node_config);
+    changed |= AddConfigItem(
+        absl::StrCat(ConfigItemFingerprint("trunk", {&trunk, &node_config}),
+                     ":", node_id),
+        [this, &trunk, node_id, &node_config]() {
+          AddSubtreeInterfaceFromTrunk(trunk.name(), node_id, trunk.id(),
+                                       node_config);
+        },
+        &items);
   }
   // Add all chassis-related gNMI paths.
-  AddSubtreeChassis(change.new_config_.chassis());
+  const Chassis& chassis = change.new_config_.chassis();
+  changed |= AddConfigItem(ConfigItemFingerprint("chassis", {&chassis}),
+                           [this, &chassis]() { AddSubtreeChassis(chassis); },
+                           &items);
   // Add all node-related gNMI paths.
   for (const auto& node : change.new_config_.nodes()) {
-    AddSubtreeNode(node);
+    changed |= AddConfigItem(ConfigItemFingerprint("node", {&node}),
+                             [this, &node]() { AddSubtreeNode(node); },
+                             &items);
+  }
+
+  // Remove the subtrees of the items no longer in the config.
+  for (const auto& entry : config_items_) {
+    RemoveConfigItem(entry.second);
+    changed = true;
+  }
+  config_items_ = std::move(items);
+
+  // The ports may have changed.
+  if (changed) port_counters_cache_.Clear();
+}
+
+bool YangParseTree::AddConfigItem(const std::string& fingerprint,
+                                  const Action& add_subtree,
+                                  ConfigItems* items) {
+  // The same item can be found twice in the config.
+  if (items->count(fingerprint)) return false;
+  auto it = config_items_.find(fingerprint);
+  if (it != config_items_.end()) {
+    // Unchanged since the previous config push.
+    items->insert(std::move(*it));
+    config_items_.erase(it);
+    return false;
+  }
+
+  absl::flat_hash_map<TreeNode*, TreeNode*> added_keyed_subtrees;
+  added_keyed_subtrees_ = &added_keyed_subtrees;
+  add_subtree();
+  added_keyed_subtrees_ = nullptr;
+
+  std::vector<TreeNode*>& keyed_subtrees = (*items)[fingerprint];
+  for (const auto& entry : added_keyed_subtrees) {
+    // If the item replaces one which changed, the subtree is shared by both
+    // until the latter is removed.
+    KeyedSubtree& keyed_subtree = keyed_subtrees_[entry.first];
+    keyed_subtree.parent = entry.second;
+    ++keyed_subtree.num_config_items;
+    keyed_subtrees.push_back(entry.first);
+  }
+
+  return true;
+}
+
+void YangParseTree::RemoveConfigItem(
+    const std::vector<TreeNode*>& keyed_subtrees) {
+  for (TreeNode* subtree : keyed_subtrees) {
+    auto it = keyed_subtrees_.find(subtree);
+    if (it == keyed_subtrees_.end()) continue;
+    if (--it->second.num_config_items > 0) continue;
+    TreeNode* parent = it->second.parent;
+    const std::string name = subtree->name();
+    keyed_subtrees_.erase(it);
+    {
+      // The removed nodes may be in the cached wildcards.
+      absl::MutexLock l(&wildcard_cache_lock_);
+      wildcard_cache_.clear();
+    }
+    parent->RemoveChild(name);
   }
 }
 
@@ -189,9 +369,30 @@ bool YangParseTree::IsWildcard(const std::string& name) const {
 ::util::Status YangParseTree::PerformActionForAllNonWildcardNodes(
     const gnmi::Path& path, const gnmi::Path& subpath,
     const std::function<::util::Status(const TreeNode& leaf)>& action) const {
+  ASSIGN_OR_RETURN(auto leaves, FindAllNonWildcardLeaves(path, subpath));
+  ::util::Status ret = ::util::OkStatus();
+  for (const TreeNode* leaf : *leaves) {
+    APPEND_STATUS_IF_ERROR(ret, action(*leaf));
+  }
+  return ret;
+}
+
+::util::StatusOr<std::shared_ptr<const std::vector<const TreeNode*>>>
+YangParseTree::FindAllNonWildcardLeaves(const gnmi::Path& path,
+                                        const gnmi::Path& subpath) const {
+  const std::string serialized_path = path.SerializeAsString();
+  const std::string key = absl::StrCat(serialized_path.size(), ":",
+                                       serialized_path,
+                                       subpath.SerializeAsString());
+  {
+    absl::MutexLock l(&wildcard_cache_lock_);
+    auto* leaves = gtl::FindOrNull(wildcard_cache_, key);
+    if (leaves != nullptr) return *leaves;
+  }
+
   const auto* root = root_.FindNodeOrNull(path);
   CHECK_RETURN_IF_FALSE(root);
-  ::util::Status ret = ::util::OkStatus();
+  auto leaves = std::make_shared<std::vector<const TreeNode*>>();
   for (const auto& entry : root->children_) {
     if (IsWildcard(entry.first)) {
       // Skip this one!
@@ -205,13 +406,18 @@ bool YangParseTree::IsWildcard(const std::string& name) const {
       // but some components do not have node-id leaf.
       continue;
     }
-    APPEND_STATUS_IF_ERROR(ret, action(*leaf));
+    leaves->push_back(leaf);
   }
-  return ret;
+  absl::MutexLock l(&wildcard_cache_lock_);
+  wildcard_cache_[key] = leaves;
+
+  return std::shared_ptr<const std::vector<const TreeNode*>>(leaves);
 }
 
 YangParseTree::YangParseTree(SwitchInterface* switch_interface)
-    : switch_interface_(ABSL_DIE_IF_NULL(switch_interface)) {
+    : switch_interface_(ABSL_DIE_IF_NULL(switch_interface)),
+      retrieve_value_batch_(nullptr),
+      port_counters_cache_(switch_interface) {
   // Add the minimum nodes:
   //   /interfaces/interface[name=*]/state/ifindex
   //   /interfaces/interface[name=*]/state/name
@@ -226,31 +432,31 @@ YangParseTree::YangParseTree(SwitchInterface* switch_interface)
 
 TreeNode* YangParseTree::AddNode(const ::gnmi::Path& path) {
   // No need to lock the mutex - it is locked by method calling this one.
+  {
+    // The new nodes may match the cached wildcards.
+    absl::MutexLock l(&wildcard_cache_lock_);
+    wildcard_cache_.clear();
+  }
   TreeNode* node = &root_;
+  bool is_keyed = false;
   for (const auto& element : path.elem()) {
-    TreeNode* child = gtl::FindOrNull(node->children_, element.name());
-    if (child == nullptr) {
-      // This path is not supported yet. Let's add a node with default
-      // processing.
-      node->children_.emplace(element.name(), TreeNode(*node, element.name()));
-      child = gtl::FindOrNull(node->children_, element.name());
-    }
-    node = child;
+    // If this path is not supported yet, a node with default processing is
+    // added.
+    node = node->FindOrAddChild(element.name());
     auto* search = gtl::FindOrNull(element.key(), "name");
     if (search == nullptr) {
       continue;
     }
 
     // A filtering pattern has been found!
-    child = gtl::FindOrNull(node->children_, *search);
-    if (child == nullptr) {
-      // This path is not supported yet. Let's add a node with default
-      // processing.
-      node->children_.emplace(
-          *search, TreeNode(*node, *search, true /* mark as a key */));
-      child = gtl::FindOrNull(node->children_, *search);
+    TreeNode* parent = node;
+    node = node->FindOrAddChild(*search, true /* mark as a key */);
+    if (added_keyed_subtrees_ != nullptr && !is_keyed) {
+      // The first key of the path is where the subtree of a config item
+      // starts.
+      (*added_keyed_subtrees_)[node] = parent;
     }
-    node = child;
+    is_keyed = true;
   }
   return node;
 }
@@ -285,6 +491,24 @@ const TreeNode* YangParseTree::FindNodeOrNull(const ::gnmi::Path& path) const {
   return root_.FindNodeOrNull(path);
 }
 
+::util::Status YangParseTree::RetrieveValue(
+    uint64 node_id, const DataRequest& req,
+    WriterInterface<DataResponse>* writer,
+    std::vector<::util::Status>* details) {
+  SwitchInterface* switch_interface;
+  RetrieveValueBatch* batch;
+  {
+    absl::WriterMutexLock l(&root_access_lock_);
+    switch_interface = switch_interface_;
+    batch = retrieve_value_batch_;
+  }
+  if (batch != nullptr) {
+    return batch->RetrieveValue(node_id, req, writer, details);
+  }
+
+  return switch_interface->RetrieveValue(node_id, req, writer, details);
+}
+
 const TreeNode* YangParseTree::GetRoot() const {
   absl::WriterMutexLock l(&root_access_lock_);
 
@@ -5,19 +5,25 @@
 #ifndef STRATUM_HAL_LIB_COMMON_YANG_PARSE_TREE_H_
 #define STRATUM_HAL_LIB_COMMON_YANG_PARSE_TREE_H_
 
+#include <atomic>
 #include <unordered_map>
 #include <utility>
 #include <memory>
 #include <string>
 #include <map>
+#include <vector>
 
 #include "stratum/lib/macros.h"
 #include "stratum/glue/status/status.h"
+#include "stratum/glue/status/statusor.h"
 #include "gnmi/gnmi.grpc.pb.h"
 #include "stratum/hal/lib/common/common.pb.h"
 #include "stratum/hal/lib/common/gnmi_events.h"
+#include "stratum/hal/lib/common/port_counters_cache.h"
 #include "stratum/hal/lib/common/switch_interface.h"
 #include "stratum/hal/lib/common/writer_interface.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/strings/string_view.h"
 #include "absl/synchronization/mutex.h"
 
 namespace stratum {
@@ -25,6 +31,7 @@ namespace hal {
 
 class EventHandlerRecord;
 class GnmiEvent;
+class RetrieveValueBatch;
 class SubscriptionTestBase;
 class YangParseTreePaths;
 class YangParseTreeTest;
@@ -53,6 +60,17 @@ using TreeNodeEventRegistration =
 // its children and so on until the first unknown path element is found (and the
 // client is notified that such leaf is not supported) or the whole path is
 // processed (which means that the leaf is supported).
+//
+// The children are kept in a map ordered by name, which is the order in which
+// a subtree is visited, and indexed by a hash table used to find them. Whether
+// all the leaves of the subtree starting from a node support a mode is cached
+// in the node until any node is added or changes its handlers, which only
+// happens when a config is pushed.
+//
+// The handlers returned by GetOnTimerHandler(), GetOnChangeHandler() and
+// GetOnPollHandler() are kept by the subscriptions. They do nothing once their
+// node has been removed from the tree, which happens when the config item it
+// was added for is removed from the chassis config.
 class TreeNode {
  public:
   using SupportsOnPtr = bool TreeNode::*;
@@ -81,6 +99,7 @@ class TreeNode {
         supports_on_replace_(false),
         supports_on_delete_(false) {}
   TreeNode(const TreeNode& src);
+  ~TreeNode() { *self_ = nullptr; }
 
   void CopySubtree(const TreeNode& src);
 
@@ -89,6 +108,7 @@ class TreeNode {
   TreeNode* SetOnUpdateHandler(const TreeNodeSetHandler& handler) {
     on_update_handler_ = handler;
     supports_on_update_ = true;
+    InvalidateSupportCache();
     return this;
   }
 
@@ -97,6 +117,7 @@ class TreeNode {
   TreeNode* SetOnReplaceHandler(const TreeNodeSetHandler& handler) {
     on_replace_handler_ = handler;
     supports_on_replace_ = true;
+    InvalidateSupportCache();
     return this;
   }
 
@@ -105,6 +126,7 @@ class TreeNode {
   TreeNode* SetOnDeleteHandler(const TreeNodeDeleteHandler& handler) {
     on_delete_handler_ = handler;
     supports_on_delete_ = true;
+    InvalidateSupportCache();
     return this;
   }
 
@@ -113,6 +135,7 @@ class TreeNode {
   TreeNode* SetOnTimerHandler(const TreeNodeEventHandler& handler) {
     on_timer_handler_ = handler;
     supports_on_timer_ = true;
+    InvalidateSupportCache();
     return this;
   }
 
@@ -121,6 +144,7 @@ class TreeNode {
   TreeNode* SetOnPollHandler(const TreeNodeEventHandler& handler) {
     on_poll_handler_ = handler;
     supports_on_poll_ = true;
+    InvalidateSupportCache();
     return this;
   }
 
@@ -129,6 +153,7 @@ class TreeNode {
   TreeNode* SetOnChangeHandler(const TreeNodeEventHandler& handler) {
     on_change_handler_ = handler;
     supports_on_change_ = true;
+    InvalidateSupportCache();
     return this;
   }
 
@@ -149,23 +174,28 @@ class TreeNode {
   // Returns a node that handles the YANG path starting from this node.
   const TreeNode* FindNodeOrNull(const ::gnmi::Path& path) const;
 
+  // Returns the child called 'name' or nullptr if there is no such child.
+  const TreeNode* FindChildOrNull(absl::string_view name) const {
+    auto it = child_index_.find(name);
+    return it == child_index_.end() ? nullptr : it->second;
+  }
+  TreeNode* FindChildOrNull(absl::string_view name) {
+    auto it = child_index_.find(name);
+    return it == child_index_.end() ? nullptr : it->second;
+  }
+
+  // Returns the child called 'name', adding it first if there is no such
+  // child.
+  TreeNode* FindOrAddChild(const std::string& name, bool is_name_a_key = false);
+  // Removes the child named 'name' and its subtree, if any.
+  void RemoveChild(const std::string& name);
+
   // A generic method that checks if the subtree starting from this node
   // supports a particular type of events. The input parameter is a pointer to
   // the mameber variable that keeps information if this node supports the
   // requested type of events.
   bool AllSubtreeLeavesSupportOn(SupportsOnPtr supports_on) const {
-    if (children_.empty()) {
-      // This is a leaf - return what the flag says.
-      return this->*supports_on;
-    }
-    // Not a leaf - check all leafs in this subtree. If even one of them does
-    // not support this mode then the whole subtree does not support it!
-    bool supported = true;
-    for (const auto& entry : children_) {
-      supported =
-          supported && entry.second.AllSubtreeLeavesSupportOn(supports_on);
-    }
-    return supported;
+    return (GetSubtreeSupport() & SupportBit(supports_on)) != 0;
   }
 
   // Returns true if the subtree starting from this node supports on-update
@@ -231,26 +261,17 @@ class TreeNode {
 
   // Returns a functor that will execute handlers of this node and its children.
   GnmiEventHandler GetOnTimerHandler() const {
-    return [this](const GnmiEvent& event, GnmiSubscribeStream* stream) {
-      return VisitThisNodeAndItsChildren(&TreeNode::on_timer_handler_, event,
-                                         this->GetPath(), stream);
-    };
+    return GetVisitingHandler(&TreeNode::on_timer_handler_);
   }
 
   // Returns a functor that will execute handlers of this node and its children.
   GnmiEventHandler GetOnChangeHandler() const {
-    return [this](const GnmiEvent& event, GnmiSubscribeStream* stream) {
-      return VisitThisNodeAndItsChildren(&TreeNode::on_change_handler_, event,
-                                         this->GetPath(), stream);
-    };
+    return GetVisitingHandler(&TreeNode::on_change_handler_);
   }
 
   // Returns a functor that will execute handlers of this node and its children.
   GnmiEventHandler GetOnPollHandler() const {
-    return [this](const GnmiEvent& event, GnmiSubscribeStream* stream) {
-      return VisitThisNodeAndItsChildren(&TreeNode::on_poll_handler_, event,
-                                         this->GetPath(), stream);
-    };
+    return GetVisitingHandler(&TreeNode::on_poll_handler_);
   }
 
   // Returns a functor that will register the on_change handler of this node for
@@ -275,11 +296,27 @@ class TreeNode {
   // Returns path from root to this node.
   ::gnmi::Path GetPath() const;
 
+  // Never modified directly, so that child_index_ is kept in sync.
   std::map<std::string, TreeNode> children_;
 
  private:
   using TreeNodeEventHandlerPtr = TreeNodeEventHandler TreeNode::*;
 
+  // Returns the bit used in the support caches for a supports_on_* flag.
+  static uint8 SupportBit(SupportsOnPtr supports_on);
+  // Returns the supports_on_* flags of this node as a mask of SupportBit().
+  uint8 GetSupport() const;
+  // Returns the mask of the modes supported by all the leaves of the subtree
+  // starting from this node, computing it if the cached one is out of date.
+  uint8 GetSubtreeSupport() const;
+  // Marks the support caches of all the nodes as out of date.
+  static void InvalidateSupportCache() { ++support_generation_; }
+
+  // Returns a functor calling VisitThisNodeAndItsChildren() with 'handler'
+  // while this node is part of the tree.
+  GnmiEventHandler GetVisitingHandler(
+      const TreeNodeEventHandlerPtr& handler) const;
+
   // Traverses the whole subtree starting from this node.
   // This method is used to visit all subtree nodes and execute handler functor
   // - this implements the expected behavior when a client subscribes to a node
@@ -365,6 +402,18 @@ class TreeNode {
   bool supports_on_update_;
   bool supports_on_replace_;
   bool supports_on_delete_;
+  // The children, indexed by name. The keys point to the keys of 'children_'.
+  absl::flat_hash_map<absl::string_view, TreeNode*> child_index_;
+  // GetSubtreeSupport() of this node, in the lower 8 bits, and the value of
+  // 'support_generation_' it was computed at, in the upper bits.
+  mutable std::atomic<uint64> subtree_support_{0};
+  // Incremented every time a node of any tree is added or changes its
+  // handlers. Starts at 1 so that a zeroed cache is out of date.
+  static std::atomic<uint64> support_generation_;
+  // Points to this node until it is destroyed. Shared with the functors
+  // returned by GetVisitingHandler().
+  std::shared_ptr<const TreeNode*> self_ =
+      std::make_shared<const TreeNode*>(this);
 
   friend class stratum::hal::YangParseTreeTest;
   friend class stratum::hal::SubscriptionTestBase;
@@ -443,6 +492,27 @@ class YangParseTree {
     return switch_interface_;
   }
 
+  // Retrieves the values requested by the leaves, from the batch set by
+  // SetRetrieveValueBatch() if any, or else from the SwitchInterface. Same
+  // contract as SwitchInterface::RetrieveValue().
+  ::util::Status RetrieveValue(uint64 node_id, const DataRequest& req,
+                               WriterInterface<DataResponse>* writer,
+                               std::vector<::util::Status>* details)
+      LOCKS_EXCLUDED(root_access_lock_);
+
+  // Makes RetrieveValue() go through 'batch' until it is called again with
+  // nullptr. The batch is not owned.
+  void SetRetrieveValueBatch(RetrieveValueBatch* batch)
+      LOCKS_EXCLUDED(root_access_lock_) {
+    absl::WriterMutexLock r(&root_access_lock_);
+
+    retrieve_value_batch_ = batch;
+  }
+
+  // Returns the cache of port counters shared by the counter leaves of all
+  // interfaces. The cache is thread-safe.
+  PortCountersCache* GetPortCountersCache() { return &port_counters_cache_; }
+
   // A getter providing a functor setting TARGET_DEFINED mode of a leaf to be
   // STREAM:SAMPLE.
   const TreeNode::TargetDefinedModeFunc& GetStreamSampleModeFunc() {
@@ -454,12 +524,31 @@ class YangParseTree {
   virtual void SendNotification(const GnmiEventPtr& event)
       LOCKS_EXCLUDED(root_access_lock_);
 
-  // An action that modifies the tree to reflect new configuration.
+  // An action that modifies the tree to reflect new configuration. Only the
+  // subtrees of the ports, nodes and chassis which changed since the previous
+  // config are added again or removed, the others are left untouched.
   void ProcessPushedConfig(const ConfigHasBeenPushedEvent& change)
       LOCKS_EXCLUDED(root_access_lock_);
 
  protected:
   using Action = std::function<void()>;
+  // The config items whose subtrees are in the tree, keyed by a fingerprint of
+  // the config they were added from, with the keyed subtrees added for each,
+  // e.g. /interfaces/interface[name=1/1/1] and /components/component[name=
+  // 1/1/1] for a singleton port.
+  using ConfigItems = absl::flat_hash_map<std::string, std::vector<TreeNode*>>;
+
+  // Moves the config item identified by 'fingerprint' from 'config_items_' to
+  // 'items'. If it is not found, 'add_subtree' is called to add its subtrees
+  // to the tree first. Returns true if the subtrees were added.
+  bool AddConfigItem(const std::string& fingerprint, const Action& add_subtree,
+                     ConfigItems* items)
+      EXCLUSIVE_LOCKS_REQUIRED(root_access_lock_);
+
+  // Removes the keyed subtrees of a config item no longer in the config,
+  // unless another config item uses them.
+  void RemoveConfigItem(const std::vector<TreeNode*>& keyed_subtrees)
+      EXCLUSIVE_LOCKS_REQUIRED(root_access_lock_);
 
   // Adds node to a tree at specified path.
   TreeNode* AddNode(const ::gnmi::Path& path)
@@ -483,7 +572,18 @@ class YangParseTree {
       const std::function<::util::Status(const TreeNode& leaf)>& action) const
       EXCLUSIVE_LOCKS_REQUIRED(root_access_lock_);
 
+  // The leaves 'action' is executed on by PerformActionForAllNonWildcardNodes()
+  // for 'path' and 'subpath', in the order of the children of 'path'. Kept in
+  // 'wildcard_cache_'.
+  ::util::StatusOr<std::shared_ptr<const std::vector<const TreeNode*>>>
+  FindAllNonWildcardLeaves(const gnmi::Path& path,
+                           const gnmi::Path& subpath) const
+      EXCLUSIVE_LOCKS_REQUIRED(root_access_lock_)
+          LOCKS_EXCLUDED(wildcard_cache_lock_);
+
   SwitchInterface* switch_interface_ GUARDED_BY(root_access_lock_);
+  // The batch used by RetrieveValue() while a Get is processed, or nullptr.
+  RetrieveValueBatch* retrieve_value_batch_ GUARDED_BY(root_access_lock_);
 
   // A channel between YangParseTree object and GnmiPublisher objest.
   // It is used to send notifications that a leaf has changed.
@@ -494,6 +594,31 @@ class YangParseTree {
   // A Mutex used to guard access to the root.
   mutable absl::Mutex root_access_lock_;
 
+  // The config items added by the last ProcessPushedConfig().
+  ConfigItems config_items_ GUARDED_BY(root_access_lock_);
+  // A keyed subtree added for one or more config items.
+  struct KeyedSubtree {
+    TreeNode* parent = nullptr;
+    int num_config_items = 0;
+  };
+  absl::flat_hash_map<const TreeNode*, KeyedSubtree> keyed_subtrees_
+      GUARDED_BY(root_access_lock_);
+  // While AddConfigItem() adds the subtrees of a config item, the keyed
+  // subtrees AddNode() goes through, with their parents.
+  absl::flat_hash_map<TreeNode*, TreeNode*>* added_keyed_subtrees_
+      GUARDED_BY(root_access_lock_) = nullptr;
+
+  // The expansions of the wildcard paths done by FindAllNonWildcardLeaves(),
+  // keyed by the serialized path and subpath. Cleared whenever nodes are added
+  // or removed, so when a config is pushed.
+  mutable absl::Mutex wildcard_cache_lock_;
+  mutable absl::flat_hash_map<
+      std::string, std::shared_ptr<const std::vector<const TreeNode*>>>
+      wildcard_cache_ GUARDED_BY(wildcard_cache_lock_);
+
+  // Snapshots of the port counters read from 'switch_interface_'.
+  PortCountersCache port_counters_cache_;
+
   // In most cases the TARGET_DEFINED mode is ON_CHANGE mode as this mode
   // is the least resource-hungry. But to make the gNMI demo more realistic it
   // is changed to SAMPLE with the period of 1s.
@@ -0,0 +1,122 @@
+// Copyright 2018-present Open Networking Foundation
+// SPDX-License-Identifier: Apache-2.0
+
+// Benchmarks the resolution of gNMI paths by YangParseTree on a switch with
+// 512 ports, as done for every Get and Subscribe request:
+// - BM_FindLeaf finds the node of one leaf of one interface,
+// - BM_SubtreeSupportsPoll checks that all the leaves of /interfaces support
+//   POLL, as done when subscribing to it,
+// - BM_GetAllInterfaceNames polls /interfaces/interface[name=*]/state/name,
+//   which expands the wildcard into the leaves of all the interfaces.
+// - BM_PushConfigWithOnePortChanged processes a config push changing the
+//   speed of one port. The tree is locked for the whole time.
+
+#include <string>
+
+#include "absl/strings/str_cat.h"
+#include "benchmark/benchmark.h"
+#include "gmock/gmock.h"
+#include "stratum/glue/logging.h"
+#include "stratum/hal/lib/common/switch_mock.h"
+#include "stratum/hal/lib/common/yang_parse_tree.h"
+#include "stratum/lib/constants.h"
+
+namespace stratum {
+namespace hal {
+namespace {
+
+constexpr int kNumPorts = 512;
+constexpr uint64 kNodeId = 1;
+
+// A YangParseTree for a switch with kNumPorts ports.
+class Tree {
+ public:
+  Tree() : tree_(&switch_) {
+    config_.add_nodes()->set_id(kNodeId);
+    for (int port = 1; port <= kNumPorts; ++port) {
+      auto* singleton_port = config_.add_singleton_ports();
+      singleton_port->set_id(port);
+      singleton_port->set_name(absl::StrCat("1/", port, "/1"));
+      singleton_port->set_node(kNodeId);
+      singleton_port->set_slot(1);
+      singleton_port->set_port(port);
+    }
+    tree_.ProcessPushedConfig(ConfigHasBeenPushedEvent(config_));
+  }
+
+  YangParseTree* tree() { return &tree_; }
+  const ChassisConfig& config() const { return config_; }
+
+ private:
+  ::testing::NiceMock<SwitchMock> switch_;
+  ChassisConfig config_;
+  YangParseTree tree_;
+};
+
+// Returns the path /interfaces/interface[name=<name>]/state/<leaf>.
+::gnmi::Path InterfaceStatePath(const std::string& name,
+                                const std::string& leaf) {
+  ::gnmi::Path path;
+  path.add_elem()->set_name("interfaces");
+  auto* elem = path.add_elem();
+  elem->set_name("interface");
+  (*elem->mutable_key())["name"] = name;
+  path.add_elem()->set_name("state");
+  path.add_elem()->set_name(leaf);
+  return path;
+}
+
+void BM_FindLeaf(benchmark::State& state) {
+  Tree tree;
+  const auto path = InterfaceStatePath("1/256/1", "oper-status");
+  CHECK(tree.tree()->FindNodeOrNull(path) != nullptr);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(tree.tree()->FindNodeOrNull(path));
+  }
+}
+BENCHMARK(BM_FindLeaf);
+
+void BM_SubtreeSupportsPoll(benchmark::State& state) {
+  Tree tree;
+  ::gnmi::Path path;
+  path.add_elem()->set_name("interfaces");
+  for (auto _ : state) {
+    const TreeNode* node = tree.tree()->FindNodeOrNull(path);
+    benchmark::DoNotOptimize(node->AllSubtreeLeavesSupportOnPoll());
+  }
+}
+BENCHMARK(BM_SubtreeSupportsPoll);
+
+void BM_GetAllInterfaceNames(benchmark::State& state) {
+  Tree tree;
+  int64 num_responses = 0;
+  InlineGnmiSubscribeStream stream(
+      [&num_responses](const ::gnmi::SubscribeResponse& resp) {
+        ++num_responses;
+        return true;
+      });
+  const auto path = InterfaceStatePath("*", "name");
+  for (auto _ : state) {
+    const TreeNode* node = tree.tree()->FindNodeOrNull(path);
+    CHECK_OK(node->GetOnPollHandler()(PollEvent(), &stream));
+  }
+  state.counters["responses_per_get"] = benchmark::Counter(
+      static_cast<double>(num_responses) / state.iterations());
+}
+BENCHMARK(BM_GetAllInterfaceNames);
+
+void BM_PushConfigWithOnePortChanged(benchmark::State& state) {
+  Tree tree;
+  ChassisConfig config = tree.config();
+  auto* singleton_port = config.mutable_singleton_ports(kNumPorts / 2);
+  for (auto _ : state) {
+    const bool is_slow = singleton_port->speed_bps() == kTwentyFiveGigBps;
+    singleton_port->set_speed_bps(is_slow ? kFortyGigBps : kTwentyFiveGigBps);
+    tree.tree()->ProcessPushedConfig(ConfigHasBeenPushedEvent(config));
+  }
+}
+BENCHMARK(BM_PushConfigWithOnePortChanged);
+
+}  // namespace
+}  // namespace hal
+}  // namespace stratum
@@ -221,7 +221,7 @@ TreeNodeSetHandler GetOnUpdateFunctor(
 }
 
 // A family of helper methods that request a value of type U from the switch
-// using SwitchInterface::RetrieveValue() call. To do its job it requires:
+// using YangParseTree::RetrieveValue() call. To do its job it requires:
 // - a pointer to method that gets the message of type T that is part of the
 //   DataResponse protobuf and that keeps the value to be returned
 //   ('data_response_get_inner_message_func')
@@ -265,8 +265,7 @@ U GetValue(
   // Query the switch. The returned status is ignored as there is no way to
   // notify the controller that something went wrong. The error is logged when
   // it is created.
-  tree->GetSwitchInterface()
-      ->RetrieveValue(node_id, req, &writer, /* details= */ nullptr)
+  tree->RetrieveValue(node_id, req, &writer, /* details= */ nullptr)
       .IgnoreError();
   // Return the retrieved value.
   return resp;
@@ -306,8 +305,7 @@ U GetValue(
   // Query the switch. The returned status is ignored as there is no way to
   // notify the controller that something went wrong. The error is logged when
   // it is created.
-  tree->GetSwitchInterface()
-      ->RetrieveValue(node_id, req, &writer, /* details= */ nullptr)
+  tree->RetrieveValue(node_id, req, &writer, /* details= */ nullptr)
       .IgnoreError();
   // Return the retrieved value.
   return resp;
@@ -341,8 +339,7 @@ U GetValue(
   // Query the switch. The returned status is ignored as there is no way to
   // notify the controller that something went wrong. The error is logged when
   // it is created.
-  tree->GetSwitchInterface()
-      ->RetrieveValue(/* node_id= */ 0, req, &writer, /* details= */ nullptr)
+  tree->RetrieveValue(/* node_id= */ 0, req, &writer, /* details= */ nullptr)
       .IgnoreError();
   // Return the retrieved value.
   return resp;
@@ -377,8 +374,7 @@ U GetValue(
   // Query the switch. The returned status is ignored as there is no way to
   // notify the controller that something went wrong. The error is logged when
   // it is created.
-  tree->GetSwitchInterface()
-      ->RetrieveValue(node_id, req, &writer, /* details= */ nullptr)
+  tree->RetrieveValue(node_id, req, &writer, /* details= */ nullptr)
       .IgnoreError();
   // Return the retrieved value.
   return resp;
@@ -422,8 +418,7 @@ U GetValue(
   // Query the switch. The returned status is ignored as there is no way to
   // notify the controller that something went wrong. The error is logged when
   // it is created.
-  tree->GetSwitchInterface()
-      ->RetrieveValue(node_id, req, &writer, /* details= */ nullptr)
+  tree->RetrieveValue(node_id, req, &writer, /* details= */ nullptr)
       .IgnoreError();
   // Return the retrieved value.
   return resp;
@@ -512,8 +507,7 @@ TreeNodeEventHandler GetOnPollFunctor(
     // notify the controller that something went wrong. The error is logged when
     // it is created.
     // Here we ignore the node_id since it is not valid in this case.
-    tree->GetSwitchInterface()
-        ->RetrieveValue(/*node_id*/ 0, req, &writer, /* details= */ nullptr)
+    tree->RetrieveValue(/*node_id*/ 0, req, &writer, /* details= */ nullptr)
         .IgnoreError();
     // Return the retrieved value.
     T value = (resp.*inner_message_get_field_func)();
@@ -550,8 +544,7 @@ TreeNodeEventHandler GetOnPollFunctor(
     // notify the controller that something went wrong. The error is logged when
     // it is created.
     // Here we ignore the node_id since it is not valid in this case.
-    tree->GetSwitchInterface()
-        ->RetrieveValue(/*node_id*/ 0, req, &writer, /* details= */ nullptr)
+    tree->RetrieveValue(/*node_id*/ 0, req, &writer, /* details= */ nullptr)
         .IgnoreError();
     // Return the retrieved value. Note that we will return a default value if
     // the second level nest message does not exists.
@@ -1048,8 +1041,7 @@ void SetUpInterfacesInterfaceStateHardwarePort(uint64 node_id, uint32 port_id,
     // Query the switch. The returned status is ignored as there is no way to
     // notify the controller that something went wrong. The error is logged when
     // it is created.
-    tree->GetSwitchInterface()
-        ->RetrieveValue(node_id, req, &writer, /* details= */ nullptr)
+    tree->RetrieveValue(node_id, req, &writer, /* details= */ nullptr)
         .IgnoreError();
     return SendResponse(GetResponse(path, resp), stream);
   };
@@ -1713,26 +1705,17 @@ TreeNodeEventHandler GetPollCounterFunctor(
   return [tree, node_id, port_id, func_ptr](const GnmiEvent& event,
                                             const ::gnmi::Path& path,
                                             GnmiSubscribeStream* stream) {
-    // Create a data retrieval request.
-    DataRequest req;
-    auto* request = req.add_requests()->mutable_port_counters();
-    request->set_node_id(node_id);
-    request->set_port_id(port_id);
-
-    // In-place definition of method retrieving data from generic response
-    // and saving into 'resp' local variable.
-    uint64 resp = 0;
-    DataResponseWriter writer(
-        [&resp, func_ptr](const DataResponse& in) -> bool {
-          if (!in.has_port_counters()) return false;
-          resp = (in.port_counters().*func_ptr)();
-          return true;
-        });
-    // Query the switch. The returned status is ignored as there is no way to
+    // The counters are read from a snapshot of the port counters shared by all
+    // the counter leaves of the port, so that sampling all of them reads the
+    // port counters once. The returned status is ignored as there is no way to
     // notify the controller that something went wrong. The error is logged when
     // it is created.
-    auto status = tree->GetSwitchInterface()->RetrieveValue(
-        node_id, req, &writer, /* details= */ nullptr);
+    uint64 resp = 0;
+    auto counters =
+        tree->GetPortCountersCache()->GetPortCounters(node_id, port_id);
+    if (counters.ok()) {
+      resp = (counters.ValueOrDie().*func_ptr)();
+    }
     return SendResponse(GetResponse(path, resp), stream);
   };
 }
@@ -2121,8 +2104,7 @@ void SetUpComponentsComponentChassisAlarmsMemoryErrorInfo(TreeNode* node,
     // Query the switch. The returned status is ignored as there is no way to
     // notify the controller that something went wrong. The error is logged when
     // it is created.
-    tree->GetSwitchInterface()
-        ->RetrieveValue(/* node_id= */ 0, req, &writer, /* details= */ nullptr)
+    tree->RetrieveValue(/* node_id= */ 0, req, &writer, /* details= */ nullptr)
         .IgnoreError();
     return SendResponse(GetResponse(path, resp), stream);
   };
@@ -2224,8 +2206,7 @@ void SetUpComponentsComponentChassisAlarmsFlowProgrammingExceptionInfo(
     // Query the switch. The returned status is ignored as there is no way to
     // notify the controller that something went wrong. The error is logged when
     // it is created.
-    tree->GetSwitchInterface()
-        ->RetrieveValue(/* node_id= */ 0, req, &writer, /* details= */ nullptr)
+    tree->RetrieveValue(/* node_id= */ 0, req, &writer, /* details= */ nullptr)
         .IgnoreError();
     return SendResponse(GetResponse(path, resp), stream);
   };
@@ -2298,8 +2279,7 @@ void SetUpComponentsComponentTransceiverStateSerialNo(
         // Query the switch. The returned status is ignored as there is no
         // way to notify the controller that something went wrong.
         // The error is logged when it is created.
-        tree->GetSwitchInterface()
-            ->RetrieveValue(node_id, req, &writer, /* details= */ nullptr)
+        tree->RetrieveValue(node_id, req, &writer, /* details= */ nullptr)
             .IgnoreError();
         return SendResponse(GetResponse(path, resp), stream);
       };
@@ -2336,8 +2316,7 @@ void SetUpComponentsComponentTransceiverStateVendor(
     // Query the switch. The returned status is ignored as there is no way to
     // notify the controller that something went wrong. The error is
     // logged when it is created.
-    tree->GetSwitchInterface()
-        ->RetrieveValue(node_id, req, &writer, /* details= */ nullptr)
+    tree->RetrieveValue(node_id, req, &writer, /* details= */ nullptr)
         .IgnoreError();
     return SendResponse(GetResponse(path, resp), stream);
   };
@@ -2373,8 +2352,7 @@ void SetUpComponentsComponentTransceiverStateVendorPart(
         // Query the switch. The returned status is ignored as there is no
         // way to notify the controller that something went wrong.
         // The error is logged when it is created.
-        tree->GetSwitchInterface()
-            ->RetrieveValue(node_id, req, &writer, /* details= */ nullptr)
+        tree->RetrieveValue(node_id, req, &writer, /* details= */ nullptr)
             .IgnoreError();
         return SendResponse(GetResponse(path, resp), stream);
       };
@@ -2996,8 +2974,7 @@ void SetUpComponentsComponentStatePartNo(uint64 node_id, TreeNode* node,
     // Query the switch. The returned status is ignored as there is no way to
     // notify the controller that something went wrong. The error is logged when
     // it is created.
-    tree->GetSwitchInterface()
-        ->RetrieveValue(node_id, req, &writer, /* details= */ nullptr)
+    tree->RetrieveValue(node_id, req, &writer, /* details= */ nullptr)
         .IgnoreError();
     return SendResponse(GetResponse(path, resp), stream);
   };
@@ -3026,8 +3003,7 @@ void SetUpComponentsComponentStateMfgName(uint64 node_id, TreeNode* node,
     // Query the switch. The returned status is ignored as there is no way to
     // notify the controller that something went wrong. The error is logged when
     // it is created.
-    tree->GetSwitchInterface()
-        ->RetrieveValue(node_id, req, &writer, /* details= */ nullptr)
+    tree->RetrieveValue(node_id, req, &writer, /* details= */ nullptr)
         .IgnoreError();
     return SendResponse(GetResponse(path, resp), stream);
   };
@@ -3193,8 +3169,7 @@ void SetUpDebugNodesNodePacketIoDebugString(uint64 node_id, TreeNode* node,
     // Query the switch. The returned status is ignored as there is no way to
     // notify the controller that something went wrong. The error is logged when
     // it is created.
-    tree->GetSwitchInterface()
-        ->RetrieveValue(node_id, req, &writer, /* details= */ nullptr)
+    tree->RetrieveValue(node_id, req, &writer, /* details= */ nullptr)
         .IgnoreError();
     return SendResponse(GetResponse(path, resp), stream);
   };
@@ -4,6 +4,10 @@
 
 #include "stratum/hal/lib/common/yang_parse_tree_mock.h"
 
+#include <string>
+#include <vector>
+
+#include "gflags/gflags.h"
 #include "google/protobuf/text_format.h"
 #include "gnmi/gnmi.pb.h"
 #include "openconfig/openconfig.pb.h"
@@ -20,6 +24,10 @@
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
 #include "absl/synchronization/mutex.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+
+DECLARE_int32(port_counters_cache_max_age_ms);
 
 namespace stratum {
 namespace hal {
@@ -31,6 +39,7 @@ using ::testing::DoAll;
 using ::testing::HasSubstr;
 using ::testing::Invoke;
 using ::testing::Return;
+using ::testing::SaveArg;
 using ::testing::SizeIs;
 using ::testing::WithArg;
 using ::testing::WithArgs;
@@ -99,6 +108,29 @@ class YangParseTreeTest : public ::testing::Test {
                                                            action);
   }
 
+  // A proxy for YangParseTree::FindAllNonWildcardLeaves().
+  ::util::StatusOr<std::shared_ptr<const std::vector<const TreeNode*>>>
+  FindAllNonWildcardLeaves(const gnmi::Path& path,
+                           const gnmi::Path& subpath) const {
+    absl::WriterMutexLock l(&parse_tree_.root_access_lock_);
+
+    return parse_tree_.FindAllNonWildcardLeaves(path, subpath);
+  }
+
+  // Returns the number of wildcard expansions cached by the parse tree.
+  size_t WildcardCacheSize() const {
+    absl::MutexLock l(&parse_tree_.wildcard_cache_lock_);
+
+    return parse_tree_.wildcard_cache_.size();
+  }
+
+  // Returns true if the cached TreeNode::GetSubtreeSupport() of 'node' is up
+  // to date.
+  static bool IsSubtreeSupportCached(const TreeNode& node) {
+    return node.subtree_support_.load() >> 8 ==
+           TreeNode::support_generation_.load();
+  }
+
   // A proxy for YangParseTree::gnmi_event_writer_.
   void SetGnmiEventWriter(WriterInterface<GnmiEventPtr>* channel) {
     absl::WriterMutexLock l(&parse_tree_.root_access_lock_);
@@ -689,6 +721,216 @@ TEST_F(YangParseTreeTest, PerformActionForAllNodesOnePresent) {
       GetPath("interfaces")("interface", "interface-1")("state")("ifindex")()));
 }
 
+namespace {
+
+// Returns a config with one node and a singleton port for each of 'names'.
+ChassisConfig ConfigWithPorts(const std::vector<std::string>& names) {
+  ChassisConfig config;
+  config.add_nodes()->set_id(1);
+  int port = 0;
+  for (const auto& name : names) {
+    auto* singleton = config.add_singleton_ports();
+    singleton->set_id(++port);
+    singleton->set_name(name);
+    singleton->set_node(1);
+    singleton->set_port(port);
+    singleton->set_speed_bps(kTwentyFiveGigBps);
+  }
+  return config;
+}
+
+}  // namespace
+
+// Check that the expansion of a wildcard path is cached.
+TEST_F(YangParseTreeTest, WildcardExpansionIsCached) {
+  AddSubtreeInterface("interface-1");
+  const auto path = GetPath("interfaces")("interface")();
+  const auto subpath = GetPath("state")("ifindex")();
+  EXPECT_EQ(0, WildcardCacheSize());
+
+  auto first = FindAllNonWildcardLeaves(path, subpath);
+  ASSERT_OK(first);
+  EXPECT_THAT(*first.ValueOrDie(), SizeIs(1));
+  EXPECT_EQ(1, WildcardCacheSize());
+
+  // The second expansion is the cached one.
+  auto second = FindAllNonWildcardLeaves(path, subpath);
+  ASSERT_OK(second);
+  EXPECT_EQ(first.ValueOrDie(), second.ValueOrDie());
+  EXPECT_EQ(1, WildcardCacheSize());
+
+  // Other subpaths are cached separately.
+  auto other = FindAllNonWildcardLeaves(path, GetPath("state")("name")());
+  ASSERT_OK(other);
+  EXPECT_NE(first.ValueOrDie(), other.ValueOrDie());
+  EXPECT_EQ(2, WildcardCacheSize());
+}
+
+// Check that the cached wildcard expansions are dropped when a node is added,
+// so that they find the new node.
+TEST_F(YangParseTreeTest, WildcardCacheIsInvalidatedByAddNode) {
+  const auto path = GetPath("interfaces")("interface")();
+  const auto subpath = GetPath("state")("ifindex")();
+  auto before = FindAllNonWildcardLeaves(path, subpath);
+  ASSERT_OK(before);
+  EXPECT_THAT(*before.ValueOrDie(), SizeIs(0));
+  EXPECT_EQ(1, WildcardCacheSize());
+
+  AddSubtreeInterface("interface-1");
+  EXPECT_EQ(0, WildcardCacheSize());
+  auto after = FindAllNonWildcardLeaves(path, subpath);
+  ASSERT_OK(after);
+  ASSERT_THAT(*after.ValueOrDie(), SizeIs(1));
+  EXPECT_EQ(
+      parse_tree_.FindNodeOrNull(GetPath("interfaces")(
+          "interface", "interface-1")("state")("ifindex")()),
+      after.ValueOrDie()->at(0));
+}
+
+// Check that the cached wildcard expansions are dropped when a config is
+// pushed, so that they find the added ports.
+TEST_F(YangParseTreeTest, WildcardCacheIsInvalidatedByConfigPush) {
+  const auto path = GetPath("interfaces")("interface")();
+  const auto subpath = GetPath("state")("ifindex")();
+  parse_tree_.ProcessPushedConfig(
+      ConfigHasBeenPushedEvent(ConfigWithPorts({"1/1/1"})));
+  auto before = FindAllNonWildcardLeaves(path, subpath);
+  ASSERT_OK(before);
+  EXPECT_THAT(*before.ValueOrDie(), SizeIs(1));
+  EXPECT_EQ(1, WildcardCacheSize());
+
+  parse_tree_.ProcessPushedConfig(
+      ConfigHasBeenPushedEvent(ConfigWithPorts({"1/1/1", "1/2/1"})));
+  EXPECT_EQ(0, WildcardCacheSize());
+  auto after = FindAllNonWildcardLeaves(path, subpath);
+  ASSERT_OK(after);
+  EXPECT_THAT(*after.ValueOrDie(), SizeIs(2));
+}
+
+// Check that the modes supported by a subtree are cached until the tree
+// changes.
+TEST_F(YangParseTreeTest, SubtreeSupportIsCached) {
+  const TreeNode& root = GetRoot();
+  EXPECT_TRUE(root.AllSubtreeLeavesSupportOnPoll());
+  EXPECT_TRUE(IsSubtreeSupportCached(root));
+  const TreeNode* interfaces = root.FindNodeOrNull(GetPath("interfaces")());
+  ASSERT_NE(nullptr, interfaces);
+  EXPECT_TRUE(IsSubtreeSupportCached(*interfaces));
+
+  // Reading the cached support does not invalidate it.
+  EXPECT_TRUE(root.AllSubtreeLeavesSupportOnPoll());
+  EXPECT_FALSE(root.AllSubtreeLeavesSupportOnUpdate());
+  EXPECT_TRUE(IsSubtreeSupportCached(root));
+  EXPECT_TRUE(IsSubtreeSupportCached(*interfaces));
+}
+
+// Check that the cached subtree support is recomputed once a node is added.
+TEST_F(YangParseTreeTest, SubtreeSupportCacheIsInvalidatedByAddNode) {
+  const TreeNode& root = GetRoot();
+  EXPECT_TRUE(root.AllSubtreeLeavesSupportOnPoll());
+  EXPECT_TRUE(IsSubtreeSupportCached(root));
+
+  // A new leaf has no handlers, so it does not support polling.
+  AddNode(GetPath("test")("leaf")());
+  EXPECT_FALSE(IsSubtreeSupportCached(root));
+  EXPECT_FALSE(root.AllSubtreeLeavesSupportOnPoll());
+  EXPECT_TRUE(IsSubtreeSupportCached(root));
+}
+
+// Check that the cached subtree support is recomputed once a config is pushed.
+TEST_F(YangParseTreeTest, SubtreeSupportCacheIsInvalidatedByConfigPush) {
+  const TreeNode& root = GetRoot();
+  EXPECT_TRUE(root.AllSubtreeLeavesSupportOnPoll());
+  EXPECT_TRUE(IsSubtreeSupportCached(root));
+
+  parse_tree_.ProcessPushedConfig(
+      ConfigHasBeenPushedEvent(ConfigWithPorts({"1/1/1"})));
+  EXPECT_FALSE(IsSubtreeSupportCached(root));
+  const TreeNode* port =
+      parse_tree_.FindNodeOrNull(GetPath("interfaces")("interface", "1/1/1")());
+  ASSERT_NE(nullptr, port);
+
+  // The support of the root is recomputed with the new port.
+  root.AllSubtreeLeavesSupportOnPoll();
+  EXPECT_TRUE(IsSubtreeSupportCached(*port));
+  EXPECT_TRUE(IsSubtreeSupportCached(root));
+}
+
+// Check that the subtrees of the removed ports are removed and the others are
+// left untouched.
+TEST_F(YangParseTreeTest, ProcessPushedConfigRemovesDeletedPorts) {
+  const auto port_1 =
+      GetPath("interfaces")("interface", "1/1/1")("state")("oper-status")();
+  const auto port_2 =
+      GetPath("interfaces")("interface", "1/2/1")("state")("oper-status")();
+  const auto transceiver_2 = GetPath("components")(
+      "component", "1/2/1")("transceiver")("state")("present")();
+
+  parse_tree_.ProcessPushedConfig(
+      ConfigHasBeenPushedEvent(ConfigWithPorts({"1/1/1", "1/2/1"})));
+  const TreeNode* node_1 = parse_tree_.FindNodeOrNull(port_1);
+  ASSERT_NE(nullptr, node_1);
+  ASSERT_NE(nullptr, parse_tree_.FindNodeOrNull(port_2));
+  ASSERT_NE(nullptr, parse_tree_.FindNodeOrNull(transceiver_2));
+
+  parse_tree_.ProcessPushedConfig(
+      ConfigHasBeenPushedEvent(ConfigWithPorts({"1/1/1"})));
+  EXPECT_EQ(node_1, parse_tree_.FindNodeOrNull(port_1));
+  EXPECT_EQ(nullptr, parse_tree_.FindNodeOrNull(port_2));
+  EXPECT_EQ(nullptr, parse_tree_.FindNodeOrNull(transceiver_2));
+
+  // The wildcard paths no longer find the removed port.
+  std::vector<std::string> names;
+  EXPECT_OK(PerformActionForAllNonWildcardNodes(
+      GetPath("interfaces")("interface")(), GetPath("state")("ifindex")(),
+      [&names](const TreeNode& leaf) {
+        names.push_back(leaf.parent().parent().name());
+        return ::util::OkStatus();
+      }));
+  EXPECT_THAT(names, ::testing::ElementsAre("1/1/1"));
+}
+
+// Check that a changed port is updated in place, so that the subscriptions to
+// it see the new config.
+TEST_F(YangParseTreeTest, ProcessPushedConfigUpdatesChangedPorts) {
+  const auto path = GetPath("interfaces")(
+      "interface", "1/1/1")("ethernet")("config")("port-speed")();
+  ChassisConfig config = ConfigWithPorts({"1/1/1"});
+  parse_tree_.ProcessPushedConfig(ConfigHasBeenPushedEvent(config));
+  const TreeNode* node = parse_tree_.FindNodeOrNull(path);
+  ASSERT_NE(nullptr, node);
+  const auto handler = node->GetOnPollHandler();
+
+  config.mutable_singleton_ports(0)->set_speed_bps(kFortyGigBps);
+  parse_tree_.ProcessPushedConfig(ConfigHasBeenPushedEvent(config));
+  EXPECT_EQ(node, parse_tree_.FindNodeOrNull(path));
+
+  ::gnmi::SubscribeResponse resp;
+  SubscribeReaderWriterMock stream;
+  EXPECT_CALL(stream, Write(_, _))
+      .WillOnce(DoAll(SaveArg<0>(&resp), Return(true)));
+  ASSERT_OK(handler(PollEvent(), &stream));
+  ASSERT_EQ(resp.update().update_size(), 1);
+  EXPECT_EQ(resp.update().update(0).val().string_val(), "SPEED_40GB");
+}
+
+// Check that the handlers of a removed subtree kept by a subscription do
+// nothing.
+TEST_F(YangParseTreeTest, HandlerOfRemovedPortDoesNothing) {
+  parse_tree_.ProcessPushedConfig(
+      ConfigHasBeenPushedEvent(ConfigWithPorts({"1/1/1"})));
+  const TreeNode* node =
+      parse_tree_.FindNodeOrNull(GetPath("interfaces")("interface", "1/1/1")());
+  ASSERT_NE(nullptr, node);
+  const auto handler = node->GetOnPollHandler();
+
+  parse_tree_.ProcessPushedConfig(
+      ConfigHasBeenPushedEvent(ConfigWithPorts({})));
+  SubscribeReaderWriterMock stream;
+  EXPECT_CALL(stream, Write(_, _)).Times(0);
+  EXPECT_OK(handler(PollEvent(), &stream));
+}
+
 // Check if RetrieveValue is called.
 TEST_F(YangParseTreeTest, GetDataFromSwitchInterfaceCalled) {
   // Create a fake switch interface object.
@@ -1350,6 +1592,62 @@ TEST_F(YangParseTreeTest,
   EXPECT_EQ(resp.update().update(0).val().uint_val(), kInOctets);
 }
 
+// Check that sampling all the counters of an interface reads the port counters
+// once per sampling tick, not once per counter leaf.
+TEST_F(YangParseTreeTest,
+       InterfacesInterfaceStateCountersOnTimerReadsPortCountersOncePerTick) {
+  AddSubtreeInterface("interface-1");
+  auto path =
+      GetPath("interfaces")("interface", "interface-1")("state")("counters")();
+  constexpr int kNumCounterLeaves = 14;
+  constexpr uint64 kInOctets = 5;
+
+  // One read of the port counters per tick.
+  EXPECT_CALL(switch_, RetrieveValue(kInterface1NodeId, _, _, _))
+      .Times(2)
+      .WillRepeatedly(
+          DoAll(WithArg<2>(Invoke([](WriterInterface<DataResponse>* w) {
+                  DataResponse resp;
+                  resp.mutable_port_counters()->set_in_octets(kInOctets);
+                  w->Write(resp);
+                })),
+                Return(::util::OkStatus())));
+  SubscribeReaderWriterMock stream;
+  std::vector<::gnmi::SubscribeResponse> responses;
+  EXPECT_CALL(stream, Write(_, _))
+      .WillRepeatedly(
+          DoAll(WithArgs<0>(Invoke(
+                    [&responses](const ::gnmi::SubscribeResponse& r) {
+                      responses.push_back(r);
+                    })),
+                Return(true)));
+
+  auto* node = GetRoot().FindNodeOrNull(path);
+  ASSERT_NE(node, nullptr);
+  const auto handler = node->GetOnTimerHandler();
+  ASSERT_OK(handler(TimerEvent(), &stream));
+  EXPECT_THAT(responses, SizeIs(kNumCounterLeaves));
+  // The next tick comes after the snapshot of the previous one has expired.
+  absl::SleepFor(absl::Milliseconds(FLAGS_port_counters_cache_max_age_ms));
+  ASSERT_OK(handler(TimerEvent(), &stream));
+  ASSERT_THAT(responses, SizeIs(2 * kNumCounterLeaves));
+
+  // All leaves got the value of the snapshot.
+  int num_in_octets = 0;
+  for (const auto& resp : responses) {
+    const auto& leaf_path = resp.update().update(0).path();
+    if (leaf_path.elem(leaf_path.elem_size() - 1).name() == "in-octets") {
+      EXPECT_EQ(kInOctets, resp.update().update(0).val().uint_val());
+      ++num_in_octets;
+    }
+  }
+  EXPECT_EQ(2, num_in_octets);
+
+  const auto stats = parse_tree_.GetPortCountersCache()->GetStats();
+  EXPECT_EQ(2U, stats.num_switch_reads);
+  EXPECT_EQ(2U * (kNumCounterLeaves - 1), stats.num_reads_avoided);
+}
+
 // Check if the 'counters/in-octets' OnChange action works correctly.
 TEST_F(YangParseTreeTest,
        InterfacesInterfaceStateCountersInOctetsOnChangeSuccess) {
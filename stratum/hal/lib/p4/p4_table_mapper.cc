@@ -4,7 +4,7 @@
 
 #include "stratum/hal/lib/p4/p4_table_mapper.h"
 
-#include <set>
+#include <utility>
 
 #include "absl/memory/memory.h"
 #include "gflags/gflags.h"
@@ -104,10 +104,21 @@ P4TableMapper::~P4TableMapper() { Shutdown().IgnoreError(); }
   //  2) Determine the table-specific header field conversion that applies
   //     to each match field.
   //  3) Establish a correspondence between the table and its valid actions.
+  // The results are compiled into the table's plan for MapFlowEntry.  The
+  // tables come from p4_info_manager_ so that the plan can refer to them.
   param_mapper_ = absl::make_unique<P4ActionParamMapper>(
       *p4_info_manager_, global_id_table_map_, p4_pipeline_config_);
 
-  for (const auto& table : p4_info.tables()) {
+  for (const auto& table : p4_info_manager_->p4_info().tables()) {
+    P4TablePlan& table_plan = table_plans_[table.preamble().id()];
+    table_plan.table_p4_info = &table;
+    table_plan.match_fields.resize(table.match_fields_size());
+    for (int i = 0; i < table.match_fields_size(); ++i) {
+      P4MatchFieldSlot& slot = table_plan.match_fields[i];
+      slot.field_id = table.match_fields(i).id();
+      slot.dont_care_match.set_field_id(slot.field_id);
+    }
+
     ::util::Status table_status = AddMapEntryFromPreamble(table.preamble());
     if (!table_status.ok()) {
       // Since there are discrepancies caused by hidden p4c internal objects
@@ -116,8 +127,14 @@ P4TableMapper::~P4TableMapper() { Shutdown().IgnoreError(); }
                    << " table descriptor in the forwarding pipeline spec";
       continue;
     }
+    const P4TableMapValue* table_map_value =
+        gtl::FindPtrOrNull(global_id_table_map_, table.preamble().id());
+    if (table_map_value != nullptr) {
+      table_plan.table_descriptor = &table_map_value->table_descriptor();
+    }
 
-    for (const auto& match_field : table.match_fields()) {
+    for (int i = 0; i < table.match_fields_size(); ++i) {
+      const auto& match_field = table.match_fields(i);
       if (match_field.name().empty()) {
         LOG(WARNING) << "Match field " << match_field.ShortDebugString()
                      << " in table " << table.preamble().name()
@@ -142,6 +159,8 @@ P4TableMapper::~P4TableMapper() { Shutdown().IgnoreError(); }
             value.mapped_field.set_bit_width(field_descriptor.bit_width());
             value.mapped_field.set_header_type(field_descriptor.header_type());
             field_convert_by_table_[key] = value;
+            table_plan.match_fields[i].convert_value =
+                &field_convert_by_table_[key];
             conversion_found = true;
             break;
           }
@@ -175,6 +194,11 @@ P4TableMapper::~P4TableMapper() { Shutdown().IgnoreError(); }
                      << "action " << PrintP4ObjectID(action_ref.id())
                      << " in table " << table.preamble().name();
       }
+      if (param_mapper_->IsActionInTableInfo(table.preamble().id(),
+                                             action_ref.id())
+              .ok()) {
+        table_plan.action_ids.insert(action_ref.id());
+      }
     }
   }
 
@@ -315,30 +339,36 @@ P4TableMapper::~P4TableMapper() { Shutdown().IgnoreError(); }
   ::util::Status status = ::util::OkStatus();
 
   // The table should be recognized in the P4Info, and it must contain a
-  // valid set of match fields and one action.
+  // valid set of match fields and one action.  Every table in the P4Info has
+  // a plan, so P4InfoManager is only asked to report unknown tables.
   int p4_table_id = table_entry.table_id();
-  ASSIGN_OR_RETURN(::p4::config::v1::Table table_p4_info,
-                   p4_info_manager_->FindTableByID(p4_table_id));
-  std::vector<::p4::v1::FieldMatch> all_match_fields;
+  const P4TablePlan* table_plan = gtl::FindOrNull(table_plans_, p4_table_id);
+  if (table_plan == nullptr) {
+    RETURN_IF_ERROR(p4_info_manager_->FindTableByID(p4_table_id).status());
+    return MAKE_ERROR(ERR_INTERNAL)
+           << "P4 table ID " << PrintP4ObjectID(p4_table_id)
+           << " has no mapping plan";
+  }
+  P4MatchFieldRefs all_match_fields;
   RETURN_IF_ERROR(
-      PrepareMatchFields(table_p4_info, table_entry, &all_match_fields));
+      PrepareMatchFields(*table_plan, table_entry, &all_match_fields));
   if (update_type == ::p4::v1::Update::INSERT && !table_entry.has_action()) {
     return MAKE_ERROR(ERR_INVALID_PARAM)
            << "P4 TableEntry update has no action";
   }
 
-  APPEND_STATUS_IF_ERROR(
-      status, ProcessTableID(table_p4_info, p4_table_id, flow_entry));
+  APPEND_STATUS_IF_ERROR(status,
+                         ProcessTableID(*table_plan, p4_table_id, flow_entry));
 
   for (const auto& match_field : all_match_fields) {
     APPEND_STATUS_IF_ERROR(
-        status, ProcessMatchField(table_p4_info, match_field, flow_entry));
+        status, ProcessMatchField(*table_plan, match_field, flow_entry));
   }
 
   if (table_entry.has_action()) {
     APPEND_STATUS_IF_ERROR(
         status,
-        ProcessTableAction(table_p4_info, table_entry.action(), flow_entry));
+        ProcessTableAction(*table_plan, table_entry.action(), flow_entry));
   }
 
   flow_entry->set_priority(table_entry.priority());
@@ -601,9 +631,10 @@ std::string P4TableMapper::GetMapperNameKey(
 }
 
 ::util::Status P4TableMapper::PrepareMatchFields(
-    const ::p4::config::v1::Table& table_p4_info,
-    const ::p4::v1::TableEntry& table_entry,
-    std::vector<::p4::v1::FieldMatch>* all_match_fields) const {
+    const P4TablePlan& table_plan, const ::p4::v1::TableEntry& table_entry,
+    P4MatchFieldRefs* all_match_fields) const {
+  const ::p4::config::v1::Table& table_p4_info = *table_plan.table_p4_info;
+
   // An empty set of match fields changes the default action for tables
   // that were not defined with a const default action in the P4 program.
   if (table_entry.match_size() == 0) {
@@ -619,32 +650,62 @@ std::string P4TableMapper::GetMapperNameKey(
   // Per field validations:
   //  - Every field_id must be non-zero.
   //  - A field_id can appear in a match field at most once.
-  std::set<uint32> requested_field_ids;
-  for (const auto& match_field : table_entry.match()) {
-    if (match_field.field_id() == 0) {
+  // The requested slots of the table plan are flagged to find the duplicate
+  // and the missing fields.
+  const auto& slots = table_plan.match_fields;
+  absl::InlinedVector<bool, 16> slot_requested(slots.size(), false);
+  for (int m = 0; m < table_entry.match_size(); ++m) {
+    const auto& match_field = table_entry.match(m);
+    const uint32 field_id = match_field.field_id();
+    if (field_id == 0) {
       return MAKE_ERROR(ERR_INVALID_PARAM)
              << "P4 TableEntry match field has no field_id. "
              << table_entry.ShortDebugString();
     }
-    if (!requested_field_ids.insert(match_field.field_id()).second) {
+
+    // P4 compilers number the match fields of a table from 1 in P4Info
+    // order, so the slot at field_id - 1 is tried before searching.
+    int slot_index = -1;
+    if (field_id <= slots.size() && slots[field_id - 1].field_id == field_id) {
+      slot_index = field_id - 1;
+    } else {
+      for (size_t s = 0; s < slots.size(); ++s) {
+        if (slots[s].field_id == field_id) {
+          slot_index = s;
+          break;
+        }
+      }
+    }
+
+    bool duplicate = false;
+    if (slot_index >= 0) {
+      duplicate = slot_requested[slot_index];
+      slot_requested[slot_index] = true;
+    } else {
+      // Fields foreign to the table are rare, a search of the preceding
+      // match fields is enough to find their duplicates.
+      for (int prev = 0; prev < m && !duplicate; ++prev) {
+        duplicate = table_entry.match(prev).field_id() == field_id;
+      }
+    }
+    if (duplicate) {
       return MAKE_ERROR(ERR_INVALID_PARAM)
              << "P4 TableEntry update of table "
              << table_p4_info.preamble().name() << " has multiple match field "
-             << "entries for field_id " << match_field.field_id() << ". "
+             << "entries for field_id " << field_id << ". "
              << table_entry.ShortDebugString();
     }
-    all_match_fields->push_back(match_field);
+    all_match_fields->push_back(std::make_pair(
+        &match_field, slot_index >= 0 ? &slots[slot_index] : nullptr));
   }
 
   // Any missing fields in the request are added with don't care values below.
   // The P4MatchKey instance in ProcessMatchField ultimately determines whether
   // don't-care/default usage is permissible for each field.
-  for (const auto& p4info_match_field : table_p4_info.match_fields()) {
-    if (requested_field_ids.find(p4info_match_field.id()) ==
-        requested_field_ids.end()) {
-      ::p4::v1::FieldMatch dont_care_match;
-      dont_care_match.set_field_id(p4info_match_field.id());
-      all_match_fields->push_back(dont_care_match);
+  for (size_t s = 0; s < slots.size(); ++s) {
+    if (!slot_requested[s]) {
+      all_match_fields->push_back(
+          std::make_pair(&slots[s].dont_care_match, &slots[s]));
     }
   }
 
@@ -652,21 +713,21 @@ std::string P4TableMapper::GetMapperNameKey(
 }
 
 ::util::Status P4TableMapper::ProcessTableID(
-    const ::p4::config::v1::Table& table_p4_info, int table_id,
+    const P4TablePlan& table_plan, int table_id,
     CommonFlowEntry* flow_entry) const {
+  const ::p4::config::v1::Table& table_p4_info = *table_plan.table_p4_info;
   flow_entry->mutable_table_info()->set_id(table_id);
   flow_entry->mutable_table_info()->set_name(table_p4_info.preamble().name());
   *flow_entry->mutable_table_info()->mutable_annotations() =
       table_p4_info.preamble().annotations();
 
-  auto desc_iter = global_id_table_map_.find(table_id);
-  if (desc_iter == global_id_table_map_.end()) {
+  if (table_plan.table_descriptor == nullptr) {
     flow_entry->mutable_table_info()->set_type(P4_TABLE_UNKNOWN);
     return MAKE_ERROR(ERR_OPER_NOT_SUPPORTED)
            << "P4 table ID " << table_id << " is missing a table descriptor.";
   }
 
-  const auto& table_descriptor = desc_iter->second->table_descriptor();
+  const auto& table_descriptor = *table_plan.table_descriptor;
   RETURN_IF_ERROR(IsTableUpdateAllowed(table_p4_info, table_descriptor));
   // Information from the table descriptor includes the mapped type, mapped
   // pipeline stage, and any internal match fields.
@@ -682,15 +743,16 @@ std::string P4TableMapper::GetMapperNameKey(
 // produce some output for the field in flow_entry, even if it is just a raw
 // copy of an unknown field.
 ::util::Status P4TableMapper::ProcessMatchField(
-    const ::p4::config::v1::Table& table_p4_info,
-    const ::p4::v1::FieldMatch& match_field,
+    const P4TablePlan& table_plan, const P4MatchFieldRef& match_field_ref,
     CommonFlowEntry* flow_entry) const {
-  // This lookup in field_convert_by_table_ accomplishes two things:
+  const ::p4::config::v1::Table& table_p4_info = *table_plan.table_p4_info;
+  const ::p4::v1::FieldMatch& match_field = *match_field_ref.first;
+
+  // The conversion in the field's slot accomplishes two things:
   //  1) It confirms that the field is allowed in the table.
   //  2) It indicates how to map the field into the flow_entry output.
-  P4FieldConvertKey key = MakeP4FieldConvertKey(table_p4_info, match_field);
-  auto convert_iter = field_convert_by_table_.find(key);
-  if (convert_iter == field_convert_by_table_.end()) {
+  const P4MatchFieldSlot* slot = match_field_ref.second;
+  if (slot == nullptr || slot->convert_value == nullptr) {
     // No way to decode fields that don't go with the table.
     RETURN_ERROR(ERR_OPER_NOT_SUPPORTED)
         << "P4 TableEntry match field ID "
@@ -698,7 +760,7 @@ std::string P4TableMapper::GetMapperNameKey(
         << " is not recognized in table " << table_p4_info.preamble().name();
   }
 
-  const auto& conversion_value = convert_iter->second;
+  const auto& conversion_value = *slot->convert_value;
   const auto& conversion_entry = conversion_value.conversion_entry;
   const auto& conversion_field = conversion_value.mapped_field;
 
@@ -723,9 +785,9 @@ std::string P4TableMapper::GetMapperNameKey(
 }
 
 ::util::Status P4TableMapper::ProcessTableAction(
-    const ::p4::config::v1::Table& table_p4_info,
-    const ::p4::v1::TableAction& table_action,
+    const P4TablePlan& table_plan, const ::p4::v1::TableAction& table_action,
     CommonFlowEntry* flow_entry) const {
+  const ::p4::config::v1::Table& table_p4_info = *table_plan.table_p4_info;
   ::util::Status status = ::util::OkStatus();
 
   // Action profile group and member IDs are easy - the ID just copies
@@ -739,7 +801,7 @@ std::string P4TableMapper::GetMapperNameKey(
     case ::p4::v1::TableAction::kAction:
       APPEND_STATUS_IF_ERROR(
           status, ProcessTableActionFunction(
-                      table_p4_info, table_action.action(), mapped_action));
+                      table_plan, table_action.action(), mapped_action));
       break;
     case ::p4::v1::TableAction::kActionProfileMemberId:
       mapped_action->set_type(P4_ACTION_TYPE_PROFILE_MEMBER_ID);
@@ -769,17 +831,21 @@ std::string P4TableMapper::GetMapperNameKey(
 // Hands off to the common ProcessActionFunction after doing action validation
 // specific to tables.
 ::util::Status P4TableMapper::ProcessTableActionFunction(
-    const ::p4::config::v1::Table& table_p4_info,
-    const ::p4::v1::Action& action, MappedAction* mapped_action) const {
+    const P4TablePlan& table_plan, const ::p4::v1::Action& action,
+    MappedAction* mapped_action) const {
   if (action.action_id() == 0) {
     return MAKE_ERROR(ERR_INVALID_PARAM)
            << "P4 TableEntry action has no action_id.";
   }
 
-  // The next function validates that the P4Info and mapping descriptors
-  // both recognize this action's ID as a valid action for the table.
-  RETURN_IF_ERROR(param_mapper_->IsActionInTableInfo(
-      table_p4_info.preamble().id(), action.action_id()));
+  // The table plan's action IDs are the ones that the P4Info and mapping
+  // descriptors both recognize as valid actions for the table.
+  if (!table_plan.action_ids.contains(action.action_id())) {
+    return MAKE_ERROR(ERR_OPER_NOT_SUPPORTED)
+           << "P4 action ID " << PrintP4ObjectID(action.action_id())
+           << " is not a recognized action for table ID "
+           << PrintP4ObjectID(table_plan.table_p4_info->preamble().id());
+  }
 
   ::util::Status status = ProcessActionFunction(action, mapped_action);
   return status;
@@ -898,6 +964,7 @@ std::string P4TableMapper::GetMapperNameKey(
 
 void P4TableMapper::ClearMaps() {
   global_id_table_map_.clear();
+  table_plans_.clear();
   field_convert_by_table_.clear();
   packetin_metadata_type_to_id_bitwidth_pair_.clear();
   packetin_metadata_id_to_type_bitwidth_pair_.clear();
@@ -15,6 +15,8 @@
 #include <utility>
 
 #include "absl/container/flat_hash_map.h"
+#include "absl/container/flat_hash_set.h"
+#include "absl/container/inlined_vector.h"
 #include "stratum/glue/status/status.h"
 #include "stratum/hal/lib/common/common.pb.h"
 #include "stratum/hal/lib/p4/common_flow_entry.pb.h"
@@ -291,6 +293,44 @@ class P4TableMapper {
     return MakeP4FieldConvertKey(table.preamble().id(), match_field.id());
   }
 
+  // PushForwardingPipelineConfig compiles a P4TablePlan for each table in the
+  // P4Info.  The plan gathers what MapFlowEntry needs to map the table's
+  // entries, so that mapping an entry neither copies the table's P4Info nor
+  // searches the maps above for each match field and action:
+  //  table_p4_info - the table's P4Info, owned by p4_info_manager_.
+  //  table_descriptor - the table's descriptor in p4_pipeline_config_, or
+  //      nullptr if the table has no descriptor.
+  //  match_fields - one slot per match field, in P4Info order.
+  //  action_ids - the IDs of the actions with mapping data for the table.
+  struct P4MatchFieldSlot {
+    P4MatchFieldSlot() : field_id(0), convert_value(nullptr) {}
+
+    uint32 field_id;
+    // Points to the field's entry in field_convert_by_table_, or nullptr if
+    // the field has no known conversion in the table.
+    const P4FieldConvertValue* convert_value;
+    // A FieldMatch with only field_id set, which is mapped in place of the
+    // field when a TableEntry leaves it out as a don't care value.
+    ::p4::v1::FieldMatch dont_care_match;
+  };
+  struct P4TablePlan {
+    P4TablePlan() : table_p4_info(nullptr), table_descriptor(nullptr) {}
+
+    const ::p4::config::v1::Table* table_p4_info;
+    const P4TableDescriptor* table_descriptor;
+    std::vector<P4MatchFieldSlot> match_fields;
+    absl::flat_hash_set<int> action_ids;
+  };
+  typedef absl::flat_hash_map<int, P4TablePlan> P4TablePlanMap;
+
+  // A match field to map for a TableEntry, paired with its slot in the table
+  // plan.  The slot is nullptr when the field is not one of the table's
+  // match fields.  The FieldMatch points either into the TableEntry or to the
+  // slot's dont_care_match.
+  typedef std::pair<const ::p4::v1::FieldMatch*, const P4MatchFieldSlot*>
+      P4MatchFieldRef;
+  typedef absl::InlinedVector<P4MatchFieldRef, 16> P4MatchFieldRefs;
+
   // This private class helps P4TableMapper with the details of action
   // parameter mapping.  A P4ActionParamMapper instance typically lives for
   // the duration of one set of P4Info.  Thus, there is an AddAction method
@@ -358,7 +398,8 @@ class P4TableMapper {
     // is a combination of the action ID and the action parameter ID.  The
     // action ID is globally unique, but the parameter ID is unique only
     // within the scope of its action.
-    typedef std::map<std::pair<int, int>, P4ActionParamEntry> P4ActionParamMap;
+    typedef absl::flat_hash_map<std::pair<int, int>, P4ActionParamEntry>
+        P4ActionParamMap;
 
     // The P4ActionConstantMap supports actions that use constants to assign
     // fields or pass to other actions.  The action ID is the key, and the
@@ -408,7 +449,7 @@ class P4TableMapper {
     // pairs, i.e. the action ID is defined in P4Info as one of the table's
     // possible actions.  The first pair member is the table ID, and the second
     // member is the action ID.
-    std::set<std::pair<int, int>> valid_table_actions_;
+    absl::flat_hash_set<std::pair<int, int>> valid_table_actions_;
   };
 
   // Creates the global_id_table_map_ entry for the object represented by the
@@ -422,47 +463,44 @@ class P4TableMapper {
   std::string GetMapperNameKey(const ::p4::config::v1::Preamble& preamble);
 
   // Validates all of the match fields in the table_entry from a P4Runtime
-  // WriteRequest message.  The input table_p4_info provides information
+  // WriteRequest message.  The input table_plan provides information
   // about the expected match fields for the applicable table.  If the
   // P4Runtime request omits some match fields as "don't care" values,
-  // PrepareMatchFields appends them to the all_match_fields output vector.
+  // PrepareMatchFields appends them to the all_match_fields output.
   // Upon successful return, all_match_fields combines the match fields
   // in the original WriteRequest with any additional don't care fields,
-  // yielding the full set of match fields as specified by table_p4_info.
-  ::util::Status PrepareMatchFields(
-      const ::p4::config::v1::Table& table_p4_info,
-      const ::p4::v1::TableEntry& table_entry,
-      std::vector<::p4::v1::FieldMatch>* all_match_fields) const;
+  // yielding the full set of match fields as specified by the table's P4Info.
+  ::util::Status PrepareMatchFields(const P4TablePlan& table_plan,
+                                    const ::p4::v1::TableEntry& table_entry,
+                                    P4MatchFieldRefs* all_match_fields) const;
 
   // Processes the identified table and updates table-level flow_entry output.
   // Output always includes table_info with id, name, and type.  If the table's
   // P4Info contains annotations, they are also included in the output.  The
   // output may include internal match fields if they have been defined
   // in the P4PipelineConfig table map.
-  ::util::Status ProcessTableID(const ::p4::config::v1::Table& table_p4_info,
-                                int table_id,
+  ::util::Status ProcessTableID(const P4TablePlan& table_plan, int table_id,
                                 CommonFlowEntry* flow_entry) const;
 
   // Processes one match_field from a table entry.  If successful, a new
   // MappedField will be added to flow_entry.
-  ::util::Status ProcessMatchField(const ::p4::config::v1::Table& table_p4_info,
-                                   const ::p4::v1::FieldMatch& match_field,
+  ::util::Status ProcessMatchField(const P4TablePlan& table_plan,
+                                   const P4MatchFieldRef& match_field,
                                    CommonFlowEntry* flow_entry) const;
 
   // Processes the action from a table entry.  If successful, the
   // MappedAction will be populated in flow_entry.
-  ::util::Status ProcessTableAction(
-      const ::p4::config::v1::Table& table_p4_info,
-      const ::p4::v1::TableAction& table_action,
-      CommonFlowEntry* flow_entry) const;
+  ::util::Status ProcessTableAction(const P4TablePlan& table_plan,
+                                    const ::p4::v1::TableAction& table_action,
+                                    CommonFlowEntry* flow_entry) const;
 
   // These methods both handle action function processing.  The first one is
   // for actions in table updates.  The second one is for actions in action
   // profile updates.  Both of them produce mapped_action output when
   // successful.
   ::util::Status ProcessTableActionFunction(
-      const ::p4::config::v1::Table& table_p4_info,
-      const ::p4::v1::Action& action, MappedAction* mapped_action) const;
+      const P4TablePlan& table_plan, const ::p4::v1::Action& action,
+      MappedAction* mapped_action) const;
   ::util::Status ProcessProfileActionFunction(
       const ::p4::config::v1::ActionProfile& profile_p4_info,
       const ::p4::v1::Action& action, MappedAction* mapped_action) const;
@@ -494,6 +532,11 @@ class P4TableMapper {
   // This map facilitates table-dependent match field conversions.
   P4FieldConvertByTable field_convert_by_table_;
 
+  // Provides the mapping plan of each table by P4 table ID.  The plans point
+  // into p4_info_manager_, p4_pipeline_config_, and field_convert_by_table_,
+  // so they are rebuilt whenever those change.
+  P4TablePlanMap table_plans_;
+
   // Map from packet in (out) metadata ID to the corresponding (type, bitwidth)
   // pair used for parsing the packet in (out) metadata. The ID and bitwidth of
   // metadata are available from P4Info and the type (P4FieldType) is found from
@@ -4,6 +4,14 @@
 
 #include "stratum/lib/channel/channel.h"
 
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <limits>
+
 #include "absl/synchronization/mutex.h"
 
 namespace stratum {
@@ -11,6 +19,48 @@ namespace stratum {
 using channel_internal::ChannelBase;
 using channel_internal::SelectData;
 
+namespace channel_internal {
+
+uint32 EventCount::PrepareWait() {
+  waiters_.fetch_add(1, std::memory_order_seq_cst);
+  // Orders the registration before the caller checks its condition again,
+  // pairing with the fence in NotifyAll().
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  return seq_.load(std::memory_order_seq_cst);
+}
+
+void EventCount::CancelWait() {
+  waiters_.fetch_sub(1, std::memory_order_seq_cst);
+}
+
+void EventCount::Wait(uint32 key, absl::Time deadline) {
+  struct timespec timeout;
+  struct timespec* timeout_ptr = nullptr;
+  if (deadline != absl::InfiniteFuture()) {
+    absl::Duration remaining =
+        std::max(deadline - absl::Now(), absl::ZeroDuration());
+    timeout = absl::ToTimespec(remaining);
+    timeout_ptr = &timeout;
+  }
+  // Returns immediately if seq_ no longer holds the key, i.e. if NotifyAll()
+  // was called since PrepareWait().
+  syscall(SYS_futex, reinterpret_cast<uint32*>(&seq_), FUTEX_WAIT_PRIVATE, key,
+          timeout_ptr, nullptr, 0);
+  waiters_.fetch_sub(1, std::memory_order_seq_cst);
+}
+
+void EventCount::NotifyAll() {
+  // Orders the change of the condition before the load of waiters_, pairing
+  // with the fence in PrepareWait().
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (waiters_.load(std::memory_order_relaxed) == 0) return;
+  seq_.fetch_add(1, std::memory_order_seq_cst);
+  syscall(SYS_futex, reinterpret_cast<uint32*>(&seq_), FUTEX_WAKE_PRIVATE,
+          std::numeric_limits<int>::max(), nullptr, nullptr, 0);
+}
+
+}  // namespace channel_internal
+
 ::util::StatusOr<SelectResult> Select(const std::vector<ChannelBase*>& channels,
                                       absl::Duration timeout) {
   // Create output map;
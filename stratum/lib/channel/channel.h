@@ -5,9 +5,11 @@
 #ifndef STRATUM_LIB_CHANNEL_CHANNEL_H_
 #define STRATUM_LIB_CHANNEL_CHANNEL_H_
 
+#include <atomic>
 #include <deque>
 #include <list>
 #include <memory>
+#include <type_traits>
 #include <unordered_map>
 #include <utility>
 #include <vector>
@@ -15,7 +17,9 @@
 #include "absl/base/thread_annotations.h"
 #include "absl/memory/memory.h"
 #include "absl/synchronization/mutex.h"
+#include "absl/time/clock.h"
 #include "absl/time/time.h"
+#include "stratum/glue/integral_types.h"
 #include "stratum/lib/channel/channel_internal.h"
 #include "stratum/lib/macros.h"
 
@@ -42,6 +46,17 @@ namespace stratum {
 //
 //   T: Message type. T must be move-assignable.
 //
+// Channel Implementations:
+//
+//   The implementation of the internal queue is selected when the Channel is
+//   created, see ChannelImpl below. Both implementations provide the same
+//   ChannelReader/ChannelWriter/Select semantics. The default one is a
+//   std::deque guarded by a mutex. ChannelImpl::kLockFreeRing is a bounded
+//   lock-free ring buffer meant for channels with many writers and a single
+//   reader on a hot path (e.g. packet I/O). On this implementation writers
+//   only issue a wakeup system call when a reader is actually sleeping, so a
+//   reader draining the Channel with ReadAll() is not woken up per message.
+//
 // Example Setup and Cleanup:
 //
 //   int max_depth = 128;
@@ -203,6 +218,16 @@ class SelectResult {
     const std::vector<channel_internal::ChannelBase*>& channels,
     absl::Duration timeout);
 
+// Selects the implementation of the internal queue of a Channel.
+enum class ChannelImpl {
+  // std::deque protected by a single mutex, with condition variables for
+  // blocked ChannelReaders and ChannelWriters.
+  kLocked,
+  // Bounded lock-free ring buffer. Blocked ChannelReaders and ChannelWriters
+  // sleep on futexes that are only signaled when somebody is waiting.
+  kLockFreeRing,
+};
+
 // TODO(unknown): add support for optional en/dequeue timestamping.
 template <typename T>
 class Channel : public channel_internal::ChannelBase {
@@ -213,10 +238,10 @@ class Channel : public channel_internal::ChannelBase {
  public:
   ~Channel() override {}
 
-  // Creates shared Channel object with given maximum queue depth.
-  static std::unique_ptr<Channel<T>> Create(size_t max_depth) {
-    return absl::WrapUnique(new Channel<T>(max_depth));
-  }
+  // Creates shared Channel object with given maximum queue depth, using the
+  // given implementation for the internal queue.
+  static std::unique_ptr<Channel<T>> Create(
+      size_t max_depth, ChannelImpl impl = ChannelImpl::kLocked);
 
   // Closes the Channel. Any blocked Read() or Write() operations immediately
   // return ERR_CANCELLED. Returns false if the Channel is already closed.
@@ -244,10 +269,20 @@ class Channel : public channel_internal::ChannelBase {
   virtual ::util::Status Write(T&& t, absl::Duration timeout)
       LOCKS_EXCLUDED(queue_lock_);
 
-  // Returns ERR_NO_RESOURCE immediately if the queue is full.
+  // Returns ERR_NO_RESOURCE immediately, without logging it, if the queue is
+  // full.
   virtual ::util::Status TryWrite(const T& t) LOCKS_EXCLUDED(queue_lock_);
   virtual ::util::Status TryWrite(T&& t) LOCKS_EXCLUDED(queue_lock_);
 
+  // Moves the elements of t_s into the Channel, in order, waking up the
+  // blocked ChannelReaders once per batch rather than once per element. Blocks
+  // while the queue is full, until the timeout. Returns ERR_SUCCESS once all
+  // the elements are enqueued, ERR_NO_RESOURCE on timeout and ERR_CANCELLED if
+  // the Channel is closed. On return, t_s only holds the elements which were
+  // not enqueued.
+  virtual ::util::Status WriteBatch(std::vector<T>* t_s, absl::Duration timeout)
+      LOCKS_EXCLUDED(queue_lock_);
+
   // Reads and pops the first element of the queue into t. Returns ERR_SUCCESS
   // on successful dequeue. Blocks if the queue is empty until the timeout, then
   // returns ERR_ENTRY_NOT_FOUND. Returns ERR_CANCELED if Channel is closed and
@@ -257,7 +292,8 @@ class Channel : public channel_internal::ChannelBase {
   virtual ::util::Status Read(T* t, absl::Duration timeout)
       LOCKS_EXCLUDED(queue_lock_);
 
-  // Returns ERR_ENTRY_NOT_FOUND immediately if the queue is empty.
+  // Returns ERR_ENTRY_NOT_FOUND immediately, without logging it, if the queue
+  // is empty.
   virtual ::util::Status TryRead(T* t) LOCKS_EXCLUDED(queue_lock_);
 
   // Reads all of the elements of the queue into ts. Returns ERR_CANCELED if the
@@ -265,6 +301,11 @@ class Channel : public channel_internal::ChannelBase {
   virtual ::util::Status ReadAll(std::vector<T>* t_s)
       LOCKS_EXCLUDED(queue_lock_);
 
+  // Same as above, but blocks if the queue is empty until the timeout, then
+  // returns ERR_ENTRY_NOT_FOUND.
+  virtual ::util::Status ReadAll(std::vector<T>* t_s, absl::Duration timeout)
+      LOCKS_EXCLUDED(queue_lock_);
+
   // Checks whether there are any elements enqueued in the Channel. If true,
   // sets both done and ready to true and returns ERR_SUCCESS. If the Channel
   // is closed, returns ERR_CANCELLED.
@@ -288,6 +329,12 @@ class Channel : public channel_internal::ChannelBase {
   // above.
   ::util::Status CheckWriteState() EXCLUSIVE_LOCKS_REQUIRED(queue_lock_);
 
+  // Helper function used by Read() and the blocking ReadAll(). Checks if
+  // Channel state is closed and blocks if the internal queue is empty. Returns
+  // OK or the error statuses described above.
+  ::util::Status CheckReadStateAndBlock(absl::Duration timeout)
+      EXCLUSIVE_LOCKS_REQUIRED(queue_lock_);
+
   // Helper function used by the Write()s and Close() on successful operation.
   // Pops each element on the select list, setting the corresponding done and
   // ready flags to the given value and signaling their condition variables.
@@ -335,6 +382,9 @@ class ChannelReader {
   virtual ::util::Status ReadAll(std::vector<T>* t_s) {
     return channel_->ReadAll(t_s);
   }
+  virtual ::util::Status ReadAll(std::vector<T>* t_s, absl::Duration timeout) {
+    return channel_->ReadAll(t_s, timeout);
+  }
   virtual bool IsClosed() { return channel_->IsClosed(); }
 
   // Disallow copy and assign.
@@ -379,6 +429,10 @@ class ChannelWriter {
   virtual ::util::Status TryWrite(T&& t) {
     return channel_->TryWrite(std::move(t));
   }
+  virtual ::util::Status WriteBatch(std::vector<T>* t_s,
+                                    absl::Duration timeout) {
+    return channel_->WriteBatch(t_s, timeout);
+  }
   virtual bool IsClosed() { return channel_->IsClosed(); }
 
   // Disallow copy and assign.
@@ -501,13 +555,38 @@ template <typename T>
   return ::util::OkStatus();
 }
 
+template <typename T>
+::util::Status Channel<T>::WriteBatch(std::vector<T>* t_s,
+                                      absl::Duration timeout) {
+  absl::MutexLock l(&queue_lock_);
+  absl::Time deadline = absl::Now() + timeout;
+  size_t written = 0;
+  ::util::Status status = ::util::OkStatus();
+  while (written < t_s->size()) {
+    // Check internal state, blocking with timeout if queue is full.
+    status = CheckWriteStateAndBlock(deadline - absl::Now());
+    if (!status.ok()) break;
+    // Enqueue as many messages as fit.
+    do {
+      queue_.push_back(std::move((*t_s)[written++]));
+    } while (written < t_s->size() && queue_.size() < max_depth_);
+    // Signal all blocked ChannelReaders.
+    cond_not_empty_.SignalAll();
+    // Signal any Select()-ing threads.
+    ClearSelectList(true);
+  }
+  t_s->erase(t_s->begin(), t_s->begin() + written);
+  return status;
+}
+
 template <typename T>
 ::util::Status Channel<T>::CheckWriteState() {
   // Check for Channel closure.
   if (closed_) return MAKE_ERROR(ERR_CANCELLED) << "Channel is closed.";
   // Check for full internal buffer.
   if (queue_.size() == max_depth_) {
-    return MAKE_ERROR(ERR_NO_RESOURCE) << "Channel is full.";
+    return MAKE_ERROR(ERR_NO_RESOURCE).without_logging()
+           << "Channel is full.";
   }
   // Queue size should never exceed maximum queue depth.
   if (queue_.size() > max_depth_) {
@@ -536,8 +615,7 @@ void Channel<T>::ClearSelectList(bool ready) {
 }
 
 template <typename T>
-::util::Status Channel<T>::Read(T* t, absl::Duration timeout) {
-  absl::MutexLock l(&queue_lock_);
+::util::Status Channel<T>::CheckReadStateAndBlock(absl::Duration timeout) {
   // Check Channel closure. If closed, will not be signaled during wait.
   if (closed_)
     return MAKE_ERROR(ERR_CANCELLED).without_logging() << "Channel is closed.";
@@ -555,6 +633,14 @@ template <typename T>
              << "Read did not succeed within timeout due to empty Channel.";
     }
   }
+  return ::util::OkStatus();
+}
+
+template <typename T>
+::util::Status Channel<T>::Read(T* t, absl::Duration timeout) {
+  absl::MutexLock l(&queue_lock_);
+  // Check internal state, blocking with timeout if queue is empty.
+  RETURN_IF_ERROR(CheckReadStateAndBlock(timeout));
   // Dequeue message.
   *t = std::move(queue_.front());
   queue_.pop_front();
@@ -570,7 +656,8 @@ template <typename T>
   if (closed_) return MAKE_ERROR(ERR_CANCELLED) << "Channel is closed.";
   // Check for empty internal buffer.
   if (queue_.empty()) {
-    return MAKE_ERROR(ERR_ENTRY_NOT_FOUND) << "Channel is empty.";
+    return MAKE_ERROR(ERR_ENTRY_NOT_FOUND).without_logging()
+           << "Channel is empty.";
   }
   // Dequeue message.
   *t = std::move(queue_.front());
@@ -595,6 +682,22 @@ template <typename T>
   return ::util::OkStatus();
 }
 
+template <typename T>
+::util::Status Channel<T>::ReadAll(std::vector<T>* t_s,
+                                   absl::Duration timeout) {
+  absl::MutexLock l(&queue_lock_);
+  // Check internal state, blocking with timeout if queue is empty.
+  RETURN_IF_ERROR(CheckReadStateAndBlock(timeout));
+  // Resize vector for element_s to be moved.
+  t_s->resize(queue_.size());
+  std::move(queue_.begin(), queue_.end(), t_s->begin());
+  // Clear internal buffer.
+  queue_.erase(queue_.begin(), queue_.end());
+  // Signal all blocked ChannelWriters.
+  cond_not_full_.SignalAll();
+  return ::util::OkStatus();
+}
+
 template <typename T>
 void Channel<T>::SelectRegister(
     const std::shared_ptr<channel_internal::SelectData>& select_data,
@@ -615,6 +718,422 @@ void Channel<T>::SelectRegister(
   }
 }
 
+namespace channel_internal {
+
+// Lock-free implementation of Channel<T>, selected with
+// ChannelImpl::kLockFreeRing. The queue is a bounded ring of max_depth cells,
+// each tagged with a sequence number telling whether it is free for the
+// writer at a given position (2 * pos) or holds a message for the reader at a
+// given position (2 * pos + 1), after D. Vyukov's bounded MPMC queue. The
+// doubled tags keep the two states apart even for a single cell ring. Writers
+// and readers claim positions with a CAS, so any number of ChannelWriters and
+// ChannelReaders is supported, but the ring is tuned for many writers and a
+// single reader.
+//
+// Blocked ChannelReaders and ChannelWriters sleep on EventCounts, which
+// writers and readers only signal (with a futex system call) when somebody is
+// sleeping. Select() registrations are kept in a mutex-protected list, which
+// writers only lock when it is not empty.
+template <typename T>
+class RingChannel : public Channel<T> {
+ public:
+  explicit RingChannel(size_t max_depth)
+      : Channel<T>(max_depth),
+        capacity_(max_depth),
+        cells_(new Cell[max_depth]),
+        enqueue_pos_(0),
+        dequeue_pos_(0),
+        closed_(false),
+        num_selects_(0) {
+    for (size_t i = 0; i < capacity_; ++i) {
+      cells_[i].seq.store(2 * i, std::memory_order_relaxed);
+    }
+  }
+
+  ~RingChannel() override {
+    // Destroy the messages which were never read.
+    while (TryDequeue([](T&& t) {})) {
+    }
+  }
+
+  bool Close() override LOCKS_EXCLUDED(select_lock_);
+  bool IsClosed() override { return closed_.load(); }
+
+ protected:
+  ::util::Status Write(const T& t, absl::Duration timeout) override {
+    return DoWrite(t, timeout);
+  }
+  ::util::Status Write(T&& t, absl::Duration timeout) override {
+    return DoWrite(std::move(t), timeout);
+  }
+  ::util::Status TryWrite(const T& t) override { return DoTryWrite(t); }
+  ::util::Status TryWrite(T&& t) override { return DoTryWrite(std::move(t)); }
+  ::util::Status WriteBatch(std::vector<T>* t_s,
+                            absl::Duration timeout) override;
+  ::util::Status Read(T* t, absl::Duration timeout) override;
+  ::util::Status TryRead(T* t) override;
+  ::util::Status ReadAll(std::vector<T>* t_s) override;
+  ::util::Status ReadAll(std::vector<T>* t_s, absl::Duration timeout) override;
+  void SelectRegister(const std::shared_ptr<SelectData>& select_data,
+                      bool* ready) override LOCKS_EXCLUDED(select_lock_);
+
+ private:
+  struct Cell {
+    std::atomic<size_t> seq;
+    typename std::aligned_storage<sizeof(T), alignof(T)>::type storage;
+  };
+
+  // Enqueues t if the ring is not full. t is only moved from on success.
+  template <typename U>
+  bool TryEnqueue(U&& t);
+
+  // Dequeues the oldest message and passes it to consume(T&&) if the ring is
+  // not empty.
+  template <typename F>
+  bool TryDequeue(F&& consume);
+
+  // Returns true if the next cell to read holds a message.
+  bool HasData() const;
+
+  // Returns true if the next cell to write is free.
+  bool HasRoom() const;
+
+  // Waits until HasData() or HasRoom() (as given by 'ready') is true, the
+  // Channel is closed or the deadline expires. Returns true in the first case.
+  template <typename Predicate>
+  bool WaitFor(EventCount* event_count, Predicate ready, absl::Time deadline);
+
+  template <typename U>
+  ::util::Status DoWrite(U&& t, absl::Duration timeout);
+
+  template <typename U>
+  ::util::Status DoTryWrite(U&& t);
+
+  // Wakes up the blocked ChannelReaders and Select()-ing threads, if any.
+  // Called after enqueuing one or more messages.
+  void NotifyReaders() LOCKS_EXCLUDED(select_lock_);
+
+  // Same as Channel<T>::ClearSelectList().
+  void ClearSelectList(bool ready) EXCLUSIVE_LOCKS_REQUIRED(select_lock_);
+
+  const size_t capacity_;
+  std::unique_ptr<Cell[]> cells_;
+  // Next positions to write and read. Kept in separate cache lines, as they
+  // are updated by different threads.
+  alignas(64) std::atomic<size_t> enqueue_pos_;
+  alignas(64) std::atomic<size_t> dequeue_pos_;
+  alignas(64) std::atomic<bool> closed_;
+  // Blocked ChannelReaders wait on not_empty_, blocked ChannelWriters on
+  // not_full_.
+  EventCount not_empty_;
+  EventCount not_full_;
+  // Number of entries in select_list_, readable without select_lock_.
+  std::atomic<int> num_selects_;
+  absl::Mutex select_lock_;
+  std::list<std::pair<std::shared_ptr<SelectData>, bool>> select_list_
+      GUARDED_BY(select_lock_);
+};
+
+template <typename T>
+template <typename U>
+bool RingChannel<T>::TryEnqueue(U&& t) {
+  if (capacity_ == 0) return false;
+  Cell* cell;
+  size_t pos = enqueue_pos_.load(std::memory_order_relaxed);
+  while (true) {
+    cell = &cells_[pos % capacity_];
+    size_t seq = cell->seq.load(std::memory_order_acquire);
+    int64 diff = static_cast<int64>(seq) - static_cast<int64>(2 * pos);
+    if (diff == 0) {
+      // The cell is free for this position; try to claim it.
+      if (enqueue_pos_.compare_exchange_weak(pos, pos + 1,
+                                             std::memory_order_relaxed)) {
+        break;
+      }
+    } else if (diff < 0) {
+      // The cell still holds the message written one lap ago: full.
+      return false;
+    } else {
+      // Another writer claimed this position.
+      pos = enqueue_pos_.load(std::memory_order_relaxed);
+    }
+  }
+  new (&cell->storage) T(std::forward<U>(t));
+  cell->seq.store(2 * pos + 1, std::memory_order_release);
+  return true;
+}
+
+template <typename T>
+template <typename F>
+bool RingChannel<T>::TryDequeue(F&& consume) {
+  if (capacity_ == 0) return false;
+  Cell* cell;
+  size_t pos = dequeue_pos_.load(std::memory_order_relaxed);
+  while (true) {
+    cell = &cells_[pos % capacity_];
+    size_t seq = cell->seq.load(std::memory_order_acquire);
+    int64 diff = static_cast<int64>(seq) - static_cast<int64>(2 * pos + 1);
+    if (diff == 0) {
+      // The cell holds the message for this position; try to claim it.
+      if (dequeue_pos_.compare_exchange_weak(pos, pos + 1,
+                                             std::memory_order_relaxed)) {
+        break;
+      }
+    } else if (diff < 0) {
+      // The message for this position has not been written yet: empty.
+      return false;
+    } else {
+      // Another reader claimed this position.
+      pos = dequeue_pos_.load(std::memory_order_relaxed);
+    }
+  }
+  T* t = reinterpret_cast<T*>(&cell->storage);
+  consume(std::move(*t));
+  t->~T();
+  // Free the cell for the writer one lap ahead.
+  cell->seq.store(2 * (pos + capacity_), std::memory_order_release);
+  return true;
+}
+
+template <typename T>
+bool RingChannel<T>::HasData() const {
+  if (capacity_ == 0) return false;
+  size_t pos = dequeue_pos_.load(std::memory_order_seq_cst);
+  return cells_[pos % capacity_].seq.load(std::memory_order_seq_cst) ==
+         2 * pos + 1;
+}
+
+template <typename T>
+bool RingChannel<T>::HasRoom() const {
+  if (capacity_ == 0) return false;
+  size_t pos = enqueue_pos_.load(std::memory_order_seq_cst);
+  return cells_[pos % capacity_].seq.load(std::memory_order_seq_cst) ==
+         2 * pos;
+}
+
+template <typename T>
+template <typename Predicate>
+bool RingChannel<T>::WaitFor(EventCount* event_count, Predicate ready,
+                             absl::Time deadline) {
+  while (!closed_.load() && !ready()) {
+    uint32 key = event_count->PrepareWait();
+    if (closed_.load() || ready() || absl::Now() >= deadline) {
+      event_count->CancelWait();
+      break;
+    }
+    event_count->Wait(key, deadline);
+  }
+  return !closed_.load() && ready();
+}
+
+template <typename T>
+void RingChannel<T>::NotifyReaders() {
+  not_empty_.NotifyAll();
+  // The fence in NotifyAll() also orders the enqueue before the load of
+  // num_selects_, pairing with the fence in SelectRegister().
+  if (num_selects_.load(std::memory_order_relaxed) > 0) {
+    absl::MutexLock l(&select_lock_);
+    ClearSelectList(true);
+  }
+}
+
+template <typename T>
+bool RingChannel<T>::Close() {
+  if (closed_.exchange(true)) return false;
+  // Signal all blocked ChannelWriters and ChannelReaders.
+  not_full_.NotifyAll();
+  not_empty_.NotifyAll();
+  // Signal any Select()-ing threads.
+  absl::MutexLock l(&select_lock_);
+  ClearSelectList(false);
+  return true;
+}
+
+template <typename T>
+template <typename U>
+::util::Status RingChannel<T>::DoWrite(U&& t, absl::Duration timeout) {
+  absl::Time deadline = absl::Now() + timeout;
+  while (true) {
+    if (closed_.load()) {
+      return MAKE_ERROR(ERR_CANCELLED) << "Channel is closed.";
+    }
+    if (TryEnqueue(std::forward<U>(t))) break;
+    if (!WaitFor(&not_full_, [this]() { return HasRoom(); }, deadline)) {
+      if (closed_.load()) {
+        return MAKE_ERROR(ERR_CANCELLED) << "Channel is closed.";
+      }
+      return MAKE_ERROR(ERR_NO_RESOURCE)
+             << "Write did not succeed within timeout due to full Channel.";
+    }
+  }
+  NotifyReaders();
+  return ::util::OkStatus();
+}
+
+template <typename T>
+template <typename U>
+::util::Status RingChannel<T>::DoTryWrite(U&& t) {
+  if (closed_.load()) return MAKE_ERROR(ERR_CANCELLED) << "Channel is closed.";
+  if (!TryEnqueue(std::forward<U>(t))) {
+    return MAKE_ERROR(ERR_NO_RESOURCE).without_logging()
+           << "Channel is full.";
+  }
+  NotifyReaders();
+  return ::util::OkStatus();
+}
+
+template <typename T>
+::util::Status RingChannel<T>::WriteBatch(std::vector<T>* t_s,
+                                          absl::Duration timeout) {
+  absl::Time deadline = absl::Now() + timeout;
+  size_t written = 0;
+  ::util::Status status = ::util::OkStatus();
+  while (written < t_s->size()) {
+    if (closed_.load()) {
+      status = MAKE_ERROR(ERR_CANCELLED) << "Channel is closed.";
+      break;
+    }
+    if (TryEnqueue(std::move((*t_s)[written]))) {
+      ++written;
+      continue;
+    }
+    // The ring is full. Let the readers drain what was written so far before
+    // waiting for room.
+    if (written > 0) NotifyReaders();
+    if (!WaitFor(&not_full_, [this]() { return HasRoom(); }, deadline)) {
+      if (closed_.load()) {
+        status = MAKE_ERROR(ERR_CANCELLED) << "Channel is closed.";
+      } else {
+        status = MAKE_ERROR(ERR_NO_RESOURCE)
+                 << "WriteBatch did not succeed within timeout due to full "
+                 << "Channel.";
+      }
+      break;
+    }
+  }
+  if (written > 0) NotifyReaders();
+  t_s->erase(t_s->begin(), t_s->begin() + written);
+  return status;
+}
+
+template <typename T>
+::util::Status RingChannel<T>::Read(T* t, absl::Duration timeout) {
+  absl::Time deadline = absl::Now() + timeout;
+  while (true) {
+    if (closed_.load()) {
+      return MAKE_ERROR(ERR_CANCELLED).without_logging()
+             << "Channel is closed.";
+    }
+    if (TryDequeue([t](T&& msg) { *t = std::move(msg); })) break;
+    if (!WaitFor(&not_empty_, [this]() { return HasData(); }, deadline)) {
+      if (closed_.load()) {
+        return MAKE_ERROR(ERR_CANCELLED).without_logging()
+               << "Channel is closed.";
+      }
+      return MAKE_ERROR(ERR_ENTRY_NOT_FOUND)
+             << "Read did not succeed within timeout due to empty Channel.";
+    }
+  }
+  not_full_.NotifyAll();
+  return ::util::OkStatus();
+}
+
+template <typename T>
+::util::Status RingChannel<T>::TryRead(T* t) {
+  if (closed_.load()) return MAKE_ERROR(ERR_CANCELLED) << "Channel is closed.";
+  if (!TryDequeue([t](T&& msg) { *t = std::move(msg); })) {
+    return MAKE_ERROR(ERR_ENTRY_NOT_FOUND).without_logging()
+           << "Channel is empty.";
+  }
+  not_full_.NotifyAll();
+  return ::util::OkStatus();
+}
+
+template <typename T>
+::util::Status RingChannel<T>::ReadAll(std::vector<T>* t_s) {
+  if (closed_.load()) return MAKE_ERROR(ERR_CANCELLED) << "Channel is closed.";
+  t_s->clear();
+  // Read at most one lap, so that fast writers cannot keep the reader here.
+  while (t_s->size() < capacity_ &&
+         TryDequeue([t_s](T&& msg) { t_s->push_back(std::move(msg)); })) {
+  }
+  if (!t_s->empty()) not_full_.NotifyAll();
+  return ::util::OkStatus();
+}
+
+template <typename T>
+::util::Status RingChannel<T>::ReadAll(std::vector<T>* t_s,
+                                       absl::Duration timeout) {
+  absl::Time deadline = absl::Now() + timeout;
+  while (true) {
+    RETURN_IF_ERROR(ReadAll(t_s));
+    if (!t_s->empty()) return ::util::OkStatus();
+    if (!WaitFor(&not_empty_, [this]() { return HasData(); }, deadline)) {
+      if (closed_.load()) {
+        return MAKE_ERROR(ERR_CANCELLED).without_logging()
+               << "Channel is closed.";
+      }
+      return MAKE_ERROR(ERR_ENTRY_NOT_FOUND)
+             << "Read did not succeed within timeout due to empty Channel.";
+    }
+  }
+}
+
+template <typename T>
+void RingChannel<T>::SelectRegister(
+    const std::shared_ptr<SelectData>& select_data, bool* ready) {
+  absl::MutexLock l(&select_lock_);
+  // Check for Channel closure.
+  if (closed_.load()) return;
+  absl::MutexLock sel_lock(&select_data->lock);
+  if (!HasData()) {
+    // Only enqueue a copy of select_data if the operation is not done.
+    if (select_data->done) return;
+    select_list_.push_back(std::make_pair(select_data, false));
+    num_selects_.store(select_list_.size(), std::memory_order_seq_cst);
+    // Orders the registration before checking the ring again, pairing with
+    // the fence in NotifyReaders(). A writer which enqueued before that either
+    // sees the registration or its message is seen here.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (!HasData()) return;
+    select_list_.pop_back();
+    num_selects_.store(select_list_.size(), std::memory_order_seq_cst);
+  }
+  *ready = true;
+  select_data->done = true;
+}
+
+template <typename T>
+void RingChannel<T>::ClearSelectList(bool ready) {
+  while (!select_list_.empty()) {
+    auto& pair = select_list_.front();
+    {
+      // Set select done flag and Channel ready flag and signal Select()-ing
+      // thread.
+      pair.second = ready;
+      absl::MutexLock sel_lock(&pair.first->lock);
+      pair.first->done = ready;
+      pair.first->cond.Signal();
+    }
+    select_list_.pop_front();
+  }
+  num_selects_.store(0, std::memory_order_seq_cst);
+}
+
+}  // namespace channel_internal
+
+template <typename T>
+std::unique_ptr<Channel<T>> Channel<T>::Create(size_t max_depth,
+                                               ChannelImpl impl) {
+  switch (impl) {
+    case ChannelImpl::kLockFreeRing:
+      return absl::WrapUnique(new channel_internal::RingChannel<T>(max_depth));
+    case ChannelImpl::kLocked:
+    default:
+      return absl::WrapUnique(new Channel<T>(max_depth));
+  }
+}
+
 }  // namespace stratum
 
 #endif  // STRATUM_LIB_CHANNEL_CHANNEL_H_
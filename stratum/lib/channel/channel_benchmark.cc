@@ -0,0 +1,63 @@
+// Copyright 2018-present Open Networking Foundation
+// SPDX-License-Identifier: Apache-2.0
+
+// Benchmarks the message throughput of the Channel implementations with 1, 4
+// and 16 ChannelWriter threads feeding a single ChannelReader, which drains the
+// Channel with the blocking ReadAll() like the packet and event reader threads
+// do.
+
+#include <memory>
+#include <thread>  // NOLINT
+#include <vector>
+
+#include "absl/time/time.h"
+#include "benchmark/benchmark.h"
+#include "stratum/glue/logging.h"
+#include "stratum/lib/channel/channel.h"
+
+namespace stratum {
+namespace {
+
+constexpr size_t kMaxDepth = 1024;
+constexpr int kMessagesPerIteration = 1 << 16;
+
+void BM_ChannelThroughput(benchmark::State& state) {
+  const ChannelImpl impl = static_cast<ChannelImpl>(state.range(0));
+  const int num_writers = state.range(1);
+  const int messages_per_writer = kMessagesPerIteration / num_writers;
+  for (auto _ : state) {
+    std::shared_ptr<Channel<int64>> channel =
+        Channel<int64>::Create(kMaxDepth, impl);
+    auto reader = ChannelReader<int64>::Create(channel);
+    std::vector<std::thread> writers;
+    for (int i = 0; i < num_writers; ++i) {
+      writers.emplace_back([&channel, messages_per_writer]() {
+        auto writer = ChannelWriter<int64>::Create(channel);
+        for (int j = 0; j < messages_per_writer; ++j) {
+          CHECK(writer->Write(j, absl::InfiniteDuration()).ok());
+        }
+      });
+    }
+    std::vector<int64> msgs;
+    int received = 0;
+    while (received < messages_per_writer * num_writers) {
+      CHECK(reader->ReadAll(&msgs, absl::InfiniteDuration()).ok());
+      received += msgs.size();
+    }
+    for (auto& writer : writers) writer.join();
+  }
+  state.SetItemsProcessed(state.iterations() * kMessagesPerIteration);
+}
+BENCHMARK(BM_ChannelThroughput)
+    ->Apply([](benchmark::internal::Benchmark* b) {
+      for (auto impl : {ChannelImpl::kLocked, ChannelImpl::kLockFreeRing}) {
+        for (int num_writers : {1, 4, 16}) {
+          b->Args({static_cast<int>(impl), num_writers});
+        }
+      }
+    })
+    ->ArgNames({"impl", "writers"})
+    ->UseRealTime();
+
+}  // namespace
+}  // namespace stratum
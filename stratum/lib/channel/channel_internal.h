@@ -5,10 +5,13 @@
 #ifndef STRATUM_LIB_CHANNEL_CHANNEL_INTERNAL_H_
 #define STRATUM_LIB_CHANNEL_CHANNEL_INTERNAL_H_
 
+#include <atomic>
 #include <memory>
 
+#include "stratum/glue/integral_types.h"
 #include "stratum/lib/macros.h"
 #include "absl/synchronization/mutex.h"
+#include "absl/time/time.h"
 
 namespace stratum {
 namespace channel_internal {
@@ -40,6 +43,53 @@ class ChannelBase {
   ChannelBase() {}
 };
 
+// EventCount lets threads sleep until a condition they poll for becomes true,
+// e.g. a lock-free queue becoming non-empty, without taking a lock on the fast
+// path. A waiter does:
+//
+//   while (!condition()) {
+//     uint32 key = event_count.PrepareWait();
+//     if (condition()) {
+//       event_count.CancelWait();
+//       break;
+//     }
+//     event_count.Wait(key, deadline);
+//   }
+//
+// and a thread that makes the condition true calls NotifyAll() afterwards.
+// NotifyAll() costs a fence and an atomic load when there are no waiters; the
+// futex system call is only made if at least one thread is waiting.
+class EventCount {
+ public:
+  EventCount() : seq_(0), waiters_(0) {}
+
+  // Registers the caller as a waiter and returns the key to pass to Wait().
+  // The caller must check its condition again after this call and then call
+  // either Wait() or CancelWait().
+  uint32 PrepareWait();
+
+  // Unregisters the caller without waiting.
+  void CancelWait();
+
+  // Blocks until NotifyAll() is called after the PrepareWait() call which
+  // returned the key, or until the deadline. May return spuriously.
+  // Unregisters the caller.
+  void Wait(uint32 key, absl::Time deadline);
+
+  // Wakes up all the threads blocked in Wait().
+  void NotifyAll();
+
+  // Disallow copy and assign.
+  EventCount(const EventCount&) = delete;
+  EventCount& operator=(const EventCount&) = delete;
+
+ private:
+  // Futex word, bumped by every NotifyAll() which finds waiters.
+  std::atomic<uint32> seq_;
+  // Number of threads between PrepareWait() and Wait()/CancelWait().
+  std::atomic<int> waiters_;
+};
+
 }  // namespace channel_internal
 }  // namespace stratum
 
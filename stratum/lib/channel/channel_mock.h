@@ -23,10 +23,14 @@ class ChannelMock : public Channel<T> {
   MOCK_METHOD2_T(Read, ::util::Status(T* t, absl::Duration timeout));
   MOCK_METHOD1_T(TryRead, ::util::Status(T* t));
   MOCK_METHOD1_T(ReadAll, ::util::Status(std::vector<T>* t_s));
+  MOCK_METHOD2_T(ReadAll,
+                 ::util::Status(std::vector<T>* t_s, absl::Duration timeout));
   MOCK_METHOD2_T(Write, ::util::Status(const T& t, absl::Duration timeout));
   MOCK_METHOD2_T(Write, ::util::Status(T&& t, absl::Duration timeout));
   MOCK_METHOD1_T(TryWrite, ::util::Status(const T& t));
   MOCK_METHOD1_T(TryWrite, ::util::Status(T&& t));
+  MOCK_METHOD2_T(WriteBatch,
+                 ::util::Status(std::vector<T>* t_s, absl::Duration timeout));
   MOCK_METHOD2_T(
       SelectRegister,
       void(const std::shared_ptr<channel_internal::SelectData>& select_data,
@@ -39,6 +43,8 @@ class ChannelReaderMock : public ChannelReader<T> {
   MOCK_METHOD2_T(Read, ::util::Status(T* t, absl::Duration timeout));
   MOCK_METHOD1_T(TryRead, ::util::Status(T* t));
   MOCK_METHOD1_T(ReadAll, ::util::Status(std::vector<T>* t_s));
+  MOCK_METHOD2_T(ReadAll,
+                 ::util::Status(std::vector<T>* t_s, absl::Duration timeout));
   MOCK_METHOD0_T(IsClosed, bool());
 };
 
@@ -49,6 +55,8 @@ class ChannelWriterMock : public ChannelWriter<T> {
   MOCK_METHOD2_T(Write, ::util::Status(T&& t, absl::Duration timeout));
   MOCK_METHOD1_T(TryWrite, ::util::Status(const T& t));
   MOCK_METHOD1_T(TryWrite, ::util::Status(T&& t));
+  MOCK_METHOD2_T(WriteBatch,
+                 ::util::Status(std::vector<T>* t_s, absl::Duration timeout));
   MOCK_METHOD0_T(IsClosed, bool());
 };
 
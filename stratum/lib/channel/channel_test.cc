@@ -22,9 +22,12 @@ namespace stratum {
 
 using channel_internal::ChannelBase;
 
+// All the tests are run against every Channel implementation.
+class ChannelTest : public ::testing::TestWithParam<ChannelImpl> {};
+
 // Test Channel creation, IsOpen() check, Close(), and destruction.
-TEST(ChannelTest, TestCreateChannelClose) {
-  auto channel = Channel<int>::Create(0);
+TEST_P(ChannelTest, TestCreateChannelClose) {
+  auto channel = Channel<int>::Create(0, GetParam());
   EXPECT_FALSE(channel->IsClosed());
   EXPECT_TRUE(channel->Close());
   EXPECT_TRUE(channel->IsClosed());
@@ -33,8 +36,8 @@ TEST(ChannelTest, TestCreateChannelClose) {
 }
 
 // Test ChannelReader and ChannelWriter creation and Channel reference count.
-TEST(ChannelTest, TestCreateChannelReaderChannelWriter) {
-  std::shared_ptr<Channel<int>> channel = Channel<int>::Create(1);
+TEST_P(ChannelTest, TestCreateChannelReaderChannelWriter) {
+  std::shared_ptr<Channel<int>> channel = Channel<int>::Create(1, GetParam());
   EXPECT_EQ(1, channel.use_count());
   auto reader = ChannelReader<int>::Create(channel);
   EXPECT_EQ(2, channel.use_count());
@@ -47,8 +50,8 @@ TEST(ChannelTest, TestCreateChannelReaderChannelWriter) {
 }
 
 // Test basic ChannelReader/ChannelWriter interaction with Channel.
-TEST(ChannelTest, TestReadWriteClose) {
-  std::shared_ptr<Channel<int>> channel = Channel<int>::Create(2);
+TEST_P(ChannelTest, TestReadWriteClose) {
+  std::shared_ptr<Channel<int>> channel = Channel<int>::Create(2, GetParam());
   auto reader = ChannelReader<int>::Create(channel);
   auto writer = ChannelWriter<int>::Create(channel);
   absl::Duration timeout = absl::InfiniteDuration();
@@ -99,6 +102,72 @@ TEST(ChannelTest, TestReadWriteClose) {
   EXPECT_EQ(ERR_CANCELLED, reader->Read(&msg, timeout).error_code());
 }
 
+// Test WriteBatch() writes as many elements as fit and leaves the rest.
+TEST_P(ChannelTest, TestWriteBatch) {
+  std::shared_ptr<Channel<int>> channel = Channel<int>::Create(3, GetParam());
+  auto reader = ChannelReader<int>::Create(channel);
+  auto writer = ChannelWriter<int>::Create(channel);
+
+  std::vector<int> msgs = {1, 2};
+  EXPECT_OK(writer->WriteBatch(&msgs, absl::ZeroDuration()));
+  EXPECT_TRUE(msgs.empty());
+  // Only one element fits, the others are left in the batch.
+  msgs = {3, 4, 5};
+  EXPECT_EQ(ERR_NO_RESOURCE,
+            writer->WriteBatch(&msgs, absl::Milliseconds(10)).error_code());
+  EXPECT_EQ(std::vector<int>({4, 5}), msgs);
+
+  std::vector<int> read_msgs;
+  EXPECT_OK(reader->ReadAll(&read_msgs));
+  EXPECT_EQ(std::vector<int>({1, 2, 3}), read_msgs);
+  EXPECT_OK(writer->WriteBatch(&msgs, absl::ZeroDuration()));
+  EXPECT_TRUE(msgs.empty());
+  EXPECT_OK(reader->ReadAll(&read_msgs));
+  EXPECT_EQ(std::vector<int>({4, 5}), read_msgs);
+
+  EXPECT_TRUE(channel->Close());
+  msgs = {6};
+  EXPECT_EQ(ERR_CANCELLED,
+            writer->WriteBatch(&msgs, absl::InfiniteDuration()).error_code());
+  EXPECT_EQ(std::vector<int>({6}), msgs);
+}
+
+// Test the blocking ReadAll() waits for at least one element.
+TEST_P(ChannelTest, TestBlockingReadAll) {
+  std::shared_ptr<Channel<int>> channel = Channel<int>::Create(4, GetParam());
+  auto reader = ChannelReader<int>::Create(channel);
+  auto writer = ChannelWriter<int>::Create(channel);
+
+  std::vector<int> msgs;
+  EXPECT_EQ(ERR_ENTRY_NOT_FOUND,
+            reader->ReadAll(&msgs, absl::Milliseconds(10)).error_code());
+  EXPECT_TRUE(msgs.empty());
+
+  std::thread writer_thread([&writer]() {
+    absl::SleepFor(absl::Milliseconds(50));
+    std::vector<int> batch = {1, 2, 3};
+    EXPECT_OK(writer->WriteBatch(&batch, absl::InfiniteDuration()));
+  });
+  // Depending on the timing, the first call may only see part of the batch.
+  std::vector<int> all_msgs;
+  while (all_msgs.size() < 3) {
+    ASSERT_OK(reader->ReadAll(&msgs, absl::InfiniteDuration()));
+    EXPECT_FALSE(msgs.empty());
+    all_msgs.insert(all_msgs.end(), msgs.begin(), msgs.end());
+  }
+  writer_thread.join();
+  EXPECT_EQ(std::vector<int>({1, 2, 3}), all_msgs);
+
+  // Close() should wake up a blocked ReadAll().
+  std::thread close_thread([&channel]() {
+    absl::SleepFor(absl::Milliseconds(50));
+    EXPECT_TRUE(channel->Close());
+  });
+  EXPECT_EQ(ERR_CANCELLED,
+            reader->ReadAll(&msgs, absl::InfiniteDuration()).error_code());
+  close_thread.join();
+}
+
 namespace {
 
 void* TestCloseReadFunc(void* arg) {
@@ -122,9 +191,9 @@ void* TestCloseWriteFunc(void* arg) {
 
 // Test Close() broadcast to blocked ChannelReaders or ChannelWriters on
 // separate threads.
-TEST(ChannelTest, TestCloseBroadcast) {
+TEST_P(ChannelTest, TestCloseBroadcast) {
   // Channel size 0 will cause both readers and writers to block.
-  std::shared_ptr<Channel<int>> channel = Channel<int>::Create(0);
+  std::shared_ptr<Channel<int>> channel = Channel<int>::Create(0, GetParam());
   auto reader = ChannelReader<int>::Create(channel);
   auto writer = ChannelWriter<int>::Create(channel);
 
@@ -157,8 +226,8 @@ void* TestReadWaitFunc(void* arg) {
 }  // namespace
 
 // Test blocking Read operation using multiple threads.
-TEST(ChannelTest, TestBlockingRead) {
-  std::shared_ptr<Channel<int>> channel = Channel<int>::Create(1);
+TEST_P(ChannelTest, TestBlockingRead) {
+  std::shared_ptr<Channel<int>> channel = Channel<int>::Create(1, GetParam());
   auto reader = ChannelReader<int>::Create(channel);
   auto writer = ChannelWriter<int>::Create(channel);
 
@@ -193,8 +262,8 @@ void* TestWriteWaitFunc(void* arg) {
 }  // namespace
 
 // Test blocking Write operation using multiple threads.
-TEST(ChannelTest, TestBlockingWrite) {
-  std::shared_ptr<Channel<int>> channel = Channel<int>::Create(1);
+TEST_P(ChannelTest, TestBlockingWrite) {
+  std::shared_ptr<Channel<int>> channel = Channel<int>::Create(1, GetParam());
   auto reader = ChannelReader<int>::Create(channel);
   auto writer = ChannelWriter<int>::Create(channel);
 
@@ -267,13 +336,13 @@ void* TestArrChannelReader(void* arg) {
 // destination array. At the end, the destination array should be a copy of the
 // source array. The test should complete without a Close() call as there are an
 // equal number of blocking Read()/Write() operations on the Channel.
-TEST(ChannelTest, TestMultipleBlockingReadWrite) {
+TEST_P(ChannelTest, TestMultipleBlockingReadWrite) {
   pthread_t reader_tids[kArrTestSize];
   pthread_t writer_tids[kArrTestSize];
   std::unique_ptr<ChannelReader<TestStruct>> readers[kArrTestSize];
   ChannelWriterArgs writers[kArrTestSize];
   std::shared_ptr<Channel<TestStruct>> channel =
-      Channel<TestStruct>::Create(kArrTestSize);
+      Channel<TestStruct>::Create(kArrTestSize, GetParam());
   // Initialize test array.
   for (size_t i = 0; i < kArrTestSize; ++i) test_arr_src[i] = i + 1;
   // Create ChannelReader/ChannelWriter threads.
@@ -393,10 +462,11 @@ void* StressTestChannelReaderFunc(void* arg) {
 // depth, and there are more ChannelReaders and more ChannelWriters than that
 // depth. Additionally, ChannelReaders and ChannelWriters may utilize the
 // non-blocking calls.
-TEST(ChannelTest, ReadWriteStressTest) {
+TEST_P(ChannelTest, ReadWriteStressTest) {
   pthread_t reader_tids[kChannelReaderCnt];
   pthread_t writer_tids[kChannelWriterCnt];
-  std::shared_ptr<Channel<int>> channel = Channel<int>::Create(kMaxDepth);
+  std::shared_ptr<Channel<int>> channel =
+      Channel<int>::Create(kMaxDepth, GetParam());
   StressTestChannelReaderArgs readers[kChannelReaderCnt];
   StressTestChannelWriterArgs writers[kChannelWriterCnt];
   std::set<int> src, src_copy, dst;
@@ -443,8 +513,8 @@ TEST(ChannelTest, ReadWriteStressTest) {
   EXPECT_EQ(src_copy, dst);
 }
 
-TEST(ChannelTest, BasicSelectTest) {
-  std::shared_ptr<Channel<int>> channel = Channel<int>::Create(2);
+TEST_P(ChannelTest, BasicSelectTest) {
+  std::shared_ptr<Channel<int>> channel = Channel<int>::Create(2, GetParam());
   auto writer = ChannelWriter<int>::Create(channel);
   auto reader = ChannelReader<int>::Create(channel);
 
@@ -477,12 +547,13 @@ TEST(ChannelTest, BasicSelectTest) {
   EXPECT_EQ(ERR_CANCELLED, status_or_ready.status().error_code());
 }
 
-TEST(ChannelTest, BasicSelectTestMultiChannel) {
-  std::shared_ptr<Channel<int>> int_channel = Channel<int>::Create(2);
+TEST_P(ChannelTest, BasicSelectTestMultiChannel) {
+  std::shared_ptr<Channel<int>> int_channel =
+      Channel<int>::Create(2, GetParam());
   auto int_writer = ChannelWriter<int>::Create(int_channel);
   auto int_reader = ChannelReader<int>::Create(int_channel);
   std::shared_ptr<Channel<std::string>> str_channel =
-      Channel<std::string>::Create(2);
+      Channel<std::string>::Create(2, GetParam());
   auto str_writer = ChannelWriter<std::string>::Create(str_channel);
   auto str_reader = ChannelReader<std::string>::Create(str_channel);
   std::vector<ChannelBase*> channels = {int_channel.get(), str_channel.get()};
@@ -556,7 +627,7 @@ void SelectStressTestProcessChannel(ChannelReader<int>* reader,
 
 // Similar to ReadWriteStressTest but creates a separate Channel for each writer
 // to use. The main thread Selects on and processes all of the messages.
-TEST(ChannelTest, SelectStressTest) {
+TEST_P(ChannelTest, SelectStressTest) {
   const int kChannelCnt = 10;
   pthread_t writer_tids[kChannelCnt];
   std::shared_ptr<Channel<int>> channels[kChannelCnt];
@@ -573,7 +644,7 @@ TEST(ChannelTest, SelectStressTest) {
   }
   // Create ChannelWriter threads.
   for (size_t i = 0; i < kChannelCnt; ++i) {
-    channels[i] = Channel<int>::Create(kMaxDepth);
+    channels[i] = Channel<int>::Create(kMaxDepth, GetParam());
     ASSERT_NE(nullptr,
               writers[i].writer = ChannelWriter<int>::Create(channels[i]));
     writers[i].src = &src;
@@ -606,4 +677,8 @@ TEST(ChannelTest, SelectStressTest) {
   EXPECT_EQ(src_copy, dst);
 }
 
+INSTANTIATE_TEST_SUITE_P(ChannelImpls, ChannelTest,
+                         ::testing::Values(ChannelImpl::kLocked,
+                                           ChannelImpl::kLockFreeRing));
+
 }  // namespace stratum
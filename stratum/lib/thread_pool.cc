@@ -0,0 +1,54 @@
+// Copyright 2018-present Open Networking Foundation
+// SPDX-License-Identifier: Apache-2.0
+
+
+#include "stratum/lib/thread_pool.h"
+
+#include <utility>
+
+#include "stratum/glue/logging.h"
+
+namespace stratum {
+
+ThreadPool::ThreadPool(int num_threads) : queue_(), shutdown_(false) {
+  CHECK_GT(num_threads, 0) << "ThreadPool needs at least one thread.";
+  workers_.reserve(num_threads);
+  for (int i = 0; i < num_threads; ++i) {
+    workers_.emplace_back([this]() { WorkerLoop(); });
+  }
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    absl::MutexLock l(&lock_);
+    shutdown_ = true;
+  }
+  for (auto& worker : workers_) worker.join();
+}
+
+void ThreadPool::Schedule(std::function<void()> closure) {
+  absl::MutexLock l(&lock_);
+  queue_.push_back(std::move(closure));
+}
+
+int ThreadPool::QueueSize() const {
+  absl::MutexLock l(&lock_);
+  return queue_.size();
+}
+
+void ThreadPool::WorkerLoop() {
+  while (true) {
+    std::function<void()> closure;
+    {
+      absl::MutexLock l(&lock_);
+      lock_.Await(absl::Condition(this, &ThreadPool::WorkAvailable));
+      // Drain the queue before honoring the shutdown request.
+      if (queue_.empty()) return;
+      closure = std::move(queue_.front());
+      queue_.pop_front();
+    }
+    closure();
+  }
+}
+
+}  // namespace stratum
@@ -0,0 +1,71 @@
+// Copyright 2018-present Open Networking Foundation
+// SPDX-License-Identifier: Apache-2.0
+
+
+#ifndef STRATUM_LIB_THREAD_POOL_H_
+#define STRATUM_LIB_THREAD_POOL_H_
+
+#include <deque>
+#include <functional>
+#include <thread>  // NOLINT
+#include <vector>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/synchronization/mutex.h"
+
+namespace stratum {
+
+// ThreadPool is a fixed-size pool of worker threads executing closures in FIFO
+// order. Closures are not cancellable; the destructor runs all the closures
+// that are still queued and then joins the workers. The pool itself is
+// thread-safe: Schedule() can be called from any thread, including from a
+// closure running on the pool.
+//
+// Callers that need to wait for a set of closures should use something like
+// absl::BlockingCounter:
+//
+//   absl::BlockingCounter done(tasks.size());
+//   for (auto& task : tasks) {
+//     pool->Schedule([&task, &done]() {
+//       task.Run();
+//       done.DecrementCount();
+//     });
+//   }
+//   done.Wait();
+class ThreadPool {
+ public:
+  // Starts num_threads worker threads. num_threads must be positive.
+  explicit ThreadPool(int num_threads);
+  ~ThreadPool() LOCKS_EXCLUDED(lock_);
+
+  // Queues the closure for execution on one of the workers.
+  void Schedule(std::function<void()> closure) LOCKS_EXCLUDED(lock_);
+
+  // Returns the number of worker threads.
+  int NumThreads() const { return workers_.size(); }
+
+  // Returns the number of closures queued but not yet picked up by a worker.
+  int QueueSize() const LOCKS_EXCLUDED(lock_);
+
+  // ThreadPool is neither copyable nor movable.
+  ThreadPool(const ThreadPool&) = delete;
+  ThreadPool& operator=(const ThreadPool&) = delete;
+
+ private:
+  // Main loop of every worker thread.
+  void WorkerLoop() LOCKS_EXCLUDED(lock_);
+
+  // Returns true if a worker has something to do.
+  bool WorkAvailable() const SHARED_LOCKS_REQUIRED(lock_) {
+    return shutdown_ || !queue_.empty();
+  }
+
+  mutable absl::Mutex lock_;
+  std::deque<std::function<void()>> queue_ GUARDED_BY(lock_);
+  bool shutdown_ GUARDED_BY(lock_);
+  std::vector<std::thread> workers_;
+};
+
+}  // namespace stratum
+
+#endif  // STRATUM_LIB_THREAD_POOL_H_
@@ -0,0 +1,86 @@
+// Copyright 2018-present Open Networking Foundation
+// SPDX-License-Identifier: Apache-2.0
+
+
+#include "stratum/lib/thread_pool.h"
+
+#include <atomic>
+#include <set>
+#include <thread>  // NOLINT
+
+#include "absl/synchronization/barrier.h"
+#include "absl/synchronization/blocking_counter.h"
+#include "absl/synchronization/mutex.h"
+#include "gtest/gtest.h"
+
+namespace stratum {
+namespace {
+
+TEST(ThreadPoolTest, RunsAllScheduledClosures) {
+  constexpr int kNumClosures = 1000;
+  std::atomic<int> count(0);
+  ThreadPool pool(4);
+  EXPECT_EQ(4, pool.NumThreads());
+  absl::BlockingCounter done(kNumClosures);
+  for (int i = 0; i < kNumClosures; ++i) {
+    pool.Schedule([&count, &done]() {
+      ++count;
+      done.DecrementCount();
+    });
+  }
+  done.Wait();
+  EXPECT_EQ(kNumClosures, count.load());
+}
+
+TEST(ThreadPoolTest, UsesMultipleThreads) {
+  constexpr int kNumThreads = 4;
+  ThreadPool pool(kNumThreads);
+  absl::Mutex lock;
+  std::set<std::thread::id> thread_ids;
+  // Every closure blocks until all of them are running, which is only
+  // possible if they run on different workers.
+  absl::Barrier started(kNumThreads);
+  absl::BlockingCounter done(kNumThreads);
+  for (int i = 0; i < kNumThreads; ++i) {
+    pool.Schedule([&]() {
+      {
+        absl::MutexLock l(&lock);
+        thread_ids.insert(std::this_thread::get_id());
+      }
+      started.Block();
+      done.DecrementCount();
+    });
+  }
+  done.Wait();
+  EXPECT_EQ(kNumThreads, thread_ids.size());
+}
+
+TEST(ThreadPoolTest, DestructorDrainsQueue) {
+  std::atomic<int> count(0);
+  {
+    ThreadPool pool(1);
+    for (int i = 0; i < 100; ++i) {
+      pool.Schedule([&count]() { ++count; });
+    }
+  }
+  EXPECT_EQ(100, count.load());
+}
+
+TEST(ThreadPoolTest, ScheduleFromClosure) {
+  std::atomic<int> count(0);
+  absl::BlockingCounter done(2);
+  ThreadPool pool(2);
+  pool.Schedule([&]() {
+    ++count;
+    pool.Schedule([&]() {
+      ++count;
+      done.DecrementCount();
+    });
+    done.DecrementCount();
+  });
+  done.Wait();
+  EXPECT_EQ(2, count.load());
+}
+
+}  // namespace
+}  // namespace stratum
@@ -4,111 +4,97 @@
 
 
 #include "stratum/lib/timer_daemon.h"
+
+#include <algorithm>
+#include <limits>
+
+#include "gflags/gflags.h"
+#include "stratum/glue/logging.h"
+#include "absl/memory/memory.h"
 #include "absl/synchronization/mutex.h"
 
+DEFINE_int32(timer_daemon_num_workers, 4,
+             "Number of threads running the actions of the timers of the "
+             "TimerDaemon.");
+DEFINE_int32(timer_daemon_coalescing_ms, 10,
+             "The first deadline of a periodic timer is rounded up to a "
+             "multiple of this many milliseconds (or of its period, if "
+             "shorter), so that periodic timers with the same period fire "
+             "together. 0 or 1 disables the rounding.");
+
 namespace stratum {
 namespace hal {
 
-namespace {
-// A function that is executed by the thread created by TimerDaemon::Start().
-// It provides a timer resolution of 1ms.
-static void* Timer(void* arg) {
-  while (true) {
-    // Sleep for 1ms.
-    absl::SleepFor(absl::Milliseconds(1));
-
-    // Call the method that will process the list of timers.
-    // If the method returns 'false' it means that this thread should be
-    // terminated.
-    if (!TimerDaemon::Execute()) break;
-  }
-  return nullptr;
-}
-}  // namespace
-
-bool TimerDaemon::IsStopped() {
-  absl::WriterMutexLock l(&access_lock_);
-  return !started_;
-}
-
-TimerDaemon::DescriptorPtr TimerDaemon::GetAction() {
-  // Once woken up check if the timer at the top of the heap is due.
-  absl::WriterMutexLock l(&access_lock_);
-
-  if (timers_.empty()) {
-    return nullptr;
-  }
-  if (timers_.front().expired()) {
-    pop_heap(timers_.begin(), timers_.end(), TimerDescriptorComparator());
-    timers_.pop_back();
-    return nullptr;
-  }
-  TimerDaemon::DescriptorPtr front = DescriptorPtr(timers_.front());
-  absl::Time now = absl::Now();
-  if (front->due_time_ <= now) {
-    pop_heap(timers_.begin(), timers_.end(), TimerDescriptorComparator());
-    timers_.pop_back();
-    if (front->Repeat()) {
-      // Periodic timer. Insert it in the queue again.
-      front->due_time_ += front->Period();
-      timers_.push_back(front);
-      push_heap(timers_.begin(), timers_.end(), TimerDescriptorComparator());
-    }
-    return front;
+constexpr int TimerDaemon::kRootBits;
+constexpr int TimerDaemon::kLevelBits;
+constexpr int TimerDaemon::kNumLevels;
+constexpr uint64 TimerDaemon::kRootSize;
+constexpr uint64 TimerDaemon::kLevelSize;
+constexpr uint64 TimerDaemon::kMaxTicks;
+
+void TimerDaemon::Run() {
+  absl::MutexLock l(&access_lock_);
+  while (started_) {
+    RunDueTimers(absl::Now());
+    next_wakeup_ = NextWakeupTime();
+    wakeup_cond_.WaitWithDeadline(&access_lock_, next_wakeup_);
   }
-  return nullptr;
 }
 
 bool TimerDaemon::Execute() {
   TimerDaemon* daemon = GetInstance();
+  absl::MutexLock l(&daemon->access_lock_);
+  if (!daemon->started_) return false;
 
-  if (daemon->IsStopped()) return false;
-
-  auto front = daemon->GetAction();
-  if (front != nullptr) {
-    // Execute the timer's action!
-    const auto& status = front->ExecuteAction();
-    if (status.ok()) {
-      VLOG(1) << "Timer has been triggered!";
-    } else {
-      LOG(ERROR) << "Error executing action: " << status;
-    }
-  }
+  daemon->RunDueTimers(absl::Now());
+  daemon->access_lock_.Await(
+      absl::Condition(daemon, &TimerDaemon::NoActionRunning));
   return true;
 }
 
 ::util::Status TimerDaemon::Start() {
-  absl::WriterMutexLock l(&GetInstance()->access_lock_);
-  if (GetInstance()->started_ == true) {
+  TimerDaemon* daemon = GetInstance();
+  absl::MutexLock l(&daemon->access_lock_);
+  if (daemon->started_ == true) {
     return ::util::OkStatus();
   }
+  CHECK_RETURN_IF_FALSE(FLAGS_timer_daemon_num_workers > 0)
+      << "Invalid number of timer workers: " << FLAGS_timer_daemon_num_workers
+      << ".";
 
-  GetInstance()->started_ = true;
+  daemon->started_ = true;
+  daemon->next_wakeup_ = absl::InfiniteFuture();
+  daemon->workers_ =
+      absl::make_unique<ThreadPool>(FLAGS_timer_daemon_num_workers);
+  daemon->timer_thread_ = std::thread([daemon]() { daemon->Run(); });
+  VLOG(1) << "The timer daemon has been started.";
 
-  if (pthread_create(&GetInstance()->tid_, nullptr, &Timer, nullptr) != 0) {
-    return MAKE_ERROR(ERR_INTERNAL) << "Failed to create the timer thread.";
-  } else {
-    VLOG(1) << "The timer daemon has been started.";
-    return ::util::OkStatus();
-  }
+  return ::util::OkStatus();
 }
 
 ::util::Status TimerDaemon::Stop() {
+  TimerDaemon* daemon = GetInstance();
   {
-    absl::WriterMutexLock l(&GetInstance()->access_lock_);
-    GetInstance()->started_ = false;
+    absl::MutexLock l(&daemon->access_lock_);
+    if (!daemon->started_) return ::util::OkStatus();
+    daemon->started_ = false;
+    daemon->wakeup_cond_.Signal();
   }
 
-  if (pthread_join(GetInstance()->tid_, nullptr) != 0) {
-    return MAKE_ERROR(ERR_INTERNAL) << "Failed to join the timer thread.";
-  } else {
-    absl::WriterMutexLock l(&GetInstance()->access_lock_);
-    GetInstance()->timers_.clear();
-    GetInstance()->tid_ = 0;
+  daemon->timer_thread_.join();
+  // Waits for the actions being run. The queued ones see that the service is
+  // stopped and return at once.
+  daemon->workers_.reset();
 
-    VLOG(1) << "The timer daemon has been stopped.";
-    return ::util::OkStatus();
+  absl::MutexLock l(&daemon->access_lock_);
+  for (auto& slot : daemon->root_) slot.clear();
+  for (auto& level : daemon->levels_) {
+    for (auto& slot : level) slot.clear();
   }
+  daemon->groups_.clear();
+  VLOG(1) << "The timer daemon has been stopped.";
+
+  return ::util::OkStatus();
 }
 
 ::util::Status TimerDaemon::RequestOneShotTimer(uint64 delay_ms,
@@ -129,19 +115,200 @@ bool TimerDaemon::Execute() {
 ::util::Status TimerDaemon::RequestTimer(bool repeat, uint64 delay_ms,
                                           uint64 period_ms, Action action,
                                           DescriptorPtr* desc) {
-  absl::WriterMutexLock l(&access_lock_);
+  absl::MutexLock l(&access_lock_);
 
   VLOG(1) << "Registered timer.";
 
-  absl::Time now = absl::Now();
+  const absl::Time now = absl::Now();
+  if (groups_.empty()) {
+    // No tick is processed while there are no timers: catch up with the
+    // clock.
+    next_tick_ = std::max(next_tick_, TickAtOrBefore(now));
+  }
   *desc = std::make_shared<Descriptor>(repeat, action);
-  (*desc)->due_time_ = now + absl::Milliseconds(delay_ms);
   (*desc)->period_ = absl::Milliseconds(period_ms);
-  timers_.push_back(DescriptorWeakPtr(*desc));
-  push_heap(timers_.begin(), timers_.end(), TimerDescriptorComparator());
+  uint64 expires = TickAtOrAfter(now + absl::Milliseconds(delay_ms));
+  uint64 period = 0;
+  if (repeat) {
+    period = std::max<uint64>(period_ms, 1);
+    const uint64 coalescing = std::min<uint64>(
+        std::max(FLAGS_timer_daemon_coalescing_ms, 1), period);
+    expires = (expires + coalescing - 1) / coalescing * coalescing;
+  }
+  (*desc)->due_time_ = TimeOfTick(expires);
+  AddToGroup(expires, period, {DescriptorWeakPtr(*desc)});
+  if ((*desc)->due_time_ < next_wakeup_) wakeup_cond_.Signal();
 
   return ::util::OkStatus();
 }
 
+void TimerDaemon::RunDueTimers(absl::Time now) {
+  const uint64 now_tick = TickAtOrBefore(now);
+  if (groups_.empty()) {
+    // Nothing to cascade or to fire.
+    next_tick_ = std::max(next_tick_, now_tick + 1);
+    return;
+  }
+  while (next_tick_ <= now_tick) ProcessTick();
+}
+
+void TimerDaemon::ProcessTick() {
+  const uint64 tick = next_tick_;
+  const uint64 index = tick & (kRootSize - 1);
+  if (index == 0) {
+    // A turn of the root wheel is complete: bring the groups of the next slot
+    // of level 1 down, and so on up the levels whose turn is complete.
+    for (int level = 1; level <= kNumLevels; ++level) {
+      if (Cascade(level, (tick >> LevelShift(level)) & (kLevelSize - 1))) {
+        break;
+      }
+    }
+  }
+  std::vector<TimerGroup*> due;
+  due.swap(root_[index]);
+  ++next_tick_;
+  for (TimerGroup* group : due) FireGroup(group, tick);
+}
+
+uint64 TimerDaemon::Cascade(int level, uint64 index) {
+  std::vector<TimerGroup*> groups;
+  groups.swap(*Slot(level, index));
+  for (TimerGroup* group : groups) InsertInWheel(group);
+
+  return index;
+}
+
+void TimerDaemon::FireGroup(TimerGroup* group, uint64 tick) {
+  auto node = groups_.extract(TimerGroupKey(group->expires, group->period));
+  std::unique_ptr<TimerGroup> owned = std::move(node.mapped());
+  // Next turn of periodic timers. If the daemon fell behind, the missed turns
+  // are skipped.
+  uint64 expires = owned->expires + owned->period;
+  if (owned->period > 0 && expires <= tick) {
+    expires += ((tick - expires) / owned->period + 1) * owned->period;
+  }
+  const absl::Time due_time = TimeOfTick(expires);
+  std::vector<DescriptorWeakPtr> live;
+  live.reserve(owned->timers.size());
+  for (const auto& timer : owned->timers) {
+    // A timer which has been cancelled is dropped here.
+    DescriptorPtr desc = timer.lock();
+    if (desc == nullptr) continue;
+    Dispatch(desc);
+    desc->due_time_ = due_time;
+    live.push_back(timer);
+  }
+  if (owned->period > 0 && !live.empty()) {
+    AddToGroup(expires, owned->period, std::move(live));
+  }
+}
+
+void TimerDaemon::AddToGroup(uint64 expires, uint64 period,
+                             std::vector<DescriptorWeakPtr> timers) {
+  auto& group = groups_[TimerGroupKey(expires, period)];
+  if (group != nullptr) {
+    group->timers.insert(group->timers.end(), timers.begin(), timers.end());
+    return;
+  }
+  group = absl::make_unique<TimerGroup>();
+  group->expires = expires;
+  group->period = period;
+  group->timers = std::move(timers);
+  InsertInWheel(group.get());
+}
+
+void TimerDaemon::InsertInWheel(TimerGroup* group) {
+  // Groups already due go to the next slot processed.
+  uint64 expires = std::max(group->expires, next_tick_);
+  const uint64 delta = expires - next_tick_;
+  if (delta < kRootSize) {
+    root_[expires & (kRootSize - 1)].push_back(group);
+    return;
+  }
+  if (delta > kMaxTicks) expires = next_tick_ + kMaxTicks;
+  for (int level = 1; level <= kNumLevels; ++level) {
+    if (level == kNumLevels || delta < (1ULL << LevelShift(level + 1))) {
+      Slot(level, (expires >> LevelShift(level)) & (kLevelSize - 1))
+          ->push_back(group);
+      return;
+    }
+  }
+}
+
+void TimerDaemon::Dispatch(const DescriptorPtr& desc) {
+  if (desc->running_.exchange(true)) {
+    VLOG(1) << "Skipping timer whose previous action is still running.";
+    return;
+  }
+  ++num_actions_running_;
+  workers_->Schedule([this, desc]() { RunAction(desc); });
+}
+
+void TimerDaemon::RunAction(const DescriptorPtr& desc) {
+  bool started;
+  {
+    absl::ReaderMutexLock l(&access_lock_);
+    started = started_;
+  }
+  if (started) {
+    // Execute the timer's action!
+    const auto& status = desc->ExecuteAction();
+    if (status.ok()) {
+      VLOG(1) << "Timer has been triggered!";
+    } else {
+      LOG(ERROR) << "Error executing action: " << status;
+    }
+  }
+  desc->running_ = false;
+
+  absl::MutexLock l(&access_lock_);
+  --num_actions_running_;
+}
+
+absl::Time TimerDaemon::NextWakeupTime() const {
+  if (groups_.empty()) return absl::InfiniteFuture();
+
+  // The first non-empty slot of the root wheel.
+  uint64 wakeup = std::numeric_limits<uint64>::max();
+  for (uint64 tick = next_tick_; tick < next_tick_ + kRootSize; ++tick) {
+    if (!root_[tick & (kRootSize - 1)].empty()) {
+      wakeup = tick;
+      break;
+    }
+  }
+  // The first cascade of a non-empty slot of each level. The groups brought
+  // down are not due before it.
+  for (int level = 1; level <= kNumLevels; ++level) {
+    const int shift = LevelShift(level);
+    const uint64 slot_ticks = 1ULL << shift;
+    uint64 boundary = (next_tick_ + slot_ticks - 1) >> shift << shift;
+    for (uint64 i = 0; i < kLevelSize && boundary < wakeup;
+         ++i, boundary += slot_ticks) {
+      if (!levels_[level - 1][(boundary >> shift) & (kLevelSize - 1)]
+               .empty()) {
+        wakeup = boundary;
+        break;
+      }
+    }
+  }
+  if (wakeup == std::numeric_limits<uint64>::max()) {
+    return absl::InfiniteFuture();
+  }
+
+  return TimeOfTick(wakeup);
+}
+
+uint64 TimerDaemon::TickAtOrAfter(absl::Time t) const {
+  if (t <= start_time_) return 0;
+  return absl::ToInt64Milliseconds(
+      absl::Ceil(t - start_time_, absl::Milliseconds(1)));
+}
+
+uint64 TimerDaemon::TickAtOrBefore(absl::Time t) const {
+  if (t <= start_time_) return 0;
+  return absl::ToInt64Milliseconds(
+      absl::Floor(t - start_time_, absl::Milliseconds(1)));
+}
+
 }  // namespace hal
 }  // namespace stratum
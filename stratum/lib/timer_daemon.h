@@ -6,17 +6,20 @@
 #ifndef STRATUM_LIB_TIMER_DAEMON_H_
 #define STRATUM_LIB_TIMER_DAEMON_H_
 
-#include <pthread.h>
-#include <algorithm>
+#include <atomic>
 #include <functional>
-#include <vector>
 #include <memory>
+#include <thread>  // NOLINT
+#include <utility>
+#include <vector>
 
 #include "stratum/glue/integral_types.h"
 #include "stratum/glue/status/status.h"
 #include "stratum/glue/status/status_macros.h"
 #include "stratum/lib/macros.h"
+#include "stratum/lib/thread_pool.h"
 #include "stratum/public/lib/error.h"
+#include "absl/container/flat_hash_map.h"
 #include "absl/synchronization/mutex.h"
 #include "absl/time/clock.h"
 #include "absl/time/time.h"
@@ -24,6 +27,20 @@
 namespace stratum {
 namespace hal {
 
+// TimerDaemon runs the actions of one-shot and periodic timers. The timers are
+// kept in a hierarchical timing wheel with a resolution of 1ms: a root wheel of
+// 256 1ms slots and 4 levels of 64 slots, each slot of a level covering a whole
+// turn of the level below. Adding or cancelling a timer is O(1) and the timer
+// thread only wakes up at the next deadline, or when a timer with an earlier
+// deadline is requested. Timers due at the same tick with the same period are
+// coalesced into one entry of the wheel, and the first deadline of a periodic
+// timer is rounded up to a multiple of FLAGS_timer_daemon_coalescing_ms so that
+// periodic timers with the same period share as few entries as possible.
+//
+// The actions are run on a pool of FLAGS_timer_daemon_num_workers threads, so a
+// slow action does not delay the other timers. A periodic timer whose previous
+// action is still queued or running skips its turn. A timer is cancelled by
+// releasing its DescriptorPtr.
 class TimerDaemon final {
  private:
   using Action = std::function<::util::Status()>;
@@ -31,9 +48,15 @@ class TimerDaemon final {
   class Descriptor {
    public:
     explicit Descriptor(const Action& action)
-        : repeat_(true), period_(absl::Seconds(1)), action_(action) {}
+        : repeat_(true),
+          period_(absl::Seconds(1)),
+          running_(false),
+          action_(action) {}
     explicit Descriptor(bool repeat, const Action& action)
-        : repeat_(repeat), period_(absl::Seconds(1)), action_(action) {}
+        : repeat_(repeat),
+          period_(absl::Seconds(1)),
+          running_(false),
+          action_(action) {}
     ~Descriptor() {}
     bool Repeat() { return repeat_; }
     absl::Duration Period() { return period_; }
@@ -42,6 +65,8 @@ class TimerDaemon final {
     bool repeat_;
     absl::Time due_time_;
     absl::Duration period_;
+    // True while the action is queued or running on a worker.
+    std::atomic<bool> running_;
 
    private:
     Action action_ = []() {
@@ -52,51 +77,40 @@ class TimerDaemon final {
 
   using DescriptorWeakPtr = std::weak_ptr<Descriptor>;
 
-  // In order to use TimerDaemon::Descriptor as a key in heap operations a
-  // comparator functor has to be defined.
-  struct TimerDescriptorComparator {
-    bool operator()(const TimerDaemon::DescriptorWeakPtr& lhs,
-                    const TimerDaemon::DescriptorWeakPtr& rhs) const {
-      // The goal of this method is to find which timer descriptor describes a
-      // timer that should be executed earlier: lhs or rhs?
-      // If a timer is canceled then the weak pointer pointing to it will
-      // 'expire' and there is no point in keeping such pointer on the heap. As
-      // the most effective way of removing an element from a heap is to move it
-      // to the top and then delete it, expired pointers should be theated as
-      // ones that are to be executed 'now'. This approach makes them to
-      // 'bubbled up' to the top as quickly as possible and then they can be
-      // removed.
-      if (lhs.expired() && !rhs.expired()) {
-        // rhs is expired, so, it is the lowest number.
-        return true;
-      }
-      if (rhs.expired() && !lhs.expired()) {
-        // lhs is expired, so, it is the lowest number.
-        return false;
-      }
-      if (rhs.expired() && lhs.expired()) {
-        // Both are expired, so, it really does not matter what we return.
-        return false;
-      }
-      // Both elements are still valid. Compare them!
-      return std::shared_ptr<Descriptor>(lhs)->due_time_ >
-             std::shared_ptr<Descriptor>(rhs)->due_time_;
-    }
+  // The timers due at the same tick with the same period.
+  struct TimerGroup {
+    uint64 expires;  // tick
+    uint64 period;   // ticks, 0 for one-shot timers
+    std::vector<DescriptorWeakPtr> timers;
   };
 
+  // A group is identified by its (expires, period) pair.
+  using TimerGroupKey = std::pair<uint64, uint64>;
+
+  // Geometry of the timing wheel.
+  static constexpr int kRootBits = 8;
+  static constexpr int kLevelBits = 6;
+  static constexpr int kNumLevels = 4;
+  static constexpr uint64 kRootSize = 1ULL << kRootBits;
+  static constexpr uint64 kLevelSize = 1ULL << kLevelBits;
+  // Timers further than this are parked in the last slot of the top level.
+  static constexpr uint64 kMaxTicks =
+      (1ULL << (kRootBits + kNumLevels * kLevelBits)) - 1;
+
  public:
   using DescriptorPtr = std::shared_ptr<Descriptor>;
 
-  // Starts the timer service. Creates a thread that calls Execute() every 1ms.
+  // Starts the timer service: the timer thread and the pool of workers running
+  // the actions.
   static ::util::Status Start() LOCKS_EXCLUDED(access_lock_);
-  // Stops the timer service. Notifies the timer thread to exit and waits until
-  // it joins.
+  // Stops the timer service. Notifies the timer thread to exit, waits until it
+  // joins and until the actions being run are done. Actions not started yet
+  // are dropped, as are all the timers.
   static ::util::Status Stop() LOCKS_EXCLUDED(access_lock_);
-  // The 'worker' of the timer service. Is called every 1ms and checks if the
-  // first timer to be executed should be executed. If so, the action is
-  // executed and then if the timer is periodic the timer is updated and
-  // re-inserted into the heap with timers. It also takes care of all expired
-  // timers.
+  // Runs the actions of all the timers due by now, then waits until all the
+  // actions queued or running are done. This is normally done by the timer
+  // thread; calling it makes the processing synchronous, e.g. in tests.
+  // Returns false if the timer service is stopped.
   static bool Execute() LOCKS_EXCLUDED(access_lock_);
 
   // Creates a one-shot timer that will execute 'action' 'delay_ms' milliseconds
@@ -112,35 +126,127 @@ class TimerDaemon final {
                                              DescriptorPtr* desc);
 
  private:
-  TimerDaemon() : started_(false) {}
-
-  // If there is an action to be executed at this moment of time a non-null
-  // pointer is returned.
-  DescriptorPtr GetAction();
-
-  // Returns true if the timer daemon is stopped.
-  bool IsStopped();
+  TimerDaemon()
+      : started_(false),
+        start_time_(absl::Now()),
+        next_tick_(0),
+        next_wakeup_(absl::InfiniteFuture()),
+        num_actions_running_(0) {}
 
   static TimerDaemon* GetInstance() {
     static TimerDaemon* singleton = new TimerDaemon();
 
     return singleton;
   }
+
+  // Main loop of the timer thread. Runs the due timers and sleeps until the
+  // next deadline.
+  void Run() LOCKS_EXCLUDED(access_lock_);
+
   // Internal method creating requested timer.
   ::util::Status RequestTimer(bool repeat, uint64 delay_ms, uint64 period_ms,
                               Action action, DescriptorPtr* desc)
       LOCKS_EXCLUDED(access_lock_);
 
-  // A Mutex used to guard access to the list of pointers to timer requests and
-  // the started_ flag.
-  mutable absl::Mutex access_lock_;
+  // Processes all the ticks up to 'now', dispatching the actions of the due
+  // timers to the workers.
+  void RunDueTimers(absl::Time now) EXCLUSIVE_LOCKS_REQUIRED(access_lock_);
+
+  // Processes the tick 'next_tick_': cascades the upper levels of the wheel if
+  // a turn of the root wheel is complete and fires the groups of the tick.
+  void ProcessTick() EXCLUSIVE_LOCKS_REQUIRED(access_lock_);
+
+  // Moves the groups of slot 'index' of 'level' down the wheel. Returns
+  // 'index'.
+  uint64 Cascade(int level, uint64 index)
+      EXCLUSIVE_LOCKS_REQUIRED(access_lock_);
+
+  // Dispatches the actions of the group due at 'tick' and re-inserts the group
+  // if it is periodic.
+  void FireGroup(TimerGroup* group, uint64 tick)
+      EXCLUSIVE_LOCKS_REQUIRED(access_lock_);
+
+  // Adds 'timers' to the group with the given expiry and period, creating the
+  // group if needed.
+  void AddToGroup(uint64 expires, uint64 period,
+                  std::vector<DescriptorWeakPtr> timers)
+      EXCLUSIVE_LOCKS_REQUIRED(access_lock_);
+
+  // Puts the group in the slot of the wheel matching its expiry.
+  void InsertInWheel(TimerGroup* group) EXCLUSIVE_LOCKS_REQUIRED(access_lock_);
+
+  // Queues the action of the timer on the workers, unless it is still queued or
+  // running.
+  void Dispatch(const DescriptorPtr& desc)
+      EXCLUSIVE_LOCKS_REQUIRED(access_lock_);
+
+  // Runs the action of the timer on a worker.
+  void RunAction(const DescriptorPtr& desc) LOCKS_EXCLUDED(access_lock_);
+
+  // Returns the time of the next tick with groups to fire or to cascade.
+  absl::Time NextWakeupTime() const SHARED_LOCKS_REQUIRED(access_lock_);
 
-  std::vector<DescriptorWeakPtr> timers_ GUARDED_BY(access_lock_);
+  // Returns the log2 of the number of ticks covered by one slot of 'level' (0 is
+  // the root wheel).
+  static int LevelShift(int level) {
+    return level == 0 ? 0 : kRootBits + (level - 1) * kLevelBits;
+  }
+
+  // Returns slot 'index' of 'level'.
+  std::vector<TimerGroup*>* Slot(int level, uint64 index)
+      EXCLUSIVE_LOCKS_REQUIRED(access_lock_) {
+    return level == 0 ? &root_[index] : &levels_[level - 1][index];
+  }
+
+  // Conversions between time and ticks of the wheel. TickAtOrAfter() rounds up,
+  // TickAtOrBefore() rounds down.
+  uint64 TickAtOrAfter(absl::Time t) const SHARED_LOCKS_REQUIRED(access_lock_);
+  uint64 TickAtOrBefore(absl::Time t) const
+      SHARED_LOCKS_REQUIRED(access_lock_);
+  absl::Time TimeOfTick(uint64 tick) const SHARED_LOCKS_REQUIRED(access_lock_) {
+    return start_time_ + absl::Milliseconds(tick);
+  }
+
+  // Returns true if no action is queued or running.
+  bool NoActionRunning() const SHARED_LOCKS_REQUIRED(access_lock_) {
+    return num_actions_running_ == 0;
+  }
+
+  // A Mutex used to guard access to the timing wheel and the started_ flag.
+  mutable absl::Mutex access_lock_;
 
-  pthread_t tid_ = 0;  // will not be destroyed before the thread is joined.
+  // Signalled to wake up the timer thread before next_wakeup_.
+  absl::CondVar wakeup_cond_;
 
   bool started_ GUARDED_BY(access_lock_);
 
+  // Time of tick 0.
+  const absl::Time start_time_;
+
+  // The first tick not processed yet.
+  uint64 next_tick_ GUARDED_BY(access_lock_);
+
+  // The time until which the timer thread sleeps.
+  absl::Time next_wakeup_ GUARDED_BY(access_lock_);
+
+  // The slots of the root wheel and of the upper levels. The groups are owned
+  // by 'groups_'.
+  std::vector<TimerGroup*> root_[kRootSize] GUARDED_BY(access_lock_);
+  std::vector<TimerGroup*> levels_[kNumLevels][kLevelSize] GUARDED_BY(
+      access_lock_);
+
+  // All the groups in the wheel.
+  absl::flat_hash_map<TimerGroupKey, std::unique_ptr<TimerGroup>> groups_
+      GUARDED_BY(access_lock_);
+
+  // Number of actions queued or running on the workers.
+  int num_actions_running_ GUARDED_BY(access_lock_);
+
+  // The workers running the actions. Created by Start(), destroyed by Stop().
+  std::unique_ptr<ThreadPool> workers_;
+
+  std::thread timer_thread_;
+
   friend class TimerDaemonTest;
 };
 
@@ -5,9 +5,17 @@
 
 #include "stratum/lib/timer_daemon.h"
 
+#include <time.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "stratum/glue/logging.h"
 #include "stratum/glue/status/status_test_util.h"
 #include "gtest/gtest.h"
 #include "absl/synchronization/mutex.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
 
 namespace stratum {
 namespace hal {
@@ -39,17 +47,29 @@ class TimerDaemonTest : public ::testing::Test {
 
   void TearDown() override { ASSERT_OK(TimerDaemon::Stop()); }
 
-  TimerDaemon::DescriptorPtr GetTimerDescriptorPtr(const absl::Time when) {
-    TimerDaemon::DescriptorPtr desc =
-        std::make_shared<TimerDaemon::Descriptor>(
-            /* repeat = */ false, []() { return ::util::OkStatus(); });
-    desc->due_time_ = when;
-    return desc;
+  // Returns the number of entries of the timing wheel.
+  static int NumTimerGroups() {
+    TimerDaemon* daemon = TimerDaemon::GetInstance();
+    absl::MutexLock l(&daemon->access_lock_);
+    return daemon->groups_.size();
+  }
+
+  // Returns the CPU time used by the process so far.
+  static absl::Duration ProcessCpuTime() {
+    struct timespec ts;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+    return absl::DurationFromTimespec(ts);
   }
 
-  TimerDaemon::DescriptorWeakPtr GetTimerDescriptorWeakPtr(
-      const TimerDaemon::DescriptorPtr &desc) {
-    return TimerDaemon::DescriptorWeakPtr(desc);
+  int GetCount() {
+    absl::ReaderMutexLock l(&access_lock_);
+    return count_;
+  }
+
+  ::util::Status IncrementCount() {
+    absl::WriterMutexLock l(&access_lock_);
+    ++count_;
+    return ::util::OkStatus();
   }
 
   // A counter used to check if timers are executed in correct order. Each timer
@@ -59,63 +79,8 @@ class TimerDaemonTest : public ::testing::Test {
   int count_ GUARDED_BY(access_lock_);
   // A Mutex used to guard access to the 'count_'.
   mutable absl::Mutex access_lock_;
-
-  // A comparator used internally by the TimerSevice to compare timestamps.
-  // This class is private, so, it is instantiated here to allow access by
-  // relevant tests.
-  TimerDaemon::TimerDescriptorComparator cmp_;
 };
 
-TEST_F(TimerDaemonTest, CompareSmallerBigger) {
-  absl::Time now = absl::Now();
-  auto desc1 = GetTimerDescriptorPtr(now);
-  auto desc2 = GetTimerDescriptorPtr(now + absl::Milliseconds(10));
-
-  auto weak1 = GetTimerDescriptorWeakPtr(desc1);
-  auto weak2 = GetTimerDescriptorWeakPtr(desc2);
-
-  // 0 > 10
-  EXPECT_FALSE(cmp_(weak1, weak2));
-
-  desc2.reset();
-  // 0 > expired 10
-  EXPECT_FALSE(cmp_(weak1, weak2));
-
-  desc1.reset();
-  // expired 0 > expired 10
-  EXPECT_FALSE(cmp_(weak1, weak2));
-
-  desc2 = GetTimerDescriptorPtr(now + absl::Milliseconds(10));
-  weak2 = GetTimerDescriptorWeakPtr(desc2);
-  // expired 0 > 10
-  EXPECT_TRUE(cmp_(weak1, weak2));
-}
-
-TEST_F(TimerDaemonTest, CompareBiggerSmaller) {
-  absl::Time now = absl::Now();
-  auto desc1 = GetTimerDescriptorPtr(now + absl::Milliseconds(10));
-  auto desc2 = GetTimerDescriptorPtr(now);
-
-  auto weak1 = GetTimerDescriptorWeakPtr(desc1);
-  auto weak2 = GetTimerDescriptorWeakPtr(desc2);
-
-  // 10 > 0
-  EXPECT_TRUE(cmp_(weak1, weak2));
-
-  desc2.reset();
-  // 10 > expired 0
-  EXPECT_FALSE(cmp_(weak1, weak2));
-
-  desc1.reset();
-  // expired 10 > expired 0
-  EXPECT_FALSE(cmp_(weak1, weak2));
-
-  desc2 = GetTimerDescriptorPtr(now);
-  weak2 = GetTimerDescriptorWeakPtr(desc2);
-  // expired 10 > 0
-  EXPECT_TRUE(cmp_(weak1, weak2));
-}
-
 TEST_F(TimerDaemonTest, CreateOneShot) {
   // This test verifies that TimerDaemon does create one-shot timer.
   TimerDaemon::DescriptorPtr desc;
@@ -154,6 +119,140 @@ TEST_F(TimerDaemonTest, CreateTwoOneShots) {
 
 TEST_F(TimerDaemonTest, CreatePeriodic) {
   // This test verifies that TimerDaemon does create periodic timer.
+  TimerDaemon::DescriptorPtr desc;
+  ASSERT_OK(TimerDaemon::RequestPeriodicTimer(
+      0, 10, [this]() { return IncrementCount(); }, &desc));
+  absl::SleepFor(absl::Milliseconds(205));
+  // 20 runs, give or take the rounding of the first deadline and a loaded
+  // machine.
+  EXPECT_GE(GetCount(), 10);
+  EXPECT_LE(GetCount(), 22);
+}
+
+TEST_F(TimerDaemonTest, CancelPeriodic) {
+  TimerDaemon::DescriptorPtr desc;
+  ASSERT_OK(TimerDaemon::RequestPeriodicTimer(
+      0, 5, [this]() { return IncrementCount(); }, &desc));
+  absl::SleepFor(absl::Milliseconds(50));
+  desc.reset();
+  ASSERT_TRUE(TimerDaemon::Execute());
+  const int count = GetCount();
+  EXPECT_GT(count, 0);
+  absl::SleepFor(absl::Milliseconds(50));
+  EXPECT_EQ(count, GetCount());
+  EXPECT_EQ(0, NumTimerGroups());
+}
+
+TEST_F(TimerDaemonTest, ExecuteWaitsForDueActions) {
+  TimerDaemon::DescriptorPtr desc;
+  ASSERT_OK(TimerDaemon::RequestOneShotTimer(1,
+                                             [this]() {
+                                               absl::SleepFor(
+                                                   absl::Milliseconds(50));
+                                               return IncrementCount();
+                                             },
+                                             &desc));
+  absl::SleepFor(absl::Milliseconds(2));
+  ASSERT_TRUE(TimerDaemon::Execute());
+  EXPECT_EQ(1, GetCount());
+}
+
+TEST_F(TimerDaemonTest, SlowActionDoesNotDelayOtherTimers) {
+  TimerDaemon::DescriptorPtr slow, fast;
+  ASSERT_OK(TimerDaemon::RequestOneShotTimer(0,
+                                             []() {
+                                               absl::SleepFor(
+                                                   absl::Milliseconds(500));
+                                               return ::util::OkStatus();
+                                             },
+                                             &slow));
+  ASSERT_OK(TimerDaemon::RequestPeriodicTimer(
+      0, 10, [this]() { return IncrementCount(); }, &fast));
+  absl::SleepFor(absl::Milliseconds(300));
+  EXPECT_GE(GetCount(), 15);
+}
+
+TEST_F(TimerDaemonTest, PeriodicTimerSkipsTurnsWhileRunning) {
+  TimerDaemon::DescriptorPtr desc;
+  ASSERT_OK(TimerDaemon::RequestPeriodicTimer(0, 10,
+                                              [this]() {
+                                                absl::SleepFor(
+                                                    absl::Milliseconds(100));
+                                                return IncrementCount();
+                                              },
+                                              &desc));
+  absl::SleepFor(absl::Milliseconds(350));
+  desc.reset();
+  ASSERT_TRUE(TimerDaemon::Execute());
+  // The action never runs twice at once, so at most 4 runs fit in 350ms.
+  EXPECT_GE(GetCount(), 2);
+  EXPECT_LE(GetCount(), 4);
+}
+
+TEST_F(TimerDaemonTest, CoalescesPeriodicTimersWithSamePeriod) {
+  constexpr int kNumTimers = 1000;
+  constexpr int kPeriodMs = 1000;
+  std::vector<TimerDaemon::DescriptorPtr> descs(kNumTimers);
+  for (auto& desc : descs) {
+    ASSERT_OK(TimerDaemon::RequestPeriodicTimer(
+        0, kPeriodMs, []() { return ::util::OkStatus(); }, &desc));
+  }
+  // The first deadlines are rounded up to a multiple of 10ms, so the timers
+  // share at most one entry per 10ms of the period.
+  EXPECT_LE(NumTimerGroups(), kPeriodMs / 10);
+}
+
+TEST_F(TimerDaemonTest, JitterWith10kPeriodicTimers) {
+  constexpr int kNumTimers = 10000;
+  const absl::Duration kPeriod = absl::Milliseconds(500);
+  // Every timer records the deviation of the intervals between its runs from
+  // the period. A timer never runs concurrently with itself, so each one owns
+  // its entries.
+  std::vector<absl::Time> last_run(kNumTimers, absl::InfinitePast());
+  std::vector<std::vector<absl::Duration>> jitters(kNumTimers);
+  std::vector<TimerDaemon::DescriptorPtr> descs(kNumTimers);
+  for (int i = 0; i < kNumTimers; ++i) {
+    ASSERT_OK(TimerDaemon::RequestPeriodicTimer(
+        0, absl::ToInt64Milliseconds(kPeriod),
+        [i, kPeriod, &last_run, &jitters]() {
+          const absl::Time now = absl::Now();
+          if (last_run[i] != absl::InfinitePast()) {
+            jitters[i].push_back(
+                absl::AbsDuration(now - last_run[i] - kPeriod));
+          }
+          last_run[i] = now;
+          return ::util::OkStatus();
+        },
+        &descs[i]));
+  }
+  absl::SleepFor(kPeriod * 4 + kPeriod / 2);
+  descs.clear();
+  ASSERT_TRUE(TimerDaemon::Execute());
+
+  std::vector<absl::Duration> all;
+  for (const auto& timer_jitters : jitters) {
+    EXPECT_GE(timer_jitters.size(), 2U);
+    all.insert(all.end(), timer_jitters.begin(), timer_jitters.end());
+  }
+  ASSERT_FALSE(all.empty());
+  std::sort(all.begin(), all.end());
+  const absl::Duration p50 = all[all.size() / 2];
+  const absl::Duration p99 = all[all.size() * 99 / 100];
+  LOG(INFO) << "Jitter of " << kNumTimers << " periodic timers: p50 " << p50
+            << ", p99 " << p99 << ", max " << all.back() << ".";
+  EXPECT_LT(p99, absl::Milliseconds(50));
+}
+
+TEST_F(TimerDaemonTest, IdleCpuUsage) {
+  // A timer far away: the timer thread has nothing to do until then.
+  TimerDaemon::DescriptorPtr desc;
+  ASSERT_OK(TimerDaemon::RequestPeriodicTimer(
+      60000, 60000, []() { return ::util::OkStatus(); }, &desc));
+  const absl::Duration cpu_before = ProcessCpuTime();
+  absl::SleepFor(absl::Seconds(1));
+  const absl::Duration idle_cpu = ProcessCpuTime() - cpu_before;
+  LOG(INFO) << "CPU time used in 1s of idle: " << idle_cpu << ".";
+  EXPECT_LT(idle_cpu, absl::Milliseconds(5));
 }
 
 }  // namespace hal